@@ -0,0 +1,27 @@
+#ifndef CORO_HTTP_BENCHMARK_BENCHMARK_UTIL_H
+#define CORO_HTTP_BENCHMARK_BENCHMARK_UTIL_H
+
+#include <stdexcept>
+
+#include "coro/task.h"
+
+namespace coro {
+
+// Runs `func`, which must not wait for an event loop, as a task of its own.
+// Generators and shared promises resume their awaiters inline, so awaiting
+// them over and over in a single coroutine would keep growing the stack.
+template <typename F>
+void RunSynchronously(F func) {
+  bool done = false;
+  RunTask([&]() -> Task<> {
+    co_await func();
+    done = true;
+  });
+  if (!done) {
+    throw std::logic_error("task didn't complete synchronously");
+  }
+}
+
+}  // namespace coro
+
+#endif  // CORO_HTTP_BENCHMARK_BENCHMARK_UTIL_H
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "benchmark_util.h"
+#include "coro/http/cache_http.h"
+#include "coro/http/http.h"
+#include "coro/task.h"
+#include "coro/util/lru_cache.h"
+
+namespace coro {
+namespace {
+
+struct IntFactory {
+  Task<int> operator()(int key, stdx::stop_token) const { co_return key; }
+};
+
+using IntCache = util::LRUCache<int, IntFactory>;
+
+void Get(IntCache& cache, int key) {
+  RunSynchronously([&]() -> Task<> {
+    benchmark::DoNotOptimize(co_await cache.Get(key, stdx::stop_token()));
+  });
+}
+
+void BM_LRUCacheHit(benchmark::State& state) {
+  IntCache cache(1024, IntFactory{});
+  for (int i = 0; i < 1024; i++) {
+    Get(cache, i);
+  }
+  int key = 0;
+  for (auto _ : state) {
+    Get(cache, key);
+    key = (key + 1) % 1024;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LRUCacheHit);
+
+// Every lookup misses and evicts the least recently used entry.
+void BM_LRUCacheMiss(benchmark::State& state) {
+  IntCache cache(1024, IntFactory{});
+  int key = 0;
+  for (auto _ : state) {
+    Get(cache, key++);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LRUCacheMiss);
+
+class FakeHttp {
+ public:
+  explicit FakeHttp(size_t body_size) : body_(body_size, 'x') {}
+
+  Task<http::Response<>> Fetch(http::Request<>, stdx::stop_token) const {
+    co_return http::Response<>{
+        .status = 200,
+        .headers = {{"Content-Length", std::to_string(body_.size())},
+                    {"Cache-Control", "max-age=3600"}},
+        .body = http::CreateBody(body_)};
+  }
+
+ private:
+  std::string body_;
+};
+
+void Fetch(const http::CacheHttp& cache_http, int index) {
+  RunSynchronously([&]() -> Task<> {
+    http::Request<> request{.url = "http://host/" + std::to_string(index),
+                            .headers = {{"Accept", "application/json"}}};
+    auto response = co_await cache_http.Fetch(std::move(request), {});
+    benchmark::DoNotOptimize(
+        co_await http::GetBody(std::move(response.body)));
+  });
+}
+
+// Serves cached responses, including reading their bodies.
+void BM_CacheHttpHit(benchmark::State& state) {
+  const auto body_size = static_cast<size_t>(state.range(0));
+  http::Http http{FakeHttp(body_size)};
+  http::CacheHttp cache_http({}, &http);
+  for (int i = 0; i < 64; i++) {
+    Fetch(cache_http, i);
+  }
+  int index = 0;
+  for (auto _ : state) {
+    Fetch(cache_http, index);
+    index = (index + 1) % 64;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * body_size);
+}
+BENCHMARK(BM_CacheHttpHit)->Arg(64)->Arg(64 * 1024);
+
+// Fetches a different URL every time, filling and evicting cache entries.
+void BM_CacheHttpMiss(benchmark::State& state) {
+  http::Http http{FakeHttp(64)};
+  http::CacheHttp cache_http({.cache_size = 1024}, &http);
+  int index = 0;
+  for (auto _ : state) {
+    Fetch(cache_http, index++);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CacheHttpMiss);
+
+}  // namespace
+}  // namespace coro
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include "coro/generator.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro {
+namespace {
+
+Task<int> Identity(int value) { co_return value; }
+
+Generator<int> Iota(int count) {
+  for (int i = 0; i < count; i++) {
+    co_yield i;
+  }
+}
+
+// Creates, runs and destroys a coroutine frame per iteration.
+void BM_TaskCreateAndResume(benchmark::State& state) {
+  RunTask([&]() -> Task<> {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(co_await Identity(1));
+    }
+  });
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TaskCreateAndResume);
+
+void BM_GeneratorIteration(benchmark::State& state) {
+  const auto count = static_cast<int>(state.range(0));
+  RunTask([&]() -> Task<> {
+    for (auto _ : state) {
+      FOR_CO_AWAIT(int value, Iota(count)) { benchmark::DoNotOptimize(value); }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_GeneratorIteration)->Arg(1)->Arg(1024);
+
+// Round trip from the event loop to a worker thread and back.
+void BM_ThreadPoolDo(benchmark::State& state) {
+  util::EventLoop event_loop;
+  util::ThreadPool thread_pool(
+      &event_loop, static_cast<unsigned int>(state.range(0)));
+  RunTask([&]() -> Task<> {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(co_await thread_pool.Do([] { return 1; }));
+    }
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(util::EventLoopType::NoExitOnEmpty);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadPoolDo)->Arg(1)->Arg(4)->UseRealTime();
+
+void BM_EventLoopRunOnEventLoop(benchmark::State& state) {
+  util::EventLoop event_loop;
+  RunTask([&]() -> Task<> {
+    for (auto _ : state) {
+      Promise<void> done;
+      event_loop.RunOnEventLoop([&] { done.SetValue(); });
+      co_await done;
+    }
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(util::EventLoopType::NoExitOnEmpty);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventLoopRunOnEventLoop);
+
+}  // namespace
+}  // namespace coro
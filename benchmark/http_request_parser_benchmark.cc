@@ -0,0 +1,110 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coro/http/http_exception.h"
+#include "coro/http/http_request_parser.h"
+#include "coro/util/regex.h"
+
+namespace coro::http {
+namespace {
+
+namespace re = coro::util::re;
+
+constexpr std::string_view kRequest =
+    "GET /some/resource/path?query=value HTTP/1.1\r\n"
+    "Host: localhost:12345\r\n"
+    "User-Agent: curl/7.88.1\r\n"
+    "Accept: */*\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+struct LegacyRequest {
+  std::string method;
+  std::string url;
+  std::vector<std::pair<std::string, std::string>> headers;
+};
+
+// Byte-at-a-time accumulation and per-line regex matching, as done by the
+// server before HttpRequestParser.
+LegacyRequest LegacyParse(std::string_view data) {
+  std::string http_header;
+  size_t offset = 0;
+  while (!http_header.ends_with("\r\n\r\n")) {
+    http_header.push_back(data[offset++]);
+  }
+  LegacyRequest request;
+  size_t idx = 0;
+  while (idx < http_header.size()) {
+    size_t len = 0;
+    while (idx + len < http_header.size() &&
+           !std::string_view(http_header.data() + idx, len).ends_with("\r\n")) {
+      len++;
+    }
+    std::string_view line(http_header.data() + idx, len - strlen("\r\n"));
+    if (idx == 0) {
+      re::regex regex(R"(([A-Z]+) (\S+) HTTP\/1\.[01])");
+      re::match_results<std::string_view::const_iterator> match;
+      if (!re::regex_match(line.begin(), line.end(), match, regex)) {
+        throw HttpException(HttpException::kBadRequest, "malformed url");
+      }
+      request.method = match[1].str();
+      request.url = match[2].str();
+    } else if (!line.empty()) {
+      re::regex regex(R"((\S+):\s*(.+)$)");
+      re::match_results<std::string_view::const_iterator> match;
+      if (!re::regex_match(line.begin(), line.end(), match, regex)) {
+        throw HttpException(HttpException::kBadRequest, "malformed header");
+      }
+      request.headers.emplace_back(match[1], match[2]);
+    }
+    idx += len;
+  }
+  return request;
+}
+
+void BM_LegacyRequestParser(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LegacyParse(kRequest));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kRequest.size());
+}
+BENCHMARK(BM_LegacyRequestParser);
+
+void BM_HttpRequestParser(benchmark::State& state) {
+  HttpRequestParser parser;
+  for (auto _ : state) {
+    parser.Reset();
+    benchmark::DoNotOptimize(parser.Parse(kRequest));
+    benchmark::DoNotOptimize(parser.url());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kRequest.size());
+}
+BENCHMARK(BM_HttpRequestParser);
+
+// Feeds the request in pieces of the given size, as if it arrived in several
+// reads.
+void BM_HttpRequestParserFragmented(benchmark::State& state) {
+  const auto piece_size = static_cast<size_t>(state.range(0));
+  HttpRequestParser parser;
+  for (auto _ : state) {
+    parser.Reset();
+    for (size_t offset = 0; offset < kRequest.size(); offset += piece_size) {
+      benchmark::DoNotOptimize(
+          parser.Parse(kRequest.substr(offset, piece_size)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kRequest.size());
+}
+BENCHMARK(BM_HttpRequestParserFragmented)->Arg(1)->Arg(16)->Arg(64);
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "coro/http/curl_http.h"
+#include "coro/http/http_server.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::http {
+namespace {
+
+using ::coro::util::EventLoop;
+
+Generator<util::BufferSlice> CreateChunkedBody(int chunk_count,
+                                               size_t chunk_size) {
+  std::string chunk(chunk_size, 'x');
+  for (int i = 0; i < chunk_count; i++) {
+    co_yield chunk;
+  }
+}
+
+// Runs `client` against a loopback server whose handler is `handler`.
+template <typename Handler, typename Client>
+void RunWithServer(benchmark::State& state, Handler handler, Client client) {
+  EventLoop event_loop;
+  CurlHttp http(&event_loop, CurlHttpConfig{.native_ca_certs = false});
+  RunTask([&]() -> Task<> {
+    auto http_server = CreateHttpServer(std::move(handler), &event_loop,
+                                        {.address = "127.0.0.1", .port = 0});
+    std::string address =
+        "http://127.0.0.1:" + std::to_string(http_server.GetPort());
+    try {
+      co_await client(http, address);
+    } catch (const std::exception& e) {
+      state.SkipWithError(e.what());
+    }
+    co_await http_server.Quit();
+  });
+  event_loop.EnterLoop();
+}
+
+// Sequential small requests over a single kept-alive connection.
+void BM_LoopbackKeepAliveRequests(benchmark::State& state) {
+  RunWithServer(
+      state,
+      [](Request<>, stdx::stop_token) -> Task<Response<>> {
+        co_return Response<>{.status = 200,
+                             .headers = {{"Content-Length", "2"}},
+                             .body = CreateBody("ok")};
+      },
+      [&](const CurlHttp& http, const std::string& address) -> Task<> {
+        for (auto _ : state) {
+          Request<> request{.url = address};
+          auto response =
+              co_await http.Fetch(std::move(request), stdx::stop_token());
+          benchmark::DoNotOptimize(co_await GetBody(std::move(response.body)));
+        }
+      });
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoopbackKeepAliveRequests)->UseRealTime();
+
+// A chunked response of `state.range(0)` chunks of 64KiB per iteration.
+void BM_ChunkedStreamingThroughput(benchmark::State& state) {
+  constexpr size_t kChunkSize = 64 * 1024;
+  const auto chunk_count = static_cast<int>(state.range(0));
+  RunWithServer(
+      state,
+      [chunk_count](Request<>, stdx::stop_token) -> Task<Response<>> {
+        co_return Response<>{.status = 200,
+                             .body = CreateChunkedBody(chunk_count,
+                                                       kChunkSize)};
+      },
+      [&](const CurlHttp& http, const std::string& address) -> Task<> {
+        for (auto _ : state) {
+          Request<> request{.url = address};
+          auto response =
+              co_await http.Fetch(std::move(request), stdx::stop_token());
+          FOR_CO_AWAIT(std::string_view chunk, response.body) {
+            benchmark::DoNotOptimize(chunk);
+          }
+        }
+      });
+  state.SetBytesProcessed(state.iterations() * chunk_count * kChunkSize);
+}
+BENCHMARK(BM_ChunkedStreamingThroughput)->Arg(16)->UseRealTime();
+
+}  // namespace
+}  // namespace coro::http
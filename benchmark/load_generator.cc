@@ -0,0 +1,394 @@
+// Drives open-loop load against an HTTP endpoint and prints latency
+// histograms and throughput as JSON, e.g.
+//
+//   coro-http-load-generator --rate=20000 --duration=10 --concurrency=256
+//
+// Requests are scheduled at a fixed rate regardless of how fast responses
+// come back, and their latency is measured from the time they were scheduled
+// rather than sent, so that a stalled server shows up in the tail instead of
+// slowing the load down (coordinated omission). Without --url the requests go
+// to an in-process loopback server.
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/http/curl_http.h"
+#include "coro/http/http.h"
+#include "coro/http/http_server.h"
+#include "coro/promise.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/hdr_histogram.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::http {
+namespace {
+
+using ::coro::util::EventLoop;
+using ::coro::util::HdrHistogram;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view kUsage =
+    "Usage: coro-http-load-generator [--flag=value...]\n"
+    "  --url             target, a loopback server if empty\n"
+    "  --rate            requests per second (1000)\n"
+    "  --duration        seconds of measured load (10)\n"
+    "  --warmup          seconds of load before measuring (1)\n"
+    "  --concurrency     requests in flight at most (64)\n"
+    "  --response_size   body size of the loopback server (1024)\n"
+    "  --server_threads  loopback server threads, 0 for the client's (0)\n"
+    "  --output          JSON file to write, stdout if empty\n";
+
+struct LoadConfig {
+  std::string url;
+  double rate = 1000;
+  double duration = 10;
+  double warmup = 1;
+  int concurrency = 64;
+  size_t response_size = 1024;
+  unsigned server_threads = 0;
+  std::string output;
+};
+
+LoadConfig ParseArgs(int argc, char** argv) {
+  LoadConfig config;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    auto separator = arg.find('=');
+    if (!arg.starts_with("--") || separator == std::string_view::npos) {
+      throw InvalidArgument("malformed flag " + std::string(arg));
+    }
+    std::string_view name = arg.substr(2, separator - 2);
+    std::string value(arg.substr(separator + 1));
+    if (name == "url") {
+      config.url = std::move(value);
+    } else if (name == "rate") {
+      config.rate = std::stod(value);
+    } else if (name == "duration") {
+      config.duration = std::stod(value);
+    } else if (name == "warmup") {
+      config.warmup = std::stod(value);
+    } else if (name == "concurrency") {
+      config.concurrency = std::stoi(value);
+    } else if (name == "response_size") {
+      config.response_size = std::stoull(value);
+    } else if (name == "server_threads") {
+      config.server_threads = static_cast<unsigned>(std::stoul(value));
+    } else if (name == "output") {
+      config.output = std::move(value);
+    } else {
+      throw InvalidArgument("unknown flag " + std::string(arg));
+    }
+  }
+  if (config.rate <= 0 || config.duration <= 0 || config.warmup < 0 ||
+      config.concurrency <= 0) {
+    throw InvalidArgument("rate, duration and concurrency have to be positive");
+  }
+  return config;
+}
+
+std::string EscapeJson(std::string_view input) {
+  std::string result;
+  for (char c : input) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      constexpr std::string_view kHex = "0123456789abcdef";
+      result += "\\u00";
+      result += kHex[static_cast<unsigned char>(c) >> 4];
+      result += kHex[c & 0xf];
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+void WriteHistogram(const HdrHistogram& histogram, std::ostream& output) {
+  output << "{\"count\": " << histogram.count()
+         << ", \"min\": " << histogram.min().count()
+         << ", \"mean\": " << histogram.mean().count();
+  for (auto [name, percentile] :
+       {std::pair<std::string_view, double>{"p50", 50.0},
+        {"p90", 90.0},
+        {"p99", 99.0},
+        {"p99.9", 99.9},
+        {"p99.99", 99.99}}) {
+    output << ", \"" << name
+           << "\": " << histogram.GetPercentile(percentile).count();
+  }
+  output << ", \"max\": " << histogram.max().count() << ", \"buckets\": [";
+  bool first = true;
+  histogram.ForEachBucket([&](std::chrono::microseconds lowest,
+                              std::chrono::microseconds highest,
+                              uint64_t count) {
+    output << (first ? "" : ", ") << "[" << lowest.count() << ", "
+           << highest.count() << ", " << count << "]";
+    first = false;
+  });
+  output << "]}";
+}
+
+// Issues requests at `config.rate` per second for the warmup and the measured
+// duration. A request due while `config.concurrency` are in flight is queued
+// until one of them finishes, its latency still counting from when it was due.
+class LoadGenerator {
+ public:
+  LoadGenerator(const EventLoop* event_loop, const CurlHttp* http,
+                const LoadConfig* config)
+      : event_loop_(event_loop), http_(http), config_(config) {}
+
+  Task<> Run() {
+    start_ = Clock::now();
+    measure_start_ = start_ + ToDuration(config_->warmup);
+    auto total = static_cast<uint64_t>(config_->rate *
+                                       (config_->warmup + config_->duration));
+    for (uint64_t next = 0; next < total;) {
+      auto now = Clock::now();
+      for (; next < total && GetScheduledTime(next) <= now; next++) {
+        Dispatch(GetScheduledTime(next));
+      }
+      if (next < total) {
+        auto delay = std::chrono::ceil<std::chrono::milliseconds>(
+            GetScheduledTime(next) - Clock::now());
+        co_await event_loop_->Wait(
+            static_cast<int>(std::max<int64_t>(delay.count(), 0)));
+      }
+    }
+    dispatch_end_ = Clock::now();
+    dispatched_ = true;
+    if (in_flight_ > 0) {
+      co_await drained_;
+    }
+  }
+
+  void WriteJson(std::ostream& output) const {
+    CurlHttpStats curl = http_->GetStats();
+    double elapsed = std::chrono::duration<double>(
+                         std::max(last_finish_, dispatch_end_) - measure_start_)
+                         .count();
+    output << "{\n  \"url\": \"" << EscapeJson(config_->url) << "\",\n"
+           << "  \"rate\": " << config_->rate << ",\n"
+           << "  \"duration_s\": " << config_->duration << ",\n"
+           << "  \"warmup_s\": " << config_->warmup << ",\n"
+           << "  \"concurrency\": " << config_->concurrency << ",\n"
+           << "  \"completed\": " << completed_ << ",\n"
+           << "  \"errors\": " << error_count_ << ",\n"
+           << "  \"max_queued\": " << max_queued_ << ",\n"
+           << "  \"statuses\": {";
+    bool first = true;
+    for (auto [status, count] : status_counts_) {
+      output << (first ? "" : ", ") << "\"" << status << "\": " << count;
+      first = false;
+    }
+    output << "},\n"
+           << "  \"requests_per_s\": " << double(completed_) / elapsed << ",\n"
+           << "  \"bytes_per_s\": " << double(bytes_received_) / elapsed
+           << ",\n"
+           << "  \"curl\": {\"transfers\": " << curl.transfer_count
+           << ", \"failed\": " << curl.failed_transfer_count
+           << ", \"reused_connections\": " << curl.reused_connection_count
+           << "},\n"
+           << "  \"latency_us\": ";
+    WriteHistogram(latency_, output);
+    output << ",\n  \"service_time_us\": ";
+    WriteHistogram(service_time_, output);
+    output << ",\n  \"first_byte_us\": ";
+    WriteHistogram(first_byte_, output);
+    output << "\n}\n";
+  }
+
+ private:
+  static Clock::duration ToDuration(double seconds) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+  }
+
+  Clock::time_point GetScheduledTime(uint64_t index) const {
+    return start_ + ToDuration(double(index) / config_->rate);
+  }
+
+  void Dispatch(Clock::time_point scheduled) {
+    if (in_flight_ < config_->concurrency) {
+      in_flight_++;
+      RunTask(Send(scheduled));
+    } else {
+      queued_.push_back(scheduled);
+      max_queued_ = std::max(max_queued_, queued_.size());
+    }
+  }
+
+  Task<> Send(Clock::time_point scheduled) {
+    auto sent = Clock::now();
+    try {
+      Request<> request{.url = config_->url};
+      auto response =
+          co_await http_->Fetch(std::move(request), stdx::stop_token());
+      auto first_byte = Clock::now();
+      uint64_t size = 0;
+      FOR_CO_AWAIT(std::string_view chunk, response.body) {
+        size += chunk.size();
+      }
+      Record(scheduled, sent, first_byte, response.status, size);
+    } catch (const std::exception& e) {
+      if (error_count_++ == 0) {
+        std::cerr << "[LOAD]: " << e.what() << '\n';
+      }
+    }
+    if (!queued_.empty()) {
+      Clock::time_point next = queued_.front();
+      queued_.pop_front();
+      RunTask(Send(next));
+    } else if (--in_flight_ == 0 && dispatched_) {
+      drained_.SetValue();
+    }
+  }
+
+  void Record(Clock::time_point scheduled, Clock::time_point sent,
+              Clock::time_point first_byte, int status, uint64_t size) {
+    auto finished = Clock::now();
+    if (scheduled < measure_start_) {
+      return;
+    }
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    latency_.Add(duration_cast<microseconds>(finished - scheduled));
+    service_time_.Add(duration_cast<microseconds>(finished - sent));
+    first_byte_.Add(duration_cast<microseconds>(first_byte - sent));
+    status_counts_[status]++;
+    if (status >= 400) {
+      error_count_++;
+    }
+    completed_++;
+    bytes_received_ += size;
+    last_finish_ = std::max(last_finish_, finished);
+  }
+
+  const EventLoop* event_loop_;
+  const CurlHttp* http_;
+  const LoadConfig* config_;
+  Clock::time_point start_;
+  Clock::time_point measure_start_;
+  Clock::time_point dispatch_end_;
+  Clock::time_point last_finish_;
+  bool dispatched_ = false;
+  int in_flight_ = 0;
+  std::deque<Clock::time_point> queued_;
+  size_t max_queued_ = 0;
+  Promise<void> drained_;
+  HdrHistogram latency_;
+  HdrHistogram service_time_;
+  HdrHistogram first_byte_;
+  std::map<int, uint64_t> status_counts_;
+  uint64_t completed_ = 0;
+  uint64_t error_count_ = 0;
+  uint64_t bytes_received_ = 0;
+};
+
+Task<> RunLoad(const EventLoop* event_loop, const LoadConfig& config) {
+  CurlHttpConfig curl_config;
+  if (!config.url.starts_with("https://")) {
+    curl_config.native_ca_certs = false;
+  }
+  CurlHttp http(event_loop, std::move(curl_config));
+  LoadGenerator generator(event_loop, &http, &config);
+  co_await generator.Run();
+  if (config.output.empty()) {
+    generator.WriteJson(std::cout);
+  } else {
+    std::ofstream output(config.output);
+    generator.WriteJson(output);
+    if (!output) {
+      throw RuntimeError("couldn't write " + config.output);
+    }
+  }
+}
+
+HttpHandler CreateLoopbackHandler(size_t response_size) {
+  auto body = std::make_shared<const std::string>(response_size, 'x');
+  return [body](Request<>, stdx::stop_token) -> Task<Response<>> {
+    co_return Response<>{
+        .status = 200,
+        .headers = {{"Content-Length", std::to_string(body->size())}},
+        .body = CreateBody(std::string(*body))};
+  };
+}
+
+template <typename Server>
+Task<> RunLoad(const EventLoop* event_loop, LoadConfig config,
+               Server& server) {
+  config.url = "http://127.0.0.1:" + std::to_string(server.GetPort());
+  std::exception_ptr exception;
+  try {
+    co_await RunLoad(event_loop, config);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  co_await server.Quit();
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+Task<> CoMain(const EventLoop* event_loop, LoadConfig config) {
+  if (!config.url.empty()) {
+    co_await RunLoad(event_loop, config);
+  } else if (config.server_threads == 0) {
+    auto server =
+        CreateHttpServer(CreateLoopbackHandler(config.response_size),
+                         event_loop, {.address = "127.0.0.1", .port = 0});
+    co_await RunLoad(event_loop, std::move(config), server);
+  } else {
+    size_t response_size = config.response_size;
+    auto server = CreateMultiThreadedHttpServer(
+        [response_size](const EventLoop*) {
+          return CreateLoopbackHandler(response_size);
+        },
+        event_loop,
+        {.server = {.address = "127.0.0.1", .port = 0},
+         .thread_count = config.server_threads});
+    co_await RunLoad(event_loop, std::move(config), server);
+  }
+}
+
+}  // namespace
+}  // namespace coro::http
+
+int main(int argc, char** argv) {
+  coro::http::LoadConfig config;
+  try {
+    config = coro::http::ParseArgs(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << "[LOAD]: " << e.what() << '\n' << coro::http::kUsage;
+    return 1;
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+  coro::util::EventLoop event_loop;
+  int exit_code = 0;
+  coro::RunTask([&]() -> coro::Task<> {
+    try {
+      co_await coro::http::CoMain(&event_loop, std::move(config));
+    } catch (const std::exception& e) {
+      std::cerr << "[LOAD]: " << e.what() << '\n';
+      exit_code = 1;
+    }
+  });
+  event_loop.EnterLoop();
+  return exit_code;
+}
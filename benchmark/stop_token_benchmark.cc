@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro {
+namespace {
+
+template <typename StopSource>
+void BM_StopCallbackRegistration(benchmark::State& state) {
+  StopSource stop_source;
+  int invoked = 0;
+  for (auto _ : state) {
+    stdx::stop_callback callback(stop_source.get_token(), [&] { invoked++; });
+    benchmark::DoNotOptimize(&callback);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StopCallbackRegistration<stdx::stop_source>);
+BENCHMARK(BM_StopCallbackRegistration<stdx::inplace_stop_source>);
+
+// Cancellation bookkeeping of a served request: a connection's stop source
+// chained to the server's, the callbacks waking its readers and writers, and
+// a StopTokenOr joining the connection's token with a request deadline.
+void BM_PerRequestCancellation(benchmark::State& state) {
+  stdx::stop_source server_stop_source;
+  stdx::stop_source deadline;
+  int invoked = 0;
+  for (auto _ : state) {
+    stdx::stop_source connection;
+    stdx::stop_callback stop_connection(server_stop_source.get_token(),
+                                        [&] { connection.request_stop(); });
+    stdx::stop_callback wake_reader(connection.get_token(),
+                                    [&] { invoked++; });
+    stdx::stop_callback wake_writer(connection.get_token(),
+                                    [&] { invoked++; });
+    util::StopTokenOr<2> stop_token_or(connection.get_token(),
+                                       deadline.get_token());
+    benchmark::DoNotOptimize(stop_token_or.GetToken().stop_requested());
+    connection.request_stop();
+  }
+  benchmark::DoNotOptimize(invoked);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PerRequestCancellation);
+
+}  // namespace
+}  // namespace coro
@@ -46,7 +46,7 @@ coro::Task<> CoMain(const coro::util::EventLoop *event_loop) noexcept {
     }
 
     std::size_t size = 0;
-    FOR_CO_AWAIT(const std::string &bytes, response.body) {
+    FOR_CO_AWAIT(const coro::util::BufferSlice &bytes, response.body) {
       std::cerr << "awaiting...\n";
       co_await event_loop->Wait(1000, stop_source.get_token());
       std::cerr << "bytes:" << bytes.size() << "\n";
@@ -72,4 +72,4 @@ int main() {
   coro::RunTask(CoMain(&event_loop));
   event_loop.EnterLoop();
   return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "coro/generator.h"
 #include "coro/http/curl_http.h"
 #include "coro/http/http_parse.h"
+#include "coro/http/http_router.h"
 #include "coro/http/http_server.h"
 #include "coro/util/event_loop.h"
 #include "coro/util/raii_utils.h"
@@ -13,8 +14,7 @@ constexpr const char *kUrl =
 
 class HttpHandler {
  public:
-  HttpHandler(const coro::http::Http *http, coro::Promise<void> *semaphore)
-      : http_(http), semaphore_(semaphore) {}
+  explicit HttpHandler(const coro::http::Http *http) : http_(http) {}
 
   coro::Task<coro::http::Response<>> operator()(
       coro::http::Request<> request, coro::stdx::stop_token stop_token) const {
@@ -22,9 +22,6 @@ class HttpHandler {
     if (auto range_header = coro::http::GetHeader(request.headers, "Range")) {
       pipe_request.headers.emplace_back("Range", std::move(*range_header));
     }
-    if (request.url == "/quit") {
-      semaphore_->SetValue();
-    }
     auto pipe =
         co_await http_->Fetch(std::move(pipe_request), std::move(stop_token));
     co_return coro::http::Response<>{.status = pipe.status,
@@ -34,7 +31,6 @@ class HttpHandler {
 
  private:
   const coro::http::Http *http_;
-  coro::Promise<void> *semaphore_;
 };
 
 int main() {
@@ -46,12 +42,23 @@ int main() {
   coro::RunTask([&]() -> coro::Task<> {
     coro::http::Http http{coro::http::CurlHttp(&event_loop)};
     coro::Promise<void> semaphore;
+    coro::http::HttpRouter router;
+    router
+        .Add(coro::http::Method::kGet, "/quit",
+             [&](coro::http::Request<> &, const coro::http::PathParams &,
+                 coro::stdx::stop_token)
+                 -> coro::Task<coro::http::Response<>> {
+               semaphore.SetValue();
+               co_return coro::http::Response<>{
+                   .status = 200, .body = coro::http::CreateBody("")};
+             })
+        .SetFallback(HttpHandler(&http));
     auto http_server = coro::http::CreateHttpServer(
-        HttpHandler{&http, &semaphore}, &event_loop,
+        std::move(router), &event_loop,
         {.address = "127.0.0.1", .port = 4444});
     co_await semaphore;
     co_await http_server.Quit();
   });
   event_loop.EnterLoop();
   return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
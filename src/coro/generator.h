@@ -8,6 +8,11 @@
 #include "coro/stdx/coroutine.h"
 #include "coro/task.h"
 
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+#include "coro/stdx/source_location.h"
+#include "coro/util/coroutine_trace.h"
+#endif
+
 namespace coro {
 
 template <typename T>
@@ -21,20 +26,55 @@ class async_generator_advance_operation;
 
 class async_generator_promise_base {
  public:
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  explicit async_generator_promise_base(stdx::source_location location) noexcept
+      : exception_(nullptr), location_(location) {
+    util::detail::TraceCoroutine(util::detail::CoroutineTraceEventType::kCreate,
+                                 this, location_);
+  }
+
+  ~async_generator_promise_base() {
+    util::detail::TraceCoroutine(
+        util::detail::CoroutineTraceEventType::kDestroy, this, location_);
+  }
+#else
   async_generator_promise_base() noexcept : exception_(nullptr) {
     // Other variables left intentionally uninitialised as they're
     // only referenced in certain states by which time they should
     // have been initialised.
   }
+#endif
 
   async_generator_promise_base(const async_generator_promise_base& other) =
       delete;
   async_generator_promise_base& operator=(
       const async_generator_promise_base& other) = delete;
 
+  static void* operator new(size_t size) {
+    return util::AllocateFrame(size);
+  }
+  static void operator delete(void* ptr, size_t size) noexcept {
+    util::DeallocateFrame(ptr, size);
+  }
+
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  [[nodiscard]] util::detail::TracedInitialSuspend initial_suspend()
+      const noexcept {
+    return {this, location_};
+  }
+
+  template <typename Awaitable>
+  auto await_transform(
+      Awaitable&& awaitable,
+      stdx::source_location site = stdx::source_location::current()) {
+    return util::detail::TracedAwaitable<Awaitable>(
+        this, location_, site, std::forward<Awaitable>(awaitable));
+  }
+#else
   [[nodiscard]] stdx::suspend_always initial_suspend() const noexcept {
     return {};
   }
+#endif
 
   async_generator_yield_operation final_suspend() noexcept;
 
@@ -63,6 +103,9 @@ class async_generator_promise_base {
 
   std::exception_ptr exception_;
   stdx::coroutine_handle<void> consumer_coroutine_;
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  stdx::source_location location_;
+#endif
 
  protected:
   void* current_value_;
@@ -70,32 +113,66 @@ class async_generator_promise_base {
 
 class async_generator_yield_operation final {
  public:
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  // `producer` is null for the final suspend point, which is never resumed.
+  async_generator_yield_operation(
+      stdx::coroutine_handle<void> consumer,
+      const async_generator_promise_base* producer) noexcept
+      : consumer_(consumer), producer_(producer) {}
+#else
   async_generator_yield_operation(
       stdx::coroutine_handle<void> consumer) noexcept
       : consumer_(consumer) {}
+#endif
 
   [[nodiscard]] bool await_ready() const noexcept { return false; }
 
   stdx::coroutine_handle<void> await_suspend(
       stdx::coroutine_handle<void>) noexcept {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+    if (producer_) {
+      util::detail::TraceCoroutine(
+          util::detail::CoroutineTraceEventType::kSuspend, producer_,
+          producer_->location_);
+    }
+#endif
     return consumer_;
   }
 
-  void await_resume() noexcept {}
+  void await_resume() noexcept {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+    util::detail::TraceCoroutine(
+        util::detail::CoroutineTraceEventType::kResume, producer_,
+        producer_->location_);
+#endif
+  }
 
  private:
   stdx::coroutine_handle<void> consumer_;
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  const async_generator_promise_base* producer_;
+#endif
 };
 
 inline async_generator_yield_operation
 async_generator_promise_base::final_suspend() noexcept {
   current_value_ = nullptr;
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  util::detail::TraceCoroutine(util::detail::CoroutineTraceEventType::kComplete,
+                               this, location_);
+  return async_generator_yield_operation{consumer_coroutine_, nullptr};
+#else
   return internal_yield_value();
+#endif
 }
 
 inline async_generator_yield_operation
 async_generator_promise_base::internal_yield_value() noexcept {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  return async_generator_yield_operation{consumer_coroutine_, this};
+#else
   return async_generator_yield_operation{consumer_coroutine_};
+#endif
 }
 
 class async_generator_advance_operation {
@@ -123,12 +200,25 @@ class async_generator_advance_operation {
   stdx::coroutine_handle<void> producer_coroutine_;
 };
 
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+// The default argument is evaluated where the compiler constructs the promise,
+// so it's the location of the coroutine itself.
+#define CORO_HTTP_GENERATOR_PROMISE_CONSTRUCTOR                            \
+  explicit async_generator_promise(                                        \
+      stdx::source_location location = stdx::source_location::current()) \
+      noexcept                                                             \
+      : async_generator_promise_base(location) {}
+#else
+#define CORO_HTTP_GENERATOR_PROMISE_CONSTRUCTOR \
+  async_generator_promise() noexcept = default;
+#endif
+
 template <typename T>
 class async_generator_promise final : public async_generator_promise_base {
   using value_type = std::remove_reference_t<T>;
 
  public:
-  async_generator_promise() noexcept = default;
+  CORO_HTTP_GENERATOR_PROMISE_CONSTRUCTOR
 
   Generator<T> get_return_object() noexcept;
 
@@ -147,7 +237,7 @@ class async_generator_promise final : public async_generator_promise_base {
 template <typename T>
 class async_generator_promise<T&&> final : public async_generator_promise_base {
  public:
-  async_generator_promise() noexcept = default;
+  CORO_HTTP_GENERATOR_PROMISE_CONSTRUCTOR
 
   Generator<T> get_return_object() noexcept;
 
@@ -161,6 +251,8 @@ class async_generator_promise<T&&> final : public async_generator_promise_base {
   }
 };
 
+#undef CORO_HTTP_GENERATOR_PROMISE_CONSTRUCTOR
+
 template <typename T>
 class async_generator_increment_operation final
     : public async_generator_advance_operation {
@@ -204,6 +296,8 @@ class async_generator_iterator final {
 
   reference operator*() const noexcept { return coroutine_.promise().value(); }
 
+  pointer operator->() const noexcept { return &**this; }
+
   bool operator==(const async_generator_iterator& other) const noexcept {
     return coroutine_ == other.coroutine_;
   }
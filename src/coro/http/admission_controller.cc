@@ -0,0 +1,134 @@
+#include "coro/http/admission_controller.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "coro/util/raii_utils.h"
+
+namespace coro::http {
+
+namespace {
+
+int DivideRoundingUp(int limit, unsigned int thread_count) {
+  auto count = static_cast<int>(thread_count);
+  return (limit + count - 1) / count;
+}
+
+}  // namespace
+
+bool ClientRequestCounts::TryAdd(std::string_view client) {
+  Stripe& stripe = GetStripe(client);
+  std::unique_lock lock(stripe.mutex);
+  auto it = stripe.counts.find(client);
+  if (it == stripe.counts.end()) {
+    it = stripe.counts.emplace(std::string(client), 0).first;
+  }
+  if (it->second >= max_requests_per_client_) {
+    return false;
+  }
+  it->second++;
+  return true;
+}
+
+void ClientRequestCounts::Remove(std::string_view client) {
+  Stripe& stripe = GetStripe(client);
+  std::unique_lock lock(stripe.mutex);
+  auto it = stripe.counts.find(client);
+  if (--it->second == 0) {
+    stripe.counts.erase(it);
+  }
+}
+
+AdmissionController::AdmissionController(
+    const AdmissionConfig& config,
+    std::shared_ptr<ClientRequestCounts> client_request_counts)
+    : config_(config),
+      client_request_counts_(std::move(client_request_counts)),
+      semaphore_(std::max(config.max_in_flight_requests, 0)) {}
+
+Task<bool> AdmissionController::Admit(std::string_view client,
+                                      stdx::stop_token stop_token) {
+  if (client_request_counts_ && !client_request_counts_->TryAdd(client)) {
+    co_return false;
+  }
+  if (config_.max_in_flight_requests <= 0) {
+    co_return true;
+  }
+  Clock::time_point start = Clock::now();
+  if (!semaphore_.TryAcquire()) {
+    if (queued_count_ >= config_.max_queued_requests) {
+      ReleaseClient(client);
+      co_return false;
+    }
+    queued_count_++;
+    auto queued_guard = coro::util::AtScopeExit([&] { queued_count_--; });
+    try {
+      co_await semaphore_.Acquire(std::move(stop_token));
+    } catch (...) {
+      ReleaseClient(client);
+      throw;
+    }
+  }
+  if (IsQueueDelayExceeded(Clock::now() - start)) {
+    Release(client);
+    co_return false;
+  }
+  co_return true;
+}
+
+void AdmissionController::Release(std::string_view client) {
+  ReleaseClient(client);
+  if (config_.max_in_flight_requests > 0) {
+    semaphore_.Release();
+  }
+}
+
+void AdmissionController::ReleaseClient(std::string_view client) {
+  if (client_request_counts_) {
+    client_request_counts_->Remove(client);
+  }
+}
+
+bool AdmissionController::IsQueueDelayExceeded(Clock::duration delay) {
+  Clock::time_point now = Clock::now();
+  if (now >= interval_end_) {
+    standing_queue_ = min_queue_delay_ != Clock::duration::max() &&
+                      min_queue_delay_ > config_.target_queue_delay;
+    min_queue_delay_ = Clock::duration::max();
+    interval_end_ = now + config_.interval;
+  }
+  min_queue_delay_ = std::min(min_queue_delay_, delay);
+  if (standing_queue_) {
+    return delay > config_.target_queue_delay;
+  } else {
+    return delay > config_.interval;
+  }
+}
+
+std::shared_ptr<ClientRequestCounts> CreateClientRequestCounts(
+    const AdmissionConfig& config) {
+  if (config.max_requests_per_client <= 0) {
+    return nullptr;
+  }
+  return std::make_shared<ClientRequestCounts>(config.max_requests_per_client);
+}
+
+std::unique_ptr<AdmissionController> CreateAdmissionController(
+    const AdmissionConfig& config, unsigned int thread_count,
+    std::shared_ptr<ClientRequestCounts> client_request_counts) {
+  if (config.max_in_flight_requests <= 0 &&
+      config.max_requests_per_client <= 0) {
+    return nullptr;
+  }
+  AdmissionConfig thread_config = config;
+  if (config.max_in_flight_requests > 0) {
+    thread_config.max_in_flight_requests =
+        DivideRoundingUp(config.max_in_flight_requests, thread_count);
+    thread_config.max_queued_requests =
+        DivideRoundingUp(config.max_queued_requests, thread_count);
+  }
+  return std::make_unique<AdmissionController>(
+      thread_config, std::move(client_request_counts));
+}
+
+}  // namespace coro::http
@@ -0,0 +1,102 @@
+#ifndef CORO_HTTP_ADMISSION_CONTROLLER_H
+#define CORO_HTTP_ADMISSION_CONTROLLER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "coro/http/http_server.h"
+#include "coro/mutex.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::http {
+
+// Requests handled or waiting per client IP address, shared by all the
+// threads of a server, so that AdmissionConfig::max_requests_per_client holds
+// for the whole server.
+class ClientRequestCounts {
+ public:
+  explicit ClientRequestCounts(int max_requests_per_client)
+      : max_requests_per_client_(max_requests_per_client) {}
+
+  // Returns false if the client is at its limit already. Only allocates for a
+  // client which has no requests yet.
+  bool TryAdd(std::string_view client);
+  void Remove(std::string_view client);
+
+ private:
+  struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  // Clients are spread over stripes by their hash, so that the threads rarely
+  // contend for a lock.
+  struct Stripe {
+    std::mutex mutex;
+    std::unordered_map<std::string, int, StringHash, std::equal_to<>> counts;
+  };
+
+  Stripe& GetStripe(std::string_view client) {
+    return stripes_[StringHash{}(client) % stripes_.size()];
+  }
+
+  int max_requests_per_client_;
+  std::array<Stripe, 16> stripes_;
+};
+
+// Decides which requests a thread of a server handles, see AdmissionConfig.
+class AdmissionController {
+ public:
+  // `config` has the limits of this thread. `client_request_counts`, if not
+  // null, may be shared with the controllers of the other threads.
+  AdmissionController(
+      const AdmissionConfig& config,
+      std::shared_ptr<ClientRequestCounts> client_request_counts);
+
+  // Returns false if the request is shed. Otherwise the request has to be
+  // released once it's done.
+  Task<bool> Admit(std::string_view client, stdx::stop_token stop_token);
+  void Release(std::string_view client);
+
+  std::chrono::seconds retry_after() const { return config_.retry_after; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void ReleaseClient(std::string_view client);
+  bool IsQueueDelayExceeded(Clock::duration delay);
+
+  AdmissionConfig config_;
+  std::shared_ptr<ClientRequestCounts> client_request_counts_;
+  Semaphore semaphore_;
+  int queued_count_ = 0;
+  Clock::time_point interval_end_;
+  Clock::duration min_queue_delay_ = Clock::duration::max();
+  bool standing_queue_ = false;
+};
+
+// Null unless `config` limits the requests per client.
+std::shared_ptr<ClientRequestCounts> CreateClientRequestCounts(
+    const AdmissionConfig& config);
+
+// Controller of one of the `thread_count` threads of a server, null if
+// `config` sets no limits. Each thread queues its own requests, so the limits
+// on requests handled and queued at once are divided between the threads.
+std::unique_ptr<AdmissionController> CreateAdmissionController(
+    const AdmissionConfig& config, unsigned int thread_count,
+    std::shared_ptr<ClientRequestCounts> client_request_counts);
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_ADMISSION_CONTROLLER_H
@@ -1,13 +1,179 @@
 #include "coro/http/cache_http.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/util/raii_utils.h"
+
 namespace coro::http {
 
+// Chunks of a response body, appended while it is being received, or a body
+// mapped from the disk cache, whose pages are faulted in on `thread_pool` if
+// set. A body which outgrows `max_size` is truncated: it isn't cached and,
+// once its readers are past them, drops its oldest chunks until it holds no
+// more than `max_size` again.
+struct CacheHttp::CachedBody {
+  void Append(util::BufferSlice chunk) {
+    size += chunk.size();
+    retained_size += chunk.size();
+    chunks.push_back(std::move(chunk));
+    if (size > max_size) {
+      truncated = true;
+    }
+    ReleaseReadChunks();
+    Notify();
+  }
+
+  void Finish(std::exception_ptr e) {
+    done = true;
+    exception = std::move(e);
+    Notify();
+  }
+
+  // Waits until a chunk is appended, the body is finished or, for the filler
+  // of a truncated body, readers move on.
+  Task<> WaitForUpdate(stdx::stop_token stop_token) {
+    Promise<void> semaphore;
+    awaiters.insert(&semaphore);
+    auto guard = util::AtScopeExit([&] { awaiters.erase(&semaphore); });
+    stdx::stop_callback stop_callback(
+        stop_token, [&] { semaphore.SetException(InterruptedException()); });
+    co_await semaphore;
+  }
+
+  // Awaiters which start waiting again while being woken up are left for the
+  // next update.
+  void Notify() {
+    std::vector<Promise<void>*> woken(awaiters.begin(), awaiters.end());
+    for (Promise<void>* awaiter : woken) {
+      if (awaiters.erase(awaiter)) {
+        awaiter->SetValue();
+      }
+    }
+  }
+
+  // Index in the body of the next chunk to be appended.
+  size_t end() const { return first_chunk + chunks.size(); }
+
+  // Whether the filler of a truncated body has to wait for readers to move on
+  // before appending more.
+  bool full() const {
+    return truncated && retained_size > max_size && !cursors.empty();
+  }
+
+  // Returns whether any chunks were dropped.
+  bool ReleaseReadChunks();
+
+  // Shared with readers, which get them without copying.
+  std::deque<util::BufferSlice> chunks;
+  // Index in the body of the front of `chunks`.
+  size_t first_chunk = 0;
+  std::string_view mapped;
+  std::shared_ptr<const void> mapping;
+  std::optional<util::FileSlice> file;
+  util::ThreadPool* thread_pool = nullptr;
+  // Of all the chunks appended, including dropped ones.
+  size_t size = 0;
+  size_t retained_size = 0;
+  size_t max_size = std::numeric_limits<size_t>::max();
+  bool truncated = false;
+  bool done = false;
+  std::exception_ptr exception;
+  std::unordered_set<Promise<void>*> awaiters;
+  std::unordered_set<const BodyCursor*> cursors;
+};
+
+// Position of a reader in a body. It's registered as soon as the reader is
+// created, so that a truncated body keeps the chunks the reader hasn't read
+// yet.
+class CacheHttp::BodyCursor {
+ public:
+  explicit BodyCursor(std::shared_ptr<CachedBody> body)
+      : body_(std::move(body)) {
+    body_->cursors.insert(this);
+  }
+
+  BodyCursor(BodyCursor&& other) noexcept
+      : body_(std::move(other.body_)), next_chunk_(other.next_chunk_) {
+    body_->cursors.erase(&other);
+    body_->cursors.insert(this);
+  }
+
+  BodyCursor(const BodyCursor&) = delete;
+  BodyCursor& operator=(const BodyCursor&) = delete;
+  BodyCursor& operator=(BodyCursor&&) = delete;
+
+  ~BodyCursor() {
+    if (body_) {
+      body_->cursors.erase(this);
+      // The filler stops waiting once nobody is left reading.
+      if (body_->ReleaseReadChunks() || body_->cursors.empty()) {
+        body_->Notify();
+      }
+    }
+  }
+
+  CachedBody* body() const { return body_.get(); }
+  size_t next_chunk() const { return next_chunk_; }
+
+  void Advance() {
+    next_chunk_++;
+    if (body_->ReleaseReadChunks()) {
+      body_->Notify();
+    }
+  }
+
+ private:
+  std::shared_ptr<CachedBody> body_;
+  size_t next_chunk_ = 0;
+};
+
+bool CacheHttp::CachedBody::ReleaseReadChunks() {
+  // Without readers, those about to be created would miss dropped chunks.
+  if (!truncated || cursors.empty()) {
+    return false;
+  }
+  size_t read = end();
+  for (const BodyCursor* cursor : cursors) {
+    read = std::min(read, cursor->next_chunk());
+  }
+  bool released = false;
+  while (first_chunk < read && retained_size > max_size) {
+    retained_size -= chunks.front().size();
+    chunks.pop_front();
+    first_chunk++;
+    released = true;
+  }
+  return released;
+}
+
 namespace {
 
+constexpr size_t kMappedChunkSize = 64 * 1024;
+
+// Reads a byte of every page of `data`, so that those which aren't cached are
+// read from the disk by the calling thread.
+void TouchPages(std::string_view data) {
+  constexpr size_t kPageSize = 4096;
+  for (size_t offset = 0; offset < data.size(); offset += kPageSize) {
+    static_cast<void>(*static_cast<const volatile char*>(&data[offset]));
+  }
+}
+
 Task<Request<std::string>> GetRequest(Request<> request) {
   Request<std::string> result{.url = std::move(request.url),
                               .method = request.method,
-                              .headers = std::move(request.headers)};
+                              .headers = std::move(request.headers),
+                              .body = std::nullopt,
+                              .timeouts = request.timeouts};
   if (request.body) {
     result.body = co_await GetBody(std::move(*request.body));
   }
@@ -20,14 +186,106 @@ bool IsCacheable(const Request<>& request) {
       (accept != "application/json" && accept != "application/xml")) {
     return false;
   }
+  if (HasHeader(request.headers, "Cache-Control", "no-store")) {
+    return false;
+  }
   auto content_type = GetHeader(request.headers, "Content-Type");
   return !content_type || content_type == "application/json" ||
          content_type == "application/xml" ||
          content_type == "application/x-www-form-urlencoded";
 }
 
-Generator<std::string> ToGenerator(std::string string) {
-  co_yield std::move(string);
+size_t GetSize(const std::vector<std::pair<std::string, std::string>>& headers) {
+  size_t size = headers.capacity() * sizeof(headers[0]);
+  for (const auto& [name, value] : headers) {
+    size += name.capacity() + value.capacity();
+  }
+  return size;
+}
+
+struct CacheControl {
+  std::optional<int64_t> max_age;
+  std::optional<int64_t> stale_while_revalidate;
+  bool no_cache = false;
+  bool no_store = false;
+};
+
+std::optional<int64_t> ParseSeconds(std::string_view value) {
+  try {
+    return std::stoll(std::string(value));
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+CacheControl ParseCacheControl(std::string_view header) {
+  CacheControl result;
+  while (!header.empty()) {
+    auto separator = header.find(',');
+    std::string directive =
+        ToLowerCase(TrimWhitespace(header.substr(0, separator)));
+    header.remove_prefix(separator == std::string_view::npos ? header.size()
+                                                             : separator + 1);
+    if (directive == "no-cache") {
+      result.no_cache = true;
+    } else if (directive == "no-store") {
+      result.no_store = true;
+    } else if (directive.starts_with("max-age=")) {
+      // An invalid max-age makes the response stale.
+      result.max_age =
+          ParseSeconds(std::string_view(directive).substr(strlen("max-age=")))
+              .value_or(0);
+    } else if (directive.starts_with("stale-while-revalidate=")) {
+      result.stale_while_revalidate =
+          ParseSeconds(std::string_view(directive)
+                           .substr(strlen("stale-while-revalidate=")))
+              .value_or(0);
+    }
+  }
+  return result;
+}
+
+size_t GetPathEnd(std::string_view url) {
+  return std::min(url.find_first_of("?#"), url.size());
+}
+
+size_t GetPathStart(std::string_view url) {
+  auto scheme_end = url.find("://");
+  auto path_start =
+      url.find('/', scheme_end == std::string_view::npos ? 0 : scheme_end + 3);
+  return std::min(path_start, GetPathEnd(url));
+}
+
+// Mutating `url` affects the collection it belongs to, e.g. uploading
+// https://host/files/upload affects https://host/files/list.
+std::string_view GetInvalidatedPrefix(std::string_view url) {
+  size_t path_start = GetPathStart(url);
+  size_t path_end = GetPathEnd(url);
+  if (path_start == path_end) {
+    return url.substr(0, path_start);
+  }
+  size_t parent_end = url.rfind('/', path_end - 2);
+  if (parent_end == std::string_view::npos || parent_end < path_start) {
+    parent_end = path_start;
+  }
+  return url.substr(0, parent_end + 1);
+}
+
+void UpdateHeaders(std::vector<std::pair<std::string, std::string>>& headers,
+                   std::vector<std::pair<std::string, std::string>> updated) {
+  for (auto& [name, value] : updated) {
+    if (EqualsIgnoreCase(name, "content-length")) {
+      continue;
+    }
+    auto it = std::find_if(headers.begin(), headers.end(), [&](const auto& h) {
+      return EqualsIgnoreCase(h.first, name);
+    });
+    if (it == headers.end()) {
+      headers.emplace_back(std::move(name), std::move(value));
+    } else {
+      it->second = std::move(value);
+    }
+  }
 }
 
 int64_t GetTime() {
@@ -40,57 +298,376 @@ int64_t GetTime() {
 Task<Response<>> CacheHttp::Fetch(Request<> request,
                                   stdx::stop_token stop_token) const {
   bool should_invalidate_cache = request.invalidates_cache;
+  std::string url = should_invalidate_cache ? request.url : "";
   if (!IsCacheable(request)) {
     auto response =
         co_await http_->Fetch(std::move(request), std::move(stop_token));
     if (should_invalidate_cache && response.status / 100 == 2) {
-      InvalidateCache();
+      InvalidateCache(url);
     }
     co_return response;
   }
   auto r = co_await GetRequest(std::move(request));
-  auto cached_response = cache_.GetCached(r);
-  if (cached_response && !IsStale(*cached_response)) {
-    co_return ConvertResponse(*cached_response);
-  } else {
-    cache_.Invalidate(r);
+  bool should_revalidate = HasHeader(r.headers, "Cache-Control", "no-cache");
+  RequestFingerprint fingerprint = GetFingerprint(r);
+  CacheKey key{
+      .fingerprint = fingerprint,
+      .request = std::make_shared<const Request<std::string>>(std::move(r))};
+  auto cached_response = cache_.GetCached(key);
+  if (cached_response && !should_revalidate) {
+    switch (GetFreshness(key.request->url, *cached_response)) {
+      case Freshness::kFresh:
+        co_return ConvertResponse(std::move(*cached_response),
+                                  std::move(stop_token));
+      case Freshness::kStale:
+        RunTask(RefreshInBackground(std::move(key)));
+        co_return ConvertResponse(std::move(*cached_response),
+                                  std::move(stop_token));
+      case Freshness::kExpired:
+        break;
+    }
   }
 
-  auto response = co_await cache_.Get(std::move(r), std::move(stop_token));
+  CacheableResponse response;
+  if (cached_response) {
+    response = co_await cache_.Refresh(std::move(key), stop_token);
+  } else {
+    response = co_await cache_.Get(std::move(key), stop_token);
+  }
   if (should_invalidate_cache && response.status / 100 == 2) {
-    InvalidateCache();
+    InvalidateCache(url);
   }
-  co_return ConvertResponse(response);
+  co_return ConvertResponse(std::move(response), std::move(stop_token));
 }
 
-Response<> CacheHttp::ConvertResponse(CacheableResponse response) {
+Response<> CacheHttp::ConvertResponse(CacheableResponse response,
+                                      stdx::stop_token stop_token) {
+  std::optional<util::FileSlice> file_body = response.body->file;
   return {.status = response.status,
           .headers = std::move(response.headers),
-          .body = ToGenerator(std::move(response.body))};
+          .body = ReadBody(BodyCursor(std::move(response.body)),
+                           std::move(stop_token)),
+          .file_body = std::move(file_body)};
+}
+
+Generator<util::BufferSlice> CacheHttp::ReadBody(BodyCursor cursor,
+                                                 stdx::stop_token stop_token) {
+  CachedBody* body = cursor.body();
+  if (body->mapping) {
+    for (size_t offset = 0; offset < body->mapped.size();
+         offset += kMappedChunkSize) {
+      std::string_view slice = body->mapped.substr(offset, kMappedChunkSize);
+      if (body->thread_pool) {
+        co_await body->thread_pool->Do(stop_token,
+                                       [&] { TouchPages(slice); });
+      }
+      // Served from the mapping, which the slice keeps alive.
+      co_yield util::BufferSlice(
+          body->mapping,
+          std::span<const uint8_t>(
+              reinterpret_cast<const uint8_t*>(slice.data()), slice.size()));
+    }
+    co_return;
+  }
+  while (true) {
+    while (cursor.next_chunk() == body->end() && !body->done) {
+      co_await body->WaitForUpdate(stop_token);
+    }
+    if (cursor.next_chunk() == body->end()) {
+      if (body->exception) {
+        std::rethrow_exception(body->exception);
+      }
+      co_return;
+    }
+    if (cursor.next_chunk() < body->first_chunk) {
+      throw RuntimeError("response body is no longer buffered");
+    }
+    util::BufferSlice chunk =
+        body->chunks[cursor.next_chunk() - body->first_chunk];
+    cursor.Advance();
+    co_yield std::move(chunk);
+  }
+}
+
+Task<> CacheHttp::FillBody(CacheKey key,
+                           std::shared_ptr<CachedBody> body,
+                           Generator<util::BufferSlice> content,
+                           std::optional<DiskCache::Metadata> metadata) const {
+  stdx::stop_token stop_token = stop_source_.get_token();
+  std::exception_ptr exception;
+  try {
+    FOR_CO_AWAIT(util::BufferSlice & chunk, content) {
+      bool truncated = body->truncated;
+      body->Append(std::move(chunk));
+      if (body.use_count() == 1) {
+        // Neither the cache nor any reader holds the body anymore.
+        co_return;
+      }
+      if (body->truncated && !truncated && !stop_token.stop_requested()) {
+        // The response can't be cached anymore, so it's only passed through.
+        auto cached_response = cache_.GetCached(key);
+        if (cached_response && cached_response->body == body) {
+          cache_.Invalidate(key);
+        }
+      }
+      // Gets no further ahead of the slowest reader than the budget allows,
+      // regardless of this CacheHttp, which readers may outlive.
+      while (body->full()) {
+        co_await body->WaitForUpdate(stdx::stop_token());
+      }
+    }
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  // Readers resumed by Finish may destroy this CacheHttp, so the cache is
+  // updated first. The disk write isn't waited for: readers get the end of
+  // the body as soon as it's received.
+  if (!stop_token.stop_requested()) {
+    if (exception) {
+      auto cached_response = cache_.GetCached(key);
+      if (cached_response && cached_response->body == body) {
+        cache_.Invalidate(key);
+      }
+    } else if (!body->truncated) {
+      cache_.UpdateWeight(key);
+      if (metadata) {
+        RunTask(PutOnDisk(key.fingerprint, std::move(*metadata), body));
+      }
+    }
+  }
+  body->Finish(std::move(exception));
+}
+
+auto CacheHttp::GetFromDisk(const RequestFingerprint& fingerprint) const
+    -> Task<std::optional<DiskCache::Entry>> {
+  if (thread_pool_) {
+    co_return co_await thread_pool_->Do(
+        [&] { return disk_cache_->Get(fingerprint); });
+  }
+  co_return disk_cache_->Get(fingerprint);
+}
+
+Task<> CacheHttp::PutOnDisk(RequestFingerprint fingerprint,
+                            DiskCache::Metadata metadata,
+                            std::shared_ptr<const CachedBody> body) const {
+  // The write may outlast this CacheHttp.
+  DiskCache* disk_cache = disk_cache_;
+  util::ThreadPool* thread_pool = thread_pool_;
+  auto put = [&] {
+    std::vector<std::string_view> chunks;
+    if (body->mapping) {
+      chunks.push_back(body->mapped);
+    } else {
+      chunks.assign(body->chunks.begin(), body->chunks.end());
+    }
+    try {
+      disk_cache->Put(fingerprint, metadata, chunks);
+    } catch (const RuntimeError&) {
+      // The response just won't survive a restart.
+    }
+  };
+  if (thread_pool) {
+    co_await thread_pool->Do(std::move(put));
+  } else {
+    put();
+  }
 }
 
-bool CacheHttp::IsStale(const CacheableResponse& response) const {
+auto CacheHttp::FromDiskCache(DiskCache::Entry entry) const
+    -> CacheableResponse {
+  auto body = std::make_shared<CachedBody>();
+  body->mapped = entry.body;
+  body->mapping = std::move(entry.mapping);
+  body->file = std::move(entry.file_body);
+  body->thread_pool = thread_pool_;
+  body->done = true;
+  return {.status = entry.metadata.status,
+          .headers = std::move(entry.metadata.headers),
+          .body = std::move(body),
+          .timestamp = entry.metadata.timestamp,
+          .max_age_ms = entry.metadata.max_age_ms,
+          .stale_while_revalidate_ms = entry.metadata.stale_while_revalidate_ms};
+}
+
+auto CacheHttp::GetFreshness(std::string_view url,
+                             const CacheableResponse& response) const
+    -> Freshness {
   if (response.status >= 400) {
-    return true;
+    return Freshness::kExpired;
   }
   if (response.timestamp <= last_invalidate_ms_) {
-    return true;
+    return Freshness::kExpired;
+  }
+  if (!invalidated_prefixes_.empty()) {
+    auto is_invalidated = [&](std::string_view prefix) {
+      auto it = invalidated_prefixes_.find(prefix);
+      return it != invalidated_prefixes_.end() &&
+             response.timestamp <= it->second;
+    };
+    size_t path_start = GetPathStart(url);
+    size_t path_end = GetPathEnd(url);
+    if (is_invalidated(url.substr(0, path_start))) {
+      return Freshness::kExpired;
+    }
+    for (size_t i = url.find('/', path_start); i < path_end;
+         i = url.find('/', i + 1)) {
+      if (is_invalidated(url.substr(0, i + 1))) {
+        return Freshness::kExpired;
+      }
+    }
+  }
+  int64_t age = GetTime() - response.timestamp;
+  if (age < response.max_age_ms) {
+    return Freshness::kFresh;
+  }
+  if (age < response.max_age_ms + response.stale_while_revalidate_ms) {
+    return Freshness::kStale;
+  }
+  return Freshness::kExpired;
+}
+
+Task<> CacheHttp::RefreshInBackground(CacheKey key) const {
+  try {
+    co_await cache_.Refresh(std::move(key), stop_source_.get_token());
+  } catch (const std::exception&) {
+    // The stale response keeps being served until it expires.
+  }
+}
+
+void CacheHttp::InvalidateCache(std::string_view url) const {
+  int64_t now = GetTime();
+  if (invalidated_prefixes_.size() >= max_invalidated_prefix_count_) {
+    invalidated_prefixes_.clear();
+    last_invalidate_ms_ = now;
+    return;
+  }
+  std::string_view prefix = GetInvalidatedPrefix(url);
+  auto it = invalidated_prefixes_.find(prefix);
+  if (it == invalidated_prefixes_.end()) {
+    invalidated_prefixes_.emplace(std::string(prefix), now);
+  } else {
+    it->second = now;
   }
-  return GetTime() - response.timestamp >= max_staleness_ms_;
 }
 
-void CacheHttp::InvalidateCache() const { last_invalidate_ms_ = GetTime(); }
+auto CacheHttp::ToCacheableResponse(
+    int status, std::vector<std::pair<std::string, std::string>> headers,
+    std::shared_ptr<CachedBody> body) const -> CacheableResponse {
+  CacheControl cache_control =
+      ParseCacheControl(GetHeader(headers, "Cache-Control").value_or(""));
+  int64_t max_age_ms = max_staleness_ms_;
+  if (cache_control.no_cache) {
+    max_age_ms = 0;
+  } else if (cache_control.max_age) {
+    max_age_ms = *cache_control.max_age * 1000;
+    if (auto age = GetHeader(headers, "Age")) {
+      max_age_ms -= ParseSeconds(*age).value_or(0) * 1000;
+    }
+  }
+  int64_t stale_while_revalidate_ms = stale_while_revalidate_ms_;
+  if (cache_control.stale_while_revalidate) {
+    stale_while_revalidate_ms = std::min<int64_t>(
+        stale_while_revalidate_ms, *cache_control.stale_while_revalidate * 1000);
+  }
+  // The key already holds all request headers, so Vary only matters when it
+  // says that nothing may be reused.
+  bool storable = !cache_control.no_store &&
+                  TrimWhitespace(GetHeader(headers, "Vary").value_or("")) != "*";
+  return {.status = status,
+          .headers = std::move(headers),
+          .body = std::move(body),
+          .timestamp = GetTime(),
+          .max_age_ms = max_age_ms,
+          .stale_while_revalidate_ms = stale_while_revalidate_ms,
+          .storable = storable};
+}
 
-auto CacheHttp::Factory::operator()(Request<std::string> request,
+std::optional<DiskCache::Metadata> CacheHttp::GetDiskMetadata(
+    const CacheableResponse& response) const {
+  if (!disk_cache_ || !response.storable || response.status / 100 != 2) {
+    return std::nullopt;
+  }
+  return DiskCache::Metadata{
+      .status = response.status,
+      .headers = response.headers,
+      .timestamp = response.timestamp,
+      .max_age_ms = response.max_age_ms,
+      .stale_while_revalidate_ms = response.stale_while_revalidate_ms};
+}
+
+auto CacheHttp::Factory::operator()(CacheKey key,
                                     stdx::stop_token stop_token) const
     -> Task<CacheableResponse> {
+  auto stale_response = d->cache_.GetCached(key);
+  if (!stale_response && d->disk_cache_) {
+    if (auto entry = co_await d->GetFromDisk(key.fingerprint)) {
+      auto response = d->FromDiskCache(std::move(*entry));
+      if (d->GetFreshness(key.request->url, response) == Freshness::kFresh) {
+        co_return response;
+      }
+      stale_response = std::move(response);
+    }
+  }
+  Request<std::string> request = *key.request;
+  if (stale_response && stale_response->status / 100 == 2) {
+    if (auto etag = GetHeader(stale_response->headers, "ETag")) {
+      request.headers.emplace_back("If-None-Match", std::move(*etag));
+    }
+    if (auto last_modified =
+            GetHeader(stale_response->headers, "Last-Modified")) {
+      request.headers.emplace_back("If-Modified-Since",
+                                   std::move(*last_modified));
+    }
+  } else {
+    stale_response = std::nullopt;
+  }
   auto response =
-      co_await http->Fetch(std::move(request), std::move(stop_token));
-  CacheableResponse result{.status = response.status,
-                           .headers = std::move(response.headers),
-                           .timestamp = GetTime()};
-  result.body = co_await GetBody(std::move(response.body));
+      co_await d->http_->Fetch(std::move(request), std::move(stop_token));
+  if (stale_response && response.status == 304) {
+    co_await GetBody(std::move(response.body));
+    UpdateHeaders(stale_response->headers, std::move(response.headers));
+    auto result = d->ToCacheableResponse(stale_response->status,
+                                         std::move(stale_response->headers),
+                                         std::move(stale_response->body));
+    // Otherwise the disk cache would keep serving the stale metadata, e.g.
+    // after a restart. A body still being received is stored once complete,
+    // with the metadata it started with.
+    const CachedBody& body = *result.body;
+    if (auto metadata = d->GetDiskMetadata(result);
+        metadata &&
+        (body.mapping || (body.done && !body.exception && !body.truncated))) {
+      RunTask(d->PutOnDisk(key.fingerprint, std::move(*metadata),
+                           result.body));
+    }
+    co_return result;
+  }
+  auto body = std::make_shared<CachedBody>();
+  body->max_size = d->max_body_size_;
+  auto result = d->ToCacheableResponse(
+      response.status, std::move(response.headers), body);
+  std::optional<DiskCache::Metadata> metadata = d->GetDiskMetadata(result);
+  RunTask(d->FillBody(std::move(key), std::move(body), std::move(response.body),
+                      std::move(metadata)));
   co_return result;
 }
 
-}  // namespace coro::http
\ No newline at end of file
+size_t CacheHttp::Weigher::operator()(const CacheKey& key,
+                                      const CacheableResponse& response) const {
+  const Request<std::string>& request = *key.request;
+  if (!response.storable || response.body->truncated ||
+      response.body->exception) {
+    // Heavier than any budget, so that the cache doesn't keep it.
+    return std::numeric_limits<size_t>::max();
+  }
+  size_t size = sizeof(request) + sizeof(key) + request.url.capacity() +
+                GetSize(request.headers) + sizeof(response) +
+                GetSize(response.headers) + sizeof(*response.body) +
+                response.body->chunks.size() * sizeof(util::BufferSlice) +
+                response.body->size;
+  if (request.body) {
+    size += request.body->capacity();
+  }
+  return size;
+}
+
+}  // namespace coro::http
@@ -2,51 +2,147 @@
 #define CORO_HTTP_SRC_CORO_HTTP_CACHE_HTTP_H_
 
 #include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
 
+#include "coro/http/disk_cache.h"
 #include "coro/http/http.h"
 #include "coro/http/http_parse.h"
+#include "coro/stdx/stop_source.h"
 #include "coro/util/lru_cache.h"
+#include "coro/util/thread_pool.h"
 
 namespace coro::http {
 
 struct CacheHttpConfig {
   int cache_size = 1024;
+  // Upper bound on the memory held by cached requests and responses. A
+  // response body outgrowing it is streamed to its readers without being
+  // cached.
+  size_t cache_size_bytes = 32 * 1024 * 1024;
+  // Freshness lifetime of responses which don't specify Cache-Control max-age.
   int max_staleness_ms = 1000;
+  // For how long past their freshness lifetime responses may still be served
+  // while a refresh runs in the background. Responses can shorten it with
+  // Cache-Control stale-while-revalidate.
+  int stale_while_revalidate_ms = 0;
+  // Optional second tier, consulted on misses and filled with every complete
+  // storable response. Responses it serves carry their body as `file_body` as
+  // well, so that an HTTP server forwarding them sends it from the file.
+  DiskCache* disk_cache = nullptr;
+  // Runs the disk cache's lookups and writes, and the reads of the bodies it
+  // serves, if set, so that the event loop doesn't block on disk I/O. Writes
+  // may finish after the CacheHttp is gone, so both have to outlive it.
+  util::ThreadPool* thread_pool = nullptr;
 };
 
+// Caches responses to GET-like JSON and XML requests. Responses are kept
+// fresh for their Cache-Control max-age and are revalidated using ETag and
+// Last-Modified once stale, optionally serving the stale response meanwhile.
+// Response bodies are streamed into the cache as they arrive and shared by
+// everyone reading them. A successful request with `invalidates_cache` set
+// marks every cached response under its URL's parent collection as stale.
 class CacheHttp {
  public:
   CacheHttp(const CacheHttpConfig& config, const Http* http)
       : http_(http),
-        cache_(config.cache_size, Factory{http_}),
-        max_staleness_ms_(config.max_staleness_ms) {}
+        cache_(config.cache_size, config.cache_size_bytes, Factory{this}),
+        max_staleness_ms_(config.max_staleness_ms),
+        stale_while_revalidate_ms_(config.stale_while_revalidate_ms),
+        disk_cache_(config.disk_cache),
+        thread_pool_(config.thread_pool),
+        max_body_size_(config.cache_size_bytes),
+        max_invalidated_prefix_count_(config.cache_size) {}
+
+  CacheHttp(const CacheHttp&) = delete;
+  CacheHttp& operator=(const CacheHttp&) = delete;
+
+  ~CacheHttp() { stop_source_.request_stop(); }
 
   Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
 
  private:
+  struct CachedBody;
+  class BodyCursor;
+
   struct CacheableResponse {
     int status;
     std::vector<std::pair<std::string, std::string>> headers;
-    std::string body;
+    std::shared_ptr<CachedBody> body;
     int64_t timestamp;
+    int64_t max_age_ms = 0;
+    int64_t stale_while_revalidate_ms = 0;
+    bool storable = true;
+  };
+
+  // Compared and hashed by the fingerprint alone. The request is shared by
+  // the entry and everything producing or refreshing its response.
+  struct CacheKey {
+    RequestFingerprint fingerprint;
+    std::shared_ptr<const Request<std::string>> request;
+
+    friend bool operator==(const CacheKey& k1, const CacheKey& k2) {
+      return k1.fingerprint == k2.fingerprint;
+    }
+  };
+
+  struct CacheKeyHash {
+    size_t operator()(const CacheKey& key) const {
+      return std::hash<RequestFingerprint>{}(key.fingerprint);
+    }
   };
 
   struct Factory {
-    Task<CacheableResponse> operator()(Request<std::string> request,
+    Task<CacheableResponse> operator()(CacheKey key,
                                        stdx::stop_token stop_token) const;
-    const Http* http;
+    const CacheHttp* d;
   };
 
-  static Response<> ConvertResponse(CacheableResponse response);
-  bool IsStale(const CacheableResponse& response) const;
-  void InvalidateCache() const;
+  struct Weigher {
+    size_t operator()(const CacheKey& key,
+                      const CacheableResponse& response) const;
+  };
+
+  enum class Freshness { kFresh, kStale, kExpired };
+
+  static Response<> ConvertResponse(CacheableResponse response,
+                                    stdx::stop_token stop_token);
+  static Generator<util::BufferSlice> ReadBody(BodyCursor cursor,
+                                               stdx::stop_token stop_token);
+  Freshness GetFreshness(std::string_view url,
+                         const CacheableResponse& response) const;
+  Task<> RefreshInBackground(CacheKey key) const;
+  Task<> FillBody(CacheKey key,
+                  std::shared_ptr<CachedBody> body,
+                  Generator<util::BufferSlice> content,
+                  std::optional<DiskCache::Metadata> metadata) const;
+  Task<std::optional<DiskCache::Entry>> GetFromDisk(
+      const RequestFingerprint& fingerprint) const;
+  Task<> PutOnDisk(RequestFingerprint fingerprint,
+                   DiskCache::Metadata metadata,
+                   std::shared_ptr<const CachedBody> body) const;
+  CacheableResponse FromDiskCache(DiskCache::Entry entry) const;
+  void InvalidateCache(std::string_view url) const;
+  CacheableResponse ToCacheableResponse(
+      int status, std::vector<std::pair<std::string, std::string>> headers,
+      std::shared_ptr<CachedBody> body) const;
+  std::optional<DiskCache::Metadata> GetDiskMetadata(
+      const CacheableResponse& response) const;
 
   const Http* http_;
-  mutable util::LRUCache<Request<std::string>, Factory> cache_;
+  mutable util::LRUCache<CacheKey, Factory, CacheKeyHash, Weigher> cache_;
   int max_staleness_ms_;
+  int stale_while_revalidate_ms_;
+  DiskCache* disk_cache_;
+  util::ThreadPool* thread_pool_;
+  size_t max_body_size_;
+  size_t max_invalidated_prefix_count_;
   mutable int64_t last_invalidate_ms_ = 0;
+  mutable std::map<std::string, int64_t, std::less<>> invalidated_prefixes_;
+  stdx::stop_source stop_source_;
 };
 
 }  // namespace coro::http
 
-#endif  // CORO_HTTP_SRC_CORO_HTTP_CACHE_HTTP_H_
\ No newline at end of file
+#endif  // CORO_HTTP_SRC_CORO_HTTP_CACHE_HTTP_H_
@@ -4,17 +4,35 @@
 #include <event2/event.h>
 #include <event2/event_struct.h>
 
+#ifdef CORO_HTTP_HAVE_TLS
+#include <openssl/crypto.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "coro/http/http_body_generator.h"
 #include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/shared_promise.h"
+#include "coro/util/raii_utils.h"
 
 namespace coro::http {
 
@@ -68,12 +86,47 @@ void Check(int code) {
   }
 }
 
+struct CurlEasyDeleter {
+  void operator()(CURL* handle) const noexcept { curl_easy_cleanup(handle); }
+};
+
+// Keeps easy handles of finished requests, so that the next requests don't
+// have to set them up from scratch.
+class CurlHandlePool {
+ public:
+  explicit CurlHandlePool(size_t max_idle_handle_count)
+      : max_idle_handle_count_(max_idle_handle_count) {}
+
+  CURL* Acquire() {
+    if (idle_handles_.empty()) {
+      return CheckNotNull(curl_easy_init());
+    }
+    CURL* handle = idle_handles_.back().release();
+    idle_handles_.pop_back();
+    return handle;
+  }
+
+  void Release(CURL* handle) noexcept {
+    if (idle_handles_.size() < max_idle_handle_count_) {
+      curl_easy_reset(handle);
+      idle_handles_.emplace_back(handle);
+    } else {
+      curl_easy_cleanup(handle);
+    }
+  }
+
+ private:
+  size_t max_idle_handle_count_;
+  std::vector<std::unique_ptr<CURL, CurlEasyDeleter>> idle_handles_;
+};
+
 struct CurlHandleDeleter {
   void operator()(CURL* handle) const noexcept {
     Check(curl_multi_remove_handle(multi_handle, handle));
-    curl_easy_cleanup(handle);
+    pool->Release(handle);
   }
   CURLM* multi_handle;
+  CurlHandlePool* pool;
 };
 
 struct CurlListDeleter {
@@ -103,12 +156,74 @@ class CurlGlobalInitializer {
   CurlGlobalInitializer& operator=(CurlGlobalInitializer&&) = delete;
 };
 
+// Hands a PEM CA bundle to curl. If curl uses the OpenSSL this library is
+// linked against, the bundle is parsed once into an X509 store which is shared
+// by the SSL contexts of all the connections. Otherwise curl parses the blob
+// itself for every new connection.
+class CaCertBundle {
+ public:
+  explicit CaCertBundle(std::shared_ptr<const std::string> blob);
+
+  void Apply(CURL* handle) const;
+
+ private:
+  std::shared_ptr<const std::string> blob_;
+#ifdef CORO_HTTP_HAVE_TLS
+  struct X509StoreDeleter {
+    void operator()(X509_STORE* store) const noexcept {
+      X509_STORE_free(store);
+    }
+  };
+
+  static bool IsCurlUsingOpenSsl();
+  static std::shared_ptr<X509_STORE> GetStore(
+      const std::shared_ptr<const std::string>& blob);
+  static std::shared_ptr<X509_STORE> ParseStore(std::string_view blob);
+  static CURLcode SslContextCallback(CURL*, void* ssl_context, void* userptr);
+
+  std::shared_ptr<X509_STORE> store_;
+#endif
+};
+
+// The native CA bundle, as loaded on a thread of its own for an event loop.
+struct NativeCaCertLoad {
+  explicit NativeCaCertLoad(event_base* event_loop)
+      : keep_alive(
+            event_loop, -1, 0, [](evutil_socket_t, short, void*) {}, nullptr) {}
+
+  // Pending while the bundle loads, so that the event loop doesn't run out of
+  // events and exit in the meantime.
+  EventData keep_alive;
+  Promise<std::shared_ptr<const CaCertBundle>> loaded;
+};
+
+Task<std::shared_ptr<const CaCertBundle>> AwaitNativeCaCerts(
+    std::shared_ptr<NativeCaCertLoad> load) {
+  co_return co_await load->loaded;
+}
+
+// The bundle of GetNativeCaCertBlob, parsed once per process. Blocks.
+std::shared_ptr<const CaCertBundle> GetNativeCaCertBundle() {
+  static const auto bundle =
+      std::make_shared<const CaCertBundle>(GetNativeCaCertBlob());
+  return bundle;
+}
+
+struct NativeCaCertsProducer {
+  Task<std::shared_ptr<const CaCertBundle>> operator()() const {
+    return AwaitNativeCaCerts(load);
+  }
+
+  std::shared_ptr<NativeCaCertLoad> load;
+};
+
 class CurlHandle {
  public:
   using Owner = std::variant<CurlHttpOperation*, CurlHttpBodyGenerator*>;
 
-  CurlHandle(CURLM* http, event_base* event_loop, Request<>,
-             const CurlHttpConfig& config, stdx::stop_token, Owner);
+  CurlHandle(CURLM* http, CurlHandlePool* pool, CURLSH* share,
+             event_base* event_loop, Request<>, const CurlHttpConfig& config,
+             const CaCertBundle& ca_certs, stdx::stop_token, Owner);
 
  private:
   friend class CurlHttpImpl;
@@ -131,6 +246,12 @@ class CurlHandle {
                              void* userdata);
   static void OnNextRequestBodyChunkRequested(evutil_socket_t, short,
                                               void* userdata);
+  static void OnFirstByteTimeout(evutil_socket_t, short, void* userdata);
+
+  // Starts pulling request body chunks unless that's already happening, the
+  // body has ended or the send window is full.
+  void FetchRequestBody();
+  Task<> FetchRequestBodyChunks();
 
   void Cleanup();
 
@@ -139,12 +260,22 @@ class CurlHandle {
   CURLM* http_;
   event_base* event_loop_;
   std::unique_ptr<curl_slist, CurlListDeleter> header_list_;
-  std::optional<Generator<std::string>> request_body_;
-  std::optional<Generator<std::string>::iterator> request_body_it_;
-  std::optional<size_t> request_body_chunk_index_;
+  std::optional<Generator<util::BufferSlice>> request_body_;
+  std::optional<Generator<util::BufferSlice>::iterator> request_body_it_;
+  // Chunks pulled from `request_body_` which curl hasn't fully read yet.
+  std::deque<util::BufferSlice> request_body_chunks_;
+  size_t request_body_chunk_offset_ = 0;
+  size_t request_body_buffered_byte_cnt_ = 0;
+  bool request_body_fetching_ = false;
+  bool request_body_ended_ = false;
   stdx::stop_token stop_token_;
   Owner owner_;
+  size_t receive_window_size_;
+  size_t send_window_size_;
+  bool receive_paused_ = false;
+  bool send_paused_ = false;
   EventData next_request_body_chunk_;
+  EventData first_byte_timeout_;
   std::unique_ptr<CURL, CurlHandleDeleter> handle_;
   stdx::stop_callback<OnCancel> stop_callback_;
 };
@@ -152,7 +283,7 @@ class CurlHandle {
 class CurlHttpBodyGenerator : public HttpBodyGenerator<CurlHttpBodyGenerator> {
  public:
   CurlHttpBodyGenerator(std::unique_ptr<CurlHandle> handle,
-                        std::string_view initial_chunk);
+                        std::string initial_chunk);
 
   void Resume();
 
@@ -175,12 +306,15 @@ class CurlHttpBodyGenerator : public HttpBodyGenerator<CurlHttpBodyGenerator> {
 
 class CurlHttpOperation {
  public:
-  CurlHttpOperation(CURLM* http, event_base* event_loop, Request<>,
-                    const CurlHttpConfig& config, stdx::stop_token);
+  CurlHttpOperation(CURLM* http, CurlHandlePool* pool, CURLSH* share,
+                    event_base* event_loop, Request<>,
+                    const CurlHttpConfig& config, const CaCertBundle& ca_certs,
+                    stdx::stop_token);
 
   bool await_ready();
   void await_suspend(stdx::coroutine_handle<void> awaiting_coroutine);
-  std::unique_ptr<Response<CurlHttpBodyGenerator>> await_resume();
+  // A failure is returned rather than thrown.
+  Result<std::unique_ptr<Response<CurlHttpBodyGenerator>>> await_resume();
 
  private:
   static void OnHeadersReady(evutil_socket_t fd, short event, void* handle);
@@ -201,20 +335,37 @@ class CurlHttpOperation {
 
 class CurlHttpImpl {
  public:
-  CurlHttpImpl(event_base* event_loop, CurlHttpConfig);
+  CurlHttpImpl(event_base* event_loop, CurlHttpConfig, CURLSH* share);
+  ~CurlHttpImpl();
+
+  CurlHttpImpl(const CurlHttpImpl&) = delete;
+  CurlHttpImpl(CurlHttpImpl&&) = delete;
+  CurlHttpImpl& operator=(const CurlHttpImpl&) = delete;
+  CurlHttpImpl& operator=(CurlHttpImpl&&) = delete;
+
+  // Whether the CA bundle to trust is known, as Fetch requires.
+  bool has_ca_certs() const { return ca_certs_ != nullptr; }
+  // Waits for the native CA bundle, which the first call starts loading on a
+  // thread of its own. `event_loop` is the loop of this instance.
+  Task<> LoadCaCerts(const coro::util::EventLoop* event_loop,
+                     stdx::stop_token) const;
 
   CurlHttpOperation Fetch(Request<> request,
                           stdx::stop_token = stdx::stop_token()) const;
 
+  const CurlHttpStats& stats() const { return stats_; }
+
  private:
   static int SocketCallback(CURL* handle, curl_socket_t socket, int what,
                             void* userp, void* socketp);
   static int TimerCallback(CURLM* handle, long timeout_ms, void* userp);
-  static void SocketEvent(evutil_socket_t fd, short event, void* multi_handle);
-  static void TimeoutEvent(evutil_socket_t fd, short event, void* handle);
-  static void ProcessEvents(CURLM* handle);
+  static void SocketEvent(evutil_socket_t fd, short event, void* userp);
+  static void TimeoutEvent(evutil_socket_t fd, short event, void* userp);
+  static void ProcessEvents(CurlHttpImpl* http);
   static std::string GetCaCertBlob();
 
+  void RecordTransfer(CURL* handle, CURLcode result) const;
+
   friend class CurlHttpOperation;
   friend class CurlHttpBodyGenerator;
   friend class CurlHandle;
@@ -228,6 +379,12 @@ class CurlHttpImpl {
   event_base* event_loop_;
   EventData timeout_event_;
   CurlHttpConfig config_;
+  mutable std::shared_ptr<const CaCertBundle> ca_certs_;
+  mutable std::optional<SharedPromise<NativeCaCertsProducer>> native_ca_certs_;
+  mutable std::thread native_ca_cert_loader_;
+  CURLSH* share_;
+  mutable CurlHandlePool handle_pool_;
+  mutable CurlHttpStats stats_;
 };
 
 void CurlHandle::Cleanup() {
@@ -238,6 +395,7 @@ void CurlHandle::Cleanup() {
   if (next_request_body_chunk_.event()->ev_base) {
     Check(event_del(next_request_body_chunk_.event()));
   }
+  Check(event_del(first_byte_timeout_.event()));
 }
 
 void CurlHandle::HandleException(std::exception_ptr exception) {
@@ -260,6 +418,7 @@ size_t CurlHandle::HeaderCallback(char* buffer, size_t size, size_t nitems,
   if (!std::holds_alternative<CurlHttpOperation*>(data->owner_)) {
     return 0;
   }
+  Check(event_del(data->first_byte_timeout_.event()));
   auto* http_operation = std::get<CurlHttpOperation*>(data->owner_);
   std::string_view view(buffer, size * nitems);
   auto index = view.find_first_of(':');
@@ -287,14 +446,17 @@ size_t CurlHandle::WriteCallback(char* ptr, size_t size, size_t nmemb,
       http_operation->headers_ready_event_posted_ = true;
       evuser_trigger(http_operation->headers_ready_.event());
     }
-    http_operation->body_ += std::string(ptr, ptr + size * nmemb);
+    http_operation->body_.append(ptr, size * nmemb);
   } else if (std::holds_alternative<CurlHttpBodyGenerator*>(data->owner_)) {
     auto* http_body_generator = std::get<CurlHttpBodyGenerator*>(data->owner_);
-    if (!http_body_generator->data_.empty() ||
-        http_body_generator->GetBufferedByteCount() > 0) {
+    size_t buffered_byte_cnt = http_body_generator->data_.size() +
+                               http_body_generator->GetBufferedByteCount();
+    if (buffered_byte_cnt > 0 &&
+        buffered_byte_cnt + size * nmemb > data->receive_window_size_) {
+      data->receive_paused_ = true;
       return CURL_WRITEFUNC_PAUSE;
     }
-    http_body_generator->data_ += std::string(ptr, ptr + size * nmemb);
+    http_body_generator->data_.append(ptr, size * nmemb);
     evuser_trigger(http_body_generator->chunk_ready_.event());
   }
   return size * nmemb;
@@ -310,45 +472,212 @@ int CurlHandle::ProgressCallback(void* clientp, curl_off_t /*dltotal*/,
 size_t CurlHandle::ReadCallback(char* buffer, size_t size, size_t nitems,
                                 void* userdata) {
   auto* data = reinterpret_cast<CurlHandle*>(userdata);
-  if (!data->request_body_it_ || !data->request_body_chunk_index_) {
-    return CURL_READFUNC_PAUSE;
-  }
-  if (data->request_body_it_ == std::end(*data->request_body_)) {
-    return 0;
-  }
-  std::string& current_chunk = **data->request_body_it_;
+  size_t capacity = size * nitems;
   size_t offset = 0;
-  for (; offset < size * nitems &&
-         data->request_body_chunk_index_ < current_chunk.size();
-       offset++) {
-    buffer[offset] = current_chunk[(*data->request_body_chunk_index_)++];
+  while (offset < capacity && !data->request_body_chunks_.empty()) {
+    const util::BufferSlice& chunk = data->request_body_chunks_.front();
+    size_t byte_cnt = std::min(capacity - offset,
+                               chunk.size() - data->request_body_chunk_offset_);
+    memcpy(buffer + offset, chunk.data() + data->request_body_chunk_offset_,
+           byte_cnt);
+    offset += byte_cnt;
+    data->request_body_chunk_offset_ += byte_cnt;
+    data->request_body_buffered_byte_cnt_ -= byte_cnt;
+    if (data->request_body_chunk_offset_ == chunk.size()) {
+      data->request_body_chunks_.pop_front();
+      data->request_body_chunk_offset_ = 0;
+    }
+  }
+  // Refills the window while curl sends what it just got.
+  data->FetchRequestBody();
+  if (offset > 0) {
+    return offset;
   }
-  if (data->request_body_chunk_index_ == current_chunk.size()) {
-    data->request_body_chunk_index_ = std::nullopt;
-    evuser_trigger(data->next_request_body_chunk_.event());
+  if (data->request_body_ended_) {
+    return 0;
   }
-  return offset > 0 ? offset : CURL_READFUNC_PAUSE;
+  data->send_paused_ = true;
+  return CURL_READFUNC_PAUSE;
 }
 
 void CurlHandle::OnNextRequestBodyChunkRequested(evutil_socket_t, short,
                                                  void* userdata) {
-  RunTask([data = reinterpret_cast<CurlHandle*>(userdata)]() -> Task<> {
-    try {
-      data->request_body_it_ = co_await ++*data->request_body_it_;
-      data->request_body_chunk_index_ = 0;
-      curl_easy_pause(data->handle_.get(), CURLPAUSE_SEND_CONT);
-    } catch (...) {
-      data->HandleException(std::current_exception());
+  util::EventLoop::CallbackScope callback_scope;
+  RunTask(reinterpret_cast<CurlHandle*>(userdata)->FetchRequestBodyChunks());
+}
+
+void CurlHandle::FetchRequestBody() {
+  if (!request_body_fetching_ && !request_body_ended_ &&
+      request_body_buffered_byte_cnt_ < send_window_size_) {
+    request_body_fetching_ = true;
+    // Curl doesn't expect the generator to run from within its callbacks.
+    evuser_trigger(next_request_body_chunk_.event());
+  }
+}
+
+Task<> CurlHandle::FetchRequestBodyChunks() {
+  try {
+    while (!request_body_ended_ &&
+           request_body_buffered_byte_cnt_ < send_window_size_) {
+      if (!request_body_it_) {
+        request_body_it_ = co_await request_body_->begin();
+      } else {
+        request_body_it_ = co_await ++*request_body_it_;
+      }
+      if (*request_body_it_ == std::end(*request_body_)) {
+        request_body_ended_ = true;
+      } else if (!(*request_body_it_)->empty()) {
+        request_body_buffered_byte_cnt_ += (*request_body_it_)->size();
+        request_body_chunks_.push_back(std::move(**request_body_it_));
+      }
+      if (std::exchange(send_paused_, false)) {
+        curl_easy_pause(handle_.get(),
+                        receive_paused_ ? CURLPAUSE_RECV : CURLPAUSE_CONT);
+      }
+    }
+    request_body_fetching_ = false;
+  } catch (...) {
+    HandleException(std::current_exception());
+  }
+}
+
+CaCertBundle::CaCertBundle(std::shared_ptr<const std::string> blob)
+    : blob_(std::move(blob)) {
+#ifdef CORO_HTTP_HAVE_TLS
+  if (blob_ && !blob_->empty() && IsCurlUsingOpenSsl()) {
+    store_ = GetStore(blob_);
+  }
+#endif
+}
+
+void CaCertBundle::Apply(CURL* handle) const {
+  if (!blob_ || blob_->empty()) {
+    return;
+  }
+#ifdef CORO_HTTP_HAVE_TLS
+  if (store_ && curl_easy_setopt(handle, CURLOPT_SSL_CTX_FUNCTION,
+                                 SslContextCallback) == CURLE_OK) {
+    Check(curl_easy_setopt(handle, CURLOPT_SSL_CTX_DATA, store_.get()));
+    // The store replaces whatever curl loads, so it shouldn't load anything.
+    Check(curl_easy_setopt(handle, CURLOPT_CAINFO, nullptr));
+    Check(curl_easy_setopt(handle, CURLOPT_CAPATH, nullptr));
+    return;
+  }
+#endif
+  curl_blob ca_cert{
+      .data = const_cast<void*>(reinterpret_cast<const void*>(blob_->data())),
+      .len = blob_->size()};
+  Check(curl_easy_setopt(handle, CURLOPT_CAINFO_BLOB, &ca_cert));
+}
+
+#ifdef CORO_HTTP_HAVE_TLS
+
+bool CaCertBundle::IsCurlUsingOpenSsl() {
+  // Stores can't be passed between different OpenSSL builds, so curl has to
+  // report the very version of the library loaded for this process, e.g.
+  // "OpenSSL/3.0.2" for "OpenSSL 3.0.2 15 Mar 2022". A curl built against
+  // several TLS backends lists the other ones after a space.
+  const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+  std::string_view curl_ssl_version =
+      info->ssl_version ? info->ssl_version : "";
+  curl_ssl_version = curl_ssl_version.substr(0, curl_ssl_version.find(' '));
+  std::string_view ssl_version = OpenSSL_version(OPENSSL_VERSION);
+  constexpr std::string_view kPrefix = "OpenSSL ";
+  if (!ssl_version.starts_with(kPrefix)) {
+    return false;
+  }
+  ssl_version.remove_prefix(kPrefix.size());
+  ssl_version = ssl_version.substr(0, ssl_version.find(' '));
+  return !ssl_version.empty() &&
+         curl_ssl_version == "OpenSSL/" + std::string(ssl_version);
+}
+
+std::shared_ptr<X509_STORE> CaCertBundle::GetStore(
+    const std::shared_ptr<const std::string>& blob) {
+  // Stores of the bundles still in use, so that CurlHttp instances given the
+  // same bundle, like the native one, share its store.
+  struct Entry {
+    std::weak_ptr<const std::string> blob;
+    std::weak_ptr<X509_STORE> store;
+  };
+  static std::mutex mutex;
+  static std::vector<Entry> entries;
+  std::unique_lock lock(mutex);
+  std::erase_if(entries, [](const Entry& e) { return e.blob.expired(); });
+  for (const Entry& e : entries) {
+    if (e.blob.lock() == blob) {
+      if (auto store = e.store.lock()) {
+        return store;
+      }
+    }
+  }
+  std::shared_ptr<X509_STORE> store = ParseStore(*blob);
+  if (store) {
+    entries.push_back(Entry{.blob = blob, .store = store});
+  }
+  return store;
+}
+
+std::shared_ptr<X509_STORE> CaCertBundle::ParseStore(std::string_view blob) {
+  std::unique_ptr<BIO, decltype(&BIO_free)> bio(
+      BIO_new_mem_buf(blob.data(), static_cast<int>(blob.size())), BIO_free);
+  if (!bio) {
+    return nullptr;
+  }
+  STACK_OF(X509_INFO)* infos =
+      PEM_X509_INFO_read_bio(bio.get(), nullptr, nullptr, nullptr);
+  if (!infos) {
+    return nullptr;
+  }
+  auto infos_guard = coro::util::AtScopeExit(
+      [&] { sk_X509_INFO_pop_free(infos, X509_INFO_free); });
+  std::shared_ptr<X509_STORE> store(X509_STORE_new(), X509StoreDeleter());
+  if (!store) {
+    return nullptr;
+  }
+  int cert_count = 0;
+  for (int i = 0; i < sk_X509_INFO_num(infos); i++) {
+    X509_INFO* info = sk_X509_INFO_value(infos, i);
+    if (info->x509 && X509_STORE_add_cert(store.get(), info->x509) == 1) {
+      cert_count++;
+    }
+    if (info->crl) {
+      X509_STORE_add_crl(store.get(), info->crl);
     }
-  });
+  }
+  if (cert_count == 0) {
+    return nullptr;
+  }
+  return store;
+}
+
+CURLcode CaCertBundle::SslContextCallback(CURL*, void* ssl_context,
+                                          void* userptr) {
+  auto* store = static_cast<X509_STORE*>(userptr);
+  if (X509_STORE_up_ref(store) != 1) {
+    return CURLE_SSL_CERTPROBLEM;
+  }
+  SSL_CTX_set_cert_store(static_cast<SSL_CTX*>(ssl_context), store);
+  return CURLE_OK;
+}
+
+#endif
+
+void CurlHandle::OnFirstByteTimeout(evutil_socket_t, short, void* userdata) {
+  util::EventLoop::CallbackScope callback_scope;
+  reinterpret_cast<CurlHandle*>(userdata)->HandleException(
+      std::make_exception_ptr(HttpException(CURLE_OPERATION_TIMEDOUT,
+                                            "First byte timeout reached.")));
 }
 
 void CurlHandle::OnCancel::operator()() const {
   data->HandleException(std::make_exception_ptr(InterruptedException()));
 }
 
-CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
+CurlHandle::CurlHandle(CURLM* http, CurlHandlePool* pool, CURLSH* share,
+                       event_base* event_loop, Request<> request,
                        const CurlHttpConfig& config,
+                       const CaCertBundle& ca_certs,
                        stdx::stop_token stop_token, Owner owner)
     : http_(http),
       event_loop_(event_loop),
@@ -356,10 +685,13 @@ CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
       request_body_(std::move(request.body)),
       stop_token_(std::move(stop_token)),
       owner_(owner),
+      receive_window_size_(config.receive_window_size),
+      send_window_size_(std::max<size_t>(config.send_window_size, 1)),
       next_request_body_chunk_(event_loop, -1, 0,
                                OnNextRequestBodyChunkRequested, this),
-      handle_(CheckNotNull(curl_easy_init()),
-              CurlHandleDeleter{.multi_handle = http}),
+      first_byte_timeout_(event_loop, -1, 0, OnFirstByteTimeout, this),
+      handle_(pool->Acquire(),
+              CurlHandleDeleter{.multi_handle = http, .pool = pool}),
       stop_callback_(stop_token_, OnCancel{this}) {
   Check(curl_easy_setopt(handle_.get(), CURLOPT_URL, request.url.data()));
   Check(curl_easy_setopt(handle_.get(), CURLOPT_PRIVATE, this));
@@ -381,19 +713,30 @@ CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
                          CURL_HTTP_VERSION_NONE));
   Check(curl_easy_setopt(handle_.get(), CURLOPT_SSL_OPTIONS,
                          CURLSSLOPT_NATIVE_CA));
+  if (share) {
+    Check(curl_easy_setopt(handle_.get(), CURLOPT_SHARE, share));
+  }
   if (request.method == Method::kHead) {
     Check(curl_easy_setopt(handle_.get(), CURLOPT_NOBODY, 1L));
   }
+  if (const auto& timeout = request.timeouts.connect) {
+    Check(curl_easy_setopt(handle_.get(), CURLOPT_CONNECTTIMEOUT_MS,
+                           static_cast<long>(timeout->count())));
+  }
+  if (const auto& timeout = request.timeouts.total) {
+    Check(curl_easy_setopt(handle_.get(), CURLOPT_TIMEOUT_MS,
+                           static_cast<long>(timeout->count())));
+  }
   if (config.alt_svc_path) {
     Check(curl_easy_setopt(handle_.get(), CURLOPT_ALTSVC,
                            config.alt_svc_path->c_str()));
   }
-  if (config.ca_cert_blob && !config.ca_cert_blob->empty()) {
-    curl_blob ca_cert{.data = const_cast<void*>(reinterpret_cast<const void*>(
-                          config.ca_cert_blob->data())),
-                      .len = config.ca_cert_blob->size()};
-    Check(curl_easy_setopt(handle_.get(), CURLOPT_CAINFO_BLOB, &ca_cert));
-  }
+  ca_certs.Apply(handle_.get());
+#if LIBCURL_VERSION_NUM >= 0x075700
+  // Left unchecked, as a libcurl older than its headers doesn't know it.
+  curl_easy_setopt(handle_.get(), CURLOPT_CA_CACHE_TIMEOUT,
+                   static_cast<long>(config.ca_cache_timeout.count()));
+#endif
   std::optional<curl_off_t> content_length;
   for (const auto& [header_name, header_value] : request.headers) {
     std::string header_line = header_name;
@@ -401,7 +744,7 @@ CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
     header_line += header_value;
     header_list_.reset(CheckNotNull(
         curl_slist_append(header_list_.release(), header_line.c_str())));
-    if (ToLowerCase(header_name) == "content-length") {
+    if (EqualsIgnoreCase(header_name, "content-length")) {
       content_length = std::stoll(header_value);
     }
   }
@@ -422,30 +765,39 @@ CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
                                *content_length));
       }
     }
-    RunTask([d = this]() -> Task<> {
-      try {
-        d->request_body_it_ = co_await d->request_body_->begin();
-        d->request_body_chunk_index_ = 0;
-        curl_easy_pause(d->handle_.get(), CURLPAUSE_SEND_CONT);
-      } catch (...) {
-        d->HandleException(std::current_exception());
-      }
-    });
+    // Curl copies the body into its upload buffer in reads of at most this
+    // size, so large chunks take fewer callbacks.
+    curl_easy_setopt(handle_.get(), CURLOPT_UPLOAD_BUFFERSIZE,
+                     static_cast<long>(std::clamp<size_t>(
+                         send_window_size_, 16 * 1024, 2 * 1024 * 1024)));
+    request_body_fetching_ = true;
+    RunTask(FetchRequestBodyChunks());
   }
 
   Check(curl_multi_add_handle(http, handle_.get()));
+
+  // Libcurl has no limit on the time to the first byte of a response, so it
+  // is enforced by a timer cleared by the first header.
+  if (request.timeouts.first_byte) {
+    auto ms = request.timeouts.first_byte->count();
+    timeval tv = {
+        .tv_sec = static_cast<decltype(tv.tv_sec)>(ms / 1000),
+        .tv_usec = static_cast<decltype(tv.tv_usec)>(ms % 1000 * 1000)};
+    Check(event_add(first_byte_timeout_.event(), &tv));
+  }
 }
 
 CurlHttpBodyGenerator::CurlHttpBodyGenerator(std::unique_ptr<CurlHandle> handle,
-                                             std::string_view initial_chunk)
+                                             std::string initial_chunk)
     : chunk_ready_(handle->event_loop_, -1, 0, OnChunkReady, this),
       body_ready_(handle->event_loop_, -1, 0, OnBodyReady, this),
       handle_(std::move(handle)) {
   handle_->owner_ = this;
-  ReceivedData(initial_chunk);
+  ReceivedData(std::move(initial_chunk));
 }
 
 void CurlHttpBodyGenerator::OnChunkReady(evutil_socket_t, short, void* handle) {
+  util::EventLoop::CallbackScope callback_scope;
   auto* curl_http_body_generator =
       reinterpret_cast<CurlHttpBodyGenerator*>(handle);
   std::string data = std::move(curl_http_body_generator->data_);
@@ -459,6 +811,7 @@ void CurlHttpBodyGenerator::OnChunkReady(evutil_socket_t, short, void* handle) {
 }
 
 void CurlHttpBodyGenerator::OnBodyReady(evutil_socket_t, short, void* handle) {
+  util::EventLoop::CallbackScope callback_scope;
   auto* curl_http_body_generator =
       reinterpret_cast<CurlHttpBodyGenerator*>(handle);
   if (curl_http_body_generator->exception_ptr_) {
@@ -469,21 +822,27 @@ void CurlHttpBodyGenerator::OnBodyReady(evutil_socket_t, short, void* handle) {
 }
 
 void CurlHttpBodyGenerator::Resume() {
-  if (status_ == -1 && !exception_ptr_) {
+  if (status_ == -1 && !exception_ptr_ && handle_->receive_paused_ &&
+      data_.size() + GetBufferedByteCount() <=
+          handle_->receive_window_size_ / 2) {
+    handle_->receive_paused_ = false;
     curl_easy_pause(handle_->handle_.get(), CURLPAUSE_RECV_CONT);
   }
 }
 
-CurlHttpOperation::CurlHttpOperation(CURLM* http, event_base* event_loop,
+CurlHttpOperation::CurlHttpOperation(CURLM* http, CurlHandlePool* pool,
+                                     CURLSH* share, event_base* event_loop,
                                      Request<> request,
                                      const CurlHttpConfig& config,
+                                     const CaCertBundle& ca_certs,
                                      stdx::stop_token stop_token)
     : headers_ready_(event_loop, -1, 0, OnHeadersReady, this),
-      handle_(std::make_unique<CurlHandle>(http, event_loop, std::move(request),
-                                           config, std::move(stop_token),
-                                           this)) {}
+      handle_(std::make_unique<CurlHandle>(
+          http, pool, share, event_loop, std::move(request), config, ca_certs,
+          std::move(stop_token), this)) {}
 
 void CurlHttpOperation::OnHeadersReady(evutil_socket_t, short, void* handle) {
+  util::EventLoop::CallbackScope callback_scope;
   auto* http_operation = reinterpret_cast<CurlHttpOperation*>(handle);
   if (http_operation->awaiting_coroutine_) {
     std::exchange(http_operation->awaiting_coroutine_, nullptr).resume();
@@ -499,10 +858,11 @@ void CurlHttpOperation::await_suspend(
   awaiting_coroutine_ = awaiting_coroutine;
 }
 
-std::unique_ptr<Response<CurlHttpBodyGenerator>>
+Result<std::unique_ptr<Response<CurlHttpBodyGenerator>>>
 CurlHttpOperation::await_resume() {
   if (exception_ptr_) {
-    std::rethrow_exception(exception_ptr_);
+    return Result<std::unique_ptr<Response<CurlHttpBodyGenerator>>>::Failure(
+        exception_ptr_);
   }
   std::unique_ptr<Response<CurlHttpBodyGenerator>> response(
       new Response<CurlHttpBodyGenerator>{
@@ -515,11 +875,17 @@ CurlHttpOperation::await_resume() {
   return response;
 }
 
-CurlHttpImpl::CurlHttpImpl(event_base* event_loop, CurlHttpConfig config)
+CurlHttpImpl::CurlHttpImpl(event_base* event_loop, CurlHttpConfig config,
+                           CURLSH* share)
     : curl_handle_(CheckNotNull(curl_multi_init())),
       event_loop_(event_loop),
-      timeout_event_(event_loop, -1, 0, TimeoutEvent, curl_handle_.get()),
-      config_(std::move(config)) {
+      timeout_event_(event_loop, -1, 0, TimeoutEvent, this),
+      config_(std::move(config)),
+      ca_certs_(config_.ca_cert_blob || !config_.native_ca_certs
+                    ? std::make_shared<const CaCertBundle>(config_.ca_cert_blob)
+                    : nullptr),
+      share_(share),
+      handle_pool_(config_.max_idle_handle_count) {
   Check(curl_multi_setopt(curl_handle_.get(), CURLMOPT_SOCKETFUNCTION,
                           SocketCallback));
   Check(curl_multi_setopt(curl_handle_.get(), CURLMOPT_TIMERFUNCTION,
@@ -528,20 +894,108 @@ CurlHttpImpl::CurlHttpImpl(event_base* event_loop, CurlHttpConfig config)
   Check(curl_multi_setopt(curl_handle_.get(), CURLMOPT_TIMERDATA, this));
 }
 
-void CurlHttpImpl::TimeoutEvent(evutil_socket_t, short, void* handle) {
+CurlHttpImpl::~CurlHttpImpl() {
+  if (native_ca_cert_loader_.joinable()) {
+    native_ca_cert_loader_.join();
+  }
+}
+
+Task<> CurlHttpImpl::LoadCaCerts(const coro::util::EventLoop* event_loop,
+                                 stdx::stop_token stop_token) const {
+  if (!native_ca_certs_) {
+    auto load = std::make_shared<NativeCaCertLoad>(event_loop_);
+    timeval forever = {.tv_sec = 365 * 24 * 60 * 60, .tv_usec = 0};
+    Check(event_add(load->keep_alive.event(), &forever));
+    native_ca_certs_.emplace(NativeCaCertsProducer{load});
+    native_ca_cert_loader_ = std::thread([event_loop,
+                                          load = std::move(load)]() mutable {
+      std::shared_ptr<const CaCertBundle> bundle;
+      std::exception_ptr exception;
+      try {
+        bundle = GetNativeCaCertBundle();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+      // Hands over the last reference this thread has, so that the event is
+      // only ever touched on the event loop.
+      event_loop->RunOnEventLoop([load = std::move(load),
+                                  bundle = std::move(bundle), exception] {
+        Check(event_del(load->keep_alive.event()));
+        if (exception) {
+          load->loaded.SetException(exception);
+        } else {
+          load->loaded.SetValue(bundle);
+        }
+      });
+    });
+  }
+  ca_certs_ = (co_await native_ca_certs_->Get(std::move(stop_token))).get();
+}
+
+void CurlHttpImpl::TimeoutEvent(evutil_socket_t, short, void* userp) {
+  util::EventLoop::CallbackScope callback_scope;
+  auto* http = reinterpret_cast<CurlHttpImpl*>(userp);
   int running_handles;
-  Check(curl_multi_socket_action(handle, CURL_SOCKET_TIMEOUT, 0,
-                                 &running_handles));
-  ProcessEvents(handle);
+  Check(curl_multi_socket_action(http->curl_handle_.get(), CURL_SOCKET_TIMEOUT,
+                                 0, &running_handles));
+  ProcessEvents(http);
 }
 
-void CurlHttpImpl::ProcessEvents(CURLM* multi_handle) {
+void CurlHttpImpl::RecordTransfer(CURL* handle, CURLcode result) const {
+  auto get_time = [&](CURLINFO info) {
+    curl_off_t time = 0;
+    Check(curl_easy_getinfo(handle, info, &time));
+    return std::chrono::microseconds(time);
+  };
+  long response_code = 0;
+  Check(curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code));
+  long connect_count = 0;
+  Check(curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connect_count));
+  CurlTransferTiming timing{
+      .result = static_cast<int>(result),
+      .status = static_cast<int>(response_code),
+      .name_lookup = get_time(CURLINFO_NAMELOOKUP_TIME_T),
+      .connect = get_time(CURLINFO_CONNECT_TIME_T),
+      .tls_handshake = get_time(CURLINFO_APPCONNECT_TIME_T),
+      .first_byte = get_time(CURLINFO_STARTTRANSFER_TIME_T),
+      .total = get_time(CURLINFO_TOTAL_TIME_T),
+      .reused_connection = connect_count == 0};
+
+  stats_.transfer_count++;
+  if (result != CURLE_OK) {
+    stats_.failed_transfer_count++;
+  }
+  if (timing.reused_connection) {
+    stats_.reused_connection_count++;
+  } else {
+    stats_.name_lookup.Add(timing.name_lookup);
+    stats_.connect.Add(timing.connect);
+    if (timing.tls_handshake.count() > 0) {
+      stats_.tls_handshake.Add(timing.tls_handshake);
+    }
+  }
+  stats_.first_byte.Add(timing.first_byte);
+  stats_.total.Add(timing.total);
+
+  if (config_.on_transfer_finished) {
+    char* url = nullptr;
+    Check(curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url));
+    if (url) {
+      timing.url = url;
+    }
+    config_.on_transfer_finished(timing);
+  }
+}
+
+void CurlHttpImpl::ProcessEvents(CurlHttpImpl* http) {
+  CURLM* multi_handle = http->curl_handle_.get();
   CURLMsg* message;
   do {
     int message_count;
     message = curl_multi_info_read(multi_handle, &message_count);
     if (message && message->msg == CURLMSG_DONE) {
       CURL* handle = message->easy_handle;
+      http->RecordTransfer(handle, message->data.result);
       CurlHandle* data;
       Check(curl_easy_getinfo(handle, CURLINFO_PRIVATE, &data));
       if (std::holds_alternative<CurlHttpOperation*>(data->owner_)) {
@@ -559,6 +1013,7 @@ void CurlHttpImpl::ProcessEvents(CURLM* multi_handle) {
         Check(event_base_once(
             operation->handle_->event_loop_, -1, EV_TIMEOUT,
             [](evutil_socket_t, short, void* handle) {
+              util::EventLoop::CallbackScope callback_scope;
               stdx::coroutine_handle<void>::from_address(handle).resume();
             },
             std::exchange(operation->awaiting_coroutine_, nullptr).address(),
@@ -584,14 +1039,16 @@ void CurlHttpImpl::ProcessEvents(CURLM* multi_handle) {
   } while (message != nullptr);
 }
 
-void CurlHttpImpl::SocketEvent(evutil_socket_t fd, short event, void* handle) {
+void CurlHttpImpl::SocketEvent(evutil_socket_t fd, short event, void* userp) {
+  util::EventLoop::CallbackScope callback_scope;
+  auto* http = reinterpret_cast<CurlHttpImpl*>(userp);
   int running_handles;
   Check(
-      curl_multi_socket_action(handle, fd,
+      curl_multi_socket_action(http->curl_handle_.get(), fd,
                                ((event & EV_READ) ? CURL_CSELECT_IN : 0) |
                                    ((event & EV_WRITE) ? CURL_CSELECT_OUT : 0),
                                &running_handles));
-  ProcessEvents(handle);
+  ProcessEvents(http);
 }
 
 int CurlHttpImpl::SocketCallback(CURL*, curl_socket_t socket, int what,
@@ -606,12 +1063,12 @@ int CurlHttpImpl::SocketCallback(CURL*, curl_socket_t socket, int what,
                                      EV_PERSIST);
     if (!data) {
       data = new EventData(http->event_loop_, socket, events, SocketEvent,
-                           http->curl_handle_.get());
+                           http);
       Check(curl_multi_assign(http->curl_handle_.get(), socket, data));
     } else {
       Check(event_del(data->event()));
       Check(event_assign(data->event(), http->event_loop_, socket, events,
-                         SocketEvent, http->curl_handle_.get()));
+                         SocketEvent, http));
     }
     Check(event_add(data->event(), /*timeout=*/nullptr));
   }
@@ -633,26 +1090,70 @@ int CurlHttpImpl::TimerCallback(CURLM*, long timeout_ms, void* userp) {
 
 CurlHttpOperation CurlHttpImpl::Fetch(Request<> request,
                                       stdx::stop_token token) const {
-  return {curl_handle_.get(), event_loop_, std::move(request), config_,
-          std::move(token)};
+  return {curl_handle_.get(), &handle_pool_, share_, event_loop_,
+          std::move(request), config_, *ca_certs_, std::move(token)};
 }
 
 void CurlHttpImpl::CurlMultiDeleter::operator()(CURLM* handle) const {
   Check(curl_multi_cleanup(handle));
 }
 
-Generator<std::string> ToBody(
+Generator<util::BufferSlice> ToBody(
     std::unique_ptr<Response<CurlHttpBodyGenerator>> d) {
-  FOR_CO_AWAIT(std::string & chunk, d->body) { co_yield std::move(chunk); }
+  FOR_CO_AWAIT(util::BufferSlice & chunk, d->body) {
+    co_yield std::move(chunk);
+  }
 }
 
 }  // namespace
 
 struct CurlHttp::Impl {
+  const coro::util::EventLoop* event_loop;
   CurlHttpImpl impl;
 };
 
-std::string GetNativeCaCertBlob() {
+struct CurlShare::Impl {
+  static void Lock(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+    reinterpret_cast<Impl*>(userp)->mutex[data].lock();
+  }
+
+  static void Unlock(CURL*, curl_lock_data data, void* userp) {
+    reinterpret_cast<Impl*>(userp)->mutex[data].unlock();
+  }
+
+  struct CurlShareDeleter {
+    void operator()(CURLSH* handle) const noexcept {
+      curl_share_cleanup(handle);
+    }
+  };
+
+  CurlGlobalInitializer initializer;
+  std::mutex mutex[CURL_LOCK_DATA_LAST];
+  std::unique_ptr<CURLSH, CurlShareDeleter> handle{
+      CheckNotNull(curl_share_init())};
+};
+
+CurlShare::CurlShare() : d_(std::make_unique<Impl>()) {
+  CURLSH* handle = d_->handle.get();
+  auto check = [](CURLSHcode code) {
+    if (code != CURLSHE_OK) {
+      throw HttpException(code, curl_share_strerror(code));
+    }
+  };
+  check(curl_share_setopt(handle, CURLSHOPT_LOCKFUNC, Impl::Lock));
+  check(curl_share_setopt(handle, CURLSHOPT_UNLOCKFUNC, Impl::Unlock));
+  check(curl_share_setopt(handle, CURLSHOPT_USERDATA, d_.get()));
+  for (curl_lock_data data : {CURL_LOCK_DATA_DNS, CURL_LOCK_DATA_SSL_SESSION,
+                              CURL_LOCK_DATA_CONNECT}) {
+    check(curl_share_setopt(handle, CURLSHOPT_SHARE, data));
+  }
+}
+
+CurlShare::~CurlShare() = default;
+
+namespace {
+
+std::string LoadNativeCaCertBlob() {
   constexpr int kMaxCaCertBlobSize = 1024 * 1024 * 10;
   constexpr int kBufferSize = 4 * 1024;
   std::string blob;
@@ -689,11 +1190,23 @@ std::string GetNativeCaCertBlob() {
   return blob;
 }
 
+}  // namespace
+
+std::shared_ptr<const std::string> GetNativeCaCertBlob() {
+  static const auto blob =
+      std::make_shared<const std::string>(LoadNativeCaCertBlob());
+  return blob;
+}
+
 CurlHttp::CurlHttp(const coro::util::EventLoop* event_loop,
                    CurlHttpConfig config)
-    : d_(new Impl{
-          {reinterpret_cast<struct event_base*>(GetEventLoop(*event_loop)),
-           std::move(config)}}) {}
+    : d_([&] {
+        CURLSH* share = config.share ? config.share->d_->handle.get() : nullptr;
+        return new Impl{
+            event_loop,
+            {reinterpret_cast<struct event_base*>(GetEventLoop(*event_loop)),
+             std::move(config), share}};
+      }()) {}
 
 CurlHttp::~CurlHttp() = default;
 
@@ -703,8 +1216,25 @@ CurlHttp& CurlHttp::operator=(CurlHttp&&) noexcept = default;
 
 Task<Response<>> CurlHttp::Fetch(Request<> request,
                                  stdx::stop_token stop_token) const {
-  auto response =
+  auto result = co_await TryFetch(std::move(request), std::move(stop_token));
+  co_return std::move(result).value();
+}
+
+Task<Result<Response<>>> CurlHttp::TryFetch(Request<> request,
+                                            stdx::stop_token stop_token) const {
+  if (!d_->impl.has_ca_certs()) {
+    try {
+      co_await d_->impl.LoadCaCerts(d_->event_loop, stop_token);
+    } catch (...) {
+      co_return Result<Response<>>::Failure(std::current_exception());
+    }
+  }
+  auto result =
       co_await d_->impl.Fetch(std::move(request), std::move(stop_token));
+  if (!result) {
+    co_return Result<Response<>>::Failure(result.error());
+  }
+  auto response = std::move(result).value();
   auto status = response->status;
   auto headers = std::move(response->headers);
   co_return Response<>{.status = status,
@@ -712,4 +1242,6 @@ Task<Response<>> CurlHttp::Fetch(Request<> request,
                        .body = ToBody(std::move(response))};
 }
 
+CurlHttpStats CurlHttp::GetStats() const { return d_->impl.stats(); }
+
 }  // namespace coro::http
@@ -1,16 +1,102 @@
 #ifndef CORO_HTTP_SRC_CORO_HTTP_CURL_HTTP_H_
 #define CORO_HTTP_SRC_CORO_HTTP_CURL_HTTP_H_
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
 #include "coro/http/http.h"
+#include "coro/result.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/latency_histogram.h"
 
 namespace coro::http {
 
-std::string GetNativeCaCertBlob();
+// PEM bundle of the CA certificates found in the system's certificate
+// directories. They're read on the first call, which blocks, and shared by all
+// the later ones. CurlHttp makes that call on a thread of its own.
+std::shared_ptr<const std::string> GetNativeCaCertBlob();
+
+// Shares the DNS cache, TLS sessions and connections between CurlHttp
+// instances, also ones running on different threads.
+class CurlShare {
+ public:
+  CurlShare();
+  CurlShare(const CurlShare&) = delete;
+  CurlShare(CurlShare&&) = delete;
+  CurlShare& operator=(const CurlShare&) = delete;
+  CurlShare& operator=(CurlShare&&) = delete;
+  ~CurlShare();
+
+ private:
+  friend class CurlHttp;
+
+  struct Impl;
+
+  std::unique_ptr<Impl> d_;
+};
+
+// Where the time of a finished transfer went, as recorded by libcurl. Every
+// duration is measured from the start of the transfer, so e.g. `connect`
+// includes `name_lookup`.
+struct CurlTransferTiming {
+  std::string url;
+  // CURLcode of the transfer, 0 if it succeeded.
+  int result;
+  int status;
+  std::chrono::microseconds name_lookup;
+  std::chrono::microseconds connect;
+  // Zero unless the transfer went through a new TLS connection.
+  std::chrono::microseconds tls_handshake;
+  std::chrono::microseconds first_byte;
+  std::chrono::microseconds total;
+  bool reused_connection;
+};
+
+// Aggregate of all the transfers finished by a CurlHttp instance.
+struct CurlHttpStats {
+  uint64_t transfer_count = 0;
+  uint64_t failed_transfer_count = 0;
+  uint64_t reused_connection_count = 0;
+  coro::util::LatencyHistogram name_lookup;
+  coro::util::LatencyHistogram connect;
+  coro::util::LatencyHistogram tls_handshake;
+  coro::util::LatencyHistogram first_byte;
+  coro::util::LatencyHistogram total;
+};
 
 struct CurlHttpConfig {
   std::optional<std::string> alt_svc_path;
-  std::optional<std::string> ca_cert_blob = GetNativeCaCertBlob();
+  // PEM bundle of the CA certificates to trust. In builds with WITH_TLS=ON,
+  // and if curl uses the same OpenSSL as this library, it's parsed once per
+  // bundle and process rather than for every TLS connection, so pass the same
+  // pointer to all the instances.
+  std::shared_ptr<const std::string> ca_cert_blob;
+  // If `ca_cert_blob` is null, trusts the bundle of GetNativeCaCertBlob rather
+  // than curl's default CA certificates. It's loaded and parsed off the event
+  // loop, once per process, when the first request needs it; requests wait
+  // for it.
+  bool native_ca_certs = true;
+  // How long curl keeps a CA store it loaded from a file, i.e. with curl's
+  // default CA certificates, for further connections. Needs curl 7.87.0.
+  std::chrono::seconds ca_cache_timeout = std::chrono::hours(24);
+  std::shared_ptr<CurlShare> share;
+  // Easy handles of finished requests are reset and kept for reuse, up to
+  // this many.
+  size_t max_idle_handle_count = 16;
+  // Response body bytes which may be received ahead of the consumer. Once
+  // that much is buffered the transfer is paused, and it's resumed when the
+  // consumer has drained the buffer down to half of it.
+  size_t receive_window_size = 1024 * 1024;
+  // Request body bytes which may be pulled from the body generator ahead of
+  // curl sending them, so that the upload doesn't wait for the generator at
+  // every chunk boundary. The generator is only advanced while less than this
+  // much is buffered.
+  size_t send_window_size = 1024 * 1024;
+  // Called on the event loop for every finished transfer; must not throw.
+  std::function<void(const CurlTransferTiming&)> on_transfer_finished;
 };
 
 class CurlHttp {
@@ -23,6 +109,14 @@ class CurlHttp {
   ~CurlHttp();
 
   Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
+  // Like Fetch, but a failure to receive the response head, e.g. a connection
+  // error, a timeout or cancellation, is returned rather than thrown. Errors
+  // while reading the body are still thrown by the body generator.
+  Task<Result<Response<>>> TryFetch(Request<> request,
+                                    stdx::stop_token stop_token) const;
+
+  // Must be called on the event loop thread.
+  CurlHttpStats GetStats() const;
 
  private:
   struct Impl;
@@ -0,0 +1,397 @@
+#include "coro/http/disk_cache.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+
+#include "coro/exception.h"
+
+namespace coro::http {
+
+#ifndef _WIN32
+
+namespace {
+
+constexpr std::string_view kFileHeader = "coro-http-cache2";
+constexpr uint32_t kRecordMagic = 0x43524543;
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t key_size;
+  // Size of the whole record, this header included.
+  uint64_t size;
+  uint64_t key_hash;
+};
+
+std::string GetErrorMessage(std::string_view operation,
+                            std::string_view path) {
+  return std::string(operation) + " " + std::string(path) + ": " +
+         strerror(errno);
+}
+
+void WriteAll(int fd, std::string_view data, uint64_t offset) {
+  while (!data.empty()) {
+    ssize_t written = pwrite(fd, data.data(), data.size(), offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw RuntimeError(std::string("pwrite error: ") + strerror(errno));
+    }
+    data.remove_prefix(written);
+    offset += written;
+  }
+}
+
+void PutUInt64(std::string& output, uint64_t value) {
+  output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& output, std::string_view value) {
+  PutUInt64(output, value.size());
+  output += value;
+}
+
+void PutHeaders(
+    std::string& output,
+    const std::vector<std::pair<std::string, std::string>>& headers) {
+  PutUInt64(output, headers.size());
+  for (const auto& [name, value] : headers) {
+    PutString(output, name);
+    PutString(output, value);
+  }
+}
+
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : data_(data) {}
+
+  uint64_t GetUInt64() {
+    uint64_t value;
+    memcpy(&value, Consume(sizeof(value)).data(), sizeof(value));
+    return value;
+  }
+
+  std::string_view GetString() { return Consume(GetUInt64()); }
+
+  std::vector<std::pair<std::string, std::string>> GetHeaders() {
+    std::vector<std::pair<std::string, std::string>> headers;
+    uint64_t count = GetUInt64();
+    for (uint64_t i = 0; i < count; i++) {
+      std::string name(GetString());
+      std::string value(GetString());
+      headers.emplace_back(std::move(name), std::move(value));
+    }
+    return headers;
+  }
+
+  std::string_view Consume(uint64_t size) {
+    if (size > data_.size()) {
+      throw RuntimeError("corrupted disk cache record");
+    }
+    std::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+  }
+
+ private:
+  std::string_view data_;
+};
+
+std::string SerializeKey(const RequestFingerprint& key) {
+  std::string result;
+  PutUInt64(result, key.low);
+  PutUInt64(result, key.high);
+  return result;
+}
+
+std::string SerializeMetadata(const DiskCache::Metadata& metadata) {
+  std::string result;
+  PutUInt64(result, static_cast<uint64_t>(metadata.status));
+  PutUInt64(result, static_cast<uint64_t>(metadata.timestamp));
+  PutUInt64(result, static_cast<uint64_t>(metadata.max_age_ms));
+  PutUInt64(result, static_cast<uint64_t>(metadata.stale_while_revalidate_ms));
+  PutHeaders(result, metadata.headers);
+  return result;
+}
+
+struct Mapping {
+  Mapping(void* data, size_t size) : data(data), size(size) {}
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+  ~Mapping() { munmap(data, size); }
+
+  void* data;
+  size_t size;
+};
+
+struct FileDescriptor {
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  ~FileDescriptor() { close(fd); }
+
+  int fd;
+};
+
+struct Record {
+  std::shared_ptr<const Mapping> mapping;
+  std::string_view data;
+  std::shared_ptr<const FileDescriptor> file;
+  // Of `data` in the file.
+  uint64_t offset;
+};
+
+DiskCache::Entry ToEntry(Record record) {
+  Reader reader(record.data);
+  RecordHeader header;
+  memcpy(&header, reader.Consume(sizeof(header)).data(), sizeof(header));
+  reader.Consume(header.key_size);
+  DiskCache::Metadata metadata{
+      .status = static_cast<int>(reader.GetUInt64()),
+      .timestamp = static_cast<int64_t>(reader.GetUInt64()),
+      .max_age_ms = static_cast<int64_t>(reader.GetUInt64()),
+      .stale_while_revalidate_ms = static_cast<int64_t>(reader.GetUInt64())};
+  metadata.headers = reader.GetHeaders();
+  std::string_view body = reader.GetString();
+  int fd = record.file->fd;
+  util::FileSlice file_body(std::move(record.file), fd,
+                            record.offset + (body.data() - record.data.data()),
+                            body.size());
+  return {.metadata = std::move(metadata),
+          .body = body,
+          .mapping = std::move(record.mapping),
+          .file_body = std::move(file_body)};
+}
+
+}  // namespace
+
+class DiskCache::Log {
+ public:
+  explicit Log(std::string path)
+      : path_(std::move(path)),
+        fd_(open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)) {
+    if (fd_ < 0) {
+      throw RuntimeError(GetErrorMessage("can't open", path_));
+    }
+    // Entries handed out keep the file open past the log's rotation.
+    file_ = std::make_shared<const FileDescriptor>(fd_);
+  }
+
+  Log(const Log&) = delete;
+  Log& operator=(const Log&) = delete;
+
+  const std::string& path() const { return path_; }
+  void set_path(std::string path) { path_ = std::move(path); }
+
+  uint64_t size() {
+    EnsureIndexed();
+    return size_;
+  }
+
+  std::optional<Record> Find(uint64_t key_hash, std::string_view key) {
+    EnsureIndexed();
+    auto it = index_.find(key_hash);
+    if (it == index_.end()) {
+      return std::nullopt;
+    }
+    std::shared_ptr<const Mapping> mapping = GetMapping();
+    std::string_view file(static_cast<const char*>(mapping->data),
+                          mapping->size);
+    RecordHeader header;
+    memcpy(&header, file.data() + it->second, sizeof(header));
+    std::string_view data = file.substr(it->second, header.size);
+    if (data.substr(sizeof(header), header.key_size) != key) {
+      return std::nullopt;
+    }
+    return Record{.mapping = std::move(mapping),
+                  .data = data,
+                  .file = file_,
+                  .offset = it->second};
+  }
+
+  // Writes a record made of `pieces`, the first of which starts with its
+  // RecordHeader.
+  void Append(uint64_t key_hash, std::span<const std::string_view> pieces) {
+    EnsureIndexed();
+    uint64_t offset = size_;
+    for (std::string_view piece : pieces) {
+      WriteAll(fd_, piece, offset);
+      offset += piece.size();
+    }
+    index_[key_hash] = size_;
+    size_ = offset;
+  }
+
+ private:
+  // Builds the index by walking the record headers. A torn record at the end,
+  // left by a crash mid-write, is cut off.
+  void EnsureIndexed() {
+    if (indexed_) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      throw RuntimeError(GetErrorMessage("can't stat", path_));
+    }
+    uint64_t file_size = st.st_size;
+    std::string header(kFileHeader.size(), '\0');
+    if (file_size < kFileHeader.size() ||
+        pread(fd_, header.data(), header.size(), 0) !=
+            static_cast<ssize_t>(header.size()) ||
+        header != kFileHeader) {
+      if (ftruncate(fd_, 0) != 0) {
+        throw RuntimeError(GetErrorMessage("can't truncate", path_));
+      }
+      WriteAll(fd_, kFileHeader, 0);
+      file_size = kFileHeader.size();
+    }
+    uint64_t offset = kFileHeader.size();
+    while (offset + sizeof(RecordHeader) <= file_size) {
+      RecordHeader record;
+      if (pread(fd_, &record, sizeof(record), offset) !=
+              static_cast<ssize_t>(sizeof(record)) ||
+          record.magic != kRecordMagic || record.size < sizeof(record) ||
+          record.size > file_size - offset) {
+        break;
+      }
+      index_[record.key_hash] = offset;
+      offset += record.size;
+    }
+    if (offset < file_size && ftruncate(fd_, offset) != 0) {
+      throw RuntimeError(GetErrorMessage("can't truncate", path_));
+    }
+    size_ = offset;
+    indexed_ = true;
+  }
+
+  std::shared_ptr<const Mapping> GetMapping() {
+    if (!mapping_ || mapping_->size < size_) {
+      void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+      if (data == MAP_FAILED) {
+        throw RuntimeError(GetErrorMessage("can't map", path_));
+      }
+      mapping_ = std::make_shared<const Mapping>(data, size_);
+    }
+    return mapping_;
+  }
+
+  std::string path_;
+  int fd_;
+  std::shared_ptr<const FileDescriptor> file_;
+  bool indexed_ = false;
+  uint64_t size_ = 0;
+  std::unordered_map<uint64_t, uint64_t> index_;
+  std::shared_ptr<const Mapping> mapping_;
+};
+
+DiskCache::DiskCache(Config config)
+    : config_(std::move(config)),
+      current_(std::make_unique<Log>(config_.directory + "/current.log")),
+      previous_(std::make_unique<Log>(config_.directory + "/previous.log")) {}
+
+DiskCache::~DiskCache() = default;
+
+std::optional<DiskCache::Entry> DiskCache::Get(
+    const RequestFingerprint& fingerprint) {
+  std::string key = SerializeKey(fingerprint);
+  uint64_t key_hash = fingerprint.low;
+  std::unique_lock lock(mutex_);
+  try {
+    if (auto record = current_->Find(key_hash, key)) {
+      return ToEntry(std::move(*record));
+    }
+    if (auto record = previous_->Find(key_hash, key)) {
+      // Keeps the entry alive across the next rotation.
+      if (current_->size() + record->data.size() > config_.max_size_bytes / 2) {
+        Rotate();
+      }
+      std::string_view pieces[] = {record->data};
+      current_->Append(key_hash, pieces);
+      return ToEntry(std::move(*record));
+    }
+  } catch (const RuntimeError&) {
+    // A failing disk cache behaves as an empty one.
+  }
+  return std::nullopt;
+}
+
+void DiskCache::Put(const RequestFingerprint& fingerprint,
+                    const Metadata& metadata,
+                    std::span<const std::string_view> body) {
+  std::unique_lock lock(mutex_);
+  PutLocked(fingerprint, metadata, body);
+}
+
+void DiskCache::PutLocked(const RequestFingerprint& fingerprint,
+                          const Metadata& metadata,
+                          std::span<const std::string_view> body) {
+  std::string key = SerializeKey(fingerprint);
+  std::string prefix(sizeof(RecordHeader), '\0');
+  prefix += key;
+  prefix += SerializeMetadata(metadata);
+  uint64_t body_size = 0;
+  for (std::string_view chunk : body) {
+    body_size += chunk.size();
+  }
+  PutUInt64(prefix, body_size);
+  RecordHeader header{
+      .magic = kRecordMagic,
+      .key_size = static_cast<uint32_t>(key.size()),
+      .size = prefix.size() + body_size,
+      .key_hash = fingerprint.low};
+  if (header.size + kFileHeader.size() > config_.max_size_bytes / 2) {
+    return;
+  }
+  memcpy(prefix.data(), &header, sizeof(header));
+  if (current_->size() + header.size > config_.max_size_bytes / 2) {
+    Rotate();
+  }
+  std::vector<std::string_view> pieces{prefix};
+  pieces.insert(pieces.end(), body.begin(), body.end());
+  current_->Append(header.key_hash, pieces);
+}
+
+void DiskCache::Rotate() {
+  std::string current_path = current_->path();
+  if (rename(current_path.c_str(), previous_->path().c_str()) != 0) {
+    throw RuntimeError(GetErrorMessage("can't rename", current_path));
+  }
+  current_->set_path(previous_->path());
+  auto current = std::make_unique<Log>(std::move(current_path));
+  previous_ = std::move(current_);
+  current_ = std::move(current);
+}
+
+#else
+
+class DiskCache::Log {};
+
+DiskCache::DiskCache(Config config) : config_(std::move(config)) {
+  throw RuntimeError("DiskCache is not supported on this platform");
+}
+
+DiskCache::~DiskCache() = default;
+
+std::optional<DiskCache::Entry> DiskCache::Get(const RequestFingerprint&) {
+  return std::nullopt;
+}
+
+void DiskCache::Put(const RequestFingerprint&, const Metadata&,
+                    std::span<const std::string_view>) {}
+
+void DiskCache::PutLocked(const RequestFingerprint&, const Metadata&,
+                          std::span<const std::string_view>) {}
+
+void DiskCache::Rotate() {}
+
+#endif
+
+}  // namespace coro::http
@@ -0,0 +1,74 @@
+#ifndef CORO_HTTP_DISK_CACHE_H
+#define CORO_HTTP_DISK_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/util/file_slice.h"
+
+namespace coro::http {
+
+// Persistent store of HTTP responses, keyed by request fingerprint.
+//
+// Responses are appended to the current of two log files. Once it would grow
+// past half of `max_size_bytes`, the previous log is dropped and the current
+// one takes its place, so the total size stays bounded while recently written
+// and recently read entries survive. A log is indexed on first use, and hits
+// are served from a read-only mapping of the log file without copying. Its
+// methods block on disk I/O and may be called from any thread.
+class DiskCache {
+ public:
+  struct Config {
+    std::string directory;
+    size_t max_size_bytes = 256 * 1024 * 1024;
+  };
+
+  struct Metadata {
+    int status;
+    std::vector<std::pair<std::string, std::string>> headers;
+    int64_t timestamp;
+    int64_t max_age_ms;
+    int64_t stale_while_revalidate_ms;
+  };
+
+  struct Entry {
+    Metadata metadata;
+    // Points into `mapping`, which keeps it valid.
+    std::string_view body;
+    std::shared_ptr<const void> mapping;
+    // The same bytes in the log file, which it keeps open.
+    util::FileSlice file_body;
+  };
+
+  explicit DiskCache(Config config);
+  DiskCache(const DiskCache&) = delete;
+  DiskCache& operator=(const DiskCache&) = delete;
+  ~DiskCache();
+
+  std::optional<Entry> Get(const RequestFingerprint& key);
+  void Put(const RequestFingerprint& key, const Metadata& metadata,
+           std::span<const std::string_view> body);
+
+ private:
+  class Log;
+
+  void PutLocked(const RequestFingerprint& key, const Metadata& metadata,
+                 std::span<const std::string_view> body);
+  void Rotate();
+
+  Config config_;
+  std::mutex mutex_;
+  std::unique_ptr<Log> current_;
+  std::unique_ptr<Log> previous_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_DISK_CACHE_H
@@ -0,0 +1,139 @@
+#include "coro/http/hedged_http.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "coro/generator.h"
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::http {
+
+namespace {
+
+using ::coro::util::MakeStopTokenOr;
+using ::coro::util::MakeUniqueStopTokenOr;
+using ::coro::util::StopTokenOr;
+
+Request<> CopyRequest(const Request<>& request) {
+  return Request<>{.url = request.url,
+                   .method = request.method,
+                   .headers = request.headers,
+                   .body = std::nullopt,
+                   .invalidates_cache = request.invalidates_cache,
+                   .timeouts = request.timeouts};
+}
+
+// Yields `body`, keeping the owner alive until the body is done.
+Generator<util::BufferSlice> HoldWhileReading(
+    std::shared_ptr<const void> /*owner*/, Generator<util::BufferSlice> body) {
+  FOR_CO_AWAIT(util::BufferSlice & chunk, body) { co_yield std::move(chunk); }
+}
+
+}  // namespace
+
+struct HedgedHttp::Race {
+  Promise<Response<>> result;
+  std::array<stdx::stop_source, 2> attempt_stop_sources;
+  // Outlive the attempts, since the winner's body is read with its token.
+  std::array<std::unique_ptr<StopTokenOr<2>>, 2> attempt_stop_tokens;
+  stdx::stop_source hedge_stop_source;
+  int running_attempt_count = 0;
+  bool done = false;
+
+  // Cancels everything but the `winner` attempt, -1 if there's none, before
+  // handing out the result, so that a losing attempt doesn't keep going
+  // while the caller consumes it.
+  void Finish(int winner) {
+    done = true;
+    hedge_stop_source.request_stop();
+    for (int i = 0; i < static_cast<int>(attempt_stop_sources.size()); i++) {
+      if (i != winner) {
+        attempt_stop_sources[i].request_stop();
+      }
+    }
+  }
+};
+
+Task<Response<>> HedgedHttp::Fetch(Request<> request,
+                                   stdx::stop_token stop_token) const {
+  stats_.request_count++;
+  if (request.body || request.invalidates_cache) {
+    co_return co_await http_->Fetch(std::move(request), std::move(stop_token));
+  }
+  auto race = std::make_shared<Race>();
+  race->running_attempt_count = 1;
+  RunTask(Attempt(race, CopyRequest(request), 0, stop_token));
+  if (!race->done) {
+    auto hedge_stop_token =
+        MakeStopTokenOr(stop_token, race->hedge_stop_source.get_token());
+    bool hedge = true;
+    try {
+      co_await event_loop_->Wait(static_cast<int>(GetHedgeDelay().count()),
+                                 hedge_stop_token.GetToken());
+    } catch (const InterruptedException&) {
+      hedge = false;
+    }
+    if (hedge && !race->done) {
+      race->running_attempt_count++;
+      stats_.hedged_request_count++;
+      RunTask(Attempt(race, std::move(request), 1, stop_token));
+    }
+  }
+  co_return co_await race->result;
+}
+
+Task<> HedgedHttp::Attempt(std::shared_ptr<Race> race, Request<> request,
+                           int index, stdx::stop_token stop_token) const {
+  race->attempt_stop_tokens[index] = MakeUniqueStopTokenOr(
+      std::move(stop_token), race->attempt_stop_sources[index].get_token());
+  auto start = std::chrono::steady_clock::now();
+  try {
+    auto response = co_await http_->Fetch(
+        std::move(request), race->attempt_stop_tokens[index]->GetToken());
+    race->running_attempt_count--;
+    if (!race->done) {
+      RecordLatency(std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start));
+      if (index == 1) {
+        stats_.hedge_won_count++;
+      }
+      race->Finish(index);
+      response.body = HoldWhileReading(race, std::move(response.body));
+      race->result.SetValue(std::move(response));
+    }
+  } catch (...) {
+    race->running_attempt_count--;
+    if (!race->done && race->running_attempt_count == 0) {
+      race->Finish(/*winner=*/-1);
+      race->result.SetException(std::current_exception());
+    }
+  }
+}
+
+std::chrono::milliseconds HedgedHttp::GetHedgeDelay() const {
+  const coro::util::LatencyHistogram& latency =
+      latency_.count() >= policy_.min_sample_count ? latency_
+                                                   : previous_latency_;
+  if (latency.count() < policy_.min_sample_count) {
+    return policy_.initial_delay;
+  }
+  auto delay = std::chrono::ceil<std::chrono::milliseconds>(
+      latency.GetPercentile(policy_.percentile));
+  return std::clamp(delay, policy_.min_delay, policy_.max_delay);
+}
+
+void HedgedHttp::RecordLatency(std::chrono::microseconds latency) const {
+  if (latency_.count() >= policy_.window_size) {
+    previous_latency_ = std::exchange(latency_, {});
+  }
+  latency_.Add(latency);
+}
+
+}  // namespace coro::http
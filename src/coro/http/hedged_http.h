@@ -0,0 +1,75 @@
+#ifndef CORO_HTTP_HEDGED_HTTP_H
+#define CORO_HTTP_HEDGED_HTTP_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "coro/http/http.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/latency_histogram.h"
+
+namespace coro::http {
+
+struct HedgingPolicy {
+  // Percentile of the times to response headers after which a request still
+  // waiting for them is sent again.
+  double percentile = 95;
+  // Delay of the duplicate until `min_sample_count` responses were seen.
+  std::chrono::milliseconds initial_delay{100};
+  // Bounds on the delay derived from the percentile.
+  std::chrono::milliseconds min_delay{5};
+  std::chrono::milliseconds max_delay{1000};
+  uint64_t min_sample_count = 20;
+  // Latencies are tracked over windows of this many responses, so that the
+  // delay follows changes of the servers' latency.
+  uint64_t window_size = 1000;
+};
+
+// Sends a duplicate of a request which hasn't received response headers
+// within the policy's percentile of latency, and returns whichever response
+// comes first, cancelling the other request. Requests with a body or with
+// `invalidates_cache` set are never duplicated. A failed attempt ends the
+// Fetch only once no other attempt is running.
+//
+// Has to be used on the event loop's thread.
+class HedgedHttp {
+ public:
+  struct Stats {
+    uint64_t request_count = 0;
+    uint64_t hedged_request_count = 0;
+    // Hedged requests which were answered first by the duplicate.
+    uint64_t hedge_won_count = 0;
+  };
+
+  HedgedHttp(const Http* http, const coro::util::EventLoop* event_loop,
+             HedgingPolicy policy = {})
+      : http_(http), event_loop_(event_loop), policy_(policy) {}
+
+  HedgedHttp(const HedgedHttp&) = delete;
+  HedgedHttp& operator=(const HedgedHttp&) = delete;
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
+
+  const Stats& stats() const { return stats_; }
+
+  // Delay after which the next request would be duplicated.
+  std::chrono::milliseconds GetHedgeDelay() const;
+
+ private:
+  struct Race;
+
+  Task<> Attempt(std::shared_ptr<Race> race, Request<> request, int index,
+                 stdx::stop_token stop_token) const;
+  void RecordLatency(std::chrono::microseconds latency) const;
+
+  const Http* http_;
+  const coro::util::EventLoop* event_loop_;
+  HedgingPolicy policy_;
+  mutable Stats stats_;
+  mutable coro::util::LatencyHistogram latency_;
+  mutable coro::util::LatencyHistogram previous_latency_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HEDGED_HTTP_H
@@ -1,9 +1,82 @@
 #include "coro/http/http.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
 #include "coro/http/http_exception.h"
 
 namespace coro::http {
 
+namespace {
+
+uint64_t Load64(const char* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint64_t FinalMix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+// MurmurHash3_x64_128 of `data`, seeded with both halves of `seed`, so that
+// chaining calls hashes a sequence of fields with their boundaries.
+RequestFingerprint Hash(std::string_view data, RequestFingerprint seed) {
+  constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+  constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+  auto mix_k1 = [&](uint64_t k1) {
+    k1 *= c1;
+    k1 = std::rotl(k1, 31);
+    return k1 * c2;
+  };
+  auto mix_k2 = [&](uint64_t k2) {
+    k2 *= c2;
+    k2 = std::rotl(k2, 33);
+    return k2 * c1;
+  };
+  uint64_t h1 = seed.low;
+  uint64_t h2 = seed.high;
+  size_t block_count = data.size() / 16;
+  for (size_t i = 0; i < block_count; i++) {
+    h1 ^= mix_k1(Load64(data.data() + i * 16));
+    h1 = std::rotl(h1, 27) + h2;
+    h1 = h1 * 5 + 0x52dce729;
+    h2 ^= mix_k2(Load64(data.data() + i * 16 + 8));
+    h2 = std::rotl(h2, 31) + h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+  std::string_view tail = data.substr(block_count * 16);
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  for (size_t i = 0; i < tail.size(); i++) {
+    (i < 8 ? k1 : k2) |= uint64_t(static_cast<uint8_t>(tail[i]))
+                         << (i % 8 * 8);
+  }
+  if (tail.size() > 8) {
+    h2 ^= mix_k2(k2);
+  }
+  if (!tail.empty()) {
+    h1 ^= mix_k1(k1);
+  }
+  h1 ^= data.size();
+  h2 ^= data.size();
+  h1 += h2;
+  h2 += h1;
+  h1 = FinalMix(h1);
+  h2 = FinalMix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {.low = h1, .high = h2};
+}
+
+}  // namespace
+
 std::string_view MethodToString(Method method) {
   switch (method) {
     case Method::kGet:
@@ -35,37 +108,56 @@ std::string_view MethodToString(Method method) {
   }
 }
 
-Task<std::string> GetBody(Generator<std::string> body) {
+Task<std::string> GetBody(Generator<util::BufferSlice> body) {
   std::string result;
-  FOR_CO_AWAIT(std::string & piece, body) {
-    result += std::move(piece);
+  FOR_CO_AWAIT(const util::BufferSlice& piece, body) {
+    result += std::string_view(piece);
     if (result.size() > 10 * 1024 * 1024) {
       throw HttpException(HttpException::kBadRequest, "body too large");
     }
   }
   co_return result;
 }
-Generator<std::string> CreateBody(std::string body) {
+Generator<util::BufferSlice> CreateBody(std::string body) {
   co_yield std::move(body);
 }
 
+RequestFingerprint GetFingerprint(const Request<std::string>& request) {
+  RequestFingerprint fingerprint = Hash(MethodToString(request.method), {});
+  std::string_view url = request.url;
+  url = url.substr(0, url.find('#'));
+  size_t scheme_end = url.find("://");
+  size_t origin_end = std::min(
+      url.find_first_of("/?", scheme_end == std::string_view::npos
+                                  ? 0
+                                  : scheme_end + 3),
+      url.size());
+  fingerprint =
+      Hash(ToLowerCase(std::string(url.substr(0, origin_end))), fingerprint);
+  fingerprint = Hash(url.substr(origin_end), fingerprint);
+  // Summing the headers' hashes makes their order irrelevant.
+  uint64_t headers[2] = {request.headers.size(), 0};
+  for (const auto& [name, value] : request.headers) {
+    RequestFingerprint header = Hash(value, Hash(ToLowerCase(name), {}));
+    headers[0] += header.low;
+    headers[1] += header.high;
+  }
+  fingerprint = Hash(
+      std::string_view(reinterpret_cast<const char*>(headers), sizeof(headers)),
+      fingerprint);
+  if (request.body) {
+    fingerprint = Hash(*request.body, Hash("body", fingerprint));
+  }
+  return fingerprint;
+}
+
 }  // namespace coro::http
 
 namespace std {
 
-namespace {
-
-size_t CombineHash(size_t lhs, size_t rhs) {
-  lhs ^= rhs + 0x9e3779b9 + (lhs << 6) + (lhs >> 2);
-  return lhs;
-}
-
-}  // namespace
-
 size_t hash<coro::http::Request<std::string>>::operator()(
     const coro::http::Request<std::string>& r) const {
-  return CombineHash(std::hash<std::string>{}(r.url),
-                     std::hash<std::optional<std::string>>{}(r.body));
+  return static_cast<size_t>(coro::http::GetFingerprint(r).low);
 }
 
-}  // namespace std
\ No newline at end of file
+}  // namespace std
\ No newline at end of file
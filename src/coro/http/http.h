@@ -1,6 +1,8 @@
 #ifndef CORO_HTTP_HTTP_H
 #define CORO_HTTP_HTTP_H
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -14,6 +16,9 @@
 #include "coro/stdx/any_invocable.h"
 #include "coro/stdx/coroutine.h"
 #include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/buffer_slice.h"
+#include "coro/util/file_slice.h"
 
 namespace coro::http {
 
@@ -34,11 +39,30 @@ enum class Method {
 
 std::string_view MethodToString(Method method);
 
-Task<std::string> GetBody(Generator<std::string> body);
+class WebSocket;
 
-Generator<std::string> CreateBody(std::string body);
+// Serves an upgraded connection, see AcceptWebSocket.
+using WebSocketHandler =
+    stdx::any_invocable<Task<>(WebSocket&, stdx::stop_token)>;
 
-template <typename BodyGenerator = Generator<std::string>>
+Task<std::string> GetBody(Generator<util::BufferSlice> body);
+
+Generator<util::BufferSlice> CreateBody(std::string body);
+
+// Limits on the phases of a request, each measured from the start of the
+// Fetch. An exceeded limit fails the request with an HttpException, also when
+// the response body is being read already in case of `total`.
+struct RequestTimeouts {
+  // Until the connection is established, including name lookup and the TLS
+  // handshake. Unused if an existing connection is reused.
+  std::optional<std::chrono::milliseconds> connect;
+  // Until the first byte of the response arrives.
+  std::optional<std::chrono::milliseconds> first_byte;
+  // Until the whole response is received.
+  std::optional<std::chrono::milliseconds> total;
+};
+
+template <typename BodyGenerator = Generator<util::BufferSlice>>
 struct Request {
   std::string url;
   Method method = Method::kGet;
@@ -59,6 +83,8 @@ struct Request {
         return false;
     }
   }();
+  // Not part of the request's identity, e.g. as a cache key.
+  RequestTimeouts timeouts = {};
 
   friend bool operator==(const Request& r1, const Request& r2) {
     return std::tie(r1.url, r1.method, r1.headers, r1.body) ==
@@ -67,13 +93,33 @@ struct Request {
 };
 
 template <GeneratorLike<std::string_view> HttpBodyGenerator =
-              Generator<std::string>>
+              Generator<util::BufferSlice>>
 struct Response {
   int status = -1;
   std::vector<std::pair<std::string, std::string>> headers;
   HttpBodyGenerator body;
+  // Sent by the HTTP server instead of `body`, straight from the file. Sets
+  // Content-Length unless the headers have it already. Clients ignore it.
+  std::optional<util::FileSlice> file_body = std::nullopt;
+  // Set by AcceptWebSocket. The HTTP/1.1 server hands the connection over to
+  // it once the response head is sent. Clients ignore it.
+  WebSocketHandler websocket_handler = nullptr;
 };
 
+// 128-bit hash identifying a request in caches: its method, its URL with the
+// scheme and host lowercased and without the fragment, its headers regardless
+// of their order and the case of their names, and its body. Timeouts and
+// `invalidates_cache` aren't covered.
+struct RequestFingerprint {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  friend bool operator==(const RequestFingerprint&,
+                         const RequestFingerprint&) = default;
+};
+
+RequestFingerprint GetFingerprint(const Request<std::string>& request);
+
 class Http {
  public:
   template <typename HttpClientT>
@@ -83,6 +129,14 @@ class Http {
           return d.Fetch(std::move(request), std::move(stop_token));
         }) {}
 
+  // Doesn't take ownership of `client`, e.g. a CacheHttp, which has to
+  // outlive the Http. Lets clients wrapping an Http be stacked.
+  template <typename HttpClientT>
+  explicit Http(HttpClientT* client)
+      : impl_([client](Request<> request, stdx::stop_token stop_token) {
+          return client->Fetch(std::move(request), std::move(stop_token));
+        }) {}
+
   auto Fetch(Request<> request,
              stdx::stop_token stop_token = stdx::stop_token()) const {
     return impl_(std::move(request), std::move(stop_token));
@@ -91,7 +145,7 @@ class Http {
   auto Fetch(Request<std::string> request,
              stdx::stop_token stop_token = stdx::stop_token()) const {
     auto headers = std::move(request.headers);
-    if (request.body && !GetHeader(headers, "Content-Length")) {
+    if (request.body && !FindHeader(headers, "Content-Length")) {
       headers.emplace_back("Content-Length",
                            std::to_string(request.body->length()));
     }
@@ -101,7 +155,8 @@ class Http {
                            .body = request.body ? std::make_optional(CreateBody(
                                                       std::move(*request.body)))
                                                 : std::nullopt,
-                           .invalidates_cache = request.invalidates_cache},
+                           .invalidates_cache = request.invalidates_cache,
+                           .timeouts = request.timeouts},
                  std::move(stop_token));
   }
 
@@ -133,6 +188,13 @@ template <>
 struct hash<coro::http::Request<std::string>> {
   size_t operator()(const coro::http::Request<std::string>& r) const;
 };
+
+template <>
+struct hash<coro::http::RequestFingerprint> {
+  size_t operator()(const coro::http::RequestFingerprint& f) const {
+    return static_cast<size_t>(f.low);
+  }
+};
 }  // namespace std
 
 #endif  // CORO_HTTP_HTTP_H
@@ -0,0 +1,771 @@
+#include "coro/http/http2_server.h"
+
+#include <nghttp2/nghttp2.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/http/admission_controller.h"
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/file_slice.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro::http {
+
+namespace {
+
+using ::coro::util::FileSlice;
+using ::coro::util::TcpRequestDataProvider;
+using ::coro::util::TcpResponseChunk;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view kConnectionPreface =
+    "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr size_t kMaxHeaderSize = 16384;
+// Frames are handed to the connection in chunks of at most this many bytes, so
+// that the write high watermark of TcpServer still throttles the session.
+constexpr size_t kMaxOutputChunkSize = 64 * 1024;
+
+struct SessionDeleter {
+  void operator()(nghttp2_session* session) const noexcept {
+    nghttp2_session_del(session);
+  }
+};
+
+struct SessionCallbacksDeleter {
+  void operator()(nghttp2_session_callbacks* callbacks) const noexcept {
+    nghttp2_session_callbacks_del(callbacks);
+  }
+};
+
+struct OptionDeleter {
+  void operator()(nghttp2_option* option) const noexcept {
+    nghttp2_option_del(option);
+  }
+};
+
+void Check(int code) {
+  if (code != 0) {
+    throw RuntimeError(std::string("nghttp2 error: ") + nghttp2_strerror(code));
+  }
+}
+
+struct Http2Stream {
+  int32_t id;
+  int connection_request_index;
+  std::string method;
+  std::string path;
+  std::string authority;
+  std::vector<std::pair<std::string, std::string>> headers;
+  size_t header_size = 0;
+  // Request body chunks received but not read by the handler yet. Their bytes
+  // are handed back to the flow-control window once the handler reads them.
+  std::deque<std::string> request_body;
+  bool request_body_done = false;
+  // Set once the response is complete; request body bytes which still arrive
+  // are dropped.
+  bool discard_request_body = false;
+  Promise<void> request_body_ready;
+  // Response body bytes waiting for the flow-control window.
+  std::deque<util::BufferSlice> response_body;
+  size_t response_body_offset = 0;
+  size_t buffered_response_size = 0;
+  std::optional<FileSlice> response_file;
+  bool response_submitted = false;
+  bool response_done = false;
+  // Set while nghttp2 waits for nghttp2_session_resume_data.
+  bool response_deferred = false;
+  Promise<void> response_drained;
+  bool closed = false;
+  // Cancels the handler once the stream is closed or the connection is done.
+  stdx::stop_source stop_source;
+  Clock::time_point start;
+  Clock::time_point head_parsed;
+  Clock::time_point response_started;
+  int status = -1;
+  uint64_t bytes_received = 0;
+  uint64_t bytes_sent = 0;
+};
+
+struct Http2Connection {
+  Http2Connection(TcpRequestDataProvider provider, HttpHandler* handler,
+                  HttpServerMetrics* metrics, AdmissionController* admission,
+                  Http2Config config)
+      : provider(std::move(provider)),
+        handler(handler),
+        metrics(metrics),
+        admission(admission),
+        config(config) {}
+
+  std::unique_ptr<nghttp2_session, SessionDeleter> session;
+  TcpRequestDataProvider provider;
+  HttpHandler* handler;
+  HttpServerMetrics* metrics;
+  AdmissionController* admission;
+  Http2Config config;
+  std::unordered_map<int32_t, std::shared_ptr<Http2Stream>> streams;
+  int stream_count = 0;
+  // Filled in by the nghttp2 callbacks, which mustn't resume coroutines while
+  // nghttp2 is on the stack, and handled by ProcessEvents once it returns.
+  std::vector<std::shared_ptr<Http2Stream>> started_streams;
+  std::vector<std::shared_ptr<Http2Stream>> updated_streams;
+  // Set once reading frames failed; the connection is closed once the frames
+  // queued before are sent.
+  std::exception_ptr exception;
+  Promise<void> output_ready;
+  // Cancels the streams once the connection is done.
+  stdx::stop_source stop_source;
+};
+
+Task<> Wait(Promise<void>& event, const stdx::stop_token& stop_token) {
+  if (stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  co_await event;
+  event = Promise<void>();
+}
+
+std::string_view ToStringView(const uint8_t* data, size_t size) {
+  return std::string_view(reinterpret_cast<const char*>(data), size);
+}
+
+Http2Stream* FindStream(Http2Connection* connection, int32_t stream_id) {
+  auto it = connection->streams.find(stream_id);
+  return it == connection->streams.end() ? nullptr : it->second.get();
+}
+
+int OnBeginHeaders(nghttp2_session*, const nghttp2_frame* frame,
+                   void* user_data) {
+  if (frame->hd.type != NGHTTP2_HEADERS ||
+      frame->headers.cat != NGHTTP2_HCAT_REQUEST) {
+    return 0;
+  }
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  auto stream = std::make_shared<Http2Stream>();
+  stream->id = frame->hd.stream_id;
+  stream->connection_request_index = connection->stream_count++;
+  if (connection->metrics) {
+    stream->start = Clock::now();
+  }
+  connection->streams.emplace(stream->id, std::move(stream));
+  return 0;
+}
+
+int OnHeader(nghttp2_session*, const nghttp2_frame* frame,
+             const uint8_t* name_data, size_t name_size,
+             const uint8_t* value_data, size_t value_size, uint8_t /*flags*/,
+             void* user_data) {
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  Http2Stream* stream = FindStream(connection, frame->hd.stream_id);
+  // Trailers are dropped.
+  if (stream == nullptr || frame->headers.cat != NGHTTP2_HCAT_REQUEST) {
+    return 0;
+  }
+  stream->header_size += name_size + value_size;
+  if (stream->header_size > kMaxHeaderSize) {
+    return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+  }
+  std::string_view name = ToStringView(name_data, name_size);
+  std::string_view value = ToStringView(value_data, value_size);
+  if (name == ":method") {
+    stream->method = value;
+  } else if (name == ":path") {
+    stream->path = value;
+  } else if (name == ":authority") {
+    stream->authority = value;
+  } else if (name.starts_with(':')) {
+    return 0;
+  } else if (name == "cookie") {
+    // Clients may split the Cookie header into several fields, while handlers
+    // expect a single one.
+    auto it = std::find_if(
+        stream->headers.begin(), stream->headers.end(),
+        [](const auto& header) { return header.first == "cookie"; });
+    if (it == stream->headers.end()) {
+      stream->headers.emplace_back(name, value);
+    } else {
+      it->second += "; ";
+      it->second += value;
+    }
+  } else {
+    stream->headers.emplace_back(name, value);
+  }
+  return 0;
+}
+
+int OnFrameRecv(nghttp2_session*, const nghttp2_frame* frame,
+                void* user_data) {
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  auto it = connection->streams.find(frame->hd.stream_id);
+  if (it == connection->streams.end()) {
+    return 0;
+  }
+  const std::shared_ptr<Http2Stream>& stream = it->second;
+  if (frame->hd.type == NGHTTP2_HEADERS &&
+      frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+    if (!stream->authority.empty() && !FindHeader(stream->headers, "host")) {
+      stream->headers.emplace_back("host", stream->authority);
+    }
+    if (connection->metrics) {
+      stream->head_parsed = Clock::now();
+    }
+    connection->started_streams.push_back(stream);
+  }
+  if ((frame->hd.type == NGHTTP2_HEADERS || frame->hd.type == NGHTTP2_DATA) &&
+      (frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+    stream->request_body_done = true;
+    connection->updated_streams.push_back(stream);
+  }
+  return 0;
+}
+
+int OnDataChunkRecv(nghttp2_session* session, uint8_t /*flags*/,
+                    int32_t stream_id, const uint8_t* data, size_t size,
+                    void* user_data) {
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  auto it = connection->streams.find(stream_id);
+  if (it == connection->streams.end() || it->second->discard_request_body) {
+    nghttp2_session_consume(session, stream_id, size);
+    return 0;
+  }
+  const std::shared_ptr<Http2Stream>& stream = it->second;
+  stream->request_body.emplace_back(ToStringView(data, size));
+  stream->bytes_received += size;
+  connection->updated_streams.push_back(stream);
+  return 0;
+}
+
+int OnStreamClose(nghttp2_session* session, int32_t stream_id,
+                  uint32_t /*error_code*/, void* user_data) {
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  auto it = connection->streams.find(stream_id);
+  if (it == connection->streams.end()) {
+    return 0;
+  }
+  std::shared_ptr<Http2Stream> stream = std::move(it->second);
+  connection->streams.erase(it);
+  // Request body bytes nobody is going to read still count against the
+  // connection's flow-control window.
+  size_t unread_size = 0;
+  for (const std::string& chunk : stream->request_body) {
+    unread_size += chunk.size();
+  }
+  stream->request_body.clear();
+  if (unread_size > 0) {
+    nghttp2_session_consume_connection(session, unread_size);
+  }
+  stream->closed = true;
+  connection->updated_streams.push_back(std::move(stream));
+  return 0;
+}
+
+int64_t ReadFile(const FileSlice& file, uint8_t* buffer, size_t size) {
+#ifdef _WIN32
+  if (_lseeki64(file.fd(), static_cast<int64_t>(file.offset()), SEEK_SET) <
+      0) {
+    return -1;
+  }
+  return _read(file.fd(), buffer, static_cast<unsigned int>(size));
+#else
+  return pread(file.fd(), buffer, size, static_cast<off_t>(file.offset()));
+#endif
+}
+
+ssize_t ReadResponseData(nghttp2_session*, int32_t stream_id, uint8_t* buffer,
+                         size_t length, uint32_t* data_flags,
+                         nghttp2_data_source* source, void* user_data) {
+  auto* connection = static_cast<Http2Connection*>(user_data);
+  auto* stream = static_cast<Http2Stream*>(source->ptr);
+  if (stream->response_file) {
+    FileSlice& file = *stream->response_file;
+    int64_t size = ReadFile(
+        file, buffer, static_cast<size_t>(std::min<uint64_t>(length,
+                                                             file.size())));
+    if (size <= 0 && !file.empty()) {
+      return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+    file = file.Subslice(static_cast<uint64_t>(size));
+    stream->bytes_sent += static_cast<uint64_t>(size);
+    if (file.empty()) {
+      *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return static_cast<ssize_t>(size);
+  }
+  size_t size = 0;
+  while (size < length && !stream->response_body.empty()) {
+    const util::BufferSlice& chunk = stream->response_body.front();
+    size_t piece_size =
+        std::min(length - size, chunk.size() - stream->response_body_offset);
+    std::memcpy(buffer + size, chunk.data() + stream->response_body_offset,
+                piece_size);
+    size += piece_size;
+    stream->response_body_offset += piece_size;
+    if (stream->response_body_offset == chunk.size()) {
+      stream->response_body.pop_front();
+      stream->response_body_offset = 0;
+    }
+  }
+  stream->buffered_response_size -= size;
+  stream->bytes_sent += size;
+  if (size > 0) {
+    connection->updated_streams.push_back(connection->streams.at(stream_id));
+  }
+  if (stream->response_body.empty() && stream->response_done) {
+    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+  } else if (size == 0) {
+    stream->response_deferred = true;
+    return NGHTTP2_ERR_DEFERRED;
+  }
+  return static_cast<ssize_t>(size);
+}
+
+void CreateSession(Http2Connection* connection) {
+  nghttp2_session_callbacks* callbacks_ptr;
+  Check(nghttp2_session_callbacks_new(&callbacks_ptr));
+  std::unique_ptr<nghttp2_session_callbacks, SessionCallbacksDeleter>
+      callbacks(callbacks_ptr);
+  nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks.get(),
+                                                          OnBeginHeaders);
+  nghttp2_session_callbacks_set_on_header_callback(callbacks.get(), OnHeader);
+  nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks.get(),
+                                                       OnFrameRecv);
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks.get(),
+                                                            OnDataChunkRecv);
+  nghttp2_session_callbacks_set_on_stream_close_callback(callbacks.get(),
+                                                         OnStreamClose);
+
+  nghttp2_option* option_ptr;
+  Check(nghttp2_option_new(&option_ptr));
+  std::unique_ptr<nghttp2_option, OptionDeleter> option(option_ptr);
+  nghttp2_option_set_no_auto_window_update(option.get(), 1);
+
+  nghttp2_session* session;
+  Check(nghttp2_session_server_new2(&session, callbacks.get(), connection,
+                                    option.get()));
+  connection->session.reset(session);
+
+  const Http2Config& config = connection->config;
+  nghttp2_settings_entry settings[] = {
+      {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, config.max_concurrent_streams},
+      {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, config.stream_window_size}};
+  Check(nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, settings,
+                                std::size(settings)));
+  Check(nghttp2_session_set_local_window_size(
+      session, NGHTTP2_FLAG_NONE, /*stream_id=*/0,
+      static_cast<int32_t>(config.connection_window_size)));
+}
+
+void FinishRequest(HttpServerMetrics* metrics, const Http2Stream& stream) {
+  auto get_duration = [&](Clock::time_point end) {
+    if (end == Clock::time_point()) {
+      return std::chrono::microseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                 stream.start);
+  };
+  Method method = Method::kGet;
+  try {
+    method = ToMethod(stream.method);
+  } catch (const HttpException&) {
+  }
+  metrics->OnRequestFinished(HttpRequestStats{
+      .url = stream.path,
+      .method = method,
+      .status = stream.status,
+      .head_parse = get_duration(stream.head_parsed),
+      .time_to_first_byte = get_duration(stream.response_started),
+      .total = get_duration(Clock::now()),
+      .bytes_received = stream.bytes_received,
+      .bytes_sent = stream.bytes_sent,
+      .connection_request_index = stream.connection_request_index});
+}
+
+// HTTP/2 forbids connection-specific header fields.
+bool IsConnectionSpecificHeader(std::string_view name) {
+  for (std::string_view header : {"connection", "keep-alive",
+                                  "proxy-connection", "transfer-encoding",
+                                  "upgrade"}) {
+    if (name == header) {
+      return true;
+    }
+  }
+  return false;
+}
+
+nghttp2_nv ToNameValue(std::string_view name, std::string_view value) {
+  return nghttp2_nv{
+      .name = reinterpret_cast<uint8_t*>(const_cast<char*>(name.data())),
+      .value = reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+      .namelen = name.size(),
+      .valuelen = value.size(),
+      .flags = NGHTTP2_NV_FLAG_NONE};
+}
+
+void SubmitResponse(Http2Connection& connection, Http2Stream& stream,
+                    int status,
+                    std::span<const std::pair<std::string, std::string>>
+                        response_headers,
+                    bool has_body) {
+  std::string status_value = std::to_string(status);
+  std::vector<std::pair<std::string, std::string_view>> headers;
+  headers.reserve(response_headers.size());
+  for (const auto& [name, value] : response_headers) {
+    std::string lowercase_name = ToLowerCase(name);
+    if (!IsConnectionSpecificHeader(lowercase_name)) {
+      headers.emplace_back(std::move(lowercase_name), value);
+    }
+  }
+  std::vector<nghttp2_nv> name_values;
+  name_values.reserve(headers.size() + 1);
+  name_values.push_back(ToNameValue(":status", status_value));
+  for (const auto& [name, value] : headers) {
+    name_values.push_back(ToNameValue(name, value));
+  }
+  nghttp2_data_provider data_provider;
+  data_provider.source.ptr = &stream;
+  data_provider.read_callback = ReadResponseData;
+  Check(nghttp2_submit_response(connection.session.get(), stream.id,
+                                name_values.data(), name_values.size(),
+                                has_body ? &data_provider : nullptr));
+  stream.response_submitted = true;
+  stream.status = status;
+  if (connection.metrics) {
+    stream.response_started = Clock::now();
+  }
+  connection.output_ready.SetValue();
+}
+
+void ResumeResponse(Http2Connection& connection, Http2Stream& stream) {
+  if (stream.response_deferred && !stream.closed) {
+    stream.response_deferred = false;
+    Check(nghttp2_session_resume_data(connection.session.get(), stream.id));
+  }
+  connection.output_ready.SetValue();
+}
+
+void SubmitErrorResponse(Http2Connection& connection, Http2Stream& stream,
+                         std::exception_ptr exception) {
+  int status = 500;
+  std::string message;
+  try {
+    std::rethrow_exception(exception);
+  } catch (const HttpException& e) {
+    if (e.status() >= 100 && e.status() < 600) {
+      status = e.status();
+    }
+    message = e.what();
+  } catch (const std::exception& e) {
+    message = e.what();
+  } catch (...) {
+    message = "unknown error";
+  }
+  message += '\n';
+  std::vector<std::pair<std::string, std::string>> headers{
+      {"content-length", std::to_string(message.size())}};
+  bool has_body = stream.method != "HEAD";
+  if (has_body) {
+    stream.buffered_response_size = message.size();
+    stream.response_body.push_back(std::move(message));
+  }
+  stream.response_done = true;
+  SubmitResponse(connection, stream, status, headers, has_body);
+}
+
+// Once the response is complete, the rest of the request body is dropped as
+// it arrives so that the client isn't stalled by a closed window.
+void DiscardRequestBody(Http2Connection& connection, Http2Stream& stream) {
+  stream.discard_request_body = true;
+  for (const std::string& chunk : stream.request_body) {
+    nghttp2_session_consume(connection.session.get(), stream.id, chunk.size());
+  }
+  stream.request_body.clear();
+  connection.output_ready.SetValue();
+}
+
+Generator<util::BufferSlice> GetRequestBody(
+    std::shared_ptr<Http2Connection> connection,
+    std::shared_ptr<Http2Stream> stream) {
+  while (true) {
+    while (stream->request_body.empty() && !stream->request_body_done) {
+      co_await Wait(stream->request_body_ready,
+                    stream->stop_source.get_token());
+    }
+    if (stream->request_body.empty()) {
+      co_return;
+    }
+    std::string chunk = std::move(stream->request_body.front());
+    stream->request_body.pop_front();
+    // The client may send as much again only once the handler took this.
+    Check(nghttp2_session_consume(connection->session.get(), stream->id,
+                                  chunk.size()));
+    connection->output_ready.SetValue();
+    co_yield std::move(chunk);
+  }
+}
+
+Task<> SendResponse(std::shared_ptr<Http2Connection> connection,
+                    std::shared_ptr<Http2Stream> stream, Response<> response) {
+  if (stream->closed) {
+    throw InterruptedException();
+  }
+  if (response.file_body && !FindHeader(response.headers, "Content-Length")) {
+    response.headers.emplace_back("content-length",
+                                  std::to_string(response.file_body->size()));
+  }
+  bool has_body = stream->method != "HEAD" && response.status / 100 != 1 &&
+                  response.status != 204 && response.status != 304;
+  if (response.file_body) {
+    stream->response_file = std::move(response.file_body);
+    stream->response_done = true;
+  }
+  SubmitResponse(*connection, *stream, response.status, response.headers,
+                 has_body);
+  if (!has_body || stream->response_file) {
+    co_return;
+  }
+  auto it = co_await response.body.begin();
+  while (it != response.body.end()) {
+    if (stream->closed) {
+      throw InterruptedException();
+    }
+    if (!(*it).empty()) {
+      stream->buffered_response_size += (*it).size();
+      stream->response_body.push_back(std::move(*it));
+      ResumeResponse(*connection, *stream);
+    }
+    // Pulls the body only as fast as the client's window lets it out.
+    while (stream->buffered_response_size >=
+           connection->config.max_buffered_response_bytes) {
+      co_await Wait(stream->response_drained, stream->stop_source.get_token());
+    }
+    co_await ++it;
+  }
+  stream->response_done = true;
+  ResumeResponse(*connection, *stream);
+}
+
+Task<> ServeStream(std::shared_ptr<Http2Connection> connection,
+                   std::shared_ptr<Http2Stream> stream) {
+  AdmissionController* admission = connection->admission;
+  std::string_view client = connection->provider.peer_address();
+  bool admitted = !admission;
+  auto admission_guard = coro::util::AtScopeExit([&] {
+    if (admission && admitted) {
+      admission->Release(client);
+    }
+  });
+  if (admission) {
+    admitted =
+        co_await admission->Admit(client, stream->stop_source.get_token());
+  }
+  if (!admitted) {
+    Response<> response{
+        .status = 503,
+        .headers = {{"retry-after",
+                     std::to_string(admission->retry_after().count())}},
+        .body = CreateBody(std::string())};
+    co_await SendResponse(connection, stream, std::move(response));
+    co_return;
+  }
+  Request<> request{.url = stream->path,
+                    .method = ToMethod(stream->method),
+                    .headers = std::move(stream->headers)};
+  if (!stream->request_body_done || !stream->request_body.empty()) {
+    request.body = GetRequestBody(connection, stream);
+  }
+  auto response = co_await (*connection->handler)(
+      std::move(request), stream->stop_source.get_token());
+  co_await SendResponse(connection, stream, std::move(response));
+}
+
+Task<> HandleStream(std::shared_ptr<Http2Connection> connection,
+                    std::shared_ptr<Http2Stream> stream) {
+  stdx::stop_callback wake_waiters(stream->stop_source.get_token(), [stream] {
+    std::shared_ptr<Http2Stream> s = stream;
+    s->request_body_ready.SetException(InterruptedException());
+    s->response_drained.SetException(InterruptedException());
+  });
+  stdx::stop_callback stop_stream(connection->stop_source.get_token(),
+                                  [stream] {
+                                    std::shared_ptr<Http2Stream> s = stream;
+                                    s->stop_source.request_stop();
+                                  });
+  if (connection->metrics) {
+    connection->metrics->OnRequestStarted();
+  }
+  std::exception_ptr exception;
+  try {
+    co_await ServeStream(connection, stream);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  try {
+    if (exception && !stream->closed) {
+      if (!stream->response_submitted) {
+        SubmitErrorResponse(*connection, *stream, exception);
+      } else {
+        Check(nghttp2_submit_rst_stream(connection->session.get(),
+                                        NGHTTP2_FLAG_NONE, stream->id,
+                                        NGHTTP2_INTERNAL_ERROR));
+        connection->output_ready.SetValue();
+      }
+    }
+    if (!stream->closed) {
+      DiscardRequestBody(*connection, *stream);
+    }
+  } catch (const Exception&) {
+    connection->stop_source.request_stop();
+  }
+  if (connection->metrics) {
+    FinishRequest(connection->metrics, *stream);
+  }
+}
+
+// Resumes the coroutines waiting for what the nghttp2 callbacks recorded.
+void ProcessEvents(const std::shared_ptr<Http2Connection>& connection) {
+  while (!connection->started_streams.empty() ||
+         !connection->updated_streams.empty()) {
+    for (const std::shared_ptr<Http2Stream>& stream :
+         std::exchange(connection->started_streams, {})) {
+      if (!stream->closed) {
+        RunTask(HandleStream(connection, stream));
+      }
+    }
+    for (const std::shared_ptr<Http2Stream>& stream :
+         std::exchange(connection->updated_streams, {})) {
+      if (stream->closed) {
+        stream->stop_source.request_stop();
+      } else {
+        stream->request_body_ready.SetValue();
+        stream->response_drained.SetValue();
+      }
+    }
+  }
+}
+
+std::string SendFrames(Http2Connection& connection) {
+  std::string output;
+  while (output.size() < kMaxOutputChunkSize) {
+    const uint8_t* data;
+    ssize_t size = nghttp2_session_mem_send(connection.session.get(), &data);
+    if (size < 0) {
+      Check(static_cast<int>(size));
+    }
+    if (size == 0) {
+      break;
+    }
+    output += ToStringView(data, static_cast<size_t>(size));
+  }
+  return output;
+}
+
+Task<> ReadFrames(std::shared_ptr<Http2Connection> connection) {
+  try {
+    // Resuming the other coroutines may end the connection, which frees the
+    // data provider.
+    while (!connection->stop_source.get_token().stop_requested()) {
+      std::span<const uint8_t> data = co_await connection->provider.Peek();
+      if (data.empty()) {
+        throw InterruptedException();
+      }
+      ssize_t result = nghttp2_session_mem_recv(connection->session.get(),
+                                                data.data(), data.size());
+      if (result < 0) {
+        Check(static_cast<int>(result));
+      }
+      connection->provider.Consume(static_cast<uint32_t>(data.size()));
+      ProcessEvents(connection);
+      connection->output_ready.SetValue();
+    }
+  } catch (...) {
+    connection->exception = std::current_exception();
+    connection->output_ready.SetValue();
+  }
+}
+
+}  // namespace
+
+Task<bool> IsHttp2Connection(TcpRequestDataProvider& provider) {
+  uint32_t size = 1;
+  while (true) {
+    std::span<const uint8_t> data = co_await provider.Peek(size);
+    size = static_cast<uint32_t>(
+        std::min(data.size(), kConnectionPreface.size()));
+    if (size == 0 ||
+        kConnectionPreface.substr(0, size) != ToStringView(data.data(), size)) {
+      co_return false;
+    }
+    if (size == kConnectionPreface.size()) {
+      co_return true;
+    }
+    size++;
+  }
+}
+
+Generator<TcpResponseChunk> ServeHttp2Connection(
+    HttpHandler* handler, TcpRequestDataProvider provider,
+    stdx::stop_token stop_token, HttpServerMetrics* metrics,
+    AdmissionController* admission, Http2Config config) {
+  auto connection = std::make_shared<Http2Connection>(
+      std::move(provider), handler, metrics, admission, config);
+  CreateSession(connection.get());
+  if (metrics) {
+    metrics->OnConnectionOpened();
+  }
+  auto connection_guard = coro::util::AtScopeExit([metrics] {
+    if (metrics) {
+      metrics->OnConnectionClosed();
+    }
+  });
+  stdx::stop_callback wake_writer(
+      connection->stop_source.get_token(), [connection] {
+        std::shared_ptr<Http2Connection> c = connection;
+        c->output_ready.SetException(InterruptedException());
+      });
+  stdx::stop_callback stop_connection(
+      std::move(stop_token), [&] { connection->stop_source.request_stop(); });
+  auto cancel_guard = coro::util::AtScopeExit(
+      [&] { connection->stop_source.request_stop(); });
+  RunTask(ReadFrames(connection));
+  while (true) {
+    std::string output = SendFrames(*connection);
+    ProcessEvents(connection);
+    if (!output.empty()) {
+      co_yield std::move(output);
+      continue;
+    }
+    if (connection->exception) {
+      std::rethrow_exception(connection->exception);
+    }
+    if (!nghttp2_session_want_read(connection->session.get()) &&
+        !nghttp2_session_want_write(connection->session.get())) {
+      co_return;
+    }
+    co_await Wait(connection->output_ready,
+                  connection->stop_source.get_token());
+  }
+}
+
+}  // namespace coro::http
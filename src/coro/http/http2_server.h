@@ -0,0 +1,32 @@
+#ifndef CORO_HTTP_HTTP2_SERVER_H
+#define CORO_HTTP_HTTP2_SERVER_H
+
+#include "coro/generator.h"
+#include "coro/http/http_server.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::http {
+
+class AdmissionController;
+
+// Returns whether the connection starts with the HTTP/2 client connection
+// preface. Waits only for as many bytes as it takes to tell and consumes none
+// of them.
+Task<bool> IsHttp2Connection(coro::util::TcpRequestDataProvider& provider);
+
+// Serves an HTTP/2 connection whose preface wasn't consumed yet, running
+// `handler` for every stream concurrently. Frames are read in a separate task
+// while the returned generator yields the frames to send; it ends once the
+// session has nothing more to read or write. Streams `admission` sheds are
+// answered with 503. `handler`, and `metrics` and `admission` if not null, have
+// to outlive the connection's streams.
+Generator<coro::util::TcpResponseChunk> ServeHttp2Connection(
+    HttpHandler* handler, coro::util::TcpRequestDataProvider provider,
+    stdx::stop_token stop_token, HttpServerMetrics* metrics,
+    AdmissionController* admission, Http2Config config);
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP2_SERVER_H
@@ -5,8 +5,10 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include "coro/stdx/coroutine.h"
+#include "coro/util/buffer_slice.h"
 
 namespace coro::http {
 
@@ -29,7 +31,10 @@ class HttpBodyGenerator {
           i.http_body_generator_->exception_ptr_) {
         i.offset_ = INT64_MAX;
       }
-      i.data_ = std::move(i.http_body_generator_->data_);
+      // The received bytes are handed over as a slice owning them, so that
+      // they aren't copied again on their way out.
+      i.data_ = util::BufferSlice(
+          std::exchange(i.http_body_generator_->data_, std::string()));
       if (i.http_body_generator_->exception_ptr_) {
         std::rethrow_exception(i.http_body_generator_->exception_ptr_);
       }
@@ -41,20 +46,20 @@ class HttpBodyGenerator {
   class Iterator {
    public:
     Iterator(HttpBodyGenerator* http_body_generator, int64_t offset,
-             std::string data);
+             util::BufferSlice data);
 
     bool operator!=(const Iterator& iterator) const;
     bool operator==(const Iterator& iterator) const;
     Awaitable<Iterator&> operator++();
-    const std::string& operator*() const;
-    std::string& operator*();
+    const util::BufferSlice& operator*() const;
+    util::BufferSlice& operator*();
 
    private:
     template <typename>
     friend struct Awaitable;
     HttpBodyGenerator* http_body_generator_;
     int64_t offset_;
-    std::string data_;
+    util::BufferSlice data_;
   };
 
   Awaitable<Iterator> begin();
@@ -62,6 +67,8 @@ class HttpBodyGenerator {
 
  protected:
   void ReceivedData(std::string_view data);
+  // Takes over `data` without copying it if nothing is buffered yet.
+  void ReceivedData(std::string data);
   void Close(int status);
   void Close(std::exception_ptr);
   auto GetBufferedByteCount() const { return data_.size(); }
@@ -75,7 +82,8 @@ class HttpBodyGenerator {
 
 template <typename Impl>
 HttpBodyGenerator<Impl>::Iterator::Iterator(
-    HttpBodyGenerator* http_body_generator, int64_t offset, std::string data)
+    HttpBodyGenerator* http_body_generator, int64_t offset,
+    util::BufferSlice data)
     : http_body_generator_(http_body_generator),
       offset_(offset),
       data_(std::move(data)) {}
@@ -100,23 +108,24 @@ auto HttpBodyGenerator<Impl>::Iterator::operator++() -> Awaitable<Iterator&> {
 }
 
 template <typename Impl>
-const std::string& HttpBodyGenerator<Impl>::Iterator::operator*() const {
+const util::BufferSlice& HttpBodyGenerator<Impl>::Iterator::operator*()
+    const {
   return data_;
 }
 
 template <typename Impl>
-std::string& HttpBodyGenerator<Impl>::Iterator::operator*() {
+util::BufferSlice& HttpBodyGenerator<Impl>::Iterator::operator*() {
   return data_;
 }
 
 template <typename Impl>
 auto HttpBodyGenerator<Impl>::begin() -> Awaitable<Iterator> {
-  return Awaitable<Iterator>{Iterator(this, 0, "")};
+  return Awaitable<Iterator>{Iterator(this, 0, {})};
 }
 
 template <typename Impl>
 typename HttpBodyGenerator<Impl>::Iterator HttpBodyGenerator<Impl>::end() {
-  return Iterator(this, INT64_MAX, "");
+  return Iterator(this, INT64_MAX, {});
 }
 
 template <typename Impl>
@@ -127,6 +136,18 @@ void HttpBodyGenerator<Impl>::ReceivedData(std::string_view data) {
   }
 }
 
+template <typename Impl>
+void HttpBodyGenerator<Impl>::ReceivedData(std::string data) {
+  if (data_.empty()) {
+    data_ = std::move(data);
+  } else {
+    data_ += data;
+  }
+  if (handle_) {
+    std::exchange(handle_, nullptr).resume();
+  }
+}
+
 template <typename Impl>
 void HttpBodyGenerator<Impl>::Close(int status) {
   status_ = status;
@@ -0,0 +1,405 @@
+#include "coro/http/http_compression.h"
+
+#include <zlib.h>
+
+#ifdef CORO_HTTP_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/http/http_parse.h"
+
+namespace coro::http {
+
+namespace {
+
+class Compressor {
+ public:
+  virtual ~Compressor() = default;
+
+  // Compresses `input` and flushes the output, or ends the stream if
+  // `finish` is set.
+  virtual std::string Compress(std::string_view input, bool finish) = 0;
+};
+
+class GzipCompressor : public Compressor {
+ public:
+  explicit GzipCompressor(int level) {
+    if (deflateInit2(&stream_, level, Z_DEFLATED, /*windowBits=*/15 + 16,
+                     /*memLevel=*/8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      throw RuntimeError("deflateInit2 failed");
+    }
+  }
+
+  GzipCompressor(const GzipCompressor&) = delete;
+  GzipCompressor& operator=(const GzipCompressor&) = delete;
+
+  ~GzipCompressor() override { deflateEnd(&stream_); }
+
+  std::string Compress(std::string_view input, bool finish) override {
+    stream_.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream_.avail_in = static_cast<uInt>(input.size());
+    std::string output;
+    size_t written = 0;
+    int code;
+    do {
+      size_t bound = deflateBound(&stream_, stream_.avail_in);
+      output.resize(written + std::max<size_t>(bound, 64));
+      stream_.next_out = reinterpret_cast<Bytef*>(output.data() + written);
+      stream_.avail_out = static_cast<uInt>(output.size() - written);
+      code = deflate(&stream_, finish ? Z_FINISH : Z_SYNC_FLUSH);
+      if (code == Z_STREAM_ERROR) {
+        throw RuntimeError("deflate failed");
+      }
+      written = output.size() - stream_.avail_out;
+    } while (stream_.avail_out == 0 || (finish && code != Z_STREAM_END));
+    output.resize(written);
+    return output;
+  }
+
+ private:
+  z_stream stream_{};
+};
+
+#ifdef CORO_HTTP_HAVE_BROTLI
+
+class BrotliCompressor : public Compressor {
+ public:
+  explicit BrotliCompressor(int quality)
+      : state_(BrotliEncoderCreateInstance(/*alloc_func=*/nullptr,
+                                           /*free_func=*/nullptr,
+                                           /*opaque=*/nullptr)) {
+    if (state_ == nullptr) {
+      throw RuntimeError("BrotliEncoderCreateInstance failed");
+    }
+    BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY,
+                              static_cast<uint32_t>(quality));
+  }
+
+  BrotliCompressor(const BrotliCompressor&) = delete;
+  BrotliCompressor& operator=(const BrotliCompressor&) = delete;
+
+  ~BrotliCompressor() override { BrotliEncoderDestroyInstance(state_); }
+
+  std::string Compress(std::string_view input, bool finish) override {
+    const auto* next_in = reinterpret_cast<const uint8_t*>(input.data());
+    size_t available_in = input.size();
+    std::string output;
+    while (true) {
+      size_t available_out = 0;
+      if (!BrotliEncoderCompressStream(
+              state_,
+              finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH,
+              &available_in, &next_in, &available_out, /*next_out=*/nullptr,
+              /*total_out=*/nullptr)) {
+        throw RuntimeError("BrotliEncoderCompressStream failed");
+      }
+      size_t size = 0;
+      const uint8_t* data = BrotliEncoderTakeOutput(state_, &size);
+      output.append(reinterpret_cast<const char*>(data), size);
+      if (available_in == 0 && !BrotliEncoderHasMoreOutput(state_) &&
+          (!finish || BrotliEncoderIsFinished(state_))) {
+        return output;
+      }
+    }
+  }
+
+ private:
+  BrotliEncoderState* state_;
+};
+
+#endif
+
+std::unique_ptr<Compressor> CreateCompressor(ContentEncoding encoding,
+                                             const CompressionConfig& config) {
+  switch (encoding) {
+    case ContentEncoding::kIdentity:
+      return nullptr;
+    case ContentEncoding::kGzip:
+      return std::make_unique<GzipCompressor>(config.gzip_level);
+    case ContentEncoding::kBrotli:
+#ifdef CORO_HTTP_HAVE_BROTLI
+      return std::make_unique<BrotliCompressor>(config.brotli_quality);
+#else
+      break;
+#endif
+  }
+  throw InvalidArgument("unsupported content encoding");
+}
+
+Generator<util::BufferSlice> CompressChunks(
+    std::unique_ptr<Compressor> compressor, Generator<util::BufferSlice> body,
+    util::ThreadPool* thread_pool, size_t offload_threshold) {
+  FOR_CO_AWAIT(const util::BufferSlice& chunk, body) {
+    if (chunk.empty()) {
+      continue;
+    }
+    std::string output;
+    if (thread_pool != nullptr && chunk.size() >= offload_threshold) {
+      output = co_await thread_pool->Do(
+          [&] { return compressor->Compress(chunk, /*finish=*/false); });
+    } else {
+      output = compressor->Compress(chunk, /*finish=*/false);
+    }
+    // An empty chunk would end a chunked response.
+    if (!output.empty()) {
+      co_yield std::move(output);
+    }
+  }
+  std::string output = compressor->Compress({}, /*finish=*/true);
+  if (!output.empty()) {
+    co_yield std::move(output);
+  }
+}
+
+std::string_view TrimOptionalWhitespace(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+// Whether the comma-separated list `value` holds `token`, ignoring case.
+bool HasToken(std::string_view value, std::string_view token) {
+  while (!value.empty()) {
+    size_t end = value.find(',');
+    std::string_view element = TrimOptionalWhitespace(value.substr(0, end));
+    if (EqualsIgnoreCase(element, token)) {
+      return true;
+    }
+    if (end == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(end + 1);
+  }
+  return false;
+}
+
+// Parses a qvalue into thousandths; malformed ones count as 0.
+int ParseQValue(std::string_view value) {
+  if (value.empty() || (value[0] != '0' && value[0] != '1')) {
+    return 0;
+  }
+  int result = (value[0] - '0') * 1000;
+  if (value.size() > 1) {
+    if (value[1] != '.' || value.size() > 5) {
+      return 0;
+    }
+    int scale = 100;
+    for (char c : value.substr(2)) {
+      if (c < '0' || c > '9') {
+        return 0;
+      }
+      result += (c - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return std::min(result, 1000);
+}
+
+struct AcceptedEncodings {
+  // Indexed by ContentEncoding, in thousandths.
+  std::optional<int> qvalues[3];
+  std::optional<int> wildcard_qvalue;
+
+  int GetQValue(ContentEncoding encoding) const {
+    return qvalues[static_cast<int>(encoding)].value_or(
+        wildcard_qvalue.value_or(0));
+  }
+};
+
+AcceptedEncodings ParseAcceptEncoding(std::string_view accept_encoding) {
+  AcceptedEncodings result;
+  while (!accept_encoding.empty()) {
+    size_t end = accept_encoding.find(',');
+    std::string_view element = accept_encoding.substr(0, end);
+    int qvalue = 1000;
+    if (size_t semicolon = element.find(';');
+        semicolon != std::string_view::npos) {
+      std::string_view parameter = element.substr(semicolon + 1);
+      element = element.substr(0, semicolon);
+      parameter = TrimOptionalWhitespace(parameter);
+      if (parameter.size() >= 2 && ToLowerAscii(parameter[0]) == 'q' &&
+          parameter[1] == '=') {
+        qvalue = ParseQValue(parameter.substr(2));
+      }
+    }
+    element = TrimOptionalWhitespace(element);
+    if (element == "*") {
+      result.wildcard_qvalue = qvalue;
+    } else if (EqualsIgnoreCase(element, "gzip") ||
+               EqualsIgnoreCase(element, "x-gzip")) {
+      result.qvalues[static_cast<int>(ContentEncoding::kGzip)] = qvalue;
+    } else if (EqualsIgnoreCase(element, "br")) {
+      result.qvalues[static_cast<int>(ContentEncoding::kBrotli)] = qvalue;
+    } else if (EqualsIgnoreCase(element, "identity")) {
+      result.qvalues[static_cast<int>(ContentEncoding::kIdentity)] = qvalue;
+    }
+    if (end == std::string_view::npos) {
+      break;
+    }
+    accept_encoding.remove_prefix(end + 1);
+  }
+  return result;
+}
+
+bool HasCompressibleContentType(
+    std::span<const std::pair<std::string, std::string>> headers,
+    const CompressionConfig& config) {
+  auto header = FindHeader(headers, "Content-Type");
+  if (!header) {
+    return false;
+  }
+  std::string content_type =
+      ToLowerCase(TrimWhitespace(header->substr(0, header->find(';'))));
+  if (content_type.ends_with("+json") || content_type.ends_with("+xml")) {
+    return true;
+  }
+  return std::any_of(config.content_types.begin(), config.content_types.end(),
+                     [&](const std::string& prefix) {
+                       return content_type.starts_with(prefix);
+                     });
+}
+
+bool IsCompressible(const Response<>& response,
+                    const CompressionConfig& config) {
+  if (response.status < 200 || response.status == 204 ||
+      response.status == 206 || response.status == 304 ||
+      response.file_body || FindHeader(response.headers, "Content-Encoding") ||
+      HasHeader(response.headers, "Cache-Control", "no-transform") ||
+      !HasCompressibleContentType(response.headers, config)) {
+    return false;
+  }
+  if (auto content_length = FindHeader(response.headers, "Content-Length")) {
+    return std::stoull(std::string(*content_length)) >= config.min_size;
+  }
+  return true;
+}
+
+void AddVary(std::vector<std::pair<std::string, std::string>>& headers) {
+  for (auto& [name, value] : headers) {
+    if (EqualsIgnoreCase(name, "Vary")) {
+      if (!HasToken(value, "*") && !HasToken(value, "Accept-Encoding")) {
+        value += ", Accept-Encoding";
+      }
+      return;
+    }
+  }
+  headers.emplace_back("Vary", "Accept-Encoding");
+}
+
+struct CompressingHandler {
+  Task<Response<>> operator()(Request<> request, stdx::stop_token stop_token) {
+    std::string accept_encoding(
+        FindHeader(request.headers, "Accept-Encoding").value_or(""));
+    Response<> response =
+        co_await handler(std::move(request), std::move(stop_token));
+    if (!IsCompressible(response, config)) {
+      co_return response;
+    }
+    AddVary(response.headers);
+    ContentEncoding encoding =
+        NegotiateContentEncoding(accept_encoding, encodings);
+    if (encoding == ContentEncoding::kIdentity) {
+      co_return response;
+    }
+    std::erase_if(response.headers, [](const auto& header) {
+      return EqualsIgnoreCase(header.first, "Content-Length");
+    });
+    for (auto& [name, value] : response.headers) {
+      // The compressed body isn't byte-for-byte the entity the tag names.
+      if (EqualsIgnoreCase(name, "ETag") && value.starts_with('"')) {
+        value = "W/" + value;
+      }
+    }
+    response.headers.emplace_back("Content-Encoding",
+                                  std::string(ToString(encoding)));
+    response.body = CompressChunks(
+        CreateCompressor(encoding, config), std::move(response.body),
+        config.thread_pool, config.offload_threshold);
+    co_return response;
+  }
+
+  HttpHandler handler;
+  CompressionConfig config;
+  // The configured encodings which are supported, identity last.
+  std::vector<ContentEncoding> encodings;
+};
+
+}  // namespace
+
+std::string_view ToString(ContentEncoding encoding) {
+  switch (encoding) {
+    case ContentEncoding::kIdentity:
+      return "identity";
+    case ContentEncoding::kGzip:
+      return "gzip";
+    case ContentEncoding::kBrotli:
+      return "br";
+  }
+  throw InvalidArgument("invalid content encoding");
+}
+
+bool IsContentEncodingSupported([[maybe_unused]] ContentEncoding encoding) {
+#ifdef CORO_HTTP_HAVE_BROTLI
+  return true;
+#else
+  return encoding != ContentEncoding::kBrotli;
+#endif
+}
+
+ContentEncoding NegotiateContentEncoding(
+    std::string_view accept_encoding,
+    std::span<const ContentEncoding> available) {
+  AcceptedEncodings accepted = ParseAcceptEncoding(accept_encoding);
+  ContentEncoding best = ContentEncoding::kIdentity;
+  int best_qvalue = 0;
+  for (ContentEncoding encoding : available) {
+    if (int qvalue = accepted.GetQValue(encoding); qvalue > best_qvalue) {
+      best = encoding;
+      best_qvalue = qvalue;
+    }
+  }
+  return best;
+}
+
+Generator<util::BufferSlice> CompressBody(ContentEncoding encoding,
+                                          Generator<util::BufferSlice> body,
+                                          const CompressionConfig& config) {
+  std::unique_ptr<Compressor> compressor = CreateCompressor(encoding, config);
+  if (!compressor) {
+    return body;
+  }
+  return CompressChunks(std::move(compressor), std::move(body),
+                        config.thread_pool, config.offload_threshold);
+}
+
+Generator<util::BufferSlice> CompressBody(ContentEncoding encoding,
+                                          Generator<util::BufferSlice> body) {
+  return CompressBody(encoding, std::move(body), CompressionConfig{});
+}
+
+HttpHandler CompressResponses(HttpHandler handler, CompressionConfig config) {
+  std::vector<ContentEncoding> encodings;
+  for (ContentEncoding encoding : config.encodings) {
+    if (encoding != ContentEncoding::kIdentity &&
+        IsContentEncodingSupported(encoding)) {
+      encodings.push_back(encoding);
+    }
+  }
+  encodings.push_back(ContentEncoding::kIdentity);
+  return CompressingHandler{.handler = std::move(handler),
+                            .config = std::move(config),
+                            .encodings = std::move(encodings)};
+}
+
+}  // namespace coro::http
@@ -0,0 +1,72 @@
+#ifndef CORO_HTTP_HTTP_COMPRESSION_H
+#define CORO_HTTP_HTTP_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coro/generator.h"
+#include "coro/http/http.h"
+#include "coro/http/http_server.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::http {
+
+enum class ContentEncoding { kIdentity, kGzip, kBrotli };
+
+// The Content-Encoding token of `encoding`, such as "gzip".
+std::string_view ToString(ContentEncoding encoding);
+
+// Brotli is only available if the library was built with it.
+bool IsContentEncodingSupported(ContentEncoding encoding);
+
+// Picks the encoding of `available` which the client prefers according to its
+// Accept-Encoding header, the earlier one on ties. Returns kIdentity if the
+// client accepts none of them. Handlers serving precompressed variants of
+// static assets use it to choose the variant to send.
+ContentEncoding NegotiateContentEncoding(
+    std::string_view accept_encoding,
+    std::span<const ContentEncoding> available);
+
+struct CompressionConfig {
+  // Encodings offered to clients, the preferred ones first.
+  std::vector<ContentEncoding> encodings = {ContentEncoding::kBrotli,
+                                            ContentEncoding::kGzip};
+  int gzip_level = 6;
+  int brotli_quality = 5;
+  // Responses whose Content-Length is smaller are sent as they are.
+  uint64_t min_size = 1024;
+  // Responses are compressed if their Content-Type starts with one of these
+  // or has a +json or +xml suffix.
+  std::vector<std::string> content_types = {
+      "text/", "application/json", "application/javascript",
+      "application/xml", "image/svg+xml"};
+  // Body chunks at least `offload_threshold` bytes long are compressed on
+  // `thread_pool`, if set, so that the event loop keeps serving other
+  // connections meanwhile.
+  util::ThreadPool* thread_pool = nullptr;
+  size_t offload_threshold = 64 * 1024;
+};
+
+// Compresses `body` chunk by chunk. The output is flushed after every chunk,
+// so that a streamed body reaches the client as it's produced.
+Generator<util::BufferSlice> CompressBody(ContentEncoding encoding,
+                                          Generator<util::BufferSlice> body,
+                                          const CompressionConfig& config);
+Generator<util::BufferSlice> CompressBody(ContentEncoding encoding,
+                                          Generator<util::BufferSlice> body);
+
+// Wraps `handler` so that compressible responses are sent with the
+// Content-Encoding the client prefers. Their Content-Length is dropped, so
+// they are sent chunked, their ETag is weakened and Accept-Encoding is added
+// to their Vary header. Responses which already have a Content-Encoding, like
+// precompressed static assets, and file bodies are sent as they are.
+HttpHandler CompressResponses(HttpHandler handler,
+                              CompressionConfig config = {});
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP_COMPRESSION_H
@@ -0,0 +1,168 @@
+#include "coro/http/http_middleware.h"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/interrupted_exception.h"
+
+namespace coro::http {
+
+namespace {
+
+Request<> CopyRequest(const Request<>& request) {
+  return Request<>{.url = request.url,
+                   .method = request.method,
+                   .headers = request.headers,
+                   .body = std::nullopt,
+                   .invalidates_cache = request.invalidates_cache,
+                   .timeouts = request.timeouts};
+}
+
+// Only the delay-seconds form is understood.
+std::optional<std::chrono::milliseconds> GetRetryAfter(
+    const std::vector<std::pair<std::string, std::string>>& headers) {
+  auto header = GetHeader(headers, "Retry-After");
+  if (!header) {
+    return std::nullopt;
+  }
+  int seconds;
+  auto [end, error] =
+      std::from_chars(header->data(), header->data() + header->size(), seconds);
+  if (error != std::errc() || end != header->data() + header->size() ||
+      seconds < 0) {
+    return std::nullopt;
+  }
+  return std::chrono::seconds(seconds);
+}
+
+std::string GetHostKey(std::string_view url) {
+  Uri uri = ParseUri(url);
+  std::string key = uri.host.value_or("");
+  if (uri.port) {
+    key += ":" + std::to_string(*uri.port);
+  }
+  return key;
+}
+
+Generator<util::BufferSlice> HoldLock(SemaphoreLock /*lock*/,
+                                      Generator<util::BufferSlice> body) {
+  FOR_CO_AWAIT(util::BufferSlice & chunk, body) { co_yield std::move(chunk); }
+}
+
+}  // namespace
+
+RetryHttp::RetryHttp(const Http* http, const coro::util::EventLoop* event_loop,
+                     RetryPolicy policy)
+    : http_(http),
+      event_loop_(event_loop),
+      policy_(std::move(policy)),
+      retry_budget_(policy_.max_retry_budget),
+      random_(std::random_device()()) {}
+
+bool RetryHttp::IsRetryable(int status) const {
+  return std::find(policy_.retryable_statuses.begin(),
+                   policy_.retryable_statuses.end(),
+                   status) != policy_.retryable_statuses.end();
+}
+
+Task<Response<>> RetryHttp::Fetch(Request<> request,
+                                  stdx::stop_token stop_token) const {
+  retry_budget_ = std::min(retry_budget_ + policy_.retry_budget_ratio,
+                           policy_.max_retry_budget);
+  if (request.body || request.invalidates_cache) {
+    co_return co_await http_->Fetch(std::move(request), std::move(stop_token));
+  }
+  std::chrono::milliseconds backoff = policy_.initial_backoff;
+  for (int attempt = 1; attempt < policy_.max_attempts; attempt++) {
+    std::optional<std::chrono::milliseconds> retry_after;
+    try {
+      auto response = co_await http_->Fetch(CopyRequest(request), stop_token);
+      if (!IsRetryable(response.status)) {
+        co_return response;
+      }
+      if (retry_budget_ < 1) {
+        stats_.budget_exhausted_count++;
+        co_return response;
+      }
+      retry_after = GetRetryAfter(response.headers);
+    } catch (const HttpException&) {
+      if (retry_budget_ < 1) {
+        stats_.budget_exhausted_count++;
+        throw;
+      }
+    }
+    retry_budget_ -= 1;
+    stats_.retry_count++;
+    auto delay = std::chrono::milliseconds(
+        std::uniform_int_distribution<int64_t>(0, backoff.count())(random_));
+    if (retry_after) {
+      delay = std::min(std::max(delay, *retry_after), policy_.max_backoff);
+    }
+    co_await event_loop_->Wait(static_cast<int>(delay.count()), stop_token);
+    backoff = std::min(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            backoff * policy_.backoff_multiplier),
+        policy_.max_backoff);
+  }
+  co_return co_await http_->Fetch(std::move(request), std::move(stop_token));
+}
+
+Task<Response<>> CircuitBreakerHttp::Fetch(Request<> request,
+                                           stdx::stop_token stop_token) const {
+  std::string host = GetHostKey(request.url);
+  if (auto it = circuits_.find(host);
+      it != circuits_.end() && it->second.open_until) {
+    Circuit& circuit = it->second;
+    if (circuit.probing ||
+        std::chrono::steady_clock::now() < *circuit.open_until) {
+      stats_.rejected_request_count++;
+      throw HttpException(503, "Circuit breaker open for " + host + ".");
+    }
+    circuit.probing = true;
+  }
+  try {
+    auto response =
+        co_await http_->Fetch(std::move(request), std::move(stop_token));
+    if (response.status / 100 == 5) {
+      RecordFailure(host);
+    } else {
+      circuits_.erase(host);
+    }
+    co_return response;
+  } catch (const HttpException&) {
+    RecordFailure(host);
+    throw;
+  } catch (...) {
+    if (auto it = circuits_.find(host); it != circuits_.end()) {
+      it->second.probing = false;
+    }
+    throw;
+  }
+}
+
+void CircuitBreakerHttp::RecordFailure(const std::string& host) const {
+  Circuit& circuit = circuits_[host];
+  circuit.failure_count++;
+  if (circuit.probing || circuit.failure_count >= policy_.failure_threshold) {
+    if (!circuit.open_until || circuit.probing) {
+      stats_.open_circuit_count++;
+    }
+    circuit.open_until =
+        std::chrono::steady_clock::now() + policy_.open_duration;
+    circuit.probing = false;
+  }
+}
+
+Task<Response<>> ConcurrencyLimitedHttp::Fetch(
+    Request<> request, stdx::stop_token stop_token) const {
+  auto lock = co_await SemaphoreLock::Create(&semaphore_, stop_token);
+  auto response =
+      co_await http_->Fetch(std::move(request), std::move(stop_token));
+  response.body = HoldLock(std::move(lock), std::move(response.body));
+  co_return response;
+}
+
+}  // namespace coro::http
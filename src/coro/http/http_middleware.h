@@ -0,0 +1,137 @@
+#ifndef CORO_HTTP_HTTP_MIDDLEWARE_H
+#define CORO_HTTP_HTTP_MIDDLEWARE_H
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/mutex.h"
+#include "coro/util/event_loop.h"
+
+// Clients wrapping an Http, like CacheHttp does. Wrapped into an Http by
+// pointer they stack, e.g. a RetryHttp on top of a CircuitBreakerHttp, so that
+// retries are rejected early during an outage. They have to be used on the
+// event loop's thread.
+
+namespace coro::http {
+
+struct RetryPolicy {
+  // Including the first one.
+  int max_attempts = 3;
+  // Attempts after the first one wait for a random duration of up to the
+  // backoff, which grows by `backoff_multiplier` with every attempt.
+  std::chrono::milliseconds initial_backoff{100};
+  std::chrono::milliseconds max_backoff{10000};
+  double backoff_multiplier = 2;
+  // Every request adds this many retries to the budget, of which at most
+  // `max_retry_budget` are kept. A retry is made only if the budget holds at
+  // least one, so that retries don't multiply the load during an outage.
+  double retry_budget_ratio = 0.2;
+  double max_retry_budget = 10;
+  // Response statuses retried in addition to HttpExceptions. Retry-After of
+  // such responses is honored up to `max_backoff`.
+  std::vector<int> retryable_statuses = {429, 502, 503, 504};
+};
+
+// Retries failed requests with jittered exponential backoff. Requests with a
+// body or with `invalidates_cache` set are sent once only.
+class RetryHttp {
+ public:
+  struct Stats {
+    uint64_t retry_count = 0;
+    // Failed requests which weren't retried as the budget was spent.
+    uint64_t budget_exhausted_count = 0;
+  };
+
+  RetryHttp(const Http* http, const coro::util::EventLoop* event_loop,
+            RetryPolicy policy = {});
+
+  RetryHttp(const RetryHttp&) = delete;
+  RetryHttp& operator=(const RetryHttp&) = delete;
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  bool IsRetryable(int status) const;
+
+  const Http* http_;
+  const coro::util::EventLoop* event_loop_;
+  RetryPolicy policy_;
+  mutable double retry_budget_;
+  mutable std::minstd_rand random_;
+  mutable Stats stats_;
+};
+
+struct CircuitBreakerPolicy {
+  // Consecutive failures of a host, i.e. HttpExceptions and 5xx responses,
+  // after which its circuit opens.
+  int failure_threshold = 5;
+  // For how long an open circuit fails requests right away. Afterwards a
+  // single request is let through, which closes the circuit if it succeeds
+  // and opens it again otherwise.
+  std::chrono::milliseconds open_duration{5000};
+};
+
+// Fails requests to hosts which keep failing with HttpException(503) without
+// sending them, which gives the hosts time to recover.
+class CircuitBreakerHttp {
+ public:
+  struct Stats {
+    uint64_t rejected_request_count = 0;
+    uint64_t open_circuit_count = 0;
+  };
+
+  CircuitBreakerHttp(const Http* http, CircuitBreakerPolicy policy = {})
+      : http_(http), policy_(policy) {}
+
+  CircuitBreakerHttp(const CircuitBreakerHttp&) = delete;
+  CircuitBreakerHttp& operator=(const CircuitBreakerHttp&) = delete;
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Circuit {
+    int failure_count = 0;
+    std::optional<std::chrono::steady_clock::time_point> open_until;
+    bool probing = false;
+  };
+
+  void RecordFailure(const std::string& host) const;
+
+  const Http* http_;
+  CircuitBreakerPolicy policy_;
+  // Hosts which failed recently; a success removes the host.
+  mutable std::unordered_map<std::string, Circuit> circuits_;
+  mutable Stats stats_;
+};
+
+// Bounds the number of requests running at once; others wait for their turn
+// in FIFO order. A request runs until its response body is consumed or
+// destroyed.
+class ConcurrencyLimitedHttp {
+ public:
+  ConcurrencyLimitedHttp(const Http* http, int max_concurrent_requests)
+      : http_(http), semaphore_(max_concurrent_requests) {}
+
+  ConcurrencyLimitedHttp(const ConcurrencyLimitedHttp&) = delete;
+  ConcurrencyLimitedHttp& operator=(const ConcurrencyLimitedHttp&) = delete;
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const;
+
+ private:
+  const Http* http_;
+  mutable Semaphore semaphore_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP_MIDDLEWARE_H
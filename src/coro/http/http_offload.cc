@@ -0,0 +1,36 @@
+#include "coro/http/http_offload.h"
+
+#include <utility>
+
+namespace coro::http {
+
+namespace {
+
+struct OffloadingHandler {
+  Task<Response<>> operator()(Request<> request, stdx::stop_token stop_token) {
+    Request<std::string> buffered_request{
+        .url = std::move(request.url),
+        .method = request.method,
+        .headers = std::move(request.headers),
+        .invalidates_cache = request.invalidates_cache};
+    if (request.body) {
+      buffered_request.body = co_await GetBody(std::move(*request.body));
+    }
+    co_return co_await offloader->Run(
+        [&] { return handler(std::move(buffered_request), stop_token); },
+        stop_token);
+  }
+
+  CpuBoundHttpHandler handler;
+  HttpOffloader* offloader;
+};
+
+}  // namespace
+
+HttpHandler OffloadHandler(CpuBoundHttpHandler handler,
+                           HttpOffloader* offloader) {
+  return OffloadingHandler{.handler = std::move(handler),
+                           .offloader = offloader};
+}
+
+}  // namespace coro::http
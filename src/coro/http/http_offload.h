@@ -0,0 +1,97 @@
+#ifndef CORO_HTTP_HTTP_OFFLOAD_H
+#define CORO_HTTP_HTTP_OFFLOAD_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "coro/http/http.h"
+#include "coro/http/http_exception.h"
+#include "coro/http/http_server.h"
+#include "coro/mutex.h"
+#include "coro/stdx/any_invocable.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/function_traits.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::http {
+
+struct OffloadConfig {
+  // Functions running on the thread pool at once; further ones wait in FIFO
+  // order. Kept below the pool's thread count, it leaves threads to other
+  // offloaders sharing the pool.
+  int max_running = 4;
+  // Functions waiting for their turn, past which new ones are rejected with
+  // HttpException(503) instead of queueing behind work which would make them
+  // time out anyway.
+  int max_queued = 16;
+};
+
+// Runs the CPU-bound parts of HTTP handlers on a ThreadPool, so that the event
+// loop keeps serving other connections meanwhile. Has to be used on the event
+// loop's thread; a multi-threaded server needs one offloader per event loop,
+// created by the handler factory. Routes with different costs should use
+// separate offloaders, so that a burst of expensive requests is shed before it
+// delays cheap ones.
+class HttpOffloader {
+ public:
+  struct Stats {
+    uint64_t offloaded_count = 0;
+    uint64_t rejected_count = 0;
+  };
+
+  HttpOffloader(util::ThreadPool* thread_pool, OffloadConfig config = {})
+      : thread_pool_(thread_pool),
+        config_(config),
+        semaphore_(config.max_running) {}
+
+  HttpOffloader(const HttpOffloader&) = delete;
+  HttpOffloader& operator=(const HttpOffloader&) = delete;
+
+  // Calls `func` on a worker thread and resumes the caller on the event loop
+  // with its result.
+  template <typename Func>
+  util::ThreadPool::TaskT<util::ReturnTypeT<Func>> Run(
+      Func&& func, stdx::stop_token stop_token = stdx::stop_token()) {
+    if (semaphore_.available() <= 0 && queued_count_ >= config_.max_queued) {
+      stats_.rejected_count++;
+      throw HttpException(503, "Too many CPU-bound requests.");
+    }
+    queued_count_++;
+    SemaphoreLock lock = co_await [&]() -> Task<SemaphoreLock> {
+      auto guard = util::AtScopeExit([&] { queued_count_--; });
+      co_return co_await SemaphoreLock::Create(&semaphore_, stop_token);
+    }();
+    stats_.offloaded_count++;
+    co_return co_await thread_pool_->Do(std::move(stop_token),
+                                        std::forward<Func>(func));
+  }
+
+  const Stats& stats() const { return stats_; }
+  int queued_count() const { return queued_count_; }
+
+ private:
+  util::ThreadPool* thread_pool_;
+  OffloadConfig config_;
+  Semaphore semaphore_;
+  int queued_count_ = 0;
+  Stats stats_;
+};
+
+// A handler which runs entirely on a worker thread, possibly on many at once.
+// The response body is iterated on the event loop, so it should be computed
+// by the time the handler returns, e.g. with CreateBody.
+using CpuBoundHttpHandler = stdx::any_invocable<Response<>(
+    Request<std::string>, stdx::stop_token) const>;
+
+// Wraps `handler` into an HttpHandler reading the request body on the event
+// loop, computing the response on `offloader`'s thread pool and sending it
+// from the event loop again. `offloader` has to outlive the returned handler.
+HttpHandler OffloadHandler(CpuBoundHttpHandler handler,
+                           HttpOffloader* offloader);
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP_OFFLOAD_H
@@ -3,27 +3,80 @@
 #include <event2/http.h>
 #include <event2/keyvalq_struct.h>
 
+#include <algorithm>
 #include <array>
+#include <charconv>
 #include <cmath>
-#include <iomanip>
+#include <cstring>
+#include <ctime>
+#include <limits>
 #include <memory>
-#include <sstream>
+#include <string>
 #include <utility>
 
+#include "coro/exception.h"
 #include "coro/http/http.h"
-#include "coro/util/raii_utils.h"
-#include "coro/util/regex.h"
+#include "coro/http/http_exception.h"
 
 namespace coro::http {
 
 namespace {
 
-namespace re = util::re;
-
 struct EvHttpUriDeleter {
   void operator()(evhttp_uri* uri) const { evhttp_uri_free(uri); }
 };
 
+constexpr std::string_view kBase64Chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr std::string_view kHexDigits = "0123456789ABCDEF";
+constexpr uint8_t kInvalid = 255;
+
+// Accepts both the standard and the URL-safe alphabet.
+constexpr std::array<uint8_t, 256> kBase64Values = [] {
+  std::array<uint8_t, 256> values{};
+  values.fill(kInvalid);
+  for (size_t i = 0; i < kBase64Chars.size(); i++) {
+    values[static_cast<uint8_t>(kBase64Chars[i])] = static_cast<uint8_t>(i);
+  }
+  values['-'] = 62;
+  values['_'] = 63;
+  return values;
+}();
+
+constexpr std::array<uint8_t, 256> kHexValues = [] {
+  std::array<uint8_t, 256> values{};
+  values.fill(kInvalid);
+  for (int i = 0; i < 10; i++) {
+    values['0' + i] = static_cast<uint8_t>(i);
+  }
+  for (int i = 0; i < 6; i++) {
+    values['a' + i] = values['A' + i] = static_cast<uint8_t>(10 + i);
+  }
+  return values;
+}();
+
+// Characters left as they are by EncodeUri, per RFC 3986.
+constexpr std::array<bool, 256> kUnreservedChars = [] {
+  std::array<bool, 256> chars{};
+  for (int c = 0; c < 256; c++) {
+    chars[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+               c == '~';
+  }
+  return chars;
+}();
+
+// Lower-cases the ASCII letters among the 8 bytes of `word` at once, leaving
+// other bytes intact.
+uint64_t ToLowerCaseWord(uint64_t word) {
+  constexpr uint64_t kOnes = 0x0101010101010101;
+  uint64_t low_bits = word & (0x7f * kOnes);
+  uint64_t above_z = low_bits + (0x7f - 'Z') * kOnes;
+  uint64_t from_a = low_bits + (0x80 - 'A') * kOnes;
+  uint64_t upper = ~word & (from_a ^ above_z) & (0x80 * kOnes);
+  return word | (upper >> 2);
+}
+
 const std::unordered_map<std::string, std::string> kMimeType = {  // NOLINT
     {"aac", "audio/aac"},           {"avi", "video/x-msvideo"},
     {"gif", "image/gif"},           {"jpeg", "image/jpeg"},
@@ -55,6 +108,97 @@ std::optional<int> ToOptional(int value) {
   }
 }
 
+constexpr std::array<std::string_view, 7> kDayNames = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+constexpr std::array<std::string_view, 12> kMonthNames = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsOptionalWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+std::string_view TrimOptionalWhitespace(std::string_view str) {
+  while (!str.empty() && IsOptionalWhitespace(str.front())) {
+    str.remove_prefix(1);
+  }
+  while (!str.empty() && IsOptionalWhitespace(str.back())) {
+    str.remove_suffix(1);
+  }
+  return str;
+}
+
+// Consumes a nonempty run of decimal digits from the front of `str`.
+std::optional<int64_t> ConsumeNumber(std::string_view& str) {
+  int64_t value = 0;
+  size_t i = 0;
+  for (; i < str.size() && IsDigit(str[i]); i++) {
+    int digit = str[i] - '0';
+    if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) {
+      return std::nullopt;
+    }
+    value = value * 10 + digit;
+  }
+  if (i == 0) {
+    return std::nullopt;
+  }
+  str.remove_prefix(i);
+  return value;
+}
+
+// Consumes exactly `digit_count` decimal digits from the front of `str`.
+std::optional<int> ConsumeFixedNumber(std::string_view& str,
+                                      size_t digit_count) {
+  if (str.size() < digit_count) {
+    return std::nullopt;
+  }
+  int value = 0;
+  for (size_t i = 0; i < digit_count; i++) {
+    if (!IsDigit(str[i])) {
+      return std::nullopt;
+    }
+    value = value * 10 + (str[i] - '0');
+  }
+  str.remove_prefix(digit_count);
+  return value;
+}
+
+bool ConsumePrefix(std::string_view& str, std::string_view prefix) {
+  if (!str.starts_with(prefix)) {
+    return false;
+  }
+  str.remove_prefix(prefix.size());
+  return true;
+}
+
+bool ConsumeOneOf(std::string_view& str, std::string_view chars) {
+  if (str.empty() || chars.find(str.front()) == std::string_view::npos) {
+    return false;
+  }
+  str.remove_prefix(1);
+  return true;
+}
+
+char* FormatNumber(char* output, int value, int width) {
+  for (int i = width - 1; i >= 0; i--) {
+    output[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return output + width;
+}
+
+char* FormatString(char* output, std::string_view str) {
+  memcpy(output, str.data(), str.size());
+  return output + str.size();
+}
+
+bool IsValidTime(const std::tm& time) {
+  return time.tm_mon >= 0 && time.tm_mon < 12 && time.tm_mday >= 1 &&
+         time.tm_mday <= 31 && time.tm_hour >= 0 && time.tm_hour <= 23 &&
+         time.tm_min >= 0 && time.tm_min <= 59 && time.tm_sec >= 0 &&
+         time.tm_sec <= 60;
+}
+
 }  // namespace
 
 Uri ParseUri(std::string_view url_view) {
@@ -88,24 +232,50 @@ std::unordered_map<std::string, std::string> ParseQuery(
 }
 
 std::string DecodeUri(std::string_view uri) {
-  char* decoded = evhttp_uridecode(std::string(uri).c_str(), 1, nullptr);
-  if (!decoded) {
-    throw HttpException(-1, "evhttp_decode_uri failed");
+  std::string decoded;
+  decoded.reserve(uri.size());
+  size_t it = 0;
+  while (it < uri.size()) {
+    size_t next = uri.find_first_of("%+", it);
+    if (next == std::string_view::npos) {
+      decoded.append(uri.substr(it));
+      break;
+    }
+    decoded.append(uri.substr(it, next - it));
+    it = next + 1;
+    if (uri[next] == '+') {
+      decoded += ' ';
+      continue;
+    }
+    uint8_t high = it + 1 < uri.size()
+                       ? kHexValues[static_cast<uint8_t>(uri[it])]
+                       : kInvalid;
+    uint8_t low = high != kInvalid ? kHexValues[static_cast<uint8_t>(uri[it + 1])]
+                                   : kInvalid;
+    if (low == kInvalid) {
+      // Malformed escapes are kept as they are.
+      decoded += '%';
+    } else {
+      decoded += static_cast<char>(high << 4 | low);
+      it += 2;
+    }
   }
-  auto scope_guard = util::AtScopeExit([&] {
-    free(decoded);  // NOLINT
-  });
   return decoded;
 }
 
 std::string EncodeUri(std::string_view uri) {
-  char* encoded = evhttp_encode_uri(std::string(uri).c_str());
-  if (!encoded) {
-    throw HttpException(-1, "evhttp_encode_uri failed");
+  std::string encoded;
+  encoded.reserve(uri.size());
+  for (char c : uri) {
+    auto byte = static_cast<uint8_t>(c);
+    if (kUnreservedChars[byte]) {
+      encoded += c;
+    } else {
+      const char escaped[] = {'%', kHexDigits[byte >> 4],
+                              kHexDigits[byte & 0xF]};
+      encoded.append(escaped, sizeof(escaped));
+    }
   }
-  auto scope_guard = util::AtScopeExit([&] {
-    free(encoded);  // NOLINT
-  });
   return encoded;
 }
 
@@ -192,21 +362,71 @@ std::string FormDataToString(
 }
 
 Range ParseRange(std::string_view str) {
-  re::regex regex(R"(bytes=(\d+)-(\d*))");
-  re::match_results<std::string_view::const_iterator> match;
-  if (re::regex_match(str.begin(), str.end(), match, regex)) {
-    return Range{.start = std::stoll(match[1].str()),
-                 .end = match[2].str().empty()
-                            ? std::nullopt
-                            : std::make_optional(std::stoll(match[2].str()))};
+  Range range{};
+  if (ParseRanges(str, std::span<Range>(&range, 1)) == 1) {
+    return range;
   } else {
     return Range{};
   }
 }
 
+std::optional<size_t> ParseRanges(std::string_view str,
+                                  std::span<Range> ranges) {
+  constexpr std::string_view kUnit = "bytes=";
+  if (str.size() < kUnit.size() ||
+      !EqualsIgnoreCase(str.substr(0, kUnit.size()), kUnit)) {
+    return std::nullopt;
+  }
+  str.remove_prefix(kUnit.size());
+  size_t count = 0;
+  while (true) {
+    size_t comma = str.find(',');
+    std::string_view spec = TrimOptionalWhitespace(str.substr(0, comma));
+    if (!spec.empty()) {
+      std::optional<int64_t> start = ConsumeNumber(spec);
+      if (!start || !ConsumePrefix(spec, "-") || count == ranges.size()) {
+        return std::nullopt;
+      }
+      Range& range = ranges[count++];
+      range = Range{.start = *start};
+      if (!spec.empty()) {
+        range.end = ConsumeNumber(spec);
+        if (!range.end || !spec.empty() || *range.end < *start) {
+          return std::nullopt;
+        }
+      }
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    str.remove_prefix(comma + 1);
+  }
+  if (count == 0) {
+    return std::nullopt;
+  }
+  return count;
+}
+
+std::vector<Range> ParseRanges(std::string_view str) {
+  std::vector<Range> ranges(std::count(str.begin(), str.end(), ',') + 1);
+  if (std::optional<size_t> count = ParseRanges(str, ranges)) {
+    ranges.resize(*count);
+  } else {
+    ranges.clear();
+  }
+  return ranges;
+}
+
 std::string ToLowerCase(std::string result) {
-  for (char& c : result) {
-    c = static_cast<char>(std::tolower(c));
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= result.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, result.data() + i, sizeof(word));
+    word = ToLowerCaseWord(word);
+    memcpy(result.data() + i, &word, sizeof(word));
+  }
+  for (; i < result.size(); i++) {
+    result[i] = ToLowerAscii(result[i]);
   }
   return result;
 }
@@ -251,52 +471,61 @@ std::string MimeTypeToExtension(std::string_view mime_type) {
 }
 
 std::string ToBase64(std::string_view in) {
-  const char* base64_chars =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  std::string out;
-  int val = 0;
-  int valb = -6;
-  for (uint8_t c : in) {
-    val = (val << 8) + c;
-    valb += 8;
-    while (valb >= 0) {
-      out.push_back(base64_chars[(val >> valb) & 0x3F]);
-      valb -= 6;
+  std::string out(4 * ((in.size() + 2) / 3), '=');
+  const auto* input = reinterpret_cast<const uint8_t*>(in.data());
+  char* output = out.data();
+  size_t i = 0;
+  for (; i + 3 <= in.size(); i += 3, output += 4) {
+    uint32_t group = input[i] << 16 | input[i + 1] << 8 | input[i + 2];
+    output[0] = kBase64Chars[group >> 18];
+    output[1] = kBase64Chars[(group >> 12) & 0x3F];
+    output[2] = kBase64Chars[(group >> 6) & 0x3F];
+    output[3] = kBase64Chars[group & 0x3F];
+  }
+  if (i < in.size()) {
+    uint32_t group = input[i] << 16;
+    if (i + 1 < in.size()) {
+      group |= input[i + 1] << 8;
+      output[2] = kBase64Chars[(group >> 6) & 0x3F];
     }
-  }
-  if (valb > -6) {
-    out.push_back(base64_chars[((val << 8) >> (valb + 8)) & 0x3F]);
-  }
-  while (out.size() % 4) {
-    out.push_back('=');
+    output[0] = kBase64Chars[group >> 18];
+    output[1] = kBase64Chars[(group >> 12) & 0x3F];
   }
   return out;
 }
 
+// Decodes up to the first character outside of the alphabet, such as padding.
 std::string FromBase64(std::string_view in) {
-  const std::array<uint8_t, 80> lookup = {
-      62,  255, 62,  255, 63,  52,  53, 54, 55, 56, 57, 58, 59, 60, 61, 255,
-      255, 0,   255, 255, 255, 255, 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,
-      10,  11,  12,  13,  14,  15,  16, 17, 18, 19, 20, 21, 22, 23, 24, 25,
-      255, 255, 255, 255, 63,  255, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
-      36,  37,  38,  39,  40,  41,  42, 43, 44, 45, 46, 47, 48, 49, 50, 51};
-
   std::string out;
-  int val = 0;
-  int valb = -8;
-  for (uint8_t c : in) {
-    if (c < '+' || c > 'z') {
+  out.reserve(in.size() / 4 * 3 + 2);
+  const auto* input = reinterpret_cast<const uint8_t*>(in.data());
+  size_t i = 0;
+  for (; i + 4 <= in.size(); i += 4) {
+    uint32_t a = kBase64Values[input[i]];
+    uint32_t b = kBase64Values[input[i + 1]];
+    uint32_t c = kBase64Values[input[i + 2]];
+    uint32_t d = kBase64Values[input[i + 3]];
+    if ((a | b | c | d) & 0x80) {
       break;
     }
-    c -= '+';
-    if (lookup[c] >= 64) {
+    uint32_t group = a << 18 | b << 12 | c << 6 | d;
+    const char bytes[] = {static_cast<char>(group >> 16),
+                          static_cast<char>(group >> 8),
+                          static_cast<char>(group)};
+    out.append(bytes, sizeof(bytes));
+  }
+  uint32_t group = 0;
+  int bits = 0;
+  for (; i < in.size(); i++) {
+    uint8_t value = kBase64Values[input[i]];
+    if (value == kInvalid) {
       break;
     }
-    val = (val << 6) + lookup[c];
-    valb += 6;
-    if (valb >= 0) {
-      out.push_back(static_cast<char>((val >> valb) & 0xFF));
-      valb -= 8;
+    group = (group << 6 | value) & 0xFFFFFF;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<char>(group >> bits));
     }
   }
   return out;
@@ -362,50 +591,119 @@ time_t timegm(const std::tm& t) {
 }
 
 int64_t ParseTime(std::string_view str) {
-  const uint32_t SIZE = 6;
-  std::array<char, SIZE + 1> buffer = {};
-  float sec;
   std::tm time = {};
-#ifdef _MSC_VER
-  int cnt =
-      sscanf_s(std::string(str).c_str(), "%d-%d-%dT%d:%d:%f%6s", &time.tm_year,
-               &time.tm_mon, &time.tm_mday, &time.tm_hour, &time.tm_min, &sec,
-               buffer.data(), static_cast<unsigned int>(buffer.size()));
-#else
-  // NOLINTNEXTLINE
-  int cnt = sscanf(std::string(str).c_str(), "%d-%d-%dT%d:%d:%f%6s",
-                   &time.tm_year, &time.tm_mon, &time.tm_mday, &time.tm_hour,
-                   &time.tm_min, &sec, buffer.data());
-#endif
-  if (cnt == 7) {
-    time.tm_year -= 1900;
-    time.tm_mon--;
-    time.tm_sec = static_cast<int>(std::lround(sec));
-    if (std::string_view(buffer.data()) != "Z") {
-      int offset_hour;
-      int offset_minute;
-#ifdef _MSC_VER
-      cnt = sscanf_s(buffer.data(), "%d:%d", &offset_hour, &offset_minute);
-#else
-      // NOLINTNEXTLINE
-      cnt = sscanf(buffer.data(), "%d:%d", &offset_hour, &offset_minute);
-#endif
-      if (cnt == 2) {
-        return timegm(time) +
-               (offset_hour >= 0 ? -1 : 1) *
-                   (std::abs(offset_hour) * 60 * 60 + offset_minute * 60);
+  std::optional<int64_t> year = ConsumeNumber(str);
+  std::optional<int64_t> month, day, hour, minute, second;
+  if (year && ConsumePrefix(str, "-") && (month = ConsumeNumber(str)) &&
+      ConsumePrefix(str, "-") && (day = ConsumeNumber(str)) &&
+      ConsumeOneOf(str, "Tt") && (hour = ConsumeNumber(str)) &&
+      ConsumePrefix(str, ":") && (minute = ConsumeNumber(str)) &&
+      ConsumePrefix(str, ":") && (second = ConsumeNumber(str)) &&
+      *year >= 1900 && *year <= 9999 && *month <= 12 && *day <= 31 &&
+      *hour <= 23 && *minute <= 59 && *second <= 60) {
+    time.tm_year = static_cast<int>(*year - 1900);
+    time.tm_mon = static_cast<int>(*month - 1);
+    time.tm_mday = static_cast<int>(*day);
+    time.tm_hour = static_cast<int>(*hour);
+    time.tm_min = static_cast<int>(*minute);
+    time.tm_sec = static_cast<int>(*second);
+    if (ConsumePrefix(str, ".")) {
+      std::string_view fraction = str;
+      if (!ConsumeNumber(str)) {
+        throw InvalidArgument("can't parse time");
+      }
+      if (fraction.front() >= '5') {
+        time.tm_sec++;
+      }
+    }
+    if (IsValidTime(time)) {
+      if (ConsumeOneOf(str, "Zz") && str.empty()) {
+        return timegm(time);
+      }
+      bool negative = str.starts_with('-');
+      std::optional<int> offset_hour, offset_minute;
+      if (ConsumeOneOf(str, "+-") &&
+          (offset_hour = ConsumeFixedNumber(str, 2)) &&
+          ConsumePrefix(str, ":") &&
+          (offset_minute = ConsumeFixedNumber(str, 2)) && str.empty()) {
+        int64_t offset = *offset_hour * 60 * 60 + *offset_minute * 60;
+        return timegm(time) + (negative ? offset : -offset);
       }
     }
-    return timegm(time);
   }
   throw InvalidArgument("can't parse time");
 }
 
 std::string ToTimeString(time_t timestamp) {
-  auto time = http::gmtime(timestamp);
-  std::stringstream ss;
-  ss << std::put_time(&time, "%Y-%m-%dT%H:%M:%SZ");
-  return ss.str();
+  std::tm time = http::gmtime(timestamp);
+  char buffer[std::string_view("YYYY-MM-DDTHH:MM:SSZ").size()];
+  char* output = FormatNumber(buffer, time.tm_year + 1900, 4);
+  *output++ = '-';
+  output = FormatNumber(output, time.tm_mon + 1, 2);
+  *output++ = '-';
+  output = FormatNumber(output, time.tm_mday, 2);
+  *output++ = 'T';
+  output = FormatNumber(output, time.tm_hour, 2);
+  *output++ = ':';
+  output = FormatNumber(output, time.tm_min, 2);
+  *output++ = ':';
+  output = FormatNumber(output, time.tm_sec, 2);
+  *output++ = 'Z';
+  return std::string(buffer, output);
+}
+
+std::optional<int64_t> ParseHttpDate(std::string_view str) {
+  std::tm time = {};
+  auto consume_name = [&](std::span<const std::string_view> names,
+                          int* index) {
+    for (size_t i = 0; i < names.size(); i++) {
+      if (ConsumePrefix(str, names[i])) {
+        *index = static_cast<int>(i);
+        return true;
+      }
+    }
+    return false;
+  };
+  int day_of_week;
+  std::optional<int> day, year, hour, minute, second;
+  if (consume_name(kDayNames, &day_of_week) && ConsumePrefix(str, ", ") &&
+      (day = ConsumeFixedNumber(str, 2)) && ConsumePrefix(str, " ") &&
+      consume_name(kMonthNames, &time.tm_mon) && ConsumePrefix(str, " ") &&
+      (year = ConsumeFixedNumber(str, 4)) && ConsumePrefix(str, " ") &&
+      (hour = ConsumeFixedNumber(str, 2)) && ConsumePrefix(str, ":") &&
+      (minute = ConsumeFixedNumber(str, 2)) && ConsumePrefix(str, ":") &&
+      (second = ConsumeFixedNumber(str, 2)) && str == " GMT" &&
+      *year >= 1900) {
+    time.tm_year = *year - 1900;
+    time.tm_mday = *day;
+    time.tm_hour = *hour;
+    time.tm_min = *minute;
+    time.tm_sec = *second;
+    if (IsValidTime(time)) {
+      return timegm(time);
+    }
+  }
+  return std::nullopt;
+}
+
+std::string ToHttpDate(time_t timestamp) {
+  std::tm time = http::gmtime(timestamp);
+  char buffer[std::string_view("Sun, 06 Nov 1994 08:49:37 GMT").size()];
+  char* output = FormatString(buffer, kDayNames[time.tm_wday]);
+  output = FormatString(output, ", ");
+  output = FormatNumber(output, time.tm_mday, 2);
+  *output++ = ' ';
+  output = FormatString(output, kMonthNames[time.tm_mon]);
+  *output++ = ' ';
+  output = FormatNumber(output, time.tm_year + 1900, 4);
+  *output++ = ' ';
+  output = FormatNumber(output, time.tm_hour, 2);
+  *output++ = ':';
+  output = FormatNumber(output, time.tm_min, 2);
+  *output++ = ':';
+  output = FormatNumber(output, time.tm_sec, 2);
+  output = FormatString(output, " GMT");
+  return std::string(buffer, output);
 }
 
 Method ToMethod(std::string_view method) {
@@ -436,7 +734,10 @@ Method ToMethod(std::string_view method) {
   }
 }
 
-std::string_view ToStatusString(int http_code) {
+namespace {
+
+// Empty for unknown codes.
+std::string_view GetReasonPhrase(int http_code) {
   switch (http_code) {
     case 100:
       return "Continue";
@@ -555,25 +856,105 @@ std::string_view ToStatusString(int http_code) {
     case 511:
       return "Network Authentication Required";
     default:
-      throw HttpException(http_code, "unknown http code");
+      return {};
+  }
+}
+
+}  // namespace
+
+std::string_view ToStatusString(int http_code) {
+  std::string_view reason = GetReasonPhrase(http_code);
+  if (reason.empty()) {
+    throw HttpException(http_code, "unknown http code");
+  }
+  return reason;
+}
+
+void AppendStatusLine(std::string& output, int http_code) {
+  constexpr int kMinCode = 100;
+  constexpr int kMaxCode = 599;
+  static const auto kStatusLines = [] {
+    std::array<std::string, kMaxCode - kMinCode + 1> lines;
+    for (int code = kMinCode; code <= kMaxCode; code++) {
+      if (std::string_view reason = GetReasonPhrase(code); !reason.empty()) {
+        lines[code - kMinCode] = "HTTP/1.1 " + std::to_string(code) + " " +
+                                 std::string(reason) + "\r\n";
+      }
+    }
+    return lines;
+  }();
+  if (http_code >= kMinCode && http_code <= kMaxCode &&
+      !kStatusLines[http_code - kMinCode].empty()) {
+    output += kStatusLines[http_code - kMinCode];
+    return;
+  }
+  std::string_view reason = ToStatusString(http_code);
+  output += "HTTP/1.1 ";
+  output += std::to_string(http_code);
+  output += ' ';
+  output += reason;
+  output += "\r\n";
+}
+
+std::string_view GetCurrentHttpDate() {
+  struct CachedDate {
+    time_t timestamp = -1;
+    std::string date;
+  };
+  thread_local CachedDate cached;
+  if (time_t now = std::time(nullptr); now != cached.timestamp) {
+    cached.timestamp = now;
+    cached.date = ToHttpDate(now);
   }
+  return cached.date;
+}
+
+void AppendChunkSize(std::string& output, uint64_t chunk_size) {
+  char buffer[std::numeric_limits<uint64_t>::digits / 4 + 2];
+  char* end = std::to_chars(buffer, buffer + sizeof(buffer), chunk_size,
+                            /*base=*/16)
+                  .ptr;
+  *end++ = '\r';
+  *end++ = '\n';
+  output.append(buffer, end);
 }
 
 std::pair<std::string, std::string> ToRangeHeader(const Range& range) {
-  std::stringstream range_header;
-  range_header << "bytes=" << range.start << "-";
+  std::string range_header = "bytes=" + std::to_string(range.start) + "-";
   if (range.end) {
-    range_header << *range.end;
+    range_header += std::to_string(*range.end);
+  }
+  return {"Range", std::move(range_header)};
+}
+
+std::optional<std::string_view> FindCookie(std::string_view cookie_str,
+                                           std::string_view name) {
+  while (!cookie_str.empty()) {
+    size_t separator = cookie_str.find(';');
+    std::string_view cookie =
+        TrimOptionalWhitespace(cookie_str.substr(0, separator));
+    size_t equals = cookie.find('=');
+    if (equals != std::string_view::npos &&
+        TrimOptionalWhitespace(cookie.substr(0, equals)) == name) {
+      std::string_view value =
+          TrimOptionalWhitespace(cookie.substr(equals + 1));
+      if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
+      }
+      return value;
+    }
+    if (separator == std::string_view::npos) {
+      break;
+    }
+    cookie_str.remove_prefix(separator + 1);
   }
-  return {"Range", std::move(range_header).str()};
+  return std::nullopt;
 }
 
 std::optional<std::string> GetCookie(std::string_view cookie_str,
                                      std::string_view name) {
-  re::regex regex(std::string(name) + R"(=([^;]*);?)");
-  re::match_results<std::string_view::const_iterator> match;
-  if (re::regex_search(cookie_str.begin(), cookie_str.end(), match, regex)) {
-    return DecodeUri(match[1].str());
+  if (auto value = FindCookie(cookie_str, name)) {
+    return DecodeUri(*value);
   } else {
     return std::nullopt;
   }
@@ -582,7 +963,7 @@ std::optional<std::string> GetCookie(std::string_view cookie_str,
 std::optional<std::string> GetCookie(
     std::span<const std::pair<std::string, std::string>> headers,
     std::string_view name) {
-  if (auto cookie = GetHeader(headers, "Cookie")) {
+  if (auto cookie = FindHeader(headers, "Cookie")) {
     return GetCookie(*cookie, name);
   } else {
     return std::nullopt;
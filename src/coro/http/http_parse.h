@@ -7,6 +7,7 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace coro::http {
 
@@ -53,7 +54,15 @@ std::string FormDataToString(const List& params) {
   return result;
 }
 
+// Parses a single `bytes=start-[end]` range; returns Range{} if malformed.
 Range ParseRange(std::string_view);
+// Parses a Range header holding a list of `start-[end]` byte ranges into
+// `ranges`, without allocating. Returns the number of ranges, or nullopt if
+// the header is malformed, has more ranges than fit or has a suffix range
+// (`-length`), which Range can't represent.
+std::optional<size_t> ParseRanges(std::string_view, std::span<Range> ranges);
+// As above; returns no ranges if the header can't be parsed.
+std::vector<Range> ParseRanges(std::string_view);
 std::string ToLowerCase(std::string);
 std::string TrimWhitespace(std::string_view);
 std::string GetExtension(std::string_view filename);
@@ -61,36 +70,81 @@ std::string GetMimeType(std::string_view extension);
 std::string MimeTypeToExtension(std::string_view mime_type);
 std::string ToBase64(std::string_view);
 std::string FromBase64(std::string_view);
+// Parses an RFC 3339 timestamp, such as `2021-04-01T12:30:00.5+02:00`.
 int64_t ParseTime(std::string_view);
 std::string ToTimeString(time_t);
+// Parses an IMF-fixdate, such as `Sun, 06 Nov 1994 08:49:37 GMT`, the format
+// of HTTP dates. The obsolete RFC 850 and asctime formats aren't accepted.
+std::optional<int64_t> ParseHttpDate(std::string_view);
+std::string ToHttpDate(time_t);
 std::string_view ToStatusString(int http_code);
+// Appends "HTTP/1.1 <code> <reason>\r\n"; preformatted for known codes.
+void AppendStatusLine(std::string& output, int http_code);
+// ToHttpDate of the current time, formatted at most once a second per
+// thread. Valid until the next call on the same thread.
+std::string_view GetCurrentHttpDate();
+// Appends the size line of a chunk of the chunked transfer coding, such as
+// "1a2\r\n".
+void AppendChunkSize(std::string& output, uint64_t chunk_size);
 Method ToMethod(std::string_view method);
 std::pair<std::string, std::string> ToRangeHeader(const Range&);
+// Returns a view of the raw value of the cookie `name` in a Cookie header,
+// without allocating.
+std::optional<std::string_view> FindCookie(std::string_view cookie_str,
+                                           std::string_view name);
+// Returns the percent-decoded value of the cookie `name`.
 std::optional<std::string> GetCookie(std::string_view cookie_str,
                                      std::string_view name);
 std::optional<std::string> GetCookie(
     std::span<const std::pair<std::string, std::string>> headers,
     std::string_view name);
 
+constexpr char ToLowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Compares ASCII strings, such as header names, ignoring case.
+constexpr bool EqualsIgnoreCase(std::string_view s1, std::string_view s2) {
+  if (s1.size() != s2.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < s1.size(); i++) {
+    if (ToLowerAscii(s1[i]) != ToLowerAscii(s2[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a view of the value of the first header named `requested_header`,
+// without allocating.
 template <typename Collection>
-std::optional<std::string> GetHeader(const Collection& collection,
-                                     std::string requested_header) {
+std::optional<std::string_view> FindHeader(const Collection& collection,
+                                           std::string_view requested_header) {
   for (const auto& [header, value] : collection) {
-    if (ToLowerCase(header) == ToLowerCase(requested_header)) {
-      return value;
+    if (EqualsIgnoreCase(header, requested_header)) {
+      return std::string_view(value);
     }
   }
   return std::nullopt;
 }
 
+template <typename Collection>
+std::optional<std::string> GetHeader(const Collection& collection,
+                                     std::string_view requested_header) {
+  if (auto value = FindHeader(collection, requested_header)) {
+    return std::string(*value);
+  }
+  return std::nullopt;
+}
+
 template <typename Container>
 bool HasHeader(const Container& container, std::string_view key,
                std::string_view value) {
   for (const auto& [ckey, cvalue] : container) {
-    if (ToLowerCase(ckey) == ToLowerCase(std::string(key))) {
-      if (cvalue.find(value) != std::string::npos) {
-        return true;
-      }
+    if (EqualsIgnoreCase(ckey, key) &&
+        std::string_view(cvalue).find(value) != std::string_view::npos) {
+      return true;
     }
   }
   return false;
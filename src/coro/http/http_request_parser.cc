@@ -0,0 +1,155 @@
+#include "coro/http/http_request_parser.h"
+
+#include <array>
+#include <cstring>
+#include <utility>
+
+#include "coro/http/http_exception.h"
+
+namespace coro::http {
+
+namespace {
+
+constexpr std::array<bool, 256> kTokenChars = [] {
+  std::array<bool, 256> chars{};
+  for (int c = 0; c < 256; c++) {
+    chars[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9');
+  }
+  for (char c : std::string_view("!#$%&'*+-.^_`|~")) {
+    chars[static_cast<uint8_t>(c)] = true;
+  }
+  return chars;
+}();
+
+bool IsTokenChar(char c) { return kTokenChars[static_cast<uint8_t>(c)]; }
+
+bool IsWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+}  // namespace
+
+size_t HttpRequestParser::Parse(std::string_view data) {
+  if (state_ == State::kDone) {
+    return 0;
+  }
+  // Nothing of this head has been buffered yet, so if `data` holds all of it,
+  // it doesn't need to be copied.
+  bool in_place = buffer_.empty();
+  if (in_place) {
+    head_ = data.data();
+  }
+  size_t consumed = 0;
+  while (state_ != State::kDone && consumed < data.size()) {
+    std::string_view rest = data.substr(consumed);
+    const auto* newline =
+        static_cast<const char*>(std::memchr(rest.data(), '\n', rest.size()));
+    size_t length = newline ? newline - rest.data() + 1 : rest.size();
+    if (head_size_ + length > max_head_size_) {
+      throw HttpException(HttpException::kRequestHeaderFieldsTooLarge);
+    }
+    if (!in_place) {
+      buffer_.append(rest.data(), length);
+      head_ = buffer_.data();
+    }
+    head_size_ += static_cast<uint32_t>(length);
+    consumed += length;
+    if (!newline) {
+      break;
+    }
+    ParseLine(std::exchange(line_begin_, head_size_), head_size_);
+  }
+  if (in_place && state_ != State::kDone && consumed > 0) {
+    // The rest of the head comes with later data; keep what's parsed so far,
+    // at the same offsets.
+    buffer_.assign(data.data(), consumed);
+    head_ = buffer_.data();
+  }
+  return consumed;
+}
+
+void HttpRequestParser::Reset() {
+  state_ = State::kRequestLine;
+  buffer_.clear();
+  head_ = nullptr;
+  head_size_ = 0;
+  line_begin_ = 0;
+  method_ = {};
+  url_ = {};
+  headers_.clear();
+}
+
+void HttpRequestParser::ParseLine(uint32_t begin, uint32_t end) {
+  end--;
+  if (end > begin && head_[end - 1] == '\r') {
+    end--;
+  }
+  switch (state_) {
+    case State::kRequestLine:
+      if (begin != end) {
+        ParseRequestLine(begin, end);
+        state_ = State::kHeaders;
+      }
+      break;
+    case State::kHeaders:
+      if (begin == end) {
+        state_ = State::kDone;
+      } else {
+        ParseHeaderField(begin, end);
+      }
+      break;
+    case State::kDone:
+      break;
+  }
+}
+
+void HttpRequestParser::ParseRequestLine(uint32_t begin, uint32_t end) {
+  std::string_view line(head_ + begin, end - begin);
+  size_t method_end = line.find(' ');
+  if (method_end == 0 || method_end == std::string_view::npos) {
+    throw HttpException(HttpException::kBadRequest, "malformed url");
+  }
+  for (size_t i = 0; i < method_end; i++) {
+    if (line[i] < 'A' || line[i] > 'Z') {
+      throw HttpException(HttpException::kBadRequest, "malformed url");
+    }
+  }
+  size_t url_end = line.find(' ', method_end + 1);
+  if (url_end == std::string_view::npos || url_end == method_end + 1) {
+    throw HttpException(HttpException::kBadRequest, "malformed url");
+  }
+  for (size_t i = method_end + 1; i < url_end; i++) {
+    if (static_cast<unsigned char>(line[i]) <= ' ' || line[i] == '\x7f') {
+      throw HttpException(HttpException::kBadRequest, "malformed url");
+    }
+  }
+  std::string_view version = line.substr(url_end + 1);
+  if (version != "HTTP/1.1" && version != "HTTP/1.0") {
+    throw HttpException(HttpException::kBadRequest, "malformed url");
+  }
+  method_ = {.offset = begin, .size = static_cast<uint32_t>(method_end)};
+  url_ = {.offset = static_cast<uint32_t>(begin + method_end + 1),
+          .size = static_cast<uint32_t>(url_end - method_end - 1)};
+}
+
+void HttpRequestParser::ParseHeaderField(uint32_t begin, uint32_t end) {
+  uint32_t name_end = begin;
+  while (name_end < end && IsTokenChar(head_[name_end])) {
+    name_end++;
+  }
+  if (name_end == begin || name_end == end || head_[name_end] != ':') {
+    throw HttpException(HttpException::kBadRequest, "malformed header");
+  }
+  uint32_t value_begin = name_end + 1;
+  while (value_begin < end && IsWhitespace(head_[value_begin])) {
+    value_begin++;
+  }
+  uint32_t value_end = end;
+  while (value_end > value_begin && IsWhitespace(head_[value_end - 1])) {
+    value_end--;
+  }
+  headers_.push_back(
+      Field{.name = {.offset = begin, .size = name_end - begin},
+            .value = {.offset = value_begin, .size = value_end - value_begin}});
+}
+
+}  // namespace coro::http
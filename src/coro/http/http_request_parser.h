@@ -0,0 +1,84 @@
+#ifndef CORO_HTTP_HTTP_REQUEST_PARSER_H
+#define CORO_HTTP_HTTP_REQUEST_PARSER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coro::http {
+
+// Incremental parser of an HTTP/1.1 request head (request line and header
+// fields). Data can be fed in arbitrary pieces, as it arrives on the
+// connection. A head which arrives whole is parsed in place and its fields are
+// views into the data passed to Parse; otherwise its pieces are gathered in
+// the parser's own buffer, which is reused between requests of a connection.
+class HttpRequestParser {
+ public:
+  static constexpr size_t kDefaultMaxHeadSize = 16384;
+
+  struct HeaderField {
+    std::string_view name;
+    std::string_view value;
+  };
+
+  explicit HttpRequestParser(size_t max_head_size = kDefaultMaxHeadSize)
+      : max_head_size_(max_head_size) {}
+
+  // Consumes bytes of `data` up to and including the empty line terminating
+  // the request head. Returns the number of consumed bytes; whatever follows
+  // the head is left for the caller. Throws HttpException on malformed or too
+  // large input.
+  size_t Parse(std::string_view data);
+
+  bool done() const { return state_ == State::kDone; }
+
+  // Valid only once done() returns true, until the next call to Reset() and,
+  // if the head was parsed in place, while the data passed to Parse is.
+  std::string_view method() const { return View(method_); }
+  std::string_view url() const { return View(url_); }
+  size_t header_count() const { return headers_.size(); }
+  HeaderField header(size_t index) const {
+    return {View(headers_[index].name), View(headers_[index].value)};
+  }
+
+  // Prepares the parser for the next request, keeping allocated memory.
+  void Reset();
+
+ private:
+  enum class State { kRequestLine, kHeaders, kDone };
+
+  struct Slice {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+  };
+
+  struct Field {
+    Slice name;
+    Slice value;
+  };
+
+  void ParseLine(uint32_t begin, uint32_t end);
+  void ParseRequestLine(uint32_t begin, uint32_t end);
+  void ParseHeaderField(uint32_t begin, uint32_t end);
+
+  std::string_view View(Slice slice) const {
+    return std::string_view(head_ + slice.offset, slice.size);
+  }
+
+  size_t max_head_size_;
+  State state_ = State::kRequestLine;
+  std::string buffer_;
+  // Start of the head, either in the caller's data or in `buffer_`. Slices
+  // are offsets from here.
+  const char* head_ = nullptr;
+  uint32_t head_size_ = 0;
+  uint32_t line_begin_ = 0;
+  Slice method_;
+  Slice url_;
+  std::vector<Field> headers_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP_REQUEST_PARSER_H
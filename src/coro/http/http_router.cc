@@ -0,0 +1,205 @@
+#include "coro/http/http_router.h"
+
+#include "coro/exception.h"
+
+namespace coro::http {
+
+namespace {
+
+struct PatternSegment {
+  enum class Kind { kLiteral, kParam, kRest } kind;
+  std::string_view value;
+};
+
+PatternSegment ParseSegment(std::string_view segment) {
+  if (segment.empty() || segment.front() != '{') {
+    if (segment.find_first_of("{}") != std::string_view::npos) {
+      throw InvalidArgument("Invalid route segment " + std::string(segment));
+    }
+    return {.kind = PatternSegment::Kind::kLiteral, .value = segment};
+  }
+  if (segment.back() != '}' || segment.size() < 3) {
+    throw InvalidArgument("Invalid route segment " + std::string(segment));
+  }
+  std::string_view name = segment.substr(1, segment.size() - 2);
+  if (name.ends_with("...")) {
+    name.remove_suffix(3);
+    if (name.empty()) {
+      throw InvalidArgument("Invalid route segment " + std::string(segment));
+    }
+    return {.kind = PatternSegment::Kind::kRest, .value = name};
+  }
+  return {.kind = PatternSegment::Kind::kParam, .value = name};
+}
+
+// Splits off the first segment of `path`; the rest is empty if there's no
+// segment after it.
+std::pair<std::string_view, std::optional<std::string_view>> SplitSegment(
+    std::string_view path) {
+  size_t slash = path.find('/');
+  if (slash == std::string_view::npos) {
+    return {path, std::nullopt};
+  }
+  return {path.substr(0, slash), path.substr(slash + 1)};
+}
+
+Response<> CreateResponse(int status,
+                          std::vector<std::pair<std::string, std::string>>
+                              headers = {}) {
+  return Response<>{.status = status,
+                    .headers = std::move(headers),
+                    .body = CreateBody(std::string())};
+}
+
+}  // namespace
+
+HttpRouter::HttpRouter() : nodes_(1) {}
+
+HttpRouter& HttpRouter::Add(Method method, std::string_view pattern,
+                            RouteHandler handler) {
+  if (!pattern.starts_with('/')) {
+    throw InvalidArgument("Route " + std::string(pattern) +
+                          " doesn't start with /.");
+  }
+  size_t node = 0;
+  int param_count = 0;
+  std::optional<std::string_view> rest = pattern.substr(1);
+  while (rest) {
+    auto [segment, next] = SplitSegment(*rest);
+    if (next && ParseSegment(segment).kind == PatternSegment::Kind::kRest) {
+      throw InvalidArgument("Route " + std::string(pattern) +
+                            " continues after a rest parameter.");
+    }
+    node = GetChild(node, segment, &param_count);
+    rest = next;
+  }
+  std::optional<size_t>& index =
+      nodes_[node].handlers[static_cast<size_t>(method)];
+  if (index) {
+    throw InvalidArgument("Route " + std::string(MethodToString(method)) +
+                          " " + std::string(pattern) + " already exists.");
+  }
+  index = handlers_.size();
+  handlers_.push_back(std::move(handler));
+  nodes_[node].methods |= GetMethodBit(method);
+  return *this;
+}
+
+HttpRouter& HttpRouter::SetFallback(HttpHandler handler) {
+  fallback_ = std::move(handler);
+  return *this;
+}
+
+size_t HttpRouter::GetChild(size_t node, std::string_view segment,
+                            int* param_count) {
+  PatternSegment parsed = ParseSegment(segment);
+  auto get_param_child = [&](std::optional<size_t> Node::*child) {
+    if (++*param_count > static_cast<int>(kMaxPathParams)) {
+      throw InvalidArgument("Too many route parameters.");
+    }
+    if (!(nodes_[node].*child)) {
+      nodes_[node].*child = nodes_.size();
+      nodes_.emplace_back().param_name = parsed.value;
+    } else if (nodes_[*(nodes_[node].*child)].param_name != parsed.value) {
+      throw InvalidArgument("Conflicting names of route parameter " +
+                            std::string(parsed.value) + ".");
+    }
+    return *(nodes_[node].*child);
+  };
+  switch (parsed.kind) {
+    case PatternSegment::Kind::kLiteral: {
+      auto it = nodes_[node].children.find(parsed.value);
+      if (it != nodes_[node].children.end()) {
+        return it->second;
+      }
+      size_t child = nodes_.size();
+      nodes_[node].children.emplace(std::string(parsed.value), child);
+      nodes_.emplace_back();
+      return child;
+    }
+    case PatternSegment::Kind::kParam:
+      return get_param_child(&Node::param_child);
+    case PatternSegment::Kind::kRest:
+      return get_param_child(&Node::rest_child);
+  }
+  throw InvalidArgument("Invalid route segment.");
+}
+
+std::optional<size_t> HttpRouter::Match(size_t node,
+                                        std::optional<std::string_view> path,
+                                        Method method, PathParams* params,
+                                        uint32_t* allowed_methods) const {
+  const Node& current = nodes_[node];
+  if (!path) {
+    return Accept(node, method, allowed_methods);
+  }
+  auto [segment, rest] = SplitSegment(*path);
+  if (auto it = current.children.find(segment);
+      it != current.children.end()) {
+    if (auto match = Match(it->second, rest, method, params, allowed_methods)) {
+      return match;
+    }
+  }
+  if (current.param_child && !segment.empty()) {
+    const Node& child = nodes_[*current.param_child];
+    params->Push(child.param_name, segment);
+    if (auto match = Match(*current.param_child, rest, method, params,
+                           allowed_methods)) {
+      return match;
+    }
+    params->Pop();
+  }
+  if (current.rest_child) {
+    if (auto match = Accept(*current.rest_child, method, allowed_methods)) {
+      params->Push(nodes_[*current.rest_child].param_name, *path);
+      return match;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<size_t> HttpRouter::Accept(size_t node, Method method,
+                                         uint32_t* allowed_methods) const {
+  const Node& current = nodes_[node];
+  *allowed_methods |= current.methods;
+  if (current.methods & GetMethodBit(method)) {
+    return node;
+  }
+  return std::nullopt;
+}
+
+Task<Response<>> HttpRouter::operator()(Request<> request,
+                                        stdx::stop_token stop_token) {
+  std::string_view path = request.url;
+  path = path.substr(0, path.find_first_of("?#"));
+  PathParams params;
+  std::optional<size_t> node;
+  uint32_t allowed_methods = 0;
+  if (path.starts_with('/')) {
+    node = Match(0, path.substr(1), request.method, &params, &allowed_methods);
+  }
+  if (node) {
+    size_t index = *nodes_[*node].handlers[static_cast<size_t>(request.method)];
+    co_return co_await handlers_[index](request, params,
+                                        std::move(stop_token));
+  }
+  if (allowed_methods == 0) {
+    if (fallback_) {
+      co_return co_await (*fallback_)(std::move(request),
+                                      std::move(stop_token));
+    }
+    co_return CreateResponse(404);
+  }
+  std::string allow;
+  for (size_t method = 0; method < kMethodCount; method++) {
+    if (allowed_methods & GetMethodBit(static_cast<Method>(method))) {
+      if (!allow.empty()) {
+        allow += ", ";
+      }
+      allow += MethodToString(static_cast<Method>(method));
+    }
+  }
+  co_return CreateResponse(405, {{"Allow", std::move(allow)}});
+}
+
+}  // namespace coro::http
@@ -0,0 +1,132 @@
+#ifndef CORO_HTTP_HTTP_ROUTER_H
+#define CORO_HTTP_HTTP_ROUTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/http/http_server.h"
+#include "coro/stdx/any_invocable.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::http {
+
+inline constexpr size_t kMaxPathParams = 8;
+
+// Path parameters of a routed request. Names point into the router and values
+// into the request's url, so both are only valid while the route handler
+// runs.
+class PathParams {
+ public:
+  std::optional<std::string_view> Get(std::string_view name) const {
+    for (size_t i = 0; i < size_; i++) {
+      if (params_[i].first == name) {
+        return params_[i].second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  friend class HttpRouter;
+
+  void Push(std::string_view name, std::string_view value) {
+    params_[size_++] = {name, value};
+  }
+  void Pop() { size_--; }
+
+  std::array<std::pair<std::string_view, std::string_view>, kMaxPathParams>
+      params_;
+  size_t size_ = 0;
+};
+
+// The request is owned by the router for the duration of the handler, so that
+// the path parameters can refer to its url. Parts of it which outlive the
+// handler, like the body, have to be moved out.
+using RouteHandler = stdx::any_invocable<Task<Response<>>(
+    Request<>& request, const PathParams& params, stdx::stop_token)>;
+
+// Dispatches requests on their method and path, usable as the HttpHandler of
+// CreateHttpServer. Routes are kept in a trie of path segments, with literal
+// segments looked up by hash, so matching costs time proportional to the
+// length of the path rather than to the number of routes.
+//
+// A pattern is a path whose segments are literals, `{name}` matching any
+// nonempty segment, or, as the last segment, `{name...}` matching the rest of
+// the path. Literal segments take precedence over parameters, unless the
+// literal's route isn't there for the request's method. The query is
+// ignored and values are passed as sent, without percent-decoding. Routes
+// are added before the router starts serving requests.
+class HttpRouter {
+ public:
+  HttpRouter();
+
+  // Throws InvalidArgument if the pattern is malformed or already routed for
+  // `method`.
+  HttpRouter& Add(Method method, std::string_view pattern,
+                  RouteHandler handler);
+
+  // Serves requests whose path matches no route. Without one they get a 404
+  // response. Paths which match routes only for other methods get a 405
+  // response.
+  HttpRouter& SetFallback(HttpHandler handler);
+
+  Task<Response<>> operator()(Request<> request, stdx::stop_token stop_token);
+
+ private:
+  static constexpr size_t kMethodCount = static_cast<size_t>(Method::kCopy) + 1;
+
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  struct Node {
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>>
+        children;
+    std::optional<size_t> param_child;
+    std::optional<size_t> rest_child;
+    // Name of the parameter matched by this node, if it's a parameter.
+    std::string param_name;
+    std::array<std::optional<size_t>, kMethodCount> handlers;
+    // Bits of the methods with a handler, see GetMethodBit.
+    uint32_t methods = 0;
+  };
+
+  static uint32_t GetMethodBit(Method method) {
+    return uint32_t{1} << static_cast<size_t>(method);
+  }
+
+  size_t GetChild(size_t node, std::string_view segment, int* param_count);
+  // Finds the node of a route for `method` matching `path`, backtracking from
+  // literal segments to parameters. Adds the methods of every route matching
+  // `path` to `allowed_methods`.
+  std::optional<size_t> Match(size_t node,
+                              std::optional<std::string_view> path,
+                              Method method, PathParams* params,
+                              uint32_t* allowed_methods) const;
+  // Returns `node` if it has a route for `method`.
+  std::optional<size_t> Accept(size_t node, Method method,
+                               uint32_t* allowed_methods) const;
+
+  std::vector<Node> nodes_;
+  std::vector<RouteHandler> handlers_;
+  std::optional<HttpHandler> fallback_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_HTTP_ROUTER_H
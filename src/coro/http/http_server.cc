@@ -1,25 +1,172 @@
 #include "coro/http/http_server.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "coro/exception.h"
+#include "coro/http/admission_controller.h"
 #include "coro/http/http_parse.h"
-#include "coro/util/regex.h"
+#include "coro/http/http_request_parser.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/raii_utils.h"
 #include "coro/util/tcp_server.h"
 
+#ifdef CORO_HTTP_HAVE_NGHTTP2
+#include "coro/http/http2_server.h"
+#endif
+
 namespace coro::http {
 
 namespace {
 
 using ::coro::util::EventLoop;
+using ::coro::util::MultiThreadedTcpServer;
 using ::coro::util::TcpRequestDataProvider;
 using ::coro::util::TcpResponseChunk;
 using ::coro::util::TcpServer;
 
 constexpr int kMaxHeaderSize = 16384;
 
-namespace re = coro::util::re;
+// Reads request data of a connection in place, as characters.
+class RequestDataReader {
+ public:
+  explicit RequestDataReader(TcpRequestDataProvider provider)
+      : provider_(std::move(provider)) {}
+
+  // Returns readable data, waiting for at least one byte.
+  Task<std::string_view> Peek() {
+    std::span<const uint8_t> data = co_await provider_.Peek();
+    co_return std::string_view(reinterpret_cast<const char*>(data.data()),
+                               data.size());
+  }
+
+  void Consume(size_t byte_cnt) {
+    provider_.Consume(static_cast<uint32_t>(byte_cnt));
+    consumed_byte_cnt_ += byte_cnt;
+  }
+
+  uint64_t consumed_byte_cnt() const { return consumed_byte_cnt_; }
+
+  void SetReadDeadline(
+      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    provider_.SetReadDeadline(deadline);
+  }
+
+  // Hands the connection over, e.g. after a protocol upgrade.
+  TcpRequestDataProvider Release() && { return std::move(provider_); }
+
+  // Reads at least one and at most `max_byte_cnt` bytes.
+  Task<std::string> Read(size_t max_byte_cnt) {
+    std::string data((co_await Peek()).substr(0, max_byte_cnt));
+    Consume(data.size());
+    co_return data;
+  }
+
+  Task<std::string> ReadExactly(size_t byte_cnt) {
+    std::string data;
+    while (data.size() < byte_cnt) {
+      data += co_await Read(byte_cnt - data.size());
+    }
+    co_return data;
+  }
+
+ private:
+  TcpRequestDataProvider provider_;
+  uint64_t consumed_byte_cnt_ = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Progress of a request, recorded only when the server has metrics.
+struct RequestTrace {
+  Clock::time_point start;
+  Clock::time_point head_parsed;
+  Clock::time_point response_started;
+  std::string url;
+  Method method = Method::kGet;
+  int status = -1;
+  uint64_t bytes_received = 0;
+  uint64_t bytes_sent = 0;
+  int connection_request_index;
+};
+
+std::chrono::microseconds GetDuration(Clock::time_point start,
+                                      Clock::time_point end) {
+  if (end == Clock::time_point()) {
+    return std::chrono::microseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+}
+
+void FinishRequest(HttpServerMetrics* metrics, const RequestTrace& trace) {
+  Clock::time_point now = Clock::now();
+  metrics->OnRequestFinished(HttpRequestStats{
+      .url = trace.url,
+      .method = trace.method,
+      .status = trace.status,
+      .head_parse = GetDuration(trace.start, trace.head_parsed),
+      .time_to_first_byte = GetDuration(trace.start, trace.response_started),
+      .total = GetDuration(trace.start, now),
+      .bytes_received = trace.bytes_received,
+      .bytes_sent = trace.bytes_sent,
+      .connection_request_index = trace.connection_request_index});
+}
+
+// Route a request is grouped under unless HttpServerMetrics::Config has
+// `get_route`, standing for the string "<method> <path>".
+struct DefaultRoute {
+  std::string_view method;
+  std::string_view path;
+
+  friend bool operator==(const DefaultRoute& route, std::string_view name) {
+    return name.size() == route.method.size() + 1 + route.path.size() &&
+           name.starts_with(route.method) && name[route.method.size()] == ' ' &&
+           name.ends_with(route.path);
+  }
+};
+
+uint64_t HashBytes(std::string_view bytes,
+                   uint64_t hash = 14695981039346656037u) {
+  for (char c : bytes) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211u;
+  }
+  return hash;
+}
+
+// Hashes a DefaultRoute like the string it stands for, so that routes are
+// looked up without building it.
+struct RouteHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view name) const { return HashBytes(name); }
+  size_t operator()(const DefaultRoute& route) const {
+    return HashBytes(route.path, HashBytes(" ", HashBytes(route.method)));
+  }
+};
+
+std::string ToString(std::string_view name) { return std::string(name); }
+
+std::string ToString(const DefaultRoute& route) {
+  std::string name(route.method);
+  name += ' ';
+  name += route.path;
+  return name;
+}
+
+// Counters with a single writing thread, read concurrently by others.
+void Increment(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+std::atomic<uint64_t> next_metrics_id = 0;
 
 struct ErrorMetadata {
   int status;
@@ -44,24 +191,33 @@ ErrorMetadata GetErrorMetadata(std::exception_ptr e) {
   }
 }
 
-std::string ToString(std::span<const uint8_t> bytes) {
-  return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-}
-
 std::vector<uint8_t> ToByteArray(std::string_view bytes) {
   const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
   return std::vector<uint8_t>(data, data + bytes.size());
 }
 
-Generator<std::string> WrapGenerator(
-    Generator<std::string>& wrapped,
-    std::optional<Generator<std::string>::iterator>& it) {
-  if (!it) {
-    it = co_await wrapped.begin();
-  }
-  while (*it != wrapped.end()) {
-    co_yield std::move(**it);
-    co_await ++*it;
+// Body of a request, which the handler may leave unread.
+struct RequestBody {
+  Generator<util::BufferSlice> generator;
+  std::optional<Generator<util::BufferSlice>::iterator> it;
+  // Set once reading the body threw, e.g. on malformed chunk framing. It
+  // can't be read any further then and the rest of the connection's data
+  // can't be told apart from it.
+  bool failed = false;
+};
+
+Generator<util::BufferSlice> WrapGenerator(RequestBody& body) {
+  try {
+    if (!body.it) {
+      body.it = co_await body.generator.begin();
+    }
+    while (*body.it != body.generator.end()) {
+      co_yield std::move(**body.it);
+      co_await ++*body.it;
+    }
+  } catch (...) {
+    body.failed = true;
+    throw;
   }
 }
 
@@ -74,64 +230,80 @@ bool HasBody(int response_status, std::optional<uint64_t> content_length) {
   return HasBody(response_status) || (content_length && *content_length > 0);
 }
 
-bool IsChunked(std::span<const std::pair<std::string, std::string>> headers) {
-  return !GetHeader(headers, "Content-Length").has_value();
+std::string GetConnectionHeader(bool keep_alive) {
+  return keep_alive ? "keep-alive" : "close";
 }
 
-Task<std::string> GetHttpHeader(TcpRequestDataProvider& provider) {
-  std::string buffer;
-  while (!buffer.ends_with("\r\n\r\n")) {
-    if (buffer.size() >= kMaxHeaderSize) {
-      throw HttpException(HttpException::kRequestHeaderFieldsTooLarge);
-    }
-    std::vector<uint8_t> chunk = co_await provider(1);
-    buffer.push_back(static_cast<char>(chunk[0]));
-  }
-  co_return buffer;
+bool IsChunked(std::span<const std::pair<std::string, std::string>> headers) {
+  return !FindHeader(headers, "Content-Length").has_value();
 }
 
+// Adds a Date header unless the handler has set one.
 std::string GetHttpResponseHeader(
     int response_status,
     std::span<const std::pair<std::string, std::string>> headers) {
-  std::stringstream header;
-  header << "HTTP/1.1 " << response_status << " "
-         << ToStatusString(response_status) << "\r\n";
+  bool has_date = FindHeader(headers, "Date").has_value();
+  std::string_view date = has_date ? "" : GetCurrentHttpDate();
+  size_t size = std::string_view("HTTP/1.1 200 \r\nDate: \r\n\r\n").size() +
+                ToStatusString(response_status).size() + date.size();
+  for (const auto& [key, value] : headers) {
+    size += key.size() + value.size() + 4;
+  }
+  std::string header;
+  header.reserve(size);
+  AppendStatusLine(header, response_status);
+  if (!has_date) {
+    header += "Date: ";
+    header += date;
+    header += "\r\n";
+  }
   for (const auto& [key, value] : headers) {
-    header << key << ": " << value << "\r\n";
+    header += key;
+    header += ": ";
+    header += value;
+    header += "\r\n";
   }
-  header << "\r\n";
-  return std::move(header).str();
+  header += "\r\n";
+  return header;
 }
 
-Generator<std::string> GetRequestBody(TcpRequestDataProvider& provider,
-                                      uint64_t content_length) {
+Generator<util::BufferSlice> GetRequestBody(RequestDataReader& reader,
+                                            uint64_t content_length) {
   while (content_length > 0) {
-    auto chunk_length = static_cast<uint32_t>(std::min(
-        content_length, static_cast<uint64_t>(coro::util::kMaxBufferSize)));
-    co_yield ToString(co_await provider(chunk_length));
-    content_length -= chunk_length;
+    std::string chunk = co_await reader.Read(static_cast<size_t>(std::min(
+        content_length, static_cast<uint64_t>(coro::util::kMaxBufferSize))));
+    content_length -= chunk.size();
+    co_yield std::move(chunk);
   }
 }
 
-Generator<std::string> GetChunkedRequestBody(TcpRequestDataProvider& provider) {
-  while (true) {
-    std::string buffer;
-    while (!buffer.ends_with("\r\n")) {
-      buffer.push_back(static_cast<char>((co_await provider(1))[0]));
-      if (buffer.size() >= 8) {
-        throw HttpException(HttpException::kBadRequest, "too big chunk length");
-      }
+Task<uint64_t> GetChunkLength(RequestDataReader& reader) {
+  std::string buffer;
+  while (!buffer.ends_with("\r\n")) {
+    std::string_view data = co_await reader.Peek();
+    size_t pos = data.find('\n');
+    size_t length = pos == std::string_view::npos ? data.size() : pos + 1;
+    if (buffer.size() + length >= 8) {
+      throw HttpException(HttpException::kBadRequest, "too big chunk length");
     }
-    uint64_t chunk_length =
-        std::stoull(buffer.data(), /*pos=*/nullptr, /*base=*/16);
+    buffer += data.substr(0, length);
+    reader.Consume(length);
+  }
+  co_return std::stoull(buffer.data(), /*pos=*/nullptr, /*base=*/16);
+}
+
+Generator<util::BufferSlice> GetChunkedRequestBody(
+    RequestDataReader& reader) {
+  while (true) {
+    uint64_t chunk_length = co_await GetChunkLength(reader);
     bool last_chunk = chunk_length == 0;
     while (chunk_length > 0) {
-      auto piece_length = static_cast<uint32_t>(std::min(
-          chunk_length, static_cast<uint64_t>(coro::util::kMaxBufferSize)));
-      co_yield ToString(co_await provider(piece_length));
-      chunk_length -= piece_length;
+      std::string piece = co_await reader.Read(static_cast<size_t>(std::min(
+          chunk_length, static_cast<uint64_t>(coro::util::kMaxBufferSize))));
+      chunk_length -= piece.size();
+      co_yield std::move(piece);
     }
-    if (ToString(co_await provider(2)) != "\r\n") {
+    if (co_await reader.ReadExactly(2) != "\r\n") {
       throw HttpException(HttpException::kBadRequest,
                           "invalid chunk delimiter");
     }
@@ -141,76 +313,87 @@ Generator<std::string> GetChunkedRequestBody(TcpRequestDataProvider& provider) {
   }
 }
 
-std::optional<Generator<std::string>> GetHttpRequestBody(
-    TcpRequestDataProvider& provider,
+std::optional<Generator<util::BufferSlice>> GetHttpRequestBody(
+    RequestDataReader& reader,
     std::span<const std::pair<std::string, std::string>> headers) {
-  auto transfer_encoding = GetHeader(headers, "Transfer-Encoding");
-  if (transfer_encoding &&
-      transfer_encoding->find("chunked") != std::string::npos) {
-    return GetChunkedRequestBody(provider);
-  } else if (auto content_length = GetHeader(headers, "Content-Length")) {
-    return GetRequestBody(provider, std::stoull(*content_length));
+  if (HasHeader(headers, "Transfer-Encoding", "chunked")) {
+    return GetChunkedRequestBody(reader);
+  } else if (auto content_length = FindHeader(headers, "Content-Length")) {
+    return GetRequestBody(reader, std::stoull(std::string(*content_length)));
   } else {
     return std::nullopt;
   }
 }
 
-Request<> GetHttpRequest(std::string_view http_header) {
-  Request<> request{};
-  size_t idx = 0;
-  while (idx < http_header.size()) {
-    size_t len = 0;
-    while (idx + len < http_header.size() &&
-           !std::string_view(http_header.data() + idx, len).ends_with("\r\n")) {
-      len++;
+// Reads the request's head, which has to arrive within `head_timeout` of its
+// first byte unless that's 0.
+Task<Request<>> GetHttpRequest(RequestDataReader& reader,
+                               HttpRequestParser& parser,
+                               std::chrono::milliseconds head_timeout) {
+  parser.Reset();
+  if (head_timeout.count() > 0) {
+    // Idling before the first byte is up to the read timeout.
+    co_await reader.Peek();
+    reader.SetReadDeadline(Clock::now() + head_timeout);
+  }
+  auto deadline_guard = coro::util::AtScopeExit([&] {
+    if (head_timeout.count() > 0) {
+      reader.SetReadDeadline(std::nullopt);
     }
-    std::string_view line(http_header.data() + idx, len - strlen("\r\n"));
-    if (idx == 0) {
-      re::regex regex(R"(([A-Z]+) (\S+) HTTP\/1\.[01])");
-      re::match_results<std::string_view::const_iterator> match;
-      if (re::regex_match(line.begin(), line.end(), match, regex)) {
-        request.method = ToMethod(match[1].str());
-        request.url = match[2].str();
-      } else {
-        throw HttpException(HttpException::kBadRequest, "malformed url");
-      }
-    } else if (!line.empty()) {
-      re::regex regex(R"((\S+):\s*(.+)$)");
-      re::match_results<std::string_view::const_iterator> match;
-      if (re::regex_match(line.begin(), line.end(), match, regex)) {
-        request.headers.emplace_back(match[1], match[2]);
-      } else {
-        throw HttpException(HttpException::kBadRequest, "malformed header");
-      }
+  });
+  while (true) {
+    std::string_view data = co_await reader.Peek();
+    size_t consumed = parser.Parse(data);
+    if (!parser.done()) {
+      reader.Consume(consumed);
+      continue;
+    }
+    // The parsed fields may be views into `data`, which consuming it
+    // invalidates.
+    Request<> request{};
+    request.method = ToMethod(parser.method());
+    request.url = parser.url();
+    request.headers.reserve(parser.header_count());
+    for (size_t i = 0; i < parser.header_count(); i++) {
+      auto [name, value] = parser.header(i);
+      request.headers.emplace_back(name, value);
     }
-    idx += len;
+    reader.Consume(consumed);
+    co_return request;
   }
-  return request;
 }
 
-Task<> DrainRequestBody(Generator<std::string>& body,
-                        std::optional<Generator<std::string>::iterator>& it) {
-  if (!it) {
-    it = co_await body.begin();
+// Throws InterruptedException if the body failed, so that the connection is
+// closed.
+Task<> DrainRequestBody(RequestBody& body) {
+  if (body.failed) {
+    throw InterruptedException();
   }
-  while (*it != body.end()) {
-    co_await ++*it;
+  if (!body.it) {
+    body.it = co_await body.generator.begin();
+  }
+  while (*body.it != body.generator.end()) {
+    co_await ++*body.it;
   }
 }
 
-Generator<std::string> GetResponseChunk(bool is_chunked, std::string chunk) {
-  if (is_chunked) {
-    std::string length = [&] {
-      std::stringstream stream;
-      stream << std::hex << chunk.size() << "\r\n";
-      return std::move(stream).str();
-    }();
-    co_yield length;
-    co_yield std::move(chunk);
-    co_yield "\r\n";
-  } else {
-    co_yield std::move(chunk);
-  }
+// Chunks up to this size are framed for the chunked transfer coding in a
+// single copy; larger ones are sent between their framing without copying.
+constexpr size_t kMaxFramedChunkSize = 1024;
+
+std::string FrameChunk(std::string_view chunk) {
+  std::string framed;
+  framed.reserve(chunk.size() + 20);
+  AppendChunkSize(framed, chunk.size());
+  framed += chunk;
+  framed += "\r\n";
+  return framed;
+}
+
+std::string GetChunkSizeLine(uint64_t chunk_size) {
+  std::string line;
+  AppendChunkSize(line, chunk_size);
+  return line;
 }
 
 std::string GetErrorMessage(const ErrorMetadata& e) {
@@ -227,26 +410,158 @@ std::string GetErrorMessage(const ErrorMetadata& e) {
 struct HttpHandlerT {
   Generator<TcpResponseChunk> operator()(TcpRequestDataProvider provider,
                                          stdx::stop_token stop_token) {
+#ifdef CORO_HTTP_HAVE_NGHTTP2
+    if (config.enable_http2 && co_await IsHttp2Connection(provider)) {
+      FOR_CO_AWAIT(TcpResponseChunk chunk,
+                   ServeHttp2Connection(&http_handler, std::move(provider),
+                                        std::move(stop_token), metrics,
+                                        admission.get(), config.http2)) {
+        co_yield std::move(chunk);
+      }
+      throw InterruptedException();
+    }
+#endif
+    std::string_view client = provider.peer_address();
+    RequestDataReader reader(std::move(provider));
+    HttpRequestParser parser(kMaxHeaderSize);
+    if (!metrics) {
+      for (int index = 0;; index++) {
+        bool keep_alive = IsKeepAliveAllowed(index);
+        FOR_CO_AWAIT(TcpResponseChunk chunk,
+                     HandleRequest(reader, parser, client, stop_token,
+                                   /*trace=*/nullptr, &keep_alive)) {
+          co_yield std::move(chunk);
+        }
+        if (!keep_alive) {
+          throw InterruptedException();
+        }
+      }
+    }
+    metrics->OnConnectionOpened();
+    auto connection_guard =
+        coro::util::AtScopeExit([metrics = metrics] {
+          metrics->OnConnectionClosed();
+        });
+    for (int index = 0;; index++) {
+      // Time spent idle on a kept-alive connection doesn't count.
+      co_await reader.Peek();
+      RequestTrace trace;
+      trace.start = Clock::now();
+      trace.connection_request_index = index;
+      uint64_t consumed_byte_cnt = reader.consumed_byte_cnt();
+      metrics->OnRequestStarted();
+      auto request_guard = coro::util::AtScopeExit([&] {
+        trace.bytes_received = reader.consumed_byte_cnt() - consumed_byte_cnt;
+        FinishRequest(metrics, trace);
+      });
+      bool keep_alive = IsKeepAliveAllowed(index);
+      FOR_CO_AWAIT(TcpResponseChunk chunk,
+                   HandleRequest(reader, parser, client, stop_token, &trace,
+                                 &keep_alive)) {
+        trace.bytes_sent += chunk.size();
+        co_yield std::move(chunk);
+      }
+      if (!keep_alive) {
+        // Closes the connection once the response is flushed.
+        throw InterruptedException();
+      }
+    }
+  }
+
+  bool IsKeepAliveAllowed(int request_index) const {
+    return config.max_requests_per_connection <= 0 ||
+           request_index + 1 < config.max_requests_per_connection;
+  }
+
+  // `keep_alive` is cleared if the client asks for the connection to be
+  // closed; if it ends up false, the response says the connection closes.
+  Generator<TcpResponseChunk> HandleRequest(RequestDataReader& reader,
+                                            HttpRequestParser& parser,
+                                            std::string_view client,
+                                            stdx::stop_token stop_token,
+                                            RequestTrace* trace,
+                                            bool* keep_alive) {
     std::exception_ptr exception;
     std::optional<http::Method> request_method;
-    std::optional<Generator<std::string>> request_body;
-    std::optional<Generator<std::string>::iterator> request_body_it;
+    std::optional<RequestBody> request_body;
     std::optional<bool> is_response_chunked;
     try {
-      auto request = GetHttpRequest(co_await GetHttpHeader(provider));
+      auto request =
+          co_await GetHttpRequest(reader, parser, config.request_head_timeout);
       request_method = request.method;
-      request_body = GetHttpRequestBody(provider, request.headers);
+      if (trace) {
+        trace->head_parsed = Clock::now();
+        trace->url = request.url;
+        trace->method = request.method;
+      }
+      if (HasHeader(request.headers, "Connection", "close")) {
+        *keep_alive = false;
+      }
+      if (auto body = GetHttpRequestBody(reader, request.headers)) {
+        request_body.emplace(RequestBody{.generator = std::move(*body)});
+      }
+      bool admitted = !admission;
+      auto admission_guard = coro::util::AtScopeExit([&] {
+        if (admission && admitted) {
+          admission->Release(client);
+        }
+      });
+      if (admission) {
+        admitted = co_await admission->Admit(client, stop_token);
+      }
+      if (!admitted) {
+        // Closes the connection rather than reading a body nobody wants.
+        if (request_body) {
+          *keep_alive = false;
+        }
+        if (trace) {
+          trace->status = 503;
+          trace->response_started = Clock::now();
+        }
+        std::vector<std::pair<std::string, std::string>> headers{
+            {"Retry-After", std::to_string(admission->retry_after().count())},
+            {"Content-Length", "0"},
+            {"Connection", GetConnectionHeader(*keep_alive)}};
+        co_yield GetHttpResponseHeader(503, headers);
+        co_return;
+      }
       if (request_body) {
-        request.body = WrapGenerator(*request_body, request_body_it);
+        request.body = WrapGenerator(*request_body);
       }
       if (HasHeader(request.headers, "Expect", "100-continue")) {
         co_yield std::string("HTTP/1.1 100 Continue\r\n\r\n");
       }
-      auto response =
-          co_await http_handler(std::move(request), std::move(stop_token));
+      auto response = co_await http_handler(std::move(request), stop_token);
+      if (response.websocket_handler) {
+        // A WebSocket may stay open indefinitely, so it doesn't count
+        // against the admission limits.
+        if (admission && admitted) {
+          admission->Release(client);
+          admitted = false;
+        }
+        if (trace) {
+          trace->status = response.status;
+          trace->response_started = Clock::now();
+        }
+        *keep_alive = false;
+        co_yield GetHttpResponseHeader(response.status, response.headers);
+        FOR_CO_AWAIT(TcpResponseChunk chunk,
+                     ServeWebSocketConnection(
+                         std::move(reader).Release(),
+                         std::move(response.websocket_handler),
+                         std::move(stop_token), config.websocket)) {
+          co_yield std::move(chunk);
+        }
+        co_return;
+      }
+      if (response.file_body &&
+          !FindHeader(response.headers, "Content-Length")) {
+        response.headers.emplace_back(
+            "Content-Length", std::to_string(response.file_body->size()));
+      }
       auto content_length = [&]() -> std::optional<uint64_t> {
-        if (auto header = GetHeader(response.headers, "Content-Length")) {
-          return std::stoull(*header);
+        if (auto header = FindHeader(response.headers, "Content-Length")) {
+          return std::stoull(std::string(*header));
         } else {
           return std::nullopt;
         }
@@ -257,27 +572,43 @@ struct HttpHandlerT {
       if (is_chunked && has_body) {
         response.headers.emplace_back("Transfer-Encoding", "chunked");
       }
-      response.headers.emplace_back("Connection", "keep-alive");
+      response.headers.emplace_back("Connection",
+                                    GetConnectionHeader(*keep_alive));
+      if (trace) {
+        trace->status = response.status;
+        trace->response_started = Clock::now();
+      }
       co_yield GetHttpResponseHeader(response.status, response.headers);
 
       if (request_method == Method::kHead || !has_body) {
         if (request_body) {
-          co_await DrainRequestBody(*request_body, request_body_it);
+          co_await DrainRequestBody(*request_body);
         }
         co_return;
       }
 
-      auto it = co_await response.body.begin();
-      while (it != response.body.end()) {
-        FOR_CO_AWAIT(std::string piece,
-                     GetResponseChunk(is_chunked, std::move(*it))) {
-          co_yield std::move(piece);
+      if (response.file_body) {
+        co_yield TcpResponseChunk(std::move(*response.file_body));
+      } else {
+        auto it = co_await response.body.begin();
+        while (it != response.body.end()) {
+          if (!is_chunked) {
+            co_yield std::move(*it);
+          } else if (it->empty()) {
+            // An empty chunk would end the chunked body.
+          } else if (it->size() <= kMaxFramedChunkSize) {
+            co_yield FrameChunk(*it);
+          } else {
+            co_yield GetChunkSizeLine(it->size());
+            co_yield std::move(*it);
+            co_yield std::string("\r\n");
+          }
+          co_await ++it;
         }
-        co_await ++it;
       }
 
       if (request_body) {
-        co_await DrainRequestBody(*request_body, request_body_it);
+        co_await DrainRequestBody(*request_body);
       }
 
       if (is_chunked) {
@@ -293,23 +624,24 @@ struct HttpHandlerT {
       std::rethrow_exception(exception);
       co_return;
     }
-    if (request_body) {
-      co_await DrainRequestBody(*request_body, request_body_it);
+    if (request_body && request_body->failed) {
+      *keep_alive = false;
+    } else if (request_body) {
+      co_await DrainRequestBody(*request_body);
     }
     ErrorMetadata error_metadata = GetErrorMetadata(exception);
     std::string formatted_message = GetErrorMessage(error_metadata);
     if (is_response_chunked && *is_response_chunked) {
-      FOR_CO_AWAIT(
-          std::string piece,
-          GetResponseChunk(/*is_chunked=*/true, std::move(formatted_message))) {
-        co_yield std::move(piece);
-      }
-      co_yield std::string("0\r\n\r\n");
+      co_yield FrameChunk(formatted_message) + "0\r\n\r\n";
       co_return;
     }
     std::vector<std::pair<std::string, std::string>> headers{
         {"Content-Length", std::to_string(formatted_message.size())},
-        {"Connection", "keep-alive"}};
+        {"Connection", GetConnectionHeader(*keep_alive)}};
+    if (trace) {
+      trace->status = error_metadata.status;
+      trace->response_started = Clock::now();
+    }
     co_yield GetHttpResponseHeader(error_metadata.status, headers);
     if (request_method != Method::kHead) {
       co_yield formatted_message;
@@ -317,15 +649,219 @@ struct HttpHandlerT {
   }
 
   HttpHandler http_handler;
+  HttpServerMetrics* metrics;
+  HttpServerConfig config;
+  std::unique_ptr<AdmissionController> admission;
 };
 
+void CheckHttpServerConfig(const HttpServerConfig& config) {
+  if (config.enable_http2 && !IsHttp2Supported()) {
+    throw InvalidArgument("coro-http was built without HTTP/2 support.");
+  }
+}
+
 }  // namespace
 
+bool IsHttp2Supported() {
+#ifdef CORO_HTTP_HAVE_NGHTTP2
+  return true;
+#else
+  return false;
+#endif
+}
+
+HttpServerMetrics::HttpServerMetrics() : HttpServerMetrics(Config{}) {}
+
+// Statistics recorded by a single thread. Only that thread writes them, so
+// that it needs neither locks nor atomic read-modify-writes, while GetSnapshot
+// reads them from another one.
+struct HttpServerMetrics::Shard {
+  struct Route {
+    std::atomic<uint64_t> request_count = 0;
+    std::atomic<uint64_t> error_count = 0;
+    std::atomic<uint64_t> bytes_received = 0;
+    std::atomic<uint64_t> bytes_sent = 0;
+    coro::util::SingleWriterLatencyHistogram time_to_first_byte;
+    coro::util::SingleWriterLatencyHistogram total;
+  };
+
+  // Only allocates when the route is new.
+  template <typename Name>
+  Route& GetRoute(const Name& name, size_t max_route_count) {
+    if (auto it = routes.find(name); it != routes.end()) {
+      return it->second;
+    }
+    std::string key =
+        routes.size() < max_route_count ? ToString(name) : "other";
+    std::unique_lock lock(mutex);
+    return routes.try_emplace(std::move(key)).first->second;
+  }
+
+  // Held by the writer only while inserting into `routes`, and by GetSnapshot
+  // while reading it.
+  std::mutex mutex;
+  std::unordered_map<std::string, Route, RouteHash, std::equal_to<>> routes;
+  std::atomic<uint64_t> reused_connection_request_count = 0;
+  coro::util::SingleWriterLatencyHistogram head_parse;
+};
+
+HttpServerMetrics::HttpServerMetrics(Config config)
+    : config_(std::move(config)), id_(next_metrics_id++) {}
+
+HttpServerMetrics::~HttpServerMetrics() = default;
+
+auto HttpServerMetrics::GetShard() -> Shard& {
+  struct ThreadShard {
+    uint64_t metrics_id;
+    Shard* shard;
+    std::weak_ptr<Shard> owner;
+  };
+  // Shards this thread records into, including ones of metrics destroyed
+  // already, which are dropped once another shard is created.
+  thread_local std::vector<ThreadShard> thread_shards;
+  for (const ThreadShard& thread_shard : thread_shards) {
+    if (thread_shard.metrics_id == id_) {
+      return *thread_shard.shard;
+    }
+  }
+  std::erase_if(thread_shards, [](const ThreadShard& thread_shard) {
+    return thread_shard.owner.expired();
+  });
+  auto shard = std::make_shared<Shard>();
+  thread_shards.push_back(
+      ThreadShard{.metrics_id = id_, .shard = shard.get(), .owner = shard});
+  std::unique_lock lock(mutex_);
+  shards_.push_back(std::move(shard));
+  return *shards_.back();
+}
+
+auto HttpServerMetrics::GetSnapshot() const -> Snapshot {
+  Snapshot snapshot{
+      .open_connection_count = open_connection_count_.load(),
+      .in_flight_request_count = in_flight_request_count_.load(),
+      .reused_connection_request_count = 0};
+  // Routes other than "other" in the snapshot.
+  size_t named_route_count = 0;
+  std::unique_lock lock(mutex_);
+  for (const std::shared_ptr<Shard>& shard : shards_) {
+    snapshot.reused_connection_request_count +=
+        shard->reused_connection_request_count.load(std::memory_order_relaxed);
+    snapshot.head_parse.Merge(shard->head_parse.Load());
+    std::unique_lock shard_lock(shard->mutex);
+    for (const auto& [name, route] : shard->routes) {
+      auto it = snapshot.routes.find(name);
+      if (it == snapshot.routes.end()) {
+        bool is_other = name == "other";
+        if (is_other || named_route_count < config_.max_route_count) {
+          named_route_count += is_other ? 0 : 1;
+          it = snapshot.routes.try_emplace(name).first;
+        } else {
+          it = snapshot.routes.try_emplace("other").first;
+        }
+      }
+      RouteStats& stats = it->second;
+      stats.request_count +=
+          route.request_count.load(std::memory_order_relaxed);
+      stats.error_count += route.error_count.load(std::memory_order_relaxed);
+      stats.bytes_received +=
+          route.bytes_received.load(std::memory_order_relaxed);
+      stats.bytes_sent += route.bytes_sent.load(std::memory_order_relaxed);
+      stats.time_to_first_byte.Merge(route.time_to_first_byte.Load());
+      stats.total.Merge(route.total.Load());
+    }
+  }
+  return snapshot;
+}
+
+void HttpServerMetrics::OnConnectionOpened() { open_connection_count_++; }
+
+void HttpServerMetrics::OnConnectionClosed() { open_connection_count_--; }
+
+void HttpServerMetrics::OnRequestStarted() { in_flight_request_count_++; }
+
+void HttpServerMetrics::OnRequestFinished(const HttpRequestStats& stats) {
+  in_flight_request_count_--;
+  Shard& shard = GetShard();
+  Shard::Route& route =
+      config_.get_route
+          ? shard.GetRoute(config_.get_route(stats.method, stats.url),
+                           config_.max_route_count)
+          : shard.GetRoute(
+                DefaultRoute{.method = MethodToString(stats.method),
+                             .path = stats.url.substr(0, stats.url.find('?'))},
+                config_.max_route_count);
+  if (stats.connection_request_index > 0) {
+    Increment(shard.reused_connection_request_count, 1);
+  }
+  shard.head_parse.Add(stats.head_parse);
+  Increment(route.request_count, 1);
+  if (stats.status == -1 || stats.status / 100 == 5) {
+    Increment(route.error_count, 1);
+  }
+  Increment(route.bytes_received, stats.bytes_received);
+  Increment(route.bytes_sent, stats.bytes_sent);
+  route.time_to_first_byte.Add(stats.time_to_first_byte);
+  route.total.Add(stats.total);
+  if (config_.on_slow_request &&
+      stats.total >= config_.slow_request_threshold) {
+    config_.on_slow_request(stats);
+  }
+}
+
+TcpServer CreateHttpServer(HttpHandler http_handler,
+                           const EventLoop* event_loop,
+                           const TcpServer::Config& config,
+                           HttpServerConfig http_config) {
+  return CreateHttpServer(std::move(http_handler), event_loop, config,
+                          /*metrics=*/nullptr, std::move(http_config));
+}
+
 TcpServer CreateHttpServer(HttpHandler http_handler,
                            const EventLoop* event_loop,
-                           const TcpServer::Config& config) {
-  return TcpServer(HttpHandlerT{.http_handler = std::move(http_handler)},
+                           const TcpServer::Config& config,
+                           HttpServerMetrics* metrics,
+                           HttpServerConfig http_config) {
+  CheckHttpServerConfig(http_config);
+  auto admission = CreateAdmissionController(
+      http_config.admission, /*thread_count=*/1,
+      CreateClientRequestCounts(http_config.admission));
+  return TcpServer(HttpHandlerT{.http_handler = std::move(http_handler),
+                                .metrics = metrics,
+                                .config = std::move(http_config),
+                                .admission = std::move(admission)},
                    event_loop, config);
 }
 
+MultiThreadedTcpServer CreateMultiThreadedHttpServer(
+    HttpHandlerFactory http_handler_factory, const EventLoop* event_loop,
+    const MultiThreadedTcpServer::Config& config,
+    HttpServerConfig http_config) {
+  return CreateMultiThreadedHttpServer(std::move(http_handler_factory),
+                                       event_loop, config,
+                                       /*metrics=*/nullptr,
+                                       std::move(http_config));
+}
+
+MultiThreadedTcpServer CreateMultiThreadedHttpServer(
+    HttpHandlerFactory http_handler_factory, const EventLoop* event_loop,
+    const MultiThreadedTcpServer::Config& config,
+    HttpServerMetrics* metrics, HttpServerConfig http_config) {
+  CheckHttpServerConfig(http_config);
+  // Requests per client are counted for the whole server.
+  auto client_request_counts = CreateClientRequestCounts(http_config.admission);
+  return MultiThreadedTcpServer(
+      [http_handler_factory = std::move(http_handler_factory), metrics,
+       http_config, thread_count = config.thread_count,
+       client_request_counts = std::move(client_request_counts)](
+          const EventLoop* event_loop) mutable {
+        return HttpHandlerT{
+            .http_handler = http_handler_factory(event_loop),
+            .metrics = metrics,
+            .config = http_config,
+            .admission = CreateAdmissionController(
+                http_config.admission, thread_count, client_request_counts)};
+      },
+      event_loop, config);
+}
+
 }  // namespace coro::http
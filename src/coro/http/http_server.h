@@ -1,10 +1,24 @@
 #ifndef CORO_HTTP_HTTP_SERVER_H
 #define CORO_HTTP_HTTP_SERVER_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "coro/http/http.h"
+#include "coro/http/websocket.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/task.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/latency_histogram.h"
+#include "coro/util/multi_threaded_tcp_server.h"
 #include "coro/util/tcp_server.h"
 
 namespace coro::http {
@@ -12,9 +26,179 @@ namespace coro::http {
 using HttpHandler =
     stdx::any_invocable<Task<Response<>>(Request<>, stdx::stop_token)>;
 
+// Describes a request served by the HTTP server. Durations are measured from
+// the arrival of the first byte of the request.
+struct HttpRequestStats {
+  std::string_view url;
+  Method method;
+  // Status of the response sent, -1 if the connection broke before the
+  // response head was sent.
+  int status;
+  // Until the request head was parsed.
+  std::chrono::microseconds head_parse;
+  // Until the handler returned the response head.
+  std::chrono::microseconds time_to_first_byte;
+  // Until the whole response was queued on the connection.
+  std::chrono::microseconds total;
+  uint64_t bytes_received;
+  uint64_t bytes_sent;
+  // Number of requests served on the same connection before this one.
+  int connection_request_index;
+};
+
+// Statistics of an HTTP server, thread-safe so that the threads of a
+// multi-threaded server can share them. Each thread records requests into its
+// own shard without taking locks; GetSnapshot merges the shards. A server
+// created without metrics doesn't measure anything.
+class HttpServerMetrics {
+ public:
+  struct Config {
+    // Maps a request to the route its statistics are grouped under. By default
+    // the route is the method followed by the path, without the query, which
+    // is looked up without allocating.
+    std::function<std::string(Method, std::string_view url)> get_route;
+    // Routes past this many, on any thread or in a snapshot, are grouped under
+    // "other".
+    size_t max_route_count = 256;
+    // Requests taking at least this long are passed to `on_slow_request`.
+    std::chrono::microseconds slow_request_threshold = std::chrono::seconds(1);
+    std::function<void(const HttpRequestStats&)> on_slow_request;
+  };
+
+  struct RouteStats {
+    uint64_t request_count = 0;
+    // Responses with a 5xx status or broken off.
+    uint64_t error_count = 0;
+    uint64_t bytes_received = 0;
+    uint64_t bytes_sent = 0;
+    coro::util::LatencyHistogram time_to_first_byte;
+    coro::util::LatencyHistogram total;
+  };
+
+  struct Snapshot {
+    int64_t open_connection_count;
+    int64_t in_flight_request_count;
+    // Requests which were not the first one on their connection.
+    uint64_t reused_connection_request_count;
+    coro::util::LatencyHistogram head_parse;
+    std::map<std::string, RouteStats, std::less<>> routes;
+  };
+
+  HttpServerMetrics();
+  explicit HttpServerMetrics(Config config);
+  ~HttpServerMetrics();
+
+  Snapshot GetSnapshot() const;
+
+  // Called by the server.
+  void OnConnectionOpened();
+  void OnConnectionClosed();
+  void OnRequestStarted();
+  void OnRequestFinished(const HttpRequestStats& stats);
+
+ private:
+  struct Shard;
+
+  Shard& GetShard();
+
+  Config config_;
+  // Unlike the address, never reused by another instance.
+  uint64_t id_;
+  std::atomic<int64_t> open_connection_count_ = 0;
+  std::atomic<int64_t> in_flight_request_count_ = 0;
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<Shard>> shards_;
+};
+
+struct Http2Config {
+  // Streams a client may have open at once on a connection.
+  uint32_t max_concurrent_streams = 100;
+  // Request body bytes a client may send ahead of the handlers reading them,
+  // on a single stream and on the whole connection. The flow-control windows
+  // are reopened only as the handlers consume request bodies.
+  uint32_t stream_window_size = 256 * 1024;
+  uint32_t connection_window_size = 1024 * 1024;
+  // Response body bytes of a stream taken from the handler ahead of the
+  // client's flow-control window. The body generator isn't resumed until they
+  // are sent.
+  size_t max_buffered_response_bytes = 64 * 1024;
+};
+
+// Limits on the requests a server works on at once, so that latency stays
+// bounded when it's overloaded. A request which isn't admitted is answered
+// with 503 and Retry-After as soon as its head is read, without calling the
+// handler. HTTP/2 streams count as requests too. On a multi-threaded server
+// each thread queues its own requests, so `max_in_flight_requests` and
+// `max_queued_requests` are divided evenly between the threads, rounding up,
+// while `max_requests_per_client` holds for the server as a whole.
+struct AdmissionConfig {
+  // Requests handled at once; further ones wait for their turn in FIFO order.
+  // 0 means no limit, which also disables the queue settings below.
+  int max_in_flight_requests = 0;
+  // Requests waiting for their turn, past which new ones are shed right away.
+  int max_queued_requests = 128;
+  // Queue delay control after CoDel. If no request waited less than
+  // `target_queue_delay` during a whole `interval`, the queue is considered
+  // standing and requests which waited longer than the target are shed as
+  // they reach its front. Otherwise only requests which waited longer than
+  // `interval` are shed.
+  std::chrono::milliseconds target_queue_delay{5};
+  std::chrono::milliseconds interval{100};
+  // Requests handled or waiting at once per client IP address. 0 means no
+  // limit.
+  int max_requests_per_client = 0;
+  // Sent with the 503 responses of shed requests.
+  std::chrono::seconds retry_after{1};
+};
+
+struct HttpServerConfig {
+  // A kept-alive connection is closed after serving this many requests, the
+  // last response saying so with `Connection: close`. 0 means no limit.
+  int max_requests_per_connection = 0;
+  // A connection is closed unless a request's head arrives in full within
+  // this long of its first byte, however steadily the client trickles it in.
+  // Complements TcpServer::Config::read_timeout_ms, which bounds every single
+  // wait for bytes. 0 means no limit.
+  std::chrono::milliseconds request_head_timeout{0};
+  // Serves HTTP/2 on connections which start with its connection preface, i.e.
+  // cleartext HTTP/2 with prior knowledge; other connections on the same port
+  // still speak HTTP/1.1. Each stream is dispatched to the handler like an
+  // HTTP/1.1 request. Requires the library to be built with HTTP/2 support.
+  bool enable_http2 = false;
+  Http2Config http2;
+  AdmissionConfig admission;
+  // Applies to connections upgraded with AcceptWebSocket.
+  WebSocketConfig websocket;
+};
+
+// Whether the library was built with HTTP/2 support.
+bool IsHttp2Supported();
+
+coro::util::TcpServer CreateHttpServer(
+    HttpHandler http_handler, const coro::util::EventLoop* event_loop,
+    const coro::util::TcpServer::Config& config,
+    HttpServerConfig http_config = {});
+
+// `metrics`, if not null, has to outlive the server.
 coro::util::TcpServer CreateHttpServer(
     HttpHandler http_handler, const coro::util::EventLoop* event_loop,
-    const coro::util::TcpServer::Config& config);
+    const coro::util::TcpServer::Config& config, HttpServerMetrics* metrics,
+    HttpServerConfig http_config = {});
+
+using HttpHandlerFactory =
+    stdx::any_invocable<HttpHandler(const coro::util::EventLoop*)>;
+
+coro::util::MultiThreadedTcpServer CreateMultiThreadedHttpServer(
+    HttpHandlerFactory http_handler_factory,
+    const coro::util::EventLoop* event_loop,
+    const coro::util::MultiThreadedTcpServer::Config& config,
+    HttpServerConfig http_config = {});
+
+coro::util::MultiThreadedTcpServer CreateMultiThreadedHttpServer(
+    HttpHandlerFactory http_handler_factory,
+    const coro::util::EventLoop* event_loop,
+    const coro::util::MultiThreadedTcpServer::Config& config,
+    HttpServerMetrics* metrics, HttpServerConfig http_config = {});
 
 }  // namespace coro::http
 
@@ -0,0 +1,131 @@
+#include "coro/http/parallel_download.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+
+#include "coro/exception.h"
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::http {
+
+namespace {
+
+struct RangeRequest {
+  std::string url;
+  std::vector<std::pair<std::string, std::string>> headers;
+  uint64_t content_length;
+  uint64_t start;
+  uint64_t size;
+  int max_attempts;
+};
+
+bool IsRetriable(const HttpException& e) {
+  return e.status() < 400 || e.status() >= 500;
+}
+
+Task<std::string> FetchRangeOnce(const Http& http, const RangeRequest& range,
+                                 stdx::stop_token stop_token) {
+  Request<> request{.url = range.url, .headers = range.headers};
+  request.headers.push_back(ToRangeHeader(
+      Range{.start = static_cast<int64_t>(range.start),
+            .end = static_cast<int64_t>(range.start + range.size - 1)}));
+  auto response = co_await http.FetchOk(std::move(request), stop_token);
+  if (response.status != 206 &&
+      !(range.start == 0 && range.size == range.content_length)) {
+    throw HttpException(HttpException::kRangeNotSatisfiable,
+                        "Server doesn't support Range requests.");
+  }
+  std::string body = co_await GetBody(std::move(response.body));
+  if (body.size() != range.size) {
+    throw HttpException(HttpException::kMalformedResponse,
+                        "Unexpected range length.");
+  }
+  co_return body;
+}
+
+Task<std::string> FetchRange(const Http& http, const RangeRequest& range,
+                             stdx::stop_token stop_token) {
+  for (int attempt = 1;; attempt++) {
+    try {
+      co_return co_await FetchRangeOnce(http, range, stop_token);
+    } catch (const InterruptedException&) {
+      throw;
+    } catch (const HttpException& e) {
+      if (attempt >= range.max_attempts || !IsRetriable(e)) {
+        throw;
+      }
+    } catch (const Exception&) {
+      if (attempt >= range.max_attempts) {
+        throw;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+Generator<util::BufferSlice> ParallelDownload(
+    const Http& http, std::string url, uint64_t content_length,
+    ParallelDownloadConfig config,
+    std::vector<std::pair<std::string, std::string>> headers,
+    stdx::stop_token stop_token) {
+  if (config.range_size == 0 || config.max_concurrent_ranges <= 0 ||
+      config.max_attempts_per_range <= 0) {
+    throw InvalidArgument("Invalid ParallelDownloadConfig.");
+  }
+  stdx::stop_source stop_source;
+  auto stop_token_or = std::make_unique<util::StopTokenOr<1>>(
+      stop_source, std::move(stop_token));
+  auto cancel_guard =
+      util::AtScopeExit([&stop_source] { stop_source.request_stop(); });
+
+  std::deque<std::shared_ptr<Promise<std::string>>> in_flight;
+  uint64_t next_offset = 0;
+  auto start_next_range = [&] {
+    RangeRequest range{
+        .url = url,
+        .headers = headers,
+        .content_length = content_length,
+        .start = next_offset,
+        .size = std::min(config.range_size, content_length - next_offset),
+        .max_attempts = config.max_attempts_per_range};
+    next_offset += range.size;
+    auto promise = std::make_shared<Promise<std::string>>();
+    in_flight.push_back(promise);
+    RunTask([&http, range = std::move(range), promise = std::move(promise),
+             token = stop_token_or->GetToken()]() -> Task<> {
+      try {
+        promise->SetValue(co_await FetchRange(http, range, token));
+      } catch (...) {
+        promise->SetException(std::current_exception());
+      }
+    });
+  };
+
+  auto start_ranges = [&] {
+    while (next_offset < content_length &&
+           in_flight.size() <
+               static_cast<size_t>(config.max_concurrent_ranges)) {
+      start_next_range();
+    }
+  };
+
+  start_ranges();
+  while (!in_flight.empty()) {
+    std::shared_ptr<Promise<std::string>> range = std::move(in_flight.front());
+    in_flight.pop_front();
+    Promise<std::string>& range_body = *range;
+    std::string body = co_await range_body;
+    start_ranges();
+    co_yield std::move(body);
+  }
+}
+
+}  // namespace coro::http
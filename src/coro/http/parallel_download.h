@@ -0,0 +1,38 @@
+#ifndef CORO_HTTP_PARALLEL_DOWNLOAD_H
+#define CORO_HTTP_PARALLEL_DOWNLOAD_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coro/generator.h"
+#include "coro/http/http.h"
+#include "coro/stdx/stop_token.h"
+
+namespace coro::http {
+
+struct ParallelDownloadConfig {
+  // Bytes fetched by a single ranged request.
+  uint64_t range_size = 8 * 1024 * 1024;
+  // Ranges fetched at the same time. Ranges are buffered until all the ones
+  // before them are consumed, so at most `max_concurrent_ranges + 1` ranges
+  // are held in memory.
+  int max_concurrent_ranges = 4;
+  // Failed ranges are fetched again on their own, up to this many times in
+  // total. Client errors (4xx) and interruptions aren't retried.
+  int max_attempts_per_range = 3;
+};
+
+// Downloads the first `content_length` bytes of `url` with concurrent Range
+// requests and yields them in order. `http` has to outlive the returned
+// generator's in-flight requests, which are cancelled when it's destroyed.
+Generator<util::BufferSlice> ParallelDownload(
+    const Http& http, std::string url, uint64_t content_length,
+    ParallelDownloadConfig config = {},
+    std::vector<std::pair<std::string, std::string>> headers = {},
+    stdx::stop_token stop_token = stdx::stop_token());
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_PARALLEL_DOWNLOAD_H
@@ -0,0 +1,169 @@
+#include "coro/http/read_ahead_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/lru_cache.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::http {
+
+struct ReadAheadCache::State {
+  State(const Http* http, ReadAheadCacheConfig config)
+      : http(http),
+        config(config),
+        blocks(std::numeric_limits<int>::max(), config.max_cached_bytes,
+               FetchBlock{.d = this}) {}
+
+  const Http* http;
+  ReadAheadCacheConfig config;
+  util::LRUCache<BlockKey, FetchBlock, BlockKeyHash, BlockWeigher> blocks;
+  std::unordered_map<std::string, ResourceState> resources;
+  // Cancels the fetches once the cache is destroyed.
+  stdx::stop_source stop_source;
+};
+
+ReadAheadCache::ReadAheadCache(const Http* http, ReadAheadCacheConfig config)
+    : d_(std::make_shared<State>(http, config)) {}
+
+ReadAheadCache::~ReadAheadCache() { d_->stop_source.request_stop(); }
+
+Task<std::string> ReadAheadCache::Read(std::string url, uint64_t offset,
+                                       uint64_t size,
+                                       stdx::stop_token stop_token) {
+  std::string result;
+  if (size == 0) {
+    co_return result;
+  }
+  const uint64_t block_size = d_->config.block_size;
+  uint64_t first_block = offset / block_size;
+  uint64_t last_block = (offset + size - 1) / block_size;
+  bool sequential = IsSequentialRead(url, offset, size);
+  Prefetch(url, first_block + 1,
+           last_block + (sequential ? d_->config.read_ahead_block_count : 0));
+  for (uint64_t index = first_block; index <= last_block; index++) {
+    BlockKey key{.url = url, .index = index};
+    std::shared_ptr<const std::string> block =
+        co_await d_->blocks.Get(std::move(key), stop_token);
+    uint64_t block_start = index * block_size;
+    uint64_t begin = std::max(offset, block_start) - block_start;
+    if (begin < block->size()) {
+      uint64_t end = std::min<uint64_t>(offset + size - block_start,
+                                        block->size());
+      result.append(*block, begin, end - begin);
+    }
+    if (block->size() < block_size) {
+      if (auto it = d_->resources.find(url); it != d_->resources.end()) {
+        it->second.size = block_start + block->size();
+      }
+      break;
+    }
+  }
+  co_return result;
+}
+
+bool ReadAheadCache::IsSequentialRead(const std::string& url, uint64_t offset,
+                                      uint64_t size) {
+  auto it = d_->resources.find(url);
+  if (it == d_->resources.end()) {
+    if (d_->resources.size() >= d_->config.max_tracked_resource_count) {
+      d_->resources.clear();
+    }
+    it = d_->resources.emplace(url, ResourceState{}).first;
+  }
+  ResourceState& state = it->second;
+  // Clients commonly keep a few reads in flight, which may arrive slightly
+  // out of order.
+  uint64_t distance = offset > state.next_read_offset
+                          ? offset - state.next_read_offset
+                          : state.next_read_offset - offset;
+  bool sequential = distance <= d_->config.block_size;
+  state.next_read_offset = std::max(state.next_read_offset, offset + size);
+  return sequential;
+}
+
+void ReadAheadCache::Prefetch(const std::string& url, uint64_t first_block,
+                              uint64_t last_block) {
+  if (auto it = d_->resources.find(url); it != d_->resources.end()) {
+    const ResourceState& resource = it->second;
+    if (resource.ranges_unsupported || resource.size == 0) {
+      return;
+    }
+    if (resource.size) {
+      last_block = std::min(last_block,
+                            (*resource.size - 1) / d_->config.block_size);
+    }
+  }
+  for (uint64_t index = first_block; index <= last_block; index++) {
+    BlockKey key{.url = url, .index = index};
+    if (d_->blocks.GetCached(key)) {
+      continue;
+    }
+    RunTask([d = d_, key = std::move(key)]() mutable -> Task<> {
+      // Waits for the fetch to finish, even if it's cancelled, so that the
+      // state it uses outlives it. Failures are reported to the read which
+      // needs the block.
+      co_await d->blocks.Get(std::move(key), stdx::stop_token()).AsResult();
+    });
+  }
+}
+
+size_t ReadAheadCache::BlockKeyHash::operator()(const BlockKey& key) const {
+  return std::hash<std::string>{}(key.url) ^
+         (std::hash<uint64_t>{}(key.index) * 0x9E3779B97F4A7C15ULL);
+}
+
+size_t ReadAheadCache::BlockWeigher::operator()(
+    const BlockKey& key,
+    const std::shared_ptr<const std::string>& block) const {
+  return key.url.size() + block->size();
+}
+
+Task<std::shared_ptr<const std::string>> ReadAheadCache::FetchBlock::operator()(
+    const BlockKey& key, stdx::stop_token stop_token) const {
+  const uint64_t block_size = d->config.block_size;
+  uint64_t start = key.index * block_size;
+  Request<> request{
+      .url = key.url,
+      .headers = {ToRangeHeader(
+          Range{.start = static_cast<int64_t>(start),
+                .end = static_cast<int64_t>(start + block_size - 1)})}};
+  auto stop_token_or =
+      util::MakeStopTokenOr(std::move(stop_token), d->stop_source.get_token());
+  auto response = co_await d->http->Fetch(std::move(request),
+                                          stop_token_or.GetToken());
+  if (response.status == HttpException::kRangeNotSatisfiable) {
+    co_return std::make_shared<const std::string>();
+  }
+  std::string body = co_await GetBody(std::move(response.body));
+  if (response.status == 200) {
+    // The server ignored the Range header and sent the whole resource, so
+    // the resource isn't prefetched anymore and its other blocks are cached
+    // from this response.
+    if (auto it = d->resources.find(key.url); it != d->resources.end()) {
+      it->second.ranges_unsupported = true;
+      it->second.size = body.size();
+    }
+    if (body.size() <= d->config.max_cached_bytes) {
+      for (uint64_t index = 0; index * block_size < body.size(); index++) {
+        if (index != key.index) {
+          d->blocks.Put(BlockKey{.url = key.url, .index = index},
+                        std::make_shared<const std::string>(
+                            body.substr(index * block_size, block_size)));
+        }
+      }
+    }
+    body = start < body.size() ? body.substr(start, block_size) : "";
+  } else if (response.status != 206) {
+    throw HttpException(response.status, body);
+  }
+  co_return std::make_shared<const std::string>(std::move(body));
+}
+
+}  // namespace coro::http
@@ -0,0 +1,93 @@
+#ifndef CORO_HTTP_READ_AHEAD_CACHE_H
+#define CORO_HTTP_READ_AHEAD_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "coro/http/http.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::http {
+
+struct ReadAheadCacheConfig {
+  // Resources are fetched and cached in aligned blocks of this many bytes.
+  uint64_t block_size = 1024 * 1024;
+  // Blocks fetched ahead of a read which continues where the previous read of
+  // the same resource ended.
+  int read_ahead_block_count = 4;
+  // Upper bound on the memory held by cached blocks.
+  size_t max_cached_bytes = 64 * 1024 * 1024;
+  // Resources whose access pattern is tracked at the same time.
+  size_t max_tracked_resource_count = 1024;
+};
+
+// Serves byte ranges of remote resources from a cache of fixed-size blocks,
+// each fetched with a single Range request. Sequential reads of a resource
+// trigger prefetching of the blocks that follow, so later reads are served
+// from memory. Reads of a block which is still being fetched, either by
+// another read or by the read-ahead, wait for that fetch instead of issuing a
+// new one. Resources are assumed not to change while cached.
+class ReadAheadCache {
+ public:
+  explicit ReadAheadCache(const Http* http, ReadAheadCacheConfig config = {});
+  ~ReadAheadCache();
+
+  ReadAheadCache(const ReadAheadCache&) = delete;
+  ReadAheadCache& operator=(const ReadAheadCache&) = delete;
+
+  // Returns at most `size` bytes of `url` starting at `offset`; fewer only
+  // past the end of the resource.
+  Task<std::string> Read(std::string url, uint64_t offset, uint64_t size,
+                         stdx::stop_token stop_token = stdx::stop_token());
+
+ private:
+  struct BlockKey {
+    std::string url;
+    uint64_t index;
+
+    bool operator==(const BlockKey&) const = default;
+  };
+
+  struct BlockKeyHash {
+    size_t operator()(const BlockKey& key) const;
+  };
+
+  struct BlockWeigher {
+    size_t operator()(const BlockKey& key,
+                      const std::shared_ptr<const std::string>& block) const;
+  };
+
+  struct ResourceState {
+    uint64_t next_read_offset = 0;
+    // Known once the last block of the resource has been read.
+    std::optional<uint64_t> size;
+    // Set once the server answered a Range request with the whole resource,
+    // which makes prefetching pointless.
+    bool ranges_unsupported = false;
+  };
+
+  struct State;
+
+  struct FetchBlock {
+    Task<std::shared_ptr<const std::string>> operator()(
+        const BlockKey& key, stdx::stop_token stop_token) const;
+    State* d;
+  };
+
+  // Records a read and returns whether it continues the previous one.
+  bool IsSequentialRead(const std::string& url, uint64_t offset,
+                        uint64_t size);
+  void Prefetch(const std::string& url, uint64_t first_block,
+                uint64_t last_block);
+
+  // Shared with the prefetches, which may still be finishing their fetches
+  // once the cache is destroyed.
+  std::shared_ptr<State> d_;
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_READ_AHEAD_CACHE_H
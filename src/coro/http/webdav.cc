@@ -0,0 +1,516 @@
+#include "coro/http/webdav.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/stdx/coroutine.h"
+
+namespace coro::http {
+
+namespace {
+
+constexpr std::string_view kDavNamespace = "DAV:";
+constexpr std::string_view kWhitespace = " \t\r\n";
+// Upper bounds keeping the memory of a parser small whatever the body.
+constexpr size_t kMaxTagSize = 16 * 1024;
+constexpr size_t kMaxPropertyCount = 1024;
+constexpr size_t kMaxElementDepth = 64;
+
+struct PropertyTags {
+  std::string_view name;
+  std::string_view open;
+  std::string_view close;
+  std::string_view empty;
+};
+
+// Indexed by MultiStatusWriter::Property.
+constexpr PropertyTags kPropertyTags[] = {
+    {"resourcetype", "<d:resourcetype>", "</d:resourcetype>",
+     "<d:resourcetype/>"},
+    {"displayname", "<d:displayname>", "</d:displayname>", "<d:displayname/>"},
+    {"getcontentlength", "<d:getcontentlength>", "</d:getcontentlength>",
+     "<d:getcontentlength/>"},
+    {"getlastmodified", "<d:getlastmodified>", "</d:getlastmodified>",
+     "<d:getlastmodified/>"},
+    {"getcontenttype", "<d:getcontenttype>", "</d:getcontenttype>",
+     "<d:getcontenttype/>"},
+    {"getetag", "<d:getetag>", "</d:getetag>", "<d:getetag/>"},
+};
+
+constexpr std::string_view kPropStatBegin = "<d:propstat><d:prop>";
+constexpr std::string_view kPropStatOk =
+    "</d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat>";
+constexpr std::string_view kPropStatNotFound =
+    "</d:prop><d:status>HTTP/1.1 404 Not Found</d:status></d:propstat>";
+
+[[noreturn]] void ThrowMalformed(std::string_view message) {
+  throw HttpException(HttpException::kBadRequest,
+                      "malformed PROPFIND body: " + std::string(message));
+}
+
+void AppendXmlEscaped(std::string& output, std::string_view text) {
+  while (!text.empty()) {
+    size_t special = text.find_first_of("&<>\"'");
+    output += text.substr(0, special);
+    if (special == std::string_view::npos) {
+      return;
+    }
+    switch (text[special]) {
+      case '&':
+        output += "&amp;";
+        break;
+      case '<':
+        output += "&lt;";
+        break;
+      case '>':
+        output += "&gt;";
+        break;
+      case '"':
+        output += "&quot;";
+        break;
+      default:
+        output += "&apos;";
+        break;
+    }
+    text.remove_prefix(special + 1);
+  }
+}
+
+std::string DecodeXmlEntities(std::string_view text) {
+  constexpr std::pair<std::string_view, char> kEntities[] = {
+      {"&amp;", '&'}, {"&lt;", '<'},   {"&gt;", '>'},
+      {"&quot;", '"'}, {"&apos;", '\''}};
+  std::string result;
+  while (!text.empty()) {
+    size_t entity = text.find('&');
+    result += text.substr(0, entity);
+    if (entity == std::string_view::npos) {
+      break;
+    }
+    text.remove_prefix(entity);
+    auto it = std::find_if(
+        std::begin(kEntities), std::end(kEntities),
+        [&](const auto& e) { return text.starts_with(e.first); });
+    if (it == std::end(kEntities)) {
+      ThrowMalformed("unsupported entity");
+    }
+    result += it->second;
+    text.remove_prefix(it->first.size());
+  }
+  return result;
+}
+
+// Percent-encodes everything but unreserved characters and slashes, so that
+// the result needs no XML escaping.
+void AppendEncodedPath(std::string& output, std::string_view path) {
+  constexpr char kHex[] = "0123456789ABCDEF";
+  for (char c : path) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+        c == '~' || c == '/') {
+      output += c;
+    } else {
+      auto byte = static_cast<uint8_t>(c);
+      output += '%';
+      output += kHex[byte >> 4];
+      output += kHex[byte & 0xF];
+    }
+  }
+}
+
+void AppendNumber(std::string& output, uint64_t value) {
+  char buffer[20];
+  auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+  output.append(buffer, end);
+}
+
+void AppendPropertyName(std::string& output, const DavPropertyName& name) {
+  if (name.namespace_uri == kDavNamespace) {
+    output += "<d:";
+    output += name.name;
+    output += "/>";
+  } else if (name.namespace_uri.empty()) {
+    output += '<';
+    output += name.name;
+    output += " xmlns=\"\"/>";
+  } else {
+    output += "<x:";
+    output += name.name;
+    output += " xmlns:x=\"";
+    AppendXmlEscaped(output, name.namespace_uri);
+    output += "\"/>";
+  }
+}
+
+}  // namespace
+
+DavDepth GetDavDepth(
+    std::span<const std::pair<std::string, std::string>> headers) {
+  auto depth = FindHeader(headers, "Depth");
+  if (!depth || EqualsIgnoreCase(*depth, "infinity")) {
+    return DavDepth::kInfinity;
+  }
+  if (*depth == "0") {
+    return DavDepth::kZero;
+  }
+  if (*depth == "1") {
+    return DavDepth::kOne;
+  }
+  throw HttpException(HttpException::kBadRequest, "invalid Depth header");
+}
+
+void PropfindRequestParser::Parse(std::string_view chunk) {
+  while (!chunk.empty()) {
+    if (!in_tag_) {
+      size_t start = chunk.find('<');
+      if (chunk.substr(0, start).find_first_not_of(kWhitespace) !=
+          std::string_view::npos) {
+        empty_ = false;
+      }
+      if (start == std::string_view::npos) {
+        return;
+      }
+      in_tag_ = true;
+      empty_ = false;
+      tag_.clear();
+      chunk.remove_prefix(start + 1);
+      continue;
+    }
+    size_t end = 0;
+    for (; end < chunk.size(); end++) {
+      char c = chunk[end];
+      // Comments may hold quotes and '>', so they only end at "-->".
+      if (tag_.starts_with('!')) {
+        if (c == '>' && (!tag_.starts_with("!--") ||
+                         (tag_.size() >= 5 && tag_.ends_with("--")))) {
+          break;
+        }
+      } else if (quote_ != 0) {
+        if (c == quote_) {
+          quote_ = 0;
+        }
+      } else if (c == '"' || c == '\'') {
+        quote_ = c;
+      } else if (c == '>') {
+        break;
+      }
+      if (tag_.size() == kMaxTagSize) {
+        ThrowMalformed("tag too long");
+      }
+      tag_ += c;
+    }
+    if (end == chunk.size()) {
+      return;
+    }
+    in_tag_ = false;
+    ParseTag(tag_);
+    chunk.remove_prefix(end + 1);
+  }
+}
+
+PropfindRequest PropfindRequestParser::Finish() {
+  if (empty_) {
+    return PropfindRequest{};
+  }
+  if (in_tag_ || !root_closed_) {
+    ThrowMalformed("unexpected end");
+  }
+  if (!type_) {
+    ThrowMalformed("no allprop, propname or prop element");
+  }
+  request_.type = *type_;
+  return std::move(request_);
+}
+
+void PropfindRequestParser::ParseTag(std::string_view tag) {
+  if (tag.empty()) {
+    ThrowMalformed("empty tag");
+  }
+  if (tag.front() == '?' || tag.front() == '!') {
+    return;
+  }
+  if (root_closed_) {
+    ThrowMalformed("content after the root element");
+  }
+  if (tag.front() != '/') {
+    ParseStartTag(tag);
+    return;
+  }
+  tag.remove_prefix(1);
+  tag = tag.substr(0, tag.find_last_not_of(kWhitespace) + 1);
+  if (elements_.empty() || elements_.back().qualified_name != tag) {
+    ThrowMalformed("mismatched end tag");
+  }
+  namespaces_.resize(elements_.back().namespace_count);
+  elements_.pop_back();
+  root_closed_ = elements_.empty();
+}
+
+void PropfindRequestParser::ParseStartTag(std::string_view tag) {
+  bool self_closing = tag.back() == '/';
+  if (self_closing) {
+    tag.remove_suffix(1);
+  }
+  size_t name_end = std::min(tag.find_first_of(kWhitespace), tag.size());
+  Element element{.qualified_name = std::string(tag.substr(0, name_end)),
+                  .namespace_count = namespaces_.size(),
+                  .holds_properties = false};
+  if (element.qualified_name.empty()) {
+    ThrowMalformed("missing element name");
+  }
+  tag.remove_prefix(name_end);
+  while (true) {
+    size_t start = tag.find_first_not_of(kWhitespace);
+    if (start == std::string_view::npos) {
+      break;
+    }
+    tag.remove_prefix(start);
+    size_t equals = tag.find('=');
+    if (equals == std::string_view::npos) {
+      ThrowMalformed("attribute without a value");
+    }
+    std::string_view attribute = tag.substr(0, equals);
+    attribute =
+        attribute.substr(0, attribute.find_last_not_of(kWhitespace) + 1);
+    tag.remove_prefix(equals + 1);
+    tag.remove_prefix(std::min(tag.find_first_not_of(kWhitespace), tag.size()));
+    if (tag.empty() || (tag.front() != '"' && tag.front() != '\'')) {
+      ThrowMalformed("unquoted attribute value");
+    }
+    size_t value_end = tag.find(tag.front(), 1);
+    if (value_end == std::string_view::npos) {
+      ThrowMalformed("unterminated attribute value");
+    }
+    std::string_view value = tag.substr(1, value_end - 1);
+    tag.remove_prefix(value_end + 1);
+    if (attribute == "xmlns") {
+      namespaces_.push_back({.prefix = "", .uri = DecodeXmlEntities(value)});
+    } else if (attribute.starts_with("xmlns:")) {
+      namespaces_.push_back({.prefix = std::string(attribute.substr(6)),
+                             .uri = DecodeXmlEntities(value)});
+    }
+  }
+
+  DavPropertyName name = Resolve(element.qualified_name);
+  bool is_dav = name.namespace_uri == kDavNamespace;
+  if (elements_.empty()) {
+    if (!is_dav || name.name != "propfind") {
+      ThrowMalformed("root element isn't DAV:propfind");
+    }
+  } else if (elements_.size() == 1) {
+    if (is_dav && name.name == "allprop") {
+      SetType(PropfindRequest::Type::kAllProp);
+    } else if (is_dav && name.name == "propname") {
+      SetType(PropfindRequest::Type::kPropName);
+    } else if (is_dav && name.name == "prop") {
+      SetType(PropfindRequest::Type::kProp);
+      element.holds_properties = true;
+    } else if (is_dav && name.name == "include") {
+      element.holds_properties = true;
+    }
+  } else if (elements_.size() == 2 && elements_.back().holds_properties) {
+    if (request_.properties.size() == kMaxPropertyCount) {
+      ThrowMalformed("too many properties");
+    }
+    request_.properties.push_back(std::move(name));
+  }
+
+  if (self_closing) {
+    namespaces_.resize(element.namespace_count);
+    root_closed_ = elements_.empty();
+  } else {
+    if (elements_.size() == kMaxElementDepth) {
+      ThrowMalformed("elements nested too deeply");
+    }
+    elements_.push_back(std::move(element));
+  }
+}
+
+void PropfindRequestParser::SetType(PropfindRequest::Type type) {
+  if (type_ && *type_ != type) {
+    ThrowMalformed("conflicting allprop, propname and prop elements");
+  }
+  type_ = type;
+}
+
+DavPropertyName PropfindRequestParser::Resolve(
+    std::string_view qualified_name) const {
+  size_t colon = qualified_name.find(':');
+  std::string_view prefix = colon == std::string_view::npos
+                                ? std::string_view()
+                                : qualified_name.substr(0, colon);
+  std::string_view name = colon == std::string_view::npos
+                              ? qualified_name
+                              : qualified_name.substr(colon + 1);
+  auto it = std::find_if(
+      namespaces_.rbegin(), namespaces_.rend(),
+      [&](const Namespace& ns) { return ns.prefix == prefix; });
+  if (it == namespaces_.rend()) {
+    if (!prefix.empty()) {
+      ThrowMalformed("undeclared namespace prefix");
+    }
+    return DavPropertyName{.name = std::string(name)};
+  }
+  return DavPropertyName{.namespace_uri = it->uri, .name = std::string(name)};
+}
+
+Task<PropfindRequest> ParsePropfindRequest(
+    std::optional<Generator<util::BufferSlice>> body) {
+  PropfindRequestParser parser;
+  if (body) {
+    FOR_CO_AWAIT(const util::BufferSlice& chunk, *body) { parser.Parse(chunk); }
+  }
+  co_return parser.Finish();
+}
+
+MultiStatusWriter::MultiStatusWriter(const PropfindRequest& request)
+    : type_(request.type) {
+  if (type_ != PropfindRequest::Type::kProp) {
+    for (size_t i = 0; i < std::size(kPropertyTags); i++) {
+      properties_.push_back(static_cast<Property>(i));
+    }
+    return;
+  }
+  for (const DavPropertyName& name : request.properties) {
+    auto it = std::find_if(
+        std::begin(kPropertyTags), std::end(kPropertyTags),
+        [&](const PropertyTags& tags) { return tags.name == name.name; });
+    if (name.namespace_uri != kDavNamespace || it == std::end(kPropertyTags)) {
+      AppendPropertyName(unsupported_properties_, name);
+      continue;
+    }
+    auto property =
+        static_cast<Property>(std::distance(std::begin(kPropertyTags), it));
+    if (std::find(properties_.begin(), properties_.end(), property) ==
+        properties_.end()) {
+      properties_.push_back(property);
+    }
+  }
+}
+
+std::string_view MultiStatusWriter::GetHeader() {
+  return "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+         "<d:multistatus xmlns:d=\"DAV:\">";
+}
+
+std::string_view MultiStatusWriter::GetFooter() { return "</d:multistatus>"; }
+
+void MultiStatusWriter::Append(const DavResource& resource,
+                               std::string& output) const {
+  auto is_set = [&](Property property) {
+    switch (property) {
+      case Property::kResourceType:
+        return true;
+      case Property::kDisplayName:
+        return resource.display_name.has_value();
+      case Property::kContentLength:
+        return resource.size.has_value() && !resource.is_collection;
+      case Property::kLastModified:
+        return resource.last_modified.has_value();
+      case Property::kContentType:
+        return resource.content_type.has_value();
+      case Property::kETag:
+        return resource.etag.has_value();
+    }
+    return false;
+  };
+
+  output += "<d:response><d:href>";
+  AppendEncodedPath(output, resource.path);
+  if (resource.is_collection && !resource.path.ends_with('/')) {
+    output += '/';
+  }
+  output += "</d:href>";
+
+  bool any_set = std::any_of(properties_.begin(), properties_.end(), is_set);
+  if (any_set) {
+    output += kPropStatBegin;
+    for (Property property : properties_) {
+      if (!is_set(property)) {
+        continue;
+      }
+      const PropertyTags& tags = kPropertyTags[static_cast<int>(property)];
+      if (type_ == PropfindRequest::Type::kPropName) {
+        output += tags.empty;
+        continue;
+      }
+      switch (property) {
+        case Property::kResourceType:
+          output += resource.is_collection
+                        ? "<d:resourcetype><d:collection/></d:resourcetype>"
+                        : tags.empty;
+          continue;
+        case Property::kDisplayName:
+          output += tags.open;
+          AppendXmlEscaped(output, *resource.display_name);
+          break;
+        case Property::kContentLength:
+          output += tags.open;
+          AppendNumber(output, *resource.size);
+          break;
+        case Property::kLastModified:
+          output += tags.open;
+          output += ToHttpDate(static_cast<time_t>(*resource.last_modified));
+          break;
+        case Property::kContentType:
+          output += tags.open;
+          AppendXmlEscaped(output, *resource.content_type);
+          break;
+        case Property::kETag:
+          output += tags.open;
+          AppendXmlEscaped(output, *resource.etag);
+          break;
+      }
+      output += tags.close;
+    }
+    output += kPropStatOk;
+  }
+
+  if (type_ == PropfindRequest::Type::kProp &&
+      (!unsupported_properties_.empty() ||
+       !std::all_of(properties_.begin(), properties_.end(), is_set))) {
+    output += kPropStatBegin;
+    for (Property property : properties_) {
+      if (!is_set(property)) {
+        output += kPropertyTags[static_cast<int>(property)].empty;
+      }
+    }
+    output += unsupported_properties_;
+    output += kPropStatNotFound;
+  }
+  output += "</d:response>";
+}
+
+Generator<util::BufferSlice> GetMultiStatusBody(
+    PropfindRequest request, Generator<DavResource> resources,
+    size_t chunk_size) {
+  MultiStatusWriter writer(request);
+  std::string chunk;
+  chunk.reserve(chunk_size);
+  chunk += MultiStatusWriter::GetHeader();
+  FOR_CO_AWAIT(const DavResource& resource, resources) {
+    writer.Append(resource, chunk);
+    if (chunk.size() >= chunk_size) {
+      co_yield std::move(chunk);
+      chunk.clear();
+      chunk.reserve(chunk_size);
+    }
+  }
+  chunk += MultiStatusWriter::GetFooter();
+  co_yield std::move(chunk);
+}
+
+Response<> CreateMultiStatusResponse(PropfindRequest request,
+                                     Generator<DavResource> resources,
+                                     size_t chunk_size) {
+  return Response<>{
+      .status = 207,
+      .headers = {{"Content-Type", "application/xml; charset=\"utf-8\""}},
+      .body = GetMultiStatusBody(std::move(request), std::move(resources),
+                                 chunk_size)};
+}
+
+}  // namespace coro::http
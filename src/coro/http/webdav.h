@@ -0,0 +1,156 @@
+#ifndef CORO_HTTP_WEBDAV_H
+#define CORO_HTTP_WEBDAV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coro/generator.h"
+#include "coro/http/http.h"
+#include "coro/task.h"
+
+namespace coro::http {
+
+enum class DavDepth { kZero, kOne, kInfinity };
+
+// Value of the Depth header of a WebDAV request; infinity if it's missing, as
+// for PROPFIND. Throws HttpException with kBadRequest if it's malformed.
+DavDepth GetDavDepth(
+    std::span<const std::pair<std::string, std::string>> headers);
+
+struct DavPropertyName {
+  std::string namespace_uri;
+  std::string name;
+
+  friend bool operator==(const DavPropertyName&,
+                         const DavPropertyName&) = default;
+};
+
+struct PropfindRequest {
+  enum class Type { kAllProp, kPropName, kProp };
+
+  Type type = Type::kAllProp;
+  // The properties asked for by kProp requests, or those to <include> with
+  // kAllProp.
+  std::vector<DavPropertyName> properties;
+};
+
+// Parses the XML body of a PROPFIND request as it arrives. Only an unfinished
+// tag is buffered between chunks, so memory use doesn't depend on the size of
+// the body. Namespace prefixes and default namespaces are resolved; text,
+// comments, processing instructions and elements other than those of
+// RFC 4918's propfind are ignored. Failures throw HttpException with
+// kBadRequest.
+class PropfindRequestParser {
+ public:
+  void Parse(std::string_view chunk);
+  // Returns the parsed request once the whole body was passed to Parse. An
+  // empty body requests all properties.
+  PropfindRequest Finish();
+
+ private:
+  struct Namespace {
+    std::string prefix;
+    std::string uri;
+  };
+
+  struct Element {
+    std::string qualified_name;
+    // Size of `namespaces_` before the element's declarations were added.
+    size_t namespace_count;
+    // Set for <prop> and <include>, whose children name properties.
+    bool holds_properties;
+  };
+
+  void ParseTag(std::string_view tag);
+  void ParseStartTag(std::string_view tag);
+  void SetType(PropfindRequest::Type type);
+  DavPropertyName Resolve(std::string_view qualified_name) const;
+
+  PropfindRequest request_;
+  std::optional<PropfindRequest::Type> type_;
+  std::string tag_;
+  char quote_ = 0;
+  bool in_tag_ = false;
+  bool root_closed_ = false;
+  bool empty_ = true;
+  std::vector<Namespace> namespaces_;
+  std::vector<Element> elements_;
+};
+
+// Reads and parses the body of a PROPFIND request, which may be absent.
+Task<PropfindRequest> ParsePropfindRequest(
+    std::optional<Generator<util::BufferSlice>> body);
+
+// Properties of a resource listed in a multistatus response. Properties which
+// are unset are reported as missing.
+struct DavResource {
+  // Path of the resource, without percent-encoding, like "/docs/a b.txt".
+  std::string path;
+  bool is_collection = false;
+  // getcontentlength.
+  std::optional<uint64_t> size;
+  // getlastmodified, in seconds since the epoch.
+  std::optional<int64_t> last_modified;
+  // getcontenttype.
+  std::optional<std::string> content_type;
+  // getetag, sent as it is, with its quotes.
+  std::optional<std::string> etag;
+  // displayname.
+  std::optional<std::string> display_name;
+};
+
+// Writes the <response> elements of a multistatus response to a PROPFIND
+// request. The fragments of markup which don't depend on the resource, such
+// as the tags of the requested properties and the 404 propstat of those which
+// aren't supported, are escaped and assembled once, in the constructor, so
+// that a resource costs little more than copying its values.
+class MultiStatusWriter {
+ public:
+  explicit MultiStatusWriter(const PropfindRequest& request);
+
+  static std::string_view GetHeader();
+  static std::string_view GetFooter();
+
+  // Appends the <response> element describing `resource`.
+  void Append(const DavResource& resource, std::string& output) const;
+
+ private:
+  enum class Property {
+    kResourceType,
+    kDisplayName,
+    kContentLength,
+    kLastModified,
+    kContentType,
+    kETag,
+  };
+
+  PropfindRequest::Type type_;
+  // Requested supported properties, in request order; all of them unless
+  // `type_` is kProp.
+  std::vector<Property> properties_;
+  // Empty elements of the requested properties which aren't supported.
+  std::string unsupported_properties_;
+};
+
+// Multistatus body listing `resources`, produced as they are. Chunks are
+// flushed once they reach `chunk_size` bytes, so a chunk exceeds it by at
+// most one <response> element.
+Generator<util::BufferSlice> GetMultiStatusBody(
+    PropfindRequest request, Generator<DavResource> resources,
+    size_t chunk_size = 16 * 1024);
+
+// 207 Multi-Status response streaming `resources`, for handlers of
+// CreateHttpServer. Sent chunked, since its length isn't known up front.
+Response<> CreateMultiStatusResponse(PropfindRequest request,
+                                     Generator<DavResource> resources,
+                                     size_t chunk_size = 16 * 1024);
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_WEBDAV_H
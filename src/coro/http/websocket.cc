@@ -0,0 +1,552 @@
+#include "coro/http/websocket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <utility>
+
+#include "coro/interrupted_exception.h"
+#include "coro/mutex.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro::http {
+
+namespace {
+
+using ::coro::util::TcpRequestDataProvider;
+using ::coro::util::TcpResponseChunk;
+
+constexpr std::string_view kHandshakeGuid =
+    "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr uint64_t kMaxControlPayloadLength = 125;
+// Payloads up to this size are copied behind their frame header, larger ones
+// are queued on their own.
+constexpr size_t kMaxCopiedPayloadSize = 1024;
+
+uint32_t RotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 is only used for the handshake, as RFC 6455 requires.
+std::array<uint8_t, 20> Sha1(std::string_view input) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+  std::string message(input);
+  message += static_cast<char>(0x80);
+  while (message.size() % 64 != 56) {
+    message += '\0';
+  }
+  uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+  for (int i = 7; i >= 0; i--) {
+    message += static_cast<char>((bit_length >> (i * 8)) & 0xFF);
+  }
+  for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const auto* p =
+          reinterpret_cast<const uint8_t*>(message.data() + chunk + i * 4);
+      w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+             (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+    for (int i = 16; i < 80; i++) {
+      w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = RotateLeft(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+  std::array<uint8_t, 20> digest;
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 4; j++) {
+      digest[i * 4 + j] = static_cast<uint8_t>(h[i] >> (24 - j * 8));
+    }
+  }
+  return digest;
+}
+
+// Whether the comma-separated header value `value` lists `token`, ignoring
+// case.
+bool HasToken(std::string_view value, std::string_view token) {
+  while (!value.empty()) {
+    size_t separator = value.find(',');
+    std::string_view item = value.substr(0, separator);
+    while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+      item.remove_prefix(1);
+    }
+    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+      item.remove_suffix(1);
+    }
+    if (EqualsIgnoreCase(item, token)) {
+      return true;
+    }
+    if (separator == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(separator + 1);
+  }
+  return false;
+}
+
+bool IsControlFrame(WebSocketOpcode opcode) {
+  return static_cast<uint8_t>(opcode) & 0x8;
+}
+
+Task<> Wait(Promise<void>& event, const stdx::stop_token& stop_token) {
+  if (stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  co_await event;
+  event = Promise<void>();
+}
+
+}  // namespace
+
+struct WebSocket::Session {
+  Session(TcpRequestDataProvider provider, WebSocketConfig config)
+      : provider(std::move(provider)), config(config) {}
+
+  void CheckNotStopped() const {
+    // Once stopped, the connection the provider reads from may be gone.
+    if (stop_source.get_token().stop_requested()) {
+      throw InterruptedException();
+    }
+  }
+
+  void QueueFrame(WebSocketOpcode opcode, bool fin, util::BufferSlice payload) {
+    std::string frame;
+    AppendWebSocketFrameHeader(frame, opcode, fin, payload.size());
+    output_size += frame.size() + payload.size();
+    if (payload.size() <= kMaxCopiedPayloadSize) {
+      frame += std::string_view(payload);
+      output.push_back(std::move(frame));
+    } else {
+      output.push_back(std::move(frame));
+      output.push_back(std::move(payload));
+    }
+    output_ready.SetValue();
+  }
+
+  void QueueClose(uint16_t code, std::string_view reason) {
+    if (close_sent) {
+      return;
+    }
+    close_sent = true;
+    std::string payload;
+    payload += static_cast<char>(code >> 8);
+    payload += static_cast<char>(code & 0xFF);
+    payload += reason.substr(0, kMaxControlPayloadLength - 2);
+    QueueFrame(WebSocketOpcode::kClose, /*fin=*/true, std::move(payload));
+  }
+
+  Task<> WaitForRoom() {
+    while (output_size > config.max_buffered_bytes) {
+      co_await Wait(output_drained, stop_source.get_token());
+    }
+    if (close_sent) {
+      throw InterruptedException();
+    }
+  }
+
+  Task<WebSocketFrameHeader> ReadFrameHeader() {
+    uint32_t size = 2;
+    while (true) {
+      CheckNotStopped();
+      std::span<const uint8_t> data = co_await provider.Peek(size);
+      if (data.empty()) {
+        throw InterruptedException();
+      }
+      if (auto header = ParseWebSocketFrameHeader(data)) {
+        if (!header->mask) {
+          throw WebSocketException(WebSocketException::kProtocolError,
+                                   "unmasked client frame");
+        }
+        provider.Consume(static_cast<uint32_t>(header->size));
+        co_return *header;
+      }
+      size = static_cast<uint32_t>(data.size() + 1);
+    }
+  }
+
+  // Reads and unmasks at most `max_byte_cnt` bytes of the current frame's
+  // payload, at least one.
+  Task<std::string> ReadPayload(const WebSocketFrameHeader& header,
+                                uint64_t offset, uint64_t max_byte_cnt) {
+    CheckNotStopped();
+    std::span<const uint8_t> data = co_await provider.Peek();
+    if (data.empty()) {
+      throw InterruptedException();
+    }
+    data = data.first(static_cast<size_t>(
+        std::min<uint64_t>(data.size(), max_byte_cnt)));
+    std::string piece(reinterpret_cast<const char*>(data.data()), data.size());
+    provider.Consume(static_cast<uint32_t>(data.size()));
+    MaskWebSocketPayload(
+        std::span<uint8_t>(reinterpret_cast<uint8_t*>(piece.data()),
+                           piece.size()),
+        *header.mask, offset);
+    co_return piece;
+  }
+
+  // Answers pings and records close frames. Returns false once the client has
+  // closed the connection.
+  Task<bool> HandleControlFrame(const WebSocketFrameHeader& header) {
+    if (!header.fin || header.payload_length > kMaxControlPayloadLength) {
+      throw WebSocketException(WebSocketException::kProtocolError,
+                               "invalid control frame");
+    }
+    std::string payload;
+    while (payload.size() < header.payload_length) {
+      payload += co_await ReadPayload(header, payload.size(),
+                                      header.payload_length - payload.size());
+    }
+    switch (header.opcode) {
+      case WebSocketOpcode::kPing:
+        if (!close_sent) {
+          QueueFrame(WebSocketOpcode::kPong, /*fin=*/true, std::move(payload));
+        }
+        co_return true;
+      case WebSocketOpcode::kPong:
+        co_return true;
+      case WebSocketOpcode::kClose: {
+        close_received = true;
+        uint16_t code = WebSocketException::kNormalClosure;
+        if (payload.size() >= 2) {
+          code = static_cast<uint16_t>(
+              (static_cast<uint8_t>(payload[0]) << 8) |
+              static_cast<uint8_t>(payload[1]));
+        }
+        QueueClose(code, /*reason=*/{});
+        co_return false;
+      }
+      default:
+        throw WebSocketException(WebSocketException::kProtocolError,
+                                 "unknown control frame");
+    }
+  }
+
+  TcpRequestDataProvider provider;
+  WebSocketConfig config;
+  // Frames queued for the writer.
+  std::deque<util::BufferSlice> output;
+  size_t output_size = 0;
+  Promise<void> output_ready;
+  Promise<void> output_drained;
+  // Keeps the fragments of concurrently sent messages apart.
+  Mutex send_mutex;
+  bool receiving_message = false;
+  bool close_sent = false;
+  bool close_received = false;
+  bool handler_done = false;
+  // Cancels the handler once the connection is done.
+  stdx::stop_source stop_source;
+};
+
+namespace {
+
+Generator<util::BufferSlice> ReadMessagePayload(
+    std::shared_ptr<WebSocket::Session> session, WebSocketFrameHeader header) {
+  auto message_guard =
+      coro::util::AtScopeExit([&] { session->receiving_message = false; });
+  uint64_t message_size = 0;
+  while (true) {
+    message_size += header.payload_length;
+    if (message_size > session->config.max_message_size) {
+      throw WebSocketException(WebSocketException::kMessageTooBig,
+                               "message too big");
+    }
+    uint64_t offset = 0;
+    while (offset < header.payload_length) {
+      std::string piece = co_await session->ReadPayload(
+          header, offset,
+          std::min<uint64_t>(header.payload_length - offset,
+                             coro::util::kMaxBufferSize));
+      offset += piece.size();
+      co_yield std::move(piece);
+    }
+    if (header.fin) {
+      co_return;
+    }
+    header = co_await session->ReadFrameHeader();
+    while (IsControlFrame(header.opcode)) {
+      if (!co_await session->HandleControlFrame(header)) {
+        throw InterruptedException();
+      }
+      header = co_await session->ReadFrameHeader();
+    }
+    if (header.opcode != WebSocketOpcode::kContinuation) {
+      throw WebSocketException(WebSocketException::kProtocolError,
+                               "expected a continuation frame");
+    }
+  }
+}
+
+Task<> RunHandler(std::shared_ptr<WebSocket::Session> session,
+                  WebSocketHandler handler) {
+  try {
+    WebSocket websocket(session);
+    co_await handler(websocket, session->stop_source.get_token());
+    session->QueueClose(WebSocketException::kNormalClosure, /*reason=*/{});
+  } catch (const WebSocketException& e) {
+    session->QueueClose(e.close_code(), e.what());
+  } catch (const InterruptedException&) {
+    session->QueueClose(WebSocketException::kNormalClosure, /*reason=*/{});
+  } catch (const Exception& e) {
+    std::cerr << "[WEBSOCKET]: " << e.what() << '\n';
+    session->QueueClose(WebSocketException::kInternalError, /*reason=*/{});
+  }
+  session->handler_done = true;
+  session->output_ready.SetValue();
+}
+
+}  // namespace
+
+std::optional<WebSocketFrameHeader> ParseWebSocketFrameHeader(
+    std::span<const uint8_t> data) {
+  if (data.size() < 2) {
+    return std::nullopt;
+  }
+  if (data[0] & 0x70) {
+    throw WebSocketException(WebSocketException::kProtocolError,
+                             "reserved frame bits set");
+  }
+  auto opcode = static_cast<WebSocketOpcode>(data[0] & 0x0F);
+  switch (opcode) {
+    case WebSocketOpcode::kContinuation:
+    case WebSocketOpcode::kText:
+    case WebSocketOpcode::kBinary:
+    case WebSocketOpcode::kClose:
+    case WebSocketOpcode::kPing:
+    case WebSocketOpcode::kPong:
+      break;
+    default:
+      throw WebSocketException(WebSocketException::kProtocolError,
+                               "unknown opcode");
+  }
+  bool masked = data[1] & 0x80;
+  uint64_t payload_length = data[1] & 0x7F;
+  size_t length_size = payload_length == 126 ? 2 : payload_length == 127 ? 8 : 0;
+  size_t size = 2 + length_size + (masked ? 4 : 0);
+  if (data.size() < size) {
+    return std::nullopt;
+  }
+  if (length_size > 0) {
+    payload_length = 0;
+    for (size_t i = 0; i < length_size; i++) {
+      payload_length = (payload_length << 8) | data[2 + i];
+    }
+    if ((length_size == 2 && payload_length < 126) ||
+        (length_size == 8 && (payload_length <= 0xFFFF ||
+                              payload_length >> 63 != 0))) {
+      throw WebSocketException(WebSocketException::kProtocolError,
+                               "non-minimal payload length");
+    }
+  }
+  WebSocketFrameHeader header{.fin = (data[0] & 0x80) != 0,
+                              .opcode = opcode,
+                              .payload_length = payload_length,
+                              .size = size};
+  if (masked) {
+    std::array<uint8_t, 4> mask;
+    std::copy_n(data.begin() + 2 + length_size, 4, mask.begin());
+    header.mask = mask;
+  }
+  return header;
+}
+
+void AppendWebSocketFrameHeader(std::string& output, WebSocketOpcode opcode,
+                                bool fin, uint64_t payload_length,
+                                std::optional<std::array<uint8_t, 4>> mask) {
+  output += static_cast<char>((fin ? 0x80 : 0) | static_cast<uint8_t>(opcode));
+  uint8_t mask_bit = mask ? 0x80 : 0;
+  if (payload_length < 126) {
+    output += static_cast<char>(mask_bit | payload_length);
+  } else if (payload_length <= 0xFFFF) {
+    output += static_cast<char>(mask_bit | 126);
+    output += static_cast<char>(payload_length >> 8);
+    output += static_cast<char>(payload_length & 0xFF);
+  } else {
+    output += static_cast<char>(mask_bit | 127);
+    for (int i = 7; i >= 0; i--) {
+      output += static_cast<char>((payload_length >> (i * 8)) & 0xFF);
+    }
+  }
+  if (mask) {
+    output.append(reinterpret_cast<const char*>(mask->data()), mask->size());
+  }
+}
+
+void MaskWebSocketPayload(std::span<uint8_t> data,
+                          std::array<uint8_t, 4> mask, uint64_t offset) {
+  // Rotated so that mask byte 0 applies to data[0].
+  std::array<uint8_t, 8> word_mask;
+  for (size_t i = 0; i < word_mask.size(); i++) {
+    word_mask[i] = mask[(offset + i) % 4];
+  }
+  uint64_t word_mask_value;
+  memcpy(&word_mask_value, word_mask.data(), sizeof(word_mask_value));
+  size_t index = 0;
+  // Compilers vectorize this loop; the copies keep it free of alignment
+  // requirements.
+  for (; index + sizeof(uint64_t) <= data.size(); index += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data.data() + index, sizeof(word));
+    word ^= word_mask_value;
+    memcpy(data.data() + index, &word, sizeof(word));
+  }
+  for (; index < data.size(); index++) {
+    data[index] ^= word_mask[index % word_mask.size()];
+  }
+}
+
+std::string GetWebSocketAccept(std::string_view key) {
+  std::string input(key);
+  input += kHandshakeGuid;
+  std::array<uint8_t, 20> digest = Sha1(input);
+  return ToBase64(std::string_view(reinterpret_cast<const char*>(digest.data()),
+                                   digest.size()));
+}
+
+WebSocket::WebSocket(std::shared_ptr<Session> session)
+    : d_(std::move(session)) {}
+
+Task<std::optional<WebSocketMessage>> WebSocket::Receive() {
+  if (d_->receiving_message) {
+    throw InvalidArgument("previous message wasn't read to the end");
+  }
+  if (d_->close_received) {
+    co_return std::nullopt;
+  }
+  while (true) {
+    WebSocketFrameHeader header = co_await d_->ReadFrameHeader();
+    if (IsControlFrame(header.opcode)) {
+      if (!co_await d_->HandleControlFrame(header)) {
+        co_return std::nullopt;
+      }
+      continue;
+    }
+    if (header.opcode == WebSocketOpcode::kContinuation) {
+      throw WebSocketException(WebSocketException::kProtocolError,
+                               "unexpected continuation frame");
+    }
+    d_->receiving_message = true;
+    co_return WebSocketMessage{.opcode = header.opcode,
+                               .payload = ReadMessagePayload(d_, header)};
+  }
+}
+
+Task<> WebSocket::Send(WebSocketOpcode opcode, std::string payload) {
+  auto lock = co_await UniqueLock::Create(&d_->send_mutex);
+  co_await d_->WaitForRoom();
+  d_->QueueFrame(opcode, /*fin=*/true, std::move(payload));
+}
+
+Task<> WebSocket::Send(WebSocketOpcode opcode,
+                       Generator<util::BufferSlice> payload) {
+  auto lock = co_await UniqueLock::Create(&d_->send_mutex);
+  // Held back by one, so that the last fragment can be marked final.
+  std::optional<util::BufferSlice> pending;
+  WebSocketOpcode frame_opcode = opcode;
+  FOR_CO_AWAIT(util::BufferSlice & chunk, payload) {
+    if (chunk.empty()) {
+      continue;
+    }
+    if (pending) {
+      co_await d_->WaitForRoom();
+      d_->QueueFrame(frame_opcode, /*fin=*/false, std::move(*pending));
+      frame_opcode = WebSocketOpcode::kContinuation;
+    }
+    pending = std::move(chunk);
+  }
+  co_await d_->WaitForRoom();
+  d_->QueueFrame(frame_opcode, /*fin=*/true,
+                 pending ? std::move(*pending) : util::BufferSlice());
+}
+
+void WebSocket::Close(uint16_t code, std::string_view reason) {
+  d_->QueueClose(code, reason);
+}
+
+Response<> AcceptWebSocket(const Request<>& request, WebSocketHandler handler) {
+  auto upgrade = FindHeader(request.headers, "Upgrade");
+  auto connection = FindHeader(request.headers, "Connection");
+  auto key = FindHeader(request.headers, "Sec-WebSocket-Key");
+  if (request.method != Method::kGet || !upgrade ||
+      !HasToken(*upgrade, "websocket") || !connection ||
+      !HasToken(*connection, "upgrade") || !key ||
+      FindHeader(request.headers, "Sec-WebSocket-Version") != "13") {
+    throw HttpException(HttpException::kBadRequest,
+                        "invalid WebSocket handshake");
+  }
+  return Response<>{.status = 101,
+                    .headers = {{"Upgrade", "websocket"},
+                                {"Connection", "Upgrade"},
+                                {"Sec-WebSocket-Accept",
+                                 GetWebSocketAccept(*key)}},
+                    .websocket_handler = std::move(handler)};
+}
+
+Generator<TcpResponseChunk> ServeWebSocketConnection(
+    TcpRequestDataProvider provider, WebSocketHandler handler,
+    stdx::stop_token stop_token, WebSocketConfig config) {
+  auto session =
+      std::make_shared<WebSocket::Session>(std::move(provider), config);
+  stdx::stop_callback wake_waiters(
+      session->stop_source.get_token(), [session] {
+        std::shared_ptr<WebSocket::Session> s = session;
+        s->output_ready.SetException(InterruptedException());
+        s->output_drained.SetException(InterruptedException());
+      });
+  stdx::stop_callback stop_session(
+      std::move(stop_token), [&] { session->stop_source.request_stop(); });
+  // The handler may outlive the connection; it mustn't touch it afterwards.
+  auto cancel_guard =
+      coro::util::AtScopeExit([&] { session->stop_source.request_stop(); });
+  RunTask(RunHandler(session, std::move(handler)));
+  while (true) {
+    if (!session->output.empty()) {
+      util::BufferSlice frame = std::move(session->output.front());
+      session->output.pop_front();
+      session->output_size -= frame.size();
+      session->output_drained.SetValue();
+      // Resumed once the connection has room for more, see
+      // TcpServer::Config::write_high_watermark.
+      co_yield std::move(frame);
+      continue;
+    }
+    if (session->handler_done) {
+      co_return;
+    }
+    co_await Wait(session->output_ready, session->stop_source.get_token());
+  }
+}
+
+}  // namespace coro::http
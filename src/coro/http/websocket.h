@@ -0,0 +1,145 @@
+#ifndef CORO_HTTP_WEBSOCKET_H
+#define CORO_HTTP_WEBSOCKET_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "coro/exception.h"
+#include "coro/generator.h"
+#include "coro/http/http.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::http {
+
+enum class WebSocketOpcode : uint8_t {
+  kContinuation = 0x0,
+  kText = 0x1,
+  kBinary = 0x2,
+  kClose = 0x8,
+  kPing = 0x9,
+  kPong = 0xA,
+};
+
+struct WebSocketFrameHeader {
+  bool fin;
+  WebSocketOpcode opcode;
+  uint64_t payload_length;
+  // Set in frames sent by clients, which have to mask their payloads.
+  std::optional<std::array<uint8_t, 4>> mask;
+  // Bytes the header takes up in front of the payload.
+  size_t size;
+};
+
+// Ends a WebSocket connection with a close frame carrying `close_code`.
+class WebSocketException : public Exception {
+ public:
+  static constexpr uint16_t kNormalClosure = 1000;
+  static constexpr uint16_t kProtocolError = 1002;
+  static constexpr uint16_t kMessageTooBig = 1009;
+  static constexpr uint16_t kInternalError = 1011;
+
+  WebSocketException(
+      uint16_t close_code, std::string_view message,
+      stdx::source_location location = stdx::source_location::current(),
+      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      : Exception(std::move(location), std::move(stacktrace)),
+        close_code_(close_code),
+        message_(message) {}
+
+  [[nodiscard]] const char* what() const noexcept override {
+    return message_.c_str();
+  }
+  [[nodiscard]] uint16_t close_code() const noexcept { return close_code_; }
+
+ private:
+  uint16_t close_code_;
+  std::string message_;
+};
+
+// Parses the frame header at the front of `data`. Returns nullopt if `data`
+// doesn't hold the whole header yet; throws WebSocketException if it's
+// malformed or uses extensions, which aren't negotiated.
+std::optional<WebSocketFrameHeader> ParseWebSocketFrameHeader(
+    std::span<const uint8_t> data);
+
+void AppendWebSocketFrameHeader(
+    std::string& output, WebSocketOpcode opcode, bool fin,
+    uint64_t payload_length,
+    std::optional<std::array<uint8_t, 4>> mask = std::nullopt);
+
+// XORs `data` with `mask` in place, a machine word at a time. `offset` is the
+// position of `data` within the payload, so that a payload can be (un)masked
+// piece by piece as it arrives.
+void MaskWebSocketPayload(std::span<uint8_t> data,
+                          std::array<uint8_t, 4> mask, uint64_t offset = 0);
+
+// Value of Sec-WebSocket-Accept answering Sec-WebSocket-Key `key`.
+std::string GetWebSocketAccept(std::string_view key);
+
+struct WebSocketConfig {
+  // Messages longer than this close the connection with kMessageTooBig.
+  uint64_t max_message_size = 16 * 1024 * 1024;
+  // Bytes of frames queued on the connection past which Send waits for them
+  // to be sent.
+  size_t max_buffered_bytes = 64 * 1024;
+};
+
+struct WebSocketMessage {
+  // kText or kBinary.
+  WebSocketOpcode opcode;
+  // Unmasked payload, yielded piece by piece as it's received. Has to be read
+  // to the end before the next message is received.
+  Generator<util::BufferSlice> payload;
+};
+
+// Server end of an upgraded connection, handed to a WebSocketHandler.
+// Receiving and sending may happen concurrently, from different coroutines.
+class WebSocket {
+ public:
+  struct Session;
+
+  explicit WebSocket(std::shared_ptr<Session> session);
+
+  // Next data message, or nullopt once the client has closed the connection.
+  // Pings are answered and pongs dropped while waiting here, so a handler
+  // which stops receiving leaves pings unanswered.
+  Task<std::optional<WebSocketMessage>> Receive();
+
+  // Sends a message in a single frame. Waits first while more than
+  // max_buffered_bytes are queued.
+  Task<> Send(WebSocketOpcode opcode, std::string payload);
+  // Sends a message as one fragment per nonempty chunk of `payload`, so that
+  // it's streamed out while it's produced.
+  Task<> Send(WebSocketOpcode opcode, Generator<util::BufferSlice> payload);
+
+  // Sends a close frame; nothing can be sent afterwards. Called with
+  // kNormalClosure once the handler returns, unless it's been called before.
+  void Close(uint16_t code = WebSocketException::kNormalClosure,
+             std::string_view reason = {});
+
+ private:
+  std::shared_ptr<Session> d_;
+};
+
+// Validates the upgrade request `request` and returns the 101 response which
+// makes the HTTP server hand the connection over to `handler`. Throws
+// HttpException if `request` isn't a WebSocket handshake.
+Response<> AcceptWebSocket(const Request<>& request, WebSocketHandler handler);
+
+// Serves the connection after the 101 response head, running `handler` in a
+// separate task while the returned generator yields the frames to send. Ends
+// once the handler is done and its frames are sent. Used by the HTTP server.
+Generator<coro::util::TcpResponseChunk> ServeWebSocketConnection(
+    coro::util::TcpRequestDataProvider provider, WebSocketHandler handler,
+    stdx::stop_token stop_token, WebSocketConfig config);
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_WEBSOCKET_H
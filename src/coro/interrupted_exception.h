@@ -5,11 +5,14 @@
 
 namespace coro {
 
+// Thrown into operations which were cancelled. Cancellation is routine, e.g.
+// on every client disconnect, so unlike other exceptions this one doesn't
+// capture a stacktrace unless given one.
 class InterruptedException : public Exception {
  public:
   explicit InterruptedException(
       stdx::source_location location = stdx::source_location::current(),
-      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      stdx::stacktrace stacktrace = stdx::stacktrace())
       : Exception(std::move(location), std::move(stacktrace)) {}
 
   [[nodiscard]] const char* what() const noexcept final {
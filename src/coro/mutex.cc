@@ -1,31 +1,61 @@
 #include "coro/mutex.h"
 
-#include <algorithm>
+#include <utility>
 
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_callback.h"
 #include "coro/util/raii_utils.h"
 
 namespace coro {
 
 using ::coro::util::AtScopeExit;
 
+namespace {
+
+// Queues the caller on `queue` until the lock is handed to it. A waiter which
+// is destroyed after the lock was handed to it, but before it resumed, gives
+// the lock back with `release`. Stopping `stop_token` dequeues a waiter which
+// wasn't handed the lock yet and makes it throw InterruptedException.
+template <typename Release>
+Task<> WaitInQueue(internal::WaiterList& queue, Release release,
+                   stdx::stop_token stop_token = stdx::stop_token()) {
+  internal::Waiter waiter;
+  queue.PushBack(&waiter);
+  auto guard = AtScopeExit([&] {
+    if (waiter.list) {
+      waiter.list->Remove(&waiter);
+    }
+    if (waiter.granted) {
+      release();
+    }
+  });
+  stdx::stop_callback on_cancel(std::move(stop_token), [&] {
+    if (waiter.list) {
+      waiter.list->Remove(&waiter);
+      waiter.promise.SetException(InterruptedException());
+    }
+  });
+  co_await waiter.promise;
+  waiter.granted = false;
+}
+
+}  // namespace
+
 Mutex::Mutex() : locked_() {}
 
 Task<> Mutex::Lock() {
-  if (locked_) {
-    Promise<void> promise;
-    queued_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_.erase(std::find(queued_.begin(), queued_.end(), &promise));
-    });
-    co_await promise;
+  if (!locked_) {
+    locked_ = true;
+    co_return;
   }
-  locked_ = true;
+  co_await WaitInQueue(queued_, [this] { Unlock(); });
 }
 
 void Mutex::Unlock() {
-  locked_ = false;
-  if (!queued_.empty()) {
-    queued_.front()->SetValue();
+  if (queued_.empty()) {
+    locked_ = false;
+  } else {
+    queued_.WakeFront();
   }
 }
 
@@ -50,51 +80,58 @@ Task<UniqueLock> UniqueLock::Create(Mutex* mutex) {
   co_return UniqueLock(mutex);
 }
 
-ReadWriteMutex::ReadWriteMutex() : reader_count_(), writer_count_() {}
+ReadWriteMutex::ReadWriteMutex(Policy policy)
+    : policy_(policy), reader_count_(), writer_active_() {}
 
 Task<> ReadWriteMutex::ReadLock() {
-  if (writer_count_ > 0) {
-    Promise<void> promise;
-    queued_readers_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_readers_.erase(
-          std::find(queued_readers_.begin(), queued_readers_.end(), &promise));
-    });
-    co_await promise;
+  if (!writer_active_ &&
+      (policy_ == Policy::kPreferReaders || queued_writers_.empty())) {
+    reader_count_++;
+    co_return;
   }
-  reader_count_++;
+  co_await WaitInQueue(queued_readers_, [this] { ReadUnlock(); });
 }
 
 void ReadWriteMutex::ReadUnlock() {
   reader_count_--;
   if (reader_count_ == 0 && !queued_writers_.empty()) {
-    queued_writers_.front()->SetValue();
+    writer_active_ = true;
+    queued_writers_.WakeFront();
   }
 }
 
 Task<> ReadWriteMutex::WriteLock() {
-  if (reader_count_ > 0) {
-    Promise<void> promise;
-    queued_writers_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_writers_.erase(
-          std::find(queued_writers_.begin(), queued_writers_.end(), &promise));
-    });
-    co_await promise;
+  if (!writer_active_ && reader_count_ == 0) {
+    writer_active_ = true;
+    co_return;
   }
-  writer_count_++;
+  co_await WaitInQueue(queued_writers_, [this] { WriteUnlock(); });
 }
 
 void ReadWriteMutex::WriteUnlock() {
-  writer_count_--;
-  if (writer_count_ == 0) {
-    if (!queued_writers_.empty()) {
-      queued_writers_.front()->SetValue();
-    } else {
-      while (writer_count_ == 0 && !queued_readers_.empty()) {
-        queued_readers_.front()->SetValue();
-      }
-    }
+  if (!queued_readers_.empty()) {
+    writer_active_ = false;
+    WakeReaders();
+  } else if (!queued_writers_.empty()) {
+    queued_writers_.WakeFront();
+  } else {
+    writer_active_ = false;
+  }
+}
+
+// All the queued readers are counted as holding the lock before any of them
+// resumes, so that none of them can hand the lock to a writer while the rest
+// are still being woken.
+void ReadWriteMutex::WakeReaders() {
+  for (internal::Waiter* waiter = queued_readers_.front(); waiter;
+       waiter = waiter->next) {
+    waiter->granted = true;
+    reader_count_++;
+  }
+  while (!queued_readers_.empty() && queued_readers_.front()->granted) {
+    internal::Waiter* waiter = queued_readers_.front();
+    queued_readers_.Remove(waiter);
+    waiter->promise.SetValue();
   }
 }
 
@@ -140,4 +177,55 @@ Task<WriteLock> WriteLock::Create(ReadWriteMutex* mutex) {
 
 WriteLock::WriteLock(ReadWriteMutex* mutex) : mutex_(mutex) {}
 
+Semaphore::Semaphore(int count) : count_(count) {}
+
+Task<> Semaphore::Acquire(stdx::stop_token stop_token) {
+  if (TryAcquire()) {
+    co_return;
+  }
+  co_await WaitInQueue(
+      queued_, [this] { Release(); }, std::move(stop_token));
+}
+
+bool Semaphore::TryAcquire() {
+  if (count_ > 0 && queued_.empty()) {
+    count_--;
+    return true;
+  }
+  return false;
+}
+
+void Semaphore::Release() {
+  if (queued_.empty()) {
+    count_++;
+  } else {
+    queued_.WakeFront();
+  }
+}
+
+SemaphoreLock::SemaphoreLock(Semaphore* semaphore) : semaphore_(semaphore) {}
+
+SemaphoreLock::SemaphoreLock(SemaphoreLock&& other) noexcept
+    : semaphore_(std::exchange(other.semaphore_, nullptr)) {}
+
+SemaphoreLock& SemaphoreLock::operator=(SemaphoreLock&& other) noexcept {
+  if (semaphore_) {
+    semaphore_->Release();
+  }
+  semaphore_ = std::exchange(other.semaphore_, nullptr);
+  return *this;
+}
+
+SemaphoreLock::~SemaphoreLock() noexcept {
+  if (semaphore_) {
+    semaphore_->Release();
+  }
+}
+
+Task<SemaphoreLock> SemaphoreLock::Create(Semaphore* semaphore,
+                                          stdx::stop_token stop_token) {
+  co_await semaphore->Acquire(std::move(stop_token));
+  co_return SemaphoreLock(semaphore);
+}
+
 }  // namespace coro
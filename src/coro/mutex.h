@@ -1,13 +1,67 @@
 #ifndef CORO_MUTEX_H
 #define CORO_MUTEX_H
 
-#include <vector>
-
 #include "coro/promise.h"
+#include "coro/stdx/stop_token.h"
 #include "coro/task.h"
 
 namespace coro {
 
+namespace internal {
+
+// A coroutine waiting for a lock, linked into the queue of the lock. Lives in
+// the waiting coroutine's frame.
+struct Waiter {
+  Promise<void> promise;
+  Waiter* prev = nullptr;
+  Waiter* next = nullptr;
+  class WaiterList* list = nullptr;
+  // Set once the lock was handed to the waiter, until it resumes.
+  bool granted = false;
+};
+
+// Intrusive FIFO of waiters with O(1) insertion, removal and handoff.
+class WaiterList {
+ public:
+  WaiterList() = default;
+  WaiterList(const WaiterList&) = delete;
+  WaiterList& operator=(const WaiterList&) = delete;
+
+  bool empty() const { return head_ == nullptr; }
+  Waiter* front() const { return head_; }
+
+  void PushBack(Waiter* waiter) {
+    waiter->list = this;
+    waiter->prev = tail_;
+    waiter->next = nullptr;
+    (tail_ ? tail_->next : head_) = waiter;
+    tail_ = waiter;
+  }
+
+  void Remove(Waiter* waiter) {
+    (waiter->prev ? waiter->prev->next : head_) = waiter->next;
+    (waiter->next ? waiter->next->prev : tail_) = waiter->prev;
+    waiter->prev = waiter->next = nullptr;
+    waiter->list = nullptr;
+  }
+
+  // Marks the first waiter as owning the lock, unlinks it and resumes it.
+  void WakeFront() {
+    Waiter* waiter = head_;
+    Remove(waiter);
+    waiter->granted = true;
+    waiter->promise.SetValue();
+  }
+
+ private:
+  Waiter* head_ = nullptr;
+  Waiter* tail_ = nullptr;
+};
+
+}  // namespace internal
+
+// Waiters are queued in FIFO order and the lock is handed directly to the
+// first one on Unlock, so a coroutine which doesn't wait can't overtake them.
 class Mutex {
  public:
   Mutex();
@@ -21,7 +75,7 @@ class Mutex {
 
  private:
   bool locked_;
-  std::vector<Promise<void>*> queued_;
+  internal::WaiterList queued_;
 };
 
 class UniqueLock {
@@ -41,9 +95,20 @@ class UniqueLock {
   Mutex* mutex_;
 };
 
+// Shared/exclusive lock. A writer releasing the lock wakes all the queued
+// readers at once; the next writer gets the lock once they're done.
 class ReadWriteMutex {
  public:
-  ReadWriteMutex();
+  enum class Policy {
+    // Readers take the lock whenever no writer holds it, even if writers are
+    // waiting. Maximizes read throughput, but readers can starve writers.
+    kPreferReaders,
+    // Readers queue behind waiting writers, so reading and writing phases
+    // alternate and neither side starves.
+    kPhaseFair,
+  };
+
+  explicit ReadWriteMutex(Policy policy = Policy::kPreferReaders);
   ReadWriteMutex(const ReadWriteMutex&) = delete;
   ReadWriteMutex(ReadWriteMutex&&) = delete;
   ReadWriteMutex& operator=(const ReadWriteMutex&) = delete;
@@ -56,10 +121,13 @@ class ReadWriteMutex {
   void WriteUnlock();
 
  private:
+  void WakeReaders();
+
+  Policy policy_;
   int reader_count_;
-  std::vector<Promise<void>*> queued_readers_;
-  int writer_count_;
-  std::vector<Promise<void>*> queued_writers_;
+  bool writer_active_;
+  internal::WaiterList queued_readers_;
+  internal::WaiterList queued_writers_;
 };
 
 class ReadLock {
@@ -96,6 +164,46 @@ class WriteLock {
   ReadWriteMutex* mutex_;
 };
 
+// Counting semaphore for bounding concurrency. Like Mutex, released units
+// are handed to waiters in FIFO order.
+class Semaphore {
+ public:
+  explicit Semaphore(int count);
+  Semaphore(const Semaphore&) = delete;
+  Semaphore(Semaphore&&) = delete;
+  Semaphore& operator=(const Semaphore&) = delete;
+  Semaphore& operator=(Semaphore&&) = delete;
+
+  // Throws InterruptedException if `stop_token` is stopped while waiting.
+  Task<> Acquire(stdx::stop_token stop_token = stdx::stop_token());
+  bool TryAcquire();
+  void Release();
+
+  int available() const { return count_; }
+
+ private:
+  int count_;
+  internal::WaiterList queued_;
+};
+
+class SemaphoreLock {
+ public:
+  SemaphoreLock(const SemaphoreLock&) = delete;
+  SemaphoreLock(SemaphoreLock&&) noexcept;
+  SemaphoreLock& operator=(const SemaphoreLock&) = delete;
+  SemaphoreLock& operator=(SemaphoreLock&&) noexcept;
+
+  ~SemaphoreLock() noexcept;
+
+  static Task<SemaphoreLock> Create(
+      Semaphore*, stdx::stop_token stop_token = stdx::stop_token());
+
+ private:
+  explicit SemaphoreLock(Semaphore*);
+
+  Semaphore* semaphore_;
+};
+
 }  // namespace coro
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
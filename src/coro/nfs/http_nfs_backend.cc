@@ -0,0 +1,149 @@
+#include "coro/nfs/http_nfs_backend.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/nfs/nfs_exception.h"
+
+namespace coro::nfs {
+
+namespace {
+
+// Splits "/a/b" into "/a" and "b".
+std::pair<std::string, std::string> SplitPath(std::string_view path) {
+  size_t separator = path.rfind('/');
+  std::string parent(path.substr(0, std::max<size_t>(separator, 1)));
+  return {std::move(parent), std::string(path.substr(separator + 1))};
+}
+
+NfsException ToNfsException(const http::HttpException& e) {
+  if (e.status() == http::HttpException::kNotFound) {
+    return NfsException(NfsStatus::kNoEnt, e.what());
+  }
+  return NfsException(NfsStatus::kIO, e.what());
+}
+
+}  // namespace
+
+HttpNfsBackend::HttpNfsBackend(const http::Http* http,
+                               std::vector<HttpNfsFile> files,
+                               http::ReadAheadCacheConfig cache_config)
+    : http_(http), cache_(http, std::move(cache_config)) {
+  nodes_["/"].attributes =
+      NfsAttributes{.type = NfsFileType::kDirectory, .mode = 0555};
+  for (HttpNfsFile& file : files) {
+    if (file.path.size() < 2 || file.path.front() != '/' ||
+        file.path.back() == '/' || file.path.find("//") != std::string::npos) {
+      throw InvalidArgument("invalid path " + file.path);
+    }
+    auto [it, inserted] =
+        nodes_.emplace(file.path, Node{.url = std::move(file.url)});
+    if (!inserted) {
+      throw InvalidArgument("duplicate path " + file.path);
+    }
+    // Adds the file to its directory, creating the directories up to the
+    // first one already known.
+    std::string path = file.path;
+    while (path != "/") {
+      auto [parent, name] = SplitPath(path);
+      auto [parent_it, new_parent] = nodes_.try_emplace(parent);
+      Node& parent_node = parent_it->second;
+      if (!parent_node.url.empty()) {
+        throw InvalidArgument(parent + " is both a file and a directory");
+      }
+      parent_node.entries.push_back(std::move(name));
+      if (!new_parent) {
+        break;
+      }
+      parent_node.attributes =
+          NfsAttributes{.type = NfsFileType::kDirectory, .mode = 0555};
+      path = std::move(parent);
+    }
+  }
+  for (auto& [path, node] : nodes_) {
+    if (node.url.empty()) {
+      std::sort(node.entries.begin(), node.entries.end());
+      node.attributes->size = node.entries.size();
+    }
+  }
+}
+
+Task<NfsAttributes> HttpNfsBackend::GetAttributes(std::string path,
+                                                  stdx::stop_token stop_token) {
+  co_return co_await GetAttributes(GetNode(path), std::move(stop_token));
+}
+
+Task<std::vector<NfsDirectoryEntry>> HttpNfsBackend::ListDirectory(
+    std::string path, stdx::stop_token stop_token) {
+  Node& directory = GetNode(path);
+  if (!directory.url.empty()) {
+    throw NfsException(NfsStatus::kNotDir);
+  }
+  std::vector<NfsDirectoryEntry> entries;
+  entries.reserve(directory.entries.size());
+  for (const std::string& name : directory.entries) {
+    Node& node = GetNode(path == "/" ? "/" + name : path + "/" + name);
+    entries.push_back(NfsDirectoryEntry{
+        .name = name,
+        .attributes = co_await GetAttributes(node, stop_token)});
+  }
+  co_return entries;
+}
+
+Task<std::string> HttpNfsBackend::Read(std::string path, uint64_t offset,
+                                       uint32_t size,
+                                       stdx::stop_token stop_token) {
+  Node& node = GetNode(path);
+  if (node.url.empty()) {
+    throw NfsException(NfsStatus::kIsDir);
+  }
+  try {
+    co_return co_await cache_.Read(node.url, offset, size,
+                                   std::move(stop_token));
+  } catch (const http::HttpException& e) {
+    if (e.status() == http::HttpException::kRangeNotSatisfiable) {
+      co_return std::string();
+    }
+    throw ToNfsException(e);
+  }
+}
+
+auto HttpNfsBackend::GetNode(const std::string& path) -> Node& {
+  auto it = nodes_.find(path);
+  if (it == nodes_.end()) {
+    throw NfsException(NfsStatus::kNoEnt);
+  }
+  return it->second;
+}
+
+Task<NfsAttributes> HttpNfsBackend::GetAttributes(Node& node,
+                                                  stdx::stop_token stop_token) {
+  if (node.attributes) {
+    co_return *node.attributes;
+  }
+  NfsAttributes attributes;
+  try {
+    http::Request<> request{.url = node.url, .method = http::Method::kHead};
+    auto response =
+        co_await http_->FetchOk(std::move(request), std::move(stop_token));
+    if (auto content_length =
+            http::FindHeader(response.headers, "Content-Length")) {
+      attributes.size = std::stoull(std::string(*content_length));
+    } else {
+      throw NfsException(NfsStatus::kIO, "unknown size of " + node.url);
+    }
+    if (auto last_modified =
+            http::FindHeader(response.headers, "Last-Modified")) {
+      attributes.mtime = http::ParseHttpDate(*last_modified).value_or(0);
+    }
+  } catch (const http::HttpException& e) {
+    throw ToNfsException(e);
+  }
+  node.attributes = attributes;
+  co_return attributes;
+}
+
+}  // namespace coro::nfs
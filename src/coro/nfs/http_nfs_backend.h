@@ -0,0 +1,62 @@
+#ifndef CORO_NFS_HTTP_NFS_BACKEND_H
+#define CORO_NFS_HTTP_NFS_BACKEND_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/http/read_ahead_cache.h"
+#include "coro/nfs/nfs_backend.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::nfs {
+
+struct HttpNfsFile {
+  // Absolute path of the file in the exported tree, e.g. "/videos/a.mp4".
+  std::string path;
+  std::string url;
+};
+
+// Exports remote resources as a read-only tree of files. Directories are
+// implied by the paths of the files. Sizes and modification times come from a
+// HEAD request of each resource, made once; reads are served by a
+// ReadAheadCache, so that sequential reads of a client are prefetched. Like
+// the cache, assumes that the resources don't change.
+class HttpNfsBackend : public NfsBackend {
+ public:
+  // `http` has to outlive the backend. Throws InvalidArgument if a path isn't
+  // absolute or is both a file and a directory.
+  HttpNfsBackend(const http::Http* http, std::vector<HttpNfsFile> files,
+                 http::ReadAheadCacheConfig cache_config = {});
+
+  Task<NfsAttributes> GetAttributes(std::string path,
+                                    stdx::stop_token stop_token) override;
+  Task<std::vector<NfsDirectoryEntry>> ListDirectory(
+      std::string path, stdx::stop_token stop_token) override;
+  Task<std::string> Read(std::string path, uint64_t offset, uint32_t size,
+                         stdx::stop_token stop_token) override;
+
+ private:
+  struct Node {
+    // Empty for directories.
+    std::string url;
+    // Names of the entries of a directory, sorted.
+    std::vector<std::string> entries;
+    std::optional<NfsAttributes> attributes;
+  };
+
+  Node& GetNode(const std::string& path);
+  Task<NfsAttributes> GetAttributes(Node& node, stdx::stop_token stop_token);
+
+  const http::Http* http_;
+  http::ReadAheadCache cache_;
+  std::unordered_map<std::string, Node> nodes_;
+};
+
+}  // namespace coro::nfs
+
+#endif  // CORO_NFS_HTTP_NFS_BACKEND_H
@@ -0,0 +1,69 @@
+#include "coro/nfs/inode_table.h"
+
+#include <functional>
+
+namespace coro::nfs {
+
+namespace {
+
+constexpr size_t kInitialBucketCount = 1024;
+
+}  // namespace
+
+InodeTable::InodeTable()
+    : ids_(kInitialBucketCount, Hash{.table = this}, Equal{.table = this}) {
+  inodes_.push_back(Inode{.parent = kRootId});
+}
+
+uint64_t InodeTable::GetId(uint64_t parent, std::string_view name) {
+  if (auto id = Find(parent, name)) {
+    return *id;
+  }
+  uint64_t id = kRootId + inodes_.size();
+  inodes_.push_back(Inode{.parent = parent, .name = std::string(name)});
+  ids_.insert(id);
+  return id;
+}
+
+std::optional<uint64_t> InodeTable::Find(uint64_t parent,
+                                         std::string_view name) const {
+  auto it = ids_.find(Key{.parent = parent, .name = name});
+  if (it == ids_.end()) {
+    return std::nullopt;
+  }
+  return *it;
+}
+
+std::string InodeTable::GetPath(uint64_t id) const {
+  if (id == kRootId) {
+    return "/";
+  }
+  std::vector<std::string_view> names;
+  for (; id != kRootId; id = GetParent(id)) {
+    names.push_back(GetName(id));
+  }
+  std::string path;
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    path += '/';
+    path += *it;
+  }
+  return path;
+}
+
+size_t InodeTable::Hash::operator()(const Key& key) const {
+  size_t hash = std::hash<std::string_view>{}(key.name);
+  return hash ^ (std::hash<uint64_t>{}(key.parent) + 0x9e3779b97f4a7c15 +
+                 (hash << 6) + (hash >> 2));
+}
+
+size_t InodeTable::Hash::operator()(uint64_t id) const {
+  const Inode& inode = table->Get(id);
+  return (*this)(Key{.parent = inode.parent, .name = inode.name});
+}
+
+bool InodeTable::Equal::operator()(const Key& key, uint64_t id) const {
+  const Inode& inode = table->Get(id);
+  return inode.parent == key.parent && inode.name == key.name;
+}
+
+}  // namespace coro::nfs
@@ -0,0 +1,82 @@
+#ifndef CORO_NFS_INODE_TABLE_H
+#define CORO_NFS_INODE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace coro::nfs {
+
+// Assigns file ids to the paths of a tree as they're discovered. Ids are
+// dense, start at kRootId and are never reused, so an id indexes straight into
+// a vector of (parent id, name) pairs. Each name is stored only there: the
+// hash set finding the id of a (parent, name) pair holds just ids, hashed by
+// the pair they index. Memory use is about 72 bytes per path with names of up
+// to 15 characters.
+class InodeTable {
+ public:
+  static constexpr uint64_t kRootId = 1;
+
+  InodeTable();
+
+  // The set's hasher keeps a pointer to the table.
+  InodeTable(const InodeTable&) = delete;
+  InodeTable& operator=(const InodeTable&) = delete;
+
+  // Returns the id of `name` in directory `parent`, assigning one if it's the
+  // first time it's seen.
+  uint64_t GetId(uint64_t parent, std::string_view name);
+  std::optional<uint64_t> Find(uint64_t parent, std::string_view name) const;
+
+  bool Contains(uint64_t id) const {
+    return id >= kRootId && id - kRootId < inodes_.size();
+  }
+  // Parent of the root is the root itself.
+  uint64_t GetParent(uint64_t id) const { return Get(id).parent; }
+  std::string_view GetName(uint64_t id) const { return Get(id).name; }
+  // "/" for the root, "/a/b" for b in directory a.
+  std::string GetPath(uint64_t id) const;
+
+  size_t size() const { return inodes_.size(); }
+
+ private:
+  struct Inode {
+    uint64_t parent;
+    std::string name;
+  };
+
+  struct Key {
+    uint64_t parent;
+    std::string_view name;
+  };
+
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(const Key& key) const;
+    size_t operator()(uint64_t id) const;
+    const InodeTable* table;
+  };
+
+  struct Equal {
+    using is_transparent = void;
+    bool operator()(uint64_t id1, uint64_t id2) const { return id1 == id2; }
+    bool operator()(const Key& key, uint64_t id) const;
+    bool operator()(uint64_t id, const Key& key) const {
+      return (*this)(key, id);
+    }
+    const InodeTable* table;
+  };
+
+  const Inode& Get(uint64_t id) const { return inodes_[id - kRootId]; }
+
+  std::vector<Inode> inodes_;
+  std::unordered_set<uint64_t, Hash, Equal> ids_;
+};
+
+}  // namespace coro::nfs
+
+#endif  // CORO_NFS_INODE_TABLE_H
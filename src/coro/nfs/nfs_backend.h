@@ -0,0 +1,56 @@
+#ifndef CORO_NFS_NFS_BACKEND_H
+#define CORO_NFS_NFS_BACKEND_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::nfs {
+
+enum class NfsFileType : uint32_t {
+  kRegular = 1,
+  kDirectory = 2,
+};
+
+struct NfsAttributes {
+  NfsFileType type = NfsFileType::kRegular;
+  uint64_t size = 0;
+  // Permission bits; the tree is read-only.
+  uint32_t mode = 0444;
+  // Seconds since the epoch.
+  int64_t mtime = 0;
+};
+
+struct NfsDirectoryEntry {
+  std::string name;
+  NfsAttributes attributes;
+};
+
+// Read-only file tree served by an NfsServer. Paths are absolute and
+// normalized: "/" is the root and "/a/b" is b in directory a. Failures are
+// reported by throwing NfsException, e.g. with NfsStatus::kNoEnt; other
+// exceptions fail the call with NfsStatus::kIO.
+class NfsBackend {
+ public:
+  virtual ~NfsBackend() = default;
+
+  virtual Task<NfsAttributes> GetAttributes(std::string path,
+                                            stdx::stop_token stop_token) = 0;
+
+  // Entries are returned in a stable order, without "." and "..".
+  virtual Task<std::vector<NfsDirectoryEntry>> ListDirectory(
+      std::string path, stdx::stop_token stop_token) = 0;
+
+  // Returns at most `size` bytes of the file starting at `offset`; fewer only
+  // past its end.
+  virtual Task<std::string> Read(std::string path, uint64_t offset,
+                                 uint32_t size,
+                                 stdx::stop_token stop_token) = 0;
+};
+
+}  // namespace coro::nfs
+
+#endif  // CORO_NFS_NFS_BACKEND_H
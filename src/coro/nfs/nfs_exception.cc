@@ -0,0 +1,42 @@
+#include "coro/nfs/nfs_exception.h"
+
+namespace coro::nfs {
+
+std::string NfsException::ToString(NfsStatus status) {
+  switch (status) {
+    case NfsStatus::kOk:
+      return "Ok.";
+    case NfsStatus::kPerm:
+      return "Not owner.";
+    case NfsStatus::kNoEnt:
+      return "No such file or directory.";
+    case NfsStatus::kIO:
+      return "I/O error.";
+    case NfsStatus::kAccess:
+      return "Permission denied.";
+    case NfsStatus::kNotDir:
+      return "Not a directory.";
+    case NfsStatus::kIsDir:
+      return "Is a directory.";
+    case NfsStatus::kInval:
+      return "Invalid argument.";
+    case NfsStatus::kNameTooLong:
+      return "Name too long.";
+    case NfsStatus::kStale:
+      return "Stale file handle.";
+    case NfsStatus::kBadHandle:
+      return "Illegal file handle.";
+    case NfsStatus::kBadCookie:
+      return "Stale directory cookie.";
+    case NfsStatus::kNotSupp:
+      return "Operation not supported.";
+    case NfsStatus::kTooSmall:
+      return "Buffer too small.";
+    case NfsStatus::kServerFault:
+      return "Server fault.";
+    default:
+      return "Unknown.";
+  }
+}
+
+}  // namespace coro::nfs
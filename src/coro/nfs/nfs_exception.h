@@ -0,0 +1,62 @@
+#ifndef CORO_NFS_NFS_EXCEPTION_H
+#define CORO_NFS_NFS_EXCEPTION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "coro/exception.h"
+
+namespace coro::nfs {
+
+// NFSv3 status codes, as sent in replies.
+enum class NfsStatus : uint32_t {
+  kOk = 0,
+  kPerm = 1,
+  kNoEnt = 2,
+  kIO = 5,
+  kAccess = 13,
+  kNotDir = 20,
+  kIsDir = 21,
+  kInval = 22,
+  kNameTooLong = 63,
+  kStale = 70,
+  kBadHandle = 10001,
+  kBadCookie = 10003,
+  kNotSupp = 10004,
+  kTooSmall = 10005,
+  kServerFault = 10006,
+};
+
+// Thrown by NfsBackends; the call fails with `status`.
+class NfsException : public Exception {
+ public:
+  NfsException(
+      NfsStatus status,
+      stdx::source_location location = stdx::source_location::current(),
+      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      : NfsException(status, ToString(status), location, stacktrace) {}
+
+  NfsException(
+      NfsStatus status, std::string_view message,
+      stdx::source_location location = stdx::source_location::current(),
+      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      : Exception(std::move(location), std::move(stacktrace)),
+        status_(status),
+        message_(message) {}
+
+  [[nodiscard]] const char* what() const noexcept override {
+    return message_.c_str();
+  }
+  [[nodiscard]] NfsStatus status() const noexcept { return status_; }
+
+ private:
+  static std::string ToString(NfsStatus status);
+
+  NfsStatus status_;
+  std::string message_;
+};
+
+}  // namespace coro::nfs
+
+#endif  // CORO_NFS_NFS_EXCEPTION_H
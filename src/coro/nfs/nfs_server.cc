@@ -0,0 +1,716 @@
+#include "coro/nfs/nfs_server.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+#include "coro/interrupted_exception.h"
+#include "coro/nfs/nfs_exception.h"
+#include "coro/rpc/rpc_exception.h"
+
+namespace coro::nfs {
+
+namespace {
+
+using ::coro::rpc::GetVariableLengthOpaque;
+using ::coro::rpc::ParseUInt32;
+using ::coro::rpc::ParseUInt64;
+using ::coro::rpc::RpcException;
+using ::coro::rpc::RpcRequest;
+using ::coro::rpc::RpcResponse;
+using ::coro::rpc::RpcResponseAcceptedBody;
+using ::coro::rpc::XdrSerializer;
+using ::coro::util::DrainTcpDataProvider;
+using ::coro::util::TcpRequestDataProvider;
+using ::coro::util::TcpResponseChunk;
+
+constexpr uint32_t kMaxHandleSize = 64;
+constexpr uint32_t kHandleSize = 16;
+constexpr uint32_t kMaxPathLength = 1024;
+constexpr uint32_t kMaxNameLength = 255;
+constexpr uint32_t kCookieVerfSize = 8;
+
+constexpr uint32_t kAccessRead = 0x0001;
+constexpr uint32_t kAccessLookup = 0x0002;
+constexpr uint32_t kAccessExecute = 0x0020;
+
+constexpr uint32_t kMountOk = 0;
+constexpr uint32_t kMountNoEnt = 2;
+
+struct PortMapperService {
+  static constexpr uint32_t kProgId = 100000;
+  static constexpr uint32_t kProgVersion = 2;
+
+  static constexpr uint32_t kGetPortProcId = 3;
+
+  static constexpr uint32_t kTcpProtocol = 6;
+};
+
+struct NfsService {
+  static constexpr uint32_t kProgId = 100003;
+  static constexpr uint32_t kProgVersion = 3;
+
+  static constexpr uint32_t kGetAttrProcId = 1;
+  static constexpr uint32_t kLookupProcId = 3;
+  static constexpr uint32_t kAccessProcId = 4;
+  static constexpr uint32_t kReadProcId = 6;
+  static constexpr uint32_t kReadDirPlusProcId = 17;
+  static constexpr uint32_t kFsStatProcId = 18;
+  static constexpr uint32_t kFsInfoProcId = 19;
+  static constexpr uint32_t kPathConfProcId = 20;
+};
+
+struct MountService {
+  static constexpr uint32_t kProgId = 100005;
+  static constexpr uint32_t kProgVersion = 3;
+
+  static constexpr uint32_t kMountProcId = 1;
+  static constexpr uint32_t kUnmountProcId = 3;
+  static constexpr uint32_t kExportProcId = 5;
+};
+
+struct NfsLockManagerService {
+  static constexpr uint32_t kProgId = 100021;
+  static constexpr uint32_t kProgVersion = 4;
+};
+
+struct StatusMonitorService {
+  static constexpr uint32_t kProgId = 100024;
+  static constexpr uint32_t kProgVersion = 1;
+};
+
+struct NfsHandle3 {
+  uint64_t instance_id;
+  uint64_t fileid;
+};
+
+struct NfsTime3 {
+  uint32_t seconds;
+  uint32_t nseconds;
+};
+
+constexpr auto GetXdrFields(const NfsTime3&) {
+  return std::tuple(&NfsTime3::seconds, &NfsTime3::nseconds);
+}
+
+struct NfsSpecData3 {
+  uint32_t specdata1;
+  uint32_t specdata2;
+};
+
+constexpr auto GetXdrFields(const NfsSpecData3&) {
+  return std::tuple(&NfsSpecData3::specdata1, &NfsSpecData3::specdata2);
+}
+
+struct NfsFileAttr3 {
+  NfsFileType type;
+  uint32_t mode;
+  uint32_t nlink;
+  uint32_t uid;
+  uint32_t gid;
+  uint64_t size;
+  uint64_t used;
+  NfsSpecData3 rdev;
+  uint64_t fsid;
+  uint64_t fileid;
+  NfsTime3 atime;
+  NfsTime3 mtime;
+  NfsTime3 ctime;
+};
+
+constexpr auto GetXdrFields(const NfsFileAttr3&) {
+  return std::tuple(&NfsFileAttr3::type, &NfsFileAttr3::mode,
+                    &NfsFileAttr3::nlink, &NfsFileAttr3::uid,
+                    &NfsFileAttr3::gid, &NfsFileAttr3::size,
+                    &NfsFileAttr3::used, &NfsFileAttr3::rdev,
+                    &NfsFileAttr3::fsid, &NfsFileAttr3::fileid,
+                    &NfsFileAttr3::atime, &NfsFileAttr3::mtime,
+                    &NfsFileAttr3::ctime);
+}
+
+constexpr size_t kFileAttrSize = rpc::internal::GetXdrFixedSize<NfsFileAttr3>();
+static_assert(kFileAttrSize == 84);
+
+struct FsInfo3 {
+  std::optional<NfsFileAttr3> attributes;
+  uint32_t rtmax;
+  uint32_t rtpref;
+  uint32_t rtmult;
+  uint32_t wtmax;
+  uint32_t wtpref;
+  uint32_t wtmult;
+  uint32_t dtpref;
+  uint64_t maxfilesize;
+  NfsTime3 time_delta;
+  uint32_t properties;
+};
+
+constexpr auto GetXdrFields(const FsInfo3&) {
+  return std::tuple(&FsInfo3::attributes, &FsInfo3::rtmax, &FsInfo3::rtpref,
+                    &FsInfo3::rtmult, &FsInfo3::wtmax, &FsInfo3::wtpref,
+                    &FsInfo3::wtmult, &FsInfo3::dtpref, &FsInfo3::maxfilesize,
+                    &FsInfo3::time_delta, &FsInfo3::properties);
+}
+
+struct FsStat3 {
+  std::optional<NfsFileAttr3> attributes;
+  uint64_t tbytes;
+  uint64_t fbytes;
+  uint64_t abytes;
+  uint64_t tfiles;
+  uint64_t ffiles;
+  uint64_t afiles;
+  uint32_t invarsec;
+};
+
+constexpr auto GetXdrFields(const FsStat3&) {
+  return std::tuple(&FsStat3::attributes, &FsStat3::tbytes, &FsStat3::fbytes,
+                    &FsStat3::abytes, &FsStat3::tfiles, &FsStat3::ffiles,
+                    &FsStat3::afiles, &FsStat3::invarsec);
+}
+
+struct PathConf3 {
+  std::optional<NfsFileAttr3> attributes;
+  uint32_t linkmax;
+  uint32_t name_max;
+  bool no_trunc;
+  bool chown_restricted;
+  bool case_insensitive;
+  bool case_preserving;
+};
+
+constexpr auto GetXdrFields(const PathConf3&) {
+  return std::tuple(&PathConf3::attributes, &PathConf3::linkmax,
+                    &PathConf3::name_max, &PathConf3::no_trunc,
+                    &PathConf3::chown_restricted, &PathConf3::case_insensitive,
+                    &PathConf3::case_preserving);
+}
+
+void PutHandle(std::vector<uint8_t>* data, const NfsHandle3& handle) {
+  XdrSerializer{data}.PutAll(kHandleSize, handle.instance_id, handle.fileid);
+}
+
+NfsFileAttr3 ToFileAttr3(uint64_t id, const NfsAttributes& attributes) {
+  NfsTime3 time{.seconds = static_cast<uint32_t>(attributes.mtime)};
+  return NfsFileAttr3{
+      .type = attributes.type,
+      .mode = attributes.mode,
+      .nlink = attributes.type == NfsFileType::kDirectory ? 2u : 1u,
+      .size = attributes.size,
+      .used = attributes.size,
+      .fileid = id,
+      .atime = time,
+      .mtime = time,
+      .ctime = time};
+}
+
+size_t GetOpaqueSize(size_t length) { return 4 + (length + 3) / 4 * 4; }
+
+std::string ToString(std::span<const uint8_t> bytes) {
+  return std::string(reinterpret_cast<const char*>(bytes.data()),
+                     bytes.size());
+}
+
+Generator<TcpResponseChunk> ToResponseChunks(std::vector<uint8_t> data) {
+  co_yield std::move(data);
+}
+
+// `payload` is sent as is after `header`, followed by the XDR padding.
+Generator<TcpResponseChunk> ToResponseChunks(std::vector<uint8_t> header,
+                                             std::string payload) {
+  size_t padding = GetOpaqueSize(payload.size()) - 4 - payload.size();
+  co_yield std::move(header);
+  co_yield std::move(payload);
+  if (padding > 0) {
+    co_yield std::vector<uint8_t>(padding, 0);
+  }
+}
+
+RpcResponse ToResponse(Generator<TcpResponseChunk> data) {
+  return RpcResponse{
+      .body = {.body = RpcResponseAcceptedBody{.data = std::move(data)}}};
+}
+
+RpcResponse ToResponse(std::vector<uint8_t> data) {
+  return ToResponse(ToResponseChunks(std::move(data)));
+}
+
+Task<RpcResponse> ToErrorResponse(RpcRequest request,
+                                  RpcResponseAcceptedBody::Stat stat) {
+  co_await DrainTcpDataProvider(std::move(request.body.data));
+  co_return RpcResponse{
+      .body = {.body = RpcResponseAcceptedBody{.stat = stat}}};
+}
+
+// All the procedures served, but GETATTR, reply with a post-operation
+// attribute on failure, which is left out.
+RpcResponse ToErrorResponse(uint32_t proc, NfsStatus status) {
+  std::vector<uint8_t> data;
+  XdrSerializer s{&data};
+  s.Put(status);
+  if (proc != NfsService::kGetAttrProcId) {
+    s.Put(0u);
+  }
+  return ToResponse(std::move(data));
+}
+
+bool IsValidName(std::string_view name) {
+  return !name.empty() && name != "." && name != ".." &&
+         name.find('/') == std::string_view::npos &&
+         name.size() <= kMaxNameLength;
+}
+
+uint32_t GetAllowedAccess(const NfsAttributes& attributes) {
+  if (attributes.type == NfsFileType::kDirectory) {
+    return kAccessRead | kAccessLookup | kAccessExecute;
+  }
+  return kAccessRead | ((attributes.mode & 0111) ? kAccessExecute : 0);
+}
+
+}  // namespace
+
+NfsServer::NfsServer(NfsBackend* backend, NfsServerConfig config)
+    : backend_(backend),
+      config_(std::move(config)),
+      instance_id_(static_cast<uint64_t>(
+          std::chrono::system_clock::now().time_since_epoch().count())),
+      attributes_(config_.max_cached_attributes, FetchAttributes{.d = this}),
+      directories_(std::numeric_limits<int>::max(),
+                   config_.max_cached_directory_entries,
+                   FetchDirectory{.d = this}) {}
+
+NfsServer::~NfsServer() = default;
+
+rpc::RpcHandler NfsServer::GetRpcHandler() {
+  return [d = this](RpcRequest request, stdx::stop_token stop_token) {
+    return d->HandleCall(std::move(request), std::move(stop_token));
+  };
+}
+
+Task<RpcResponse> NfsServer::HandleCall(RpcRequest request,
+                                        stdx::stop_token stop_token) {
+  auto is_version = [&](uint32_t vers) { return request.body.vers == vers; };
+  switch (request.body.prog) {
+    case PortMapperService::kProgId:
+      if (is_version(PortMapperService::kProgVersion)) {
+        co_return co_await HandlePortMapperCall(std::move(request));
+      }
+      break;
+    case MountService::kProgId:
+      if (is_version(MountService::kProgVersion)) {
+        co_return co_await HandleMountCall(std::move(request));
+      }
+      break;
+    case NfsService::kProgId:
+      if (is_version(NfsService::kProgVersion)) {
+        co_return co_await HandleNfsCall(std::move(request),
+                                         std::move(stop_token));
+      }
+      break;
+    // Only pinged by clients before mounting; locking isn't supported.
+    case NfsLockManagerService::kProgId:
+    case StatusMonitorService::kProgId:
+      if (request.body.proc == 0 &&
+          (is_version(NfsLockManagerService::kProgVersion) ||
+           is_version(StatusMonitorService::kProgVersion))) {
+        co_return RpcResponse{};
+      }
+      break;
+    default:
+      co_return co_await ToErrorResponse(
+          std::move(request), RpcResponseAcceptedBody::Stat::kProgUnavail);
+  }
+  co_return co_await ToErrorResponse(
+      std::move(request), RpcResponseAcceptedBody::Stat::kProcUnavail);
+}
+
+Task<RpcResponse> NfsServer::HandlePortMapperCall(RpcRequest request) {
+  switch (request.body.proc) {
+    case 0:
+      co_return RpcResponse{};
+    case PortMapperService::kGetPortProcId: {
+      uint32_t prog = ParseUInt32(co_await request.body.data(4));
+      uint32_t vers = ParseUInt32(co_await request.body.data(4));
+      uint32_t prot = ParseUInt32(co_await request.body.data(4));
+      co_await request.body.data(4);
+      bool served =
+          prot == PortMapperService::kTcpProtocol &&
+          ((prog == NfsService::kProgId && vers == NfsService::kProgVersion) ||
+           (prog == MountService::kProgId &&
+            vers == MountService::kProgVersion) ||
+           (prog == NfsLockManagerService::kProgId &&
+            vers == NfsLockManagerService::kProgVersion) ||
+           (prog == StatusMonitorService::kProgId &&
+            vers == StatusMonitorService::kProgVersion));
+      std::vector<uint8_t> data;
+      XdrSerializer{&data}.Put(served ? uint32_t(config_.port) : 0u);
+      co_return ToResponse(std::move(data));
+    }
+    default:
+      co_return co_await ToErrorResponse(
+          std::move(request), RpcResponseAcceptedBody::Stat::kProcUnavail);
+  }
+}
+
+Task<RpcResponse> NfsServer::HandleMountCall(RpcRequest request) {
+  switch (request.body.proc) {
+    case 0:
+      co_return RpcResponse{};
+    case MountService::kMountProcId: {
+      std::string path = ToString(
+          co_await GetVariableLengthOpaque(request.body.data, kMaxPathLength));
+      std::vector<uint8_t> data;
+      XdrSerializer s{&data};
+      if (path != config_.export_path) {
+        s.Put(kMountNoEnt);
+        co_return ToResponse(std::move(data));
+      }
+      s.Put(kMountOk);
+      PutHandle(&data, NfsHandle3{.instance_id = instance_id_,
+                                  .fileid = InodeTable::kRootId});
+      // A single authentication flavor, AUTH_NONE.
+      s.Put(1u).Put(0u);
+      co_return ToResponse(std::move(data));
+    }
+    case MountService::kUnmountProcId:
+      co_await DrainTcpDataProvider(std::move(request.body.data));
+      co_return RpcResponse{};
+    case MountService::kExportProcId: {
+      std::vector<uint8_t> data;
+      XdrSerializer{&data}
+          .Put(1u)
+          .Put(std::string_view(config_.export_path))
+          .Put(0u)
+          .Put(0u);
+      co_return ToResponse(std::move(data));
+    }
+    default:
+      co_return co_await ToErrorResponse(
+          std::move(request), RpcResponseAcceptedBody::Stat::kProcUnavail);
+  }
+}
+
+Task<RpcResponse> NfsServer::HandleNfsCall(RpcRequest request,
+                                           stdx::stop_token stop_token) {
+  uint32_t proc = request.body.proc;
+  NfsStatus status;
+  try {
+    switch (proc) {
+      case 0:
+        co_return RpcResponse{};
+      case NfsService::kGetAttrProcId:
+        co_return co_await GetAttr(request, std::move(stop_token));
+      case NfsService::kLookupProcId:
+        co_return co_await Lookup(request, std::move(stop_token));
+      case NfsService::kAccessProcId:
+        co_return co_await Access(request, std::move(stop_token));
+      case NfsService::kReadProcId:
+        co_return co_await Read(request, std::move(stop_token));
+      case NfsService::kReadDirPlusProcId:
+        co_return co_await ReadDirPlus(request, std::move(stop_token));
+      case NfsService::kFsStatProcId:
+        co_return co_await FsStat(request);
+      case NfsService::kFsInfoProcId:
+        co_return co_await FsInfo(request);
+      case NfsService::kPathConfProcId:
+        co_return co_await PathConf(request);
+      default:
+        co_return co_await ToErrorResponse(
+            std::move(request), RpcResponseAcceptedBody::Stat::kProcUnavail);
+    }
+  } catch (const NfsException& e) {
+    status = e.status();
+  } catch (const InterruptedException&) {
+    throw;
+  } catch (const RpcException&) {
+    throw;
+  } catch (const std::exception& e) {
+    std::cerr << "[NFS]: " << e.what() << '\n';
+    status = NfsStatus::kIO;
+  }
+  co_await DrainTcpDataProvider(std::move(request.body.data));
+  co_return ToErrorResponse(proc, status);
+}
+
+Task<RpcResponse> NfsServer::GetAttr(RpcRequest& request,
+                                     stdx::stop_token stop_token) {
+  uint64_t id = co_await ReadHandle(request.body.data);
+  NfsAttributes attributes =
+      co_await GetAttributes(id, std::move(stop_token));
+  std::vector<uint8_t> data;
+  XdrSerializer{&data}.Put(NfsStatus::kOk).Put(ToFileAttr3(id, attributes));
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::Lookup(RpcRequest& request,
+                                    stdx::stop_token stop_token) {
+  uint64_t directory = co_await ReadHandle(request.body.data);
+  std::string name = ToString(
+      co_await GetVariableLengthOpaque(request.body.data, kMaxPathLength));
+  NfsAttributes directory_attributes =
+      co_await GetAttributes(directory, stop_token);
+  if (directory_attributes.type != NfsFileType::kDirectory) {
+    throw NfsException(NfsStatus::kNotDir);
+  }
+  if (name.size() > kMaxNameLength) {
+    throw NfsException(NfsStatus::kNameTooLong);
+  }
+  uint64_t id;
+  NfsAttributes attributes;
+  if (name == ".") {
+    id = directory;
+    attributes = directory_attributes;
+  } else if (name == "..") {
+    id = inodes_.GetParent(directory);
+    attributes = co_await GetAttributes(id, std::move(stop_token));
+  } else if (!IsValidName(name)) {
+    throw NfsException(NfsStatus::kNoEnt);
+  } else if (auto known_id = inodes_.Find(directory, name)) {
+    id = *known_id;
+    attributes = co_await GetAttributes(id, std::move(stop_token));
+  } else {
+    // Only names which exist are given an id.
+    std::string path = inodes_.GetPath(directory);
+    if (path.back() != '/') {
+      path += '/';
+    }
+    path += name;
+    attributes = co_await backend_->GetAttributes(std::move(path),
+                                                  std::move(stop_token));
+    id = inodes_.GetId(directory, name);
+    attributes_.Put(
+        id, CachedAttributes{.attributes = attributes,
+                             .expires_at = std::chrono::steady_clock::now() +
+                                           config_.attribute_ttl});
+  }
+  std::vector<uint8_t> data;
+  XdrSerializer s{&data};
+  s.Put(NfsStatus::kOk);
+  PutHandle(&data, NfsHandle3{.instance_id = instance_id_, .fileid = id});
+  s.Put(std::make_optional(ToFileAttr3(id, attributes)))
+      .Put(std::make_optional(ToFileAttr3(directory, directory_attributes)));
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::Access(RpcRequest& request,
+                                    stdx::stop_token stop_token) {
+  uint64_t id = co_await ReadHandle(request.body.data);
+  uint32_t access = ParseUInt32(co_await request.body.data(4));
+  NfsAttributes attributes =
+      co_await GetAttributes(id, std::move(stop_token));
+  std::vector<uint8_t> data;
+  XdrSerializer{&data}
+      .Put(NfsStatus::kOk)
+      .Put(std::make_optional(ToFileAttr3(id, attributes)))
+      .Put(access & GetAllowedAccess(attributes));
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::Read(RpcRequest& request,
+                                  stdx::stop_token stop_token) {
+  uint64_t id = co_await ReadHandle(request.body.data);
+  uint64_t offset = ParseUInt64(co_await request.body.data(8));
+  uint32_t count = std::min(ParseUInt32(co_await request.body.data(4)),
+                            config_.max_read_size);
+  NfsAttributes attributes = co_await GetAttributes(id, stop_token);
+  if (attributes.type == NfsFileType::kDirectory) {
+    throw NfsException(NfsStatus::kIsDir);
+  }
+  std::string payload;
+  if (offset < attributes.size && count > 0) {
+    payload = co_await backend_->Read(inodes_.GetPath(id), offset, count,
+                                      std::move(stop_token));
+  }
+  std::vector<uint8_t> header;
+  XdrSerializer{&header}
+      .Put(NfsStatus::kOk)
+      .Put(std::make_optional(ToFileAttr3(id, attributes)))
+      .PutAll(static_cast<uint32_t>(payload.size()),
+              offset + payload.size() >= attributes.size,
+              static_cast<uint32_t>(payload.size()));
+  co_return ToResponse(
+      ToResponseChunks(std::move(header), std::move(payload)));
+}
+
+Task<RpcResponse> NfsServer::ReadDirPlus(RpcRequest& request,
+                                         stdx::stop_token stop_token) {
+  uint64_t directory = co_await ReadHandle(request.body.data);
+  uint64_t cookie = ParseUInt64(co_await request.body.data(8));
+  uint64_t cookie_verifier =
+      ParseUInt64(co_await request.body.data(kCookieVerfSize));
+  uint32_t dir_count = ParseUInt32(co_await request.body.data(4));
+  uint32_t max_count = ParseUInt32(co_await request.body.data(4));
+  NfsAttributes directory_attributes =
+      co_await GetAttributes(directory, stop_token);
+  if (directory_attributes.type != NfsFileType::kDirectory) {
+    throw NfsException(NfsStatus::kNotDir);
+  }
+  std::shared_ptr<const DirectoryListing> listing;
+  if (cookie == 0) {
+    listing = co_await GetDirectory(directory, std::move(stop_token));
+  } else if (auto cached = directories_.GetCached(directory);
+             cached && (*cached)->verifier == cookie_verifier &&
+             cookie <= (*cached)->entries.size()) {
+    listing = std::move(*cached);
+  } else {
+    throw NfsException(NfsStatus::kBadCookie);
+  }
+
+  std::vector<uint8_t> data;
+  XdrSerializer s{&data};
+  s.Put(NfsStatus::kOk)
+      .Put(std::make_optional(ToFileAttr3(directory, directory_attributes)))
+      .Put(listing->verifier);
+  // Status, directory attributes, verifier, end of the entry list and eof.
+  size_t reply_size = 4 + 4 + kFileAttrSize + kCookieVerfSize + 4 + 4;
+  size_t names_size = 0;
+  size_t index = cookie;
+  for (; index < listing->entries.size(); index++) {
+    const DirectoryListing::Entry& entry = listing->entries[index];
+    std::string_view name = inodes_.GetName(entry.id);
+    size_t entry_names_size = 8 + GetOpaqueSize(name.size()) + 8;
+    size_t entry_size =
+        4 + entry_names_size + 4 + kFileAttrSize + 4 + 4 + kHandleSize;
+    if (reply_size + entry_size > max_count ||
+        names_size + entry_names_size > dir_count) {
+      break;
+    }
+    reply_size += entry_size;
+    names_size += entry_names_size;
+    s.PutAll(1u, entry.id).Put(name).Put(uint64_t(index + 1));
+    s.Put(std::make_optional(ToFileAttr3(entry.id, entry.attributes)));
+    s.Put(1u);
+    PutHandle(&data, NfsHandle3{.instance_id = instance_id_,
+                                .fileid = entry.id});
+  }
+  if (index == cookie && index < listing->entries.size()) {
+    throw NfsException(NfsStatus::kTooSmall);
+  }
+  s.PutAll(0u, index == listing->entries.size());
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::FsStat(RpcRequest& request) {
+  co_await ReadHandle(request.body.data);
+  std::vector<uint8_t> data;
+  XdrSerializer(&data).Put(NfsStatus::kOk);
+  uint64_t total_space = 2137ull << 50;
+  uint64_t free_space = 420ull << 50;
+  XdrSerializer(&data).Put(FsStat3{.tbytes = total_space,
+                                   .fbytes = free_space,
+                                   .abytes = free_space,
+                                   .tfiles = UINT64_MAX,
+                                   .ffiles = UINT64_MAX,
+                                   .afiles = UINT64_MAX,
+                                   .invarsec = 0});
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::FsInfo(RpcRequest& request) {
+  co_await ReadHandle(request.body.data);
+  std::vector<uint8_t> data;
+  XdrSerializer(&data).Put(NfsStatus::kOk);
+  XdrSerializer(&data).Put(FsInfo3{.rtmax = config_.max_read_size,
+                                   .rtpref = config_.max_read_size,
+                                   .rtmult = 1,
+                                   .wtmax = 0,
+                                   .wtpref = 0,
+                                   .wtmult = 1,
+                                   .dtpref = 64 * 1024,
+                                   .maxfilesize = UINT64_MAX,
+                                   .time_delta = {.seconds = 1},
+                                   .properties = 0x0008});
+  co_return ToResponse(std::move(data));
+}
+
+Task<RpcResponse> NfsServer::PathConf(RpcRequest& request) {
+  co_await ReadHandle(request.body.data);
+  std::vector<uint8_t> data;
+  XdrSerializer(&data).Put(NfsStatus::kOk);
+  XdrSerializer(&data).Put(
+      PathConf3{.name_max = kMaxNameLength, .no_trunc = true});
+  co_return ToResponse(std::move(data));
+}
+
+Task<uint64_t> NfsServer::ReadHandle(TcpRequestDataProvider& data) const {
+  std::vector<uint8_t> handle =
+      co_await GetVariableLengthOpaque(data, kMaxHandleSize);
+  if (handle.size() != kHandleSize) {
+    throw NfsException(NfsStatus::kBadHandle);
+  }
+  uint64_t instance_id = ParseUInt64(std::span(handle).subspan(0, 8));
+  uint64_t id = ParseUInt64(std::span(handle).subspan(8, 8));
+  if (instance_id != instance_id_ || !inodes_.Contains(id)) {
+    throw NfsException(NfsStatus::kStale);
+  }
+  co_return id;
+}
+
+Task<NfsAttributes> NfsServer::GetAttributes(uint64_t id,
+                                             stdx::stop_token stop_token) {
+  if (auto cached = attributes_.GetCached(id);
+      cached && std::chrono::steady_clock::now() < cached->expires_at) {
+    co_return cached->attributes;
+  }
+  CachedAttributes fetched =
+      co_await attributes_.Refresh(id, std::move(stop_token));
+  co_return fetched.attributes;
+}
+
+auto NfsServer::GetDirectory(uint64_t id, stdx::stop_token stop_token)
+    -> Task<std::shared_ptr<const DirectoryListing>> {
+  if (auto cached = directories_.GetCached(id);
+      cached && std::chrono::steady_clock::now() < (*cached)->expires_at) {
+    co_return std::move(*cached);
+  }
+  co_return co_await directories_.Refresh(id, std::move(stop_token));
+}
+
+auto NfsServer::FetchAttributes::operator()(uint64_t id,
+                                            stdx::stop_token stop_token) const
+    -> Task<CachedAttributes> {
+  NfsAttributes attributes = co_await d->backend_->GetAttributes(
+      d->inodes_.GetPath(id), std::move(stop_token));
+  co_return CachedAttributes{
+      .attributes = attributes,
+      .expires_at =
+          std::chrono::steady_clock::now() + d->config_.attribute_ttl};
+}
+
+// Entries get their ids and cached attributes here, so that LOOKUP and
+// GETATTR of names listed before don't reach the backend.
+auto NfsServer::FetchDirectory::operator()(uint64_t id,
+                                           stdx::stop_token stop_token) const
+    -> Task<std::shared_ptr<const DirectoryListing>> {
+  std::vector<NfsDirectoryEntry> entries = co_await d->backend_->ListDirectory(
+      d->inodes_.GetPath(id), std::move(stop_token));
+  auto now = std::chrono::steady_clock::now();
+  auto listing = std::make_shared<DirectoryListing>();
+  listing->verifier = ++d->listing_count_;
+  listing->expires_at = now + d->config_.directory_ttl;
+  listing->entries.reserve(entries.size());
+  for (NfsDirectoryEntry& entry : entries) {
+    if (!IsValidName(entry.name)) {
+      continue;
+    }
+    uint64_t entry_id = d->inodes_.GetId(id, entry.name);
+    d->attributes_.Put(
+        entry_id,
+        CachedAttributes{.attributes = entry.attributes,
+                         .expires_at = now + d->config_.attribute_ttl});
+    listing->entries.push_back(DirectoryListing::Entry{
+        .id = entry_id, .attributes = entry.attributes});
+  }
+  co_return listing;
+}
+
+size_t NfsServer::DirectoryWeigher::operator()(
+    uint64_t, const std::shared_ptr<const DirectoryListing>& listing) const {
+  return listing->entries.size() + 1;
+}
+
+}  // namespace coro::nfs
@@ -0,0 +1,138 @@
+#ifndef CORO_NFS_NFS_SERVER_H
+#define CORO_NFS_NFS_SERVER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coro/nfs/inode_table.h"
+#include "coro/nfs/nfs_backend.h"
+#include "coro/rpc/rpc_server.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/lru_cache.h"
+
+namespace coro::nfs {
+
+struct NfsServerConfig {
+  // Attributes from the backend, including those of directory entries, are
+  // served from memory for this long. GETATTR of a handle whose attributes
+  // are cached doesn't reach the backend.
+  std::chrono::milliseconds attribute_ttl = std::chrono::seconds(10);
+  // READDIRPLUS starting a listing reuses a cached one for this long. Listings
+  // being paged through stay valid past it.
+  std::chrono::milliseconds directory_ttl = std::chrono::seconds(10);
+  int max_cached_attributes = 1024 * 1024;
+  // Upper bound on the entries of all cached listings.
+  size_t max_cached_directory_entries = 1024 * 1024;
+  uint32_t max_read_size = 1024 * 1024;
+  // Directory reported by the MOUNT program's EXPORT procedure; mounting any
+  // other one fails.
+  std::string export_path = "/";
+  // Reported by the portmapper for the NFS and MOUNT programs.
+  uint16_t port = 2049;
+};
+
+// Serves an NfsBackend read-only over NFSv3, along with the MOUNT program and
+// a portmapper answering where to find both. Handles name a file id of an
+// InodeTable and the server instance, so that handles issued before a restart
+// are rejected as stale rather than resolving to different files. Not
+// thread-safe: all calls have to be handled on the same event loop.
+class NfsServer {
+ public:
+  // `backend` has to outlive the server.
+  explicit NfsServer(NfsBackend* backend, NfsServerConfig config = {});
+  ~NfsServer();
+
+  NfsServer(const NfsServer&) = delete;
+  NfsServer& operator=(const NfsServer&) = delete;
+
+  // Handler for CreateRpcServer, which can be shared by several servers, e.g.
+  // one on the portmapper port 111 and one on `config.port`. The NfsServer has
+  // to outlive them.
+  rpc::RpcHandler GetRpcHandler();
+
+  Task<rpc::RpcResponse> HandleCall(rpc::RpcRequest request,
+                                    stdx::stop_token stop_token);
+
+ private:
+  struct CachedAttributes {
+    NfsAttributes attributes;
+    std::chrono::steady_clock::time_point expires_at;
+  };
+
+  struct DirectoryListing {
+    struct Entry {
+      uint64_t id;
+      NfsAttributes attributes;
+    };
+
+    std::vector<Entry> entries;
+    // Sent as the cookie verifier, so that cookies of a replaced listing are
+    // rejected.
+    uint64_t verifier;
+    std::chrono::steady_clock::time_point expires_at;
+  };
+
+  struct FetchAttributes {
+    Task<CachedAttributes> operator()(uint64_t id,
+                                      stdx::stop_token stop_token) const;
+    NfsServer* d;
+  };
+
+  struct FetchDirectory {
+    Task<std::shared_ptr<const DirectoryListing>> operator()(
+        uint64_t id, stdx::stop_token stop_token) const;
+    NfsServer* d;
+  };
+
+  struct DirectoryWeigher {
+    size_t operator()(
+        uint64_t id,
+        const std::shared_ptr<const DirectoryListing>& listing) const;
+  };
+
+  Task<rpc::RpcResponse> HandleNfsCall(rpc::RpcRequest request,
+                                       stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> HandleMountCall(rpc::RpcRequest request);
+  Task<rpc::RpcResponse> HandlePortMapperCall(rpc::RpcRequest request);
+
+  Task<rpc::RpcResponse> GetAttr(rpc::RpcRequest& request,
+                                 stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> Lookup(rpc::RpcRequest& request,
+                                stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> Access(rpc::RpcRequest& request,
+                                stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> Read(rpc::RpcRequest& request,
+                              stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> ReadDirPlus(rpc::RpcRequest& request,
+                                     stdx::stop_token stop_token);
+  Task<rpc::RpcResponse> FsStat(rpc::RpcRequest& request);
+  Task<rpc::RpcResponse> FsInfo(rpc::RpcRequest& request);
+  Task<rpc::RpcResponse> PathConf(rpc::RpcRequest& request);
+
+  // Reads a handle from the call's arguments and returns its file id. Throws
+  // NfsException with kBadHandle or kStale if the handle isn't one of ours.
+  Task<uint64_t> ReadHandle(util::TcpRequestDataProvider& data) const;
+  Task<NfsAttributes> GetAttributes(uint64_t id, stdx::stop_token stop_token);
+  Task<std::shared_ptr<const DirectoryListing>> GetDirectory(
+      uint64_t id, stdx::stop_token stop_token);
+
+  NfsBackend* backend_;
+  NfsServerConfig config_;
+  // Identifies the server instance in handles.
+  uint64_t instance_id_;
+  uint64_t listing_count_ = 0;
+  InodeTable inodes_;
+  util::LRUCache<uint64_t, FetchAttributes> attributes_;
+  util::LRUCache<uint64_t, FetchDirectory, std::hash<uint64_t>,
+                 DirectoryWeigher>
+      directories_;
+};
+
+}  // namespace coro::nfs
+
+#endif  // CORO_NFS_NFS_SERVER_H
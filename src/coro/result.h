@@ -0,0 +1,116 @@
+#ifndef CORO_RESULT_H
+#define CORO_RESULT_H
+
+#include <exception>
+#include <memory>
+#include <utility>
+#include <variant>
+
+namespace coro {
+
+// Outcome of an operation: either its value or the exception it failed with,
+// which is held without being rethrown until value() is called. Returned by
+// Task::AsResult, so that expected failures such as cancellation can be
+// handled without a throw and a catch at each level.
+template <typename T = void>
+class Result {
+ public:
+  Result(T value) : result_(std::in_place_index<0>, std::move(value)) {}
+
+  static Result Failure(std::exception_ptr exception) {
+    return Result(std::move(exception));
+  }
+
+  bool has_value() const noexcept { return result_.index() == 0; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  // Rethrows the exception if the operation failed.
+  T& value() & {
+    Check();
+    return std::get<0>(result_);
+  }
+  const T& value() const& {
+    Check();
+    return std::get<0>(result_);
+  }
+  T&& value() && {
+    Check();
+    return std::get<0>(std::move(result_));
+  }
+
+  // Null if the operation succeeded.
+  std::exception_ptr error() const noexcept {
+    return has_value() ? nullptr : std::get<1>(result_);
+  }
+
+ private:
+  explicit Result(std::exception_ptr exception)
+      : result_(std::in_place_index<1>, std::move(exception)) {}
+
+  void Check() const {
+    if (!has_value()) {
+      std::rethrow_exception(std::get<1>(result_));
+    }
+  }
+
+  std::variant<T, std::exception_ptr> result_;
+};
+
+template <typename T>
+class Result<T&> {
+ public:
+  Result(T& value) : value_(std::addressof(value)) {}
+
+  static Result Failure(std::exception_ptr exception) {
+    return Result(std::move(exception));
+  }
+
+  bool has_value() const noexcept { return !exception_; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  T& value() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    return *value_;
+  }
+
+  std::exception_ptr error() const noexcept { return exception_; }
+
+ private:
+  explicit Result(std::exception_ptr exception)
+      : exception_(std::move(exception)) {}
+
+  T* value_ = nullptr;
+  std::exception_ptr exception_;
+};
+
+template <>
+class Result<void> {
+ public:
+  Result() noexcept = default;
+
+  static Result Failure(std::exception_ptr exception) {
+    Result result;
+    result.exception_ = std::move(exception);
+    return result;
+  }
+
+  bool has_value() const noexcept { return !exception_; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  void value() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+  std::exception_ptr error() const noexcept { return exception_; }
+
+ private:
+  std::exception_ptr exception_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_RESULT_H
@@ -1,12 +1,19 @@
 #include "coro/rpc/rpc_server.h"
 
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <iostream>
-#include <iterator>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string_view>
 
+#include "coro/interrupted_exception.h"
 #include "coro/promise.h"
 #include "coro/rpc/rpc_exception.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
 #include "coro/util/raii_utils.h"
 
 namespace coro::rpc {
@@ -27,159 +34,357 @@ U RoundUpPower2(U num, size_t bits) {
   return ((num + (static_cast<U>(1) << bits) - 1) >> bits) << bits;
 }
 
-TcpRequestDataProvider GetDecodedChunks(bool last_fragment, uint32_t length,
-                                        TcpRequestDataProvider provider) {
-  return [last_fragment, length, provider = std::move(provider)](
-             uint32_t byte_cnt) mutable -> Task<std::vector<uint8_t>> {
-    if (last_fragment && length == 0 && byte_cnt == UINT32_MAX) {
-      co_return std::vector<uint8_t>{};
-    }
-    std::vector<uint8_t> buffer;
-    if (byte_cnt != UINT32_MAX) {
-      buffer.reserve(byte_cnt);
-    }
-    while (buffer.size() < byte_cnt) {
-      if (length == 0) {
-        if (last_fragment) {
-          throw RpcException(RpcException::kMalformedRequest,
-                             "buffer underflow");
-        }
-        uint32_t encoded_length = ParseUInt32(co_await provider(4));
-        last_fragment = encoded_length & (1 << 31);
-        length = encoded_length & ~(1 << 31);
+Task<uint32_t> GetUInt32(TcpRequestDataProvider& provider) {
+  std::span<const uint8_t> data = co_await provider.Peek(4);
+  if (data.size() < 4) {
+    throw RpcException(RpcException::kMalformedRequest, "buffer underflow");
+  }
+  uint32_t value = ParseUInt32(data);
+  provider.Consume(4);
+  co_return value;
+}
+
+Task<> Skip(TcpRequestDataProvider& provider, uint32_t byte_cnt) {
+  while (byte_cnt > 0) {
+    std::span<const uint8_t> data = co_await provider.Peek();
+    if (data.empty()) {
+      throw RpcException(RpcException::kMalformedRequest, "buffer underflow");
+    }
+    auto size = static_cast<uint32_t>(std::min<size_t>(data.size(), byte_cnt));
+    provider.Consume(size);
+    byte_cnt -= size;
+  }
+}
+
+// Exposes the payload of a record marked RPC message, with fragment headers
+// stripped. Data is handed out in place, except for the rare peeks which
+// cross a fragment boundary and have to be gathered in `scratch_`.
+class DecodedChunks {
+ public:
+  DecodedChunks(bool last_fragment, uint32_t length,
+                TcpRequestDataProvider* provider)
+      : last_fragment_(last_fragment), length_(length), provider_(provider) {}
+
+  Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) {
+    if (scratch_.empty()) {
+      co_await ReadFragmentHeader();
+      if (length_ == 0) {
+        co_return std::span<const uint8_t>();
       }
-      uint32_t current_read = std::min(byte_cnt, length);
-      std::vector<uint8_t> chunk = co_await provider(current_read);
-      length -= current_read;
-      if (byte_cnt == UINT32_MAX) {
-        co_return chunk;
+      if (min_byte_cnt <= length_) {
+        std::span<const uint8_t> data = co_await provider_->Peek(min_byte_cnt);
+        co_return data.first(std::min<size_t>(data.size(), length_));
       }
-      std::copy(chunk.begin(), chunk.end(), std::back_inserter(buffer));
     }
-    co_return buffer;
-  };
-}
+    while (scratch_.size() < min_byte_cnt) {
+      co_await ReadFragmentHeader();
+      if (length_ == 0) {
+        throw RpcException(RpcException::kMalformedRequest,
+                           "buffer underflow");
+      }
+      std::span<const uint8_t> data = co_await provider_->Peek();
+      auto size = static_cast<uint32_t>(std::min<size_t>(
+          {data.size(), length_, min_byte_cnt - scratch_.size()}));
+      scratch_.insert(scratch_.end(), data.begin(), data.begin() + size);
+      provider_->Consume(size);
+      length_ -= size;
+    }
+    co_return scratch_;
+  }
 
-std::vector<uint8_t> GetChunkToSend(std::vector<uint8_t> data, bool last) {
+  void Consume(uint32_t byte_cnt) {
+    if (!scratch_.empty()) {
+      scratch_.erase(scratch_.begin(), scratch_.begin() + byte_cnt);
+    } else {
+      provider_->Consume(byte_cnt);
+      length_ -= byte_cnt;
+    }
+  }
+
+ private:
+  Task<> ReadFragmentHeader() {
+    while (length_ == 0 && !last_fragment_) {
+      uint32_t encoded_length = co_await GetUInt32(*provider_);
+      last_fragment_ = encoded_length & (1 << 31);
+      length_ = encoded_length & ~(1 << 31);
+    }
+  }
+
+  bool last_fragment_;
+  uint32_t length_;
+  TcpRequestDataProvider* provider_;
+  std::vector<uint8_t> scratch_;
+};
+
+// Returns the record mark of a fragment made of `prefix` followed by
+// `payload_size` bytes which are sent separately, so the payload itself is
+// never copied.
+std::vector<uint8_t> GetFragmentHeader(std::span<const uint8_t> prefix,
+                                       size_t payload_size, bool last) {
   std::vector<uint8_t> output;
-  output.reserve(4 + data.size());
-  XdrSerializer{&output}.Put((last ? 1u << 31 : 0) |
-                             static_cast<uint32_t>(data.size()));
-  std::copy(data.begin(), data.end(), std::back_inserter(output));
+  XdrSerializer serializer{&output};
+  serializer.Reserve(4 + prefix.size());
+  serializer.Put((last ? 1u << 31 : 0) |
+                 static_cast<uint32_t>(prefix.size() + payload_size));
+  output.insert(output.end(), prefix.begin(), prefix.end());
   return output;
 }
 
+// Call arguments read into memory ahead of the handler.
+class BufferedChunks {
+ public:
+  explicit BufferedChunks(std::vector<uint8_t> data) : data_(std::move(data)) {}
+
+  Task<std::span<const uint8_t>> Peek(uint32_t) {
+    co_return std::span<const uint8_t>(data_).subspan(offset_);
+  }
+
+  void Consume(uint32_t byte_cnt) { offset_ += byte_cnt; }
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t offset_ = 0;
+};
+
+// Reads the header of the next call; its arguments are then read from the
+// returned request's `body.data`, which borrows `provider`.
+Task<RpcRequest> ReadCall(TcpRequestDataProvider* provider) {
+  RpcRequest rpc_request{};
+  uint32_t encoded_length = co_await GetUInt32(*provider);
+  bool last_fragment = encoded_length & (1 << 31);
+  uint32_t length = encoded_length & ~(1 << 31);
+
+  rpc_request.xid = co_await GetUInt32(*provider);
+  uint32_t message_type = co_await GetUInt32(*provider);
+  if (message_type != 0) {
+    throw RpcException(RpcException::kMalformedRequest,
+                       "expected message_type = 0");
+  }
+
+  rpc_request.body.rpcvers = co_await GetUInt32(*provider);
+  if (rpc_request.body.rpcvers != 2) {
+    throw RpcException(RpcException::kMalformedRequest,
+                       "expected rpcvers = 2");
+  }
+  rpc_request.body.prog = co_await GetUInt32(*provider);
+  rpc_request.body.vers = co_await GetUInt32(*provider);
+  rpc_request.body.proc = co_await GetUInt32(*provider);
+  rpc_request.body.cred.flavor = co_await GetUInt32(*provider);
+  rpc_request.body.cred.body =
+      co_await GetVariableLengthOpaque(*provider, kMaxCredLength);
+  rpc_request.body.verf.flavor = co_await GetUInt32(*provider);
+  rpc_request.body.verf.body =
+      co_await GetVariableLengthOpaque(*provider, kMaxCredLength);
+  rpc_request.body.data = TcpRequestDataProvider(DecodedChunks(
+      last_fragment,
+      static_cast<uint32_t>(
+          length -
+          (4 * 10 + RoundUpPower2(rpc_request.body.cred.body.size(), 2) +
+           RoundUpPower2(rpc_request.body.verf.body.size(), 2))),
+      provider));
+  co_return rpc_request;
+}
+
+Task<std::vector<uint8_t>> ReadArguments(TcpRequestDataProvider& data,
+                                         uint32_t max_size) {
+  std::vector<uint8_t> arguments;
+  while (true) {
+    std::span<const uint8_t> chunk = co_await data.Peek();
+    if (chunk.empty()) {
+      co_return arguments;
+    }
+    if (arguments.size() + chunk.size() > max_size) {
+      throw RpcException(RpcException::kMalformedRequest,
+                         "call arguments too long");
+    }
+    arguments.insert(arguments.end(), chunk.begin(), chunk.end());
+    data.Consume(static_cast<uint32_t>(chunk.size()));
+  }
+}
+
+Generator<TcpResponseChunk> GetReplyChunks(uint32_t xid,
+                                           RpcResponse response) {
+  std::vector<uint8_t> data;
+  XdrSerializer serializer{&data};
+  serializer.Put(xid).Put(MessageType::kReply);
+  if (auto* accepted =
+          std::get_if<RpcResponseAcceptedBody>(&response.body.body)) {
+    serializer.Put(ReplyStat::kMsgAccepted);
+    serializer.Put(accepted->verf.flavor);
+    if (!accepted->verf.body.empty()) {
+      throw RpcException(RpcException::kAborted, "unimplemented");
+    }
+    serializer.Put(static_cast<uint32_t>(accepted->verf.body.size()));
+    serializer.Put(accepted->stat);
+
+    // Every payload chunk is sent as its own fragment. One chunk is held back
+    // to learn whether it's the last one; the reply header is sent in the
+    // record mark chunk of the first fragment.
+    std::optional<TcpResponseChunk> previous_chunk;
+    FOR_CO_AWAIT(TcpResponseChunk chunk, accepted->data) {
+      if (chunk.size() == 0) {
+        continue;
+      }
+      if (previous_chunk) {
+        co_yield GetFragmentHeader(data, previous_chunk->size(),
+                                   /*last=*/false);
+        co_yield std::move(*previous_chunk);
+        data.clear();
+      }
+      previous_chunk.emplace(std::move(chunk));
+    }
+    co_yield GetFragmentHeader(
+        data, previous_chunk ? previous_chunk->size() : 0,
+        /*last=*/true);
+    if (previous_chunk) {
+      co_yield std::move(*previous_chunk);
+    }
+  } else {
+    throw RpcException(RpcException::kAborted, "unimplemented");
+  }
+}
+
+// Calls of a connection which are being handled concurrently. Shared by the
+// connection's response generator, the task reading calls and the tasks
+// handling them, any of which may finish first, even after the server is gone;
+// hence the tasks reach the handler and the config only through it.
+struct PipelineState {
+  PipelineState(TcpRequestDataProvider provider,
+                std::shared_ptr<RpcHandler> rpc_handler,
+                const RpcServerConfig& config)
+      : provider(std::move(provider)),
+        rpc_handler(std::move(rpc_handler)),
+        config(config) {}
+
+  TcpRequestDataProvider provider;
+  std::shared_ptr<RpcHandler> rpc_handler;
+  RpcServerConfig config;
+  // Complete replies, in the order the handlers finished.
+  std::deque<std::vector<TcpResponseChunk>> replies;
+  // Calls read whose replies haven't been handed to the connection yet.
+  int pending_call_count = 0;
+  // Set once reading calls or handling one failed; the connection is closed
+  // once the replies queued before are sent.
+  std::exception_ptr exception;
+  Promise<void> reply_ready;
+  Promise<void> call_slot_released;
+  // Cancels the handlers once the connection is done.
+  stdx::stop_source stop_source;
+};
+
+Task<> Wait(Promise<void>& event, const stdx::stop_token& stop_token) {
+  if (stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  co_await event;
+  event = Promise<void>();
+}
+
+Task<> HandleBufferedCall(std::shared_ptr<PipelineState> state,
+                          RpcRequest rpc_request) {
+  try {
+    uint32_t xid = rpc_request.xid;
+    auto response = co_await (*state->rpc_handler)(
+        std::move(rpc_request), state->stop_source.get_token());
+    std::vector<TcpResponseChunk> reply;
+    FOR_CO_AWAIT(TcpResponseChunk chunk,
+                 GetReplyChunks(xid, std::move(response))) {
+      reply.push_back(std::move(chunk));
+    }
+    state->replies.push_back(std::move(reply));
+  } catch (...) {
+    if (!state->exception) {
+      state->exception = std::current_exception();
+    }
+  }
+  state->reply_ready.SetValue();
+}
+
+Task<> ReadCalls(std::shared_ptr<PipelineState> state) {
+  try {
+    while (true) {
+      while (state->pending_call_count >=
+             state->config.max_concurrent_calls_per_connection) {
+        co_await Wait(state->call_slot_released,
+                      state->stop_source.get_token());
+      }
+      RpcRequest rpc_request = co_await ReadCall(&state->provider);
+      std::vector<uint8_t> arguments = co_await ReadArguments(
+          rpc_request.body.data, state->config.max_buffered_call_size);
+      rpc_request.body.data =
+          TcpRequestDataProvider(BufferedChunks(std::move(arguments)));
+      state->pending_call_count++;
+      RunTask(HandleBufferedCall(state, std::move(rpc_request)));
+    }
+  } catch (...) {
+    state->exception = std::current_exception();
+    state->reply_ready.SetValue();
+  }
+}
+
 struct RpcHandlerT {
   Generator<TcpResponseChunk> operator()(
       coro::util::TcpRequestDataProvider provider,
       stdx::stop_token stop_token) {
-    RpcRequest rpc_request{};
-    uint32_t encoded_length = ParseUInt32(co_await provider(4));
-    bool last_fragment = encoded_length & (1 << 31);
-    uint32_t length = encoded_length & ~(1 << 31);
-
-    rpc_request.xid = ParseUInt32(co_await provider(4));
-    int32_t message_type = ParseInt32(co_await provider(4));
-    if (message_type != 0) {
-      throw RpcException(RpcException::kMalformedRequest,
-                         "expected message_type = 0");
+    if (config.max_concurrent_calls_per_connection > 1) {
+      return HandlePipelinedCalls(std::move(provider), std::move(stop_token));
+    } else {
+      return HandleCall(std::move(provider), std::move(stop_token));
     }
+  }
 
-    rpc_request.body.rpcvers = ParseUInt32(co_await provider(4));
-    if (rpc_request.body.rpcvers != 2) {
-      throw RpcException(RpcException::kMalformedRequest,
-                         "expected rpcvers = 2");
-    }
-    rpc_request.body.prog = ParseUInt32(co_await provider(4));
-    rpc_request.body.vers = ParseUInt32(co_await provider(4));
-    rpc_request.body.proc = ParseUInt32(co_await provider(4));
-    rpc_request.body.cred.flavor = ParseUInt32(co_await provider(4));
-    rpc_request.body.cred.body =
-        co_await GetVariableLengthOpaque(provider, kMaxCredLength);
-    rpc_request.body.verf.flavor = ParseUInt32(co_await provider(4));
-    rpc_request.body.verf.body =
-        co_await GetVariableLengthOpaque(provider, kMaxCredLength);
-    rpc_request.body.data = GetDecodedChunks(
-        last_fragment,
-        static_cast<uint32_t>(
-            length -
-            (4 * 10 + RoundUpPower2(rpc_request.body.cred.body.size(), 2) +
-             RoundUpPower2(rpc_request.body.verf.body.size(), 2))),
-        std::move(provider));
+  Generator<TcpResponseChunk> HandleCall(TcpRequestDataProvider provider,
+                                         stdx::stop_token stop_token) {
+    RpcRequest rpc_request = co_await ReadCall(&provider);
     uint32_t xid = rpc_request.xid;
     auto response =
-        co_await rpc_handler(std::move(rpc_request), std::move(stop_token));
-    std::vector<uint8_t> data;
-    XdrSerializer serializer{&data};
-    serializer.Put(xid).Put(MessageType::kReply);
-    if (auto* accepted =
-            std::get_if<RpcResponseAcceptedBody>(&response.body.body)) {
-      serializer.Put(ReplyStat::kMsgAccepted);
-      serializer.Put(accepted->verf.flavor);
-      if (!accepted->verf.body.empty()) {
-        throw RpcException(RpcException::kAborted, "unimplemented");
-      }
-      serializer.Put(static_cast<uint32_t>(accepted->verf.body.size()));
-      serializer.Put(accepted->stat);
-
-      bool header_sent = false;
-      std::vector<uint8_t> previous_chunk;
-      FOR_CO_AWAIT(TcpResponseChunk ctl, accepted->data) {
-        std::vector<uint8_t> chunk(ctl.chunk().begin(), ctl.chunk().end());
-        if (!header_sent) {
-          std::vector<uint8_t> tmp;
-          tmp.reserve(data.size() + chunk.size());
-          std::copy(data.begin(), data.end(), std::back_inserter(tmp));
-          std::copy(chunk.begin(), chunk.end(), std::back_inserter(tmp));
-          chunk = std::move(tmp);
-          header_sent = true;
-        }
-        if (!previous_chunk.empty()) {
-          co_yield GetChunkToSend(std::move(previous_chunk), /*last=*/false);
-        }
-        previous_chunk = std::move(chunk);
+        co_await (*rpc_handler)(std::move(rpc_request), std::move(stop_token));
+    FOR_CO_AWAIT(TcpResponseChunk chunk,
+                 GetReplyChunks(xid, std::move(response))) {
+      co_yield std::move(chunk);
+    }
+  }
+
+  // Serves all the calls of a connection. Calls are read as long as fewer
+  // than `max_concurrent_calls_per_connection` are pending and their replies
+  // are sent in completion order, which ONC RPC clients match by xid.
+  Generator<TcpResponseChunk> HandlePipelinedCalls(
+      TcpRequestDataProvider provider, stdx::stop_token stop_token) {
+    auto state = std::make_shared<PipelineState>(std::move(provider),
+                                                 rpc_handler, config);
+    stdx::stop_callback wake_waiters(state->stop_source.get_token(), [state] {
+      std::shared_ptr<PipelineState> s = state;
+      s->call_slot_released.SetException(InterruptedException());
+      s->reply_ready.SetException(InterruptedException());
+    });
+    stdx::stop_callback stop_calls(std::move(stop_token),
+                                   [&] { state->stop_source.request_stop(); });
+    auto cancel_guard =
+        AtScopeExit([&] { state->stop_source.request_stop(); });
+    RunTask(ReadCalls(state));
+    while (true) {
+      while (state->replies.empty() && !state->exception) {
+        co_await Wait(state->reply_ready, state->stop_source.get_token());
       }
-      if (!header_sent) {
-        previous_chunk = std::move(data);
+      if (state->replies.empty()) {
+        std::rethrow_exception(state->exception);
       }
-      if (!previous_chunk.empty()) {
-        co_yield GetChunkToSend(std::move(previous_chunk), /*last=*/true);
+      std::vector<TcpResponseChunk> reply = std::move(state->replies.front());
+      state->replies.pop_front();
+      for (TcpResponseChunk& chunk : reply) {
+        co_yield std::move(chunk);
       }
-    } else {
-      throw RpcException(RpcException::kAborted, "unimplemented");
+      state->pending_call_count--;
+      state->call_slot_released.SetValue();
     }
   }
 
-  RpcHandler rpc_handler;
+  std::shared_ptr<RpcHandler> rpc_handler;
+  RpcServerConfig config;
 };
 
 }  // namespace
 
-XdrSerializer& XdrSerializer::Put(uint32_t value) {
-  dest_->push_back((value >> 24) & 255);
-  dest_->push_back((value >> 16) & 255);
-  dest_->push_back((value >> 8) & 255);
-  dest_->push_back(value & 255);
-  return *this;
-}
-
-XdrSerializer& XdrSerializer::Put(uint64_t value) {
-  dest_->push_back((value >> 56) & 255);
-  dest_->push_back((value >> 48) & 255);
-  dest_->push_back((value >> 40) & 255);
-  dest_->push_back((value >> 32) & 255);
-  dest_->push_back((value >> 24) & 255);
-  dest_->push_back((value >> 16) & 255);
-  dest_->push_back((value >> 8) & 255);
-  dest_->push_back(value & 255);
-  return *this;
-}
-
-XdrSerializer& XdrSerializer::Put(bool value) {
-  Put(static_cast<uint32_t>(value));
-  return *this;
-}
-
 XdrSerializer& XdrSerializer::Put(std::span<const uint8_t> bytes) {
   Put(static_cast<uint32_t>(bytes.size()));
   PutFixedSize(bytes);
@@ -187,8 +392,8 @@ XdrSerializer& XdrSerializer::Put(std::span<const uint8_t> bytes) {
 }
 
 XdrSerializer& XdrSerializer::PutFixedSize(std::span<const uint8_t> bytes) {
-  std::copy(bytes.begin(), bytes.end(), std::back_inserter(*dest_));
-  dest_->resize(dest_->size() + RoundUpPower2(bytes.size(), 2) - bytes.size());
+  uint8_t* dest = Extend(RoundUpPower2(bytes.size(), 2));
+  std::memcpy(dest, bytes.data(), bytes.size());
   return *this;
 }
 
@@ -199,21 +404,50 @@ XdrSerializer& XdrSerializer::Put(std::string_view bytes) {
 
 Task<std::vector<uint8_t>> GetVariableLengthOpaque(
     coro::util::TcpRequestDataProvider& provider, uint32_t max_length) {
-  uint32_t length = ParseUInt32(co_await provider(4));
+  uint32_t length = co_await GetUInt32(provider);
   if (length > max_length) {
     throw RpcException(RpcException::kMalformedRequest,
                        "opaque length too long");
   }
-  auto result = co_await provider(length);
-  co_await provider(RoundUpPower2(length, 2) - length);
+  std::vector<uint8_t> result;
+  result.reserve(length);
+  while (result.size() < length) {
+    std::span<const uint8_t> data = co_await provider.Peek();
+    if (data.empty()) {
+      throw RpcException(RpcException::kMalformedRequest, "buffer underflow");
+    }
+    data = data.first(std::min<size_t>(data.size(), length - result.size()));
+    result.insert(result.end(), data.begin(), data.end());
+    provider.Consume(static_cast<uint32_t>(data.size()));
+  }
+  co_await Skip(provider, RoundUpPower2(length, 2) - length);
   co_return result;
 }
 
 coro::util::TcpServer CreateRpcServer(
     RpcHandler rpc_handler, const coro::util::EventLoop* event_loop,
-    const coro::util::TcpServer::Config& config) {
+    const coro::util::TcpServer::Config& config,
+    const RpcServerConfig& rpc_config) {
   return coro::util::TcpServer(
-      RpcHandlerT{.rpc_handler = std::move(rpc_handler)}, event_loop, config);
+      RpcHandlerT{
+          .rpc_handler = std::make_shared<RpcHandler>(std::move(rpc_handler)),
+          .config = rpc_config},
+      event_loop, config);
+}
+
+coro::util::MultiThreadedTcpServer CreateMultiThreadedRpcServer(
+    RpcHandlerFactory rpc_handler_factory,
+    const coro::util::EventLoop* event_loop,
+    const coro::util::MultiThreadedTcpServer::Config& config,
+    const RpcServerConfig& rpc_config) {
+  return coro::util::MultiThreadedTcpServer(
+      [rpc_handler_factory = std::move(rpc_handler_factory),
+       rpc_config](const coro::util::EventLoop* event_loop) mutable {
+        return RpcHandlerT{.rpc_handler = std::make_shared<RpcHandler>(
+                               rpc_handler_factory(event_loop)),
+                           .config = rpc_config};
+      },
+      event_loop, config);
 }
 
-}  // namespace coro::rpc
\ No newline at end of file
+}  // namespace coro::rpc
@@ -1,15 +1,25 @@
 #ifndef CORO_RPC_RPC_SERVER_H
 #define CORO_RPC_RPC_SERVER_H
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
 #include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "coro/promise.h"
 #include "coro/stdx/any_invocable.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/task.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/multi_threaded_tcp_server.h"
 #include "coro/util/tcp_server.h"
 
 namespace coro::rpc {
@@ -63,13 +73,118 @@ struct RpcResponse {
 using RpcHandler =
     stdx::any_invocable<Task<RpcResponse>(RpcRequest, stdx::stop_token)>;
 
+// Structs are serialized field by field, in the order given by a
+// `GetXdrFields(const T&)` function found by argument-dependent lookup, which
+// returns a tuple of pointers to the members, e.g.
+//
+//   constexpr auto GetXdrFields(const Time&) {
+//     return std::tuple(&Time::seconds, &Time::nseconds);
+//   }
+template <typename T>
+concept XdrStruct = requires(const T& value) { GetXdrFields(value); };
+
+namespace internal {
+
+template <typename>
+struct XdrMemberType;
+
+template <typename C, typename U>
+struct XdrMemberType<U C::*> {
+  using type = U;
+};
+
+template <typename>
+struct IsByteArray : std::false_type {};
+
+template <size_t N>
+struct IsByteArray<std::array<uint8_t, N>> : std::true_type {};
+
+template <typename T>
+constexpr size_t GetXdrFixedSize();
+
+template <typename... Fields>
+constexpr size_t GetXdrFieldsFixedSize(std::tuple<Fields...>*) {
+  constexpr size_t sizes[] = {
+      GetXdrFixedSize<typename XdrMemberType<Fields>::type>()..., 0};
+  size_t total = 0;
+  for (size_t i = 0; i < sizeof...(Fields); i++) {
+    if (sizes[i] == 0) {
+      return 0;
+    }
+    total += sizes[i];
+  }
+  return total;
+}
+
+// Encoded size of values of type `T` if it's the same for all of them, 0
+// otherwise.
+template <typename T>
+constexpr size_t GetXdrFixedSize() {
+  if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, uint32_t> ||
+                std::is_enum_v<T>) {
+    return 4;
+  } else if constexpr (std::is_same_v<T, uint64_t>) {
+    return 8;
+  } else if constexpr (IsByteArray<T>::value) {
+    return (std::tuple_size_v<T> + 3) / 4 * 4;
+  } else if constexpr (XdrStruct<T>) {
+    return GetXdrFieldsFixedSize(
+        static_cast<decltype(GetXdrFields(std::declval<const T&>()))*>(
+            nullptr));
+  } else {
+    return 0;
+  }
+}
+
+inline void StoreUInt32(uint8_t* dest, uint32_t value) {
+  dest[0] = static_cast<uint8_t>(value >> 24);
+  dest[1] = static_cast<uint8_t>(value >> 16);
+  dest[2] = static_cast<uint8_t>(value >> 8);
+  dest[3] = static_cast<uint8_t>(value);
+}
+
+// Writes a value of fixed encoded size at `dest` and advances it.
+template <typename T>
+void EncodeFixedSize(uint8_t*& dest, const T& value) {
+  if constexpr (std::is_same_v<T, uint64_t>) {
+    StoreUInt32(dest, static_cast<uint32_t>(value >> 32));
+    StoreUInt32(dest + 4, static_cast<uint32_t>(value));
+    dest += 8;
+  } else if constexpr (IsByteArray<T>::value) {
+    std::memcpy(dest, value.data(), value.size());
+    dest += GetXdrFixedSize<T>();
+  } else if constexpr (XdrStruct<T>) {
+    std::apply(
+        [&](auto... fields) { (EncodeFixedSize(dest, value.*fields), ...); },
+        GetXdrFields(value));
+  } else {
+    StoreUInt32(dest, static_cast<uint32_t>(value));
+    dest += 4;
+  }
+}
+
+}  // namespace internal
+
 class XdrSerializer {
  public:
   explicit XdrSerializer(std::vector<uint8_t>* dest) : dest_(dest) {}
 
-  XdrSerializer& Put(uint32_t value);
-  XdrSerializer& Put(uint64_t value);
-  XdrSerializer& Put(bool value);
+  // Makes room for `byte_count` more bytes without reallocating.
+  XdrSerializer& Reserve(size_t byte_count) {
+    dest_->reserve(dest_->size() + byte_count);
+    return *this;
+  }
+
+  XdrSerializer& Put(uint32_t value) {
+    internal::StoreUInt32(Extend(4), value);
+    return *this;
+  }
+  XdrSerializer& Put(uint64_t value) {
+    uint8_t* dest = Extend(8);
+    internal::EncodeFixedSize(dest, value);
+    return *this;
+  }
+  XdrSerializer& Put(bool value) { return Put(static_cast<uint32_t>(value)); }
   template <typename T>
     requires(std::is_enum_v<T>)
   XdrSerializer& Put(T value) {
@@ -85,11 +200,60 @@ class XdrSerializer {
     }
     return *this;
   }
+  // Fixed-length opaque data, without the length prefix which Put writes for
+  // byte sequences.
+  template <size_t N>
+  XdrSerializer& PutFixedOpaque(const std::array<uint8_t, N>& value) {
+    return PutFixedSize(value);
+  }
+  // Structs of fixed encoded size are written with a single resize of the
+  // destination. Byte array fields are fixed-length opaque data.
+  template <XdrStruct T>
+  XdrSerializer& Put(const T& value) {
+    if constexpr (constexpr size_t size = internal::GetXdrFixedSize<T>();
+                  size != 0) {
+      uint8_t* dest = Extend(size);
+      internal::EncodeFixedSize(dest, value);
+    } else {
+      std::apply([&](auto... fields) { (PutField(value.*fields), ...); },
+                 GetXdrFields(value));
+    }
+    return *this;
+  }
+  // Puts all `values` in order, resizing the destination once if they're all
+  // of fixed encoded size. Byte arrays are fixed-length opaque data, like
+  // struct fields.
+  template <typename... Ts>
+  XdrSerializer& PutAll(const Ts&... values) {
+    if constexpr (((internal::GetXdrFixedSize<Ts>() != 0) && ...)) {
+      uint8_t* dest = Extend((internal::GetXdrFixedSize<Ts>() + ... + 0));
+      (internal::EncodeFixedSize(dest, values), ...);
+    } else {
+      (PutField(values), ...);
+    }
+    return *this;
+  }
   XdrSerializer& PutFixedSize(std::span<const uint8_t> value);
   XdrSerializer& Put(std::span<const uint8_t> bytes);
   XdrSerializer& Put(std::string_view bytes);
 
  private:
+  template <typename T>
+  void PutField(const T& value) {
+    if constexpr (internal::IsByteArray<T>::value) {
+      PutFixedOpaque(value);
+    } else {
+      Put(value);
+    }
+  }
+
+  // Grows the destination by `byte_count` bytes and returns a pointer to them.
+  uint8_t* Extend(size_t byte_count) {
+    size_t size = dest_->size();
+    dest_->resize(size + byte_count);
+    return dest_->data() + size;
+  }
+
   std::vector<uint8_t>* dest_;
 };
 
@@ -111,9 +275,29 @@ inline uint64_t ParseUInt64(std::span<const uint8_t> message) {
 Task<std::vector<uint8_t>> GetVariableLengthOpaque(
     coro::util::TcpRequestDataProvider& data, uint32_t max_length);
 
+struct RpcServerConfig {
+  // Calls of a single connection handled at the same time. With more than
+  // one, the arguments of a call are read into memory before its handler runs
+  // and its reply is buffered until complete; replies are then sent in
+  // completion order.
+  int max_concurrent_calls_per_connection = 1;
+  // Upper bound on the arguments of a call read ahead of its handler.
+  uint32_t max_buffered_call_size = 4 * 1024 * 1024;
+};
+
 coro::util::TcpServer CreateRpcServer(
     RpcHandler rpc_handler, const coro::util::EventLoop* event_loop,
-    const coro::util::TcpServer::Config& config);
+    const coro::util::TcpServer::Config& config,
+    const RpcServerConfig& rpc_config = {});
+
+using RpcHandlerFactory =
+    stdx::any_invocable<RpcHandler(const coro::util::EventLoop*)>;
+
+coro::util::MultiThreadedTcpServer CreateMultiThreadedRpcServer(
+    RpcHandlerFactory rpc_handler_factory,
+    const coro::util::EventLoop* event_loop,
+    const coro::util::MultiThreadedTcpServer::Config& config,
+    const RpcServerConfig& rpc_config = {});
 
 }  // namespace coro::rpc
 
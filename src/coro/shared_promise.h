@@ -9,6 +9,7 @@
 #include "coro/interrupted_exception.h"
 #include "coro/promise.h"
 #include "coro/stdx/stop_callback.h"
+#include "coro/task.h"
 #include "coro/util/raii_utils.h"
 
 namespace coro {
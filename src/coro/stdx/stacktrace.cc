@@ -1,5 +1,6 @@
 #include "coro/stdx/stacktrace.h"
 
+#include <atomic>
 #include <sstream>
 
 #ifdef HAVE_BOOST_STACKTRACE
@@ -11,6 +12,28 @@
 
 namespace coro {
 
+namespace {
+
+std::atomic<uint32_t> stacktrace_sampling_period = 1;
+
+#ifdef HAVE_BOOST_STACKTRACE
+bool ShouldCaptureStacktrace() {
+  thread_local uint32_t skipped_count = 0;
+  uint32_t period =
+      stacktrace_sampling_period.load(std::memory_order_relaxed);
+  if (period == 0) {
+    return false;
+  }
+  if (++skipped_count < period) {
+    return false;
+  }
+  skipped_count = 0;
+  return true;
+}
+#endif
+
+}  // namespace
+
 namespace stdx {
 
 struct stacktrace::Impl {
@@ -19,10 +42,12 @@ struct stacktrace::Impl {
 #endif
 };
 
+stacktrace::stacktrace() noexcept = default;
+
 stacktrace::stacktrace(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
 
 stacktrace::stacktrace(const stacktrace& other)
-    : impl_(std::make_unique<Impl>(*other.impl_)) {}
+    : impl_(other.impl_ ? std::make_unique<Impl>(*other.impl_) : nullptr) {}
 
 stacktrace::stacktrace(stacktrace&& other) noexcept
     : impl_(std::move(other.impl_)) {}
@@ -30,7 +55,7 @@ stacktrace::stacktrace(stacktrace&& other) noexcept
 stacktrace::~stacktrace() = default;
 
 stacktrace& stacktrace::operator=(const stacktrace& other) {
-  impl_ = std::make_unique<Impl>(*other.impl_);
+  impl_ = other.impl_ ? std::make_unique<Impl>(*other.impl_) : nullptr;
   return *this;
 }
 
@@ -41,7 +66,7 @@ stacktrace& stacktrace::operator=(stacktrace&& other) noexcept {
 
 bool stacktrace::empty() const noexcept {
 #ifdef HAVE_BOOST_STACKTRACE
-  return impl_->stacktrace.empty();
+  return !impl_ || impl_->stacktrace.empty();
 #else
   return true;
 #endif
@@ -49,10 +74,13 @@ bool stacktrace::empty() const noexcept {
 
 stacktrace stacktrace::current() noexcept {
 #ifdef HAVE_BOOST_STACKTRACE
+  if (!ShouldCaptureStacktrace()) {
+    return stacktrace();
+  }
   return stacktrace(std::make_unique<Impl>(
       Impl{.stacktrace = boost::stacktrace::stacktrace()}));
 #else
-  return stacktrace(std::make_unique<Impl>());
+  return stacktrace();
 #endif
 }
 
@@ -84,6 +112,9 @@ std::string GetHtmlStacktrace(const stdx::stacktrace& d) {
 
 std::string ToString(const stdx::stacktrace& d) {
 #ifdef HAVE_BOOST_STACKTRACE
+  if (d.empty()) {
+    return "";
+  }
   return boost::stacktrace::to_string(GetImpl(&d)->stacktrace);
 #else
   (void)d;
@@ -91,4 +122,8 @@ std::string ToString(const stdx::stacktrace& d) {
 #endif
 }
 
-}  // namespace coro
\ No newline at end of file
+void SetStacktraceSamplingPeriod(uint32_t period) noexcept {
+  stacktrace_sampling_period.store(period, std::memory_order_relaxed);
+}
+
+}  // namespace coro
\ No newline at end of file
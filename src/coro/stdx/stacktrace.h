@@ -1,6 +1,7 @@
 #ifndef CORO_STDX_STACKTRACE_H
 #define CORO_STDX_STACKTRACE_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -8,6 +9,8 @@ namespace coro::stdx {
 
 class stacktrace {
  public:
+  // Empty stacktrace; doesn't allocate.
+  stacktrace() noexcept;
   stacktrace(const stacktrace&);
   stacktrace(stacktrace&&) noexcept;
 
@@ -18,6 +21,9 @@ class stacktrace {
 
   bool empty() const noexcept;
 
+  // Captures the calling thread's stack, subject to
+  // SetStacktraceSamplingPeriod. Frames are symbolized only once the
+  // stacktrace is converted to a string.
   static stacktrace current() noexcept;
 
  private:
@@ -38,6 +44,12 @@ namespace coro {
 std::string GetHtmlStacktrace(const stdx::stacktrace&);
 std::string ToString(const stdx::stacktrace&);
 
+// Makes stdx::stacktrace::current capture only every `period`-th stacktrace
+// on each thread and return empty ones otherwise, which bounds the cost of
+// exceptions thrown in bulk. 0 disables capturing and 1, the default,
+// captures every stacktrace. Has no effect in builds without stacktraces.
+void SetStacktraceSamplingPeriod(uint32_t period) noexcept;
+
 }  // namespace coro
 
-#endif  // CORO_STDX_STACKTRACE_H
\ No newline at end of file
+#endif  // CORO_STDX_STACKTRACE_H
\ No newline at end of file
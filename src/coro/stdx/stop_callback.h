@@ -15,17 +15,14 @@ class stop_callback : private internal::base_stop_callback {
       if (stop_token_.stop_requested()) {
         callable_();
       } else {
-        stop_token_.state_->stop_callback.insert(this);
+        stop_token_.state_->add(this);
       }
     }
   }
 
   ~stop_callback() {
     if (stop_token_.stop_possible()) {
-      auto it = stop_token_.state_->stop_callback.find(this);
-      if (it != std::end(stop_token_.state_->stop_callback)) {
-        stop_token_.state_->stop_callback.erase(it);
-      }
+      stop_token_.state_->remove(this);
     }
   }
 
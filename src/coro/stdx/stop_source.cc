@@ -4,6 +4,44 @@
 
 namespace coro::stdx {
 
+namespace internal {
+
+void stop_source_state::add(base_stop_callback* callback) noexcept {
+  callback->prev_ = nullptr;
+  callback->next_ = head;
+  if (head) {
+    head->prev_ = callback;
+  }
+  head = callback;
+}
+
+void stop_source_state::remove(base_stop_callback* callback) noexcept {
+  if (callback->prev_) {
+    callback->prev_->next_ = callback->next_;
+  } else if (head == callback) {
+    head = callback->next_;
+  } else {
+    // Not registered, or already invoked.
+    return;
+  }
+  if (callback->next_) {
+    callback->next_->prev_ = callback->prev_;
+  }
+  callback->prev_ = callback->next_ = nullptr;
+}
+
+void stop_source_state::request_stop() noexcept {
+  stopped = true;
+  // A callback may destroy itself or any other callback, so each one is
+  // unlinked before it runs.
+  while (base_stop_callback* callback = head) {
+    remove(callback);
+    (*callback)();
+  }
+}
+
+}  // namespace internal
+
 stop_source::stop_source()
     : state_(std::make_shared<internal::stop_source_state>()) {}
 
@@ -11,15 +49,9 @@ bool stop_source::request_stop() noexcept {
   if (!state_) {
     return false;
   }
-  state_->stopped = true;
-
+  // Callbacks may destroy this stop_source.
   auto state = state_;
-  while (!state->stop_callback.empty()) {
-    auto* cb = *state->stop_callback.begin();
-    state->stop_callback.erase(state->stop_callback.begin());
-    (*cb)();
-  }
-
+  state->request_stop();
   return true;
 }
 
@@ -27,4 +59,16 @@ stop_token stop_source::get_token() const noexcept {
   return stop_token{state_};
 }
 
+bool inplace_stop_source::request_stop() noexcept {
+  state_.request_stop();
+  return true;
+}
+
+stop_token inplace_stop_source::get_token() const noexcept {
+  // Aliases the state without sharing ownership, so that copying the token
+  // doesn't touch a reference count.
+  return stop_token{std::shared_ptr<internal::stop_source_state>(
+      std::shared_ptr<void>(), &state_)};
+}
+
 }  // namespace coro::stdx
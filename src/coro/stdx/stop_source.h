@@ -1,8 +1,6 @@
 #ifndef CORO_HTTP_STOP_SOURCE_H
 #define CORO_HTTP_STOP_SOURCE_H
 
-#include <unordered_set>
-
 #include "coro/stdx/stop_token.h"
 
 namespace coro::stdx {
@@ -12,11 +10,24 @@ namespace internal {
 class base_stop_callback {
  public:
   virtual void operator()() = 0;
+
+ private:
+  friend struct stop_source_state;
+
+  // Links of the intrusive list of callbacks registered with a state.
+  base_stop_callback* prev_ = nullptr;
+  base_stop_callback* next_ = nullptr;
 };
 
+// Callbacks are kept in an intrusive doubly-linked list, so that registering
+// and deregistering one takes constant time and never allocates.
 struct stop_source_state {
+  void add(base_stop_callback* callback) noexcept;
+  void remove(base_stop_callback* callback) noexcept;
+  void request_stop() noexcept;
+
   bool stopped = false;
-  std::unordered_set<base_stop_callback*> stop_callback;
+  base_stop_callback* head = nullptr;
 };
 
 }  // namespace internal
@@ -32,6 +43,27 @@ class stop_source {
   std::shared_ptr<internal::stop_source_state> state_;
 };
 
+// Stop source which keeps its state inline instead of allocating it. Its
+// tokens don't own the state, so neither they nor callbacks registered with
+// them may outlive the source; meant for sources whose scope encloses every
+// use of their tokens.
+class inplace_stop_source {
+ public:
+  inplace_stop_source() = default;
+
+  inplace_stop_source(const inplace_stop_source&) = delete;
+  inplace_stop_source(inplace_stop_source&&) = delete;
+
+  inplace_stop_source& operator=(const inplace_stop_source&) = delete;
+  inplace_stop_source& operator=(inplace_stop_source&&) = delete;
+
+  bool request_stop() noexcept;
+  [[nodiscard]] stop_token get_token() const noexcept;
+
+ private:
+  mutable internal::stop_source_state state_;
+};
+
 }  // namespace coro::stdx
 
 #endif  // CORO_HTTP_STOP_SOURCE_H
@@ -18,6 +18,7 @@ class stop_token {
 
  private:
   friend class stop_source;
+  friend class inplace_stop_source;
   template <typename C>
   friend class stop_callback;
 
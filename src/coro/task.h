@@ -6,8 +6,15 @@
 #include <utility>
 
 #include "coro/interrupted_exception.h"
+#include "coro/result.h"
 #include "coro/stdx/concepts.h"
 #include "coro/stdx/coroutine.h"
+#include "coro/util/frame_allocator.h"
+
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+#include "coro/stdx/source_location.h"
+#include "coro/util/coroutine_trace.h"
+#endif
 
 namespace coro {
 
@@ -18,11 +25,51 @@ class Task;
 
 class TaskPromiseBase {
  public:
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  explicit TaskPromiseBase(stdx::source_location location) noexcept
+      : location_(location) {
+    util::detail::TraceCoroutine(util::detail::CoroutineTraceEventType::kCreate,
+                                 this, location_);
+  }
+
+  ~TaskPromiseBase() {
+    util::detail::TraceCoroutine(
+        util::detail::CoroutineTraceEventType::kDestroy, this, location_);
+  }
+#else
   TaskPromiseBase() noexcept {}
+#endif
+
+  static void* operator new(size_t size) {
+    return util::AllocateFrame(size);
+  }
+  static void operator delete(void* ptr, size_t size) noexcept {
+    util::DeallocateFrame(ptr, size);
+  }
+
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  auto initial_suspend() noexcept {
+    return util::detail::TracedInitialSuspend(this, location_);
+  }
 
+  auto final_suspend() noexcept {
+    util::detail::TraceCoroutine(
+        util::detail::CoroutineTraceEventType::kComplete, this, location_);
+    return FinalAwaitable{};
+  }
+
+  template <typename Awaitable>
+  auto await_transform(
+      Awaitable&& awaitable,
+      stdx::source_location site = stdx::source_location::current()) {
+    return util::detail::TracedAwaitable<Awaitable>(
+        this, location_, site, std::forward<Awaitable>(awaitable));
+  }
+#else
   auto initial_suspend() noexcept { return stdx::suspend_always{}; }
 
   auto final_suspend() noexcept { return FinalAwaitable{}; }
+#endif
 
   void set_continuation(stdx::coroutine_handle<> continuation) noexcept {
     continuation_ = continuation;
@@ -42,12 +89,27 @@ class TaskPromiseBase {
   };
 
   stdx::coroutine_handle<> continuation_;
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  stdx::source_location location_;
+#endif
 };
 
+// With tracing, the default argument is evaluated where the compiler
+// constructs the promise, so it's the location of the coroutine itself.
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+#define CORO_HTTP_TASK_PROMISE_CONSTRUCTOR(Promise)                        \
+  explicit Promise(                                                        \
+      stdx::source_location location = stdx::source_location::current()) \
+      noexcept                                                             \
+      : TaskPromiseBase(location)
+#else
+#define CORO_HTTP_TASK_PROMISE_CONSTRUCTOR(Promise) Promise() noexcept
+#endif
+
 template <typename T>
 class TaskPromise final : public TaskPromiseBase {
  public:
-  TaskPromise() noexcept {}
+  CORO_HTTP_TASK_PROMISE_CONSTRUCTOR(TaskPromise) {}
 
   ~TaskPromise() {
     switch (result_type_) {
@@ -93,6 +155,13 @@ class TaskPromise final : public TaskPromiseBase {
     return std::move(value_);
   }
 
+  Result<T> take_result() {
+    if (result_type_ == ResultType::kException) {
+      return Result<T>::Failure(exception_);
+    }
+    return Result<T>(std::move(value_));
+  }
+
  private:
   enum class ResultType {
     kEmpty,
@@ -109,7 +178,7 @@ class TaskPromise final : public TaskPromiseBase {
 template <>
 class TaskPromise<void> : public TaskPromiseBase {
  public:
-  TaskPromise() noexcept = default;
+  CORO_HTTP_TASK_PROMISE_CONSTRUCTOR(TaskPromise) {}
 
   Task<void> get_return_object() noexcept;
 
@@ -123,6 +192,10 @@ class TaskPromise<void> : public TaskPromiseBase {
     }
   }
 
+  Result<void> take_result() {
+    return exception_ ? Result<void>::Failure(exception_) : Result<void>();
+  }
+
  private:
   std::exception_ptr exception_;
 };
@@ -130,7 +203,7 @@ class TaskPromise<void> : public TaskPromiseBase {
 template <typename T>
 class TaskPromise<T&> : public TaskPromiseBase {
  public:
-  TaskPromise() noexcept = default;
+  CORO_HTTP_TASK_PROMISE_CONSTRUCTOR(TaskPromise) {}
 
   Task<T&> get_return_object() noexcept;
 
@@ -145,11 +218,17 @@ class TaskPromise<T&> : public TaskPromiseBase {
     return *value_;
   }
 
+  Result<T&> take_result() {
+    return exception_ ? Result<T&>::Failure(exception_) : Result<T&>(*value_);
+  }
+
  private:
   T* value_ = nullptr;
   std::exception_ptr exception_;
 };
 
+#undef CORO_HTTP_TASK_PROMISE_CONSTRUCTOR
+
 template <typename T = void>
 class [[nodiscard]] Task {
  public:
@@ -208,6 +287,21 @@ class [[nodiscard]] Task {
     return Awaitable{coroutine_};
   }
 
+  // Awaits the task like co_await does, but returns its outcome as a Result
+  // instead of rethrowing the exception the task failed with. The task's
+  // value is moved into the Result.
+  auto AsResult() const noexcept {
+    class Awaitable : public AwaitableBase {
+     public:
+      using AwaitableBase::AwaitableBase;
+
+      Result<T> await_resume() {
+        return this->coroutine_.promise().take_result();
+      }
+    };
+    return Awaitable{coroutine_};
+  }
+
  private:
   class AwaitableBase {
    public:
@@ -294,6 +388,13 @@ struct RunTaskT {
     stdx::suspend_never final_suspend() noexcept { return {}; }
     void return_void() {}
     void unhandled_exception() { std::terminate(); }
+
+    static void* operator new(size_t size) {
+      return util::AllocateFrame(size);
+    }
+    static void operator delete(void* ptr, size_t size) noexcept {
+      util::DeallocateFrame(ptr, size);
+    }
   };
 };
 
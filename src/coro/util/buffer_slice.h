@@ -0,0 +1,60 @@
+#ifndef CORO_UTIL_BUFFER_SLICE_H
+#define CORO_UTIL_BUFFER_SLICE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace coro::util {
+
+// Immutable view of bytes kept alive by a shared owner. Copying a slice or
+// taking a subslice of it only bumps a reference count, so the same bytes can
+// be queued on many connections or kept in a cache without being copied. It's
+// the element type of HTTP bodies; a std::string converts to a slice owning
+// it without copying its bytes.
+class BufferSlice {
+ public:
+  BufferSlice() = default;
+
+  BufferSlice(std::shared_ptr<const void> owner, std::span<const uint8_t> data)
+      : owner_(std::move(owner)), data_(data) {}
+
+  BufferSlice(std::string data) {
+    if (data.empty()) {
+      return;
+    }
+    auto owner = std::make_shared<const std::string>(std::move(data));
+    data_ = std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(owner->data()), owner->size());
+    owner_ = std::move(owner);
+  }
+
+  // `offset` must not exceed size().
+  BufferSlice Subslice(size_t offset,
+                       size_t size = std::string_view::npos) const {
+    std::span<const uint8_t> data = data_.subspan(offset);
+    return BufferSlice(owner_, data.first(std::min(size, data.size())));
+  }
+
+  std::span<const uint8_t> span() const { return data_; }
+  const uint8_t* data() const { return data_.data(); }
+  size_t size() const { return data_.size(); }
+  bool empty() const { return data_.empty(); }
+
+  operator std::string_view() const {
+    return std::string_view(reinterpret_cast<const char*>(data_.data()),
+                            data_.size());
+  }
+
+ private:
+  std::shared_ptr<const void> owner_;
+  std::span<const uint8_t> data_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_BUFFER_SLICE_H
@@ -0,0 +1,261 @@
+#include "coro/util/coroutine_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "coro/exception.h"
+
+namespace coro::util {
+
+namespace detail {
+
+std::atomic<bool> coroutine_trace_enabled = false;
+
+}  // namespace detail
+
+namespace {
+
+using ::coro::util::detail::CoroutineTraceEventType;
+
+constexpr size_t kEventsPerThread = 1 << 16;
+
+struct Event {
+  int64_t timestamp_ns;
+  const void* coroutine;
+  const char* name;
+  const char* file;
+  uint32_t line;
+  CoroutineTraceEventType type;
+};
+
+// Written only by the thread which owns it, without locking; the exporter
+// detects slots overwritten while it was copying them through `size`.
+struct ThreadBuffer {
+  explicit ThreadBuffer(int thread_index)
+      : events(std::make_unique<Event[]>(kEventsPerThread)),
+        thread_index(thread_index) {}
+
+  std::unique_ptr<Event[]> events;
+  std::atomic<uint64_t> size = 0;
+  int thread_index;
+};
+
+// Buffers outlive their threads, so that their events can be exported after
+// the threads exit. Never destroyed, since threads may record events during
+// static destruction.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::atomic<int64_t> start_ns = 0;
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry;
+  return *registry;
+}
+
+ThreadBuffer* GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = [] {
+    Registry& registry = GetRegistry();
+    std::unique_lock lock(registry.mutex);
+    registry.buffers.push_back(std::make_unique<ThreadBuffer>(
+        static_cast<int>(registry.buffers.size()) + 1));
+    return registry.buffers.back().get();
+  }();
+  return buffer;
+}
+
+int64_t GetTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::vector<Event> GetEvents(const ThreadBuffer& buffer, int64_t start_ns) {
+  uint64_t end = buffer.size.load(std::memory_order_acquire);
+  uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+  std::vector<Event> events;
+  events.reserve(end - begin);
+  for (uint64_t i = begin; i < end; i++) {
+    events.push_back(buffer.events[i % kEventsPerThread]);
+  }
+  uint64_t current_end = buffer.size.load(std::memory_order_acquire);
+  if (current_end - begin > kEventsPerThread) {
+    events.erase(events.begin(),
+                 events.begin() + static_cast<ptrdiff_t>(std::min<uint64_t>(
+                                      current_end - begin - kEventsPerThread,
+                                      events.size())));
+  }
+  std::erase_if(events,
+                [&](const Event& e) { return e.timestamp_ns < start_ns; });
+  return events;
+}
+
+void WriteString(std::ostream& output, std::string_view str) {
+  output << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      output << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      output << escaped;
+    } else {
+      output << c;
+    }
+  }
+  output << '"';
+}
+
+void WriteLocation(std::ostream& output, const Event& event) {
+  char line[16];
+  snprintf(line, sizeof(line), ":%u", event.line);
+  WriteString(output, std::string(event.file) + line);
+}
+
+class ChromeTraceWriter {
+ public:
+  explicit ChromeTraceWriter(std::ostream& output) : output_(output) {
+    output_ << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  }
+
+  ~ChromeTraceWriter() { output_ << "]}\n"; }
+
+  void WriteThreadName(int thread_index) {
+    Begin("M", thread_index, 0);
+    output_ << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread "
+            << thread_index << "\"}}";
+  }
+
+  // Slices on a thread's track have to nest, so ends whose beginning got
+  // overwritten or predates the trace are dropped.
+  void WriteThreadEvents(int thread_index, const std::vector<Event>& events) {
+    int depth = 0;
+    for (const Event& event : events) {
+      switch (event.type) {
+        case CoroutineTraceEventType::kCreate:
+        case CoroutineTraceEventType::kDestroy:
+          Begin(event.type == CoroutineTraceEventType::kCreate ? "b" : "e",
+                thread_index, event.timestamp_ns);
+          output_ << ",\"cat\":\"coroutine\",\"id\":\"" << event.coroutine
+                  << "\",\"name\":";
+          WriteString(output_, event.name);
+          output_ << ",\"args\":{\"location\":";
+          WriteLocation(output_, event);
+          output_ << "}}";
+          break;
+        case CoroutineTraceEventType::kResume:
+        case CoroutineTraceEventType::kCallbackBegin:
+          depth++;
+          Begin("B", thread_index, event.timestamp_ns);
+          output_ << ",\"name\":";
+          WriteString(output_, event.name);
+          if (event.coroutine) {
+            output_ << ",\"args\":{\"coroutine\":\"" << event.coroutine
+                    << "\",\"resumed_at\":";
+            WriteLocation(output_, event);
+            output_ << "}";
+          }
+          output_ << "}";
+          break;
+        case CoroutineTraceEventType::kSuspend:
+        case CoroutineTraceEventType::kComplete:
+        case CoroutineTraceEventType::kCallbackEnd:
+          if (depth == 0) {
+            break;
+          }
+          depth--;
+          Begin("E", thread_index, event.timestamp_ns);
+          if (event.type == CoroutineTraceEventType::kSuspend) {
+            output_ << ",\"args\":{\"suspended_at\":";
+            WriteLocation(output_, event);
+            output_ << "}";
+          }
+          output_ << "}";
+          break;
+      }
+    }
+  }
+
+ private:
+  void Begin(const char* phase, int thread_index, int64_t timestamp_ns) {
+    if (!first_) {
+      output_ << ',';
+    }
+    first_ = false;
+    char timestamp[32];
+    snprintf(timestamp, sizeof(timestamp), "%lld.%03lld",
+             static_cast<long long>(timestamp_ns / 1000),
+             static_cast<long long>(timestamp_ns % 1000));
+    output_ << "{\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << thread_index
+            << ",\"ts\":" << timestamp;
+  }
+
+  std::ostream& output_;
+  bool first_ = true;
+};
+
+}  // namespace
+
+namespace detail {
+
+void RecordCoroutineTraceEvent(CoroutineTraceEventType type,
+                               const void* coroutine, const char* name,
+                               const char* file, uint32_t line) noexcept {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  uint64_t index = buffer->size.load(std::memory_order_relaxed);
+  buffer->events[index % kEventsPerThread] = {.timestamp_ns = GetTimeNs(),
+                                              .coroutine = coroutine,
+                                              .name = name,
+                                              .file = file,
+                                              .line = line,
+                                              .type = type};
+  buffer->size.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+bool IsCoroutineTraceSupported() {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void StartCoroutineTrace() {
+  if (!IsCoroutineTraceSupported()) {
+    throw InvalidArgument("coro-http was built without coroutine tracing.");
+  }
+  GetRegistry().start_ns.store(GetTimeNs(), std::memory_order_relaxed);
+  detail::coroutine_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void StopCoroutineTrace() {
+  detail::coroutine_trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+void WriteChromeTrace(std::ostream& output) {
+  Registry& registry = GetRegistry();
+  int64_t start_ns = registry.start_ns.load(std::memory_order_relaxed);
+  std::vector<ThreadBuffer*> buffers;
+  {
+    std::unique_lock lock(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+  ChromeTraceWriter writer(output);
+  for (ThreadBuffer* buffer : buffers) {
+    writer.WriteThreadName(buffer->thread_index);
+    writer.WriteThreadEvents(buffer->thread_index,
+                             GetEvents(*buffer, start_ns));
+  }
+}
+
+}  // namespace coro::util
@@ -0,0 +1,174 @@
+#ifndef CORO_UTIL_COROUTINE_TRACE_H
+#define CORO_UTIL_COROUTINE_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/source_location.h"
+
+namespace coro::util {
+
+// Whether the library was built with WITH_COROUTINE_TRACE. Without it Task and
+// Generator carry no tracing hooks at all and starting a trace throws
+// InvalidArgument.
+bool IsCoroutineTraceSupported();
+
+// Starts recording, on every thread, when Task and Generator coroutines are
+// created, resumed, suspended, completed and destroyed, along with the
+// callbacks run by EventLoops. Each thread records into its own ring buffer,
+// which keeps the last 65536 events. Events recorded before the last call to
+// StartCoroutineTrace aren't exported.
+void StartCoroutineTrace();
+void StopCoroutineTrace();
+
+// Writes the recorded events in the Chrome trace event JSON format, which
+// chrome://tracing and ui.perfetto.dev open. A coroutine shows up as an async
+// span covering its lifetime, plus a slice on a thread's track for every
+// stretch it runs there without suspending. Meant to be called once tracing
+// is stopped; events being overwritten meanwhile are dropped.
+void WriteChromeTrace(std::ostream& output);
+
+namespace detail {
+
+enum class CoroutineTraceEventType : uint8_t {
+  kCreate,
+  kResume,
+  kSuspend,
+  kComplete,
+  kDestroy,
+  kCallbackBegin,
+  kCallbackEnd,
+};
+
+extern std::atomic<bool> coroutine_trace_enabled;
+
+void RecordCoroutineTraceEvent(CoroutineTraceEventType type,
+                               const void* coroutine, const char* name,
+                               const char* file, uint32_t line) noexcept;
+
+// `function` is where the coroutine was created, `site` where the event
+// happened, e.g. the co_await which suspended it.
+inline void TraceCoroutine(CoroutineTraceEventType type, const void* coroutine,
+                           const stdx::source_location& function,
+                           const stdx::source_location& site) noexcept {
+  if (coroutine_trace_enabled.load(std::memory_order_relaxed)) {
+    RecordCoroutineTraceEvent(type, coroutine, function.function_name(),
+                              site.file_name(), site.line());
+  }
+}
+
+inline void TraceCoroutine(CoroutineTraceEventType type, const void* coroutine,
+                           const stdx::source_location& function) noexcept {
+  TraceCoroutine(type, coroutine, function, function);
+}
+
+// Records a slice named `name` on the calling thread for the scope's lifetime.
+class TracedCallbackScope {
+ public:
+  explicit TracedCallbackScope(
+      const char* name,
+      stdx::source_location location = stdx::source_location::current())
+      : name_(name),
+        location_(location),
+        enabled_(coroutine_trace_enabled.load(std::memory_order_relaxed)) {
+    if (enabled_) {
+      RecordCoroutineTraceEvent(CoroutineTraceEventType::kCallbackBegin,
+                                nullptr, name_, location_.file_name(),
+                                location_.line());
+    }
+  }
+
+  ~TracedCallbackScope() {
+    if (enabled_) {
+      RecordCoroutineTraceEvent(CoroutineTraceEventType::kCallbackEnd, nullptr,
+                                name_, location_.file_name(),
+                                location_.line());
+    }
+  }
+
+  TracedCallbackScope(const TracedCallbackScope&) = delete;
+  TracedCallbackScope& operator=(const TracedCallbackScope&) = delete;
+
+ private:
+  const char* name_;
+  stdx::source_location location_;
+  bool enabled_;
+};
+
+// Initial suspend point of a traced coroutine; records its first resume.
+class TracedInitialSuspend {
+ public:
+  TracedInitialSuspend(const void* coroutine,
+                       const stdx::source_location& function) noexcept
+      : coroutine_(coroutine), function_(function) {}
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(stdx::coroutine_handle<>) const noexcept {}
+  void await_resume() const noexcept {
+    TraceCoroutine(CoroutineTraceEventType::kResume, coroutine_, function_);
+  }
+
+ private:
+  const void* coroutine_;
+  const stdx::source_location& function_;
+};
+
+template <typename Awaitable>
+decltype(auto) GetAwaiter(Awaitable&& awaitable) {
+  if constexpr (requires {
+                  std::forward<Awaitable>(awaitable).operator co_await();
+                }) {
+    return std::forward<Awaitable>(awaitable).operator co_await();
+  } else {
+    return std::forward<Awaitable>(awaitable);
+  }
+}
+
+// What await_transform of a traced coroutine turns `co_await awaitable` into.
+// The awaitable is a temporary of the co_await's full expression or an
+// lvalue, so it outlives the suspension either way and is held by reference,
+// unless it provides operator co_await, whose result is held by value.
+template <typename Awaitable>
+class TracedAwaitable {
+ public:
+  TracedAwaitable(const void* coroutine, const stdx::source_location& function,
+                  const stdx::source_location& site, Awaitable&& awaitable)
+      : coroutine_(coroutine),
+        function_(function),
+        site_(site),
+        awaiter_(GetAwaiter(std::forward<Awaitable>(awaitable))) {}
+
+  bool await_ready() { return awaiter_.await_ready(); }
+
+  template <typename Promise>
+  decltype(auto) await_suspend(stdx::coroutine_handle<Promise> handle) {
+    // The coroutine may be resumed, even on another thread, before the
+    // awaiter's await_suspend returns.
+    TraceCoroutine(CoroutineTraceEventType::kSuspend, coroutine_, function_,
+                   site_);
+    return awaiter_.await_suspend(handle);
+  }
+
+  decltype(auto) await_resume() {
+    TraceCoroutine(CoroutineTraceEventType::kResume, coroutine_, function_,
+                   site_);
+    return awaiter_.await_resume();
+  }
+
+ private:
+  using Awaiter = decltype(GetAwaiter(std::declval<Awaitable>()));
+
+  const void* coroutine_;
+  const stdx::source_location& function_;
+  stdx::source_location site_;
+  Awaiter awaiter_;
+};
+
+}  // namespace detail
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_COROUTINE_TRACE_H
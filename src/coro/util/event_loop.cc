@@ -3,8 +3,20 @@
 #include <event2/event.h>
 #include <event2/thread.h>
 
+#include <algorithm>
 #include <utility>
 
+#include "coro/exception.h"
+#include "coro/util/raii_utils.h"
+
+#ifdef CORO_HTTP_HAVE_IO_URING
+#include "coro/util/io_uring.h"
+#endif
+
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+#include "coro/util/coroutine_trace.h"
+#endif
+
 namespace coro::util {
 
 namespace {
@@ -19,6 +31,28 @@ event *ToEvent(T *d) {
   return reinterpret_cast<struct event *>(d);
 }
 
+int64_t GetTimeUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Ticks of the timer wheel are milliseconds of the steady clock.
+uint64_t GetTimeMs() { return static_cast<uint64_t>(GetTimeUs() / 1000); }
+
+template <typename T>
+void UpdateMaximum(std::atomic<T> &maximum, T value) {
+  T current = maximum.load(std::memory_order_relaxed);
+  while (value > current &&
+         !maximum.compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+// Set by EnterLoop for CallbackScope.
+thread_local const EventLoop *running_event_loop = nullptr;
+thread_local int callback_scope_depth = 0;
+
 struct EventConfigDeleter {
   void operator()(event_config *config) const { event_config_free(config); }
 };
@@ -33,9 +67,28 @@ void EventLoop::EventDeleter::operator()(Event *e) const {
   event_free(reinterpret_cast<struct event *>(e));
 }
 
+void EventLoop::IoUringDeleter::operator()(
+    [[maybe_unused]] IoUring *io_uring) const {
+#ifdef CORO_HTTP_HAVE_IO_URING
+  delete io_uring;
+#endif
+}
+
+EventLoop::CallbackScope::CallbackScope() noexcept
+    : event_loop_(callback_scope_depth++ == 0 ? running_event_loop : nullptr),
+      start_us_(event_loop_ ? GetTimeUs() : 0) {}
+
+EventLoop::CallbackScope::~CallbackScope() {
+  callback_scope_depth--;
+  if (event_loop_) {
+    UpdateMaximum(event_loop_->max_callback_duration_us_,
+                  GetTimeUs() - start_us_);
+    event_loop_->callback_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 bool EventLoop::WaitTask::await_ready() {
-  return interrupted_ ||
-         !event_pending(ToEvent(event_.get()), EV_TIMEOUT, nullptr);
+  return interrupted_ || !timer_.armed();
 }
 
 void EventLoop::WaitTask::await_suspend(stdx::coroutine_handle<void> handle) {
@@ -48,57 +101,190 @@ void EventLoop::WaitTask::await_resume() {
   }
 }
 
-EventLoop::WaitTask::WaitTask(EventBase *event_loop, int msec,
+EventLoop::WaitTask::WaitTask(const EventLoop *event_loop, int msec,
                               stdx::stop_token stop_token)
-    : stop_token_(std::move(stop_token)),
+    : event_loop_(event_loop),
+      stop_token_(std::move(stop_token)),
       stop_callback_(stop_token_, OnCancel{this}) {
   if (!interrupted_) {
-    timeval tv = {.tv_sec = msec / 1000, .tv_usec = msec % 1000 * 1000};
-    event_.reset(reinterpret_cast<Event *>(event_new(
-        ToEventBase(event_loop), -1, EV_TIMEOUT,
-        [](evutil_socket_t, short, void *data) {
-          auto *task = reinterpret_cast<WaitTask *>(data);
-          if (task->handle_) {
-            std::exchange(task->handle_, nullptr).resume();
-          }
-        },
-        this)));
-    event_add(ToEvent(event_.get()), &tv);
+    event_loop_->ArmTimer(&timer_, msec, OnExpired, this);
+    timer_active_ = true;
+    event_loop_->active_timer_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+EventLoop::WaitTask::~WaitTask() {
+  event_loop_->CancelTimer(&timer_);
+  Finish();
+}
+
+void EventLoop::WaitTask::OnExpired(void *data) {
+  auto *task = reinterpret_cast<WaitTask *>(data);
+  const EventLoop *event_loop = task->event_loop_;
+  task->Finish();
+  if (task->handle_) {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+    detail::TracedCallbackScope trace_scope("EventLoop::Wait");
+#endif
+    int64_t start = GetTimeUs();
+    std::exchange(task->handle_, nullptr).resume();
+    UpdateMaximum(event_loop->max_callback_duration_us_, GetTimeUs() - start);
+    event_loop->callback_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void EventLoop::WaitTask::Finish() {
+  if (timer_active_) {
+    timer_active_ = false;
+    event_loop_->active_timer_count_.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
 EventLoop::WaitTask EventLoop::Wait(int msec,
                                     stdx::stop_token stop_token) const {
-  return WaitTask(event_loop_.get(), msec, std::move(stop_token));
+  return WaitTask(this, msec, std::move(stop_token));
 }
 
 void EventLoop::WaitTask::OnCancel::operator()() const {
   task->interrupted_ = true;
-  if (task->event_) {
-    event_del(ToEvent(task->event_.get()));
-  }
+  task->event_loop_->CancelTimer(&task->timer_);
+  task->Finish();
   if (task->handle_) {
     std::exchange(task->handle_, nullptr).resume();
   }
 }
 
+void EventLoop::ArmTimer(TimerWheel::Timer *timer, int msec,
+                         void (*on_expired)(void *), void *data) const {
+  int64_t now_us = GetTimeUs();
+  if (timer_wheel_.size() == 0) {
+    // Catches up with the time the wheel was idle for, so that the new timer
+    // doesn't land on a needlessly coarse level.
+    timer_wheel_.Advance(static_cast<uint64_t>(now_us / 1000));
+  }
+  // Rounded up, so that the wait never ends before `msec` have passed.
+  uint64_t deadline = static_cast<uint64_t>(
+      (now_us + int64_t{std::max(msec, 0)} * 1000 + 999) / 1000);
+  timer_wheel_.Arm(timer, deadline, on_expired, data);
+  std::optional<uint64_t> next_tick = timer_wheel_.GetNextTick();
+  if (!timer_event_tick_ || *next_tick < *timer_event_tick_) {
+    ScheduleTimerEvent();
+  }
+}
+
+void EventLoop::CancelTimer(TimerWheel::Timer *timer) const {
+  if (!timer->armed()) {
+    return;
+  }
+  timer_wheel_.Cancel(timer);
+  if (timer_wheel_.size() == 0) {
+    ScheduleTimerEvent();
+  }
+}
+
+void EventLoop::OnTimerEvent() const {
+  timer_event_tick_ = std::nullopt;
+  timer_wheel_.Advance(GetTimeMs());
+  if (!timer_event_tick_) {
+    ScheduleTimerEvent();
+  }
+}
+
+void EventLoop::ScheduleTimerEvent() const {
+  std::optional<uint64_t> next_tick = timer_wheel_.GetNextTick();
+  if (!next_tick) {
+    if (timer_event_tick_) {
+      event_del(ToEvent(timer_event_.get()));
+      timer_event_tick_ = std::nullopt;
+    }
+    return;
+  }
+  int64_t delay_us =
+      std::max<int64_t>(static_cast<int64_t>(*next_tick) * 1000 - GetTimeUs(),
+                        0);
+  timeval tv = {.tv_sec = static_cast<decltype(tv.tv_sec)>(delay_us / 1000000),
+                .tv_usec = static_cast<decltype(tv.tv_usec)>(delay_us %
+                                                             1000000)};
+  event_add(ToEvent(timer_event_.get()), &tv);
+  timer_event_tick_ = next_tick;
+}
+
+struct EventLoop::QueuedFunction {
+  stdx::any_invocable<void() &&> function;
+  QueuedFunction *next;
+};
+
 void EventLoop::RunOnce(stdx::any_invocable<void() &&> f) const {
-  using F = stdx::any_invocable<void() &&>;
+  auto *node = new QueuedFunction{.function = std::move(f),
+                                  .next = queued_functions_.load()};
+  UpdateMaximum(
+      max_queued_function_count_,
+      queued_function_count_.fetch_add(1, std::memory_order_relaxed) + 1);
+  while (!queued_functions_.compare_exchange_weak(node->next, node,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+  }
+  if (node->next == nullptr) {
+    // Only the push onto an empty stack has to wake the event loop up.
+    wakeup_time_us_.store(GetTimeUs(), std::memory_order_relaxed);
+    event_active(ToEvent(wakeup_event_.get()), EV_READ, 0);
+  }
+}
 
-  auto *data = new F(std::move(f));
-  if (event_base_once(
-          ToEventBase(event_loop_.get()), -1, EV_TIMEOUT,
-          [](evutil_socket_t, short, void *d) {
-            std::unique_ptr<F> data(static_cast<F *>(d));
-            std::move (*data)();
-          },
-          data, nullptr) != 0) {
-    delete data;
-    throw RuntimeError("can't run on event loop");
+void EventLoop::RunQueuedFunctions() const {
+  int64_t start = GetTimeUs();
+  UpdateMaximum(max_loop_lag_us_,
+                start - wakeup_time_us_.load(std::memory_order_relaxed));
+  QueuedFunction *stack =
+      queued_functions_.exchange(nullptr, std::memory_order_acquire);
+  QueuedFunction *queue = nullptr;
+  while (stack) {
+    QueuedFunction *next = stack->next;
+    stack->next = queue;
+    queue = stack;
+    stack = next;
   }
+  while (queue) {
+    std::unique_ptr<QueuedFunction> node(std::exchange(queue, queue->next));
+    queued_function_count_.fetch_sub(1, std::memory_order_relaxed);
+    {
+#ifdef CORO_HTTP_HAVE_COROUTINE_TRACE
+      detail::TracedCallbackScope trace_scope("EventLoop::RunOnEventLoop");
+#endif
+      std::move(node->function)();
+    }
+    int64_t end = GetTimeUs();
+    UpdateMaximum(max_callback_duration_us_, end - start);
+    callback_count_.fetch_add(1, std::memory_order_relaxed);
+    start = end;
+  }
+}
+
+auto EventLoop::GetMetrics() const -> Metrics {
+  return {.max_loop_lag = std::chrono::microseconds(
+              max_loop_lag_us_.load(std::memory_order_relaxed)),
+          .max_callback_duration = std::chrono::microseconds(
+              max_callback_duration_us_.load(std::memory_order_relaxed)),
+          .callback_count = callback_count_.load(std::memory_order_relaxed),
+          .queued_function_count =
+              queued_function_count_.load(std::memory_order_relaxed),
+          .max_queued_function_count =
+              max_queued_function_count_.load(std::memory_order_relaxed),
+          .active_timer_count =
+              active_timer_count_.load(std::memory_order_relaxed)};
 }
 
-EventLoop::EventLoop()
+void EventLoop::ResetMetrics() const {
+  max_loop_lag_us_.store(0, std::memory_order_relaxed);
+  max_callback_duration_us_.store(0, std::memory_order_relaxed);
+  max_queued_function_count_.store(
+      queued_function_count_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+}
+
+EventLoop::EventLoop() : EventLoop(Config{}) {}
+
+EventLoop::EventLoop(const Config &config)
     : event_loop_([] {
 #ifdef _WIN32
         WORD version_requested = MAKEWORD(2, 2);
@@ -133,20 +319,65 @@ EventLoop::EventLoop()
           throw RuntimeError("event_base_new error");
         }
         return reinterpret_cast<EventBase *>(event_base);
-      }()) {
+      }()),
+      timer_wheel_(GetTimeMs()) {
+  // Never added, only activated by RunOnce, so that it doesn't keep the loop
+  // from exiting when nothing is queued.
+  wakeup_event_.reset(reinterpret_cast<Event *>(event_new(
+      ToEventBase(event_loop_.get()), -1, 0,
+      [](evutil_socket_t, short, void *d) {
+        static_cast<const EventLoop *>(d)->RunQueuedFunctions();
+      },
+      this)));
+  if (!wakeup_event_) {
+    throw RuntimeError("event_new error");
+  }
+  timer_event_.reset(reinterpret_cast<Event *>(event_new(
+      ToEventBase(event_loop_.get()), -1, EV_TIMEOUT,
+      [](evutil_socket_t, short, void *d) {
+        static_cast<const EventLoop *>(d)->OnTimerEvent();
+      },
+      this)));
+  if (!timer_event_) {
+    throw RuntimeError("event_new error");
+  }
+  if (config.io_backend == IoBackend::kIoUring) {
+#ifdef CORO_HTTP_HAVE_IO_URING
+    io_uring_.reset(new IoUring(ToEventBase(event_loop_.get())));
+#else
+    throw InvalidArgument("coro-http was built without io_uring support.");
+#endif
+  }
+}
+
+bool EventLoop::IsIoUringSupported() {
+#ifdef CORO_HTTP_HAVE_IO_URING
+  return true;
+#else
+  return false;
+#endif
 }
 
-#ifdef _WIN32
 EventLoop::~EventLoop() noexcept {
+  QueuedFunction *queued_functions = queued_functions_.exchange(nullptr);
+  while (queued_functions) {
+    delete std::exchange(queued_functions, queued_functions->next);
+  }
+  io_uring_.reset();
+  wakeup_event_.reset();
+  timer_event_.reset();
+#ifdef _WIN32
   if (WSACleanup() != 0) {
     std::terminate();
   }
-}
-#else
-EventLoop::~EventLoop() noexcept = default;
 #endif
+}
 
 void EventLoop::EnterLoop(EventLoopType type) {
+  const EventLoop *previous_event_loop =
+      std::exchange(running_event_loop, this);
+  auto guard = AtScopeExit(
+      [previous_event_loop] { running_event_loop = previous_event_loop; });
   if (event_base_loop(ToEventBase(event_loop_.get()), [&] {
         switch (type) {
           case EventLoopType::NoExitOnEmpty:
@@ -1,8 +1,12 @@
 #ifndef CORO_HTTP_WAIT_TASK_H
 #define CORO_HTTP_WAIT_TASK_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <optional>
 #include <stdexcept>
 
 #include "coro/interrupted_exception.h"
@@ -10,6 +14,7 @@
 #include "coro/stdx/stop_callback.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/task.h"
+#include "coro/util/timer_wheel.h"
 
 namespace coro::util {
 
@@ -18,18 +23,78 @@ enum class EventLoopType {
   NoExitOnEmpty,
 };
 
+// How TcpServers on an EventLoop do their socket I/O.
+enum class IoBackend {
+  // Libevent bufferevents: readiness notifications, then a read or write
+  // syscall for every operation.
+  kLibevent,
+  // io_uring on Linux: batched submissions, multishot accepts, receives into
+  // provided buffers and registered files. TLS servers keep using libevent.
+  kIoUring,
+};
+
+class IoUring;
+
 class EventLoop {
  public:
   class WaitTask;
 
+  struct Config {
+    // Timers, queued functions and everything else but TcpServer sockets go
+    // through libevent regardless.
+    IoBackend io_backend = IoBackend::kLibevent;
+  };
+
+  struct Metrics {
+    // Longest time between waking the loop up with a queued function and the
+    // loop starting to run it.
+    std::chrono::microseconds max_loop_lag;
+    // Longest run of a queued function, of a continuation of Wait or of a
+    // libevent callback in a CallbackScope. Callbacks of other libevent
+    // events registered on the loop aren't measured.
+    std::chrono::microseconds max_callback_duration;
+    uint64_t callback_count;
+    size_t queued_function_count;
+    size_t max_queued_function_count;
+    size_t active_timer_count;
+  };
+
+  // Counts the libevent callback it's created in, e.g. a socket callback of
+  // TcpServer or CurlHttp, in the metrics of the loop which EnterLoop runs on
+  // the calling thread. Scopes nested in another one aren't counted
+  // separately.
+  class CallbackScope {
+   public:
+    CallbackScope() noexcept;
+    ~CallbackScope();
+
+    CallbackScope(const CallbackScope&) = delete;
+    CallbackScope& operator=(const CallbackScope&) = delete;
+
+   private:
+    const EventLoop* event_loop_;
+    int64_t start_us_;
+  };
+
   EventLoop();
+  // Throws InvalidArgument if the library was built without io_uring support
+  // and RuntimeError if the kernel doesn't support it.
+  explicit EventLoop(const Config& config);
   ~EventLoop() noexcept;
 
+  // Whether the library was built with io_uring support.
+  static bool IsIoUringSupported();
+
   EventLoop(const EventLoop&) = delete;
   EventLoop(EventLoop&&) = delete;
   EventLoop& operator=(const EventLoop&) = delete;
   EventLoop& operator=(EventLoop&&) = delete;
 
+  // Resumes the awaiting coroutine after at least `msec` milliseconds, or
+  // throws InterruptedException once `stop_token` is stopped. All waits of a
+  // loop share a timer wheel driven by a single libevent timer, so that
+  // arming and cancelling one is cheap regardless of how many are pending.
+  // Has to be called on the event loop's thread.
   WaitTask Wait(int msec, stdx::stop_token = stdx::stop_token()) const;
 
   template <typename F>
@@ -89,6 +154,11 @@ class EventLoop {
     return std::move(result).get_future().get();
   }
 
+  // Safe to call from any thread. Maximums cover the time since the last
+  // ResetMetrics.
+  Metrics GetMetrics() const;
+  void ResetMetrics() const;
+
   void EnterLoop(EventLoopType = EventLoopType::ExitOnEmpty);
 
   void ExitLoop();
@@ -96,6 +166,7 @@ class EventLoop {
  private:
   struct EventBase;
   struct Event;
+  struct QueuedFunction;
 
   struct EventBaseDeleter {
     void operator()(EventBase* event_base) const;
@@ -105,18 +176,53 @@ class EventLoop {
     void operator()(Event*) const;
   };
 
+  struct IoUringDeleter {
+    void operator()(IoUring*) const;
+  };
+
   friend EventBase* GetEventLoop(const EventLoop& e) {
     return e.event_loop_.get();
   }
 
+  // Null unless the loop uses IoBackend::kIoUring.
+  friend IoUring* GetIoUring(const EventLoop& e) { return e.io_uring_.get(); }
+
+  // Queues a function to run on the event loop; safe to call from any thread.
+  // Functions queued while the loop hasn't picked up the previous ones yet
+  // share a single wakeup.
   void RunOnce(stdx::any_invocable<void() &&>) const;
+  void RunQueuedFunctions() const;
+
+  void ArmTimer(TimerWheel::Timer* timer, int msec, void (*on_expired)(void*),
+                void* data) const;
+  void CancelTimer(TimerWheel::Timer* timer) const;
+  void OnTimerEvent() const;
+  // Sets the libevent timer to the wheel's next tick, or removes it if no
+  // timers are armed, so that it doesn't keep the loop from exiting.
+  void ScheduleTimerEvent() const;
 
   std::unique_ptr<EventBase, EventBaseDeleter> event_loop_;
+  std::unique_ptr<Event, EventDeleter> wakeup_event_;
+  std::unique_ptr<Event, EventDeleter> timer_event_;
+  std::unique_ptr<IoUring, IoUringDeleter> io_uring_;
+  mutable TimerWheel timer_wheel_;
+  // Tick the timer event is set to, if it's pending.
+  mutable std::optional<uint64_t> timer_event_tick_;
+  // Lock-free stack of queued functions, most recently queued first.
+  mutable std::atomic<QueuedFunction*> queued_functions_ = nullptr;
+  mutable std::atomic<int64_t> wakeup_time_us_ = 0;
+  mutable std::atomic<int64_t> max_loop_lag_us_ = 0;
+  mutable std::atomic<int64_t> max_callback_duration_us_ = 0;
+  mutable std::atomic<uint64_t> callback_count_ = 0;
+  mutable std::atomic<size_t> queued_function_count_ = 0;
+  mutable std::atomic<size_t> max_queued_function_count_ = 0;
+  mutable std::atomic<size_t> active_timer_count_ = 0;
 };
 
 class EventLoop::WaitTask {
  public:
-  WaitTask(EventBase* event_loop, int msec, stdx::stop_token);
+  WaitTask(const EventLoop* event_loop, int msec, stdx::stop_token);
+  ~WaitTask();
 
   WaitTask(const WaitTask&) = delete;
   WaitTask(WaitTask&&) = delete;
@@ -134,10 +240,15 @@ class EventLoop::WaitTask {
     WaitTask* task;
   };
 
+  static void OnExpired(void* data);
+  void Finish();
+
+  const EventLoop* event_loop_;
   stdx::coroutine_handle<void> handle_;
-  std::unique_ptr<Event, EventDeleter> event_;
+  TimerWheel::Timer timer_;
   stdx::stop_token stop_token_;
   bool interrupted_ = false;
+  bool timer_active_ = false;
   stdx::stop_callback<OnCancel> stop_callback_;
 };
 
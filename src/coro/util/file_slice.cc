@@ -0,0 +1,50 @@
+#include "coro/util/file_slice.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "coro/exception.h"
+
+namespace coro::util {
+
+namespace {
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+struct FileDescriptor {
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  ~FileDescriptor() { close(fd); }
+
+  int fd;
+};
+
+}  // namespace
+
+FileSlice FileSlice::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw RuntimeError("can't open " + path + ": " + strerror(errno));
+  }
+  auto owner = std::make_shared<const FileDescriptor>(fd);
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    throw RuntimeError("can't stat " + path + ": " + strerror(errno));
+  }
+  return FileSlice(std::move(owner), fd, /*offset=*/0,
+                   static_cast<uint64_t>(status.st_size));
+}
+
+}  // namespace coro::util
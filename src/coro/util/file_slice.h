@@ -0,0 +1,47 @@
+#ifndef CORO_UTIL_FILE_SLICE_H
+#define CORO_UTIL_FILE_SLICE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace coro::util {
+
+// Byte range of an open file kept alive by a shared owner. TcpServer sends it
+// straight from the file, with sendfile where the platform supports it and
+// from a read-only memory mapping otherwise, so its bytes never pass through
+// user-space buffers.
+class FileSlice {
+ public:
+  // Opens `path` for reading; the slice covers the whole file. Throws
+  // RuntimeError if the file can't be opened.
+  static FileSlice Open(const std::string& path);
+
+  // `owner` keeps `fd` open for as long as any copy of the slice exists.
+  FileSlice(std::shared_ptr<const void> owner, int fd, uint64_t offset,
+            uint64_t size)
+      : owner_(std::move(owner)), fd_(fd), offset_(offset), size_(size) {}
+
+  // `offset` must not exceed size().
+  FileSlice Subslice(uint64_t offset, uint64_t size = UINT64_MAX) const {
+    return FileSlice(owner_, fd_, offset_ + offset,
+                     std::min(size, size_ - offset));
+  }
+
+  int fd() const { return fd_; }
+  uint64_t offset() const { return offset_; }
+  uint64_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  std::shared_ptr<const void> owner_;
+  int fd_;
+  uint64_t offset_;
+  uint64_t size_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_FILE_SLICE_H
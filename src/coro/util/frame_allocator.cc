@@ -0,0 +1,165 @@
+#include "coro/util/frame_allocator.h"
+
+#include <bit>
+#include <cstdint>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define CORO_HTTP_RECYCLE_FRAMES 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CORO_HTTP_RECYCLE_FRAMES 0
+#endif
+#endif
+
+#ifndef CORO_HTTP_RECYCLE_FRAMES
+#define CORO_HTTP_RECYCLE_FRAMES 1
+#endif
+
+namespace coro::util {
+
+namespace {
+
+// Each frame is preceded by the allocator which created it; nullptr stands for
+// the default one. Keeps the frame aligned as operator new would.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+constexpr int kMinSizeClassShift = 6;
+constexpr int kSizeClassCount = 7;
+constexpr int kMaxCachedFramesPerClass = 64;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+int GetSizeClass(size_t size) {
+  if (size <= (size_t(1) << kMinSizeClassShift)) {
+    return 0;
+  }
+  return std::bit_width(size - 1) - kMinSizeClassShift;
+}
+
+size_t GetSizeClassBytes(int size_class) {
+  return size_t(1) << (size_class + kMinSizeClassShift);
+}
+
+// Frames freed on a thread, kept for reuse by frames of the same size class.
+struct FrameCache {
+  ~FrameCache();
+
+  FreeBlock* free_lists[kSizeClassCount] = {};
+  int free_counts[kSizeClassCount] = {};
+};
+
+thread_local FrameAllocator* current_allocator = nullptr;
+thread_local bool frame_cache_destroyed = false;
+thread_local FrameCache frame_cache;
+
+FrameCache::~FrameCache() {
+  for (FreeBlock* block : free_lists) {
+    while (block) {
+      FreeBlock* next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+  frame_cache_destroyed = true;
+}
+
+void* AllocateDefault(size_t size) {
+  int size_class = GetSizeClass(size);
+  if (!CORO_HTTP_RECYCLE_FRAMES || size_class >= kSizeClassCount) {
+    return ::operator new(size);
+  }
+  if (frame_cache_destroyed) {
+    return ::operator new(GetSizeClassBytes(size_class));
+  }
+  FrameCache& cache = frame_cache;
+  if (FreeBlock* block = cache.free_lists[size_class]) {
+    cache.free_lists[size_class] = block->next;
+    cache.free_counts[size_class]--;
+    return block;
+  }
+  return ::operator new(GetSizeClassBytes(size_class));
+}
+
+void DeallocateDefault(void* ptr, size_t size) noexcept {
+  int size_class = GetSizeClass(size);
+  if (!CORO_HTTP_RECYCLE_FRAMES || size_class >= kSizeClassCount ||
+      frame_cache_destroyed) {
+    ::operator delete(ptr);
+    return;
+  }
+  FrameCache& cache = frame_cache;
+  if (cache.free_counts[size_class] >= kMaxCachedFramesPerClass) {
+    ::operator delete(ptr);
+    return;
+  }
+  cache.free_lists[size_class] =
+      ::new (ptr) FreeBlock{.next = cache.free_lists[size_class]};
+  cache.free_counts[size_class]++;
+}
+
+}  // namespace
+
+FrameAllocator* SetFrameAllocator(FrameAllocator* allocator) noexcept {
+  FrameAllocator* previous = current_allocator;
+  current_allocator = allocator;
+  return previous;
+}
+
+FrameAllocator* GetFrameAllocator() noexcept { return current_allocator; }
+
+void* AllocateFrame(size_t size) {
+  FrameAllocator* allocator = current_allocator;
+  size += kHeaderSize;
+  auto* data = static_cast<std::byte*>(allocator ? allocator->Allocate(size)
+                                                 : AllocateDefault(size));
+  ::new (data) FrameAllocator*(allocator);
+  return data + kHeaderSize;
+}
+
+void DeallocateFrame(void* ptr, size_t size) noexcept {
+  std::byte* data = static_cast<std::byte*>(ptr) - kHeaderSize;
+  FrameAllocator* allocator =
+      *std::launder(reinterpret_cast<FrameAllocator**>(data));
+  size += kHeaderSize;
+  if (allocator) {
+    allocator->Deallocate(data, size);
+  } else {
+    DeallocateDefault(data, size);
+  }
+}
+
+void* FrameArena::Allocate(size_t size) {
+  int size_class = GetSizeClass(size);
+  if (size_class < kSizeClassCount) {
+    if (FreeBlock* block = free_lists_[size_class]) {
+      free_lists_[size_class] = block->next;
+      return block;
+    }
+    size = GetSizeClassBytes(size_class);
+  }
+  allocated_bytes_ += size;
+  if (size > chunk_size_) {
+    return chunks_.emplace_back(new std::byte[size]).get();
+  }
+  if (remaining_ < size) {
+    current_ = chunks_.emplace_back(new std::byte[chunk_size_]).get();
+    remaining_ = chunk_size_;
+  }
+  std::byte* data = current_;
+  current_ += size;
+  remaining_ -= size;
+  return data;
+}
+
+void FrameArena::Deallocate(void* ptr, size_t size) noexcept {
+  int size_class = GetSizeClass(size);
+  if (size_class < kSizeClassCount) {
+    free_lists_[size_class] =
+        ::new (ptr) FreeBlock{.next = free_lists_[size_class]};
+  }
+}
+
+}  // namespace coro::util
@@ -0,0 +1,82 @@
+#ifndef CORO_UTIL_FRAME_ALLOCATOR_H
+#define CORO_UTIL_FRAME_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace coro::util {
+
+// Source of memory for coroutine frames of Task, Generator and RunTask.
+class FrameAllocator {
+ public:
+  virtual ~FrameAllocator() = default;
+
+  virtual void* Allocate(size_t size) = 0;
+  virtual void Deallocate(void* ptr, size_t size) noexcept = 0;
+};
+
+// Sets the allocator used for frames created on the calling thread and returns
+// the previous one. nullptr selects the default allocator, which recycles
+// freed frames through per-thread size-class free lists. Frames are always
+// returned to the allocator which created them, regardless of the thread or of
+// the allocator installed at the time they are destroyed.
+FrameAllocator* SetFrameAllocator(FrameAllocator*) noexcept;
+FrameAllocator* GetFrameAllocator() noexcept;
+
+void* AllocateFrame(size_t size);
+void DeallocateFrame(void* ptr, size_t size) noexcept;
+
+// Hands out frames from large chunks and releases all of them at once on
+// destruction; frames freed earlier are reused for frames of the same size
+// class. Every frame allocated from the arena must be destroyed before the
+// arena. Not thread-safe.
+class FrameArena : public FrameAllocator {
+ public:
+  // Installs the arena for the calling thread until destroyed. Since frames
+  // are allocated when a coroutine is called, a scope should only span
+  // synchronous code, e.g. creating and starting a task.
+  class Scope {
+   public:
+    explicit Scope(FrameArena* arena) noexcept
+        : previous_(SetFrameAllocator(arena)) {}
+    ~Scope() { SetFrameAllocator(previous_); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    FrameAllocator* previous_;
+  };
+
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+  explicit FrameArena(size_t chunk_size = kDefaultChunkSize)
+      : chunk_size_(chunk_size) {}
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void* Allocate(size_t size) override;
+  void Deallocate(void* ptr, size_t size) noexcept override;
+
+  size_t allocated_bytes() const { return allocated_bytes_; }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static constexpr int kSizeClassCount = 16;
+
+  size_t chunk_size_;
+  std::vector<std::unique_ptr<std::byte[]>> chunks_;
+  std::byte* current_ = nullptr;
+  size_t remaining_ = 0;
+  size_t allocated_bytes_ = 0;
+  FreeBlock* free_lists_[kSizeClassCount] = {};
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_FRAME_ALLOCATOR_H
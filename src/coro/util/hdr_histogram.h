@@ -0,0 +1,126 @@
+#ifndef CORO_UTIL_HDR_HISTOGRAM_H
+#define CORO_UTIL_HDR_HISTOGRAM_H
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace coro::util {
+
+// High dynamic range histogram of durations, in microseconds. Values below
+// 2 * kSubBucketCount are counted exactly; larger ones fall into buckets
+// covering 1 / kSubBucketCount of their power of two, so any percentile is
+// reported within 0.8% of the recorded value, from microseconds to the
+// largest trackable duration of about 12 days. Unlike LatencyHistogram it's
+// meant for benchmarks, where percentiles are compared across runs; its
+// counters take 34KiB. Adding a sample doesn't allocate.
+class HdrHistogram {
+ public:
+  static constexpr int kSubBucketBits = 7;
+  static constexpr uint64_t kSubBucketCount = uint64_t(1) << kSubBucketBits;
+  static constexpr int kMaxValueBits = 40;
+  static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+
+  HdrHistogram() : counts_(GetIndex(kMaxValue) + 1) {}
+
+  void Add(std::chrono::microseconds duration) {
+    uint64_t value = std::clamp<int64_t>(duration.count(), 0, kMaxValue);
+    counts_[GetIndex(value)]++;
+    count_++;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void Merge(const HdrHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); i++) {
+      counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  // Largest value equivalent to the one at the given percentile, in [0, 100],
+  // capped at the largest recorded value.
+  std::chrono::microseconds GetPercentile(double percentile) const {
+    if (count_ == 0) {
+      return std::chrono::microseconds(0);
+    }
+    auto rank = static_cast<uint64_t>(
+        std::clamp(percentile, 0.0, 100.0) / 100.0 * double(count_ - 1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+      seen += counts_[i];
+      if (seen > rank) {
+        return std::chrono::microseconds(
+            std::min(GetHighestEquivalentValue(i), max_));
+      }
+    }
+    return max();
+  }
+
+  // Calls `func(lowest, highest, count)` for every nonempty bucket, in
+  // increasing order of values. The bucket counts the durations in
+  // [lowest, highest].
+  template <typename F>
+  void ForEachBucket(F func) const {
+    for (size_t i = 0; i < counts_.size(); i++) {
+      if (counts_[i] > 0) {
+        func(std::chrono::microseconds(GetLowestEquivalentValue(i)),
+             std::chrono::microseconds(GetHighestEquivalentValue(i)),
+             counts_[i]);
+      }
+    }
+  }
+
+  uint64_t count() const { return count_; }
+  std::chrono::microseconds min() const {
+    return std::chrono::microseconds(count_ == 0 ? 0 : min_);
+  }
+  std::chrono::microseconds max() const {
+    return std::chrono::microseconds(max_);
+  }
+  std::chrono::microseconds mean() const {
+    return std::chrono::microseconds(count_ == 0 ? 0 : sum_ / count_);
+  }
+
+ private:
+  // Values of 2 * kSubBucketCount and more keep their kSubBucketBits + 1 most
+  // significant bits; `shift` counts the dropped ones.
+  static size_t GetIndex(uint64_t value) {
+    int shift = std::max(
+        static_cast<int>(std::bit_width(value)) - (kSubBucketBits + 1), 0);
+    return kSubBucketCount * shift + (value >> shift);
+  }
+
+  static int GetShift(size_t index) {
+    return index < 2 * kSubBucketCount
+               ? 0
+               : static_cast<int>(index / kSubBucketCount - 1);
+  }
+
+  static uint64_t GetLowestEquivalentValue(size_t index) {
+    int shift = GetShift(index);
+    return (index - kSubBucketCount * shift) << shift;
+  }
+
+  static uint64_t GetHighestEquivalentValue(size_t index) {
+    return GetLowestEquivalentValue(index) +
+           ((uint64_t(1) << GetShift(index)) - 1);
+  }
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t min_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_ = 0;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_HDR_HISTOGRAM_H
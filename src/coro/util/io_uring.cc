@@ -0,0 +1,775 @@
+#include "coro/util/io_uring.h"
+
+#include <arpa/inet.h>
+#include <event2/event.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::util {
+
+namespace {
+
+constexpr unsigned kQueueDepth = 256;
+constexpr unsigned kBufferCount = 256;
+constexpr unsigned kFileCount = 1024;
+constexpr size_t kMaxCopiedChunkSize = 1024;
+constexpr size_t kMaxIovecCount = 64;
+// Files are read into memory in pieces of this size to be sent; io_uring has
+// no sendfile.
+constexpr size_t kFileReadSize = 64 * 1024;
+
+std::string GetErrorMessage(std::string_view call, int error) {
+  return std::string(call) + " failed: " + std::strerror(error);
+}
+
+std::optional<__kernel_timespec> ToTimespec(int timeout_ms) {
+  if (timeout_ms <= 0) {
+    return std::nullopt;
+  }
+  return __kernel_timespec{
+      .tv_sec = timeout_ms / 1000,
+      .tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000};
+}
+
+}  // namespace
+
+void IoUring::EventDeleter::operator()(event* e) const noexcept {
+  event_free(e);
+}
+
+IoUring::IoUring(event_base* event_loop) : event_fd_(-1) {
+  int result = io_uring_queue_init(kQueueDepth, &ring_, /*flags=*/0);
+  if (result < 0) {
+    throw RuntimeError(GetErrorMessage("io_uring_queue_init", -result));
+  }
+  auto cleanup = [&] {
+    completion_event_.reset();
+    submit_event_.reset();
+    if (buffer_ring_) {
+      io_uring_free_buf_ring(&ring_, buffer_ring_, kBufferCount, kBufferGroup);
+    }
+    if (event_fd_ != -1) {
+      close(event_fd_);
+    }
+    io_uring_queue_exit(&ring_);
+  };
+  try {
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ == -1) {
+      throw RuntimeError(GetErrorMessage("eventfd", errno));
+    }
+    result = io_uring_register_eventfd(&ring_, event_fd_);
+    if (result < 0) {
+      throw RuntimeError(
+          GetErrorMessage("io_uring_register_eventfd", -result));
+    }
+    buffers_ = std::make_unique<uint8_t[]>(size_t{kBufferCount} * kBufferSize);
+    buffer_ring_ = io_uring_setup_buf_ring(&ring_, kBufferCount, kBufferGroup,
+                                           /*flags=*/0, &result);
+    if (!buffer_ring_) {
+      throw RuntimeError(GetErrorMessage("io_uring_setup_buf_ring", -result));
+    }
+    for (uint16_t id = 0; id < kBufferCount; id++) {
+      io_uring_buf_ring_add(buffer_ring_,
+                            buffers_.get() + size_t{id} * kBufferSize,
+                            kBufferSize, id,
+                            io_uring_buf_ring_mask(kBufferCount), id);
+    }
+    io_uring_buf_ring_advance(buffer_ring_, kBufferCount);
+    result = io_uring_register_files_sparse(&ring_, kFileCount);
+    if (result < 0) {
+      throw RuntimeError(
+          GetErrorMessage("io_uring_register_files_sparse", -result));
+    }
+    for (int slot = kFileCount - 1; slot >= 0; slot--) {
+      free_file_slots_.push_back(slot);
+    }
+    completion_event_.reset(event_new(
+        event_loop, event_fd_, EV_READ | EV_PERSIST,
+        [](evutil_socket_t, short, void* d) {
+          EventLoop::CallbackScope callback_scope;
+          static_cast<IoUring*>(d)->ReapCompletions();
+        },
+        this));
+    submit_event_.reset(event_new(
+        event_loop, -1, 0,
+        [](evutil_socket_t, short, void* d) {
+          try {
+            static_cast<IoUring*>(d)->OnSubmitEvent();
+          } catch (const Exception& e) {
+            std::cerr << "[IO_URING]: " << e.what() << '\n';
+          }
+        },
+        this));
+    if (!completion_event_ || !submit_event_) {
+      throw RuntimeError("event_new error");
+    }
+  } catch (...) {
+    cleanup();
+    throw;
+  }
+}
+
+IoUring::~IoUring() {
+  completion_event_.reset();
+  submit_event_.reset();
+  io_uring_free_buf_ring(&ring_, buffer_ring_, kBufferCount, kBufferGroup);
+  close(event_fd_);
+  io_uring_queue_exit(&ring_);
+}
+
+void IoUring::Reserve(unsigned count) {
+  if (io_uring_sq_space_left(&ring_) < count) {
+    Submit();
+  }
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+  io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+  if (sqe == nullptr) {
+    Submit();
+    sqe = io_uring_get_sqe(&ring_);
+    if (sqe == nullptr) {
+      throw RuntimeError("io_uring submission queue full");
+    }
+  }
+  return sqe;
+}
+
+void IoUring::OnQueued() {
+  pending_count_++;
+  UpdateCompletionEvent();
+  ScheduleSubmit();
+}
+
+void IoUring::ScheduleSubmit() {
+  if (!submit_scheduled_) {
+    submit_scheduled_ = true;
+    event_active(submit_event_.get(), 0, 0);
+  }
+}
+
+void IoUring::RunBeforeSubmit(Operation* operation) {
+  before_submit_.push_back(operation);
+  ScheduleSubmit();
+}
+
+void IoUring::OnSubmitEvent() {
+  // Entries these queue go into the submission below.
+  for (Operation* operation : std::exchange(before_submit_, {})) {
+    operation->on_complete(operation, 0, 0);
+  }
+  submit_scheduled_ = false;
+  Submit();
+}
+
+void IoUring::Submit() {
+  int result = io_uring_submit(&ring_);
+  if (result < 0 && result != -EAGAIN && result != -EBUSY &&
+      result != -EINTR) {
+    throw RuntimeError(GetErrorMessage("io_uring_submit", -result));
+  }
+  if (io_uring_sq_ready(&ring_) > 0) {
+    // The kernel is short of resources or completions; try again once the
+    // loop has reaped some.
+    ScheduleSubmit();
+  }
+}
+
+void IoUring::Cancel(Operation* operation) {
+  Queue(nullptr, [&](io_uring_sqe* sqe) {
+    io_uring_prep_cancel64(sqe, reinterpret_cast<uintptr_t>(operation),
+                           /*flags=*/0);
+  });
+}
+
+void IoUring::ReapCompletions() {
+  eventfd_t value;
+  eventfd_read(event_fd_, &value);
+  io_uring_cqe* cqe;
+  while (io_uring_peek_cqe(&ring_, &cqe) == 0) {
+    auto* operation = static_cast<Operation*>(io_uring_cqe_get_data(cqe));
+    int result = cqe->res;
+    uint32_t flags = cqe->flags;
+    io_uring_cqe_seen(&ring_, cqe);
+    if (!(flags & IORING_CQE_F_MORE)) {
+      pending_count_--;
+    }
+    if (operation) {
+      operation->on_complete(operation, result, flags);
+    }
+  }
+  UpdateCompletionEvent();
+}
+
+void IoUring::UpdateCompletionEvent() {
+  bool needed = pending_count_ > 0;
+  if (needed == completion_event_added_) {
+    return;
+  }
+  if (needed) {
+    event_add(completion_event_.get(), /*timeout=*/nullptr);
+  } else {
+    event_del(completion_event_.get());
+  }
+  completion_event_added_ = needed;
+}
+
+std::span<const uint8_t> IoUring::GetBuffer(uint16_t id, size_t size) const {
+  return {buffers_.get() + size_t{id} * kBufferSize, size};
+}
+
+void IoUring::RecycleBuffer(uint16_t id) {
+  io_uring_buf_ring_add(buffer_ring_, buffers_.get() + size_t{id} * kBufferSize,
+                        kBufferSize, id, io_uring_buf_ring_mask(kBufferCount),
+                        /*buf_offset=*/0);
+  io_uring_buf_ring_advance(buffer_ring_, 1);
+}
+
+int IoUring::RegisterFile(int fd) {
+  if (free_file_slots_.empty()) {
+    return -1;
+  }
+  int slot = free_file_slots_.back();
+  if (io_uring_register_files_update(&ring_, slot, &fd, 1) != 1) {
+    return -1;
+  }
+  free_file_slots_.pop_back();
+  return slot;
+}
+
+void IoUring::UnregisterFile(int index) {
+  int fd = -1;
+  io_uring_register_files_update(&ring_, index, &fd, 1);
+  free_file_slots_.push_back(index);
+}
+
+struct IoUringSocket::Impl {
+  struct SocketOperation : IoUring::Operation {
+    Impl* socket;
+  };
+
+  // Defers deleting a released socket until the outermost call which may
+  // resume coroutines returns.
+  class DispatchGuard {
+   public:
+    explicit DispatchGuard(Impl* d) : d_(d) { d_->dispatch_depth++; }
+    ~DispatchGuard() {
+      if (--d_->dispatch_depth == 0 && d_->released && !d_->receiving &&
+          !d_->sending && !d_->send_scheduled) {
+        d_->Destroy();
+      }
+    }
+    DispatchGuard(const DispatchGuard&) = delete;
+    DispatchGuard& operator=(const DispatchGuard&) = delete;
+
+   private:
+    Impl* d_;
+  };
+
+  struct ReceiveAwaiter {
+    Impl* d;
+    stdx::coroutine_handle<void> handle;
+
+    ~ReceiveAwaiter() {
+      if (handle && d->reader == handle) {
+        d->reader = nullptr;
+      }
+    }
+
+    bool await_ready() const { return d->stopped; }
+    void await_suspend(stdx::coroutine_handle<void> h) {
+      handle = h;
+      d->reader = h;
+      d->StartReceive();
+    }
+    void await_resume() const {
+      if (d->stopped) {
+        throw InterruptedException();
+      }
+    }
+  };
+
+  struct FlushAwaiter {
+    Impl* d;
+    uint64_t low_watermark;
+    stdx::coroutine_handle<void> handle;
+
+    ~FlushAwaiter() {
+      if (handle && d->writer == handle) {
+        d->writer = nullptr;
+      }
+    }
+
+    bool await_ready() const {
+      return d->stopped || d->output_size <= low_watermark;
+    }
+    void await_suspend(stdx::coroutine_handle<void> h) {
+      handle = h;
+      d->writer = h;
+      d->writer_low_watermark = low_watermark;
+    }
+    void await_resume() const {
+      if (d->stopped && d->output_size > low_watermark) {
+        throw InterruptedException();
+      }
+    }
+  };
+
+  int file() const { return file_index >= 0 ? file_index : fd; }
+  uint8_t file_flags() const { return file_index >= 0 ? IOSQE_FIXED_FILE : 0; }
+
+  void StartReceive() {
+    if (receiving || stopped) {
+      return;
+    }
+    receive_timeout = GetReceiveTimeout();
+    ring->Reserve(receive_timeout ? 2 : 1);
+    ring->Queue(&receive_op, [&](io_uring_sqe* sqe) {
+      io_uring_prep_recv(sqe, file(), nullptr, IoUring::kBufferSize,
+                         /*flags=*/0);
+      sqe->flags |= file_flags() | IOSQE_BUFFER_SELECT |
+                    (receive_timeout ? IOSQE_IO_LINK : 0);
+      sqe->buf_group = IoUring::kBufferGroup;
+    });
+    receiving = true;
+    if (receive_timeout) {
+      ring->Queue(nullptr, [&](io_uring_sqe* sqe) {
+        io_uring_prep_link_timeout(sqe, &*receive_timeout, /*flags=*/0);
+      });
+    }
+  }
+
+  // The read timeout, shortened to whatever is left until `read_deadline`.
+  std::optional<__kernel_timespec> GetReceiveTimeout() const {
+    if (!read_deadline) {
+      return read_timeout;
+    }
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        *read_deadline - std::chrono::steady_clock::now());
+    if (read_timeout &&
+        std::chrono::seconds(read_timeout->tv_sec) +
+                std::chrono::nanoseconds(read_timeout->tv_nsec) <=
+            remaining) {
+      return read_timeout;
+    }
+    return ToTimespec(std::max<int>(static_cast<int>(remaining.count()), 1));
+  }
+
+  static void OnReceived(IoUring::Operation* operation, int result,
+                         uint32_t flags) {
+    Impl* d = static_cast<SocketOperation*>(operation)->socket;
+    DispatchGuard guard(d);
+    d->receiving = false;
+    if (result > 0 && (flags & IORING_CQE_F_BUFFER)) {
+      auto id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+      std::span<const uint8_t> data =
+          d->ring->GetBuffer(id, static_cast<size_t>(result));
+      if (d->input_offset > 0) {
+        d->input.erase(d->input.begin(), d->input.begin() + d->input_offset);
+        d->input_offset = 0;
+      }
+      d->input.insert(d->input.end(), data.begin(), data.end());
+      d->ring->RecycleBuffer(id);
+    } else if (result == -ENOBUFS && !d->stopped) {
+      // Every provided buffer is taken; they're handed back as soon as their
+      // bytes are copied out.
+      d->StartReceive();
+      return;
+    } else {
+      // The end of data, an error, the read timeout or a cancellation.
+      d->Fail();
+    }
+    d->WakeWaiters();
+  }
+
+  void ScheduleSend() {
+    if (sending || send_scheduled || stopped) {
+      return;
+    }
+    // Sent only once the current callbacks are done, so that the chunks they
+    // write go out together.
+    send_scheduled = true;
+    ring->RunBeforeSubmit(&deferred_send_op);
+  }
+
+  static void OnSendScheduled(IoUring::Operation* operation, int, uint32_t) {
+    Impl* d = static_cast<SocketOperation*>(operation)->socket;
+    DispatchGuard guard(d);
+    d->send_scheduled = false;
+    d->StartSend();
+  }
+
+  void MoveCoalesced() {
+    if (!coalesced.empty()) {
+      output.emplace_back(std::move(coalesced));
+      coalesced.clear();
+    }
+  }
+
+  void StartSend() {
+    if (sending || stopped) {
+      return;
+    }
+    MoveCoalesced();
+    if (output.empty()) {
+      return;
+    }
+    if (const FileSlice* file_slice = output.front().file()) {
+      file_buffer.resize(std::min<uint64_t>(file_slice->size(), kFileReadSize));
+      ring->Queue(&send_op, [&](io_uring_sqe* sqe) {
+        io_uring_prep_read(sqe, file_slice->fd(), file_buffer.data(),
+                           static_cast<unsigned>(file_buffer.size()),
+                           file_slice->offset());
+      });
+      sending = true;
+      reading_file = true;
+      return;
+    }
+    iovecs.clear();
+    size_t offset = output_offset;
+    for (const TcpResponseChunk& chunk : output) {
+      if (chunk.file() || iovecs.size() == kMaxIovecCount) {
+        break;
+      }
+      std::span<const uint8_t> bytes = chunk.chunk().subspan(offset);
+      offset = 0;
+      iovecs.push_back(
+          iovec{.iov_base = const_cast<uint8_t*>(bytes.data()),
+                .iov_len = bytes.size()});
+    }
+    message = msghdr{};
+    message.msg_iov = iovecs.data();
+    message.msg_iovlen = iovecs.size();
+    ring->Reserve(write_timeout ? 2 : 1);
+    ring->Queue(&send_op, [&](io_uring_sqe* sqe) {
+      io_uring_prep_sendmsg(sqe, file(), &message, MSG_NOSIGNAL);
+      sqe->flags |= file_flags() | (write_timeout ? IOSQE_IO_LINK : 0);
+    });
+    sending = true;
+    reading_file = false;
+    if (write_timeout) {
+      ring->Queue(nullptr, [&](io_uring_sqe* sqe) {
+        io_uring_prep_link_timeout(sqe, &*write_timeout, /*flags=*/0);
+      });
+    }
+  }
+
+  static void OnSent(IoUring::Operation* operation, int result, uint32_t) {
+    Impl* d = static_cast<SocketOperation*>(operation)->socket;
+    DispatchGuard guard(d);
+    d->sending = false;
+    if (result <= 0) {
+      // An error, the write timeout, a cancellation or a file which shrank.
+      d->Fail();
+    } else if (d->reading_file) {
+      d->file_buffer.resize(static_cast<size_t>(result));
+      FileSlice rest =
+          d->output.front().file()->Subslice(static_cast<uint64_t>(result));
+      if (rest.empty()) {
+        d->output.pop_front();
+      } else {
+        d->output.front() = TcpResponseChunk(std::move(rest));
+      }
+      d->output.emplace_front(std::exchange(d->file_buffer, {}));
+    } else {
+      d->Advance(static_cast<size_t>(result));
+    }
+    d->StartSend();
+    d->WakeWaiters();
+  }
+
+  void Advance(size_t byte_count) {
+    output_size -= byte_count;
+    while (!output.empty() && !output.front().file()) {
+      size_t remaining = output.front().size() - output_offset;
+      if (byte_count < remaining) {
+        output_offset += byte_count;
+        return;
+      }
+      byte_count -= remaining;
+      output_offset = 0;
+      output.pop_front();
+    }
+  }
+
+  void Fail() {
+    if (!released) {
+      stop_source->request_stop();
+    }
+    Cancel();
+  }
+
+  void Cancel() {
+    DispatchGuard guard(this);
+    if (stopped) {
+      return;
+    }
+    stopped = true;
+    if (receiving) {
+      ring->Cancel(&receive_op);
+    }
+    if (sending) {
+      ring->Cancel(&send_op);
+    }
+    WakeWaiters();
+  }
+
+  void WakeWaiters() {
+    if (reader && !receiving) {
+      std::exchange(reader, nullptr).resume();
+    }
+    if (writer &&
+        (stopped ? !sending : output_size <= writer_low_watermark)) {
+      std::exchange(writer, nullptr).resume();
+    }
+  }
+
+  void Release() {
+    DispatchGuard guard(this);
+    released = true;
+    Cancel();
+  }
+
+  void Destroy() {
+    if (file_index >= 0) {
+      ring->UnregisterFile(file_index);
+    }
+    close(fd);
+    delete this;
+  }
+
+  IoUring* ring;
+  int fd;
+  int file_index;
+  stdx::stop_source* stop_source;
+  std::optional<__kernel_timespec> read_timeout;
+  std::optional<__kernel_timespec> write_timeout;
+  std::optional<std::chrono::steady_clock::time_point> read_deadline;
+  // Linked to the receive in flight; read by the kernel on submission.
+  std::optional<__kernel_timespec> receive_timeout;
+  SocketOperation receive_op{{OnReceived}, this};
+  SocketOperation send_op{{OnSent}, this};
+  SocketOperation deferred_send_op{{OnSendScheduled}, this};
+  bool receiving = false;
+  bool sending = false;
+  bool reading_file = false;
+  bool send_scheduled = false;
+  bool stopped = false;
+  bool released = false;
+  int dispatch_depth = 0;
+  stdx::coroutine_handle<void> reader;
+  stdx::coroutine_handle<void> writer;
+  uint64_t writer_low_watermark = 0;
+  std::vector<uint8_t> input;
+  size_t input_offset = 0;
+  // Chunks waiting to be sent, the front ones possibly in flight, and the
+  // bytes of small chunks not yet moved to the back of `output`.
+  std::deque<TcpResponseChunk> output;
+  std::string coalesced;
+  // Bytes of the front chunk which are sent already.
+  size_t output_offset = 0;
+  uint64_t output_size = 0;
+  std::vector<iovec> iovecs;
+  msghdr message{};
+  std::vector<uint8_t> file_buffer;
+};
+
+IoUringSocket::IoUringSocket(IoUring* ring, int fd,
+                             stdx::stop_source* stop_source,
+                             int read_timeout_ms, int write_timeout_ms)
+    : d_(new Impl{.ring = ring,
+                  .fd = fd,
+                  .file_index = ring->RegisterFile(fd),
+                  .stop_source = stop_source,
+                  .read_timeout = ToTimespec(read_timeout_ms),
+                  .write_timeout = ToTimespec(write_timeout_ms)}) {}
+
+IoUringSocket::~IoUringSocket() { d_->Release(); }
+
+Task<std::span<const uint8_t>> IoUringSocket::Peek(uint32_t min_byte_cnt) {
+  if (min_byte_cnt > kMaxBufferSize) {
+    throw InvalidArgument("requested too big request chunk");
+  }
+  min_byte_cnt = std::max<uint32_t>(min_byte_cnt, 1);
+  while (d_->input.size() - d_->input_offset < min_byte_cnt) {
+    if (d_->input.empty()) {
+      // Idle kept-alive connections don't hold on to their input buffer.
+      d_->input.shrink_to_fit();
+    }
+    co_await Impl::ReceiveAwaiter{.d = d_};
+  }
+  co_return std::span<const uint8_t>(d_->input.data() + d_->input_offset,
+                                     d_->input.size() - d_->input_offset);
+}
+
+void IoUringSocket::Consume(uint32_t byte_cnt) {
+  d_->input_offset += byte_cnt;
+  if (d_->input_offset >= d_->input.size()) {
+    d_->input.clear();
+    d_->input_offset = 0;
+  }
+}
+
+void IoUringSocket::SetReadDeadline(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+  d_->read_deadline = deadline;
+}
+
+void IoUringSocket::Write(TcpResponseChunk chunk) {
+  if (d_->stopped) {
+    throw InterruptedException();
+  }
+  uint64_t size = chunk.size();
+  if (!chunk.file() && size <= kMaxCopiedChunkSize) {
+    std::span<const uint8_t> bytes = chunk.chunk();
+    d_->coalesced.append(reinterpret_cast<const char*>(bytes.data()),
+                         bytes.size());
+  } else {
+    d_->MoveCoalesced();
+    d_->output.push_back(std::move(chunk));
+  }
+  d_->output_size += size;
+  d_->ScheduleSend();
+}
+
+uint64_t IoUringSocket::buffered_byte_count() const {
+  return d_->input.size() - d_->input_offset;
+}
+
+uint64_t IoUringSocket::pending_byte_count() const { return d_->output_size; }
+
+Task<> IoUringSocket::Flush(uint64_t low_watermark) {
+  co_await Impl::FlushAwaiter{.d = d_, .low_watermark = low_watermark};
+}
+
+void IoUringSocket::Cancel() { d_->Cancel(); }
+
+struct IoUringListener::Impl {
+  struct AcceptOperation : IoUring::Operation {
+    Impl* listener;
+  };
+
+  void Arm() {
+    if (accepting || paused || released) {
+      return;
+    }
+    ring->Queue(&accept_op, [&](io_uring_sqe* sqe) {
+      io_uring_prep_multishot_accept(sqe, fd, /*addr=*/nullptr,
+                                     /*addrlen=*/nullptr, SOCK_CLOEXEC);
+    });
+    accepting = true;
+  }
+
+  static void OnAccepted(IoUring::Operation* operation, int result,
+                         uint32_t flags) {
+    Impl* d = static_cast<AcceptOperation*>(operation)->listener;
+    if (!(flags & IORING_CQE_F_MORE)) {
+      d->accepting = false;
+    }
+    if (result >= 0) {
+      if (d->released) {
+        close(result);
+      } else {
+        d->dispatching = true;
+        d->callback(d->user_data, result);
+        d->dispatching = false;
+      }
+    }
+    if (d->released) {
+      if (!d->accepting) {
+        d->Destroy();
+      }
+      return;
+    }
+    // Re-armed after a pause was lifted or an error like EMFILE.
+    d->Arm();
+  }
+
+  void Release() {
+    released = true;
+    if (accepting) {
+      ring->Cancel(&accept_op);
+    } else if (!dispatching) {
+      Destroy();
+    }
+  }
+
+  void Destroy() {
+    close(fd);
+    delete this;
+  }
+
+  IoUring* ring;
+  int fd;
+  AcceptCallback callback;
+  void* user_data;
+  AcceptOperation accept_op{{OnAccepted}, this};
+  bool accepting = false;
+  bool paused = false;
+  bool released = false;
+  bool dispatching = false;
+};
+
+IoUringListener::IoUringListener(IoUring* ring, const std::string& address,
+                                 uint16_t port, bool reuse_port,
+                                 AcceptCallback callback, void* user_data) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    throw RuntimeError(GetErrorMessage("socket", errno));
+  }
+  sockaddr_in sin{};
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  inet_pton(AF_INET, address.c_str(), &sin.sin_addr);
+  int enabled = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled)) !=
+          0 ||
+      (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enabled,
+                                sizeof(enabled)) != 0) ||
+      bind(fd, reinterpret_cast<sockaddr*>(&sin), sizeof(sin)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    int error = errno;
+    close(fd);
+    throw RuntimeError(GetErrorMessage("binding the listener", error));
+  }
+  d_ = new Impl{
+      .ring = ring, .fd = fd, .callback = callback, .user_data = user_data};
+  d_->Arm();
+}
+
+IoUringListener::~IoUringListener() { d_->Release(); }
+
+int IoUringListener::fd() const { return d_->fd; }
+
+void IoUringListener::Pause() {
+  d_->paused = true;
+  if (d_->accepting) {
+    d_->ring->Cancel(&d_->accept_op);
+  }
+}
+
+void IoUringListener::Resume() {
+  d_->paused = false;
+  d_->Arm();
+}
+
+}  // namespace coro::util
@@ -0,0 +1,182 @@
+#ifndef CORO_UTIL_IO_URING_H
+#define CORO_UTIL_IO_URING_H
+
+#include <liburing.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "coro/stdx/stop_source.h"
+#include "coro/task.h"
+#include "coro/util/tcp_server.h"
+
+struct event_base;
+struct event;
+
+namespace coro::util {
+
+// Ring of an EventLoop created with IoBackend::kIoUring. Entries queued while
+// the loop runs callbacks are submitted together once they're done, and the
+// loop learns about completions through an eventfd, so io_uring operations
+// mix freely with libevent events and timers. Everything but the constructor
+// has to be called on the event loop's thread.
+class IoUring {
+ public:
+  // Receives the completions of a queued entry. Multishot entries complete
+  // more than once, the last time without IORING_CQE_F_MORE in `flags`.
+  struct Operation {
+    void (*on_complete)(Operation*, int result, uint32_t flags);
+  };
+
+  static constexpr uint16_t kBufferGroup = 0;
+  static constexpr uint32_t kBufferSize = 4 * 1024;
+
+  // Throws RuntimeError if the kernel lacks the io_uring features used.
+  explicit IoUring(event_base* event_loop);
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+  IoUring& operator=(IoUring&&) = delete;
+
+  // Makes room for `count` entries, so that the next `count` queued ones are
+  // submitted at once, as linked entries have to be.
+  void Reserve(unsigned count);
+
+  // Queues an entry set up by `prepare`. Completions of a null `operation`
+  // are dropped.
+  template <typename F>
+  void Queue(Operation* operation, F prepare) {
+    io_uring_sqe* sqe = GetSqe();
+    prepare(sqe);
+    io_uring_sqe_set_data(sqe, operation);
+    OnQueued();
+  }
+
+  // Asks the kernel to cancel the entries of `operation`, which then complete
+  // with -ECANCELED unless they have completed already.
+  void Cancel(Operation* operation);
+
+  // Calls `operation` with a zero result right before the next submission,
+  // so that the entries it queues can cover the work of all the callbacks
+  // the loop is running now.
+  void RunBeforeSubmit(Operation* operation);
+
+  // Bytes the kernel received into a provided buffer, see
+  // IOSQE_BUFFER_SELECT. The buffer has to be recycled once they're used.
+  std::span<const uint8_t> GetBuffer(uint16_t id, size_t size) const;
+  void RecycleBuffer(uint16_t id);
+
+  // Slot of `fd` in the table of registered files, to be used with
+  // IOSQE_FIXED_FILE, or -1 if the table is full.
+  int RegisterFile(int fd);
+  void UnregisterFile(int index);
+
+ private:
+  struct EventDeleter {
+    void operator()(event*) const noexcept;
+  };
+
+  io_uring_sqe* GetSqe();
+  void OnQueued();
+  void ScheduleSubmit();
+  void OnSubmitEvent();
+  void Submit();
+  void ReapCompletions();
+  // Keeps the completion event added only while completions are awaited, so
+  // that an idle ring doesn't keep the loop from exiting.
+  void UpdateCompletionEvent();
+
+  io_uring ring_;
+  int event_fd_;
+  std::unique_ptr<event, EventDeleter> completion_event_;
+  std::unique_ptr<event, EventDeleter> submit_event_;
+  bool completion_event_added_ = false;
+  bool submit_scheduled_ = false;
+  std::vector<Operation*> before_submit_;
+  // Queued entries whose last completion hasn't been reaped yet.
+  int pending_count_ = 0;
+  io_uring_buf_ring* buffer_ring_ = nullptr;
+  std::unique_ptr<uint8_t[]> buffers_;
+  std::vector<int> free_file_slots_;
+};
+
+// Connected socket of a TcpServer on an io_uring loop. Receives go into
+// provided buffers and are copied out of them right away, so that idle
+// connections pin no memory; queued response chunks are sent in the
+// background with gathering sendmsg, the way they drain out of a bufferevent.
+// Errors, the end of data and timeouts stop `stop_source`, whose stopping in
+// turn cancels the operations in flight.
+class IoUringSocket {
+ public:
+  IoUringSocket(IoUring* ring, int fd, stdx::stop_source* stop_source,
+                int read_timeout_ms, int write_timeout_ms);
+  // Closes the socket once the operations in flight are done.
+  ~IoUringSocket();
+
+  IoUringSocket(const IoUringSocket&) = delete;
+  IoUringSocket(IoUringSocket&&) = delete;
+  IoUringSocket& operator=(const IoUringSocket&) = delete;
+  IoUringSocket& operator=(IoUringSocket&&) = delete;
+
+  // Same contract as TcpRequestDataProvider::Peek, but throws
+  // InterruptedException once `stop_source` is stopped.
+  Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt);
+  void Consume(uint32_t byte_cnt);
+  // See TcpRequestDataProvider::SetReadDeadline.
+  void SetReadDeadline(
+      std::optional<std::chrono::steady_clock::time_point> deadline);
+  // Received bytes which aren't consumed yet.
+  uint64_t buffered_byte_count() const;
+
+  void Write(TcpResponseChunk chunk);
+  uint64_t pending_byte_count() const;
+  // Waits until at most `low_watermark` written bytes aren't sent yet.
+  Task<> Flush(uint64_t low_watermark = 0);
+
+  // Cancels the operations in flight; called when `stop_source` is stopped.
+  void Cancel();
+
+ private:
+  struct Impl;
+
+  Impl* d_;
+};
+
+// Listening socket accepting connections with a multishot accept.
+class IoUringListener {
+ public:
+  using AcceptCallback = void (*)(void* user_data, int fd);
+
+  // Throws RuntimeError if the socket can't be bound.
+  IoUringListener(IoUring* ring, const std::string& address, uint16_t port,
+                  bool reuse_port, AcceptCallback callback, void* user_data);
+  // Closes the socket once the accept in flight is cancelled.
+  ~IoUringListener();
+
+  IoUringListener(const IoUringListener&) = delete;
+  IoUringListener(IoUringListener&&) = delete;
+  IoUringListener& operator=(const IoUringListener&) = delete;
+  IoUringListener& operator=(IoUringListener&&) = delete;
+
+  int fd() const;
+
+  // Connections accepted before the pause takes effect are still reported.
+  void Pause();
+  void Resume();
+
+ private:
+  struct Impl;
+
+  Impl* d_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_IO_URING_H
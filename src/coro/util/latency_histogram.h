@@ -0,0 +1,126 @@
+#ifndef CORO_UTIL_LATENCY_HISTOGRAM_H
+#define CORO_UTIL_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace coro::util {
+
+// Histogram of durations with power-of-two microsecond buckets: bucket `i`
+// counts durations shorter than 2^i microseconds which didn't fit into the
+// previous bucket. Adding a sample doesn't allocate.
+class LatencyHistogram {
+ public:
+  static constexpr int kBucketCount = 40;
+
+  void Add(std::chrono::microseconds duration) {
+    buckets_[GetBucket(duration)]++;
+    count_++;
+    sum_ += duration;
+    if (duration > max_) {
+      max_ = duration;
+    }
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < kBucketCount; i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_) {
+      max_ = other.max_;
+    }
+  }
+
+  // Upper bound of the bucket holding the given percentile, in [0, 100].
+  std::chrono::microseconds GetPercentile(double percentile) const {
+    if (count_ == 0) {
+      return std::chrono::microseconds(0);
+    }
+    auto rank = static_cast<uint64_t>(percentile / 100.0 * (count_ - 1));
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; i++) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        auto bound = std::chrono::microseconds(uint64_t(1) << i);
+        return bound < max_ ? bound : max_;
+      }
+    }
+    return max_;
+  }
+
+  uint64_t count() const { return count_; }
+  std::chrono::microseconds sum() const { return sum_; }
+  std::chrono::microseconds max() const { return max_; }
+  const std::array<uint64_t, kBucketCount>& buckets() const {
+    return buckets_;
+  }
+
+ private:
+  friend class SingleWriterLatencyHistogram;
+
+  static int GetBucket(std::chrono::microseconds duration) {
+    auto us =
+        static_cast<uint64_t>(duration.count() > 0 ? duration.count() : 0);
+    int bucket = std::bit_width(us);
+    return bucket < kBucketCount ? bucket : kBucketCount - 1;
+  }
+
+  std::array<uint64_t, kBucketCount> buckets_{};
+  uint64_t count_ = 0;
+  std::chrono::microseconds sum_{0};
+  std::chrono::microseconds max_{0};
+};
+
+// LatencyHistogram which a single thread adds to while others may read it.
+// Adding takes no locks and no atomic read-modify-writes, since nobody else
+// writes the counters.
+class SingleWriterLatencyHistogram {
+ public:
+  // Only called by the writing thread.
+  void Add(std::chrono::microseconds duration) {
+    Increment(buckets_[LatencyHistogram::GetBucket(duration)], 1);
+    Increment(count_, 1);
+    Increment(sum_us_, duration.count());
+    if (duration.count() > max_us_.load(std::memory_order_relaxed)) {
+      max_us_.store(duration.count(), std::memory_order_relaxed);
+    }
+  }
+
+  // The counters are read one by one, so a sample added meanwhile may be
+  // counted partially.
+  LatencyHistogram Load() const {
+    LatencyHistogram histogram;
+    for (int i = 0; i < LatencyHistogram::kBucketCount; i++) {
+      histogram.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    histogram.count_ = count_.load(std::memory_order_relaxed);
+    histogram.sum_ =
+        std::chrono::microseconds(sum_us_.load(std::memory_order_relaxed));
+    histogram.max_ =
+        std::chrono::microseconds(max_us_.load(std::memory_order_relaxed));
+    return histogram;
+  }
+
+ private:
+  template <typename T>
+  static void Increment(std::atomic<T>& counter,
+                        std::type_identity_t<T> value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> buckets_{};
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<int64_t> sum_us_ = 0;
+  std::atomic<int64_t> max_us_ = 0;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_LATENCY_HISTOGRAM_H
@@ -1,7 +1,10 @@
 #ifndef CORO_CLOUDSTORAGE_LRU_CACHE_H
 #define CORO_CLOUDSTORAGE_LRU_CACHE_H
 
-#include <set>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <utility>
 
@@ -13,34 +16,59 @@
 
 namespace coro::util {
 
-template <typename Key, typename Factory, typename Hash = std::hash<Key>>
+struct UnitWeigher {
+  template <typename Key, typename Value>
+  size_t operator()(const Key&, const Value&) const {
+    return 1;
+  }
+};
+
+// Entries live in a single hash map; its nodes are additionally linked into a
+// recency list, most recently used first. Lookups, accesses and evictions are
+// O(1) and keys are stored once.
+//
+// The cache holds at most `size` values whose total weight, as reported by
+// `Weigher`, doesn't exceed `max_weight`. Values heavier than `max_weight` are
+// returned but never kept.
+template <typename Key, typename Factory, typename Hash = std::hash<Key>,
+          typename Weigher = UnitWeigher>
 class LRUCache {
  public:
   using Value = typename decltype(std::declval<Factory>()(
       std::declval<Key>(), std::declval<stdx::stop_token>()))::type;
 
   LRUCache(int size, Factory factory)
-      : size_(size), factory_(std::move(factory)), queue_(Compare{this}) {}
+      : LRUCache(size, std::numeric_limits<size_t>::max(), std::move(factory)) {
+  }
+
+  LRUCache(int size, size_t max_weight, Factory factory, Weigher weigher = {})
+      : size_(size),
+        max_weight_(max_weight),
+        factory_(std::move(factory)),
+        weigher_(std::move(weigher)) {}
 
   LRUCache(LRUCache&& other) noexcept
       : size_(other.size_),
+        max_weight_(other.max_weight_),
         factory_(std::move(other.factory_)),
-        time_(other.time_),
+        weigher_(std::move(other.weigher_)),
         map_(std::move(other.map_)),
-        pending_(std::move(other.pending_)),
-        last_access_(std::move(other.last_access_)),
-        queue_(other.queue_.begin(), other.queue_.end(), Compare{this}),
+        head_(std::exchange(other.head_, nullptr)),
+        tail_(std::exchange(other.tail_, nullptr)),
+        value_count_(std::exchange(other.value_count_, 0)),
+        weight_(std::exchange(other.weight_, 0)),
         stop_source_(std::move(other.stop_source_)) {}
 
   LRUCache& operator=(LRUCache&& other) noexcept {
     size_ = other.size_;
+    max_weight_ = other.max_weight_;
     factory_ = std::move(other.factory_);
-    time_ = other.time_;
+    weigher_ = std::move(other.weigher_);
     map_ = std::move(other.map_);
-    pending_ = std::move(other.pending_);
-    last_access_ = std::move(other.last_access_);
-    queue_ = std::set<Key, Compare>(other.queue_.begin(), other.queue_.end(),
-                                    Compare{this});
+    head_ = std::exchange(other.head_, nullptr);
+    tail_ = std::exchange(other.tail_, nullptr);
+    value_count_ = std::exchange(other.value_count_, 0);
+    weight_ = std::exchange(other.weight_, 0);
     stop_source_ = std::move(other.stop_source_);
     return *this;
   }
@@ -48,30 +76,33 @@ class LRUCache {
   ~LRUCache() { stop_source_.request_stop(); }
 
   Task<Value> Get(Key key, stdx::stop_token stop_token) {
-    RegisterAccess(key);
-    if (auto result = GetCached(key)) {
-      co_return std::move(*result);
-    }
-    auto promise_it = pending_.find(key);
-    if (promise_it != std::end(pending_)) {
-      co_return co_await promise_it->second.Get(std::move(stop_token));
-    }
-    promise_it =
-        pending_
-            .emplace(std::piecewise_construct, std::forward_as_tuple(key),
-                     std::forward_as_tuple(
-                         ProduceValue{.d = this,
-                                      .key = key,
-                                      .stop_token = stop_source_.get_token()}))
-            .first;
-    auto guard = AtScopeExit([&] { pending_.erase(key); });
-    co_return co_await promise_it->second.Get(std::move(stop_token));
+    Entry& entry = Access(std::move(key));
+    if (entry.value) {
+      co_return *entry.value;
+    }
+    co_return co_await Produce(entry, std::move(stop_token));
   }
 
+  // Produces a new value for `key` even if one is cached. The current value
+  // stays available through GetCached until the new one replaces it.
+  Task<Value> Refresh(Key key, stdx::stop_token stop_token) {
+    co_return co_await Produce(Access(std::move(key)), std::move(stop_token));
+  }
+
+  // Caches `value` for `key` as if the factory had produced it, e.g. when it
+  // was learned as a side effect of producing another value.
+  void Put(Key key, Value value) { Insert(std::move(key), std::move(value)); }
+
   void Invalidate(const Key& key) {
-    last_access_.erase(key);
-    map_.erase(key);
-    queue_.erase(key);
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+      return;
+    }
+    if (it->second.pending) {
+      ResetValue(it->second);
+    } else {
+      Erase(it->second);
+    }
   }
 
   std::optional<Value> GetCached(const Key& key) const {
@@ -79,27 +110,151 @@ class LRUCache {
     if (it == map_.end()) {
       return std::nullopt;
     }
-    return it->second;
+    return it->second.value;
+  }
+
+  // Weighs the value cached for `key` again, e.g. after it grew in place, and
+  // evicts values until the cache fits within its budget.
+  void UpdateWeight(const Key& key) {
+    auto it = map_.find(key);
+    if (it == map_.end() || !it->second.value) {
+      return;
+    }
+    Entry& entry = it->second;
+    size_t weight = weigher_(key, *entry.value);
+    if (weight > max_weight_) {
+      Invalidate(key);
+      return;
+    }
+    weight_ = weight_ - entry.weight + weight;
+    entry.weight = weight;
+    while (weight_ > max_weight_ && EvictOne()) {
+    }
   }
 
+  size_t weight() const { return weight_; }
+
  private:
+  struct ProduceValue;
+
+  struct Entry {
+    std::optional<Value> value;
+    std::optional<SharedPromise<ProduceValue>> pending;
+    size_t weight = 0;
+    const Key* key = nullptr;
+    Entry* prev = nullptr;
+    Entry* next = nullptr;
+  };
+
+  // Joins the production of the entry's value, starting it if needed.
+  Task<Value> Produce(Entry& entry, stdx::stop_token stop_token) {
+    if (entry.pending) {
+      co_return co_await entry.pending->Get(std::move(stop_token));
+    }
+    entry.pending.emplace(ProduceValue{.d = this,
+                                       .key = *entry.key,
+                                       .stop_token = stop_source_.get_token()});
+    auto guard = AtScopeExit([&] {
+      entry.pending.reset();
+      if (!entry.value) {
+        Erase(entry);
+      }
+    });
+    co_return co_await entry.pending->Get(std::move(stop_token));
+  }
+
+  // Returns the entry for `key`, creating it if needed, and marks it as the
+  // most recently used one.
+  Entry& Access(Key key) {
+    auto [it, inserted] = map_.try_emplace(std::move(key));
+    Entry& entry = it->second;
+    if (inserted) {
+      entry.key = &it->first;
+    } else {
+      Unlink(entry);
+    }
+    PushFront(entry);
+    return entry;
+  }
+
   void Insert(Key key, Value value) {
-    while (map_.size() >= static_cast<size_t>(size_)) {
-      Invalidate(*queue_.begin());
+    size_t weight = weigher_(key, value);
+    if (weight > max_weight_) {
+      Invalidate(key);
+      return;
+    }
+    Entry& entry = Access(std::move(key));
+    ResetValue(entry);
+    while ((value_count_ >= static_cast<size_t>(size_) ||
+            weight_ + weight > max_weight_) &&
+           EvictOne()) {
+    }
+    entry.value = std::move(value);
+    entry.weight = weight;
+    value_count_++;
+    weight_ += weight;
+  }
+
+  void ResetValue(Entry& entry) {
+    if (entry.value) {
+      entry.value.reset();
+      value_count_--;
+      weight_ -= entry.weight;
+    }
+  }
+
+  // Drops the least recently used value. Entries which are still being
+  // produced keep their place in the list.
+  bool EvictOne() {
+    for (Entry* entry = tail_; entry; entry = entry->prev) {
+      if (!entry->value) {
+        continue;
+      }
+      if (entry->pending) {
+        ResetValue(*entry);
+      } else {
+        Erase(*entry);
+      }
+      return true;
     }
-    map_.emplace(std::move(key), std::move(value));
+    return false;
   }
 
-  void RegisterAccess(Key key) {
-    queue_.erase(key);
-    last_access_[key] = time_++;
-    queue_.emplace(std::move(key));
+  void Erase(Entry& entry) {
+    ResetValue(entry);
+    Unlink(entry);
+    map_.erase(*entry.key);
+  }
+
+  void PushFront(Entry& entry) {
+    entry.prev = nullptr;
+    entry.next = head_;
+    if (head_) {
+      head_->prev = &entry;
+    } else {
+      tail_ = &entry;
+    }
+    head_ = &entry;
+  }
+
+  void Unlink(Entry& entry) {
+    if (entry.prev) {
+      entry.prev->next = entry.next;
+    } else {
+      head_ = entry.next;
+    }
+    if (entry.next) {
+      entry.next->prev = entry.prev;
+    } else {
+      tail_ = entry.prev;
+    }
+    entry.prev = entry.next = nullptr;
   }
 
   struct ProduceValue {
     Task<Value> operator()() && {
       auto result = co_await d->factory_(key, std::move(stop_token));
-      d->Insert(key, result);
+      d->Insert(std::move(key), result);
       co_return result;
     }
     LRUCache* d;
@@ -107,20 +262,15 @@ class LRUCache {
     stdx::stop_token stop_token;
   };
 
-  struct Compare {
-    bool operator()(const Key& k1, const Key& k2) const {
-      return d->last_access_[k1] < d->last_access_[k2];
-    }
-    LRUCache* d;
-  };
-
   int size_;
+  size_t max_weight_;
   Factory factory_;
-  int time_ = 0;
-  std::unordered_map<Key, Value, Hash> map_;
-  std::unordered_map<Key, SharedPromise<ProduceValue>, Hash> pending_;
-  std::unordered_map<Key, int, Hash> last_access_;
-  std::set<Key, Compare> queue_;
+  Weigher weigher_;
+  std::unordered_map<Key, Entry, Hash> map_;
+  Entry* head_ = nullptr;
+  Entry* tail_ = nullptr;
+  size_t value_count_ = 0;
+  size_t weight_ = 0;
   stdx::stop_source stop_source_;
 };
 
@@ -0,0 +1,112 @@
+#include "coro/util/multi_threaded_tcp_server.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::util {
+
+namespace {
+
+// Wakeups posted from other threads don't count as pending events, so this
+// keeps an event loop from exiting on empty while those are awaited.
+Task<> KeepAlive(const EventLoop* event_loop, stdx::stop_token stop_token) {
+  try {
+    co_await event_loop->Wait(std::numeric_limits<int>::max(),
+                              std::move(stop_token));
+  } catch (const InterruptedException&) {
+  }
+}
+
+}  // namespace
+
+MultiThreadedTcpServer::MultiThreadedTcpServer(
+    TcpRequestHandlerFactory handler_factory, const EventLoop* event_loop,
+    const Config& config)
+    : event_loop_(event_loop) {
+  if (config.thread_count == 0) {
+    throw InvalidArgument("thread_count must be positive");
+  }
+  TcpServer::Config server_config = config.server;
+  server_config.reuse_port = true;
+  // Every server is created before any thread starts, so that a server which
+  // fails to be created leaves no thread behind.
+  for (unsigned int i = 0; i < config.thread_count; i++) {
+    auto worker = std::make_unique<Worker>(config.event_loop);
+    worker->server = std::make_unique<TcpServer>(
+        handler_factory(&worker->event_loop), &worker->event_loop,
+        server_config);
+    // All listeners have to share the port picked by the first one.
+    server_config.port = worker->server->GetPort();
+    workers_.push_back(std::move(worker));
+  }
+  try {
+    for (unsigned int i = 0; i < config.thread_count; i++) {
+      workers_[i]->thread = std::thread([worker = workers_[i].get(), i] {
+        SetThreadName("coro-tcp-" + std::to_string(i));
+        worker->event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+      });
+    }
+  } catch (...) {
+    StopWorkers();
+    throw;
+  }
+}
+
+MultiThreadedTcpServer::~MultiThreadedTcpServer() { StopWorkers(); }
+
+void MultiThreadedTcpServer::StopWorkers() {
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->event_loop.ExitLoop();
+      worker->thread.join();
+    }
+  }
+}
+
+uint16_t MultiThreadedTcpServer::GetPort() const {
+  return workers_.front()->server->GetPort();
+}
+
+TcpServerMemoryStats MultiThreadedTcpServer::GetMemoryStats() const {
+  TcpServerMemoryStats stats;
+  for (const auto& worker : workers_) {
+    TcpServerMemoryStats worker_stats = worker->event_loop.Do(
+        [server = worker->server.get()] { return server->GetMemoryStats(); });
+    stats.connection_count += worker_stats.connection_count;
+    stats.input_bytes += worker_stats.input_bytes;
+    stats.output_bytes += worker_stats.output_bytes;
+    stats.max_connection_bytes = std::max(stats.max_connection_bytes,
+                                          worker_stats.max_connection_bytes);
+  }
+  return stats;
+}
+
+Task<> MultiThreadedTcpServer::Quit() {
+  if (!quitting_) {
+    quitting_ = true;
+    for (auto& worker : workers_) {
+      worker->event_loop.RunOnEventLoop(
+          [this, worker = worker.get()] { return QuitWorker(worker); });
+    }
+  }
+  stdx::stop_source keep_alive;
+  RunTask(KeepAlive(event_loop_, keep_alive.get_token()));
+  auto scope_guard = AtScopeExit([&] { keep_alive.request_stop(); });
+  for (const auto& worker : workers_) {
+    Promise<void>& quit_semaphore = worker->quit_semaphore;
+    co_await quit_semaphore;
+  }
+}
+
+Task<> MultiThreadedTcpServer::QuitWorker(Worker* worker) const {
+  co_await worker->server->Quit();
+  event_loop_->RunOnEventLoop([worker] { worker->quit_semaphore.SetValue(); });
+}
+
+}  // namespace coro::util
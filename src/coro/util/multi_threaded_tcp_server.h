@@ -0,0 +1,78 @@
+#ifndef CORO_UTIL_MULTI_THREADED_TCP_SERVER_H
+#define CORO_UTIL_MULTI_THREADED_TCP_SERVER_H
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/stdx/any_invocable.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::util {
+
+// Creates the request handler of a single TcpServer, which serves its
+// connections on the given event loop.
+using TcpRequestHandlerFactory =
+    stdx::any_invocable<TcpRequestHandler(const EventLoop*)>;
+
+// Runs one TcpServer per thread, each with its own EventLoop and its own
+// SO_REUSEPORT listener bound to the same address, so that the kernel spreads
+// incoming connections over the threads.
+class MultiThreadedTcpServer {
+ public:
+  struct Config {
+    TcpServer::Config server;
+    unsigned int thread_count = std::thread::hardware_concurrency();
+    // Config of the event loop of every thread, e.g. its I/O backend.
+    EventLoop::Config event_loop;
+  };
+
+  // `event_loop` is the loop Quit() is awaited on. Request handlers are
+  // created on the calling thread, before the server threads start.
+  MultiThreadedTcpServer(TcpRequestHandlerFactory handler_factory,
+                         const EventLoop* event_loop, const Config& config);
+  ~MultiThreadedTcpServer();
+
+  MultiThreadedTcpServer(const MultiThreadedTcpServer&) = delete;
+  MultiThreadedTcpServer(MultiThreadedTcpServer&&) = delete;
+
+  MultiThreadedTcpServer& operator=(const MultiThreadedTcpServer&) = delete;
+  MultiThreadedTcpServer& operator=(MultiThreadedTcpServer&&) = delete;
+
+  uint16_t GetPort() const;
+
+  // Sums the memory stats of the servers of all threads. Blocks until every
+  // thread has reported them, so it can't be called on a server thread.
+  TcpServerMemoryStats GetMemoryStats() const;
+
+  // Stops accepting connections on all threads and waits until every
+  // connection has finished.
+  Task<> Quit();
+
+ private:
+  struct Worker {
+    explicit Worker(const EventLoop::Config& config) : event_loop(config) {}
+
+    EventLoop event_loop;
+    std::unique_ptr<TcpServer> server;
+    Promise<void> quit_semaphore;
+    std::thread thread;
+  };
+
+  // Runs on the worker's event loop.
+  Task<> QuitWorker(Worker* worker) const;
+
+  // Exits the event loops of the threads started and joins them.
+  void StopWorkers();
+
+  const EventLoop* event_loop_;
+  bool quitting_ = false;
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_MULTI_THREADED_TCP_SERVER_H
@@ -1,15 +1,36 @@
 #include "coro/util/tcp_server.h"
 
-#ifndef _WIN32
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #endif
 
 #include <event2/buffer.h>
 #include <event2/bufferevent.h>
 #include <event2/listener.h>
 
+#ifdef CORO_HTTP_HAVE_TLS
+#include <event2/bufferevent_ssl.h>
+#include <openssl/ssl.h>
+#endif
+
+#ifdef CORO_HTTP_HAVE_IO_URING
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "coro/util/io_uring.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <new>
+#include <optional>
 #include <span>
 
 #include "coro/exception.h"
@@ -19,19 +40,31 @@ namespace coro::util {
 
 namespace {
 
+constexpr size_t kMaxCopiedChunkSize = 1024;
+
 struct RequestContext {
-  Promise<void> read_semaphore;
-  Promise<void> write_semaphore;
-  stdx::stop_source stop_source;
-  std::vector<uint8_t> request;
+  Promise<void> read_semaphore{};
+  Promise<void> write_semaphore{};
+  stdx::stop_source stop_source{};
+  std::optional<timeval> read_timeout = std::nullopt;
+  std::optional<timeval> write_timeout = std::nullopt;
+  std::optional<std::chrono::steady_clock::time_point> read_deadline =
+      std::nullopt;
+  std::string peer_address;
 };
 
 struct BufferEventDeleter {
-  void operator()(bufferevent* bev) const noexcept { bufferevent_free(bev); }
-};
-
-struct EvBufferDeleter {
-  void operator()(evbuffer* buffer) const noexcept { evbuffer_free(buffer); }
+  void operator()(bufferevent* bev) const noexcept {
+#ifdef CORO_HTTP_HAVE_TLS
+    // Sends close_notify, so that the client can tell the end of the
+    // connection from a truncation. Doesn't wait for the client's alert.
+    if (SSL* ssl = bufferevent_openssl_get_ssl(bev);
+        ssl != nullptr && SSL_is_init_finished(ssl)) {
+      SSL_shutdown(ssl);
+    }
+#endif
+    bufferevent_free(bev);
+  }
 };
 
 void Check(int code) {
@@ -40,13 +73,59 @@ void Check(int code) {
   }
 }
 
-Task<> WaitRead(RequestContext* context) {
+std::optional<timeval> ToTimeval(int timeout_ms) {
+  if (timeout_ms <= 0) {
+    return std::nullopt;
+  }
+  timeval result;
+  result.tv_sec = timeout_ms / 1000;
+  result.tv_usec = (timeout_ms % 1000) * 1000;
+  return result;
+}
+
+const timeval* GetPointer(const std::optional<timeval>& value) {
+  return value ? &*value : nullptr;
+}
+
+// The read timeout, shortened to whatever is left until the read deadline.
+// Throws InterruptedException once the deadline has passed.
+std::optional<timeval> GetReadTimeout(const RequestContext& context) {
+  if (!context.read_deadline) {
+    return context.read_timeout;
+  }
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      *context.read_deadline - std::chrono::steady_clock::now());
+  if (remaining.count() <= 0) {
+    throw InterruptedException();
+  }
+  if (context.read_timeout &&
+      std::chrono::seconds(context.read_timeout->tv_sec) +
+              std::chrono::microseconds(context.read_timeout->tv_usec) <=
+          remaining) {
+    return context.read_timeout;
+  }
+  return ToTimeval(static_cast<int>(remaining.count()));
+}
+
+Task<> WaitRead(RequestContext* context, bufferevent* bev) {
   if (context->stop_source.get_token().stop_requested()) {
     throw InterruptedException();
-  } else {
-    co_await context->read_semaphore;
-    context->read_semaphore = Promise<void>();
   }
+  // The read timeout runs only while waiting here, so that a response which
+  // takes long to produce doesn't count against it.
+  std::optional<timeval> read_timeout = GetReadTimeout(*context);
+  if (read_timeout) {
+    Check(bufferevent_set_timeouts(bev, GetPointer(read_timeout),
+                                   GetPointer(context->write_timeout)));
+  }
+  auto timeout_guard = AtScopeExit([&] {
+    if (read_timeout) {
+      bufferevent_set_timeouts(bev, /*timeout_read=*/nullptr,
+                               GetPointer(context->write_timeout));
+    }
+  });
+  co_await context->read_semaphore;
+  context->read_semaphore = Promise<void>();
 }
 
 Task<> WaitWrite(RequestContext* context) {
@@ -58,96 +137,431 @@ Task<> WaitWrite(RequestContext* context) {
   }
 }
 
-Task<> Write(RequestContext* context, bufferevent* bev, TcpResponseChunk data) {
-  std::unique_ptr<evbuffer, EvBufferDeleter> buffer{evbuffer_new()};
-  if (!buffer) {
-    throw RuntimeError("evbuffer_new error");
+// Waits until at most `low_watermark` bytes of the output aren't sent yet. The
+// write callback runs whenever a write leaves no more than the bufferevent's
+// write low watermark, which is at most `low_watermark`.
+Task<> Flush(RequestContext* context, bufferevent* bev,
+             uint32_t low_watermark) {
+  while (evbuffer_get_length(bufferevent_get_output(bev)) > low_watermark) {
+    co_await WaitWrite(context);
+  }
+}
+
+// Holders of chunks which libevent references until their bytes are sent,
+// which may be after the connection is gone. They're recycled through
+// per-thread free lists instead of going through the heap for every large
+// chunk. The frame allocator isn't used for them: the one installed when a
+// holder is created, e.g. a FrameArena, may be gone by the time libevent frees
+// it.
+template <typename T>
+struct HolderCache {
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static constexpr int kMaxCachedHolders = 64;
+
+  ~HolderCache() {
+    while (free_list) {
+      FreeBlock* next = free_list->next;
+      ::operator delete(free_list);
+      free_list = next;
+    }
+    destroyed = true;
+  }
+
+  FreeBlock* free_list = nullptr;
+  int free_count = 0;
+  static thread_local bool destroyed;
+};
+
+template <typename T>
+thread_local bool HolderCache<T>::destroyed = false;
+
+template <typename T>
+thread_local HolderCache<T> holder_cache;
+
+template <typename T>
+T* NewPooled(T value) {
+  static_assert(sizeof(T) >= sizeof(typename HolderCache<T>::FreeBlock));
+  void* data = nullptr;
+  if (!HolderCache<T>::destroyed) {
+    HolderCache<T>& cache = holder_cache<T>;
+    if (cache.free_list) {
+      data = cache.free_list;
+      cache.free_list = cache.free_list->next;
+      cache.free_count--;
+    }
+  }
+  if (!data) {
+    data = ::operator new(sizeof(T));
+  }
+  return ::new (data) T(std::move(value));
+}
+
+template <typename T>
+void DeletePooled(void* value) noexcept {
+  static_cast<T*>(value)->~T();
+  if (HolderCache<T>::destroyed) {
+    ::operator delete(value);
+    return;
+  }
+  HolderCache<T>& cache = holder_cache<T>;
+  if (cache.free_count >= HolderCache<T>::kMaxCachedHolders) {
+    ::operator delete(value);
+    return;
+  }
+  cache.free_list = ::new (value)
+      typename HolderCache<T>::FreeBlock{.next = cache.free_list};
+  cache.free_count++;
+}
+
+// Queues a segment of a file on `output`. Libevent sends it with sendfile when
+// the output drains straight into a socket and the platform supports it, and
+// falls back to mapping the file into memory otherwise.
+void AddFile(evbuffer* output, const FileSlice& file) {
+  evbuffer_file_segment* segment =
+      evbuffer_file_segment_new(file.fd(), static_cast<ev_off_t>(file.offset()),
+                                static_cast<ev_off_t>(file.size()),
+                                /*flags=*/0);
+  if (segment == nullptr) {
+    throw RuntimeError("evbuffer_file_segment_new failed");
   }
-  auto chunk = std::make_unique<TcpResponseChunk>(std::move(data));
-  const void* d = chunk->chunk().data();
-  const auto size = chunk->chunk().size();
-  Check(evbuffer_add_reference(
-      buffer.get(), d, size,
-      /*cleanupfn=*/
-      [](const void* /*data*/, size_t /*datalen*/, void* extra) {
-        delete reinterpret_cast<TcpResponseChunk*>(extra);
+  auto segment_guard =
+      AtScopeExit([segment] { evbuffer_file_segment_free(segment); });
+  evbuffer_file_segment_add_cleanup_cb(
+      segment,
+      [](const evbuffer_file_segment*, int /*flags*/, void* extra) {
+        DeletePooled<FileSlice>(extra);
       },
-      /*cleanupfnarg=*/chunk.release()));
-  Check(bufferevent_write_buffer(bev, buffer.get()));
-  co_await WaitWrite(context);
+      NewPooled(file));
+  Check(evbuffer_add_file_segment(output, segment, /*offset=*/0,
+                                  static_cast<ev_off_t>(file.size())));
+}
+
+// Queues `data` on the connection's output. Small chunks are copied, so that
+// consecutive ones end up coalesced in a single write; large ones are
+// referenced and files are sent without being read into user space.
+Task<> Write(RequestContext* context, bufferevent* bev, TcpResponseChunk data,
+             uint32_t high_watermark, uint32_t low_watermark) {
+  evbuffer* output = bufferevent_get_output(bev);
+  std::span<const uint8_t> bytes = data.chunk();
+  if (const FileSlice* file = data.file()) {
+    AddFile(output, *file);
+  } else if (bytes.size() <= kMaxCopiedChunkSize) {
+    Check(evbuffer_add(output, bytes.data(), bytes.size()));
+  } else {
+    TcpResponseChunk* chunk = NewPooled(std::move(data));
+    bytes = chunk->chunk();
+    if (evbuffer_add_reference(
+            output, bytes.data(), bytes.size(),
+            /*cleanupfn=*/
+            [](const void* /*data*/, size_t /*datalen*/, void* extra) {
+              DeletePooled<TcpResponseChunk>(extra);
+            },
+            /*cleanupfnarg=*/chunk) != 0) {
+      DeletePooled<TcpResponseChunk>(chunk);
+      throw RuntimeError("evbuffer_add_reference failed");
+    }
+  }
+  if (evbuffer_get_length(output) > high_watermark) {
+    co_await Flush(context, bev, low_watermark);
+  }
 }
 
 void ReadCallback(struct bufferevent*, void* user_data) {
+  EventLoop::CallbackScope callback_scope;
   auto* context = reinterpret_cast<RequestContext*>(user_data);
   context->read_semaphore.SetValue();
 }
 
 void WriteCallback(struct bufferevent*, void* user_data) {
+  EventLoop::CallbackScope callback_scope;
   auto* context = reinterpret_cast<RequestContext*>(user_data);
   context->write_semaphore.SetValue();
 }
 
 void EventCallback(struct bufferevent*, short events, void* user_data) {
+  EventLoop::CallbackScope callback_scope;
   auto* context = reinterpret_cast<RequestContext*>(user_data);
-  if (events & (BEV_EVENT_ERROR | BEV_EVENT_EOF)) {
+  if (events & (BEV_EVENT_ERROR | BEV_EVENT_EOF | BEV_EVENT_TIMEOUT)) {
     context->stop_source.request_stop();
   }
 }
 
+// Responses are often written in several small chunks and request handlers
+// wait for them to drain, so Nagle's algorithm combined with delayed acks would
+// stall every exchange.
+void DisableNagle(evutil_socket_t fd) {
+  int enabled = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+             reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+bufferevent* CreateSocketBufferEvent(event_base* event_loop, evutil_socket_t fd,
+                                     void* ssl_context) {
+  if (ssl_context == nullptr) {
+    return bufferevent_socket_new(event_loop, fd, BEV_OPT_CLOSE_ON_FREE);
+  }
+#ifdef CORO_HTTP_HAVE_TLS
+  SSL* ssl = SSL_new(reinterpret_cast<SSL_CTX*>(ssl_context));
+  if (ssl == nullptr) {
+    return nullptr;
+  }
+  // Takes ownership of `ssl` even if it fails.
+  bufferevent* bev = bufferevent_openssl_socket_new(
+      event_loop, fd, ssl, BUFFEREVENT_SSL_ACCEPTING, BEV_OPT_CLOSE_ON_FREE);
+  if (bev != nullptr) {
+    // Plenty of clients close the connection without a close_notify alert
+    // once they have the whole response; that's a regular end of data.
+    bufferevent_openssl_set_allow_dirty_shutdown(bev, 1);
+  }
+  return bev;
+#else
+  return nullptr;
+#endif
+}
+
+// `ssl_context` is either null or an SSL_CTX to terminate TLS with.
 std::unique_ptr<bufferevent, BufferEventDeleter> CreateBufferEvent(
-    event_base* event_loop, evutil_socket_t fd, RequestContext* context) {
+    event_base* event_loop, evutil_socket_t fd, void* ssl_context,
+    RequestContext* context, uint32_t read_high_watermark,
+    uint32_t write_low_watermark) {
   std::unique_ptr<bufferevent, BufferEventDeleter> bev(
-      bufferevent_socket_new(event_loop, fd, BEV_OPT_CLOSE_ON_FREE));
+      CreateSocketBufferEvent(event_loop, fd, ssl_context));
   if (!bev) {
     throw RuntimeError("bufferevent_socket_new failed");
   }
-  bufferevent_setwatermark(bev.get(), EV_READ | EV_WRITE, /*lowmark=*/0,
-                           /*highmark=*/kMaxBufferSize);
+  DisableNagle(fd);
+  bufferevent_setwatermark(bev.get(), EV_READ, /*lowmark=*/0,
+                           /*highmark=*/read_high_watermark);
+  bufferevent_setwatermark(bev.get(), EV_WRITE, /*lowmark=*/write_low_watermark,
+                           /*highmark=*/0);
+  if (context->write_timeout) {
+    Check(bufferevent_set_timeouts(bev.get(), /*timeout_read=*/nullptr,
+                                   &*context->write_timeout));
+  }
   bufferevent_setcb(bev.get(), ReadCallback, WriteCallback, EventCallback,
                     context);
   Check(bufferevent_enable(bev.get(), EV_READ | EV_WRITE));
   return bev;
 }
 
-TcpRequestDataProvider GetRequestContent(struct bufferevent* bev,
-                                         RequestContext* context) {
-  return [bev, context](uint32_t byte_cnt) -> Task<std::vector<uint8_t>> {
-    if (byte_cnt != UINT32_MAX && byte_cnt > kMaxBufferSize) {
+class RequestContent {
+ public:
+  RequestContent(struct bufferevent* bev, RequestContext* context)
+      : bev_(bev), context_(context) {}
+
+  Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) {
+    if (min_byte_cnt > kMaxBufferSize) {
       throw InvalidArgument("requested too big request chunk");
     }
-    if (byte_cnt == 0) {
-      co_return std::vector<uint8_t>();
+    min_byte_cnt = std::max<uint32_t>(min_byte_cnt, 1);
+    struct evbuffer* input = bufferevent_get_input(bev_);
+    while (evbuffer_get_length(input) < min_byte_cnt) {
+      co_await WaitRead(context_, bev_);
     }
-    struct evbuffer* input = bufferevent_get_input(bev);
-    size_t size = evbuffer_get_length(input);
-    if (size == 0) {
-      co_await WaitRead(context);
-      size = evbuffer_get_length(input);
+    evbuffer_iovec chunk;
+    if (evbuffer_peek(input, -1, /*start_at=*/nullptr, &chunk, 1) < 1) {
+      throw RuntimeError("evbuffer_peek error");
     }
-    if (byte_cnt == UINT32_MAX) {
-      std::vector<uint8_t> data(size, 0);
-      if (evbuffer_remove(input, data.data(), size) != size) {
-        throw RuntimeError("evbuffer_remove error");
+    if (chunk.iov_len < min_byte_cnt) {
+      if (evbuffer_pullup(input, min_byte_cnt) == nullptr) {
+        throw RuntimeError("evbuffer_pullup error");
       }
-      co_return data;
+      evbuffer_peek(input, -1, /*start_at=*/nullptr, &chunk, 1);
     }
-    while (size < byte_cnt) {
-      co_await WaitRead(context);
-      size = evbuffer_get_length(input);
+    co_return std::span<const uint8_t>(
+        static_cast<const uint8_t*>(chunk.iov_base), chunk.iov_len);
+  }
+
+  void Consume(uint32_t byte_cnt) {
+    Check(evbuffer_drain(bufferevent_get_input(bev_), byte_cnt));
+  }
+
+  void SetReadDeadline(
+      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    context_->read_deadline = deadline;
+  }
+
+ private:
+  struct bufferevent* bev_;
+  RequestContext* context_;
+};
+
+std::string GetPeerAddress(const void* address) {
+  char buffer[INET6_ADDRSTRLEN] = {};
+  const auto* sockaddr = static_cast<const struct sockaddr*>(address);
+  if (sockaddr->sa_family == AF_INET) {
+    inet_ntop(AF_INET,
+              &reinterpret_cast<const struct sockaddr_in*>(sockaddr)->sin_addr,
+              buffer, sizeof(buffer));
+  } else if (sockaddr->sa_family == AF_INET6) {
+    inet_ntop(
+        AF_INET6,
+        &reinterpret_cast<const struct sockaddr_in6*>(sockaddr)->sin6_addr,
+        buffer, sizeof(buffer));
+  }
+  return buffer;
+}
+
+struct BufferEventConnection {
+  TcpRequestDataProvider GetRequestData() {
+    return TcpRequestDataProvider(RequestContent(bev, context),
+                                  context->peer_address);
+  }
+  Task<> Write(TcpResponseChunk chunk) {
+    return util::Write(context, bev, std::move(chunk), high_watermark,
+                       low_watermark);
+  }
+  Task<> Flush() { return util::Flush(context, bev, /*low_watermark=*/0); }
+
+  bufferevent* bev;
+  RequestContext* context;
+  uint32_t high_watermark;
+  uint32_t low_watermark;
+};
+
+#ifdef CORO_HTTP_HAVE_IO_URING
+
+std::string GetPeerAddress(int fd) {
+  sockaddr_storage address{};
+  socklen_t length = sizeof(address);
+  if (getpeername(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    return "";
+  }
+  return GetPeerAddress(static_cast<const void*>(&address));
+}
+
+class IoUringRequestContent {
+ public:
+  explicit IoUringRequestContent(IoUringSocket* socket) : socket_(socket) {}
+
+  Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) {
+    return socket_->Peek(min_byte_cnt);
+  }
+
+  void Consume(uint32_t byte_cnt) { socket_->Consume(byte_cnt); }
+
+  void SetReadDeadline(
+      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    socket_->SetReadDeadline(deadline);
+  }
+
+ private:
+  IoUringSocket* socket_;
+};
+
+struct IoUringConnection {
+  TcpRequestDataProvider GetRequestData() {
+    return TcpRequestDataProvider(IoUringRequestContent(socket),
+                                  context->peer_address);
+  }
+  Task<> Write(TcpResponseChunk chunk) {
+    socket->Write(std::move(chunk));
+    if (socket->pending_byte_count() > high_watermark) {
+      co_await socket->Flush(low_watermark);
     }
-    std::vector<uint8_t> data(byte_cnt, 0);
-    if (evbuffer_remove(input, data.data(), byte_cnt) !=
-        static_cast<int>(byte_cnt)) {
-      throw RuntimeError("evbuffer_remove error");
+  }
+  Task<> Flush() { return socket->Flush(); }
+
+  IoUringSocket* socket;
+  RequestContext* context;
+  uint32_t high_watermark;
+  uint32_t low_watermark;
+};
+
+#endif  // CORO_HTTP_HAVE_IO_URING
+
+// Runs the request handler for one request after another until the
+// connection ends, which surfaces as an exception. `Connection` provides
+// `TcpRequestDataProvider GetRequestData()`, `Task<> Write(TcpResponseChunk)`
+// and `Task<> Flush()`.
+template <typename Connection>
+Task<> ServeRequests(TcpRequestHandler& request_handler,
+                     Connection& connection, stdx::stop_token stop_token) {
+  while (true) {
+    auto response = request_handler(connection.GetRequestData(), stop_token);
+    std::exception_ptr exception;
+    try {
+      FOR_CO_AWAIT(TcpResponseChunk ctl, response) {
+        if (ctl.size() != 0) {
+          co_await connection.Write(std::move(ctl));
+        }
+      }
+    } catch (const Exception&) {
+      exception = std::current_exception();
     }
-    co_return data;
-  };
+    co_await connection.Flush();
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
 }
 
 }  // namespace
 
+struct TcpServer::ConnectionNode {
+  const std::string* peer_address;
+  // Null until the connection's buffers are set up.
+  bufferevent* bev = nullptr;
+#ifdef CORO_HTTP_HAVE_IO_URING
+  const IoUringSocket* socket = nullptr;
+#endif
+  ConnectionNode* previous = nullptr;
+  ConnectionNode* next = nullptr;
+
+  TcpConnectionMemoryStats GetMemoryStats() const {
+    TcpConnectionMemoryStats stats{.peer_address = *peer_address,
+                                   .input_bytes = 0,
+                                   .output_bytes = 0};
+    if (bev) {
+      stats.input_bytes = evbuffer_get_length(bufferevent_get_input(bev));
+      stats.output_bytes = evbuffer_get_length(bufferevent_get_output(bev));
+    }
+#ifdef CORO_HTTP_HAVE_IO_URING
+    if (socket) {
+      stats.input_bytes = socket->buffered_byte_count();
+      stats.output_bytes = socket->pending_byte_count();
+    }
+#endif
+    return stats;
+  }
+};
+
+Task<std::vector<uint8_t>> TcpRequestDataProvider::operator()(
+    uint32_t byte_cnt) {
+  if (byte_cnt == UINT32_MAX) {
+    std::span<const uint8_t> chunk = co_await Peek();
+    std::vector<uint8_t> data(chunk.begin(), chunk.end());
+    Consume(static_cast<uint32_t>(chunk.size()));
+    co_return data;
+  }
+  if (byte_cnt > kMaxBufferSize) {
+    throw InvalidArgument("requested too big request chunk");
+  }
+  std::vector<uint8_t> data;
+  data.reserve(byte_cnt);
+  while (data.size() < byte_cnt) {
+    auto remaining = static_cast<uint32_t>(byte_cnt - data.size());
+    std::span<const uint8_t> chunk = co_await Peek(remaining);
+    if (chunk.empty()) {
+      throw RuntimeError("unexpected end of request data");
+    }
+    chunk = chunk.first(std::min<size_t>(chunk.size(), remaining));
+    data.insert(data.end(), chunk.begin(), chunk.end());
+    Consume(static_cast<uint32_t>(chunk.size()));
+  }
+  co_return data;
+}
+
 Task<> DrainTcpDataProvider(TcpRequestDataProvider data_provider) {
-  while (!(co_await data_provider(UINT32_MAX)).empty()) {
+  while (true) {
+    std::span<const uint8_t> chunk = co_await data_provider.Peek();
+    if (chunk.empty()) {
+      break;
+    }
+    data_provider.Consume(static_cast<uint32_t>(chunk.size()));
   }
 }
 
@@ -155,8 +569,20 @@ std::span<const uint8_t> TcpResponseChunk::chunk() const {
   if (const auto* chunk = std::get_if<std::string>(&chunk_)) {
     return std::span<const uint8_t>(
         reinterpret_cast<const uint8_t*>(chunk->data()), chunk->size());
+  } else if (const auto* chunk = std::get_if<BufferSlice>(&chunk_)) {
+    return chunk->span();
+  } else if (const auto* chunk = std::get_if<std::vector<uint8_t>>(&chunk_)) {
+    return *chunk;
+  } else {
+    return {};
+  }
+}
+
+uint64_t TcpResponseChunk::size() const {
+  if (const FileSlice* file = this->file()) {
+    return file->size();
   } else {
-    return std::get<std::vector<uint8_t>>(chunk_);
+    return chunk().size();
   }
 }
 
@@ -165,14 +591,37 @@ void TcpServer::EvconnListenerDeleter::operator()(
   evconnlistener_free(reinterpret_cast<evconnlistener*>(listener));
 }
 
+void TcpServer::IoUringListenerDeleter::operator()(
+    [[maybe_unused]] IoUringListener* listener) const noexcept {
+#ifdef CORO_HTTP_HAVE_IO_URING
+  delete listener;
+#endif
+}
+
 TcpServer::TcpServer(TcpRequestHandler request_handler,
                      const EventLoop* event_loop, const Config& config)
     : request_handler_(std::move(request_handler)),
       event_loop_(event_loop),
-      listener_(CreateListener(config)) {}
+      write_high_watermark_(config.write_high_watermark),
+      write_low_watermark_(config.write_low_watermark),
+      read_high_watermark_(config.read_high_watermark),
+      read_timeout_ms_(config.read_timeout_ms),
+      write_timeout_ms_(config.write_timeout_ms),
+      max_connections_(config.max_connections),
+      tls_(config.tls),
+      io_uring_listener_(CreateIoUringListener(config)),
+      listener_(io_uring_listener_ ? nullptr : CreateListener(config)) {
+  if (write_low_watermark_ > write_high_watermark_) {
+    throw InvalidArgument("write_low_watermark above write_high_watermark");
+  }
+  if (read_high_watermark_ < kMaxBufferSize) {
+    throw InvalidArgument("read_high_watermark below kMaxBufferSize");
+  }
+}
 
 void TcpServer::OnQuit() {
   event_loop_->RunOnEventLoop([this] {
+    io_uring_listener_.reset();
     listener_.reset();
     quit_semaphore_.SetValue();
   });
@@ -193,12 +642,85 @@ Task<> TcpServer::Quit() {
 uint16_t TcpServer::GetPort() const {
   sockaddr_in addr;
   socklen_t length = sizeof(addr);
+#ifdef CORO_HTTP_HAVE_IO_URING
+  if (io_uring_listener_) {
+    Check(getsockname(io_uring_listener_->fd(),
+                      reinterpret_cast<sockaddr*>(&addr), &length));
+    return ntohs(addr.sin_port);
+  }
+#endif
   Check(getsockname(
       evconnlistener_get_fd(reinterpret_cast<evconnlistener*>(listener_.get())),
       reinterpret_cast<sockaddr*>(&addr), &length));
   return ntohs(addr.sin_port);
 }
 
+TcpServerMemoryStats TcpServer::GetMemoryStats() const {
+  TcpServerMemoryStats stats;
+  for (const ConnectionNode* node = connections_; node; node = node->next) {
+    TcpConnectionMemoryStats connection = node->GetMemoryStats();
+    stats.connection_count++;
+    stats.input_bytes += connection.input_bytes;
+    stats.output_bytes += connection.output_bytes;
+    stats.max_connection_bytes =
+        std::max(stats.max_connection_bytes,
+                 connection.input_bytes + connection.output_bytes);
+  }
+  return stats;
+}
+
+std::vector<TcpConnectionMemoryStats> TcpServer::GetConnectionMemoryStats()
+    const {
+  std::vector<TcpConnectionMemoryStats> stats;
+  for (const ConnectionNode* node = connections_; node; node = node->next) {
+    stats.push_back(node->GetMemoryStats());
+  }
+  return stats;
+}
+
+void TcpServer::OnConnectionOpened(ConnectionNode* node) {
+  node->next = connections_;
+  if (connections_) {
+    connections_->previous = node;
+  }
+  connections_ = node;
+  current_connections_++;
+  if (max_connections_ > 0 && current_connections_ >= max_connections_) {
+#ifdef CORO_HTTP_HAVE_IO_URING
+    if (io_uring_listener_) {
+      io_uring_listener_->Pause();
+      return;
+    }
+#endif
+    evconnlistener_disable(reinterpret_cast<evconnlistener*>(listener_.get()));
+  }
+}
+
+void TcpServer::OnConnectionClosed(ConnectionNode* node) {
+  if (node->previous) {
+    node->previous->next = node->next;
+  } else {
+    connections_ = node->next;
+  }
+  if (node->next) {
+    node->next->previous = node->previous;
+  }
+  current_connections_--;
+  if (quitting_ && current_connections_ == 0) {
+    OnQuit();
+  }
+  if (!quitting_ && max_connections_ > 0 &&
+      current_connections_ == max_connections_ - 1) {
+#ifdef CORO_HTTP_HAVE_IO_URING
+    if (io_uring_listener_) {
+      io_uring_listener_->Resume();
+      return;
+    }
+#endif
+    evconnlistener_enable(reinterpret_cast<evconnlistener*>(listener_.get()));
+  }
+}
+
 auto TcpServer::CreateListener(const Config& config)
     -> std::unique_ptr<EvconnListener, EvconnListenerDeleter> {
   union {
@@ -213,12 +735,15 @@ auto TcpServer::CreateListener(const Config& config)
       reinterpret_cast<event_base*>(GetEventLoop(*event_loop_)),
       [](struct evconnlistener* listener, evutil_socket_t socket,
          struct sockaddr* addr, int socklen, void* d) {
+        EventLoop::CallbackScope callback_scope;
         auto* context = reinterpret_cast<TcpServer*>(d);
         RunTask(context->ListenerCallback(
             reinterpret_cast<EvconnListener*>(listener), socket,
             static_cast<void*>(addr), socklen));
       },
-      this, LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE,
+      this,
+      LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE |
+          (config.reuse_port ? LEV_OPT_REUSEABLE_PORT : 0),
       /*backlog=*/-1, &d.sockaddr, sizeof(sockaddr_in));
   if (listener == nullptr) {
     throw RuntimeError("evconnlistener_new_bind error");
@@ -227,20 +752,38 @@ auto TcpServer::CreateListener(const Config& config)
       reinterpret_cast<EvconnListener*>(listener));
 }
 
+auto TcpServer::CreateIoUringListener([[maybe_unused]] const Config& config)
+    -> std::unique_ptr<IoUringListener, IoUringListenerDeleter> {
+#ifdef CORO_HTTP_HAVE_IO_URING
+  IoUring* io_uring = GetIoUring(*event_loop_);
+  if (io_uring == nullptr || config.tls) {
+    return nullptr;
+  }
+  return std::unique_ptr<IoUringListener, IoUringListenerDeleter>(
+      new IoUringListener(
+          io_uring, config.address, config.port, config.reuse_port,
+          [](void* user_data, int fd) {
+            RunTask(static_cast<TcpServer*>(user_data)->IoUringCallback(fd));
+          },
+          this));
+#else
+  return nullptr;
+#endif
+}
+
 Task<> TcpServer::ListenerCallback(struct EvconnListener*, evutil_socket_t fd,
-                                   void*, int socklen) noexcept {
-  RequestContext context{};
+                                   void* sockaddr, int /*socklen*/) noexcept {
+  // The address is only valid until the first suspension.
+  RequestContext context{.read_timeout = ToTimeval(read_timeout_ms_),
+                         .write_timeout = ToTimeval(write_timeout_ms_),
+                         .peer_address = GetPeerAddress(sockaddr)};
   try {
     if (quitting_) {
       co_return;
     }
-    current_connections_++;
-    auto scope_guard = AtScopeExit([&] {
-      current_connections_--;
-      if (quitting_ && current_connections_ == 0) {
-        OnQuit();
-      }
-    });
+    ConnectionNode node{.peer_address = &context.peer_address};
+    OnConnectionOpened(&node);
+    auto scope_guard = AtScopeExit([&] { OnConnectionClosed(&node); });
     stdx::stop_callback stop_callback1(
         stop_source_.get_token(), [&] { context.stop_source.request_stop(); });
     stdx::stop_callback stop_callback2(context.stop_source.get_token(), [&] {
@@ -251,22 +794,64 @@ Task<> TcpServer::ListenerCallback(struct EvconnListener*, evutil_socket_t fd,
     });
     auto bev = CreateBufferEvent(
         reinterpret_cast<event_base*>(GetEventLoop(*event_loop_)), fd,
-        &context);
-    while (true) {
-      auto response = request_handler_(GetRequestContent(bev.get(), &context),
-                                       context.stop_source.get_token());
-      FOR_CO_AWAIT(TcpResponseChunk ctl, response) {
-        if (!ctl.chunk().empty()) {
-          co_await Write(&context, bev.get(), std::move(ctl));
-        }
-      }
+        tls_ ? tls_->context_.get() : nullptr, &context, read_high_watermark_,
+        write_low_watermark_);
+    node.bev = bev.get();
+    auto node_guard = AtScopeExit([&] { node.bev = nullptr; });
+    // Wakes tasks which the request handler left waiting on the connection
+    // while the stop callbacks above are still registered.
+    auto stop_guard = AtScopeExit([&] { context.stop_source.request_stop(); });
+    BufferEventConnection connection{.bev = bev.get(),
+                                     .context = &context,
+                                     .high_watermark = write_high_watermark_,
+                                     .low_watermark = write_low_watermark_};
+    co_await ServeRequests(request_handler_, connection,
+                           context.stop_source.get_token());
+  } catch (const InterruptedException&) {
+    context.stop_source.request_stop();
+  } catch (const Exception& e) {
+    std::cerr << "[TCP_SERVER]: " << e.what() << '\n';
+    context.stop_source.request_stop();
+  }
+}
+
+Task<> TcpServer::IoUringCallback([[maybe_unused]] socket_t fd) noexcept {
+#ifdef CORO_HTTP_HAVE_IO_URING
+  RequestContext context{.peer_address = GetPeerAddress(fd)};
+  try {
+    if (quitting_) {
+      close(fd);
+      co_return;
     }
+    ConnectionNode node{.peer_address = &context.peer_address};
+    OnConnectionOpened(&node);
+    auto scope_guard = AtScopeExit([&] { OnConnectionClosed(&node); });
+    stdx::stop_callback stop_callback1(
+        stop_source_.get_token(), [&] { context.stop_source.request_stop(); });
+    DisableNagle(fd);
+    // Owns `fd` from here on.
+    IoUringSocket socket(GetIoUring(*event_loop_), fd, &context.stop_source,
+                         read_timeout_ms_, write_timeout_ms_);
+    node.socket = &socket;
+    auto node_guard = AtScopeExit([&] { node.socket = nullptr; });
+    stdx::stop_callback stop_callback2(context.stop_source.get_token(),
+                                       [&] { socket.Cancel(); });
+    auto stop_guard = AtScopeExit([&] { context.stop_source.request_stop(); });
+    IoUringConnection connection{.socket = &socket,
+                                 .context = &context,
+                                 .high_watermark = write_high_watermark_,
+                                 .low_watermark = write_low_watermark_};
+    co_await ServeRequests(request_handler_, connection,
+                           context.stop_source.get_token());
   } catch (const InterruptedException&) {
     context.stop_source.request_stop();
   } catch (const Exception& e) {
     std::cerr << "[TCP_SERVER]: " << e.what() << '\n';
     context.stop_source.request_stop();
   }
+#else
+  co_return;
+#endif
 }
 
 }  // namespace coro::util
\ No newline at end of file
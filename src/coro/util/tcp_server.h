@@ -1,41 +1,223 @@
 #ifndef CORO_UTIL_BASE_SERVER_H
 #define CORO_UTIL_BASE_SERVER_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 #include "coro/generator.h"
 #include "coro/promise.h"
 #include "coro/stdx/any_invocable.h"
 #include "coro/stdx/stop_token.h"
+#include "coro/util/buffer_slice.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/file_slice.h"
+#include "coro/util/tls_context.h"
 
 namespace coro::util {
 
+class IoUringListener;
+
 inline constexpr uint32_t kMaxBufferSize = 4 * 1024;
 
-using TcpRequestDataProvider =
-    stdx::any_invocable<Task<std::vector<uint8_t>>(uint32_t byte_cnt)>;
+// Source of request bytes received on a connection. `Impl` has to provide
+// `Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt)` and
+// `void Consume(uint32_t byte_cnt)`, see below, and may provide
+// `void SetReadDeadline(std::optional<std::chrono::steady_clock::time_point>)`.
+// A callable returning the next `byte_cnt` bytes, as
+// `Task<std::vector<uint8_t>>(uint32_t byte_cnt)`, is adapted as well.
+class TcpRequestDataProvider {
+ public:
+  TcpRequestDataProvider() = default;
+
+  // `peer_address` has to outlive the provider.
+  template <typename Impl>
+    requires(!std::is_same_v<Impl, TcpRequestDataProvider> &&
+             !std::is_invocable_v<Impl&, uint32_t>)
+  explicit TcpRequestDataProvider(Impl impl,
+                                  std::string_view peer_address = {})
+      : impl_(std::make_unique<Holder<Impl>>(std::move(impl))),
+        peer_address_(peer_address) {}
+
+  template <typename F>
+    requires(!std::is_same_v<F, TcpRequestDataProvider> &&
+             std::is_invocable_r_v<Task<std::vector<uint8_t>>, F&, uint32_t>)
+  TcpRequestDataProvider(F read, std::string_view peer_address = {})
+      : TcpRequestDataProvider(ReadAdapter<F>{.read = std::move(read)},
+                               peer_address) {}
+
+  // Waits until at least `min_byte_cnt` (at most kMaxBufferSize) bytes are
+  // readable and returns a view of contiguous readable bytes without copying
+  // them. The view is invalidated by the next call to Peek or Consume. At the
+  // end of data, in-memory providers return an empty view, while connection
+  // providers throw InterruptedException, as the connection is gone.
+  Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt = 1) {
+    return impl_->Peek(min_byte_cnt);
+  }
+
+  // Discards `byte_cnt` bytes from the front of the most recently peeked view.
+  void Consume(uint32_t byte_cnt) { impl_->Consume(byte_cnt); }
+
+  // Closes the connection if Peek is still waiting for bytes at `deadline`,
+  // however steadily they trickle in; unlike the read timeout, this bounds how
+  // long a whole read like that of a request's head takes. Cleared with
+  // nullopt. Ignored by providers which aren't reading from a connection.
+  void SetReadDeadline(
+      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    impl_->SetReadDeadline(deadline);
+  }
+
+  // Returns a copy of the next `byte_cnt` bytes, or of whatever is readable if
+  // `byte_cnt` is UINT32_MAX.
+  Task<std::vector<uint8_t>> operator()(uint32_t byte_cnt);
+
+  // IP address of the client, like "192.0.2.1", or empty if unknown.
+  std::string_view peer_address() const { return peer_address_; }
+
+ private:
+  struct Interface {
+    virtual ~Interface() = default;
+    virtual Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) = 0;
+    virtual void Consume(uint32_t byte_cnt) = 0;
+    virtual void SetReadDeadline(
+        std::optional<std::chrono::steady_clock::time_point> deadline) = 0;
+  };
+
+  template <typename Impl>
+  struct Holder : Interface {
+    explicit Holder(Impl impl) : impl(std::move(impl)) {}
+    Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) override {
+      return impl.Peek(min_byte_cnt);
+    }
+    void Consume(uint32_t byte_cnt) override { impl.Consume(byte_cnt); }
+    void SetReadDeadline(std::optional<std::chrono::steady_clock::time_point>
+                             deadline) override {
+      if constexpr (requires { impl.SetReadDeadline(deadline); }) {
+        impl.SetReadDeadline(deadline);
+      }
+    }
+    Impl impl;
+  };
+
+  // Buffers what `read` returns; it's asked for exactly the missing bytes, as
+  // it may wait for all of them.
+  template <typename F>
+  struct ReadAdapter {
+    Task<std::span<const uint8_t>> Peek(uint32_t min_byte_cnt) {
+      min_byte_cnt = std::max<uint32_t>(min_byte_cnt, 1);
+      if (buffer.size() - offset < min_byte_cnt) {
+        buffer.erase(buffer.begin(),
+                     buffer.begin() + static_cast<std::ptrdiff_t>(offset));
+        offset = 0;
+        while (buffer.size() < min_byte_cnt) {
+          std::vector<uint8_t> data = co_await read(
+              static_cast<uint32_t>(min_byte_cnt - buffer.size()));
+          if (data.empty()) {
+            break;
+          }
+          buffer.insert(buffer.end(), data.begin(), data.end());
+        }
+      }
+      co_return std::span<const uint8_t>(buffer).subspan(offset);
+    }
+    void Consume(uint32_t byte_cnt) { offset += byte_cnt; }
+
+    F read;
+    std::vector<uint8_t> buffer;
+    size_t offset = 0;
+  };
+
+  std::unique_ptr<Interface> impl_;
+  std::string_view peer_address_;
+};
 
 class TcpResponseChunk {
  public:
   TcpResponseChunk(std::vector<uint8_t> chunk) : chunk_(std::move(chunk)) {}
   TcpResponseChunk(std::string chunk) : chunk_(std::move(chunk)) {}
+  // Large slices are queued on the connection by reference, without copying.
+  TcpResponseChunk(BufferSlice chunk) : chunk_(std::move(chunk)) {}
+  // Sent from the file by the kernel, see FileSlice.
+  TcpResponseChunk(FileSlice chunk) : chunk_(std::move(chunk)) {}
 
+  // Bytes of an in-memory chunk; empty for a file chunk.
   std::span<const uint8_t> chunk() const;
+  // Null unless the chunk is backed by a file.
+  const FileSlice* file() const { return std::get_if<FileSlice>(&chunk_); }
+  uint64_t size() const;
 
  private:
-  std::variant<std::vector<uint8_t>, std::string> chunk_;
+  std::variant<std::vector<uint8_t>, std::string, BufferSlice, FileSlice>
+      chunk_;
 };
 
+// Called again for the next request once its response is sent. Throwing
+// InterruptedException closes the connection after the chunks yielded so far
+// are flushed.
 using TcpRequestHandler = stdx::any_invocable<Generator<TcpResponseChunk>(
     TcpRequestDataProvider, stdx::stop_token)>;
 
+// Bytes buffered for an open connection of a TcpServer.
+struct TcpConnectionMemoryStats {
+  std::string peer_address;
+  // Received bytes which the request handler hasn't consumed yet.
+  uint64_t input_bytes;
+  // Response bytes queued but not sent yet, including those of referenced
+  // chunks and files, which aren't copied.
+  uint64_t output_bytes;
+};
+
+struct TcpServerMemoryStats {
+  int connection_count = 0;
+  uint64_t input_bytes = 0;
+  uint64_t output_bytes = 0;
+  // Most bytes buffered for a single connection.
+  uint64_t max_connection_bytes = 0;
+};
+
 class TcpServer {
  public:
   struct Config {
     std::string address;
     uint16_t port;
+    // Response chunks are queued on the connection until this many bytes are
+    // pending, only then the writer waits for the output to drain down to
+    // `write_low_watermark`.
+    uint32_t write_high_watermark = 64 * 1024;
+    // A low watermark above 0 lets the handler produce the next chunks while
+    // the rest of the output is still being sent. At most
+    // `write_high_watermark`.
+    uint32_t write_low_watermark = 0;
+    // Reading from the socket pauses once this many received bytes aren't
+    // consumed by the request handler, which bounds the input buffered per
+    // connection. At least kMaxBufferSize.
+    uint32_t read_high_watermark = kMaxBufferSize;
+    // Sets SO_REUSEPORT on the listening socket, so that several servers can
+    // accept connections on the same port.
+    bool reuse_port = false;
+    // A connection is closed once a read has waited this long for request
+    // bytes, which bounds both idle kept-alive connections and clients
+    // trickling a request in. 0 disables the timeout.
+    int read_timeout_ms = 0;
+    // A connection is closed once the client hasn't taken any pending
+    // response bytes for this long. 0 disables the timeout.
+    int write_timeout_ms = 0;
+    // Accepting is paused while this many connections are open, so further
+    // clients wait in the listen backlog. 0 means no limit.
+    int max_connections = 0;
+    // Connections are TLS-encrypted with this context; the handshake happens
+    // before the request handler sees any bytes. Null serves plain TCP.
+    // Plain TCP servers on an EventLoop with IoBackend::kIoUring do their
+    // socket I/O through io_uring.
+    std::shared_ptr<const TlsContext> tls;
   };
 
   TcpServer(TcpRequestHandler request_handler, const EventLoop* event_loop,
@@ -48,15 +230,25 @@ class TcpServer {
   TcpServer& operator=(TcpServer&&) = delete;
 
   uint16_t GetPort() const;
+  int GetConnectionCount() const { return current_connections_; }
+  // Have to be called on the event loop's thread.
+  TcpServerMemoryStats GetMemoryStats() const;
+  std::vector<TcpConnectionMemoryStats> GetConnectionMemoryStats() const;
   Task<> Quit();
 
  private:
   struct EvconnListener;
+  // Entry of an open connection in `connections_`.
+  struct ConnectionNode;
 
   struct EvconnListenerDeleter {
     void operator()(EvconnListener* listener) const noexcept;
   };
 
+  struct IoUringListenerDeleter {
+    void operator()(IoUringListener* listener) const noexcept;
+  };
+
 #ifdef _WIN32
   using socket_t = intptr_t;
 #else
@@ -65,16 +257,32 @@ class TcpServer {
 
   std::unique_ptr<EvconnListener, EvconnListenerDeleter> CreateListener(
       const Config& config);
+  // Null unless the event loop has an io_uring and the server is plain TCP.
+  std::unique_ptr<IoUringListener, IoUringListenerDeleter>
+  CreateIoUringListener(const Config& config);
   Task<> ListenerCallback(EvconnListener*, socket_t fd, void* sockaddr,
                           int socklen) noexcept;
+  Task<> IoUringCallback(socket_t fd) noexcept;
+  // Pause accepting while there are max_connections_ connections.
+  void OnConnectionOpened(ConnectionNode*);
+  void OnConnectionClosed(ConnectionNode*);
   void OnQuit();
 
   TcpRequestHandler request_handler_;
   const coro::util::EventLoop* event_loop_;
+  uint32_t write_high_watermark_;
+  uint32_t write_low_watermark_;
+  uint32_t read_high_watermark_;
+  int read_timeout_ms_;
+  int write_timeout_ms_;
+  int max_connections_;
+  std::shared_ptr<const TlsContext> tls_;
   bool quitting_ = false;
   int current_connections_ = 0;
+  ConnectionNode* connections_ = nullptr;
   stdx::stop_source stop_source_;
   Promise<void> quit_semaphore_;
+  std::unique_ptr<IoUringListener, IoUringListenerDeleter> io_uring_listener_;
   std::unique_ptr<EvconnListener, EvconnListenerDeleter> listener_;
 };
 
@@ -82,4 +290,4 @@ Task<> DrainTcpDataProvider(TcpRequestDataProvider);
 
 }  // namespace coro::util
 
-#endif  // CORO_UTIL_BASE_SERVER_H
\ No newline at end of file
+#endif  // CORO_UTIL_BASE_SERVER_H
\ No newline at end of file
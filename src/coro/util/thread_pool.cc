@@ -9,10 +9,12 @@
 #define _GNU_SOURCE
 #endif
 #include <pthread.h>
+#include <sched.h>
 #elif defined(__APPLE__)
 #include <pthread.h>
 #endif
 
+#include <algorithm>
 #include <string>
 
 namespace coro::util {
@@ -54,6 +56,21 @@ void SetThreadNameImpl(const std::string& name) {
 #endif
 }
 
+void PinThread(unsigned int cpu) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu % CPU_SETSIZE, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#elif defined(_WIN32)
+  SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (cpu % 64));
+#endif
+}
+
+// Identifies the pool and queue of the current worker thread.
+thread_local const void* current_thread_pool = nullptr;
+thread_local size_t current_queue_index = 0;
+
 int GetDigitCount(unsigned int d) {
   int result = 0;
   while (d > 0) {
@@ -81,12 +98,27 @@ void SetThreadName(std::string_view name) {
 
 ThreadPool::ThreadPool(const EventLoop* event_loop, unsigned int thread_count,
                        std::string name)
-    : event_loop_(event_loop), name_(std::move(name)) {
+    : ThreadPool(event_loop,
+                 Config{.thread_count = thread_count, .name = std::move(name)}) {
+}
+
+ThreadPool::ThreadPool(const EventLoop* event_loop, Config config)
+    : event_loop_(event_loop), name_(std::move(config.name)) {
+  const unsigned int thread_count = std::max(config.thread_count, 1u);
+  const unsigned int cpu_count = std::max(std::thread::hardware_concurrency(), 1u);
   const int cnt = GetDigitCount(thread_count);
   for (unsigned int i = 0; i < thread_count; i++) {
-    threads_.emplace_back([&, i, cnt] {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads_.emplace_back([&, i, cnt, cpu_count, pin = config.pin_threads] {
       SetThreadName(name_ + "-" + PadValue(i, cnt));
-      Work();
+      if (pin) {
+        PinThread(i % cpu_count);
+      }
+      current_thread_pool = this;
+      current_queue_index = i;
+      Work(i);
     });
   }
 }
@@ -102,20 +134,103 @@ ThreadPool::~ThreadPool() {
   }
 }
 
-void ThreadPool::Work() {
+void ThreadPool::Work(size_t index) {
   while (true) {
+    if (ThreadLoopAwaiter* awaiter = Pop(index)) {
+      awaiter->continuation.resume();
+      continue;
+    }
     std::unique_lock lock(mutex_);
-    condition_variable_.wait(lock, [&] { return !tasks_.empty() || quit_; });
-    if (quit_ && tasks_.empty()) {
+    sleeping_count_++;
+    condition_variable_.wait(lock,
+                             [&] { return pending_count_ > 0 || quit_; });
+    sleeping_count_--;
+    if (quit_ && pending_count_ == 0) {
       break;
     }
-    auto coroutine = tasks_.back();
-    tasks_.pop_back();
-    lock.unlock();
-    coroutine.resume();
   }
 }
 
+void ThreadPool::Schedule(ThreadLoopAwaiter* awaiter) {
+  // Work submitted from a worker stays on its queue; everything else is
+  // spread round-robin.
+  size_t index = current_thread_pool == this
+                     ? current_queue_index
+                     : next_queue_++ % queues_.size();
+  Queue& queue = *queues_[index];
+  {
+    std::unique_lock lock(queue.mutex);
+    awaiter->queue = &queue;
+    awaiter->queued = true;
+    awaiter->prev = queue.tail;
+    awaiter->next = nullptr;
+    if (queue.tail) {
+      queue.tail->next = awaiter;
+    } else {
+      queue.head = awaiter;
+    }
+    queue.tail = awaiter;
+    pending_count_++;
+  }
+  // Pairs with the increment of sleeping_count_ in Work: either the worker
+  // sees the pending task or it is counted as sleeping here.
+  if (sleeping_count_ > 0) {
+    { std::unique_lock lock(mutex_); }
+    condition_variable_.notify_one();
+  }
+}
+
+bool ThreadPool::Cancel(ThreadLoopAwaiter* awaiter) {
+  Queue* queue = awaiter->queue;
+  if (!queue) {
+    return false;
+  }
+  std::unique_lock lock(queue->mutex);
+  if (!awaiter->queued) {
+    return false;
+  }
+  if (awaiter->prev) {
+    awaiter->prev->next = awaiter->next;
+  } else {
+    queue->head = awaiter->next;
+  }
+  if (awaiter->next) {
+    awaiter->next->prev = awaiter->prev;
+  } else {
+    queue->tail = awaiter->prev;
+  }
+  awaiter->queued = false;
+  pending_count_--;
+  return true;
+}
+
+auto ThreadPool::Pop(size_t index) -> ThreadLoopAwaiter* {
+  for (size_t i = 0; i < queues_.size(); i++) {
+    if (ThreadLoopAwaiter* awaiter =
+            PopFront(*queues_[(index + i) % queues_.size()])) {
+      return awaiter;
+    }
+  }
+  return nullptr;
+}
+
+auto ThreadPool::PopFront(Queue& queue) -> ThreadLoopAwaiter* {
+  std::unique_lock lock(queue.mutex);
+  ThreadLoopAwaiter* awaiter = queue.head;
+  if (!awaiter) {
+    return nullptr;
+  }
+  queue.head = awaiter->next;
+  if (queue.head) {
+    queue.head->prev = nullptr;
+  } else {
+    queue.tail = nullptr;
+  }
+  awaiter->queued = false;
+  pending_count_--;
+  return awaiter;
+}
+
 Task<> ThreadPool::SwitchToEventLoop() {
   struct Awaiter {
     bool await_ready() const { return false; }
@@ -1,8 +1,11 @@
 #ifndef CORO_UTIL_THREAD_POOL_H
 #define CORO_UTIL_THREAD_POOL_H
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <type_traits>
 #include <vector>
@@ -16,8 +19,18 @@ namespace coro::util {
 
 void SetThreadName(std::string_view thread_name);
 
+// Runs functions on a pool of worker threads. Each worker owns a FIFO queue;
+// idle workers steal from the other queues before going to sleep.
 class ThreadPool {
  public:
+  struct Config {
+    unsigned int thread_count = std::thread::hardware_concurrency();
+    std::string name = "coro-tpool";
+    // Pins the i-th worker to the i-th CPU.
+    bool pin_threads = false;
+  };
+
+  ThreadPool(const EventLoop* event_loop, Config config);
   explicit ThreadPool(
       const EventLoop* event_loop,
       unsigned int thread_count = std::thread::hardware_concurrency(),
@@ -35,14 +48,9 @@ class ThreadPool {
   template <typename Func, typename... Args>
   TaskT<util::ReturnTypeT<Func>> Do(stdx::stop_token stop_token, Func&& func,
                                     Args&&... args) {
-    ThreadLoopAwaiter awaiter{this, stdx::coroutine_handle<void>(), false};
+    ThreadLoopAwaiter awaiter{.thread_pool = this};
     stdx::stop_callback cb(std::move(stop_token), [&] {
-      std::unique_lock lock(mutex_);
-      if (auto it =
-              std::find(tasks_.begin(), tasks_.end(), awaiter.continuation);
-          it != tasks_.end()) {
-        tasks_.erase(it);
-        lock.unlock();
+      if (Cancel(&awaiter)) {
         awaiter.interrupted = true;
         awaiter.continuation.resume();
       }
@@ -72,8 +80,7 @@ class ThreadPool {
   }
 
  private:
-  void Work();
-  Task<> SwitchToEventLoop();
+  struct Queue;
 
   struct ThreadLoopAwaiter {
     bool await_ready() const { return false; }
@@ -83,18 +90,37 @@ class ThreadPool {
       }
     }
     void await_suspend(stdx::coroutine_handle<void> handle) {
-      std::unique_lock lock(thread_pool->mutex_);
       continuation = handle;
-      thread_pool->tasks_.emplace_back(handle);
-      thread_pool->condition_variable_.notify_one();
+      thread_pool->Schedule(this);
     }
     ThreadPool* thread_pool;
     stdx::coroutine_handle<void> continuation;
-    bool interrupted;
+    bool interrupted = false;
+    // Intrusive links of the queue the awaiter waits in, guarded by its mutex.
+    std::atomic<Queue*> queue = nullptr;
+    ThreadLoopAwaiter* prev = nullptr;
+    ThreadLoopAwaiter* next = nullptr;
+    bool queued = false;
   };
 
-  std::vector<stdx::coroutine_handle<void>> tasks_;
+  struct Queue {
+    std::mutex mutex;
+    ThreadLoopAwaiter* head = nullptr;
+    ThreadLoopAwaiter* tail = nullptr;
+  };
+
+  void Work(size_t index);
+  void Schedule(ThreadLoopAwaiter* awaiter);
+  bool Cancel(ThreadLoopAwaiter* awaiter);
+  ThreadLoopAwaiter* Pop(size_t index);
+  ThreadLoopAwaiter* PopFront(Queue& queue);
+  Task<> SwitchToEventLoop();
+
+  std::vector<std::unique_ptr<Queue>> queues_;
   std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_ = 0;
+  std::atomic<size_t> pending_count_ = 0;
+  std::atomic<size_t> sleeping_count_ = 0;
   bool quit_ = false;
   std::condition_variable condition_variable_;
   std::mutex mutex_;
@@ -0,0 +1,157 @@
+#include "coro/util/timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace coro::util {
+
+namespace {
+
+constexpr uint64_t kSlotMask = TimerWheel::kSlotCount - 1;
+// Timers further out are kept at the top level's furthest slot and moved
+// down again once it's reached.
+constexpr uint64_t kMaxDelta =
+    (uint64_t(1) << (TimerWheel::kLevels * TimerWheel::kSlotBits)) - 1;
+
+constexpr int Shift(int level) { return level * TimerWheel::kSlotBits; }
+
+}  // namespace
+
+TimerWheel::TimerWheel(uint64_t now) : now_(now) {}
+
+void TimerWheel::Unlink(Link* link) {
+  link->prev_->next_ = link->next_;
+  link->next_->prev_ = link->prev_;
+  link->prev_ = link->next_ = link;
+}
+
+void TimerWheel::PushBack(Link* list, Link* link) {
+  link->prev_ = list->prev_;
+  link->next_ = list;
+  list->prev_->next_ = link;
+  list->prev_ = link;
+}
+
+void TimerWheel::Arm(Timer* timer, uint64_t deadline,
+                     void (*on_expired)(void*), void* data) {
+  timer->deadline_ = deadline;
+  timer->on_expired_ = on_expired;
+  timer->data_ = data;
+  Place(timer);
+  size_++;
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  if (!timer->armed()) {
+    return;
+  }
+  Unlink(timer);
+  if (timer->slot_ >= 0) {
+    if (slots_[timer->slot_].next_ == &slots_[timer->slot_]) {
+      occupied_slots_[timer->slot_ / kSlotCount] &=
+          ~(uint64_t(1) << (timer->slot_ % kSlotCount));
+    }
+  }
+  timer->slot_ = Timer::kUnarmed;
+  size_--;
+}
+
+// A timer on level L is due within [64^L, 64^(L+1)) ticks from now_ and is
+// kept in the slot of the 64^L-tick period its deadline falls into. Those
+// periods are at most 64 ahead, so each maps to a distinct slot.
+void TimerWheel::Place(Timer* timer) {
+  if (timer->deadline_ <= now_) {
+    timer->slot_ = Timer::kExpired;
+    PushBack(&expired_, timer);
+    return;
+  }
+  uint64_t delta = std::min(timer->deadline_ - now_, kMaxDelta);
+  int level = (std::bit_width(delta) - 1) / kSlotBits;
+  uint64_t slot = ((now_ + delta) >> Shift(level)) & kSlotMask;
+  timer->slot_ = level * kSlotCount + static_cast<int>(slot);
+  occupied_slots_[level] |= uint64_t(1) << slot;
+  PushBack(&slots_[timer->slot_], timer);
+}
+
+void TimerWheel::TakeSlot(int slot, Link* list) {
+  Link* head = &slots_[slot];
+  while (head->next_ != head) {
+    auto* timer = static_cast<Timer*>(head->next_);
+    Unlink(timer);
+    timer->slot_ = Timer::kExpired;
+    PushBack(list, timer);
+  }
+  occupied_slots_[slot / kSlotCount] &= ~(uint64_t(1) << (slot % kSlotCount));
+}
+
+std::optional<uint64_t> TimerWheel::GetNextTick() const {
+  if (expired_.next_ != &expired_) {
+    return now_;
+  }
+  std::optional<uint64_t> next_tick;
+  for (int level = 0; level < kLevels; level++) {
+    if (occupied_slots_[level] == 0) {
+      continue;
+    }
+    // Slots are searched starting from the period after the current one.
+    uint64_t period = (now_ >> Shift(level)) + 1;
+    int offset = std::countr_zero(std::rotr(
+        occupied_slots_[level], static_cast<int>(period & kSlotMask)));
+    uint64_t tick = (period + offset) << Shift(level);
+    if (!next_tick || tick < *next_tick) {
+      next_tick = tick;
+    }
+  }
+  return next_tick;
+}
+
+void TimerWheel::Advance(uint64_t now) {
+  Link due;
+  while (expired_.next_ != &expired_) {
+    Link* timer = expired_.next_;
+    Unlink(timer);
+    PushBack(&due, timer);
+  }
+  while (true) {
+    std::optional<uint64_t> next_tick = GetNextTick();
+    if (!next_tick || *next_tick > now) {
+      break;
+    }
+    now_ = *next_tick;
+    // Higher levels first; their timers end up on lower levels or due.
+    for (int level = kLevels - 1; level > 0; level--) {
+      if ((now_ & ((uint64_t(1) << Shift(level)) - 1)) != 0) {
+        continue;
+      }
+      uint64_t slot = (now_ >> Shift(level)) & kSlotMask;
+      if ((occupied_slots_[level] & (uint64_t(1) << slot)) == 0) {
+        continue;
+      }
+      Link cascaded;
+      TakeSlot(level * kSlotCount + static_cast<int>(slot), &cascaded);
+      while (cascaded.next_ != &cascaded) {
+        auto* timer = static_cast<Timer*>(cascaded.next_);
+        Unlink(timer);
+        if (timer->deadline_ <= now_) {
+          PushBack(&due, timer);
+        } else {
+          Place(timer);
+        }
+      }
+    }
+    uint64_t slot = now_ & kSlotMask;
+    if (occupied_slots_[0] & (uint64_t(1) << slot)) {
+      TakeSlot(static_cast<int>(slot), &due);
+    }
+  }
+  now_ = std::max(now_, now);
+  while (due.next_ != &due) {
+    auto* timer = static_cast<Timer*>(due.next_);
+    Unlink(timer);
+    timer->slot_ = Timer::kUnarmed;
+    size_--;
+    timer->on_expired_(timer->data_);
+  }
+}
+
+}  // namespace coro::util
@@ -0,0 +1,104 @@
+#ifndef CORO_UTIL_TIMER_WHEEL_H
+#define CORO_UTIL_TIMER_WHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace coro::util {
+
+// Hierarchical timer wheel. Timers are intrusive, so arming and cancelling
+// one takes constant time and never allocates, and a single system timer set
+// to GetNextTick() can drive any number of them. Time is measured in ticks of
+// the caller's choosing, e.g. milliseconds; each of the kLevels wheels has
+// kSlotCount slots, a slot of a level spanning all of the level below.
+//
+// Not thread-safe.
+class TimerWheel {
+ public:
+  static constexpr int kLevels = 6;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlotCount = 1 << kSlotBits;
+
+  class Timer;
+
+  // Links of the circular, doubly-linked lists which slots keep timers in.
+  class Link {
+   private:
+    friend class TimerWheel;
+
+    Link* prev_ = this;
+    Link* next_ = this;
+  };
+
+  class Timer : private Link {
+   public:
+    Timer() = default;
+
+    Timer(const Timer&) = delete;
+    Timer(Timer&&) = delete;
+
+    Timer& operator=(const Timer&) = delete;
+    Timer& operator=(Timer&&) = delete;
+
+    bool armed() const { return slot_ != kUnarmed; }
+
+   private:
+    friend class TimerWheel;
+
+    static constexpr int kUnarmed = -1;
+    static constexpr int kExpired = -2;
+
+    uint64_t deadline_ = 0;
+    // Index into TimerWheel::slots_, kExpired once the timer is due.
+    int slot_ = kUnarmed;
+    void (*on_expired_)(void*) = nullptr;
+    void* data_ = nullptr;
+  };
+
+  explicit TimerWheel(uint64_t now);
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+
+  // Makes Advance call `on_expired(data)` once it reaches `deadline`. A timer
+  // whose deadline has already passed expires on the next Advance. `timer`
+  // mustn't be armed and has to stay alive until it expires or is cancelled.
+  void Arm(Timer* timer, uint64_t deadline, void (*on_expired)(void*),
+           void* data);
+  // No-op if `timer` isn't armed.
+  void Cancel(Timer* timer);
+
+  // Expires the timers due at `now`. Those run in the order of their
+  // deadlines and may arm and cancel timers, including each other; timers
+  // armed meanwhile run on the next Advance at the earliest.
+  void Advance(uint64_t now);
+
+  // Tick at which Advance has to be called next, which may precede the
+  // earliest deadline when timers have to be moved between levels. Empty if
+  // no timer is armed.
+  std::optional<uint64_t> GetNextTick() const;
+
+  size_t size() const { return size_; }
+
+ private:
+  static void Unlink(Link* link);
+  static void PushBack(Link* list, Link* link);
+  // Moves the timers of `slot` to `list`, marking them as expired.
+  void TakeSlot(int slot, Link* list);
+  void Place(Timer* timer);
+
+  uint64_t now_;
+  size_t size_ = 0;
+  std::array<uint64_t, kLevels> occupied_slots_{};
+  std::array<Link, kLevels * kSlotCount> slots_;
+  Link expired_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_TIMER_WHEEL_H
@@ -0,0 +1,139 @@
+#include "coro/util/tls_context.h"
+
+#ifdef CORO_HTTP_HAVE_TLS
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#endif
+
+#include "coro/exception.h"
+
+namespace coro::util {
+
+namespace {
+
+constexpr size_t kSessionTicketKeySize = 80;
+
+#ifdef CORO_HTTP_HAVE_TLS
+
+std::string GetOpenSslError() {
+  char buffer[256];
+  ERR_error_string_n(ERR_get_error(), buffer, sizeof(buffer));
+  return buffer;
+}
+
+std::string ToAlpnProtocolList(const std::vector<std::string>& protocols) {
+  std::string list;
+  for (const std::string& protocol : protocols) {
+    if (protocol.empty() || protocol.size() > 255) {
+      throw InvalidArgument("invalid ALPN protocol " + protocol);
+    }
+    list += static_cast<char>(protocol.size());
+    list += protocol;
+  }
+  return list;
+}
+
+// Picks the first of the server's protocols which the client offers. Without a
+// common protocol the handshake carries on without ALPN.
+int SelectAlpnProtocol(SSL*, const unsigned char** out, unsigned char* outlen,
+                       const unsigned char* in, unsigned int inlen,
+                       void* arg) {
+  const auto* protocols = static_cast<const std::string*>(arg);
+  if (SSL_select_next_proto(
+          const_cast<unsigned char**>(out), outlen,
+          reinterpret_cast<const unsigned char*>(protocols->data()),
+          static_cast<unsigned int>(protocols->size()), in,
+          inlen) != OPENSSL_NPN_NEGOTIATED) {
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+  return SSL_TLSEXT_ERR_OK;
+}
+
+#endif
+
+}  // namespace
+
+void TlsContext::SslContextDeleter::operator()(
+    SslContext* context) const noexcept {
+#ifdef CORO_HTTP_HAVE_TLS
+  SSL_CTX_free(reinterpret_cast<SSL_CTX*>(context));
+#else
+  (void)context;
+#endif
+}
+
+bool TlsContext::IsSupported() {
+#ifdef CORO_HTTP_HAVE_TLS
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef CORO_HTTP_HAVE_TLS
+
+TlsContext::TlsContext(const Config& config)
+    : alpn_protocols_(ToAlpnProtocolList(config.alpn_protocols)) {
+  if (!config.session_ticket_key.empty() &&
+      config.session_ticket_key.size() != kSessionTicketKeySize) {
+    throw InvalidArgument("session_ticket_key must be 80 bytes long");
+  }
+  SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+  if (context == nullptr) {
+    throw RuntimeError("SSL_CTX_new failed: " + GetOpenSslError());
+  }
+  context_.reset(reinterpret_cast<SslContext*>(context));
+  SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+  SSL_CTX_set_options(context, SSL_OP_NO_RENEGOTIATION |
+                                   SSL_OP_CIPHER_SERVER_PREFERENCE);
+  // Libevent may retry a write with a different buffer once the previous
+  // attempt would have blocked. Buffers of idle connections are released.
+  SSL_CTX_set_mode(context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                SSL_MODE_RELEASE_BUFFERS);
+  if (SSL_CTX_use_certificate_chain_file(
+          context, config.certificate_chain_path.c_str()) != 1) {
+    throw RuntimeError("can't load " + config.certificate_chain_path + ": " +
+                       GetOpenSslError());
+  }
+  if (SSL_CTX_use_PrivateKey_file(context, config.private_key_path.c_str(),
+                                  SSL_FILETYPE_PEM) != 1 ||
+      SSL_CTX_check_private_key(context) != 1) {
+    throw RuntimeError("can't load " + config.private_key_path + ": " +
+                       GetOpenSslError());
+  }
+  // Sessions are resumed from tickets, which keeps resumption working across
+  // the threads of a multi-threaded server and doesn't need a shared cache.
+  SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+  constexpr std::string_view kSessionIdContext = "coro-http";
+  SSL_CTX_set_session_id_context(
+      context, reinterpret_cast<const unsigned char*>(kSessionIdContext.data()),
+      static_cast<unsigned int>(kSessionIdContext.size()));
+  std::string ticket_key = config.session_ticket_key;
+  if (ticket_key.empty()) {
+    ticket_key.resize(kSessionTicketKeySize);
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(ticket_key.data()),
+                   static_cast<int>(ticket_key.size())) != 1) {
+      throw RuntimeError("RAND_bytes failed: " + GetOpenSslError());
+    }
+  }
+  if (SSL_CTX_set_tlsext_ticket_keys(context, ticket_key.data(),
+                                     static_cast<long>(ticket_key.size())) !=
+      1) {
+    throw RuntimeError("can't set session ticket key: " + GetOpenSslError());
+  }
+  if (!alpn_protocols_.empty()) {
+    SSL_CTX_set_alpn_select_cb(context, SelectAlpnProtocol, &alpn_protocols_);
+  }
+}
+
+#else
+
+TlsContext::TlsContext(const Config&) {
+  throw InvalidArgument("coro-http was built without TLS support.");
+}
+
+#endif
+
+}  // namespace coro::util
@@ -0,0 +1,60 @@
+#ifndef CORO_UTIL_TLS_CONTEXT_H
+#define CORO_UTIL_TLS_CONTEXT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace coro::util {
+
+// Certificate, key and session state of TLS servers. A TcpServer given a
+// TlsContext terminates TLS itself. Contexts are immutable once created and
+// may be shared by servers running on different threads, which then resume
+// each other's sessions.
+class TlsContext {
+ public:
+  struct Config {
+    // PEM file with the server certificate followed by its intermediates.
+    std::string certificate_chain_path;
+    // PEM file with the private key of the certificate.
+    std::string private_key_path;
+    // Protocols offered through ALPN, the preferred ones first, e.g. "h2" and
+    // "http/1.1". Clients which don't use ALPN are served regardless; offer
+    // "h2" only to an HTTP server with HTTP/2 enabled.
+    std::vector<std::string> alpn_protocols;
+    // 80 bytes protecting session tickets. Servers configured with the same
+    // key resume each other's sessions, also across processes and hosts. If
+    // empty, a random key is generated for this context.
+    std::string session_ticket_key;
+  };
+
+  // Throws RuntimeError if the certificate or the key can't be loaded and
+  // InvalidArgument if the library was built without TLS support.
+  explicit TlsContext(const Config& config);
+
+  TlsContext(const TlsContext&) = delete;
+  TlsContext(TlsContext&&) = delete;
+
+  TlsContext& operator=(const TlsContext&) = delete;
+  TlsContext& operator=(TlsContext&&) = delete;
+
+  // Whether the library was built with TLS support.
+  static bool IsSupported();
+
+ private:
+  friend class TcpServer;
+
+  struct SslContext;
+
+  struct SslContextDeleter {
+    void operator()(SslContext* context) const noexcept;
+  };
+
+  // Wire-format ALPN protocol list, as OpenSSL wants it.
+  std::string alpn_protocols_;
+  std::unique_ptr<SslContext, SslContextDeleter> context_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_TLS_CONTEXT_H
@@ -2,8 +2,10 @@
 #define CORO_WHEN_ALL_H
 
 #include <optional>
+#include <ranges>
 #include <vector>
 
+#include "coro/exception.h"
 #include "coro/promise.h"
 #include "coro/task.h"
 
@@ -25,10 +27,11 @@ struct WhenAll<std::index_sequence<Index...>> {
     size_t ready = 0;
     (RunTask(
          [&](auto task, auto& result) -> Task<> {
-           try {
-             result.emplace(co_await std::move(task));
-           } catch (...) {
-             exception = std::current_exception();
+           auto task_result = co_await task.AsResult();
+           if (task_result) {
+             result.emplace(std::move(task_result).value());
+           } else {
+             exception = task_result.error();
            }
            ready++;
            if (ready == sizeof...(T)) {
@@ -47,6 +50,67 @@ struct WhenAll<std::index_sequence<Index...>> {
   }
 };
 
+// Awaits the tasks of `tasks` with at most `max_concurrency` of them running,
+// passing each result with the task's index to `on_result`. Tasks are taken
+// from the range only once a slot is free, so a lazy range creates them on
+// demand. No more tasks are started after one fails; the first exception is
+// rethrown once the running ones are done.
+template <typename Range, typename OnResult>
+Task<> ForEachLimited(size_t max_concurrency, Range& tasks,
+                      OnResult on_result) {
+  if (max_concurrency == 0) {
+    throw InvalidArgument("max_concurrency has to be positive");
+  }
+  auto it = std::ranges::begin(tasks);
+  auto end = std::ranges::end(tasks);
+  if (it == end) {
+    co_return;
+  }
+  Promise<void> semaphore;
+  size_t running = 0;
+  size_t next_index = 0;
+  std::optional<std::exception_ptr> exception;
+  auto worker = [&]() -> Task<> {
+    while (!exception && it != end) {
+      auto task = std::move(*it);
+      ++it;
+      size_t index = next_index++;
+      auto task_result = co_await task.AsResult();
+      if (!task_result) {
+        if (!exception) {
+          exception = task_result.error();
+        }
+        continue;
+      }
+      try {
+        if constexpr (std::is_void_v<typename decltype(task)::type>) {
+          on_result(index);
+        } else {
+          on_result(index, std::move(task_result).value());
+        }
+      } catch (...) {
+        if (!exception) {
+          exception = std::current_exception();
+        }
+      }
+    }
+    running--;
+    if (running == 0) {
+      semaphore.SetValue();
+    }
+  };
+  // Counted up front, so that a worker which finishes synchronously doesn't
+  // see the count drop to zero while the others are still being started.
+  running = max_concurrency;
+  for (size_t i = 0; i < max_concurrency; i++) {
+    RunTask(worker);
+  }
+  co_await semaphore;
+  if (exception) {
+    std::rethrow_exception(*exception);
+  }
+}
+
 }  // namespace internal
 
 template <typename... T>
@@ -68,10 +132,11 @@ Task<std::vector<T>> WhenAll(Container tasks) {
   for (size_t i = 0; i < tasks.size(); i++) {
     RunTask(
         [&](auto task, T& result) -> Task<> {
-          try {
-            result = co_await task;
-          } catch (...) {
-            exception = std::current_exception();
+          auto task_result = co_await task.AsResult();
+          if (task_result) {
+            result = std::move(task_result).value();
+          } else {
+            exception = task_result.error();
           }
           not_ready--;
           if (not_ready == 0) {
@@ -99,10 +164,8 @@ Task<> WhenAll(Container tasks) {
   for (size_t i = 0; i < tasks.size(); i++) {
     RunTask(
         [&](auto task) -> Task<> {
-          try {
-            co_await task;
-          } catch (...) {
-            exception = std::current_exception();
+          if (auto task_result = co_await task.AsResult(); !task_result) {
+            exception = task_result.error();
           }
           not_ready--;
           if (not_ready == 0) {
@@ -117,6 +180,36 @@ Task<> WhenAll(Container tasks) {
   }
 }
 
+// Like WhenAll over a container, but runs at most `max_concurrency` tasks at
+// a time. `tasks` is any input range of tasks, e.g. a std::views::transform
+// which creates them as they're scheduled. Results are in the range's order.
+template <std::ranges::input_range Range,
+          typename T = typename std::ranges::range_value_t<Range>::type,
+          std::enable_if_t<!std::is_void_v<T>, int> = 0>
+Task<std::vector<T>> WhenAllLimited(size_t max_concurrency, Range tasks) {
+  std::vector<std::optional<T>> results;
+  co_await internal::ForEachLimited(
+      max_concurrency, tasks, [&](size_t index, T result) {
+        if (index >= results.size()) {
+          results.resize(index + 1);
+        }
+        results[index].emplace(std::move(result));
+      });
+  std::vector<T> result;
+  result.reserve(results.size());
+  for (std::optional<T>& value : results) {
+    result.push_back(std::move(*value));
+  }
+  co_return result;
+}
+
+template <std::ranges::input_range Range,
+          typename T = typename std::ranges::range_value_t<Range>::type,
+          std::enable_if_t<std::is_void_v<T>, int> = 0>
+Task<> WhenAllLimited(size_t max_concurrency, Range tasks) {
+  co_await internal::ForEachLimited(max_concurrency, tasks, [](size_t) {});
+}
+
 }  // namespace coro
 
-#endif  // CORO_WHEN_ALL_H
\ No newline at end of file
+#endif  // CORO_WHEN_ALL_H
\ No newline at end of file
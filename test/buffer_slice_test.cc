@@ -0,0 +1,35 @@
+#include "coro/util/buffer_slice.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+#include "coro/util/tcp_server.h"
+
+namespace coro::util {
+namespace {
+
+TEST(BufferSliceTest, SharesBytesBetweenSubslices) {
+  BufferSlice slice(std::string("hello world"));
+  EXPECT_EQ(std::string_view(slice), "hello world");
+
+  BufferSlice world = slice.Subslice(6);
+  BufferSlice hello = slice.Subslice(0, 5);
+  slice = BufferSlice();
+  EXPECT_TRUE(slice.empty());
+  EXPECT_EQ(std::string_view(world), "world");
+  EXPECT_EQ(std::string_view(hello), "hello");
+  EXPECT_EQ(std::string_view(hello.Subslice(1, 100)), "ello");
+  EXPECT_TRUE(world.Subslice(world.size()).empty());
+}
+
+TEST(BufferSliceTest, IsUsableAsTcpResponseChunk) {
+  BufferSlice slice(std::string(64 * 1024, 'x'));
+  TcpResponseChunk chunk(slice.Subslice(1024));
+  EXPECT_EQ(chunk.chunk().data(), slice.data() + 1024);
+  EXPECT_EQ(chunk.chunk().size(), 63 * 1024);
+}
+
+}  // namespace
+}  // namespace coro::util
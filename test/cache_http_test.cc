@@ -0,0 +1,427 @@
+#include "coro/http/cache_http.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "coro/http/disk_cache.h"
+#include "coro/http/http.h"
+#include "coro/http/http_parse.h"
+#include "coro/promise.h"
+#include "coro/util/thread_pool.h"
+#include "http_server_fixture.h"
+
+namespace coro::http {
+namespace {
+
+using Request = Request<>;
+using Response = Response<>;
+
+using CacheHttpTest = HttpServerFixture;
+
+TEST_F(CacheHttpTest, RevalidatesStaleResponse) {
+  CacheHttp cache_http{CacheHttpConfig{}, &http()};
+  std::vector<std::optional<std::string>> validators;
+  std::vector<std::string> bodies;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        auto validator = GetHeader(request.headers, "If-None-Match");
+        validators.push_back(validator);
+        if (validator == "\"v1\"") {
+          co_return Response{.status = 304,
+                             .headers = {{"Content-Length", "0"}},
+                             .body = CreateBody("")};
+        }
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=0"},
+                                       {"ETag", "\"v1\""}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 2; i++) {
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response =
+              co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+          EXPECT_EQ(response.status, 200);
+          bodies.push_back(co_await GetBody(std::move(response.body)));
+        }
+      });
+
+  EXPECT_EQ(validators,
+            (std::vector<std::optional<std::string>>{
+                std::nullopt, std::optional<std::string>("\"v1\"")}));
+  EXPECT_EQ(bodies, (std::vector<std::string>{"payload", "payload"}));
+}
+
+TEST_F(CacheHttpTest, SharesCachedChunksBetweenReaders) {
+  CacheHttp cache_http{CacheHttpConfig{}, &http()};
+  std::vector<std::vector<const uint8_t*>> chunks(2);
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=60"}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        for (std::vector<const uint8_t*>& reader_chunks : chunks) {
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response =
+              co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+          FOR_CO_AWAIT(const util::BufferSlice& chunk, response.body) {
+            reader_chunks.push_back(chunk.data());
+          }
+        }
+      });
+
+  ASSERT_FALSE(chunks[0].empty());
+  EXPECT_EQ(chunks[0], chunks[1]);
+}
+
+TEST_F(CacheHttpTest, ServesStaleResponseWhileRevalidating) {
+  CacheHttp cache_http{CacheHttpConfig{.stale_while_revalidate_ms = 60000},
+                       &http()};
+  int request_count = 0;
+  std::vector<std::string> bodies;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        std::string message = "payload" + std::to_string(++request_count);
+        auto size = message.size();
+        co_return Response{
+            .status = 200,
+            .headers = {{"Content-Length", std::to_string(size)},
+                        {"Cache-Control", "max-age=0"}},
+            .body = CreateBody(std::move(message))};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 100; i++) {
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response =
+              co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+          bodies.push_back(co_await GetBody(std::move(response.body)));
+          if (bodies.back() != "payload1") {
+            break;
+          }
+          co_await event_loop()->Wait(10, stdx::stop_token());
+        }
+      });
+
+  ASSERT_GE(bodies.size(), 3);
+  EXPECT_EQ(bodies[0], "payload1");
+  EXPECT_EQ(bodies[1], "payload1");
+  EXPECT_EQ(bodies.back(), "payload2");
+}
+
+Generator<util::BufferSlice> CreateDelayedBody(
+    Promise<void>* release, std::string first = "first-",
+    std::string second = "second") {
+  co_yield std::move(first);
+  co_await *release;
+  co_yield std::move(second);
+}
+
+TEST_F(CacheHttpTest, StreamsResponseWhileCachingIt) {
+  CacheHttp cache_http{CacheHttpConfig{}, &http()};
+  Promise<void> release;
+  int request_count = 0;
+  std::vector<std::string> chunks;
+  std::string concurrent_body;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        request_count++;
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "12"}},
+                           .body = CreateDelayedBody(&release)};
+      },
+      [&]() -> Task<> {
+        std::string url = address() + "/";
+        Request request{.url = url,
+                        .headers = {{"Accept", "application/json"}}};
+        auto response =
+            co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+        FOR_CO_AWAIT(std::string_view chunk, response.body) {
+          chunks.emplace_back(chunk);
+          if (chunks.size() == 1) {
+            Request concurrent_request{
+                .url = url, .headers = {{"Accept", "application/json"}}};
+            auto concurrent_response = co_await cache_http.Fetch(
+                std::move(concurrent_request), stdx::stop_token());
+            release.SetValue();
+            concurrent_body =
+                co_await GetBody(std::move(concurrent_response.body));
+          }
+        }
+      });
+
+  EXPECT_EQ(request_count, 1);
+  EXPECT_EQ(chunks, (std::vector<std::string>{"first-", "second"}));
+  EXPECT_EQ(concurrent_body, "first-second");
+}
+
+TEST_F(CacheHttpTest, PassesThroughResponseLargerThanCache) {
+  CacheHttp cache_http{CacheHttpConfig{.cache_size_bytes = 256 * 1024},
+                       &http()};
+  const std::string payload(1024 * 1024, 'x');
+  Promise<void> release;
+  int request_count = 0;
+  std::string body;
+  std::string concurrent_body;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        request_count++;
+        std::vector<std::pair<std::string, std::string>> headers = {
+            {"Content-Length", std::to_string(payload.size())},
+            {"Cache-Control", "max-age=60"}};
+        if (request_count > 1) {
+          co_return Response{.status = 200,
+                             .headers = std::move(headers),
+                             .body = CreateBody(payload)};
+        }
+        co_return Response{
+            .status = 200,
+            .headers = std::move(headers),
+            .body = CreateDelayedBody(&release,
+                                      payload.substr(0, payload.size() / 2),
+                                      payload.substr(payload.size() / 2))};
+      },
+      [&]() -> Task<> {
+        std::string url = address() + "/";
+        Request request{.url = url,
+                        .headers = {{"Accept", "application/json"}}};
+        auto response =
+            co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+        FOR_CO_AWAIT(std::string_view chunk, response.body) {
+          if (body.empty()) {
+            co_await event_loop()->Wait(100, stdx::stop_token());
+            // The body has outgrown the cache by now, so it isn't shared.
+            Request concurrent_request{
+                .url = url, .headers = {{"Accept", "application/json"}}};
+            auto concurrent_response = co_await cache_http.Fetch(
+                std::move(concurrent_request), stdx::stop_token());
+            release.SetValue();
+            concurrent_body =
+                co_await GetBody(std::move(concurrent_response.body));
+          }
+          body += chunk;
+        }
+      });
+
+  EXPECT_EQ(request_count, 2);
+  EXPECT_EQ(body, payload);
+  EXPECT_EQ(concurrent_body, payload);
+}
+
+// Directory of a test's disk cache, removed with the logs in it.
+class CacheDirectory {
+ public:
+  CacheDirectory() {
+    if (mkdtemp(path_) == nullptr) {
+      throw std::runtime_error("can't create cache directory");
+    }
+  }
+  CacheDirectory(const CacheDirectory&) = delete;
+  CacheDirectory& operator=(const CacheDirectory&) = delete;
+  ~CacheDirectory() {
+    std::remove((std::string(path_) + "/current.log").c_str());
+    std::remove((std::string(path_) + "/previous.log").c_str());
+    rmdir(path_);
+  }
+
+  std::string path() const { return path_; }
+
+ private:
+  char path_[33] = "/tmp/coro-http-cache-http-XXXXXX";
+};
+
+TEST_F(CacheHttpTest, ServesResponseFromDiskCache) {
+  CacheDirectory directory;
+  DiskCache disk_cache({.directory = directory.path()});
+  int request_count = 0;
+  std::vector<std::string> bodies;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        request_count++;
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=60"}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 2; i++) {
+          // A fresh in-memory tier each time, as after a restart.
+          CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache},
+                               &http()};
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response = co_await cache_http.Fetch(std::move(request),
+                                                    stdx::stop_token());
+          bodies.push_back(co_await GetBody(std::move(response.body)));
+        }
+      });
+
+  EXPECT_EQ(request_count, 1);
+  EXPECT_EQ(bodies, (std::vector<std::string>{"payload", "payload"}));
+}
+
+TEST_F(CacheHttpTest, ServesDiskCacheHitsFromMapping) {
+  CacheDirectory directory;
+  DiskCache disk_cache({.directory = directory.path()});
+  std::vector<const uint8_t*> chunks;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=60"}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        {
+          CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache},
+                               &http()};
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response = co_await cache_http.Fetch(std::move(request),
+                                                    stdx::stop_token());
+          co_await GetBody(std::move(response.body));
+        }
+        CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache},
+                             &http()};
+        for (int i = 0; i < 2; i++) {
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response = co_await cache_http.Fetch(std::move(request),
+                                                    stdx::stop_token());
+          FOR_CO_AWAIT(const util::BufferSlice& chunk, response.body) {
+            EXPECT_EQ(std::string_view(chunk), "payload");
+            chunks.push_back(chunk.data());
+          }
+        }
+      });
+
+  ASSERT_EQ(chunks.size(), 2);
+  EXPECT_EQ(chunks[0], chunks[1]);
+}
+
+TEST_F(CacheHttpTest, RefreshesDiskCacheOnRevalidation) {
+  CacheDirectory directory;
+  DiskCache disk_cache({.directory = directory.path()});
+  // A single worker runs the disk cache's accesses in order.
+  util::ThreadPool thread_pool(event_loop(), /*thread_count=*/1);
+  std::vector<std::optional<std::string>> validators;
+  std::vector<std::string> bodies;
+  std::vector<std::optional<uint64_t>> file_sizes;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        auto validator = GetHeader(request.headers, "If-None-Match");
+        validators.push_back(validator);
+        if (validator == "\"v1\"") {
+          co_return Response{.status = 304,
+                             .headers = {{"Content-Length", "0"},
+                                         {"Cache-Control", "max-age=60"}},
+                             .body = CreateBody("")};
+        }
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=0"},
+                                       {"ETag", "\"v1\""}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 3; i++) {
+          CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache,
+                                               .thread_pool = &thread_pool},
+                               &http()};
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response = co_await cache_http.Fetch(std::move(request),
+                                                    stdx::stop_token());
+          file_sizes.push_back(
+              response.file_body
+                  ? std::optional<uint64_t>(response.file_body->size())
+                  : std::nullopt);
+          bodies.push_back(co_await GetBody(std::move(response.body)));
+        }
+      });
+
+  // The third fetch is served by the metadata the 304 refreshed.
+  EXPECT_EQ(validators,
+            (std::vector<std::optional<std::string>>{
+                std::nullopt, std::optional<std::string>("\"v1\"")}));
+  EXPECT_EQ(bodies,
+            (std::vector<std::string>{"payload", "payload", "payload"}));
+  EXPECT_EQ(file_sizes, (std::vector<std::optional<uint64_t>>{
+                            std::nullopt, 7, 7}));
+}
+
+TEST_F(CacheHttpTest, FinishesBodyBeforeDiskWrite) {
+  CacheDirectory directory;
+  DiskCache disk_cache({.directory = directory.path()});
+  util::ThreadPool thread_pool(event_loop(), /*thread_count=*/1);
+  std::promise<void> unblock_disk;
+  std::atomic<bool> disk_blocked = true;
+  bool read_while_disk_blocked = false;
+  std::string body;
+  std::optional<uint64_t> file_size;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        // Keeps the only worker busy past the disk cache lookup, so that the
+        // disk write stays pending.
+        RunTask([&]() -> Task<> {
+          co_await thread_pool.Do([&] {
+            unblock_disk.get_future().wait_for(std::chrono::seconds(10));
+            disk_blocked = false;
+          });
+        });
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"},
+                                       {"Cache-Control", "max-age=60"}},
+                           .body = CreateBody("payload")};
+      },
+      [&]() -> Task<> {
+        {
+          CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache,
+                                               .thread_pool = &thread_pool},
+                               &http()};
+          Request request{.url = address() + "/",
+                          .headers = {{"Accept", "application/json"}}};
+          auto response = co_await cache_http.Fetch(std::move(request),
+                                                    stdx::stop_token());
+          body = co_await GetBody(std::move(response.body));
+          read_while_disk_blocked = disk_blocked;
+        }
+        unblock_disk.set_value();
+        // The worker runs the disk write before this.
+        co_await thread_pool.Do([] {});
+        CacheHttp cache_http{CacheHttpConfig{.disk_cache = &disk_cache,
+                                             .thread_pool = &thread_pool},
+                             &http()};
+        Request request{.url = address() + "/",
+                        .headers = {{"Accept", "application/json"}}};
+        auto response =
+            co_await cache_http.Fetch(std::move(request), stdx::stop_token());
+        if (response.file_body) {
+          file_size = response.file_body->size();
+        }
+        co_await GetBody(std::move(response.body));
+      });
+
+  EXPECT_EQ(body, "payload");
+  EXPECT_TRUE(read_while_disk_blocked);
+  EXPECT_EQ(file_size, 7);
+}
+
+}  // namespace
+}  // namespace coro::http
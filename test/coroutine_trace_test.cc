@@ -0,0 +1,59 @@
+#include "coro/util/coroutine_trace.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "coro/exception.h"
+#include "coro/generator.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::util {
+namespace {
+
+using ::testing::HasSubstr;
+
+Generator<int> CountToThree() {
+  for (int i = 1; i <= 3; i++) {
+    co_yield i;
+  }
+}
+
+Task<int> SumWithDelay(const EventLoop& event_loop) {
+  int sum = 0;
+  FOR_CO_AWAIT(int value, CountToThree()) { sum += value; }
+  co_await event_loop.Wait(1);
+  co_return sum;
+}
+
+TEST(CoroutineTraceTest, ExportsSpansOfTasksAndGenerators) {
+  if (!IsCoroutineTraceSupported()) {
+    EXPECT_THROW(StartCoroutineTrace(), InvalidArgument);
+    GTEST_SKIP() << "coro-http was built without WITH_COROUTINE_TRACE.";
+  }
+  EventLoop event_loop;
+  int sum = 0;
+  StartCoroutineTrace();
+  RunTask([&]() -> Task<> { sum = co_await SumWithDelay(event_loop); });
+  event_loop.EnterLoop();
+  StopCoroutineTrace();
+  std::stringstream stream;
+  WriteChromeTrace(stream);
+  std::string trace = stream.str();
+
+  EXPECT_EQ(sum, 6);
+  EXPECT_TRUE(trace.starts_with("{\"displayTimeUnit\""));
+  EXPECT_TRUE(trace.ends_with("]}\n"));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"b\""));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"e\""));
+  EXPECT_THAT(trace, HasSubstr("CountToThree"));
+  EXPECT_THAT(trace, HasSubstr("SumWithDelay"));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"EventLoop::Wait\""));
+  EXPECT_THAT(trace, HasSubstr("coroutine_trace_test.cc:"));
+}
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,233 @@
+#include "coro/http/curl_http.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/http/http_exception.h"
+#include "http_server_fixture.h"
+
+namespace coro::http {
+namespace {
+
+using Request = Request<>;
+using Response = Response<>;
+
+using ::testing::HasSubstr;
+
+using CurlHttpTest = HttpServerFixture;
+
+TEST_F(CurlHttpTest, FetchesWithSharedCache) {
+  auto share = std::make_shared<CurlShare>();
+  Http http1{CurlHttp{event_loop(), CurlHttpConfig{.share = share}}};
+  Http http2{CurlHttp{event_loop(), CurlHttpConfig{.share = share}}};
+  std::vector<std::string> bodies;
+  Run(
+      [](Request request, stdx::stop_token) -> Task<Response> {
+        std::string message = "message" + request.url;
+        auto size = message.size();
+        co_return Response{
+            .status = 200,
+            .headers = {{"Content-Length", std::to_string(size)}},
+            .body = CreateBody(std::move(message))};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 2; i++) {
+          for (const auto* http : {&http1, &http2}) {
+            auto response =
+                co_await http->Fetch(address() + "/" + std::to_string(i));
+            bodies.push_back(co_await GetBody(std::move(response.body)));
+          }
+        }
+      });
+
+  EXPECT_EQ(bodies, (std::vector<std::string>{"message/0", "message/0",
+                                               "message/1", "message/1"}));
+}
+
+TEST_F(CurlHttpTest, ReportsTransferTimings) {
+  std::vector<CurlTransferTiming> timings;
+  CurlHttp http{event_loop(),
+                {.on_transfer_finished = [&](const CurlTransferTiming& t) {
+                  timings.push_back(t);
+                }}};
+  Run(
+      [](Request request, stdx::stop_token) -> Task<Response> {
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"}},
+                           .body = CreateBody("message")};
+      },
+      [&]() -> Task<> {
+        for (int i = 0; i < 2; i++) {
+          Request request{.url = address() + "/" + std::to_string(i)};
+          auto response =
+              co_await http.Fetch(std::move(request), stdx::stop_token());
+          co_await GetBody(std::move(response.body));
+        }
+      });
+
+  ASSERT_EQ(timings.size(), 2);
+  EXPECT_THAT(timings[0].url, HasSubstr("/0"));
+  EXPECT_EQ(timings[0].result, 0);
+  EXPECT_EQ(timings[0].status, 200);
+  EXPECT_FALSE(timings[0].reused_connection);
+  EXPECT_TRUE(timings[1].reused_connection);
+  EXPECT_LE(timings[0].connect, timings[0].first_byte);
+  EXPECT_LE(timings[0].first_byte, timings[0].total);
+
+  CurlHttpStats stats = http.GetStats();
+  EXPECT_EQ(stats.transfer_count, 2);
+  EXPECT_EQ(stats.failed_transfer_count, 0);
+  EXPECT_EQ(stats.reused_connection_count, 1);
+  EXPECT_EQ(stats.connect.count(), 1);
+  EXPECT_EQ(stats.total.count(), 2);
+}
+
+TEST_F(CurlHttpTest, StreamsBodyThroughSmallReceiveWindow) {
+  CurlHttp http{event_loop(), {.receive_window_size = 8 * 1024}};
+  std::string expected;
+  for (int i = 0; i < 64; i++) {
+    expected += std::string(4 * 1024, static_cast<char>('a' + i % 26));
+  }
+  std::string received;
+  int chunk_count = 0;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        co_return Response{.status = 200, .body = CreateBody(expected)};
+      },
+      [&]() -> Task<> {
+        Request request{.url = address()};
+        auto response =
+            co_await http.Fetch(std::move(request), stdx::stop_token());
+        FOR_CO_AWAIT(std::string_view chunk, std::move(response.body)) {
+          received += chunk;
+          chunk_count++;
+        }
+      });
+
+  EXPECT_EQ(received.size(), expected.size());
+  EXPECT_TRUE(received == expected);
+  EXPECT_GT(chunk_count, 1);
+}
+
+Generator<util::BufferSlice> CreateChunkedBody(int chunk_count,
+                                               size_t chunk_size) {
+  for (int i = 0; i < chunk_count; i++) {
+    co_yield std::string(chunk_size, static_cast<char>('a' + i % 26));
+  }
+}
+
+TEST_F(CurlHttpTest, UploadsBodyThroughSmallSendWindow) {
+  CurlHttp http{event_loop(), {.send_window_size = 8 * 1024}};
+  std::string uploaded;
+  std::string expected;
+  for (int i = 0; i < 64; i++) {
+    expected += std::string(3 * 1024, static_cast<char>('a' + i % 26));
+  }
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        uploaded = co_await GetBody(std::move(*request.body));
+        co_return Response{.status = 200, .body = CreateBody("ok")};
+      },
+      [&]() -> Task<> {
+        Request request{
+            .url = address(),
+            .method = Method::kPost,
+            .headers = {{"Content-Length", std::to_string(expected.size())}},
+            .body = CreateChunkedBody(64, 3 * 1024)};
+        auto response =
+            co_await http.Fetch(std::move(request), stdx::stop_token());
+        co_await GetBody(std::move(response.body));
+      });
+
+  EXPECT_EQ(uploaded.size(), expected.size());
+  EXPECT_TRUE(uploaded == expected);
+}
+
+TEST_F(CurlHttpTest, FailsRequestsPastFirstByteTimeout) {
+  std::optional<int> error_status;
+  auto start = std::chrono::steady_clock::now();
+  Run(
+      [&](Request request, stdx::stop_token stop_token) -> Task<Response> {
+        co_await event_loop()->Wait(1000, stop_token);
+        co_return Response{.status = 200};
+      },
+      [&]() -> Task<> {
+        Request request{
+            .url = address(),
+            .timeouts = {.first_byte = std::chrono::milliseconds(50)}};
+        try {
+          co_await http().Fetch(std::move(request), stdx::stop_token());
+        } catch (const HttpException& e) {
+          error_status = e.status();
+        }
+      });
+
+  EXPECT_EQ(error_status, 28 /* CURLE_OPERATION_TIMEDOUT */);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(1000));
+}
+
+TEST_F(CurlHttpTest, ReturnsFailureWithoutThrowing) {
+  CurlHttp curl_http{event_loop()};
+  std::optional<int> error_status;
+  std::string body;
+  Run(
+      [&](Request request, stdx::stop_token stop_token) -> Task<Response> {
+        if (request.url == "/slow") {
+          co_await event_loop()->Wait(1000, stop_token);
+        }
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"}},
+                           .body = CreateBody("message")};
+      },
+      [&]() -> Task<> {
+        Request slow{.url = address() + "/slow",
+                     .timeouts = {.first_byte = std::chrono::milliseconds(50)}};
+        auto failure =
+            co_await curl_http.TryFetch(std::move(slow), stdx::stop_token());
+        try {
+          std::rethrow_exception(failure.error());
+        } catch (const HttpException& e) {
+          error_status = e.status();
+        }
+        Request fast{.url = address() + "/"};
+        auto success =
+            co_await curl_http.TryFetch(std::move(fast), stdx::stop_token());
+        body = co_await GetBody(std::move(success).value().body);
+      });
+
+  EXPECT_EQ(error_status, 28 /* CURLE_OPERATION_TIMEDOUT */);
+  EXPECT_EQ(body, "message");
+}
+
+TEST(CurlHttpNativeCaCertsTest, WaitsForNativeCaCertsOnIdleLoop) {
+  // Nothing but the CA bundle load keeps this loop from exiting until the
+  // connection is attempted.
+  coro::util::EventLoop event_loop;
+  CurlHttp curl_http{&event_loop};
+  std::optional<int> error_status;
+  RunTask([&]() -> Task<> {
+    Request request{.url = "http://127.0.0.1:1/"};
+    auto failure =
+        co_await curl_http.TryFetch(std::move(request), stdx::stop_token());
+    try {
+      std::rethrow_exception(failure.error());
+    } catch (const HttpException& e) {
+      error_status = e.status();
+    }
+  });
+  event_loop.EnterLoop();
+
+  EXPECT_EQ(error_status, 7 /* CURLE_COULDNT_CONNECT */);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,86 @@
+#include "coro/http/disk_cache.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coro::http {
+namespace {
+
+class DiskCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char directory[] = "/tmp/coro-http-disk-cache-XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    directory_ = directory;
+  }
+
+  void TearDown() override {
+    std::remove((directory_ + "/current.log").c_str());
+    std::remove((directory_ + "/previous.log").c_str());
+    rmdir(directory_.c_str());
+  }
+
+  static Request<std::string> GetRequest(std::string url) {
+    return {.url = std::move(url), .headers = {{"Accept", "application/json"}}};
+  }
+
+  static RequestFingerprint GetKey(std::string url) {
+    return GetFingerprint(GetRequest(std::move(url)));
+  }
+
+  static DiskCache::Metadata GetMetadata() {
+    return {.status = 200,
+            .headers = {{"ETag", "\"v1\""}},
+            .timestamp = 1234,
+            .max_age_ms = 5000,
+            .stale_while_revalidate_ms = 0};
+  }
+
+  std::string directory_;
+};
+
+TEST_F(DiskCacheTest, ReturnsStoredResponseAfterReopening) {
+  {
+    DiskCache cache({.directory = directory_});
+    std::vector<std::string_view> body = {"hello ", "world"};
+    cache.Put(GetKey("http://host/a"), GetMetadata(), body);
+  }
+  DiskCache cache({.directory = directory_});
+  auto entry = cache.Get(GetKey("http://host/a"));
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->body, "hello world");
+  EXPECT_EQ(entry->metadata.status, 200);
+  EXPECT_EQ(entry->metadata.timestamp, 1234);
+  EXPECT_EQ(entry->metadata.max_age_ms, 5000);
+  EXPECT_EQ(entry->metadata.headers,
+            (std::vector<std::pair<std::string, std::string>>{
+                {"ETag", "\"v1\""}}));
+  EXPECT_FALSE(cache.Get(GetKey("http://host/b")));
+
+  auto other_headers = GetRequest("http://host/a");
+  other_headers.headers.emplace_back("Authorization", "token");
+  EXPECT_FALSE(cache.Get(GetFingerprint(other_headers)));
+}
+
+TEST_F(DiskCacheTest, EvictsOldestEntriesWhenFull) {
+  DiskCache cache({.directory = directory_, .max_size_bytes = 4096});
+  std::string chunk(512, 'x');
+  std::vector<std::string_view> body = {chunk};
+  for (int i = 0; i < 16; i++) {
+    cache.Put(GetKey("http://host/" + std::to_string(i)), GetMetadata(),
+              body);
+  }
+  EXPECT_FALSE(cache.Get(GetKey("http://host/0")));
+  auto entry = cache.Get(GetKey("http://host/15"));
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->body, chunk);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,92 @@
+#include "coro/util/event_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace coro::util {
+namespace {
+
+TEST(EventLoopTest, ReportsMetrics) {
+  EventLoop event_loop;
+  EventLoop::Metrics during_wait{};
+  RunTask([&]() -> Task<> {
+    std::thread thread([&] {
+      for (int i = 0; i < 3; i++) {
+        event_loop.RunOnEventLoop([] {});
+      }
+    });
+    thread.join();
+    auto wait = event_loop.Wait(10);
+    during_wait = event_loop.GetMetrics();
+    co_await wait;
+  });
+  event_loop.EnterLoop();
+
+  EXPECT_EQ(during_wait.active_timer_count, 1);
+  EXPECT_EQ(during_wait.queued_function_count, 3);
+
+  EventLoop::Metrics metrics = event_loop.GetMetrics();
+  EXPECT_EQ(metrics.active_timer_count, 0);
+  EXPECT_EQ(metrics.queued_function_count, 0);
+  EXPECT_EQ(metrics.max_queued_function_count, 3);
+  EXPECT_EQ(metrics.callback_count, 4);
+
+  event_loop.ResetMetrics();
+  metrics = event_loop.GetMetrics();
+  EXPECT_EQ(metrics.max_queued_function_count, 0);
+  EXPECT_EQ(metrics.max_loop_lag.count(), 0);
+  EXPECT_EQ(metrics.max_callback_duration.count(), 0);
+}
+
+TEST(EventLoopTest, RunsFunctionsQueuedFromThreadsInOrder) {
+  constexpr int kThreadCount = 4;
+  constexpr int kFunctionCount = 1000;
+  EventLoop event_loop;
+  std::vector<std::vector<int>> ran(kThreadCount);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadCount; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kFunctionCount; i++) {
+        event_loop.RunOnEventLoop([&, t, i] { ran[t].push_back(i); });
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  event_loop.EnterLoop();
+
+  std::vector<int> expected;
+  for (int i = 0; i < kFunctionCount; i++) {
+    expected.push_back(i);
+  }
+  for (int t = 0; t < kThreadCount; t++) {
+    EXPECT_EQ(ran[t], expected);
+  }
+  EXPECT_EQ(event_loop.GetMetrics().callback_count,
+            kThreadCount * kFunctionCount);
+}
+
+TEST(EventLoopTest, RunsFunctionQueuedWhileLoopIsRunning) {
+  EventLoop event_loop;
+  bool ran = false;
+  std::thread thread;
+  RunTask([&]() -> Task<> {
+    thread = std::thread([&] {
+      event_loop.RunOnEventLoop([&] {
+        ran = true;
+        event_loop.ExitLoop();
+      });
+    });
+    co_return;
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  thread.join();
+
+  EXPECT_TRUE(ran);
+}
+
+}  // namespace
+}  // namespace coro::util
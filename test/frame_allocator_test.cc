@@ -0,0 +1,85 @@
+#include "coro/util/frame_allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <utility>
+
+#include "coro/generator.h"
+#include "coro/task.h"
+
+namespace coro::util {
+namespace {
+
+class CountingAllocator : public FrameAllocator {
+ public:
+  void* Allocate(size_t size) override {
+    allocated_count++;
+    return ::operator new(size);
+  }
+
+  void Deallocate(void* ptr, size_t) noexcept override {
+    deallocated_count++;
+    ::operator delete(ptr);
+  }
+
+  int allocated_count = 0;
+  int deallocated_count = 0;
+};
+
+Task<int> GetValue(int value) { co_return value; }
+
+Generator<int> GetRange(int count) {
+  for (int i = 0; i < count; i++) {
+    co_yield i;
+  }
+}
+
+TEST(FrameAllocatorTest, ReturnsFramesToAllocatorWhichCreatedThem) {
+  CountingAllocator allocator;
+  std::optional<Task<int>> task;
+  FrameAllocator* previous = SetFrameAllocator(&allocator);
+  EXPECT_EQ(previous, nullptr);
+  task.emplace(GetValue(42));
+  SetFrameAllocator(previous);
+  EXPECT_EQ(allocator.allocated_count, 1);
+
+  int result = 0;
+  RunTask([&]() -> Task<> { result = co_await std::move(*task); });
+  EXPECT_EQ(result, 42);
+  EXPECT_EQ(allocator.allocated_count, 1);
+  EXPECT_EQ(allocator.deallocated_count, 0);
+
+  task.reset();
+  EXPECT_EQ(allocator.deallocated_count, 1);
+}
+
+TEST(FrameAllocatorTest, AllocatesTasksAndGeneratorsFromArena) {
+  FrameArena arena;
+  int sum = 0;
+  {
+    FrameArena::Scope scope(&arena);
+    EXPECT_EQ(GetFrameAllocator(), &arena);
+    RunTask([&]() -> Task<> {
+      FOR_CO_AWAIT(int value, GetRange(4)) { sum += value; }
+    });
+  }
+  EXPECT_EQ(GetFrameAllocator(), nullptr);
+  EXPECT_EQ(sum, 6);
+  EXPECT_GT(arena.allocated_bytes(), 0);
+
+  FrameArena::Scope scope(&arena);
+  auto run = [&](int value) {
+    RunTask([&]() -> Task<> { sum += co_await GetValue(value); });
+  };
+  run(0);
+  size_t allocated_bytes = arena.allocated_bytes();
+  for (int i = 1; i < 16; i++) {
+    run(i);
+  }
+  EXPECT_EQ(sum, 126);
+  EXPECT_EQ(arena.allocated_bytes(), allocated_bytes);
+}
+
+}  // namespace
+}  // namespace coro::util
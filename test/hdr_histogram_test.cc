@@ -0,0 +1,67 @@
+#include "coro/util/hdr_histogram.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace coro::util {
+namespace {
+
+using ::std::chrono::microseconds;
+
+TEST(HdrHistogramTest, ReportsPercentilesWithinPrecision) {
+  HdrHistogram histogram;
+  for (int64_t i = 1; i <= 100000; i++) {
+    histogram.Add(microseconds(i));
+  }
+
+  EXPECT_EQ(histogram.count(), 100000);
+  EXPECT_EQ(histogram.min(), microseconds(1));
+  EXPECT_EQ(histogram.max(), microseconds(100000));
+  EXPECT_EQ(histogram.mean(), microseconds(50000));
+  EXPECT_EQ(histogram.GetPercentile(0), microseconds(1));
+  EXPECT_EQ(histogram.GetPercentile(100), microseconds(100000));
+  for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+    auto expected = static_cast<double>(percentile * 1000);
+    auto reported = static_cast<double>(
+        histogram.GetPercentile(percentile).count());
+    EXPECT_GE(reported, expected);
+    EXPECT_LE(reported, expected * (1 + 1.0 / HdrHistogram::kSubBucketCount))
+        << percentile;
+  }
+}
+
+TEST(HdrHistogramTest, BucketsCoverValuesWithoutGaps) {
+  HdrHistogram histogram;
+  histogram.Add(microseconds(-5));
+  histogram.Add(microseconds(255));
+  histogram.Add(microseconds(256));
+  histogram.Add(microseconds(257));
+  histogram.Add(microseconds(int64_t(1) << 50));
+
+  std::vector<std::tuple<int64_t, int64_t, uint64_t>> buckets;
+  histogram.ForEachBucket(
+      [&](microseconds lowest, microseconds highest, uint64_t count) {
+        buckets.emplace_back(lowest.count(), highest.count(), count);
+      });
+  EXPECT_EQ(buckets,
+            (std::vector<std::tuple<int64_t, int64_t, uint64_t>>{
+                {0, 0, 1},
+                {255, 255, 1},
+                {256, 257, 2},
+                {HdrHistogram::kMaxValue - (int64_t(1) << 32) + 1,
+                 HdrHistogram::kMaxValue, 1}}));
+
+  HdrHistogram other;
+  other.Add(microseconds(7));
+  histogram.Merge(other);
+  EXPECT_EQ(histogram.count(), 6);
+  EXPECT_EQ(histogram.min(), microseconds(0));
+  EXPECT_EQ(histogram.GetPercentile(20), microseconds(7));
+}
+
+}  // namespace
+}  // namespace coro::util
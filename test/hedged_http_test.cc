@@ -0,0 +1,152 @@
+#include "coro/http/hedged_http.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "coro/http/http_exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::http {
+namespace {
+
+// Yields `body` a millisecond later, unless `stop_token` is cancelled first.
+Generator<util::BufferSlice> CreateStoppableBody(
+    const coro::util::EventLoop* event_loop, std::string body,
+    stdx::stop_token stop_token) {
+  co_await event_loop->Wait(1, std::move(stop_token));
+  co_yield std::move(body);
+}
+
+// Answers requests after the next of the configured delays, with the index of
+// the request as the body, or fails them with negative delays. Bodies are
+// read with the request's stop token.
+class FakeHttp {
+ public:
+  FakeHttp(const coro::util::EventLoop* event_loop, std::deque<int>* delays,
+           std::vector<std::string>* log)
+      : event_loop_(event_loop), delays_(delays), log_(log) {}
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token stop_token) const {
+    int index = static_cast<int>(log_->size());
+    int delay = delays_->front();
+    delays_->pop_front();
+    log_->push_back(request.url);
+    try {
+      co_await event_loop_->Wait(std::abs(delay), stop_token);
+    } catch (const InterruptedException&) {
+      log_->push_back("cancelled " + std::to_string(index));
+      throw;
+    }
+    if (delay < 0) {
+      throw HttpException(HttpException::kUnknown);
+    }
+    co_return Response<>{
+        .status = 200,
+        .body = CreateStoppableBody(event_loop_, std::to_string(index),
+                                    std::move(stop_token))};
+  }
+
+ private:
+  const coro::util::EventLoop* event_loop_;
+  std::deque<int>* delays_;
+  std::vector<std::string>* log_;
+};
+
+class HedgedHttpTest : public ::testing::Test {
+ protected:
+  HedgedHttpTest()
+      : http_(FakeHttp(&event_loop_, &delays_, &log_)),
+        hedged_http_(&http_, &event_loop_,
+                     {.initial_delay = std::chrono::milliseconds(20)}) {}
+
+  // Runs `request` against servers answering after `delays`, returning the
+  // body or the exception's message.
+  std::string Fetch(Request<> request, std::deque<int> delays) {
+    delays_ = std::move(delays);
+    std::string result;
+    RunTask([&]() -> Task<> {
+      try {
+        auto response =
+            co_await hedged_http_.Fetch(std::move(request), stdx::stop_token());
+        result = co_await GetBody(std::move(response.body));
+      } catch (const std::exception& e) {
+        result = e.what();
+      }
+    });
+    event_loop_.EnterLoop();
+    return result;
+  }
+
+  coro::util::EventLoop event_loop_;
+  std::deque<int> delays_;
+  std::vector<std::string> log_;
+  Http http_;
+  HedgedHttp hedged_http_;
+};
+
+TEST_F(HedgedHttpTest, DoesNotHedgeFastRequests) {
+  EXPECT_EQ(Fetch(Request<>{.url = "a"}, {1}), "0");
+  EXPECT_EQ(log_, std::vector<std::string>{"a"});
+  EXPECT_EQ(hedged_http_.stats().hedged_request_count, 0);
+}
+
+TEST_F(HedgedHttpTest, ReturnsFirstResponseAndCancelsTheOther) {
+  EXPECT_EQ(Fetch(Request<>{.url = "a"}, {500, 1}), "1");
+  EXPECT_EQ(log_, (std::vector<std::string>{"a", "a", "cancelled 0"}));
+  EXPECT_EQ(hedged_http_.stats().hedged_request_count, 1);
+  EXPECT_EQ(hedged_http_.stats().hedge_won_count, 1);
+}
+
+TEST_F(HedgedHttpTest, CancelsWinningBodyWithCallerToken) {
+  delays_ = {500, 1};
+  stdx::stop_source stop_source;
+  std::string result;
+  RunTask([&]() -> Task<> {
+    Request<> request{.url = "a"};
+    auto response =
+        co_await hedged_http_.Fetch(std::move(request), stop_source.get_token());
+    stop_source.request_stop();
+    try {
+      result = co_await GetBody(std::move(response.body));
+    } catch (const InterruptedException&) {
+      result = "interrupted";
+    }
+  });
+  event_loop_.EnterLoop();
+
+  EXPECT_EQ(result, "interrupted");
+}
+
+TEST_F(HedgedHttpTest, WaitsForRemainingAttemptAfterFailure) {
+  EXPECT_EQ(Fetch(Request<>{.url = "a"}, {50, -1}), "0");
+  EXPECT_EQ(hedged_http_.stats().hedge_won_count, 0);
+}
+
+TEST_F(HedgedHttpTest, FailsOnceEveryAttemptFailed) {
+  EXPECT_EQ(Fetch(Request<>{.url = "a"}, {-1}), "Unknown.");
+  EXPECT_EQ(log_, std::vector<std::string>{"a"});
+}
+
+TEST_F(HedgedHttpTest, DoesNotHedgeRequestsWithSideEffects) {
+  EXPECT_EQ(Fetch(Request<>{.url = "a", .method = Method::kPost}, {100}),
+            "0");
+  EXPECT_EQ(hedged_http_.stats().hedged_request_count, 0);
+}
+
+TEST_F(HedgedHttpTest, DerivesDelayFromObservedLatency) {
+  EXPECT_EQ(hedged_http_.GetHedgeDelay(), std::chrono::milliseconds(20));
+  for (int i = 0; i < 20; i++) {
+    Fetch(Request<>{.url = "a"}, {2});
+  }
+
+  EXPECT_GE(hedged_http_.GetHedgeDelay(), std::chrono::milliseconds(5));
+  EXPECT_LT(hedged_http_.GetHedgeDelay(), std::chrono::milliseconds(20));
+}
+
+}  // namespace
+}  // namespace coro::http
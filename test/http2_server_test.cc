@@ -0,0 +1,333 @@
+#include <nghttp2/nghttp2.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "coro/http/http_exception.h"
+#include "coro/http/http_parse.h"
+#include "coro/http/http_server.h"
+#include "coro/promise.h"
+#include "coro/util/event_loop.h"
+#include "tcp_client_harness.h"
+
+namespace coro::http {
+namespace {
+
+using ::coro::util::ConnectTo;
+using ::coro::util::Receive;
+using ::coro::util::RunWithClient;
+using ::testing::Contains;
+using ::testing::Not;
+using ::testing::Pair;
+
+struct Transfer {
+  std::string path;
+  std::string request_body;
+  int status = 0;
+  std::vector<std::pair<std::string, std::string>> response_headers;
+  std::string response_body;
+  size_t request_body_offset = 0;
+  bool closed = false;
+};
+
+Transfer* GetTransfer(nghttp2_session* session, int32_t stream_id) {
+  return static_cast<Transfer*>(
+      nghttp2_session_get_stream_user_data(session, stream_id));
+}
+
+ssize_t ReadRequestBody(nghttp2_session*, int32_t, uint8_t* buffer,
+                        size_t length, uint32_t* data_flags,
+                        nghttp2_data_source* source, void*) {
+  auto* transfer = static_cast<Transfer*>(source->ptr);
+  size_t size = std::min(
+      length, transfer->request_body.size() - transfer->request_body_offset);
+  std::memcpy(buffer,
+              transfer->request_body.data() + transfer->request_body_offset,
+              size);
+  transfer->request_body_offset += size;
+  if (transfer->request_body_offset == transfer->request_body.size()) {
+    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+  }
+  return static_cast<ssize_t>(size);
+}
+
+nghttp2_nv ToNameValue(std::string_view name, std::string_view value) {
+  return nghttp2_nv{
+      .name = reinterpret_cast<uint8_t*>(const_cast<char*>(name.data())),
+      .value = reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+      .namelen = name.size(),
+      .valuelen = value.size(),
+      .flags = NGHTTP2_NV_FLAG_NONE};
+}
+
+// Performs `transfers` as concurrent streams of a single cleartext HTTP/2
+// connection.
+void Perform(uint16_t port, std::vector<Transfer>& transfers) {
+  int fd = ConnectTo(port);
+  ASSERT_GE(fd, 0);
+  nghttp2_session_callbacks* callbacks;
+  nghttp2_session_callbacks_new(&callbacks);
+  nghttp2_session_callbacks_set_on_header_callback(
+      callbacks,
+      [](nghttp2_session* session, const nghttp2_frame* frame,
+         const uint8_t* name, size_t name_size, const uint8_t* value,
+         size_t value_size, uint8_t, void*) {
+        Transfer* transfer = GetTransfer(session, frame->hd.stream_id);
+        std::string_view name_view(reinterpret_cast<const char*>(name),
+                                   name_size);
+        std::string value_view(reinterpret_cast<const char*>(value),
+                               value_size);
+        if (name_view == ":status") {
+          transfer->status = std::stoi(value_view);
+        } else {
+          transfer->response_headers.emplace_back(name_view, value_view);
+        }
+        return 0;
+      });
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+      callbacks, [](nghttp2_session* session, uint8_t, int32_t stream_id,
+                    const uint8_t* data, size_t size, void*) {
+        GetTransfer(session, stream_id)
+            ->response_body.append(reinterpret_cast<const char*>(data), size);
+        return 0;
+      });
+  nghttp2_session_callbacks_set_on_stream_close_callback(
+      callbacks, [](nghttp2_session* session, int32_t stream_id, uint32_t,
+                    void*) {
+        GetTransfer(session, stream_id)->closed = true;
+        return 0;
+      });
+  nghttp2_session* session;
+  nghttp2_session_client_new(&session, callbacks, nullptr);
+  nghttp2_session_callbacks_del(callbacks);
+  nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, nullptr, 0);
+
+  std::string authority = "127.0.0.1:" + std::to_string(port);
+  for (Transfer& transfer : transfers) {
+    std::string_view method = transfer.request_body.empty() ? "GET" : "POST";
+    std::vector<nghttp2_nv> headers = {
+        ToNameValue(":method", method), ToNameValue(":scheme", "http"),
+        ToNameValue(":authority", authority),
+        ToNameValue(":path", transfer.path),
+        ToNameValue("cookie", "a=1"), ToNameValue("cookie", "b=2")};
+    nghttp2_data_provider body;
+    body.source.ptr = &transfer;
+    body.read_callback = ReadRequestBody;
+    nghttp2_submit_request(session, /*pri_spec=*/nullptr, headers.data(),
+                           headers.size(),
+                           transfer.request_body.empty() ? nullptr : &body,
+                           &transfer);
+  }
+
+  auto all_closed = [&] {
+    return std::all_of(transfers.begin(), transfers.end(),
+                       [](const Transfer& t) { return t.closed; });
+  };
+  while (!all_closed()) {
+    const uint8_t* data;
+    ssize_t size;
+    while ((size = nghttp2_session_mem_send(session, &data)) > 0) {
+      send(fd, data, static_cast<size_t>(size), MSG_NOSIGNAL);
+    }
+    if (all_closed()) {
+      break;
+    }
+    uint8_t buffer[16384];
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received <= 0 ||
+        nghttp2_session_mem_recv(session, buffer,
+                                 static_cast<size_t>(received)) < 0) {
+      break;
+    }
+  }
+  nghttp2_session_del(session);
+  close(fd);
+}
+
+// Creates a server serving `handler`, for RunWithClient.
+auto ServeHttp(HttpHandler handler, const HttpServerConfig& http_config,
+               HttpServerMetrics* metrics = nullptr) {
+  return [handler = std::move(handler), http_config,
+          metrics](const coro::util::EventLoop* event_loop) mutable {
+    return CreateHttpServer(
+        std::move(handler), event_loop,
+        coro::util::TcpServer::Config{.address = "127.0.0.1", .port = 0},
+        metrics, http_config);
+  };
+}
+
+Generator<util::BufferSlice> CreateChunkedBody(size_t chunk_count,
+                                               size_t chunk_size) {
+  for (size_t i = 0; i < chunk_count; i++) {
+    co_yield std::string(chunk_size, static_cast<char>('a' + i % 26));
+  }
+}
+
+TEST(Http2ServerTest, ServesConcurrentStreamsOnOneConnection) {
+  // The first request is answered only once the last one arrived, which can
+  // only happen if the streams are served concurrently.
+  Promise<void> last_request_arrived;
+  HttpHandler handler = [&](Request<> request,
+                            stdx::stop_token) -> Task<Response<>> {
+    if (request.url == "/first") {
+      co_await last_request_arrived;
+    } else if (request.url == "/last") {
+      last_request_arrived.SetValue();
+    }
+    std::string body = std::string(MethodToString(request.method)) + " " +
+                       request.url + " " +
+                       GetHeader(request.headers, "Cookie").value_or("");
+    if (request.body) {
+      body += " " + co_await GetBody(std::move(*request.body));
+    }
+    co_return Response<>{.status = 200,
+                         .headers = {{"Content-Type", "text/plain"},
+                                     {"Connection", "keep-alive"}},
+                         .body = CreateBody(std::move(body))};
+  };
+  std::vector<Transfer> transfers(3);
+  transfers[0].path = "/first";
+  transfers[1].path = "/upload";
+  transfers[1].request_body = "payload";
+  transfers[2].path = "/last";
+  HttpServerMetrics metrics;
+  RunWithClient(ServeHttp(std::move(handler), {.enable_http2 = true}, &metrics),
+                [&](uint16_t port) { Perform(port, transfers); });
+
+  for (const Transfer& transfer : transfers) {
+    EXPECT_EQ(transfer.status, 200);
+    EXPECT_THAT(transfer.response_headers,
+                Contains(Pair("content-type", "text/plain")));
+    EXPECT_THAT(transfer.response_headers,
+                Not(Contains(Pair("connection", "keep-alive"))));
+  }
+  EXPECT_EQ(transfers[0].response_body, "GET /first a=1; b=2");
+  EXPECT_EQ(transfers[1].response_body, "POST /upload a=1; b=2 payload");
+  EXPECT_EQ(transfers[2].response_body, "GET /last a=1; b=2");
+
+  HttpServerMetrics::Snapshot snapshot = metrics.GetSnapshot();
+  EXPECT_EQ(snapshot.open_connection_count, 0);
+  EXPECT_EQ(snapshot.in_flight_request_count, 0);
+  EXPECT_EQ(snapshot.reused_connection_request_count, 2);
+  EXPECT_EQ(snapshot.routes["POST /upload"].bytes_received, 7);
+}
+
+TEST(Http2ServerTest, StreamsBodiesThroughSmallWindows) {
+  constexpr size_t kChunkCount = 256;
+  constexpr size_t kChunkSize = 4096;
+  HttpHandler handler = [&](Request<> request,
+                            stdx::stop_token) -> Task<Response<>> {
+    std::string upload = co_await GetBody(std::move(*request.body));
+    co_return Response<>{
+        .status = 200,
+        .headers = {{"X-Upload-Size", std::to_string(upload.size())}},
+        .body = CreateChunkedBody(kChunkCount, kChunkSize)};
+  };
+  std::vector<Transfer> transfers(2);
+  transfers[0].path = "/a";
+  transfers[0].request_body = std::string(300000, 'x');
+  transfers[1].path = "/b";
+  transfers[1].request_body = std::string(200000, 'y');
+  RunWithClient(
+      ServeHttp(std::move(handler),
+                {.enable_http2 = true,
+                 .http2 = {.stream_window_size = 16 * 1024,
+                           .connection_window_size = 32 * 1024,
+                           .max_buffered_response_bytes = 8 * 1024}}),
+      [&](uint16_t port) { Perform(port, transfers); });
+
+  EXPECT_THAT(transfers[0].response_headers,
+              Contains(Pair("x-upload-size", "300000")));
+  EXPECT_THAT(transfers[1].response_headers,
+              Contains(Pair("x-upload-size", "200000")));
+  std::string expected_body;
+  for (size_t i = 0; i < kChunkCount; i++) {
+    expected_body += std::string(kChunkSize, static_cast<char>('a' + i % 26));
+  }
+  for (const Transfer& transfer : transfers) {
+    EXPECT_EQ(transfer.status, 200);
+    EXPECT_EQ(transfer.response_body, expected_body);
+  }
+}
+
+TEST(Http2ServerTest, SendsErrorResponseForFailedStream) {
+  HttpHandler handler = [](Request<> request,
+                           stdx::stop_token) -> Task<Response<>> {
+    if (request.url == "/missing") {
+      throw HttpException(HttpException::kNotFound);
+    }
+    co_return Response<>{.status = 204};
+  };
+  std::vector<Transfer> transfers(2);
+  transfers[0].path = "/missing";
+  transfers[1].path = "/";
+  RunWithClient(ServeHttp(std::move(handler), {.enable_http2 = true}),
+                [&](uint16_t port) { Perform(port, transfers); });
+
+  EXPECT_EQ(transfers[0].status, 404);
+  EXPECT_FALSE(transfers[0].response_body.empty());
+  EXPECT_EQ(transfers[1].status, 204);
+  EXPECT_EQ(transfers[1].response_body, "");
+}
+
+TEST(Http2ServerTest, ShedsStreamsPastInFlightLimit) {
+  HttpHandler handler = [](Request<> request,
+                           stdx::stop_token) -> Task<Response<>> {
+    std::string upload = co_await GetBody(std::move(*request.body));
+    co_return Response<>{.status = 200,
+                         .body = CreateBody(std::to_string(upload.size()))};
+  };
+  // The upload outgrows the stream window, so it's still in flight when the
+  // second stream arrives.
+  std::vector<Transfer> transfers(2);
+  transfers[0].path = "/a";
+  transfers[0].request_body = std::string(100000, 'x');
+  transfers[1].path = "/b";
+  transfers[1].request_body = "y";
+  RunWithClient(
+      ServeHttp(std::move(handler),
+                {.enable_http2 = true,
+                 .http2 = {.stream_window_size = 16 * 1024},
+                 .admission = {.max_in_flight_requests = 1,
+                               .max_queued_requests = 0}}),
+      [&](uint16_t port) { Perform(port, transfers); });
+
+  EXPECT_EQ(transfers[0].status, 200);
+  EXPECT_EQ(transfers[0].response_body, "100000");
+  EXPECT_EQ(transfers[1].status, 503);
+  EXPECT_THAT(transfers[1].response_headers,
+              Contains(Pair("retry-after", "1")));
+  EXPECT_EQ(transfers[1].response_body, "");
+}
+
+TEST(Http2ServerTest, ServesHttp11OnTheSamePort) {
+  HttpHandler handler = [](Request<>, stdx::stop_token) -> Task<Response<>> {
+    co_return Response<>{.status = 200,
+                         .headers = {{"Content-Length", "2"}},
+                         .body = CreateBody("ok")};
+  };
+  std::string received = RunWithClient(
+      ServeHttp(std::move(handler), {.enable_http2 = true}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string_view request =
+            "GET / HTTP/1.1\r\nConnection: close\r\n\r\n";
+        send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_TRUE(received.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(received.ends_with("\r\n\r\nok"));
+}
+
+}  // namespace
+}  // namespace coro::http
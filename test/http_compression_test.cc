@@ -0,0 +1,194 @@
+#include "coro/http/http_compression.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::http {
+namespace {
+
+using ::testing::_;
+using ::testing::Contains;
+using ::testing::Not;
+using ::testing::Pair;
+
+std::string Gunzip(std::string_view input) {
+  z_stream stream{};
+  EXPECT_EQ(inflateInit2(&stream, /*windowBits=*/15 + 16), Z_OK);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  std::string output;
+  int code = Z_OK;
+  while (code == Z_OK) {
+    char buffer[4096];
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = sizeof(buffer);
+    code = inflate(&stream, Z_NO_FLUSH);
+    output.append(buffer, sizeof(buffer) - stream.avail_out);
+  }
+  EXPECT_EQ(code, Z_STREAM_END);
+  inflateEnd(&stream);
+  return output;
+}
+
+Generator<util::BufferSlice> CreateChunkedBody(
+    std::vector<std::string> chunks) {
+  for (std::string& chunk : chunks) {
+    co_yield std::move(chunk);
+  }
+}
+
+std::string GetRepetitiveText(size_t size) {
+  std::string text;
+  while (text.size() < size) {
+    text += "{\"name\": \"entry-" + std::to_string(text.size() % 97) + "\"}, ";
+  }
+  text.resize(size);
+  return text;
+}
+
+struct CompressedResponse {
+  int status;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+};
+
+CompressedResponse Fetch(HttpHandler& handler, std::string accept_encoding) {
+  std::optional<CompressedResponse> result;
+  RunTask([&]() -> Task<> {
+    Request<> request{.url = "/"};
+    if (!accept_encoding.empty()) {
+      request.headers.emplace_back("Accept-Encoding", accept_encoding);
+    }
+    auto response = co_await handler(std::move(request), stdx::stop_token());
+    std::string body = co_await GetBody(std::move(response.body));
+    result = CompressedResponse{.status = response.status,
+                                .headers = std::move(response.headers),
+                                .body = std::move(body)};
+  });
+  return std::move(result).value();
+}
+
+TEST(HttpCompressionTest, NegotiatesContentEncoding) {
+  std::vector<ContentEncoding> available = {ContentEncoding::kBrotli,
+                                            ContentEncoding::kGzip};
+  EXPECT_EQ(NegotiateContentEncoding("gzip, deflate, br", available),
+            ContentEncoding::kBrotli);
+  EXPECT_EQ(NegotiateContentEncoding("gzip;q=1.0, br;q=0.5", available),
+            ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("br;q=0, *", available),
+            ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("x-gzip", available),
+            ContentEncoding::kGzip);
+  EXPECT_EQ(NegotiateContentEncoding("deflate, identity", available),
+            ContentEncoding::kIdentity);
+  EXPECT_EQ(NegotiateContentEncoding("", available),
+            ContentEncoding::kIdentity);
+  EXPECT_EQ(NegotiateContentEncoding("*;q=0", available),
+            ContentEncoding::kIdentity);
+}
+
+TEST(HttpCompressionTest, CompressesBodyChunkByChunk) {
+  std::string text = GetRepetitiveText(100000);
+  Generator<util::BufferSlice> body =
+      CreateChunkedBody({text.substr(0, 60000), "", text.substr(60000)});
+  std::vector<std::string> compressed;
+  RunTask([&]() -> Task<> {
+    FOR_CO_AWAIT(std::string_view chunk,
+                 CompressBody(ContentEncoding::kGzip, std::move(body))) {
+      compressed.emplace_back(chunk);
+    }
+  });
+
+  // One flushed piece per nonempty chunk, then the trailer.
+  EXPECT_EQ(compressed.size(), 3);
+  std::string all;
+  for (const std::string& chunk : compressed) {
+    EXPECT_FALSE(chunk.empty());
+    all += chunk;
+  }
+  EXPECT_LT(all.size(), text.size() / 10);
+  EXPECT_EQ(Gunzip(all), text);
+}
+
+TEST(HttpCompressionTest, CompressesLargeChunksOnThreadPool) {
+  coro::util::EventLoop event_loop;
+  coro::util::ThreadPool thread_pool(&event_loop, /*thread_count=*/2);
+  std::string text = GetRepetitiveText(300000);
+  Generator<util::BufferSlice> body =
+      CreateChunkedBody({text.substr(0, 100), text.substr(100)});
+  CompressionConfig config{.thread_pool = &thread_pool};
+  std::string compressed;
+  RunTask([&]() -> Task<> {
+    compressed = co_await GetBody(
+        CompressBody(ContentEncoding::kGzip, std::move(body), config));
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(coro::util::EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(Gunzip(compressed), text);
+}
+
+TEST(HttpCompressionTest, CompressesEligibleResponses) {
+  std::string text = GetRepetitiveText(5000);
+  std::vector<std::pair<std::string, std::string>> headers = {
+      {"Content-Type", "application/json; charset=utf-8"},
+      {"Content-Length", std::to_string(text.size())},
+      {"ETag", "\"v1\""},
+      {"Vary", "Cookie"}};
+  HttpHandler handler = CompressResponses(
+      [&](Request<>, stdx::stop_token) -> Task<Response<>> {
+        co_return Response<>{
+            .status = 200, .headers = headers, .body = CreateBody(text)};
+      },
+      {.encodings = {ContentEncoding::kGzip}});
+
+  CompressedResponse response = Fetch(handler, "gzip, deflate");
+  EXPECT_EQ(response.status, 200);
+  EXPECT_THAT(response.headers, Contains(Pair("Content-Encoding", "gzip")));
+  EXPECT_THAT(response.headers,
+              Contains(Pair("Vary", "Cookie, Accept-Encoding")));
+  EXPECT_THAT(response.headers, Contains(Pair("ETag", "W/\"v1\"")));
+  EXPECT_THAT(response.headers, Not(Contains(Pair("Content-Length", _))));
+  EXPECT_EQ(Gunzip(response.body), text);
+
+  response = Fetch(handler, "");
+  EXPECT_THAT(response.headers, Not(Contains(Pair("Content-Encoding", _))));
+  EXPECT_THAT(response.headers,
+              Contains(Pair("Vary", "Cookie, Accept-Encoding")));
+  EXPECT_EQ(response.body, text);
+}
+
+TEST(HttpCompressionTest, SendsIneligibleResponsesAsTheyAre) {
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string text = GetRepetitiveText(5000);
+  HttpHandler handler = CompressResponses(
+      [&](Request<>, stdx::stop_token) -> Task<Response<>> {
+        co_return Response<>{
+            .status = 200, .headers = headers, .body = CreateBody(text)};
+      });
+
+  for (auto response_headers :
+       std::vector<std::vector<std::pair<std::string, std::string>>>{
+           {{"Content-Type", "image/png"}},
+           {{"Content-Type", "text/plain"}, {"Content-Length", "100"}},
+           {{"Content-Type", "text/css"}, {"Content-Encoding", "br"}},
+           {{"Content-Type", "text/html"},
+            {"Cache-Control", "no-transform"}}}) {
+    headers = response_headers;
+    CompressedResponse response = Fetch(handler, "gzip");
+    EXPECT_EQ(response.headers, response_headers);
+    EXPECT_EQ(response.body, text);
+  }
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,192 @@
+#include "coro/http/http_middleware.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "coro/http/http_exception.h"
+#include "coro/promise.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::http {
+namespace {
+
+// Answers requests with the next of the configured statuses, throwing an
+// HttpException for -1, and logs the requested urls.
+class FakeHttp {
+ public:
+  FakeHttp(std::deque<int>* statuses, std::vector<std::string>* log)
+      : statuses_(statuses), log_(log) {}
+
+  Task<Response<>> Fetch(Request<> request, stdx::stop_token) const {
+    log_->push_back(request.url);
+    int status = statuses_->front();
+    statuses_->pop_front();
+    if (status == -1) {
+      throw HttpException(HttpException::kUnknown);
+    }
+    co_return Response<>{.status = status, .body = CreateBody("")};
+  }
+
+ private:
+  std::deque<int>* statuses_;
+  std::vector<std::string>* log_;
+};
+
+class HttpMiddlewareTest : public ::testing::Test {
+ protected:
+  HttpMiddlewareTest() : http_(FakeHttp(&statuses_, &log_)) {}
+
+  // Returns the status of the response or of the thrown HttpException.
+  template <typename HttpClient>
+  int Fetch(const HttpClient& client, Request<> request) {
+    int status = 0;
+    RunTask([&]() -> Task<> {
+      try {
+        auto response =
+            co_await client.Fetch(std::move(request), stdx::stop_token());
+        status = response.status;
+      } catch (const HttpException& e) {
+        status = e.status();
+      }
+    });
+    event_loop_.EnterLoop();
+    return status;
+  }
+
+  coro::util::EventLoop event_loop_;
+  std::deque<int> statuses_;
+  std::vector<std::string> log_;
+  Http http_;
+};
+
+RetryPolicy GetFastRetryPolicy() {
+  return {.initial_backoff = std::chrono::milliseconds(1),
+          .max_backoff = std::chrono::milliseconds(5)};
+}
+
+TEST_F(HttpMiddlewareTest, RetriesFailedRequests) {
+  RetryHttp retry_http(&http_, &event_loop_, GetFastRetryPolicy());
+  statuses_ = {-1, 503, 200};
+
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "a"}), 200);
+  EXPECT_EQ(log_.size(), 3);
+  EXPECT_EQ(retry_http.stats().retry_count, 2);
+}
+
+TEST_F(HttpMiddlewareTest, ReturnsLastResponseOnceAttemptsAreUsedUp) {
+  RetryHttp retry_http(&http_, &event_loop_, GetFastRetryPolicy());
+  statuses_ = {503, 503, 503};
+
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "a"}), 503);
+  EXPECT_EQ(log_.size(), 3);
+}
+
+TEST_F(HttpMiddlewareTest, DoesNotRetryRequestsWithSideEffects) {
+  RetryHttp retry_http(&http_, &event_loop_, GetFastRetryPolicy());
+  statuses_ = {503};
+
+  EXPECT_EQ(
+      Fetch(retry_http, Request<>{.url = "a", .method = Method::kDelete}), 503);
+  EXPECT_EQ(log_.size(), 1);
+}
+
+TEST_F(HttpMiddlewareTest, StopsRetryingOnceBudgetIsSpent) {
+  RetryPolicy policy = GetFastRetryPolicy();
+  policy.max_retry_budget = 2;
+  policy.retry_budget_ratio = 0;
+  RetryHttp retry_http(&http_, &event_loop_, policy);
+  statuses_ = {-1, -1, -1, -1};
+
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "a"}), HttpException::kUnknown);
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "a"}), HttpException::kUnknown);
+  EXPECT_EQ(log_.size(), 4);
+  EXPECT_EQ(retry_http.stats().retry_count, 2);
+  EXPECT_EQ(retry_http.stats().budget_exhausted_count, 1);
+}
+
+TEST_F(HttpMiddlewareTest, ReturnsRetryableResponseOnceBudgetIsSpent) {
+  RetryPolicy policy = GetFastRetryPolicy();
+  policy.max_retry_budget = 1;
+  policy.retry_budget_ratio = 0;
+  RetryHttp retry_http(&http_, &event_loop_, policy);
+  statuses_ = {503, 503, 200};
+
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "a"}), 503);
+  EXPECT_EQ(log_.size(), 2);
+  EXPECT_EQ(retry_http.stats().retry_count, 1);
+  EXPECT_EQ(retry_http.stats().budget_exhausted_count, 1);
+}
+
+TEST_F(HttpMiddlewareTest, OpensCircuitOfFailingHost) {
+  CircuitBreakerHttp circuit_breaker_http(
+      &http_, {.failure_threshold = 2,
+               .open_duration = std::chrono::milliseconds(20)});
+  statuses_ = {500, -1, 200, 200};
+
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/1"}), 500);
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/2"}),
+            HttpException::kUnknown);
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/3"}), 503);
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://b/1"}), 200);
+  EXPECT_EQ(circuit_breaker_http.stats().rejected_request_count, 1);
+  EXPECT_EQ(circuit_breaker_http.stats().open_circuit_count, 1);
+
+  RunTask([&]() -> Task<> { co_await event_loop_.Wait(30); });
+  event_loop_.EnterLoop();
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/4"}), 200);
+  EXPECT_EQ(log_, (std::vector<std::string>{"http://a/1", "http://a/2",
+                                            "http://b/1", "http://a/4"}));
+}
+
+TEST_F(HttpMiddlewareTest, ReopensCircuitWhenProbeFails) {
+  CircuitBreakerHttp circuit_breaker_http(
+      &http_,
+      {.failure_threshold = 1, .open_duration = std::chrono::milliseconds(0)});
+  statuses_ = {500, 502, 200};
+
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/"}), 500);
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/"}), 502);
+  EXPECT_EQ(Fetch(circuit_breaker_http, Request<>{.url = "http://a/"}), 200);
+  EXPECT_EQ(circuit_breaker_http.stats().open_circuit_count, 2);
+}
+
+TEST_F(HttpMiddlewareTest, LimitsConcurrencyUntilBodiesAreConsumed) {
+  ConcurrencyLimitedHttp limited_http(&http_, 1);
+  statuses_ = {200, 200};
+  std::vector<std::string> events;
+  Promise<void> consume;
+  RunTask([&]() -> Task<> {
+    Request<> request{.url = "a"};
+    auto response = co_await limited_http.Fetch(std::move(request),
+                                                stdx::stop_token());
+    events.push_back("a");
+    co_await consume;
+    co_await GetBody(std::move(response.body));
+  });
+  RunTask([&]() -> Task<> {
+    Request<> request{.url = "b"};
+    co_await limited_http.Fetch(std::move(request), stdx::stop_token());
+    events.push_back("b");
+  });
+
+  EXPECT_EQ(events, std::vector<std::string>{"a"});
+  consume.SetValue();
+  EXPECT_EQ(events, (std::vector<std::string>{"a", "b"}));
+}
+
+TEST_F(HttpMiddlewareTest, StacksThroughHttp) {
+  CircuitBreakerHttp circuit_breaker_http(&http_, {.failure_threshold = 1});
+  Http http(&circuit_breaker_http);
+  RetryHttp retry_http(&http, &event_loop_, GetFastRetryPolicy());
+  statuses_ = {503};
+
+  EXPECT_EQ(Fetch(retry_http, Request<>{.url = "http://a/"}), 503);
+  EXPECT_EQ(log_.size(), 1);
+  EXPECT_EQ(circuit_breaker_http.stats().rejected_request_count, 2);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,104 @@
+#include "coro/http/http_offload.h"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/util/event_loop.h"
+
+namespace coro::http {
+namespace {
+
+class HttpOffloadTest : public ::testing::Test {
+ protected:
+  // Runs `task` to completion on the event loop.
+  template <typename F>
+  void Run(F task) {
+    RunTask([&]() -> Task<> {
+      co_await task();
+      event_loop_.ExitLoop();
+    });
+    event_loop_.EnterLoop(coro::util::EventLoopType::NoExitOnEmpty);
+  }
+
+  coro::util::EventLoop event_loop_;
+  coro::util::ThreadPool thread_pool_{&event_loop_, /*thread_count=*/2};
+};
+
+TEST_F(HttpOffloadTest, RunsOnWorkerAndResumesOnEventLoop) {
+  HttpOffloader offloader(&thread_pool_);
+  std::thread::id worker_id;
+  std::thread::id resumed_id;
+  int result = 0;
+  Run([&]() -> Task<> {
+    result = co_await offloader.Run([&] {
+      worker_id = std::this_thread::get_id();
+      return 42;
+    });
+    resumed_id = std::this_thread::get_id();
+  });
+
+  EXPECT_EQ(result, 42);
+  EXPECT_NE(worker_id, std::this_thread::get_id());
+  EXPECT_EQ(resumed_id, std::this_thread::get_id());
+  EXPECT_EQ(offloader.stats().offloaded_count, 1);
+}
+
+TEST_F(HttpOffloadTest, ShedsLoadWhenSaturated) {
+  HttpOffloader offloader(&thread_pool_, {.max_running = 1, .max_queued = 1});
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::vector<std::string> events;
+  RunTask([&]() -> Task<> {
+    co_await offloader.Run([&] { released.wait(); });
+    events.push_back("first");
+  });
+  RunTask([&]() -> Task<> {
+    co_await offloader.Run([] {});
+    events.push_back("second");
+  });
+  Run([&]() -> Task<> {
+    try {
+      co_await offloader.Run([] {});
+    } catch (const HttpException& e) {
+      events.push_back("rejected " + std::to_string(e.status()));
+    }
+    release.set_value();
+    while (events.size() < 3) {
+      co_await event_loop_.Wait(1);
+    }
+  });
+
+  EXPECT_EQ(events,
+            (std::vector<std::string>{"rejected 503", "first", "second"}));
+  EXPECT_EQ(offloader.stats().offloaded_count, 2);
+  EXPECT_EQ(offloader.stats().rejected_count, 1);
+  EXPECT_EQ(offloader.queued_count(), 0);
+}
+
+TEST_F(HttpOffloadTest, ServesCpuBoundHandler) {
+  HttpOffloader offloader(&thread_pool_);
+  HttpHandler handler = OffloadHandler(
+      [](Request<std::string> request, stdx::stop_token) {
+        return Response<>{
+            .status = 200,
+            .headers = {{"Content-Type", "text/plain"}},
+            .body = CreateBody(request.url + ":" + *request.body)};
+      },
+      &offloader);
+  std::string body;
+  Run([&]() -> Task<> {
+    Request<> request{.url = "/resize", .body = CreateBody("image")};
+    auto response = co_await handler(std::move(request), stdx::stop_token());
+    EXPECT_EQ(response.status, 200);
+    body = co_await GetBody(std::move(response.body));
+  });
+
+  EXPECT_EQ(body, "/resize:image");
+}
+
+}  // namespace
+}  // namespace coro::http
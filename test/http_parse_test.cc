@@ -0,0 +1,134 @@
+#include "coro/http/http_parse.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/http/http_exception.h"
+
+namespace coro::http {
+namespace {
+
+TEST(HttpParseTest, FindsHeadersIgnoringCase) {
+  std::vector<std::pair<std::string, std::string>> headers = {
+      {"content-type", "text/plain"},
+      {"Transfer-Encoding", "gzip, chunked"},
+      {"Content-Type", "ignored"}};
+
+  EXPECT_EQ(FindHeader(headers, "Content-Type"), "text/plain");
+  EXPECT_EQ(GetHeader(headers, "CONTENT-TYPE"), "text/plain");
+  EXPECT_EQ(FindHeader(headers, "Content-Length"), std::nullopt);
+  EXPECT_EQ(FindHeader(headers, "Content-Typ"), std::nullopt);
+  EXPECT_TRUE(HasHeader(headers, "transfer-encoding", "chunked"));
+  EXPECT_FALSE(HasHeader(headers, "transfer-encoding", "deflate"));
+  EXPECT_FALSE(EqualsIgnoreCase("a[", "A{"));
+}
+
+TEST(HttpParseTest, EncodesBase64) {
+  EXPECT_EQ(ToBase64(""), "");
+  EXPECT_EQ(ToBase64("f"), "Zg==");
+  EXPECT_EQ(ToBase64("fo"), "Zm8=");
+  EXPECT_EQ(ToBase64("foo"), "Zm9v");
+  EXPECT_EQ(ToBase64("foobar"), "Zm9vYmFy");
+  EXPECT_EQ(ToBase64("\xfb\xff"), "+/8=");
+
+  EXPECT_EQ(FromBase64("Zm9vYmFy"), "foobar");
+  EXPECT_EQ(FromBase64("Zm9vYg=="), "foob");
+  EXPECT_EQ(FromBase64("Zm9vYmE"), "fooba");
+  EXPECT_EQ(FromBase64("-_8"), "\xfb\xff");
+  EXPECT_EQ(FromBase64("Zm9v!Zm9v"), "foo");
+}
+
+TEST(HttpParseTest, EncodesUri) {
+  EXPECT_EQ(EncodeUri("a b/c~d.e_f-g"), "a%20b%2Fc~d.e_f-g");
+  EXPECT_EQ(EncodeUri("\xc5\xbc"), "%C5%BC");
+  EXPECT_EQ(DecodeUri("a%20b+c%2fd"), "a b c/d");
+  EXPECT_EQ(DecodeUri("100%"), "100%");
+  EXPECT_EQ(DecodeUri("%zz%4"), "%zz%4");
+  EXPECT_EQ(DecodeUri(EncodeUri("\xc5\xbc \x01")), "\xc5\xbc \x01");
+}
+
+TEST(HttpParseTest, LowerCasesAsciiLetters) {
+  EXPECT_EQ(ToLowerCase("Content-TYPE: Text/HTML; \xc3\x84@[`{"),
+            "content-type: text/html; \xc3\x84@[`{");
+}
+
+TEST(HttpParseTest, ParsesRanges) {
+  Range range = ParseRange("bytes=10-20");
+  EXPECT_EQ(range.start, 10);
+  EXPECT_EQ(range.end, 20);
+  range = ParseRange("bytes=5-");
+  EXPECT_EQ(range.start, 5);
+  EXPECT_EQ(range.end, std::nullopt);
+
+  std::vector<Range> ranges = ParseRanges("Bytes=0-9, 20-,30-39");
+  ASSERT_EQ(ranges.size(), 3);
+  EXPECT_EQ(ranges[0].start, 0);
+  EXPECT_EQ(ranges[0].end, 9);
+  EXPECT_EQ(ranges[1].start, 20);
+  EXPECT_EQ(ranges[1].end, std::nullopt);
+  EXPECT_EQ(ranges[2].start, 30);
+  EXPECT_EQ(ranges[2].end, 39);
+
+  std::array<Range, 1> single;
+  EXPECT_EQ(ParseRanges("bytes=0-1,2-3", single), std::nullopt);
+  for (std::string_view malformed :
+       {"bytes=", "bytes=-5", "bytes=5-4", "bytes=1-2x", "items=1-2", "",
+        "bytes=99999999999999999999-"}) {
+    EXPECT_TRUE(ParseRanges(malformed).empty()) << malformed;
+  }
+  EXPECT_EQ(ParseRange("bytes=0-1,2-3").start, 0);
+  EXPECT_EQ(ParseRange("bytes=0-1,2-3").end, std::nullopt);
+}
+
+TEST(HttpParseTest, FindsCookies) {
+  std::string_view cookies = "session=abc; lang = \"en\" ;xsession=def; a=%20b";
+  EXPECT_EQ(FindCookie(cookies, "session"), "abc");
+  EXPECT_EQ(FindCookie(cookies, "lang"), "en");
+  EXPECT_EQ(FindCookie(cookies, "xsession"), "def");
+  EXPECT_EQ(FindCookie(cookies, "sess"), std::nullopt);
+  EXPECT_EQ(GetCookie(cookies, "a"), " b");
+  EXPECT_EQ(GetCookie(cookies, "b"), std::nullopt);
+}
+
+TEST(HttpParseTest, ParsesTimes) {
+  EXPECT_EQ(ParseTime("1994-11-06T08:49:37Z"), 784111777);
+  EXPECT_EQ(ParseTime("1994-11-06T08:49:36.6Z"), 784111777);
+  EXPECT_EQ(ParseTime("1994-11-06T10:49:37+02:00"), 784111777);
+  EXPECT_EQ(ParseTime("1994-11-06T07:19:37-01:30"), 784111777);
+  EXPECT_THROW(ParseTime("1994-11-06 08:49:37Z"), InvalidArgument);
+  EXPECT_THROW(ParseTime("1994-13-06T08:49:37Z"), InvalidArgument);
+  EXPECT_THROW(ParseTime("1994-11-06T08:49:37"), InvalidArgument);
+  EXPECT_EQ(ToTimeString(784111777), "1994-11-06T08:49:37Z");
+
+  EXPECT_EQ(ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT"), 784111777);
+  EXPECT_EQ(ParseHttpDate("Sunday, 06-Nov-94 08:49:37 GMT"), std::nullopt);
+  EXPECT_EQ(ParseHttpDate("Sun, 06 Nov 1994 08:49:37 UTC"), std::nullopt);
+  EXPECT_EQ(ToHttpDate(784111777), "Sun, 06 Nov 1994 08:49:37 GMT");
+  EXPECT_TRUE(ParseHttpDate(GetCurrentHttpDate()).has_value());
+}
+
+TEST(HttpParseTest, FormatsResponseHeadParts) {
+  std::string output;
+  AppendStatusLine(output, 200);
+  AppendStatusLine(output, 404);
+  AppendChunkSize(output, 0);
+  AppendChunkSize(output, 0x1a2);
+  AppendChunkSize(output, UINT64_MAX);
+  EXPECT_EQ(output,
+            "HTTP/1.1 200 OK\r\n"
+            "HTTP/1.1 404 Not Found\r\n"
+            "0\r\n"
+            "1a2\r\n"
+            "ffffffffffffffff\r\n");
+  EXPECT_THROW(AppendStatusLine(output, 299), HttpException);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,80 @@
+#include "coro/http/http_request_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+#include "coro/http/http_exception.h"
+
+namespace coro::http {
+namespace {
+
+constexpr std::string_view kRequest =
+    "GET /path?a=b HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Accept:  */*  \r\n"
+    "\r\n";
+
+TEST(HttpRequestParserTest, ParsesRequestHead) {
+  HttpRequestParser parser;
+  EXPECT_EQ(parser.Parse(kRequest), kRequest.size());
+  ASSERT_TRUE(parser.done());
+  EXPECT_EQ(parser.method(), "GET");
+  EXPECT_EQ(parser.url(), "/path?a=b");
+  ASSERT_EQ(parser.header_count(), 2);
+  EXPECT_EQ(parser.header(0).name, "Host");
+  EXPECT_EQ(parser.header(0).value, "localhost");
+  EXPECT_EQ(parser.header(1).name, "Accept");
+  EXPECT_EQ(parser.header(1).value, "*/*");
+}
+
+TEST(HttpRequestParserTest, ParsesWholeRequestHeadInPlace) {
+  HttpRequestParser parser;
+  EXPECT_EQ(parser.Parse(kRequest), kRequest.size());
+  ASSERT_TRUE(parser.done());
+  EXPECT_EQ(parser.url().data(), kRequest.data() + 4);
+  EXPECT_EQ(parser.header(0).value.data(), kRequest.data() + 30);
+}
+
+TEST(HttpRequestParserTest, ParsesRequestHeadInPieces) {
+  HttpRequestParser parser;
+  for (size_t i = 0; i < kRequest.size(); i++) {
+    EXPECT_FALSE(parser.done());
+    EXPECT_EQ(parser.Parse(kRequest.substr(i, 1)), 1);
+  }
+  ASSERT_TRUE(parser.done());
+  EXPECT_EQ(parser.url(), "/path?a=b");
+  ASSERT_EQ(parser.header_count(), 2);
+  EXPECT_EQ(parser.header(1).value, "*/*");
+}
+
+TEST(HttpRequestParserTest, LeavesDataFollowingHead) {
+  std::string data = std::string(kRequest) + "body";
+  HttpRequestParser parser;
+  EXPECT_EQ(parser.Parse(data), kRequest.size());
+  EXPECT_TRUE(parser.done());
+
+  parser.Reset();
+  EXPECT_FALSE(parser.done());
+  EXPECT_EQ(parser.Parse(kRequest), kRequest.size());
+  EXPECT_TRUE(parser.done());
+}
+
+TEST(HttpRequestParserTest, RejectsMalformedInput) {
+  EXPECT_THROW(HttpRequestParser().Parse("GET /path\r\n"), HttpException);
+  EXPECT_THROW(HttpRequestParser().Parse("get /path HTTP/1.1\r\n"),
+               HttpException);
+  EXPECT_THROW(HttpRequestParser().Parse("GET /path HTTP/1.1\r\nHost\r\n"),
+               HttpException);
+  EXPECT_THROW(
+      HttpRequestParser().Parse("GET /path HTTP/1.1\r\nHo st: x\r\n"),
+      HttpException);
+}
+
+TEST(HttpRequestParserTest, RejectsTooLargeHead) {
+  HttpRequestParser parser(/*max_head_size=*/16);
+  EXPECT_THROW(parser.Parse(kRequest), HttpException);
+}
+
+}  // namespace
+}  // namespace coro::http
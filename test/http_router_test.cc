@@ -0,0 +1,117 @@
+#include "coro/http/http_router.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "coro/exception.h"
+
+namespace coro::http {
+namespace {
+
+// Responds with the route's name followed by the values of its parameters.
+RouteHandler Respond(std::string name) {
+  return [name = std::move(name)](
+             Request<>&, const PathParams& params,
+             stdx::stop_token) -> Task<Response<>> {
+    std::string body = name;
+    for (std::string_view param : {"id", "file", "path"}) {
+      if (auto value = params.Get(param)) {
+        body += " " + std::string(param) + "=" + std::string(*value);
+      }
+    }
+    co_return Response<>{.status = 200, .body = CreateBody(std::move(body))};
+  };
+}
+
+struct Result {
+  int status;
+  std::string body;
+  std::optional<std::string> allow;
+};
+
+Result Route(HttpRouter& router, Method method, std::string url) {
+  Result result{};
+  RunTask([&]() -> Task<> {
+    Request<> request{.url = std::move(url), .method = method};
+    Response<> response =
+        co_await router(std::move(request), stdx::stop_token());
+    result.status = response.status;
+    result.body = co_await GetBody(std::move(response.body));
+    result.allow = GetHeader(response.headers, "Allow");
+  });
+  return result;
+}
+
+TEST(HttpRouterTest, MatchesLiteralsBeforeParameters) {
+  HttpRouter router;
+  router.Add(Method::kGet, "/", Respond("root"))
+      .Add(Method::kGet, "/users/me", Respond("me"))
+      .Add(Method::kGet, "/users/{id}", Respond("user"))
+      .Add(Method::kGet, "/users/{id}/files/{file}", Respond("file"))
+      .Add(Method::kGet, "/users/me/settings", Respond("settings"))
+      .Add(Method::kGet, "/static/{path...}", Respond("static"));
+
+  EXPECT_EQ(Route(router, Method::kGet, "/").body, "root");
+  EXPECT_EQ(Route(router, Method::kGet, "/users/me").body, "me");
+  EXPECT_EQ(Route(router, Method::kGet, "/users/42?fields=name").body,
+            "user id=42");
+  EXPECT_EQ(Route(router, Method::kGet, "/users/me/files/a.txt").body,
+            "file id=me file=a.txt");
+  EXPECT_EQ(Route(router, Method::kGet, "/static/css/main.css").body,
+            "static path=css/main.css");
+  EXPECT_EQ(Route(router, Method::kGet, "/static/").body, "static path=");
+  EXPECT_EQ(Route(router, Method::kGet, "/users/").status, 404);
+  EXPECT_EQ(Route(router, Method::kGet, "/users/42/files").status, 404);
+}
+
+TEST(HttpRouterTest, RejectsOtherMethodsAndFallsBack) {
+  HttpRouter router;
+  router.Add(Method::kGet, "/items/{id}", Respond("get"))
+      .Add(Method::kDelete, "/items/{id}", Respond("delete"));
+
+  EXPECT_EQ(Route(router, Method::kDelete, "/items/1").body, "delete id=1");
+  Result result = Route(router, Method::kPut, "/items/1");
+  EXPECT_EQ(result.status, 405);
+  EXPECT_EQ(result.allow, "GET, DELETE");
+
+  EXPECT_EQ(Route(router, Method::kGet, "/other").status, 404);
+  router.SetFallback(
+      [](Request<> request, stdx::stop_token) -> Task<Response<>> {
+        co_return Response<>{.status = 200, .body = CreateBody(request.url)};
+      });
+  EXPECT_EQ(Route(router, Method::kGet, "/other").body, "/other");
+}
+
+TEST(HttpRouterTest, FallsBackToParametersForOtherMethods) {
+  HttpRouter router;
+  router.Add(Method::kGet, "/users/{id}", Respond("get"))
+      .Add(Method::kPost, "/users/new", Respond("new"))
+      .Add(Method::kGet, "/files/index", Respond("index"))
+      .Add(Method::kPut, "/files/{path...}", Respond("put"));
+
+  EXPECT_EQ(Route(router, Method::kGet, "/users/new").body, "get id=new");
+  EXPECT_EQ(Route(router, Method::kPost, "/users/new").body, "new");
+  EXPECT_EQ(Route(router, Method::kPut, "/files/index").body,
+            "put path=index");
+  Result result = Route(router, Method::kDelete, "/users/new");
+  EXPECT_EQ(result.status, 405);
+  EXPECT_EQ(result.allow, "GET, POST");
+}
+
+TEST(HttpRouterTest, RejectsInvalidRoutes) {
+  HttpRouter router;
+  router.Add(Method::kGet, "/a/{id}", Respond("a"));
+  EXPECT_THROW(router.Add(Method::kGet, "/a/{id}", Respond("a")),
+               InvalidArgument);
+  EXPECT_THROW(router.Add(Method::kGet, "/a/{name}/b", Respond("b")),
+               InvalidArgument);
+  EXPECT_THROW(router.Add(Method::kGet, "a", Respond("a")), InvalidArgument);
+  EXPECT_THROW(router.Add(Method::kGet, "/{rest...}/a", Respond("a")),
+               InvalidArgument);
+  EXPECT_THROW(router.Add(Method::kGet, "/a{b}", Respond("a")),
+               InvalidArgument);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,83 @@
+#ifndef CORO_HTTP_TEST_HTTP_SERVER_FIXTURE_H
+#define CORO_HTTP_TEST_HTTP_SERVER_FIXTURE_H
+
+#include <gtest/gtest.h>
+
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "coro/http/curl_http.h"
+#include "coro/http/http.h"
+#include "coro/http/http_server.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::http {
+
+// Runs a test's client against an HTTP server listening on a free port of
+// localhost, both on the fixture's event loop.
+class HttpServerFixture : public ::testing::Test {
+ protected:
+  static coro::util::TcpServer::Config GetLocalConfig() {
+    return {.address = "127.0.0.1", .port = 0};
+  }
+
+  // Serves `handler` while `client()` runs, then quits the server. Rethrows
+  // whatever either of them threw.
+  template <typename HttpHandlerT, typename F>
+  void Run(HttpHandlerT handler, F client) {
+    RunWithServer(
+        [&] {
+          return CreateHttpServer(std::move(handler), &event_loop_,
+                                  GetLocalConfig());
+        },
+        [&](auto&) { return client(); });
+  }
+
+  // Like Run, for a server returned by `create_server()`, which `client` is
+  // called with.
+  template <typename CreateServer, typename F>
+  void RunWithServer(CreateServer create_server, F client) {
+    std::exception_ptr exception;
+    RunTask([&]() -> Task<> {
+      try {
+        auto http_server = create_server();
+        address_ = "http://127.0.0.1:" + std::to_string(http_server.GetPort());
+        try {
+          co_await client(http_server);
+        } catch (...) {
+          exception = std::current_exception();
+        }
+        co_await http_server.Quit();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+    });
+    event_loop_.EnterLoop();
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  Task<std::string> FetchBody(std::string url) const {
+    auto response = co_await http_.Fetch(std::move(url));
+    co_return co_await GetBody(std::move(response.body));
+  }
+
+  // Base url of the running server, e.g. "http://127.0.0.1:1234".
+  std::string address() const { return address_.value(); }
+  coro::util::EventLoop* event_loop() { return &event_loop_; }
+  const Http& http() const { return http_; }
+
+ private:
+  coro::util::EventLoop event_loop_;
+  std::optional<std::string> address_;
+  Http http_{CurlHttp{&event_loop_}};
+};
+
+}  // namespace coro::http
+
+#endif  // CORO_HTTP_TEST_HTTP_SERVER_FIXTURE_H
@@ -1,12 +1,24 @@
 #include "coro/http/http_server.h"
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
+
 #include "coro/http/curl_http.h"
 #include "coro/shared_promise.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/file_slice.h"
 #include "coro/when_all.h"
+#include "http_server_fixture.h"
+#include "tcp_client_harness.h"
 
 namespace coro::http {
 namespace {
@@ -14,6 +26,9 @@ namespace {
 using Request = Request<>;
 using Response = Response<>;
 
+using ::coro::util::ConnectTo;
+using ::coro::util::Receive;
+using ::coro::util::RunWithClient;
 using ::testing::AllOf;
 using ::testing::Contains;
 using ::testing::HasSubstr;
@@ -190,7 +205,7 @@ TEST_F(HttpServerTest, ServesManyClients) {
                          .body = CreateBody(std::move(message))};
     }
 
-    Generator<std::string> CreateBody(std::string message) {
+    Generator<util::BufferSlice> CreateBody(std::string message) {
       co_await promise_.Get(stdx::stop_token());
       co_yield message;
     }
@@ -229,7 +244,7 @@ TEST_F(HttpServerTest, ServesManyClientsWithNoContentLength) {
       co_return Response{.status = 200, .body = CreateBody(std::move(message))};
     }
 
-    Generator<std::string> CreateBody(std::string message) {
+    Generator<util::BufferSlice> CreateBody(std::string message) {
       co_await promise_.Get(stdx::stop_token());
       co_yield message;
     }
@@ -263,7 +278,9 @@ TEST_F(HttpServerTest, ReadsResponseBodyConcurrently) {
                          .body = CreateBody("message" + request.url)};
     }
 
-    Generator<std::string> CreateBody(std::string message) { co_yield message; }
+    Generator<util::BufferSlice> CreateBody(std::string message) {
+      co_yield message;
+    }
   };
   Run(HttpHandler{}, [&]() -> Task<> {
     auto [r1, r2, r3] = co_await coro::WhenAll(http().Fetch(address() + "/1"),
@@ -294,7 +311,9 @@ TEST_F(HttpServerTest, CancelsHttpRequest) {
                          .body = CreateBody(std::move(message))};
     }
 
-    Generator<std::string> CreateBody(std::string message) { co_yield message; }
+    Generator<util::BufferSlice> CreateBody(std::string message) {
+      co_yield message;
+    }
 
    private:
     Promise<void>* semaphore_;
@@ -331,10 +350,10 @@ TEST_F(HttpServerTest, CancelsHttpRequestWhenReadingBody) {
                          .body = CreateBody(std::move(message))};
     }
 
-    Generator<std::string> CreateBody(std::string message) {
+    Generator<util::BufferSlice> CreateBody(std::string message) {
       request_received_->SetValue();
-      co_yield "wtf1";
-      co_yield "wtf2";
+      co_yield std::string("wtf1");
+      co_yield std::string("wtf2");
       co_await *semaphore_;
       co_yield message;
     }
@@ -387,10 +406,10 @@ TEST_F(HttpServerTest, ReadsChunkedResponse) {
       co_return Response{.status = 200, .body = CreateBody(std::move(message))};
     }
 
-    Generator<std::string> CreateBody(std::string message) {
+    Generator<util::BufferSlice> CreateBody(std::string message) {
       request_received_->SetValue();
-      co_yield "wtf1";
-      co_yield "wtf2";
+      co_yield std::string("wtf1");
+      co_yield std::string("wtf2");
       co_await *semaphore_;
       co_yield message;
     }
@@ -415,6 +434,45 @@ TEST_F(HttpServerTest, ReadsChunkedResponse) {
   });
 }
 
+TEST_F(HttpServerTest, SendsFileBody) {
+  char path[] = "/tmp/coro-http-file-body-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  std::string content(256 * 1024, 0);
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  ASSERT_EQ(write(fd, content.data(), content.size()),
+            static_cast<ssize_t>(content.size()));
+  close(fd);
+  auto file = coro::util::FileSlice::Open(path);
+  unlink(path);
+  ASSERT_EQ(file.size(), content.size());
+
+  std::vector<ResponseContent> responses;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        co_return Response{.status = 200,
+                           .file_body = request.url.ends_with("/part")
+                                            ? file.Subslice(1000, 100000)
+                                            : file};
+      },
+      [&]() -> Task<> {
+        responses.push_back(co_await ToResponseContent(
+            co_await http().Fetch(address() + "/")));
+        responses.push_back(co_await ToResponseContent(
+            co_await http().Fetch(address() + "/part")));
+      });
+
+  ASSERT_EQ(responses.size(), 2);
+  EXPECT_EQ(responses[0].status, 200);
+  EXPECT_THAT(responses[0].headers,
+              Contains(std::make_pair("content-length",
+                                      std::to_string(content.size()))));
+  EXPECT_EQ(responses[0].body, content);
+  EXPECT_EQ(responses[1].body, content.substr(1000, 100000));
+}
+
 TEST_F(HttpServerTest, HandlesServerSideInterrupt) {
   class HttpHandler {
    public:
@@ -426,13 +484,13 @@ TEST_F(HttpServerTest, HandlesServerSideInterrupt) {
                          .body = CreateBody(std::move(stop_token))};
     }
 
-    Generator<std::string> CreateBody(stdx::stop_token stop_token) {
+    Generator<util::BufferSlice> CreateBody(stdx::stop_token stop_token) {
       Promise<void> interrupt;
       stdx::stop_callback cb(
           stop_token, [&] { interrupt.SetException(InterruptedException()); });
       request_received_->SetValue();
-      co_yield "wtf1";
-      co_yield "wtf2";
+      co_yield std::string("wtf1");
+      co_yield std::string("wtf2");
       co_await interrupt;
     }
 
@@ -457,9 +515,9 @@ TEST_F(HttpServerTest, HandlesStreamingErrorGracefully) {
     }
 
    private:
-    static Generator<std::string> CreateBody() {
-      co_yield "wtf1";
-      co_yield "wtf2";
+    static Generator<util::BufferSlice> CreateBody() {
+      co_yield std::string("wtf1");
+      co_yield std::string("wtf2");
       throw http::HttpException(500, "streaming error");
     }
   };
@@ -655,5 +713,554 @@ TEST_F(HttpServerTest, IgnoresPartOfRequestBody) {
   EXPECT_EQ(last_body, "input42");
 }
 
+using MultiThreadedHttpServerTest = HttpServerFixture;
+
+TEST_F(MultiThreadedHttpServerTest, ServesRequestsOnAllThreads) {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<std::string> bodies;
+  RunWithServer(
+      [&] {
+        return CreateMultiThreadedHttpServer(
+            [&](const coro::util::EventLoop*) -> coro::http::HttpHandler {
+              return [&](Request request, stdx::stop_token) -> Task<Response> {
+                {
+                  std::lock_guard lock(mutex);
+                  threads.insert(std::this_thread::get_id());
+                }
+                std::string message = "message" + request.url;
+                auto size = message.size();
+                co_return Response{
+                    .status = 200,
+                    .headers = {{"Content-Length", std::to_string(size)}},
+                    .body = CreateBody(std::move(message))};
+              };
+            },
+            event_loop(), {.server = GetLocalConfig(), .thread_count = 2});
+      },
+      [&](auto&) -> Task<> {
+        // Connections are spread over the threads' listeners by a hash of the
+        // client's port, so with this many one thread is practically never
+        // left out.
+        std::vector<Task<std::string>> fetches;
+        for (int i = 0; i < 32; i++) {
+          fetches.push_back(FetchBody(address() + "/" + std::to_string(i)));
+        }
+        bodies = co_await coro::WhenAll(std::move(fetches));
+      });
+
+  ASSERT_EQ(bodies.size(), 32);
+  EXPECT_EQ(bodies[0], "message/0");
+  EXPECT_EQ(bodies[31], "message/31");
+  EXPECT_EQ(threads.size(), 2);
+}
+
+constexpr std::string_view kRawRequest = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+
+Task<Response> RespondOk(Request, stdx::stop_token) {
+  co_return Response{.status = 200,
+                     .headers = {{"Content-Length", "2"}},
+                     .body = CreateBody("ok")};
+}
+
+Task<Response> EchoBody(Request request, stdx::stop_token) {
+  std::string body;
+  if (request.body) {
+    body = co_await GetBody(std::move(*request.body));
+  }
+  co_return Response{.status = 200,
+                     .headers = {{"Content-Length", std::to_string(body.size())}},
+                     .body = CreateBody(std::move(body))};
+}
+
+// Creates a server serving `handler`, for RunWithClient.
+auto ServeHttp(const coro::util::TcpServer::Config& config,
+               const HttpServerConfig& http_config,
+               Task<Response> (*handler)(Request, stdx::stop_token) =
+                   RespondOk) {
+  return [=](const coro::util::EventLoop* event_loop) {
+    return CreateHttpServer(handler, event_loop, config, /*metrics=*/nullptr,
+                            http_config);
+  };
+}
+
+int CountOccurrences(std::string_view text, std::string_view pattern) {
+  int count = 0;
+  for (size_t i = text.find(pattern); i != std::string_view::npos;
+       i = text.find(pattern, i + 1)) {
+    count++;
+  }
+  return count;
+}
+
+TEST(HttpServerKeepAliveTest, ClosesConnectionAfterMaxRequests) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0},
+                {.max_requests_per_connection = 2}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string requests;
+        for (int i = 0; i < 3; i++) {
+          requests += kRawRequest;
+        }
+        send(fd, requests.data(), requests.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 2);
+  EXPECT_EQ(CountOccurrences(received, "Connection: keep-alive"), 1);
+  EXPECT_EQ(CountOccurrences(received, "Connection: close"), 1);
+}
+
+TEST(HttpServerKeepAliveTest, HonoursConnectionClose) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0}, {}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string request =
+            "GET / HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+        request += kRawRequest;
+        send(fd, request.data(), request.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 1);
+  EXPECT_THAT(received, HasSubstr("Connection: close"));
+}
+
+TEST(HttpServerKeepAliveTest, ClosesIdleConnection) {
+  auto start = std::chrono::steady_clock::now();
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0, .read_timeout_ms = 50}, {}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        send(fd, kRawRequest.data(), kRawRequest.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 1);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(HttpServerKeepAliveTest, PausesAcceptingAtMaxConnections) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0, .max_connections = 1}, {}),
+      [](uint16_t port) {
+        int first = ConnectTo(port);
+        send(first, kRawRequest.data(), kRawRequest.size(), 0);
+        std::string received = Receive(first, "ok");
+        // Connects through the listen backlog, but isn't served yet.
+        int second = ConnectTo(port);
+        send(second, kRawRequest.data(), kRawRequest.size(), 0);
+        timeval timeout{.tv_sec = 0, .tv_usec = 200 * 1000};
+        setsockopt(second, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        received += "|" + Receive(second, "ok") + "|";
+        close(first);
+        timeout.tv_sec = 5;
+        setsockopt(second, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        received += Receive(second, "ok");
+        close(second);
+        return received;
+      });
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 2);
+  EXPECT_THAT(received, HasSubstr("||"));
+  EXPECT_TRUE(received.ends_with("ok")) << received;
+}
+
+TEST(HttpServerKeepAliveTest, ClosesConnectionTricklingRequestHead) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0, .read_timeout_ms = 1000},
+                {.request_head_timeout = std::chrono::milliseconds(100)}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string_view head = "GET / HTTP/1.1\r\nHost: x\r\nX-Padding: ";
+        send(fd, head.data(), head.size(), MSG_NOSIGNAL);
+        // Each byte comes well within the read timeout.
+        for (int i = 0; i < 20; i++) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          if (send(fd, "a", 1, MSG_NOSIGNAL) != 1) {
+            break;
+          }
+        }
+        send(fd, "\r\n\r\n", 4, MSG_NOSIGNAL);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(received, "");
+}
+
+using HttpServerConfigTest = HttpServerFixture;
+
+TEST_F(HttpServerConfigTest, AppliesConfigWithoutMetrics) {
+  std::optional<std::string> connection;
+  RunWithServer(
+      [&] {
+        return CreateHttpServer(RespondOk, event_loop(), GetLocalConfig(),
+                                {.max_requests_per_connection = 1});
+      },
+      [&](auto&) -> Task<> {
+        auto response = co_await http().Fetch(address());
+        connection = GetHeader(response.headers, "Connection");
+        co_await GetBody(std::move(response.body));
+      });
+
+  EXPECT_EQ(connection, "close");
+}
+
+TEST(HttpServerRequestBodyTest, ReadsChunkSizeLineSplitAcrossWrites) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0}, {}, EchoBody),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string head =
+            "POST / HTTP/1.1\r\nHost: x\r\nConnection: close\r\n"
+            "Transfer-Encoding: chunked\r\n\r\n1";
+        send(fd, head.data(), head.size(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::string_view rest = "0\r\n0123456789abcdef\r\n0\r\n\r\n";
+        send(fd, rest.data(), rest.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_THAT(received, StartsWith("HTTP/1.1 200"));
+  EXPECT_TRUE(received.ends_with("\r\n\r\n0123456789abcdef")) << received;
+}
+
+TEST(HttpServerRequestBodyTest, RejectsTooLongChunkSizeLine) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0}, {}, EchoBody),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string_view request =
+            "POST / HTTP/1.1\r\nHost: x\r\nConnection: close\r\n"
+            "Transfer-Encoding: chunked\r\n\r\n000001\r\nx\r\n0\r\n\r\n";
+        send(fd, request.data(), request.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_THAT(received, StartsWith("HTTP/1.1 400"));
+}
+
+TEST(TcpServerMemoryTest, ReportsBytesBufferedOnConnections) {
+  constexpr uint32_t kRequestSize = 3000;
+  coro::util::EventLoop event_loop;
+  auto handler = [&](coro::util::TcpRequestDataProvider provider,
+                     stdx::stop_token stop_token)
+      -> Generator<coro::util::TcpResponseChunk> {
+    // Leaves the request unconsumed until the server quits.
+    co_await provider.Peek(kRequestSize);
+    co_yield std::string("ok");
+    co_await event_loop.Wait(60 * 1000, std::move(stop_token));
+  };
+  coro::util::TcpServerMemoryStats stats;
+  std::vector<coro::util::TcpConnectionMemoryStats> connections;
+  RunTask([&]() -> Task<> {
+    coro::util::TcpServer server(handler, &event_loop,
+                                 {.address = "127.0.0.1", .port = 0});
+    Promise<void> received;
+    std::thread client([&, port = server.GetPort()] {
+      int fd = ConnectTo(port);
+      std::string request(kRequestSize, 'x');
+      send(fd, request.data(), request.size(), 0);
+      Receive(fd, "ok");
+      event_loop.RunOnEventLoop([&] { received.SetValue(); });
+      Receive(fd);
+      close(fd);
+    });
+    co_await received;
+    stats = server.GetMemoryStats();
+    connections = server.GetConnectionMemoryStats();
+    co_await server.Quit();
+    client.join();
+  });
+  event_loop.EnterLoop();
+
+  EXPECT_EQ(stats.connection_count, 1);
+  EXPECT_EQ(stats.input_bytes, kRequestSize);
+  EXPECT_EQ(stats.output_bytes, 0);
+  EXPECT_EQ(stats.max_connection_bytes, kRequestSize);
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[0].peer_address, "127.0.0.1");
+  EXPECT_EQ(connections[0].input_bytes, kRequestSize);
+
+  EXPECT_THROW(coro::util::TcpServer(handler, &event_loop,
+                                     {.address = "127.0.0.1",
+                                      .port = 0,
+                                      .read_high_watermark = 1024}),
+               InvalidArgument);
+}
+
+class HttpServerIoUringTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!coro::util::EventLoop::IsIoUringSupported()) {
+      GTEST_SKIP() << "built without io_uring";
+    }
+    try {
+      coro::util::EventLoop event_loop(kEventLoopConfig);
+    } catch (const coro::RuntimeError& e) {
+      GTEST_SKIP() << e.what();
+    }
+  }
+
+  static constexpr coro::util::EventLoop::Config kEventLoopConfig = {
+      .io_backend = coro::util::IoBackend::kIoUring};
+};
+
+TEST_F(HttpServerIoUringTest, ServesPipelinedRequests) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0},
+                {.max_requests_per_connection = 2}),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string requests;
+        for (int i = 0; i < 3; i++) {
+          requests += kRawRequest;
+        }
+        send(fd, requests.data(), requests.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      },
+      kEventLoopConfig);
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 2);
+  EXPECT_EQ(CountOccurrences(received, "Connection: close"), 1);
+}
+
+TEST_F(HttpServerIoUringTest, EchoesLargeBody) {
+  std::string body(256 * 1024, 'x');
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0}, {}, EchoBody),
+      [&](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string request = "POST / HTTP/1.1\r\nHost: x\r\nContent-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body;
+        send(fd, request.data(), request.size(), 0);
+        std::string received = Receive(fd, body);
+        close(fd);
+        return received;
+      },
+      kEventLoopConfig);
+
+  EXPECT_THAT(received, StartsWith("HTTP/1.1 200"));
+  EXPECT_TRUE(received.ends_with(body));
+}
+
+constexpr std::string_view kRawRequestWithBody =
+    "POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 4\r\n\r\n";
+
+// Starts a request whose handler waits for the body, which the client sends
+// only later.
+int StartSlowRequest(uint16_t port) {
+  int fd = ConnectTo(port);
+  send(fd, kRawRequestWithBody.data(), kRawRequestWithBody.size(), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  return fd;
+}
+
+std::string FinishSlowRequest(int fd) {
+  send(fd, "body", 4, 0);
+  std::string received = Receive(fd, "body");
+  close(fd);
+  return received;
+}
+
+TEST(HttpServerAdmissionTest, ShedsRequestsPastInFlightLimit) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0},
+                {.admission = {.max_in_flight_requests = 1,
+                               .max_queued_requests = 1}},
+                EchoBody),
+      [](uint16_t port) {
+        int slow = StartSlowRequest(port);
+        int queued = ConnectTo(port);
+        send(queued, kRawRequest.data(), kRawRequest.size(), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int shed = ConnectTo(port);
+        send(shed, kRawRequest.data(), kRawRequest.size(), 0);
+        std::string received = Receive(shed, "\r\n\r\n") + "|";
+        close(shed);
+        received += FinishSlowRequest(slow) + "|";
+        received += Receive(queued, "\r\n\r\n");
+        close(queued);
+        return received;
+      });
+
+  EXPECT_THAT(received, StartsWith("HTTP/1.1 503"));
+  EXPECT_THAT(received, HasSubstr("Retry-After: 1\r\n"));
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 2);
+  EXPECT_TRUE(received.ends_with("Content-Length: 0\r\n"
+                                 "Connection: keep-alive\r\n\r\n"))
+      << received;
+}
+
+TEST(HttpServerAdmissionTest, LimitsRequestsPerClient) {
+  std::string received = RunWithClient(
+      ServeHttp({.address = "127.0.0.1", .port = 0},
+                {.admission = {.max_requests_per_client = 1}}, EchoBody),
+      [](uint16_t port) {
+        int slow = StartSlowRequest(port);
+        int shed = ConnectTo(port);
+        send(shed, kRawRequestWithBody.data(), kRawRequestWithBody.size(), 0);
+        // The unread body makes the server close the connection.
+        std::string received = Receive(shed) + "|";
+        close(shed);
+        return received + FinishSlowRequest(slow);
+      });
+
+  EXPECT_THAT(received, StartsWith("HTTP/1.1 503"));
+  EXPECT_THAT(received, HasSubstr("Connection: close\r\n\r\n|"));
+  EXPECT_THAT(received, HasSubstr("HTTP/1.1 200"));
+  EXPECT_TRUE(received.ends_with("body")) << received;
+}
+
+using MultiThreadedHttpServerAdmissionTest = HttpServerFixture;
+
+TEST_F(MultiThreadedHttpServerAdmissionTest, SharesClientLimitBetweenThreads) {
+  std::string received;
+  RunWithServer(
+      [&] {
+        return CreateMultiThreadedHttpServer(
+            [](const coro::util::EventLoop*) -> coro::http::HttpHandler {
+              return EchoBody;
+            },
+            event_loop(), {.server = GetLocalConfig(), .thread_count = 2},
+            {.admission = {.max_requests_per_client = 1}});
+      },
+      [&](auto& http_server) -> Task<> {
+        // The server threads have loops of their own, so blocking this one
+        // is fine.
+        int slow = StartSlowRequest(http_server.GetPort());
+        // Whichever thread gets them, the connections count against the same
+        // client.
+        for (int i = 0; i < 8; i++) {
+          int shed = ConnectTo(http_server.GetPort());
+          send(shed, kRawRequest.data(), kRawRequest.size(), 0);
+          received += Receive(shed, "\r\n\r\n");
+          close(shed);
+        }
+        received += FinishSlowRequest(slow);
+        co_return;
+      });
+
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 503"), 8);
+  EXPECT_EQ(CountOccurrences(received, "HTTP/1.1 200"), 1);
+}
+
+using HttpServerMetricsTest = HttpServerFixture;
+
+TEST_F(HttpServerMetricsTest, RecordsRequestMetrics) {
+  std::vector<std::string> slow_requests;
+  HttpServerMetrics metrics(
+      {.slow_request_threshold = std::chrono::microseconds(0),
+       .on_slow_request = [&](const HttpRequestStats& stats) {
+         slow_requests.emplace_back(stats.url);
+       }});
+  int connection_count = -1;
+  RunWithServer(
+      [&] {
+        return CreateHttpServer(
+            [](Request request, stdx::stop_token) -> Task<Response> {
+              if (request.url.starts_with("/error")) {
+                throw HttpException(HttpException::kNotFound);
+              }
+              co_return Response{.status = 200,
+                                 .headers = {{"Content-Length", "7"}},
+                                 .body = CreateBody("message")};
+            },
+            event_loop(), GetLocalConfig(), &metrics);
+      },
+      [&](auto& http_server) -> Task<> {
+        for (std::string path : {"/a?x=1", "/a?x=2", "/error"}) {
+          co_await FetchBody(address() + path);
+        }
+        connection_count = http_server.GetConnectionCount();
+      });
+
+  EXPECT_EQ(connection_count, 1);
+  EXPECT_EQ(slow_requests,
+            (std::vector<std::string>{"/a?x=1", "/a?x=2", "/error"}));
+  HttpServerMetrics::Snapshot snapshot = metrics.GetSnapshot();
+  EXPECT_EQ(snapshot.open_connection_count, 0);
+  EXPECT_EQ(snapshot.in_flight_request_count, 0);
+  EXPECT_EQ(snapshot.reused_connection_request_count, 2);
+  EXPECT_EQ(snapshot.head_parse.count(), 3);
+  ASSERT_EQ(snapshot.routes.size(), 2);
+  const auto& route = snapshot.routes.at("GET /a");
+  EXPECT_EQ(route.request_count, 2);
+  EXPECT_EQ(route.error_count, 0);
+  EXPECT_GT(route.bytes_received, 0);
+  EXPECT_GT(route.bytes_sent, 14);
+  EXPECT_EQ(route.total.count(), 2);
+  EXPECT_EQ(snapshot.routes.at("GET /error").request_count, 1);
+}
+
+TEST_F(HttpServerMetricsTest, MergesMetricsOfAllThreads) {
+  HttpServerMetrics metrics({.max_route_count = 2});
+  RunWithServer(
+      [&] {
+        return CreateMultiThreadedHttpServer(
+            [](const coro::util::EventLoop*) -> coro::http::HttpHandler {
+              return [](Request, stdx::stop_token) -> Task<Response> {
+                co_return Response{.status = 200,
+                                   .headers = {{"Content-Length", "2"}},
+                                   .body = CreateBody("ok")};
+              };
+            },
+            event_loop(), {.server = GetLocalConfig(), .thread_count = 2},
+            &metrics);
+      },
+      [&](auto&) -> Task<> {
+        std::vector<Task<std::string>> fetches;
+        for (int i = 0; i < 32; i++) {
+          fetches.push_back(FetchBody(address() + "/" + std::to_string(i % 4)));
+        }
+        co_await coro::WhenAll(std::move(fetches));
+      });
+
+  HttpServerMetrics::Snapshot snapshot = metrics.GetSnapshot();
+  EXPECT_EQ(snapshot.head_parse.count(), 32);
+  ASSERT_EQ(snapshot.routes.size(), 3);
+  uint64_t request_count = 0;
+  uint64_t total_count = 0;
+  for (const auto& [route, stats] : snapshot.routes) {
+    request_count += stats.request_count;
+    total_count += stats.total.count();
+  }
+  EXPECT_EQ(request_count, 32);
+  EXPECT_EQ(total_count, 32);
+  EXPECT_TRUE(snapshot.routes.contains("other"));
+}
+
+TEST_F(HttpServerMetricsTest, CountsHandlersInEventLoopMetrics) {
+  event_loop()->ResetMetrics();
+  Run(
+      [](Request, stdx::stop_token) -> Task<Response> {
+        // Blocks the loop, as a handler doing too much work would.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Length", "7"}},
+                           .body = CreateBody("message")};
+      },
+      [&]() -> Task<> { co_await FetchBody(address()); });
+
+  EXPECT_GE(event_loop()->GetMetrics().max_callback_duration,
+            std::chrono::milliseconds(50));
+}
+
 }  // namespace
 }  // namespace coro::http
@@ -0,0 +1,56 @@
+#include "coro/http/http.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unordered_set>
+
+namespace coro::http {
+namespace {
+
+Request<std::string> GetRequest(std::string url) {
+  return {.url = std::move(url),
+          .headers = {{"Accept", "application/json"}, {"X-Id", "1"}}};
+}
+
+TEST(RequestFingerprintTest, IgnoresIrrelevantDifferences) {
+  RequestFingerprint fingerprint =
+      GetFingerprint(GetRequest("https://host/path?q=1"));
+
+  EXPECT_EQ(GetFingerprint(GetRequest("HTTPS://Host/path?q=1#fragment")),
+            fingerprint);
+  auto reordered = GetRequest("https://host/path?q=1");
+  std::swap(reordered.headers[0], reordered.headers[1]);
+  reordered.headers[0].first = "x-id";
+  EXPECT_EQ(GetFingerprint(reordered), fingerprint);
+  auto with_timeouts = GetRequest("https://host/path?q=1");
+  with_timeouts.timeouts.total = std::chrono::milliseconds(100);
+  EXPECT_EQ(GetFingerprint(with_timeouts), fingerprint);
+}
+
+TEST(RequestFingerprintTest, DistinguishesRequests) {
+  std::unordered_set<RequestFingerprint> fingerprints;
+  fingerprints.insert(GetFingerprint(GetRequest("https://host/path")));
+  fingerprints.insert(GetFingerprint(GetRequest("https://host/Path")));
+  fingerprints.insert(GetFingerprint(GetRequest("https://host/path?q")));
+  auto head = GetRequest("https://host/path");
+  head.method = Method::kHead;
+  fingerprints.insert(GetFingerprint(head));
+  auto other_accept = GetRequest("https://host/path");
+  other_accept.headers[0].second = "application/xml";
+  fingerprints.insert(GetFingerprint(other_accept));
+  auto extra_header = GetRequest("https://host/path");
+  extra_header.headers.emplace_back("Authorization", "token");
+  fingerprints.insert(GetFingerprint(extra_header));
+  auto empty_body = GetRequest("https://host/path");
+  empty_body.body = "";
+  fingerprints.insert(GetFingerprint(empty_body));
+  auto body = GetRequest("https://host/path");
+  body.body = std::string(100, 'x');
+  fingerprints.insert(GetFingerprint(body));
+
+  EXPECT_EQ(fingerprints.size(), 8);
+}
+
+}  // namespace
+}  // namespace coro::http
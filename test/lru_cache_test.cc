@@ -0,0 +1,108 @@
+#include "coro/util/lru_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/task.h"
+
+namespace coro::util {
+namespace {
+
+// Produces "value<key>", after `release` is set if it's given.
+struct Factory {
+  Task<std::string> operator()(int key, stdx::stop_token) const {
+    produced->push_back(key);
+    if (release) {
+      Promise<void>& released = *release;
+      co_await released;
+    }
+    co_return "value" + std::to_string(key);
+  }
+
+  std::vector<int>* produced;
+  Promise<void>* release = nullptr;
+};
+
+// Weighs values by their length.
+struct LengthWeigher {
+  size_t operator()(int, const std::string& value) const {
+    return value.size();
+  }
+};
+
+template <typename Cache>
+Task<> GetAll(Cache& cache, std::vector<int> keys) {
+  for (int key : keys) {
+    co_await cache.Get(key, stdx::stop_token());
+  }
+}
+
+TEST(LRUCacheTest, EvictsLeastRecentlyUsedValue) {
+  std::vector<int> produced;
+  LRUCache<int, Factory> cache(2, Factory{.produced = &produced});
+  // The second access to 1 makes 2 the least recently used value.
+  RunTask(GetAll(cache, {1, 2, 1, 3, 1}));
+
+  EXPECT_EQ(produced, (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(cache.GetCached(1), "value1");
+  EXPECT_EQ(cache.GetCached(2), std::nullopt);
+  EXPECT_EQ(cache.GetCached(3), "value3");
+}
+
+TEST(LRUCacheTest, SharesAndKeepsValueBeingProduced) {
+  std::vector<int> produced;
+  Promise<void> release;
+  LRUCache<int, Factory> cache(
+      1, Factory{.produced = &produced, .release = &release});
+  std::vector<std::string> values;
+  for (int i = 0; i < 2; i++) {
+    RunTask([&]() -> Task<> {
+      values.push_back(co_await cache.Get(1, stdx::stop_token()));
+    });
+  }
+  cache.Put(2, "put2");
+  cache.Put(3, "put3");
+  release.SetValue();
+
+  EXPECT_EQ(produced, (std::vector<int>{1}));
+  EXPECT_EQ(values, (std::vector<std::string>{"value1", "value1"}));
+  EXPECT_EQ(cache.GetCached(1), "value1");
+  EXPECT_EQ(cache.GetCached(3), std::nullopt);
+}
+
+TEST(LRUCacheTest, EvictsValuesUntilWithinWeightBudget) {
+  std::vector<int> produced;
+  LRUCache<int, Factory, std::hash<int>, LengthWeigher> cache(
+      100, /*max_weight=*/14, Factory{.produced = &produced});
+  RunTask(GetAll(cache, {1, 2}));
+  EXPECT_EQ(cache.weight(), 12);
+
+  // Doesn't fit next to both others, so the least recently used one goes.
+  cache.Put(3, "value333");
+
+  EXPECT_EQ(cache.weight(), 14);
+  EXPECT_EQ(cache.GetCached(1), std::nullopt);
+  EXPECT_EQ(cache.GetCached(2), "value2");
+  EXPECT_EQ(cache.GetCached(3), "value333");
+}
+
+TEST(LRUCacheTest, ReturnsValueHeavierThanBudgetWithoutKeepingIt) {
+  std::vector<int> produced;
+  LRUCache<int, Factory, std::hash<int>, LengthWeigher> cache(
+      100, /*max_weight=*/5, Factory{.produced = &produced});
+  std::optional<std::string> value;
+  RunTask([&]() -> Task<> {
+    value = co_await cache.Get(1, stdx::stop_token());
+  });
+
+  EXPECT_EQ(value, "value1");
+  EXPECT_EQ(cache.GetCached(1), std::nullopt);
+  EXPECT_EQ(cache.weight(), 0);
+}
+
+}  // namespace
+}  // namespace coro::util
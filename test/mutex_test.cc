@@ -0,0 +1,163 @@
+#include "coro/mutex.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/task.h"
+
+namespace coro {
+namespace {
+
+TEST(MutexTest, HandsLockToWaitersInOrder) {
+  Mutex mutex;
+  std::vector<int> order;
+  Promise<void> release;
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    co_await release;
+    order.push_back(0);
+  });
+  for (int i = 1; i <= 3; i++) {
+    RunTask([&, i]() -> Task<> {
+      auto lock = co_await UniqueLock::Create(&mutex);
+      order.push_back(i);
+    });
+  }
+  EXPECT_TRUE(order.empty());
+  release.SetValue();
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+
+  bool locked = false;
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    locked = true;
+  });
+  EXPECT_TRUE(locked);
+}
+
+TEST(ReadWriteMutexTest, WakesQueuedReadersTogether) {
+  ReadWriteMutex mutex;
+  std::string events;
+  Promise<void> write_done;
+  std::vector<Promise<void>> reads_done(3);
+  RunTask([&]() -> Task<> {
+    auto lock = co_await WriteLock::Create(&mutex);
+    co_await write_done;
+    events += 'W';
+  });
+  for (int i = 0; i < 3; i++) {
+    RunTask([&, i]() -> Task<> {
+      auto lock = co_await ReadLock::Create(&mutex);
+      events += 'r';
+      Promise<void>& read_done = reads_done[i];
+      co_await read_done;
+      events += 'R';
+    });
+  }
+  RunTask([&]() -> Task<> {
+    auto lock = co_await WriteLock::Create(&mutex);
+    events += 'w';
+  });
+  EXPECT_EQ(events, "");
+  write_done.SetValue();
+  EXPECT_EQ(events, "Wrrr");
+  reads_done[0].SetValue();
+  reads_done[1].SetValue();
+  EXPECT_EQ(events, "WrrrRR");
+  reads_done[2].SetValue();
+  EXPECT_EQ(events, "WrrrRRRw");
+}
+
+TEST(ReadWriteMutexTest, PhaseFairReadersWaitForQueuedWriters) {
+  for (auto policy : {ReadWriteMutex::Policy::kPreferReaders,
+                      ReadWriteMutex::Policy::kPhaseFair}) {
+    ReadWriteMutex mutex(policy);
+    std::string events;
+    Promise<void> read_done;
+    RunTask([&]() -> Task<> {
+      auto lock = co_await ReadLock::Create(&mutex);
+      co_await read_done;
+      events += 'R';
+    });
+    RunTask([&]() -> Task<> {
+      auto lock = co_await WriteLock::Create(&mutex);
+      events += 'W';
+    });
+    RunTask([&]() -> Task<> {
+      auto lock = co_await ReadLock::Create(&mutex);
+      events += 'r';
+    });
+    read_done.SetValue();
+    EXPECT_EQ(events, policy == ReadWriteMutex::Policy::kPhaseFair ? "RWr"
+                                                                   : "rRW");
+  }
+}
+
+TEST(SemaphoreTest, BoundsConcurrency) {
+  Semaphore semaphore(2);
+  int running = 0;
+  int max_running = 0;
+  int finished = 0;
+  std::vector<Promise<void>> done(5);
+  for (int i = 0; i < 5; i++) {
+    RunTask([&, i]() -> Task<> {
+      auto lock = co_await SemaphoreLock::Create(&semaphore);
+      running++;
+      max_running = std::max(max_running, running);
+      Promise<void>& task_done = done[i];
+      co_await task_done;
+      running--;
+      finished++;
+    });
+  }
+  EXPECT_EQ(running, 2);
+  EXPECT_EQ(semaphore.available(), 0);
+  EXPECT_FALSE(semaphore.TryAcquire());
+  for (Promise<void>& promise : done) {
+    promise.SetValue();
+  }
+  EXPECT_EQ(finished, 5);
+  EXPECT_EQ(max_running, 2);
+  EXPECT_EQ(semaphore.available(), 2);
+  EXPECT_TRUE(semaphore.TryAcquire());
+  semaphore.Release();
+}
+
+TEST(SemaphoreTest, DequeuesCancelledWaiters) {
+  Semaphore semaphore(1);
+  stdx::stop_source stop_source;
+  std::string events;
+  Promise<void> release;
+  RunTask([&]() -> Task<> {
+    auto lock = co_await SemaphoreLock::Create(&semaphore);
+    co_await release;
+  });
+  RunTask([&]() -> Task<> {
+    try {
+      auto lock =
+          co_await SemaphoreLock::Create(&semaphore, stop_source.get_token());
+      events += "a";
+    } catch (const InterruptedException&) {
+      events += "i";
+    }
+  });
+  RunTask([&]() -> Task<> {
+    auto lock = co_await SemaphoreLock::Create(&semaphore);
+    events += "b";
+  });
+
+  stop_source.request_stop();
+  EXPECT_EQ(events, "i");
+  release.SetValue();
+  EXPECT_EQ(events, "ib");
+  EXPECT_EQ(semaphore.available(), 1);
+}
+
+}  // namespace
+}  // namespace coro
@@ -0,0 +1,291 @@
+#include "coro/nfs/nfs_server.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "coro/nfs/inode_table.h"
+#include "coro/nfs/nfs_exception.h"
+#include "coro/rpc/rpc_server.h"
+#include "coro/stdx/coroutine.h"
+
+namespace coro::nfs {
+namespace {
+
+using ::coro::rpc::RpcRequest;
+using ::coro::rpc::RpcResponse;
+using ::coro::rpc::RpcResponseAcceptedBody;
+using ::coro::rpc::XdrSerializer;
+
+constexpr uint32_t kNfsProgId = 100003;
+constexpr uint32_t kMountProgId = 100005;
+constexpr uint32_t kGetAttrProcId = 1;
+constexpr uint32_t kLookupProcId = 3;
+constexpr uint32_t kReadProcId = 6;
+constexpr uint32_t kReadDirPlusProcId = 17;
+
+class MemoryData {
+ public:
+  explicit MemoryData(std::vector<uint8_t> data) : data_(std::move(data)) {}
+
+  Task<std::span<const uint8_t>> Peek(uint32_t) {
+    co_return std::span<const uint8_t>(data_).subspan(offset_);
+  }
+  void Consume(uint32_t byte_cnt) { offset_ += byte_cnt; }
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t offset_ = 0;
+};
+
+class XdrReader {
+ public:
+  explicit XdrReader(std::vector<uint8_t> data) : data_(std::move(data)) {}
+
+  uint32_t GetUInt32() { return rpc::ParseUInt32(Take(4)); }
+  uint64_t GetUInt64() { return rpc::ParseUInt64(Take(8)); }
+  std::vector<uint8_t> GetOpaque() {
+    uint32_t size = GetUInt32();
+    auto data = Take((size + 3) / 4 * 4).first(size);
+    return std::vector<uint8_t>(data.begin(), data.end());
+  }
+  std::string GetString() {
+    std::vector<uint8_t> data = GetOpaque();
+    return std::string(data.begin(), data.end());
+  }
+  // Returns the size of the optional attributes, which are skipped.
+  uint64_t SkipAttributes() {
+    EXPECT_EQ(GetUInt32(), 1u);
+    auto attributes = Take(84);
+    return rpc::ParseUInt64(attributes.subspan(20, 8));
+  }
+  bool empty() const { return offset_ == data_.size(); }
+
+ private:
+  std::span<const uint8_t> Take(size_t size) {
+    EXPECT_LE(offset_ + size, data_.size());
+    auto data = std::span<const uint8_t>(data_).subspan(offset_, size);
+    offset_ += size;
+    return data;
+  }
+
+  std::vector<uint8_t> data_;
+  size_t offset_ = 0;
+};
+
+class FakeBackend : public NfsBackend {
+ public:
+  void AddFile(std::string path, std::string content) {
+    files_[std::move(path)] = std::move(content);
+  }
+  void AddDirectory(std::string path, std::vector<std::string> entries) {
+    directories_[std::move(path)] = std::move(entries);
+  }
+
+  Task<NfsAttributes> GetAttributes(std::string path,
+                                    stdx::stop_token) override {
+    get_attributes_count++;
+    co_return GetAttributes(path);
+  }
+
+  Task<std::vector<NfsDirectoryEntry>> ListDirectory(
+      std::string path, stdx::stop_token) override {
+    list_directory_count++;
+    std::vector<NfsDirectoryEntry> entries;
+    for (const std::string& name : directories_.at(path)) {
+      std::string entry_path = path == "/" ? "/" + name : path + "/" + name;
+      entries.push_back(
+          {.name = name, .attributes = GetAttributes(entry_path)});
+    }
+    co_return entries;
+  }
+
+  Task<std::string> Read(std::string path, uint64_t offset, uint32_t size,
+                         stdx::stop_token) override {
+    read_count++;
+    co_return files_.at(path).substr(offset, size);
+  }
+
+  int get_attributes_count = 0;
+  int list_directory_count = 0;
+  int read_count = 0;
+
+ private:
+  NfsAttributes GetAttributes(const std::string& path) const {
+    if (auto it = files_.find(path); it != files_.end()) {
+      return {.size = it->second.size()};
+    }
+    if (auto it = directories_.find(path); it != directories_.end()) {
+      return {.type = NfsFileType::kDirectory, .size = it->second.size()};
+    }
+    throw NfsException(NfsStatus::kNoEnt);
+  }
+
+  std::map<std::string, std::string> files_;
+  std::map<std::string, std::vector<std::string>> directories_;
+};
+
+std::vector<uint8_t> Call(NfsServer& server, uint32_t prog, uint32_t proc,
+                          std::vector<uint8_t> arguments) {
+  std::vector<uint8_t> reply;
+  RunTask([&]() -> Task<> {
+    RpcRequest request{
+        .xid = 1,
+        .body = {.rpcvers = 2,
+                 .prog = prog,
+                 .vers = 3,
+                 .proc = proc,
+                 .data = util::TcpRequestDataProvider(
+                     MemoryData(std::move(arguments)))}};
+    RpcResponse response =
+        co_await server.HandleCall(std::move(request), stdx::stop_token());
+    auto& body = std::get<RpcResponseAcceptedBody>(response.body.body);
+    EXPECT_EQ(body.stat, RpcResponseAcceptedBody::Stat::kSuccess);
+    FOR_CO_AWAIT(const util::TcpResponseChunk& chunk, body.data) {
+      reply.insert(reply.end(), chunk.chunk().begin(), chunk.chunk().end());
+    }
+  });
+  return reply;
+}
+
+std::vector<uint8_t> Mount(NfsServer& server) {
+  std::vector<uint8_t> arguments;
+  XdrSerializer{&arguments}.Put(std::string_view("/"));
+  XdrReader reply(Call(server, kMountProgId, 1, std::move(arguments)));
+  EXPECT_EQ(reply.GetUInt32(), 0u);
+  return reply.GetOpaque();
+}
+
+std::vector<uint8_t> Lookup(NfsServer& server,
+                            const std::vector<uint8_t>& directory,
+                            std::string_view name) {
+  std::vector<uint8_t> arguments;
+  XdrSerializer{&arguments}.Put(std::span(directory)).Put(name);
+  XdrReader reply(
+      Call(server, kNfsProgId, kLookupProcId, std::move(arguments)));
+  EXPECT_EQ(reply.GetUInt32(), 0u);
+  return reply.GetOpaque();
+}
+
+TEST(InodeTableTest, AssignsStableIdsToPaths) {
+  InodeTable table;
+  uint64_t a = table.GetId(InodeTable::kRootId, "a");
+  uint64_t b = table.GetId(a, "b");
+
+  EXPECT_NE(a, InodeTable::kRootId);
+  EXPECT_EQ(table.GetId(InodeTable::kRootId, "a"), a);
+  EXPECT_EQ(table.Find(a, "b"), b);
+  EXPECT_EQ(table.Find(InodeTable::kRootId, "b"), std::nullopt);
+  EXPECT_EQ(table.GetPath(InodeTable::kRootId), "/");
+  EXPECT_EQ(table.GetPath(b), "/a/b");
+  EXPECT_EQ(table.GetParent(b), a);
+  EXPECT_EQ(table.GetParent(InodeTable::kRootId), InodeTable::kRootId);
+  EXPECT_TRUE(table.Contains(b));
+  EXPECT_FALSE(table.Contains(b + 1));
+  EXPECT_EQ(table.size(), 3);
+}
+
+TEST(NfsServerTest, LooksUpAndReadsFiles) {
+  FakeBackend backend;
+  backend.AddDirectory("/", {"dir"});
+  backend.AddDirectory("/dir", {"file.txt"});
+  backend.AddFile("/dir/file.txt", "hello world");
+  NfsServer server(&backend);
+
+  std::vector<uint8_t> root = Mount(server);
+  std::vector<uint8_t> file =
+      Lookup(server, Lookup(server, root, "dir"), "file.txt");
+
+  std::vector<uint8_t> arguments;
+  XdrSerializer{&arguments}.Put(std::span(file)).PutAll(uint64_t(6), 16u);
+  XdrReader reply(Call(server, kNfsProgId, kReadProcId, std::move(arguments)));
+  EXPECT_EQ(reply.GetUInt32(), 0u);
+  EXPECT_EQ(reply.SkipAttributes(), 11u);
+  EXPECT_EQ(reply.GetUInt32(), 5u);
+  EXPECT_EQ(reply.GetUInt32(), 1u);
+  EXPECT_EQ(reply.GetString(), "world");
+  EXPECT_TRUE(reply.empty());
+
+  std::vector<uint8_t> missing;
+  XdrSerializer{&missing}.Put(std::span(root)).Put(std::string_view("nope"));
+  XdrReader missing_reply(
+      Call(server, kNfsProgId, kLookupProcId, std::move(missing)));
+  EXPECT_EQ(missing_reply.GetUInt32(), uint32_t(NfsStatus::kNoEnt));
+}
+
+TEST(NfsServerTest, RejectsForeignHandles) {
+  FakeBackend backend;
+  backend.AddDirectory("/", {});
+  NfsServer server(&backend);
+  std::vector<uint8_t> handle = Mount(server);
+  handle[0] ^= 1;
+
+  std::vector<uint8_t> arguments;
+  XdrSerializer{&arguments}.Put(std::span(handle));
+  XdrReader reply(
+      Call(server, kNfsProgId, kGetAttrProcId, std::move(arguments)));
+  EXPECT_EQ(reply.GetUInt32(), uint32_t(NfsStatus::kStale));
+  EXPECT_TRUE(reply.empty());
+}
+
+TEST(NfsServerTest, PagesListingAndCachesAttributesOfEntries) {
+  FakeBackend backend;
+  std::vector<std::string> names;
+  for (int i = 0; i < 7; i++) {
+    names.push_back("file" + std::to_string(i));
+    backend.AddFile("/" + names.back(), std::string(i, 'x'));
+  }
+  backend.AddDirectory("/", names);
+  NfsServer server(&backend);
+  std::vector<uint8_t> root = Mount(server);
+
+  std::vector<std::string> listed;
+  std::vector<std::vector<uint8_t>> handles;
+  uint64_t cookie = 0;
+  uint64_t verifier = 0;
+  int pages = 0;
+  for (bool eof = false; !eof; pages++) {
+    std::vector<uint8_t> arguments;
+    // Room for the reply and three entries with names of 5 characters.
+    XdrSerializer{&arguments}.Put(std::span(root)).PutAll(
+        cookie, verifier, 4096u, 108u + 3 * 144u);
+    XdrReader reply(
+        Call(server, kNfsProgId, kReadDirPlusProcId, std::move(arguments)));
+    ASSERT_EQ(reply.GetUInt32(), 0u);
+    reply.SkipAttributes();
+    verifier = reply.GetUInt64();
+    while (reply.GetUInt32() == 1) {
+      reply.GetUInt64();
+      listed.push_back(reply.GetString());
+      cookie = reply.GetUInt64();
+      EXPECT_EQ(reply.SkipAttributes(), listed.size() - 1);
+      EXPECT_EQ(reply.GetUInt32(), 1u);
+      handles.push_back(reply.GetOpaque());
+    }
+    eof = reply.GetUInt32();
+    EXPECT_TRUE(reply.empty());
+  }
+  EXPECT_EQ(pages, 3);
+  EXPECT_EQ(listed, names);
+  EXPECT_EQ(backend.list_directory_count, 1);
+
+  int get_attributes_count = backend.get_attributes_count;
+  std::vector<uint8_t> arguments;
+  XdrSerializer{&arguments}.Put(std::span(handles[4]));
+  XdrReader reply(
+      Call(server, kNfsProgId, kGetAttrProcId, std::move(arguments)));
+  EXPECT_EQ(reply.GetUInt32(), 0u);
+  EXPECT_EQ(backend.get_attributes_count, get_attributes_count);
+
+  std::vector<uint8_t> stale_cookie;
+  XdrSerializer{&stale_cookie}.Put(std::span(root)).PutAll(
+      uint64_t(1), verifier + 1, 4096u, 4096u);
+  XdrReader stale_reply(
+      Call(server, kNfsProgId, kReadDirPlusProcId, std::move(stale_cookie)));
+  EXPECT_EQ(stale_reply.GetUInt32(), uint32_t(NfsStatus::kBadCookie));
+}
+
+}  // namespace
+}  // namespace coro::nfs
@@ -0,0 +1,66 @@
+#include "coro/http/parallel_download.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/http/http_parse.h"
+#include "http_server_fixture.h"
+
+namespace coro::http {
+namespace {
+
+using Request = Request<>;
+using Response = Response<>;
+
+using ::testing::Contains;
+
+using ParallelDownloadTest = HttpServerFixture;
+
+TEST_F(ParallelDownloadTest, ReassemblesRangesAndRetriesFailedOnes) {
+  std::string content;
+  for (int i = 0; i < 1000; i++) {
+    content += std::to_string(i) + ",";
+  }
+  std::vector<std::string> ranges;
+  int failed_request_count = 0;
+  std::string received;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        auto header = FindHeader(request.headers, "Range");
+        if (!header) {
+          co_return Response{.status = 400};
+        }
+        ranges.emplace_back(*header);
+        Range range = ParseRange(*header);
+        if (range.start == 1000 && failed_request_count++ == 0) {
+          co_return Response{.status = 503};
+        }
+        std::string body =
+            content.substr(range.start, *range.end - range.start + 1);
+        co_return Response{
+            .status = 206,
+            .headers = {{"Content-Length", std::to_string(body.size())}},
+            .body = CreateBody(std::move(body))};
+      },
+      [&]() -> Task<> {
+        FOR_CO_AWAIT(std::string_view chunk,
+                     ParallelDownload(http(), address(), content.size(),
+                                      {.range_size = 1000,
+                                       .max_concurrent_ranges = 2})) {
+          received += chunk;
+        }
+      });
+
+  EXPECT_TRUE(received == content);
+  EXPECT_EQ(failed_request_count, 2);
+  EXPECT_THAT(ranges, Contains("bytes=0-999"));
+  EXPECT_THAT(ranges, Contains("bytes=1000-1999"));
+  EXPECT_EQ(ranges.size(), (content.size() + 999) / 1000 + 1);
+}
+
+}  // namespace
+}  // namespace coro::http
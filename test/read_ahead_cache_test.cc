@@ -0,0 +1,137 @@
+#include "coro/http/read_ahead_cache.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "coro/http/http.h"
+#include "coro/http/http_parse.h"
+#include "http_server_fixture.h"
+
+namespace coro::http {
+namespace {
+
+using Request = Request<>;
+using Response = Response<>;
+
+using ::testing::Contains;
+
+using ReadAheadCacheTest = HttpServerFixture;
+
+TEST_F(ReadAheadCacheTest, PrefetchesBlocksOfSequentialReads) {
+  std::string content;
+  for (int i = 0; content.size() < 1050; i++) {
+    content += static_cast<char>('a' + i % 26);
+  }
+  content.resize(1050);
+  std::vector<std::string> ranges;
+  std::string received;
+  size_t request_count_after_first_read = 0;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        auto header = FindHeader(request.headers, "Range");
+        if (!header) {
+          co_return Response{.status = 400};
+        }
+        ranges.emplace_back(*header);
+        Range range = ParseRange(*header);
+        if (static_cast<size_t>(range.start) >= content.size()) {
+          co_return Response{.status = 416};
+        }
+        std::string body =
+            content.substr(range.start, *range.end - range.start + 1);
+        co_return Response{
+            .status = 206,
+            .headers = {{"Content-Length", std::to_string(body.size())}},
+            .body = CreateBody(std::move(body))};
+      },
+      [&]() -> Task<> {
+        ReadAheadCache cache(&http(), {.block_size = 100,
+                                       .read_ahead_block_count = 2});
+        for (uint64_t offset = 0; offset < 1100; offset += 50) {
+          received += co_await cache.Read(address(), offset, 50);
+          if (offset == 0) {
+            request_count_after_first_read = ranges.size();
+          }
+        }
+        size_t request_count = ranges.size();
+        std::string cached = co_await cache.Read(address(), 120, 30);
+        EXPECT_EQ(cached, content.substr(120, 30));
+        EXPECT_EQ(ranges.size(), request_count);
+      });
+
+  EXPECT_TRUE(received == content);
+  EXPECT_EQ(request_count_after_first_read, 3);
+  std::sort(ranges.begin(), ranges.end());
+  EXPECT_EQ(std::unique(ranges.begin(), ranges.end()), ranges.end());
+  EXPECT_THAT(ranges, Contains("bytes=1000-1099"));
+}
+
+TEST_F(ReadAheadCacheTest, StopsPrefetchingWhenServerIgnoresRanges) {
+  std::string content(1050, 'x');
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  int request_count = 0;
+  int request_count_after_first_read = 0;
+  std::string received;
+  Run(
+      [&](Request request, stdx::stop_token) -> Task<Response> {
+        request_count++;
+        co_return Response{
+            .status = 200,
+            .headers = {{"Content-Length", std::to_string(content.size())}},
+            .body = CreateBody(content)};
+      },
+      [&]() -> Task<> {
+        ReadAheadCache cache(&http(), {.block_size = 100,
+                                       .read_ahead_block_count = 2});
+        for (uint64_t offset = 0; offset < 1100; offset += 50) {
+          received += co_await cache.Read(address(), offset, 50);
+          if (offset == 0) {
+            request_count_after_first_read = request_count;
+          }
+        }
+      });
+
+  EXPECT_TRUE(received == content);
+  EXPECT_EQ(request_count, request_count_after_first_read);
+}
+
+TEST_F(ReadAheadCacheTest, CancelsPrefetchesWhenDestroyed) {
+  int started_request_count = 0;
+  int finished_request_count = 0;
+  std::string received;
+  Run(
+      [&](Request request, stdx::stop_token stop_token) -> Task<Response> {
+        started_request_count++;
+        Range range = ParseRange(*FindHeader(request.headers, "Range"));
+        if (range.start > 0) {
+          co_await event_loop()->Wait(1000, std::move(stop_token));
+        }
+        finished_request_count++;
+        co_return Response{
+            .status = 206,
+            .headers = {{"Content-Length", "100"}},
+            .body = CreateBody(std::string(100, 'a'))};
+      },
+      [&]() -> Task<> {
+        {
+          ReadAheadCache cache(&http(), {.block_size = 100,
+                                         .read_ahead_block_count = 2});
+          received = co_await cache.Read(address(), 0, 50);
+        }
+        // Let the cancelled prefetches wind down before the server quits.
+        co_await event_loop()->Wait(50, stdx::stop_token());
+      });
+
+  EXPECT_EQ(received, std::string(50, 'a'));
+  EXPECT_EQ(started_request_count, 3);
+  EXPECT_EQ(finished_request_count, 1);
+}
+
+}  // namespace
+}  // namespace coro::http
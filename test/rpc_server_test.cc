@@ -0,0 +1,327 @@
+#include "coro/rpc/rpc_server.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/util/buffer_slice.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/file_slice.h"
+
+namespace coro::rpc {
+namespace {
+
+enum class Kind : uint32_t { kFile = 1, kDirectory = 2 };
+
+struct Time {
+  uint32_t seconds;
+  uint32_t nseconds;
+};
+
+constexpr auto GetXdrFields(const Time&) {
+  return std::tuple(&Time::seconds, &Time::nseconds);
+}
+
+struct Attributes {
+  Kind kind;
+  uint64_t size;
+  bool hidden;
+  Time mtime;
+  std::array<uint8_t, 3> tag;
+};
+
+constexpr auto GetXdrFields(const Attributes&) {
+  return std::tuple(&Attributes::kind, &Attributes::size, &Attributes::hidden,
+                    &Attributes::mtime, &Attributes::tag);
+}
+
+struct Entry {
+  std::optional<Attributes> attributes;
+  uint32_t id;
+};
+
+constexpr auto GetXdrFields(const Entry&) {
+  return std::tuple(&Entry::attributes, &Entry::id);
+}
+
+static_assert(internal::GetXdrFixedSize<Time>() == 8);
+static_assert(internal::GetXdrFixedSize<Attributes>() == 28);
+static_assert(internal::GetXdrFixedSize<Entry>() == 0);
+
+std::vector<uint8_t> Encode(const auto&... values) {
+  std::vector<uint8_t> data;
+  XdrSerializer{&data}.PutAll(values...);
+  return data;
+}
+
+TEST(XdrSerializerTest, EncodesStructsFieldByField) {
+  Attributes attributes{.kind = Kind::kDirectory,
+                        .size = 0x0102030405060708,
+                        .hidden = true,
+                        .mtime = {.seconds = 9, .nseconds = 10},
+                        .tag = {'a', 'b', 'c'}};
+  std::vector<uint8_t> expected = {0, 0, 0, 2,  1, 2, 3, 4, 5,   6,   7,
+                                   8, 0, 0, 0,  1, 0, 0, 0, 9,   0,   0,
+                                   0, 10, 'a', 'b', 'c', 0};
+  EXPECT_EQ(Encode(attributes), expected);
+
+  std::vector<uint8_t> entry_expected = {0, 0, 0, 1};
+  entry_expected.insert(entry_expected.end(), expected.begin(),
+                        expected.end());
+  entry_expected.insert(entry_expected.end(), {0, 0, 0, 7});
+  EXPECT_EQ(Encode(Entry{.attributes = attributes, .id = 7}), entry_expected);
+  EXPECT_EQ(Encode(Entry{.id = 7}), (std::vector<uint8_t>{0, 0, 0, 0, 0, 0,
+                                                           0, 7}));
+}
+
+TEST(XdrSerializerTest, EncodesVariableLengthData) {
+  EXPECT_EQ(Encode(std::string_view("hello"), 1u),
+            (std::vector<uint8_t>{0, 0, 0, 5, 'h', 'e', 'l', 'l', 'o', 0, 0,
+                                  0, 0, 0, 0, 1}));
+}
+
+TEST(XdrSerializerTest, EncodesByteArrays) {
+  std::array<uint8_t, 3> bytes = {'a', 'b', 'c'};
+  std::vector<uint8_t> variable;
+  XdrSerializer{&variable}.Put(bytes);
+  EXPECT_EQ(variable, (std::vector<uint8_t>{0, 0, 0, 3, 'a', 'b', 'c', 0}));
+
+  std::vector<uint8_t> fixed;
+  XdrSerializer{&fixed}.PutFixedOpaque(bytes);
+  EXPECT_EQ(fixed, (std::vector<uint8_t>{'a', 'b', 'c', 0}));
+  EXPECT_EQ(Encode(bytes, std::string_view("d")),
+            (std::vector<uint8_t>{'a', 'b', 'c', 0, 0, 0, 0, 1, 'd', 0, 0,
+                                  0}));
+}
+
+Generator<util::TcpResponseChunk> GetReplyData() {
+  co_yield std::string("abcd");
+  co_yield std::string();
+  co_yield util::BufferSlice(std::string("efghijkl"));
+}
+
+RpcResponse CreateResponse(uint32_t xid) {
+  RpcResponseAcceptedBody accepted{
+      .verf = {.flavor = 0},
+      .stat = RpcResponseAcceptedBody::Stat::kSuccess,
+      .data = GetReplyData()};
+  return RpcResponse{.xid = xid, .body = {.body = std::move(accepted)}};
+}
+
+Task<RpcResponse> HandleCall(RpcRequest request, stdx::stop_token) {
+  co_return CreateResponse(request.xid);
+}
+
+// Replies with the same data as HandleCall, but with the second fragment sent
+// from a file.
+struct FileReplyHandler {
+  Task<RpcResponse> operator()(RpcRequest request, stdx::stop_token) const {
+    RpcResponseAcceptedBody accepted{
+        .verf = {.flavor = 0},
+        .stat = RpcResponseAcceptedBody::Stat::kSuccess,
+        .data = GetFileReplyData(file)};
+    co_return RpcResponse{.xid = request.xid,
+                          .body = {.body = std::move(accepted)}};
+  }
+
+  static Generator<util::TcpResponseChunk> GetFileReplyData(
+      util::FileSlice file) {
+    co_yield std::string("abcd");
+    co_yield std::move(file);
+  }
+
+  util::FileSlice file;
+};
+
+// Handles procedure 1 only once procedure 2 was handled, and replies to it a
+// bit later.
+struct DependentCallHandler {
+  Task<RpcResponse> operator()(RpcRequest request, stdx::stop_token) const {
+    const util::EventLoop* loop = event_loop;
+    Promise<void>& call_handled = *second_call_handled;
+    if (request.body.proc == 1) {
+      co_await call_handled;
+      co_await loop->Wait(10);
+    } else {
+      call_handled.SetValue();
+    }
+    co_return CreateResponse(request.xid);
+  }
+
+  const util::EventLoop* event_loop;
+  Promise<void>* second_call_handled;
+};
+
+// Waits for `release` regardless of cancellation, so that its call outlives
+// the server, and then records whether the handler was destroyed meanwhile.
+struct LingeringCallHandler {
+  Task<RpcResponse> operator()(RpcRequest request, stdx::stop_token) const {
+    std::weak_ptr<int> observer = lifetime;
+    bool* destroyed = handler_destroyed;
+    Promise<void>& released = *release;
+    request_received->SetValue();
+    co_await released;
+    *destroyed = observer.expired();
+    co_return CreateResponse(request.xid);
+  }
+
+  std::shared_ptr<int> lifetime = std::make_shared<int>();
+  Promise<void>* request_received;
+  Promise<void>* release;
+  bool* handler_destroyed;
+};
+
+std::vector<uint8_t> EncodeCall(uint32_t xid, uint32_t proc) {
+  return Encode((1u << 31) | 40u, xid, /*message_type=*/0u, /*rpcvers=*/2u,
+                /*prog=*/100003u, /*vers=*/3u, proc, /*cred=*/0u, 0u,
+                /*verf=*/0u, 0u);
+}
+
+std::vector<uint8_t> EncodeReply(uint32_t xid) {
+  std::vector<uint8_t> reply =
+      Encode(28u, xid, /*message_type=*/1u, /*reply_stat=*/0u,
+             /*verf=*/0u, 0u, /*accept_stat=*/0u);
+  reply.insert(reply.end(), {'a', 'b', 'c', 'd'});
+  std::vector<uint8_t> last_fragment = Encode((1u << 31) | 8u);
+  reply.insert(reply.end(), last_fragment.begin(), last_fragment.end());
+  reply.insert(reply.end(), {'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l'});
+  return reply;
+}
+
+// Sends `calls` over a blocking socket and returns the first `reply_size`
+// bytes received.
+std::vector<uint8_t> Exchange(uint16_t port, const std::vector<uint8_t>& calls,
+                              size_t reply_size) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::vector<uint8_t> reply;
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+          0 &&
+      send(fd, calls.data(), calls.size(), 0) ==
+          static_cast<ssize_t>(calls.size())) {
+    reply.resize(reply_size);
+    size_t received = 0;
+    while (received < reply_size) {
+      ssize_t n = recv(fd, reply.data() + received, reply_size - received, 0);
+      if (n <= 0) {
+        break;
+      }
+      received += n;
+    }
+    reply.resize(received);
+  }
+  close(fd);
+  return reply;
+}
+
+std::vector<uint8_t> Exchange(RpcHandler handler,
+                              const RpcServerConfig& rpc_config,
+                              util::EventLoop* event_loop,
+                              std::vector<uint8_t> calls, size_t reply_size) {
+  std::vector<uint8_t> reply;
+  RunTask([&]() -> Task<> {
+    auto server = CreateRpcServer(
+        std::move(handler), event_loop,
+        util::TcpServer::Config{.address = "127.0.0.1", .port = 0},
+        rpc_config);
+    Promise<std::vector<uint8_t>> received;
+    std::thread client([&, port = server.GetPort()] {
+      std::vector<uint8_t> data = Exchange(port, calls, reply_size);
+      event_loop->RunOnEventLoop([&, data = std::move(data)]() mutable {
+        received.SetValue(std::move(data));
+      });
+    });
+    reply = co_await received;
+    client.join();
+    co_await server.Quit();
+  });
+  event_loop->EnterLoop();
+  return reply;
+}
+
+TEST(RpcServerTest, SendsEveryReplyChunkAsSeparateFragment) {
+  util::EventLoop event_loop;
+  std::vector<uint8_t> call = EncodeCall(/*xid=*/42, /*proc=*/0);
+  EXPECT_EQ(Exchange(HandleCall, RpcServerConfig{}, &event_loop,
+                     std::move(call), /*reply_size=*/44),
+            EncodeReply(/*xid=*/42));
+}
+
+TEST(RpcServerTest, SendsFileChunksOfReply) {
+  char path[] = "/tmp/coro-rpc-file-reply-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "xxefghijkl", 10), 10);
+  close(fd);
+  util::FileSlice file = util::FileSlice::Open(path).Subslice(2);
+  unlink(path);
+
+  util::EventLoop event_loop;
+  std::vector<uint8_t> call = EncodeCall(/*xid=*/42, /*proc=*/0);
+  EXPECT_EQ(Exchange(FileReplyHandler{.file = std::move(file)},
+                     RpcServerConfig{}, &event_loop, std::move(call),
+                     /*reply_size=*/44),
+            EncodeReply(/*xid=*/42));
+}
+
+TEST(RpcServerTest, RepliesToPipelinedCallsInCompletionOrder) {
+  util::EventLoop event_loop;
+  Promise<void> second_call_handled;
+  std::vector<uint8_t> calls = EncodeCall(/*xid=*/1, /*proc=*/1);
+  std::vector<uint8_t> second_call = EncodeCall(/*xid=*/2, /*proc=*/2);
+  calls.insert(calls.end(), second_call.begin(), second_call.end());
+
+  std::vector<uint8_t> expected = EncodeReply(/*xid=*/2);
+  std::vector<uint8_t> first_reply = EncodeReply(/*xid=*/1);
+  expected.insert(expected.end(), first_reply.begin(), first_reply.end());
+  EXPECT_EQ(Exchange(DependentCallHandler{.event_loop = &event_loop,
+                                          .second_call_handled =
+                                              &second_call_handled},
+                     RpcServerConfig{.max_concurrent_calls_per_connection = 4},
+                     &event_loop, std::move(calls), /*reply_size=*/88),
+            expected);
+}
+
+TEST(RpcServerTest, KeepsHandlerOfPipelinedCallAliveAfterQuit) {
+  util::EventLoop event_loop;
+  Promise<void> request_received;
+  Promise<void> release;
+  bool handler_destroyed = true;
+  RunTask([&]() -> Task<> {
+    {
+      auto server = CreateRpcServer(
+          LingeringCallHandler{.request_received = &request_received,
+                               .release = &release,
+                               .handler_destroyed = &handler_destroyed},
+          &event_loop,
+          util::TcpServer::Config{.address = "127.0.0.1", .port = 0},
+          RpcServerConfig{.max_concurrent_calls_per_connection = 2});
+      std::thread client([port = server.GetPort()] {
+        Exchange(port, EncodeCall(/*xid=*/1, /*proc=*/1), /*reply_size=*/0);
+      });
+      co_await request_received;
+      client.join();
+      co_await server.Quit();
+    }
+    release.SetValue();
+  });
+  event_loop.EnterLoop();
+
+  EXPECT_FALSE(handler_destroyed);
+}
+
+}  // namespace
+}  // namespace coro::rpc
@@ -0,0 +1,91 @@
+#include "coro/stdx/stop_token.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+
+namespace coro::stdx {
+namespace {
+
+TEST(StopTokenTest, InvokesRegisteredCallbacksOnce) {
+  stop_source stop_source;
+  std::vector<int> invoked;
+  stop_callback callback1(stop_source.get_token(),
+                          [&] { invoked.push_back(1); });
+  stop_callback callback2(stop_source.get_token(),
+                          [&] { invoked.push_back(2); });
+  {
+    stop_callback deregistered(stop_source.get_token(),
+                               [&] { invoked.push_back(3); });
+  }
+  EXPECT_FALSE(stop_source.get_token().stop_requested());
+
+  EXPECT_TRUE(stop_source.request_stop());
+  EXPECT_TRUE(stop_source.request_stop());
+
+  EXPECT_TRUE(stop_source.get_token().stop_requested());
+  std::sort(invoked.begin(), invoked.end());
+  EXPECT_EQ(invoked, (std::vector<int>{1, 2}));
+}
+
+TEST(StopTokenTest, InvokesCallbackRegisteredAfterStopImmediately) {
+  stop_source stop_source;
+  stop_source.request_stop();
+  bool invoked = false;
+  stop_callback callback(stop_source.get_token(), [&] { invoked = true; });
+  EXPECT_TRUE(invoked);
+}
+
+TEST(StopTokenTest, CallbackMayDestroyOtherCallbacks) {
+  stop_source stop_source;
+  int invoked = 0;
+  auto on_stop = [&] { invoked++; };
+  std::optional<stop_callback<decltype(on_stop)>> callback1;
+  std::optional<stop_callback<decltype(on_stop)>> callback2;
+  auto destroy_all = [&] {
+    invoked++;
+    callback1.reset();
+    callback2.reset();
+  };
+  // Whichever runs first destroys the others before they run.
+  callback1.emplace(stop_source.get_token(), on_stop);
+  stop_callback destroyer(stop_source.get_token(), destroy_all);
+  callback2.emplace(stop_source.get_token(), on_stop);
+
+  stop_source.request_stop();
+
+  EXPECT_LE(invoked, 2);
+  EXPECT_FALSE(callback1);
+  EXPECT_FALSE(callback2);
+}
+
+TEST(StopTokenTest, DefaultTokenCantBeStopped) {
+  stop_token token;
+  bool invoked = false;
+  stop_callback callback(token, [&] { invoked = true; });
+  EXPECT_FALSE(token.stop_possible());
+  EXPECT_FALSE(token.stop_requested());
+  EXPECT_FALSE(invoked);
+}
+
+TEST(InplaceStopSourceTest, StopsTokensAndCallbacks) {
+  inplace_stop_source stop_source;
+  stop_token token = stop_source.get_token();
+  int invoked = 0;
+  stop_callback callback(token, [&] { invoked++; });
+  EXPECT_TRUE(token.stop_possible());
+  EXPECT_FALSE(token.stop_requested());
+
+  stop_source.request_stop();
+
+  EXPECT_TRUE(token.stop_requested());
+  EXPECT_EQ(invoked, 1);
+}
+
+}  // namespace
+}  // namespace coro::stdx
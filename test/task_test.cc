@@ -0,0 +1,67 @@
+#include "coro/task.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+
+namespace coro {
+namespace {
+
+Task<std::unique_ptr<std::string>> CreateString(std::string value) {
+  co_return std::make_unique<std::string>(std::move(value));
+}
+
+Task<int> Fail() {
+  throw RuntimeError("failed");
+  co_return 0;
+}
+
+Task<> Interrupt(Promise<void>& cancelled) {
+  co_await cancelled;
+}
+
+TEST(TaskTest, AsResultHoldsValue) {
+  std::optional<Result<std::unique_ptr<std::string>>> result;
+  RunTask([&]() -> Task<> {
+    result = co_await CreateString("value").AsResult();
+  });
+  ASSERT_TRUE(result);
+  ASSERT_TRUE(*result);
+  EXPECT_EQ(result->error(), nullptr);
+  EXPECT_EQ(*std::move(*result).value(), "value");
+}
+
+TEST(TaskTest, AsResultHoldsExceptionWithoutRethrowing) {
+  std::optional<Result<int>> result;
+  RunTask([&]() -> Task<> { result = co_await Fail().AsResult(); });
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(result->has_value());
+  EXPECT_NE(result->error(), nullptr);
+  EXPECT_THROW(result->value(), RuntimeError);
+}
+
+TEST(TaskTest, AsResultHoldsInterruption) {
+  Promise<void> cancelled;
+  std::optional<Result<>> result;
+  RunTask([&]() -> Task<> {
+    result = co_await Interrupt(cancelled).AsResult();
+  });
+  EXPECT_FALSE(result);
+  cancelled.SetException(InterruptedException());
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(*result);
+  EXPECT_THROW(result->value(), InterruptedException);
+}
+
+TEST(TaskTest, InterruptedExceptionSkipsStacktrace) {
+  EXPECT_TRUE(InterruptedException().stacktrace().empty());
+}
+
+}  // namespace
+}  // namespace coro
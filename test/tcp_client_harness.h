@@ -0,0 +1,92 @@
+#ifndef CORO_HTTP_TEST_TCP_CLIENT_HARNESS_H
+#define CORO_HTTP_TEST_TCP_CLIENT_HARNESS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "coro/promise.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::util {
+
+// Connects to `port` on localhost, returns -1 on failure. Receives time out
+// after 10 seconds, so that a server which never answers fails the test
+// instead of hanging it.
+inline int ConnectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  timeval timeout{.tv_sec = 10, .tv_usec = 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+// Reads from `fd` until the connection is closed, `until` has been received
+// or a receive times out.
+inline std::string Receive(int fd, std::string_view until = {}) {
+  std::string received;
+  while (until.empty() || received.find(until) == std::string::npos) {
+    char buffer[4096];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      break;
+    }
+    received.append(buffer, n);
+  }
+  return received;
+}
+
+// Runs `client(port)` on a separate thread against the server returned by
+// `create_server(event_loop)`, quits the server once the client is done and
+// returns what the client returned. The server may be a TcpServer or anything
+// with the same GetPort() and Quit().
+template <typename CreateServer, typename F>
+auto RunWithClient(CreateServer create_server, F client,
+                   const EventLoop::Config& event_loop_config = {}) {
+  using Result = std::invoke_result_t<F&, uint16_t>;
+  if constexpr (std::is_void_v<Result>) {
+    EventLoop event_loop(event_loop_config);
+    RunTask([&]() -> Task<> {
+      auto server = create_server(&event_loop);
+      Promise<void> done;
+      std::thread thread([&, port = server.GetPort()] {
+        client(port);
+        event_loop.RunOnEventLoop([&] { done.SetValue(); });
+      });
+      co_await done;
+      thread.join();
+      co_await server.Quit();
+    });
+    event_loop.EnterLoop();
+  } else {
+    std::optional<Result> result;
+    RunWithClient(
+        std::move(create_server),
+        [&](uint16_t port) { result.emplace(client(port)); },
+        event_loop_config);
+    return std::move(*result);
+  }
+}
+
+}  // namespace coro::util
+
+#endif  // CORO_HTTP_TEST_TCP_CLIENT_HARNESS_H
@@ -0,0 +1,217 @@
+#include "coro/util/tcp_server.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/multi_threaded_tcp_server.h"
+#include "tcp_client_harness.h"
+
+namespace coro::util {
+namespace {
+
+// Hands out `data` at most `segment_size` bytes at a time, as a connection
+// receiving it in small segments would.
+struct SegmentedData {
+  Task<std::span<const uint8_t>> Peek(uint32_t) {
+    size_t size = std::min(segment_size, data.size() - offset);
+    co_return std::span<const uint8_t>(data).subspan(offset, size);
+  }
+
+  void Consume(uint32_t byte_cnt) { offset += byte_cnt; }
+
+  std::vector<uint8_t> data;
+  size_t segment_size;
+  size_t offset = 0;
+};
+
+std::string ToString(const std::vector<uint8_t>& bytes) {
+  return std::string(bytes.begin(), bytes.end());
+}
+
+// Creates a TcpServer serving `handler`, for RunWithClient.
+auto ServeWith(TcpServer::Config config, TcpRequestHandler handler) {
+  return [config = std::move(config), handler = std::move(handler)](
+             const EventLoop* event_loop) mutable {
+    return TcpServer(std::move(handler), event_loop, config);
+  };
+}
+
+// Answers "ping" with "pong" once all four bytes are readable at once.
+Generator<TcpResponseChunk> AnswerPing(TcpRequestDataProvider request,
+                                       stdx::stop_token) {
+  std::span<const uint8_t> bytes = co_await request.Peek(4);
+  if (bytes.size() < 4) {
+    throw InterruptedException();
+  }
+  std::string ping(bytes.begin(), bytes.begin() + 4);
+  request.Consume(4);
+  co_yield TcpResponseChunk(std::string(ping == "ping" ? "pong" : "????"));
+}
+
+// Small chunks around one big enough to be queued by reference.
+std::vector<std::string> GetMixedChunks() {
+  std::vector<std::string> chunks;
+  for (int i = 0; i < 100; i++) {
+    chunks.push_back(std::to_string(i) + ",");
+  }
+  chunks.push_back(std::string(256 * 1024, 'x'));
+  for (int i = 0; i < 100; i++) {
+    chunks.push_back("," + std::to_string(i));
+  }
+  return chunks;
+}
+
+Generator<TcpResponseChunk> SendMixedChunks(TcpRequestDataProvider request,
+                                            stdx::stop_token) {
+  std::span<const uint8_t> bytes = co_await request.Peek();
+  if (bytes.empty()) {
+    throw InterruptedException();
+  }
+  request.Consume(static_cast<uint32_t>(bytes.size()));
+  for (std::string& chunk : GetMixedChunks()) {
+    co_yield TcpResponseChunk(std::move(chunk));
+  }
+  throw InterruptedException();
+}
+
+Generator<TcpResponseChunk> FailAfterPartialResponse(
+    TcpRequestDataProvider request, stdx::stop_token) {
+  co_await request.Peek();
+  co_yield TcpResponseChunk(std::string("partial"));
+  throw RuntimeError("handler failed");
+}
+
+TEST(TcpRequestDataProviderTest, CopiesBytesAcrossPeekedSegments) {
+  std::string_view text = "hello world";
+  TcpRequestDataProvider provider(SegmentedData{
+      .data = std::vector<uint8_t>(text.begin(), text.end()),
+      .segment_size = 3});
+  std::vector<std::string> reads;
+  bool failed_at_end = false;
+  RunTask([&]() -> Task<> {
+    reads.push_back(ToString(co_await provider(5)));
+    // Whatever a single peek returns.
+    reads.push_back(ToString(co_await provider(UINT32_MAX)));
+    reads.push_back(ToString(co_await provider(3)));
+    try {
+      co_await provider(1);
+    } catch (const RuntimeError&) {
+      failed_at_end = true;
+    }
+  });
+
+  EXPECT_EQ(reads, (std::vector<std::string>{"hello", " wo", "rld"}));
+  EXPECT_TRUE(failed_at_end);
+}
+
+TEST(TcpRequestDataProviderTest, AdaptsReadCallable) {
+  std::string_view text = "hello world";
+  size_t offset = 0;
+  TcpRequestDataProvider provider =
+      [&](uint32_t byte_cnt) -> Task<std::vector<uint8_t>> {
+    std::string_view data = text.substr(offset, byte_cnt);
+    offset += data.size();
+    co_return std::vector<uint8_t>(data.begin(), data.end());
+  };
+  std::vector<std::string> reads;
+  RunTask([&]() -> Task<> {
+    std::span<const uint8_t> data = co_await provider.Peek(5);
+    reads.emplace_back(data.begin(), data.end());
+    provider.Consume(2);
+    data = co_await provider.Peek(4);
+    reads.emplace_back(data.begin(), data.end());
+    provider.Consume(static_cast<uint32_t>(data.size()));
+    reads.push_back(ToString(co_await provider(5)));
+    data = co_await provider.Peek();
+    reads.emplace_back(data.begin(), data.end());
+  });
+
+  EXPECT_EQ(reads, (std::vector<std::string>{"hello", "llo ", "world", ""}));
+}
+
+TEST(TcpServerTest, PeeksBytesReceivedInSeparateSegments) {
+  std::string received = RunWithClient(
+      ServeWith({.address = "127.0.0.1", .port = 0}, AnswerPing),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        send(fd, "pi", 2, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        send(fd, "ng", 2, 0);
+        shutdown(fd, SHUT_WR);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(received, "pong");
+}
+
+TEST(TcpServerTest, SendsCoalescedAndReferencedChunksInOrder) {
+  std::string received = RunWithClient(
+      ServeWith(
+          {.address = "127.0.0.1", .port = 0, .write_high_watermark = 4096},
+          SendMixedChunks),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        send(fd, "go", 2, 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  std::string expected;
+  for (const std::string& chunk : GetMixedChunks()) {
+    expected += chunk;
+  }
+  EXPECT_TRUE(received == expected) << received.size();
+}
+
+TEST(TcpServerTest, FlushesResponseBeforeClosingOnHandlerError) {
+  std::string received = RunWithClient(
+      ServeWith({.address = "127.0.0.1", .port = 0}, FailAfterPartialResponse),
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        send(fd, "go", 2, 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_EQ(received, "partial");
+}
+
+TEST(MultiThreadedTcpServerTest, ThrowsWhenSecondServerFailsToBeCreated) {
+  EventLoop event_loop;
+  int created_count = 0;
+  auto handler_factory = [&](const EventLoop*) -> TcpRequestHandler {
+    if (++created_count == 2) {
+      throw RuntimeError("second server failed");
+    }
+    return AnswerPing;
+  };
+
+  // No thread is left running, as the destructor doesn't run.
+  EXPECT_THROW(MultiThreadedTcpServer(
+                   handler_factory, &event_loop,
+                   {.server = {.address = "127.0.0.1", .port = 0},
+                    .thread_count = 2}),
+               RuntimeError);
+  EXPECT_EQ(created_count, 2);
+}
+
+}  // namespace
+}  // namespace coro::util
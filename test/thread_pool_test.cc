@@ -0,0 +1,84 @@
+#include "coro/util/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::util {
+namespace {
+
+TEST(ThreadPoolTest, RunsFunctionsOffTheLoopAndResumesOnIt) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, /*thread_count=*/4);
+  std::thread::id loop_thread = std::this_thread::get_id();
+  std::vector<int> results;
+  std::atomic<int> calls_on_loop_thread = 0;
+  bool resumed_on_loop_thread = true;
+  for (int i = 0; i < 16; i++) {
+    RunTask([&, i]() -> Task<> {
+      int result = co_await thread_pool.Do([&, i] {
+        if (std::this_thread::get_id() == loop_thread) {
+          calls_on_loop_thread++;
+        }
+        return i * i;
+      });
+      resumed_on_loop_thread &= std::this_thread::get_id() == loop_thread;
+      results.push_back(result);
+      if (results.size() == 16) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+
+  EXPECT_EQ(calls_on_loop_thread, 0);
+  EXPECT_TRUE(resumed_on_loop_thread);
+  EXPECT_EQ(results.size(), 16);
+  int sum = 0;
+  for (int result : results) {
+    sum += result;
+  }
+  EXPECT_EQ(sum, 1240);
+}
+
+TEST(ThreadPoolTest, CancelsQueuedFunctionWithoutRunningIt) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, /*thread_count=*/1);
+  std::atomic<bool> release = false;
+  bool cancelled_ran = false;
+  bool interrupted = false;
+  stdx::stop_source stop_source;
+  RunTask([&]() -> Task<> {
+    // Keeps the only worker busy until the second function is cancelled.
+    co_await thread_pool.Do([&] {
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    event_loop.ExitLoop();
+  });
+  RunTask([&]() -> Task<> {
+    try {
+      co_await thread_pool.Do(stop_source.get_token(),
+                              [&] { cancelled_ran = true; });
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+    release = true;
+  });
+  stop_source.request_stop();
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+
+  EXPECT_TRUE(interrupted);
+  EXPECT_FALSE(cancelled_ran);
+}
+
+}  // namespace
+}  // namespace coro::util
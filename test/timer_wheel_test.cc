@@ -0,0 +1,176 @@
+#include "coro/util/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace coro::util {
+namespace {
+
+struct TestTimer {
+  TimerWheel::Timer timer;
+  uint64_t deadline;
+  std::function<void(TestTimer*)> on_expired;
+};
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  void Arm(TestTimer* timer, uint64_t deadline) {
+    timer->deadline = deadline;
+    wheel_.Arm(&timer->timer, deadline, &TimerWheelTest::OnExpired, timer);
+  }
+
+  // Advances the wheel tick by tick, the way a timer set to GetNextTick
+  // would, and checks that no timer is late or early.
+  void AdvanceTo(uint64_t now) {
+    while (true) {
+      std::optional<uint64_t> next_tick = wheel_.GetNextTick();
+      if (!next_tick || *next_tick > now) {
+        break;
+      }
+      now_ = *next_tick;
+      wheel_.Advance(now_);
+    }
+    now_ = now;
+    wheel_.Advance(now_);
+  }
+
+  static void OnExpired(void* data) {
+    auto* timer = static_cast<TestTimer*>(data);
+    auto* test = current_;
+    EXPECT_EQ(test->now_, std::max(timer->deadline, test->armed_at_));
+    test->expired_.push_back(timer->deadline);
+    if (timer->on_expired) {
+      timer->on_expired(timer);
+    }
+  }
+
+  void SetUp() override { current_ = this; }
+
+  static inline TimerWheelTest* current_ = nullptr;
+  TimerWheel wheel_{0};
+  uint64_t now_ = 0;
+  uint64_t armed_at_ = 0;
+  std::vector<uint64_t> expired_;
+};
+
+TEST_F(TimerWheelTest, ExpiresTimersInOrderOfDeadlines) {
+  std::vector<TestTimer> timers(5);
+  Arm(&timers[0], 70);
+  Arm(&timers[1], 3);
+  Arm(&timers[2], 5000);
+  Arm(&timers[3], 64);
+  Arm(&timers[4], 1);
+  EXPECT_EQ(wheel_.size(), 5);
+  EXPECT_EQ(wheel_.GetNextTick(), 1);
+
+  AdvanceTo(100);
+  EXPECT_EQ(expired_, (std::vector<uint64_t>{1, 3, 64, 70}));
+  EXPECT_EQ(wheel_.size(), 1);
+
+  AdvanceTo(5000);
+  EXPECT_EQ(expired_, (std::vector<uint64_t>{1, 3, 64, 70, 5000}));
+  EXPECT_EQ(wheel_.size(), 0);
+  EXPECT_EQ(wheel_.GetNextTick(), std::nullopt);
+}
+
+TEST_F(TimerWheelTest, ExpiresEverythingDueWhenAdvancedPastDeadlines) {
+  std::vector<TestTimer> timers(3);
+  Arm(&timers[0], 100000);
+  Arm(&timers[1], 10);
+  Arm(&timers[2], 4096);
+
+  // All of them are late, so they all expire at once.
+  now_ = 200000;
+  armed_at_ = now_;
+  wheel_.Advance(now_);
+  EXPECT_EQ(expired_, (std::vector<uint64_t>{10, 4096, 100000}));
+}
+
+TEST_F(TimerWheelTest, CancelsTimers) {
+  std::vector<TestTimer> timers(3);
+  Arm(&timers[0], 10);
+  Arm(&timers[1], 20);
+  Arm(&timers[2], 100000);
+
+  wheel_.Cancel(&timers[0].timer);
+  wheel_.Cancel(&timers[2].timer);
+  wheel_.Cancel(&timers[2].timer);
+  EXPECT_FALSE(timers[0].timer.armed());
+  EXPECT_TRUE(timers[1].timer.armed());
+  EXPECT_EQ(wheel_.size(), 1);
+  EXPECT_EQ(wheel_.GetNextTick(), 20);
+
+  AdvanceTo(200000);
+  EXPECT_EQ(expired_, std::vector<uint64_t>{20});
+  EXPECT_FALSE(timers[1].timer.armed());
+}
+
+TEST_F(TimerWheelTest, ExpiresPastDeadlinesOnNextAdvance) {
+  AdvanceTo(1000);
+  TestTimer timer;
+  armed_at_ = 1000;
+  Arm(&timer, 10);
+  EXPECT_EQ(wheel_.GetNextTick(), 1000);
+
+  wheel_.Advance(1000);
+  EXPECT_EQ(expired_, std::vector<uint64_t>{10});
+}
+
+TEST_F(TimerWheelTest, HandlesDeadlinesBeyondTopLevel) {
+  uint64_t far = uint64_t(1) << 40;
+  TestTimer timer;
+  Arm(&timer, far);
+
+  AdvanceTo(far - 1);
+  EXPECT_TRUE(expired_.empty());
+  AdvanceTo(far);
+  EXPECT_EQ(expired_, std::vector<uint64_t>{far});
+}
+
+TEST_F(TimerWheelTest, AllowsArmingAndCancellingFromCallbacks) {
+  std::vector<TestTimer> timers(3);
+  timers[0].on_expired = [&](TestTimer* timer) {
+    armed_at_ = now_;
+    wheel_.Cancel(&timers[1].timer);
+    Arm(timer, now_ + 100);
+    // Due now, but armed during Advance, so run by the next one.
+    Arm(&timers[2], now_);
+  };
+  Arm(&timers[0], 50);
+  Arm(&timers[1], 50);
+
+  now_ = 50;
+  wheel_.Advance(now_);
+  EXPECT_EQ(expired_, std::vector<uint64_t>{50});
+  EXPECT_TRUE(timers[2].timer.armed());
+
+  timers[0].on_expired = nullptr;
+  wheel_.Advance(now_);
+  EXPECT_EQ(expired_, (std::vector<uint64_t>{50, 50}));
+  AdvanceTo(150);
+  EXPECT_EQ(expired_, (std::vector<uint64_t>{50, 50, 150}));
+}
+
+TEST_F(TimerWheelTest, ExpiresRandomTimersOnTime) {
+  std::mt19937_64 random(42);
+  std::vector<TestTimer> timers(2000);
+  for (TestTimer& timer : timers) {
+    Arm(&timer, random() % 1000000);
+  }
+  for (size_t i = 0; i < timers.size(); i += 3) {
+    wheel_.Cancel(&timers[i].timer);
+  }
+
+  AdvanceTo(1000000);
+  EXPECT_EQ(expired_.size(), timers.size() - (timers.size() + 2) / 3);
+  EXPECT_TRUE(std::is_sorted(expired_.begin(), expired_.end()));
+  EXPECT_EQ(wheel_.size(), 0);
+}
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,289 @@
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/http/curl_http.h"
+#include "coro/http/http_exception.h"
+#include "coro/http/http_server.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/tls_context.h"
+#include "tcp_client_harness.h"
+
+namespace coro::http {
+namespace {
+
+using ::coro::util::ConnectTo;
+using ::coro::util::RunWithClient;
+using ::coro::util::TlsContext;
+
+// Self-signed certificate for "localhost" with its key, written to temporary
+// PEM files which are removed together with the object.
+class TestCertificate {
+ public:
+  TestCertificate() {
+    EVP_PKEY_CTX* key_context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    EVP_PKEY_keygen_init(key_context);
+    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_context, NID_X9_62_prime256v1);
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_keygen(key_context, &key);
+    EVP_PKEY_CTX_free(key_context);
+
+    X509* certificate = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 60 * 60);
+    X509_set_pubkey(certificate, key);
+    X509_NAME* name = X509_get_subject_name(certificate);
+    X509_NAME_add_entry_by_txt(
+        name, "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, name);
+    X509_sign(certificate, key, EVP_sha256());
+
+    certificate_path_ = WritePem(
+        [&](FILE* file) { return PEM_write_X509(file, certificate); });
+    key_path_ = WritePem([&](FILE* file) {
+      return PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr,
+                                  nullptr);
+    });
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+  }
+
+  ~TestCertificate() {
+    unlink(certificate_path_.c_str());
+    unlink(key_path_.c_str());
+  }
+
+  const std::string& certificate_path() const { return certificate_path_; }
+  const std::string& key_path() const { return key_path_; }
+
+  std::shared_ptr<const std::string> GetPem() const {
+    std::ifstream stream(certificate_path_);
+    std::stringstream pem;
+    pem << stream.rdbuf();
+    return std::make_shared<const std::string>(std::move(pem).str());
+  }
+
+ private:
+  template <typename F>
+  static std::string WritePem(F write) {
+    char path[] = "/tmp/coro-http-tls-XXXXXX";
+    int fd = mkstemp(path);
+    FILE* file = fdopen(fd, "w");
+    write(file);
+    fclose(file);
+    return path;
+  }
+
+  std::string certificate_path_;
+  std::string key_path_;
+};
+
+struct ClientResult {
+  std::string response;
+  std::string alpn_protocol;
+  bool session_reused = false;
+  // Owned by the caller, to be passed to a next Fetch.
+  SSL_SESSION* session = nullptr;
+};
+
+// Sends `request` over a new TLS connection, resuming `session` if not null,
+// and reads the response until the server closes the connection.
+ClientResult Fetch(SSL_CTX* context, uint16_t port, std::string_view request,
+                   SSL_SESSION* session = nullptr) {
+  ClientResult result;
+  int fd = ConnectTo(port);
+  if (fd == -1) {
+    return result;
+  }
+  SSL* ssl = SSL_new(context);
+  SSL_set_fd(ssl, fd);
+  SSL_set_tlsext_host_name(ssl, "localhost");
+  if (session != nullptr) {
+    SSL_set_session(ssl, session);
+  }
+  if (SSL_connect(ssl) == 1 &&
+      SSL_write(ssl, request.data(), static_cast<int>(request.size())) ==
+          static_cast<int>(request.size())) {
+    char buffer[4096];
+    int size;
+    while ((size = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+      result.response.append(buffer, static_cast<size_t>(size));
+    }
+    const unsigned char* alpn_protocol;
+    unsigned int alpn_protocol_length;
+    SSL_get0_alpn_selected(ssl, &alpn_protocol, &alpn_protocol_length);
+    result.alpn_protocol.assign(reinterpret_cast<const char*>(alpn_protocol),
+                                alpn_protocol_length);
+    result.session_reused = SSL_session_reused(ssl);
+    // TLS 1.3 session tickets arrive after the handshake, so the session is
+    // taken only once the whole response is read.
+    result.session = SSL_get1_session(ssl);
+    // OpenSSL invalidates the sessions of connections which weren't shut down.
+    SSL_shutdown(ssl);
+  }
+  SSL_free(ssl);
+  close(fd);
+  return result;
+}
+
+class TlsServerTest : public ::testing::Test {
+ protected:
+  TlsServerTest() : client_context_(SSL_CTX_new(TLS_client_method())) {}
+
+  ~TlsServerTest() override { SSL_CTX_free(client_context_); }
+
+  std::shared_ptr<const TlsContext> CreateTlsContext(
+      std::vector<std::string> alpn_protocols = {}) const {
+    return std::make_shared<TlsContext>(TlsContext::Config{
+        .certificate_chain_path = certificate_.certificate_path(),
+        .private_key_path = certificate_.key_path(),
+        .alpn_protocols = std::move(alpn_protocols)});
+  }
+
+  SSL_CTX* client_context() const { return client_context_; }
+  const TestCertificate& certificate() const { return certificate_; }
+
+ private:
+  TestCertificate certificate_;
+  SSL_CTX* client_context_;
+};
+
+constexpr std::string_view kRequest =
+    "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+HttpHandler CreateHelloHandler() {
+  return [](Request<> request, stdx::stop_token) -> Task<Response<>> {
+    co_return Response<>{
+        .status = 200,
+        .headers = {{"Content-Length", std::to_string(request.url.size())}},
+        .body = http::CreateBody(request.url)};
+  };
+}
+
+TEST_F(TlsServerTest, ServesRequestsAndResumesSessions) {
+  std::vector<ClientResult> results;
+  RunWithClient(
+      [&](const coro::util::EventLoop* event_loop) {
+        return CreateHttpServer(
+            CreateHelloHandler(), event_loop,
+            {.address = "127.0.0.1",
+             .port = 0,
+             .tls = CreateTlsContext({"h2", "http/1.1"})});
+      },
+      [&](uint16_t port) {
+        SSL_CTX_set_alpn_protos(
+            client_context(),
+            reinterpret_cast<const unsigned char*>("\x08http/1.1"), 9);
+        results.push_back(Fetch(client_context(), port, kRequest));
+        results.push_back(
+            Fetch(client_context(), port, kRequest, results[0].session));
+      });
+
+  ASSERT_EQ(results.size(), 2);
+  for (const ClientResult& result : results) {
+    EXPECT_TRUE(result.response.starts_with("HTTP/1.1 200 OK\r\n"))
+        << result.response;
+    EXPECT_TRUE(result.response.ends_with("\r\n\r\n/hello")) << result.response;
+    EXPECT_EQ(result.alpn_protocol, "http/1.1");
+    SSL_SESSION_free(result.session);
+  }
+  EXPECT_FALSE(results[0].session_reused);
+  EXPECT_TRUE(results[1].session_reused);
+}
+
+TEST_F(TlsServerTest, StreamsLargeBodies) {
+  std::string body(1024 * 1024, 0);
+  for (size_t i = 0; i < body.size(); i++) {
+    body[i] = static_cast<char>('a' + i % 26);
+  }
+  HttpHandler handler = [&](Request<>, stdx::stop_token) -> Task<Response<>> {
+    co_return Response<>{
+        .status = 200,
+        .headers = {{"Content-Length", std::to_string(body.size())}},
+        .body = http::CreateBody(body)};
+  };
+  ClientResult result;
+  RunWithClient(
+      [&](const coro::util::EventLoop* event_loop) {
+        return CreateHttpServer(
+            std::move(handler), event_loop,
+            {.address = "127.0.0.1", .port = 0, .tls = CreateTlsContext()});
+      },
+      [&](uint16_t port) { result = Fetch(client_context(), port, kRequest); });
+
+  EXPECT_TRUE(result.response.ends_with("\r\n\r\n" + body));
+  EXPECT_EQ(result.alpn_protocol, "");
+  SSL_SESSION_free(result.session);
+}
+
+TEST_F(TlsServerTest, CurlHttpVerifiesServerAgainstCaCertBlob) {
+  coro::util::EventLoop event_loop;
+  TestCertificate other_certificate;
+  std::vector<std::string> bodies;
+  bool untrusted_rejected = false;
+  RunTask([&]() -> Task<> {
+    auto http_server = CreateHttpServer(
+        CreateHelloHandler(), &event_loop,
+        coro::util::TcpServer::Config{
+            .address = "127.0.0.1", .port = 0, .tls = CreateTlsContext()});
+    std::string url = "https://localhost:" +
+                      std::to_string(http_server.GetPort()) + "/hello";
+    try {
+      CurlHttp trusted(&event_loop,
+                       CurlHttpConfig{.ca_cert_blob = certificate().GetPem()});
+      // Reuses the parsed bundle for the second connection.
+      for (int i = 0; i < 2; i++) {
+        Request<> request{.url = url, .headers = {{"Connection", "close"}}};
+        auto response =
+            co_await trusted.Fetch(std::move(request), stdx::stop_token());
+        bodies.push_back(co_await GetBody(std::move(response.body)));
+      }
+      CurlHttp untrusted(
+          &event_loop,
+          CurlHttpConfig{.ca_cert_blob = other_certificate.GetPem()});
+      try {
+        Request<> request{.url = url};
+        co_await untrusted.Fetch(std::move(request), stdx::stop_token());
+      } catch (const HttpException&) {
+        untrusted_rejected = true;
+      }
+    } catch (...) {
+    }
+    co_await http_server.Quit();
+  });
+  event_loop.EnterLoop();
+
+  EXPECT_EQ(bodies, (std::vector<std::string>{"/hello", "/hello"}));
+  EXPECT_TRUE(untrusted_rejected);
+}
+
+TEST(TlsContextTest, RejectsInvalidConfig) {
+  TestCertificate certificate;
+  EXPECT_THROW(TlsContext(TlsContext::Config{
+                   .certificate_chain_path = "/nonexistent",
+                   .private_key_path = certificate.key_path()}),
+               RuntimeError);
+  EXPECT_THROW(
+      TlsContext(TlsContext::Config{
+          .certificate_chain_path = certificate.certificate_path(),
+          .private_key_path = certificate.key_path(),
+          .session_ticket_key = "too short"}),
+      InvalidArgument);
+}
+
+}  // namespace
+}  // namespace coro::http
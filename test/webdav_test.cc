@@ -0,0 +1,133 @@
+#include "coro/http/webdav.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coro/http/http_exception.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/task.h"
+
+namespace coro::http {
+namespace {
+
+PropfindRequest ParseInPieces(std::string_view body, size_t piece_size) {
+  PropfindRequestParser parser;
+  for (size_t i = 0; i < body.size(); i += piece_size) {
+    parser.Parse(body.substr(i, piece_size));
+  }
+  return parser.Finish();
+}
+
+Generator<DavResource> ListFiles(int count) {
+  DavResource directory{.path = "/dir", .is_collection = true};
+  co_yield std::move(directory);
+  for (int i = 0; i < count; i++) {
+    DavResource file{.path = "/dir/file " + std::to_string(i) + ".txt",
+                     .size = static_cast<uint64_t>(i),
+                     .content_type = "text/plain"};
+    co_yield std::move(file);
+  }
+}
+
+TEST(WebDavTest, ParsesPropfindBodySplitAnywhere) {
+  std::string_view body =
+      "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n"
+      "<!-- a comment with <tags> and \"quotes -->\n"
+      "<D:propfind xmlns:D=\"DAV:\">\n"
+      "  <D:prop xmlns:R=\"http://ns.example.com/&amp;\">\n"
+      "    <D:getcontentlength/>\n"
+      "    <R:color attr='a > b'/>\n"
+      "    <displayname xmlns=\"DAV:\"></displayname>\n"
+      "  </D:prop>\n"
+      "</D:propfind>\n";
+  for (size_t piece_size : {1, 2, 7, 1000}) {
+    PropfindRequest request = ParseInPieces(body, piece_size);
+    EXPECT_EQ(request.type, PropfindRequest::Type::kProp);
+    EXPECT_EQ(request.properties,
+              (std::vector<DavPropertyName>{
+                  {.namespace_uri = "DAV:", .name = "getcontentlength"},
+                  {.namespace_uri = "http://ns.example.com/&", .name = "color"},
+                  {.namespace_uri = "DAV:", .name = "displayname"}}))
+        << piece_size;
+  }
+
+  EXPECT_EQ(ParseInPieces("", 1).type, PropfindRequest::Type::kAllProp);
+  EXPECT_EQ(ParseInPieces("<propfind xmlns='DAV:'><propname/></propfind>", 3)
+                .type,
+            PropfindRequest::Type::kPropName);
+  EXPECT_THROW(ParseInPieces("<D:propfind xmlns:D='DAV:'><D:prop>", 4),
+               HttpException);
+  EXPECT_THROW(ParseInPieces("<propfind><allprop/></propfind>", 4),
+               HttpException);
+  EXPECT_THROW(ParseInPieces("<a:propfind><a:allprop/></a:propfind>", 4),
+               HttpException);
+}
+
+TEST(WebDavTest, WritesRequestedPropertiesAndMissingOnes) {
+  PropfindRequest request{
+      .type = PropfindRequest::Type::kProp,
+      .properties = {{.namespace_uri = "DAV:", .name = "getcontentlength"},
+                     {.namespace_uri = "DAV:", .name = "resourcetype"},
+                     {.namespace_uri = "urn:x", .name = "color"}}};
+  MultiStatusWriter writer(request);
+
+  std::string output;
+  writer.Append(DavResource{.path = "/a&b c.txt", .size = 42}, output);
+  EXPECT_EQ(output,
+            "<d:response><d:href>/a%26b%20c.txt</d:href>"
+            "<d:propstat><d:prop><d:getcontentlength>42</d:getcontentlength>"
+            "<d:resourcetype/></d:prop>"
+            "<d:status>HTTP/1.1 200 OK</d:status></d:propstat>"
+            "<d:propstat><d:prop><x:color xmlns:x=\"urn:x\"/></d:prop>"
+            "<d:status>HTTP/1.1 404 Not Found</d:status></d:propstat>"
+            "</d:response>");
+
+  output.clear();
+  writer.Append(DavResource{.path = "/dir", .is_collection = true}, output);
+  EXPECT_EQ(output,
+            "<d:response><d:href>/dir/</d:href>"
+            "<d:propstat><d:prop>"
+            "<d:resourcetype><d:collection/></d:resourcetype></d:prop>"
+            "<d:status>HTTP/1.1 200 OK</d:status></d:propstat>"
+            "<d:propstat><d:prop><d:getcontentlength/>"
+            "<x:color xmlns:x=\"urn:x\"/></d:prop>"
+            "<d:status>HTTP/1.1 404 Not Found</d:status></d:propstat>"
+            "</d:response>");
+}
+
+TEST(WebDavTest, StreamsMultiStatusInBoundedChunks) {
+  constexpr size_t kChunkSize = 4096;
+  Response<> response = CreateMultiStatusResponse(
+      PropfindRequest{}, ListFiles(1000), kChunkSize);
+  EXPECT_EQ(response.status, 207);
+
+  std::vector<std::string> chunks;
+  RunTask([&]() -> Task<> {
+    FOR_CO_AWAIT(std::string_view chunk, response.body) {
+      chunks.emplace_back(chunk);
+    }
+  });
+
+  ASSERT_GT(chunks.size(), 10);
+  std::string body;
+  for (const std::string& chunk : chunks) {
+    EXPECT_LT(chunk.size(), kChunkSize + 1024);
+    body += chunk;
+  }
+  for (size_t i = 0; i + 1 < chunks.size(); i++) {
+    EXPECT_GE(chunks[i].size(), kChunkSize);
+  }
+  EXPECT_TRUE(body.starts_with(MultiStatusWriter::GetHeader()));
+  EXPECT_TRUE(body.ends_with(MultiStatusWriter::GetFooter()));
+  EXPECT_NE(body.find("<d:href>/dir/file%20999.txt</d:href><d:propstat><d:prop>"
+                      "<d:resourcetype/><d:getcontentlength>999"
+                      "</d:getcontentlength><d:getcontenttype>text/plain"
+                      "</d:getcontenttype></d:prop>"),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace coro::http
@@ -0,0 +1,133 @@
+#include "coro/http/websocket.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "coro/http/http_server.h"
+#include "coro/util/event_loop.h"
+#include "tcp_client_harness.h"
+
+namespace coro::http {
+namespace {
+
+using ::coro::util::ConnectTo;
+using ::coro::util::Receive;
+using ::coro::util::RunWithClient;
+using ::testing::HasSubstr;
+
+constexpr std::array<uint8_t, 4> kMask = {0x37, 0xfa, 0x21, 0x3d};
+
+std::span<uint8_t> AsBytes(std::string& data) {
+  return std::span<uint8_t>(reinterpret_cast<uint8_t*>(data.data()),
+                            data.size());
+}
+
+std::span<const uint8_t> AsBytes(std::string_view data) {
+  return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()),
+                                  data.size());
+}
+
+std::string CreateClientFrame(WebSocketOpcode opcode, bool fin,
+                              std::string payload) {
+  std::string frame;
+  AppendWebSocketFrameHeader(frame, opcode, fin, payload.size(), kMask);
+  MaskWebSocketPayload(AsBytes(payload), kMask);
+  return frame + payload;
+}
+
+TEST(WebSocketTest, ComputesHandshakeAccept) {
+  EXPECT_EQ(GetWebSocketAccept("dGhlIHNhbXBsZSBub25jZQ=="),
+            "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocketTest, ParsesFrameHeaders) {
+  for (uint64_t length : {uint64_t{5}, uint64_t{300}, uint64_t{70000}}) {
+    std::string header;
+    AppendWebSocketFrameHeader(header, WebSocketOpcode::kBinary,
+                               /*fin=*/false, length, kMask);
+    std::string_view truncated =
+        std::string_view(header).substr(0, header.size() - 1);
+    EXPECT_EQ(ParseWebSocketFrameHeader(AsBytes(truncated)), std::nullopt);
+    auto parsed = ParseWebSocketFrameHeader(AsBytes(header));
+    ASSERT_TRUE(parsed);
+    EXPECT_FALSE(parsed->fin);
+    EXPECT_EQ(parsed->opcode, WebSocketOpcode::kBinary);
+    EXPECT_EQ(parsed->payload_length, length);
+    EXPECT_EQ(parsed->mask, kMask);
+    EXPECT_EQ(parsed->size, header.size());
+  }
+  // RSV1 is set, but no extension was negotiated.
+  EXPECT_THROW(
+      ParseWebSocketFrameHeader(AsBytes(std::string_view("\xc1\x00", 2))),
+      WebSocketException);
+}
+
+TEST(WebSocketTest, MasksPayloadInPieces) {
+  std::string payload;
+  for (int i = 0; i < 100; i++) {
+    payload += static_cast<char>(i);
+  }
+  std::string whole = payload;
+  MaskWebSocketPayload(AsBytes(whole), kMask);
+  std::string pieces = payload;
+  MaskWebSocketPayload(AsBytes(pieces).subspan(0, 13), kMask, /*offset=*/0);
+  MaskWebSocketPayload(AsBytes(pieces).subspan(13), kMask, /*offset=*/13);
+  EXPECT_EQ(pieces, whole);
+  MaskWebSocketPayload(AsBytes(whole), kMask);
+  EXPECT_EQ(whole, payload);
+}
+
+Task<> Echo(WebSocket& websocket, stdx::stop_token) {
+  while (auto message = co_await websocket.Receive()) {
+    std::string payload = co_await GetBody(std::move(message->payload));
+    co_await websocket.Send(message->opcode, "echo: " + payload);
+  }
+}
+
+TEST(WebSocketTest, EchoesMessagesOverUpgradedConnection) {
+  std::string received = RunWithClient(
+      [](const coro::util::EventLoop* event_loop) {
+        return CreateHttpServer(
+            [](Request<> request, stdx::stop_token) -> Task<Response<>> {
+              co_return AcceptWebSocket(request, Echo);
+            },
+            event_loop, {.address = "127.0.0.1", .port = 0});
+      },
+      [](uint16_t port) {
+        int fd = ConnectTo(port);
+        std::string request =
+            "GET /chat HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\n"
+            "Connection: keep-alive, Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+            "Sec-WebSocket-Version: 13\r\n\r\n";
+        request += CreateClientFrame(WebSocketOpcode::kText, /*fin=*/false,
+                                     "hel");
+        request += CreateClientFrame(WebSocketOpcode::kPing, /*fin=*/true, "p");
+        request += CreateClientFrame(WebSocketOpcode::kContinuation,
+                                     /*fin=*/true, "lo");
+        request += CreateClientFrame(WebSocketOpcode::kClose, /*fin=*/true,
+                                     std::string("\x03\xe8", 2));
+        send(fd, request.data(), request.size(), 0);
+        std::string received = Receive(fd);
+        close(fd);
+        return received;
+      });
+
+  EXPECT_THAT(received, HasSubstr("HTTP/1.1 101 Switching Protocol\r\n"));
+  EXPECT_THAT(received,
+              HasSubstr("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+  // Pong, then the echo and the close frame answering the client's.
+  EXPECT_THAT(received, HasSubstr(std::string("\x8a\x01p", 3)));
+  EXPECT_THAT(received, HasSubstr(std::string("\x81\x0b" "echo: hello", 13)));
+  EXPECT_TRUE(received.ends_with(std::string("\x88\x02\x03\xe8", 4)));
+}
+
+}  // namespace
+}  // namespace coro::http
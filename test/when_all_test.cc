@@ -0,0 +1,89 @@
+#include "coro/when_all.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <ranges>
+#include <stdexcept>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/task.h"
+
+namespace coro {
+namespace {
+
+class PendingTasks {
+ public:
+  explicit PendingTasks(int count) : done_(count) {}
+
+  Task<int> Run(int index) {
+    running_++;
+    max_running_ = std::max(max_running_, running_);
+    started_++;
+    Promise<void>& done = done_[index];
+    co_await done;
+    running_--;
+    if (index == failing_index_) {
+      throw std::runtime_error("task failed");
+    }
+    co_return index * 10;
+  }
+
+  void Finish(int index) { done_[index].SetValue(); }
+  void set_failing_index(int index) { failing_index_ = index; }
+  int started() const { return started_; }
+  int running() const { return running_; }
+  int max_running() const { return max_running_; }
+
+ private:
+  std::vector<Promise<void>> done_;
+  int failing_index_ = -1;
+  int started_ = 0;
+  int running_ = 0;
+  int max_running_ = 0;
+};
+
+TEST(WhenAllLimitedTest, RunsBoundedNumberOfTasksFromLazyRange) {
+  PendingTasks tasks(5);
+  std::optional<std::vector<int>> result;
+  RunTask([&]() -> Task<> {
+    result = co_await WhenAllLimited(
+        2, std::views::iota(0, 5) |
+               std::views::transform([&](int i) { return tasks.Run(i); }));
+  });
+  EXPECT_EQ(tasks.started(), 2);
+  tasks.Finish(1);
+  EXPECT_EQ(tasks.started(), 3);
+  for (int i : {0, 3, 2, 4}) {
+    tasks.Finish(i);
+  }
+  EXPECT_EQ(tasks.max_running(), 2);
+  EXPECT_EQ(result, (std::vector<int>{0, 10, 20, 30, 40}));
+}
+
+TEST(WhenAllLimitedTest, StopsSchedulingAfterFirstFailure) {
+  PendingTasks tasks(4);
+  tasks.set_failing_index(0);
+  bool failed = false;
+  RunTask([&]() -> Task<> {
+    try {
+      std::vector<Task<int>> container;
+      for (int i = 0; i < 4; i++) {
+        container.push_back(tasks.Run(i));
+      }
+      co_await WhenAllLimited(2, std::move(container));
+    } catch (const std::runtime_error&) {
+      failed = true;
+    }
+  });
+  tasks.Finish(0);
+  EXPECT_FALSE(failed);
+  EXPECT_EQ(tasks.started(), 2);
+  tasks.Finish(1);
+  EXPECT_TRUE(failed);
+  EXPECT_EQ(tasks.started(), 2);
+}
+
+}  // namespace
+}  // namespace coro